@@ -0,0 +1,276 @@
+#include "AssetCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr uint64_t Alignment = 16;
+
+	constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+	constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+	constexpr uint64_t Prime3 = 0x165667B19E3779F9ull;
+	constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ull;
+	constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ull;
+
+	uint64_t Align(const uint64_t pOffset)
+	{
+		return (pOffset + Alignment - 1) & ~(Alignment - 1);
+	}
+
+	uint64_t RotateLeft(const uint64_t pValue, const int pBits)
+	{
+		return (pValue << pBits) | (pValue >> (64 - pBits));
+	}
+
+	uint64_t Read64(const uint8_t * pData)
+	{
+		uint64_t value;
+		memcpy(&value, pData, sizeof value);
+		return value;
+	}
+
+	uint32_t Read32(const uint8_t * pData)
+	{
+		uint32_t value;
+		memcpy(&value, pData, sizeof value);
+		return value;
+	}
+
+	uint64_t Round(uint64_t pAccumulator, const uint64_t pInput)
+	{
+		pAccumulator += pInput * Prime2;
+		return RotateLeft(pAccumulator, 31) * Prime1;
+	}
+
+	uint64_t Merge(const uint64_t pAccumulator, const uint64_t pLane)
+	{
+		return (pAccumulator ^ Round(0, pLane)) * Prime1 + Prime4;
+	}
+}
+
+uint64_t Advanced_Rendering::HashBytes(const void * pData, const size_t pSize, const uint64_t pSeed)
+{
+	auto data = static_cast<const uint8_t *>(pData);
+	const auto end = data + pSize;
+	uint64_t hash;
+
+	//Four independent lanes over 32 byte stripes, so the multiplies overlap
+	if (pSize >= 32)
+	{
+		uint64_t lanes[4] = { pSeed + Prime1 + Prime2, pSeed + Prime2, pSeed, pSeed - Prime1 };
+
+		for (; data + 32 <= end; data += 32)
+		{
+			lanes[0] = Round(lanes[0], Read64(data));
+			lanes[1] = Round(lanes[1], Read64(data + 8));
+			lanes[2] = Round(lanes[2], Read64(data + 16));
+			lanes[3] = Round(lanes[3], Read64(data + 24));
+		}
+
+		hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+
+		for (const auto lane : lanes)
+		{
+			hash = Merge(hash, lane);
+		}
+	}
+	else
+	{
+		hash = pSeed + Prime5;
+	}
+
+	hash += static_cast<uint64_t>(pSize);
+
+	for (; data + 8 <= end; data += 8)
+	{
+		hash = RotateLeft(hash ^ Round(0, Read64(data)), 27) * Prime1 + Prime4;
+	}
+
+	if (data + 4 <= end)
+	{
+		hash = RotateLeft(hash ^ (Read32(data) * Prime1), 23) * Prime2 + Prime3;
+		data += 4;
+	}
+
+	for (; data < end; data++)
+	{
+		hash = RotateLeft(hash ^ (*data * Prime5), 11) * Prime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+bool CookedFile::Open(const std::string & pFilename, const uint64_t pKey)
+{
+	Close();
+
+	if (!mFile.Open(pFilename) || mFile.Size() < sizeof(CookedFileHeader))
+	{
+		Close();
+		return false;
+	}
+
+	CookedFileHeader header;
+	memcpy(&header, mFile.Data(), sizeof header);
+
+	const auto payload = mFile.Data() + sizeof header;
+	const auto payloadSize = mFile.Size() - sizeof header;
+
+	if (header.magic != CookedFileMagic || header.version != CookedFileVersion || header.key != pKey ||
+		header.chunkCount > payloadSize / sizeof(CookedChunkEntry) || HashBytes(payload, payloadSize) != header.payloadHash)
+	{
+		Close();
+		return false;
+	}
+
+	mChunks = reinterpret_cast<const CookedChunkEntry *>(payload);
+	mChunkCount = header.chunkCount;
+
+	for (uint32_t i = 0; i < mChunkCount; i++)
+	{
+		const auto & chunk = mChunks[i];
+
+		if (chunk.offset % Alignment != 0 || chunk.offset > mFile.Size() || chunk.size > mFile.Size() - chunk.offset)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CookedFile::Close()
+{
+	mFile.Close();
+	mChunks = nullptr;
+	mChunkCount = 0;
+}
+
+const void * CookedFile::Chunk(const uint32_t pId, uint64_t & pSize) const
+{
+	for (uint32_t i = 0; i < mChunkCount; i++)
+	{
+		if (mChunks[i].id == pId)
+		{
+			pSize = mChunks[i].size;
+			return mFile.Data() + mChunks[i].offset;
+		}
+	}
+
+	pSize = 0;
+	return nullptr;
+}
+
+AssetCache::AssetCache(const std::string & pDirectory) : mDirectory(pDirectory), mHits(0), mMisses(0)
+{
+	//A cache that cannot be created just misses and fails to store, loading carries on uncached
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::u8path(mDirectory), error);
+}
+
+uint64_t AssetCache::Key(const void * pSource, const size_t pSourceSize, const uint32_t * pOptions, const uint32_t pOptionCount)
+{
+	return HashBytes(pSource, pSourceSize, HashBytes(pOptions, pOptionCount * sizeof(uint32_t)));
+}
+
+std::string AssetCache::Filename(const uint64_t pKey) const
+{
+	char name[32];
+	snprintf(name, sizeof name, "%016llx.cooked", static_cast<unsigned long long>(pKey));
+
+	return mDirectory + "/" + name;
+}
+
+std::shared_ptr<CookedFile> AssetCache::Find(const uint64_t pKey)
+{
+	auto file = std::make_shared<CookedFile>();
+
+	if (!file->Open(Filename(pKey), pKey))
+	{
+		mMisses++;
+		return nullptr;
+	}
+
+	mHits++;
+	return file;
+}
+
+bool AssetCache::Store(const uint64_t pKey, const std::vector<CookedChunk> & pChunks) const
+{
+	CookedFileHeader header = {};
+	header.magic = CookedFileMagic;
+	header.version = CookedFileVersion;
+	header.key = pKey;
+	header.chunkCount = static_cast<uint32_t>(pChunks.size());
+
+	std::vector<CookedChunkEntry> table(pChunks.size());
+	auto offset = Align(sizeof header + table.size() * sizeof(CookedChunkEntry));
+
+	for (size_t i = 0; i < pChunks.size(); i++)
+	{
+		table[i] = { pChunks[i].id, 0, offset, pChunks[i].size };
+		offset = Align(offset + pChunks[i].size);
+	}
+
+	//The payload is built in memory to hash it, cooked assets are a few megabytes at most
+	std::vector<uint8_t> payload(static_cast<size_t>(offset - sizeof header));
+	memcpy(payload.data(), table.data(), table.size() * sizeof(CookedChunkEntry));
+
+	for (size_t i = 0; i < pChunks.size(); i++)
+	{
+		if (pChunks[i].size > 0)
+		{
+			memcpy(payload.data() + (table[i].offset - sizeof header), pChunks[i].data, static_cast<size_t>(pChunks[i].size));
+		}
+	}
+
+	header.payloadHash = HashBytes(payload.data(), payload.size());
+
+	const auto filename = Filename(pKey);
+	const auto temporary = filename + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+	{
+		std::ofstream myfile(std::filesystem::u8path(temporary), std::ios::binary | std::ios::trunc);
+
+		if (!myfile)
+		{
+			return false;
+		}
+
+		myfile.write(reinterpret_cast<const char *>(&header), sizeof header);
+		myfile.write(reinterpret_cast<const char *>(payload.data()), static_cast<std::streamsize>(payload.size()));
+
+		if (!myfile.flush())
+		{
+			myfile.close();
+			std::error_code error;
+			std::filesystem::remove(std::filesystem::u8path(temporary), error);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(std::filesystem::u8path(temporary), std::filesystem::u8path(filename), error);
+
+	if (error)
+	{
+		std::filesystem::remove(std::filesystem::u8path(temporary), error);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+namespace Advanced_Rendering
+{
+	constexpr uint32_t ChunkId(const char pA, const char pB, const char pC, const char pD)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(pA)) | static_cast<uint32_t>(static_cast<uint8_t>(pB)) << 8 |
+			static_cast<uint32_t>(static_cast<uint8_t>(pC)) << 16 | static_cast<uint32_t>(static_cast<uint8_t>(pD)) << 24;
+	}
+
+	// Cooked file layout: the header, a table of chunks, then each chunk's data 16 byte aligned.
+	// payloadHash covers everything after the header, so a torn or damaged file reads as a miss.
+	struct CookedFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint64_t payloadHash;
+		uint32_t chunkCount;
+		uint32_t reserved;
+	};
+
+	struct CookedChunkEntry
+	{
+		uint32_t id;
+		uint32_t reserved;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	constexpr uint32_t CookedFileMagic = 0x4B4F4F43; // "COOK"
+	constexpr uint32_t CookedFileVersion = 1;
+
+	// A chunk to store, the data is only read during Store.
+	struct CookedChunk
+	{
+		uint32_t id;
+		const void * data;
+		uint64_t size;
+	};
+
+	// 64 bit xxHash of pSize bytes.
+	uint64_t HashBytes(const void * pData, size_t pSize, uint64_t pSeed = 0);
+
+	// Read-only cooked file, chunks point directly into the mapped file.
+	class CookedFile
+	{
+		MappedFile mFile;
+		const CookedChunkEntry * mChunks = nullptr;
+		uint32_t mChunkCount = 0;
+
+	public:
+		CookedFile() = default;
+		~CookedFile() = default;
+
+		CookedFile(const CookedFile &) = delete;
+		CookedFile(CookedFile &&) = delete;
+		CookedFile & operator= (const CookedFile &) = delete;
+		CookedFile & operator= (CookedFile &&) = delete;
+
+		// Fails unless the file is complete, undamaged and cooked for pKey
+		bool Open(const std::string & pFilename, uint64_t pKey);
+		void Close();
+
+		// Null when the file has no chunk pId
+		const void * Chunk(uint32_t pId, uint64_t & pSize) const;
+	};
+
+	// Directory of cooked assets, one file per key. A key is the hash of the source file's bytes
+	// seeded with the cooker's version and options, so editing the source, changing how it is
+	// cooked or bumping the cooker all miss and cook again; stale files are simply never opened.
+	// Find and Store may be called from any thread.
+	class AssetCache
+	{
+		std::string mDirectory;
+		std::atomic<uint32_t> mHits;
+		std::atomic<uint32_t> mMisses;
+
+	public:
+		// Creates pDirectory if it is missing
+		explicit AssetCache(const std::string & pDirectory);
+		~AssetCache() = default;
+
+		AssetCache(const AssetCache &) = delete;
+		AssetCache(AssetCache &&) = delete;
+		AssetCache & operator= (const AssetCache &) = delete;
+		AssetCache & operator= (AssetCache &&) = delete;
+
+		// pOptions holds the cooker version first, then anything else that changes the cooked output
+		static uint64_t Key(const void * pSource, size_t pSourceSize, const uint32_t * pOptions, uint32_t pOptionCount);
+
+		std::string Filename(uint64_t pKey) const;
+
+		// Null on a miss
+		std::shared_ptr<CookedFile> Find(uint64_t pKey);
+
+		// Writes to a temporary file and renames it over the key's file, so readers and other
+		// writers of the same key only ever see a whole file.
+		bool Store(uint64_t pKey, const std::vector<CookedChunk> & pChunks) const;
+
+		uint32_t Hits() const
+		{
+			return mHits.load();
+		}
+
+		uint32_t Misses() const
+		{
+			return mMisses.load();
+		}
+	};
+}
@@ -0,0 +1,303 @@
+#include "AssetLoader.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Advanced_Rendering;
+
+AssetLoader::AssetLoader(const uint32_t pWorkers) : mTotal(0), mCompleted(0)
+{
+	const auto workers = pWorkers > 0 ? pWorkers : std::max(2u, std::thread::hardware_concurrency());
+
+	for (uint32_t i = 0; i < workers; i++)
+	{
+		mWorkers.emplace_back(&AssetLoader::WorkerLoop, this);
+	}
+}
+
+AssetLoader::~AssetLoader()
+{
+	//Jobs hold pointers into their owners, so they are finished rather than abandoned
+	try
+	{
+		Wait();
+	}
+	catch (...)
+	{
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+
+	mWorkerSignal.notify_all();
+
+	for (auto & worker : mWorkers)
+	{
+		worker.join();
+	}
+}
+
+JobHandle AssetLoader::Add(const JobQueue pQueue, std::function<void()> pFunction, const std::vector<JobHandle> & pDependencies)
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	if (mTotal.load() == mCompleted.load())
+	{
+		mStart = Clock::now();
+	}
+
+	const auto handle = static_cast<JobHandle>(mJobs.size());
+	mJobs.push_back({ std::move(pFunction), pQueue, 0, false, false, {} });
+
+	for (const auto dependency : pDependencies)
+	{
+		auto & job = mJobs[dependency];
+
+		if (!job.done)
+		{
+			job.dependents.push_back(handle);
+			mJobs[handle].waiting++;
+		}
+	}
+
+	mTotal++;
+
+	if (mJobs[handle].waiting == 0)
+	{
+		(pQueue == JobQueue::Worker ? mWorkerReady : mRenderReady).push_back(handle);
+		lock.unlock();
+
+		if (pQueue == JobQueue::Worker)
+		{
+			mWorkerSignal.notify_one();
+		}
+		else
+		{
+			mProgressSignal.notify_all();
+		}
+	}
+
+	return handle;
+}
+
+void AssetLoader::Run(const JobHandle pJob)
+{
+	std::function<void()> function;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		function = std::move(mJobs[pJob].function);
+	}
+
+	const auto start = Clock::now();
+	std::exception_ptr error;
+
+	try
+	{
+		function();
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	const auto milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	auto workerJobs = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if (error && !mError)
+		{
+			mError = std::move(error);
+		}
+
+		mWorkMilliseconds += milliseconds;
+		mLongestMilliseconds = std::max(mLongestMilliseconds, milliseconds);
+
+		//Dependents of a failed job still run, so the fence is still reached and the error surfaces
+		auto & job = mJobs[pJob];
+		job.done = true;
+
+		for (const auto dependent : job.dependents)
+		{
+			auto & next = mJobs[dependent];
+
+			//A cancelled dependent is already done
+			if (!next.done && --next.waiting == 0)
+			{
+				if (next.queue == JobQueue::Worker)
+				{
+					mWorkerReady.push_back(dependent);
+					workerJobs++;
+				}
+				else
+				{
+					mRenderReady.push_back(dependent);
+				}
+			}
+		}
+
+		job.dependents.clear();
+		job.dependents.shrink_to_fit();
+
+		if (++mCompleted == mTotal.load())
+		{
+			mEnd = Clock::now();
+		}
+	}
+
+	for (auto i = 0; i < workerJobs; i++)
+	{
+		mWorkerSignal.notify_one();
+	}
+
+	mProgressSignal.notify_all();
+}
+
+void AssetLoader::WorkerLoop()
+{
+	while (true)
+	{
+		JobHandle job;
+
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkerSignal.wait(lock, [this]() { return mStopping || !mWorkerReady.empty(); });
+
+			if (mWorkerReady.empty())
+			{
+				return;
+			}
+
+			//Started as it leaves the queue, so Cancel cannot drop it on its way to Run
+			job = mWorkerReady.front();
+			mWorkerReady.pop_front();
+			mJobs[job].started = true;
+		}
+
+		Run(job);
+	}
+}
+
+uint32_t AssetLoader::RunRenderJobs()
+{
+	uint32_t count = 0;
+
+	while (true)
+	{
+		JobHandle job;
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			if (mRenderReady.empty())
+			{
+				break;
+			}
+
+			job = mRenderReady.front();
+			mRenderReady.pop_front();
+			mJobs[job].started = true;
+		}
+
+		Run(job);
+		count++;
+	}
+
+	std::exception_ptr error;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		std::swap(error, mError);
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+
+	return count;
+}
+
+void AssetLoader::Wait()
+{
+	while (true)
+	{
+		RunRenderJobs();
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mProgressSignal.wait(lock, [this]() { return IsComplete() || !mRenderReady.empty() || mError; });
+
+		if (IsComplete() && mRenderReady.empty() && !mError)
+		{
+			return;
+		}
+	}
+}
+
+void AssetLoader::Cancel()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	mWorkerReady.clear();
+	mRenderReady.clear();
+
+	//Dropped jobs count as completed, so the fence is the running jobs finishing
+	for (auto & job : mJobs)
+	{
+		if (!job.started && !job.done)
+		{
+			job.function = nullptr;
+			job.done = true;
+			job.dependents.clear();
+			job.dependents.shrink_to_fit();
+			mCompleted++;
+		}
+	}
+
+	mProgressSignal.wait(lock, [this]() { return IsComplete(); });
+
+	//The load is abandoned, so is whatever it threw
+	mError = nullptr;
+	mEnd = Clock::now();
+}
+
+double AssetLoader::Milliseconds() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if (mTotal.load() == 0)
+	{
+		return 0.0;
+	}
+
+	const auto end = IsComplete() ? mEnd : Clock::now();
+	return std::chrono::duration<double, std::milli>(end - mStart).count();
+}
+
+double AssetLoader::WorkMilliseconds() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mWorkMilliseconds;
+}
+
+double AssetLoader::LongestJobMilliseconds() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mLongestMilliseconds;
+}
+
+std::shared_ptr<MappedFile> Advanced_Rendering::ReadAssetFile(const std::string & pFilename)
+{
+	auto file = std::make_shared<MappedFile>();
+
+	if (!file->Open(pFilename))
+	{
+		throw std::runtime_error("Could not open " + pFilename);
+	}
+
+	return file;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MappedFile.h"
+
+namespace Advanced_Rendering
+{
+	using JobHandle = uint32_t;
+
+	enum class JobQueue
+	{
+		Worker,		// file reads, parsing and device object creation, the device is free threaded
+		Render		// anything on the immediate context, run from RunRenderJobs
+	};
+
+	// Dependency graph of loading jobs, typically read -> parse -> upload per asset. A job is queued
+	// once every job it depends on has finished, so independent assets load side by side and the
+	// whole load takes as long as its slowest chain. The fence is the completed count reaching the
+	// added count; jobs may be added while others run.
+	class AssetLoader
+	{
+		struct Job
+		{
+			std::function<void()> function;
+			JobQueue queue;
+			uint32_t waiting;
+			bool started;
+			bool done;
+			std::vector<JobHandle> dependents;
+		};
+
+		using Clock = std::chrono::steady_clock;
+
+		std::deque<Job> mJobs;
+		std::deque<JobHandle> mWorkerReady;
+		std::deque<JobHandle> mRenderReady;
+		std::vector<std::thread> mWorkers;
+
+		mutable std::mutex mMutex;
+		std::condition_variable mWorkerSignal;
+		std::condition_variable mProgressSignal;
+		bool mStopping = false;
+
+		std::atomic<uint32_t> mTotal;
+		std::atomic<uint32_t> mCompleted;
+		std::exception_ptr mError;
+
+		Clock::time_point mStart;
+		Clock::time_point mEnd;
+		double mWorkMilliseconds = 0.0;
+		double mLongestMilliseconds = 0.0;
+
+		void WorkerLoop();
+		void Run(JobHandle pJob);
+
+	public:
+		// pWorkers of 0 takes one per hardware thread, loading waits on I/O as much as the CPU
+		explicit AssetLoader(uint32_t pWorkers = 0);
+		~AssetLoader();
+
+		AssetLoader(const AssetLoader &) = delete;
+		AssetLoader(AssetLoader &&) = delete;
+		AssetLoader & operator= (const AssetLoader &) = delete;
+		AssetLoader & operator= (AssetLoader &&) = delete;
+
+		JobHandle Add(JobQueue pQueue, std::function<void()> pFunction, const std::vector<JobHandle> & pDependencies = {});
+
+		// Runs the render jobs that are ready on the calling thread. Rethrows the first exception any
+		// job threw.
+		uint32_t RunRenderJobs();
+
+		// Blocks until the fence, running render jobs meanwhile
+		void Wait();
+
+		// Drops every job that has not started, render jobs included, then blocks until the running
+		// worker jobs finish. For a lost device, whose queued uploads would reach a dead context.
+		void Cancel();
+
+		bool IsComplete() const
+		{
+			return mCompleted.load() == mTotal.load();
+		}
+
+		uint32_t Completed() const
+		{
+			return mCompleted.load();
+		}
+
+		uint32_t Total() const
+		{
+			return mTotal.load();
+		}
+
+		float Progress() const
+		{
+			const auto total = mTotal.load();
+			return total == 0 ? 1.0f : mCompleted.load() / static_cast<float>(total);
+		}
+
+		// From the first job added to the fence, or to now while loading
+		double Milliseconds() const;
+
+		// Time spent inside jobs, summed over every thread, and the longest single job
+		double WorkMilliseconds() const;
+		double LongestJobMilliseconds() const;
+	};
+
+	// Maps pFilename on the calling thread, for read jobs to hand to their parse or upload job.
+	// Throws std::runtime_error when the file cannot be opened.
+	std::shared_ptr<MappedFile> ReadAssetFile(const std::string & pFilename);
+}
@@ -1,5 +1,4 @@
-Texture2D colorTexture : register(t0);
-SamplerState Sampler : register(s0);
+#include "PackSampling.hlsli"
 
 struct PixelShaderInput
 {
@@ -17,7 +16,7 @@ PixelShaderOutput main(PixelShaderInput input)
 {
     PixelShaderOutput output = (PixelShaderOutput) 0;
     
-    output.color = colorTexture.Sample(Sampler, input.uv);
+    output.color = SamplePack(input.uv);
     
     if (output.color.a < 0.1f)
     {
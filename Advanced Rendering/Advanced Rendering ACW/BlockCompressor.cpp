@@ -0,0 +1,806 @@
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "Parallel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BLOCK_COMPRESSOR_AVX2
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BLOCK_COMPRESSOR_SSE2
+#endif
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	// Picks the nearest of pCount palette entries for each of the 16 pixels and returns the summed
+	// squared error. pValues holds C channels of 16 values. Every endpoint candidate is scored
+	// here, so it runs 8 or 4 pixels at a time where the target has the registers for it.
+	template <uint32_t C>
+	float FitIndices(const float * const * pValues, const float (*pPalette)[C], const uint32_t pCount, uint8_t * pIndices)
+	{
+#if defined(BLOCK_COMPRESSOR_AVX2)
+		__m256 total = _mm256_setzero_ps();
+
+		for (uint32_t group = 0; group < 16; group += 8)
+		{
+			__m256 best = _mm256_set1_ps(FLT_MAX);
+			__m256 bestIndex = _mm256_setzero_ps();
+
+			for (uint32_t k = 0; k < pCount; k++)
+			{
+				__m256 distance = _mm256_setzero_ps();
+
+				for (uint32_t c = 0; c < C; c++)
+				{
+					const auto delta = _mm256_sub_ps(_mm256_loadu_ps(pValues[c] + group), _mm256_set1_ps(pPalette[k][c]));
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(delta, delta));
+				}
+
+				//Ties keep the earlier entry
+				const auto closer = _mm256_cmp_ps(distance, best, _CMP_LT_OQ);
+				best = _mm256_min_ps(distance, best);
+				bestIndex = _mm256_blendv_ps(bestIndex, _mm256_set1_ps(static_cast<float>(k)), closer);
+			}
+
+			total = _mm256_add_ps(total, best);
+
+			alignas(32) int32_t indices[8];
+			_mm256_store_si256(reinterpret_cast<__m256i *>(indices), _mm256_cvtps_epi32(bestIndex));
+
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				pIndices[group + i] = static_cast<uint8_t>(indices[i]);
+			}
+		}
+
+		alignas(32) float sums[8];
+		_mm256_store_ps(sums, total);
+
+		return ((sums[0] + sums[1]) + (sums[2] + sums[3])) + ((sums[4] + sums[5]) + (sums[6] + sums[7]));
+#elif defined(BLOCK_COMPRESSOR_SSE2)
+		__m128 total = _mm_setzero_ps();
+
+		for (uint32_t group = 0; group < 16; group += 4)
+		{
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128 bestIndex = _mm_setzero_ps();
+
+			for (uint32_t k = 0; k < pCount; k++)
+			{
+				__m128 distance = _mm_setzero_ps();
+
+				for (uint32_t c = 0; c < C; c++)
+				{
+					const auto delta = _mm_sub_ps(_mm_loadu_ps(pValues[c] + group), _mm_set1_ps(pPalette[k][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(delta, delta));
+				}
+
+				//Ties keep the earlier entry
+				const auto closer = _mm_cmplt_ps(distance, best);
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(k))), _mm_andnot_ps(closer, bestIndex));
+			}
+
+			total = _mm_add_ps(total, best);
+
+			alignas(16) int32_t indices[4];
+			_mm_store_si128(reinterpret_cast<__m128i *>(indices), _mm_cvtps_epi32(bestIndex));
+
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				pIndices[group + i] = static_cast<uint8_t>(indices[i]);
+			}
+		}
+
+		alignas(16) float sums[4];
+		_mm_store_ps(sums, total);
+
+		return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#else
+		auto total = 0.0f;
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			auto best = FLT_MAX;
+
+			for (uint32_t k = 0; k < pCount; k++)
+			{
+				auto distance = 0.0f;
+
+				for (uint32_t c = 0; c < C; c++)
+				{
+					const auto delta = pValues[c][i] - pPalette[k][c];
+					distance += delta * delta;
+				}
+
+				if (distance < best)
+				{
+					best = distance;
+					pIndices[i] = static_cast<uint8_t>(k);
+				}
+			}
+
+			total += best;
+		}
+
+		return total;
+#endif
+	}
+
+	uint16_t Pack565(const float * pColor)
+	{
+		const auto r = static_cast<uint32_t>(std::min(std::max(pColor[0] * (31.0f / 255.0f) + 0.5f, 0.0f), 31.0f));
+		const auto g = static_cast<uint32_t>(std::min(std::max(pColor[1] * (63.0f / 255.0f) + 0.5f, 0.0f), 63.0f));
+		const auto b = static_cast<uint32_t>(std::min(std::max(pColor[2] * (31.0f / 255.0f) + 0.5f, 0.0f), 31.0f));
+
+		return static_cast<uint16_t>(r << 11 | g << 5 | b);
+	}
+
+	// Bit replication, as the hardware expands the endpoints
+	void Unpack565(const uint16_t pColor, uint32_t (&pRgb)[3])
+	{
+		const auto r = pColor >> 11 & 31u;
+		const auto g = pColor >> 5 & 63u;
+		const auto b = pColor & 31u;
+
+		pRgb[0] = r << 3 | r >> 2;
+		pRgb[1] = g << 2 | g >> 4;
+		pRgb[2] = b << 3 | b >> 2;
+	}
+
+	// Four colour blocks interpolate thirds, three colour blocks a half. The three colour mode's
+	// fourth entry is transparent black, which opaque textures must not use, so it is left out.
+	uint32_t ColorPalette(const uint16_t pColor0, const uint16_t pColor1, const bool pFourColor, float (&pPalette)[8][3])
+	{
+		uint32_t rgb0[3], rgb1[3];
+		Unpack565(pColor0, rgb0);
+		Unpack565(pColor1, rgb1);
+
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			const auto a = static_cast<float>(rgb0[c]);
+			const auto b = static_cast<float>(rgb1[c]);
+
+			pPalette[0][c] = a;
+			pPalette[1][c] = b;
+
+			if (pFourColor)
+			{
+				pPalette[2][c] = (2.0f * a + b) / 3.0f;
+				pPalette[3][c] = (a + 2.0f * b) / 3.0f;
+			}
+			else
+			{
+				pPalette[2][c] = (a + b) * 0.5f;
+			}
+		}
+
+		return pFourColor ? 4 : 3;
+	}
+
+	struct ColorBlock
+	{
+		uint16_t color0 = 0;
+		uint16_t color1 = 0;
+		bool fourColor = true;
+		uint8_t indices[16] = {};
+		float error = FLT_MAX;
+	};
+
+	// Keeps pStart to pEnd in pBest when it beats what is there
+	void TryColor(const float * const * pRgb, const float * pStart, const float * pEnd, const bool pFourColor, ColorBlock & pBest)
+	{
+		ColorBlock block;
+		block.color0 = Pack565(pStart);
+		block.color1 = Pack565(pEnd);
+		block.fourColor = pFourColor;
+
+		//The endpoint order selects the mode, swapping them only renumbers the palette
+		if (pFourColor ? block.color0 < block.color1 : block.color0 > block.color1)
+		{
+			std::swap(block.color0, block.color1);
+		}
+
+		float palette[8][3];
+		const auto count = ColorPalette(block.color0, block.color1, pFourColor, palette);
+		block.error = FitIndices<3>(pRgb, palette, count, block.indices);
+
+		if (block.error < pBest.error)
+		{
+			pBest = block;
+		}
+	}
+
+	// The endpoints that best fit the pixels for the indices they were given, or false when
+	// every pixel took the same weight.
+	bool LeastSquares(const float * const * pValues, const uint32_t pChannels, const uint8_t * pIndices, const float * pWeights,
+		float * pStart, float * pEnd)
+	{
+		auto aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = {}, bx[3] = {};
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const auto t = pWeights[pIndices[i]];
+			const auto s = 1.0f - t;
+
+			aa += s * s;
+			ab += s * t;
+			bb += t * t;
+
+			for (uint32_t c = 0; c < pChannels; c++)
+			{
+				ax[c] += s * pValues[c][i];
+				bx[c] += t * pValues[c][i];
+			}
+		}
+
+		const auto determinant = aa * bb - ab * ab;
+
+		if (std::fabs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		for (uint32_t c = 0; c < pChannels; c++)
+		{
+			pStart[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+			pEnd[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+		}
+
+		return true;
+	}
+
+	// Fast takes the corners of the bounding box on the diagonal the colours lean along, pulled in
+	// a little so the interpolated entries land on more pixels. The others take the extent of the
+	// pixels along their principal axis.
+	void ColorEndpoints(const float * const * pRgb, const CompressQuality pQuality, float (&pStart)[3], float (&pEnd)[3])
+	{
+		float minimum[3], maximum[3], mean[3] = {};
+
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			minimum[c] = *std::min_element(pRgb[c], pRgb[c] + 16);
+			maximum[c] = *std::max_element(pRgb[c], pRgb[c] + 16);
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				mean[c] += pRgb[c][i];
+			}
+
+			mean[c] /= 16.0f;
+		}
+
+		float covariance[6] = {};
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const float d[3] = { pRgb[0][i] - mean[0], pRgb[1][i] - mean[1], pRgb[2][i] - mean[2] };
+
+			covariance[0] += d[0] * d[0];
+			covariance[1] += d[0] * d[1];
+			covariance[2] += d[0] * d[2];
+			covariance[3] += d[1] * d[1];
+			covariance[4] += d[1] * d[2];
+			covariance[5] += d[2] * d[2];
+		}
+
+		if (pQuality == CompressQuality::Fast)
+		{
+			//Flip the channels that fall as green, the widest channel in most textures, rises
+			const auto flipRed = covariance[1] < 0.0f;
+			const auto flipBlue = covariance[4] < 0.0f;
+
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				const auto inset = (maximum[c] - minimum[c]) / 16.0f;
+				const auto flip = (c == 0 && flipRed) || (c == 2 && flipBlue);
+
+				pStart[c] = flip ? minimum[c] + inset : maximum[c] - inset;
+				pEnd[c] = flip ? maximum[c] - inset : minimum[c] + inset;
+			}
+
+			return;
+		}
+
+		//Power iteration from the box diagonal converges in a handful of steps on 3x3
+		float axis[3] = { maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2] };
+
+		for (uint32_t iteration = 0; iteration < 8; iteration++)
+		{
+			const float next[3] =
+			{
+				covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+				covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+				covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+			};
+
+			const auto length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+
+			if (length < 1e-6f)
+			{
+				break;
+			}
+
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+
+		auto low = FLT_MAX, high = -FLT_MAX;
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const auto t = (pRgb[0][i] - mean[0]) * axis[0] + (pRgb[1][i] - mean[1]) * axis[1] + (pRgb[2][i] - mean[2]) * axis[2];
+			low = std::min(low, t);
+			high = std::max(high, t);
+		}
+
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			pStart[c] = std::min(std::max(mean[c] + axis[c] * high, 0.0f), 255.0f);
+			pEnd[c] = std::min(std::max(mean[c] + axis[c] * low, 0.0f), 255.0f);
+		}
+	}
+
+	void EncodeColor(const float * const * pRgb, const CompressQuality pQuality, const bool pAllowThreeColor, uint8_t * pBlock)
+	{
+		static const float fourWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		static const float threeWeights[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+
+		float start[3], end[3];
+		ColorEndpoints(pRgb, pQuality, start, end);
+
+		ColorBlock best;
+		TryColor(pRgb, start, end, true, best);
+
+		const auto passes = pQuality == CompressQuality::Fast ? 0u : pQuality == CompressQuality::Normal ? 1u : 4u;
+
+		for (uint32_t pass = 0; pass < passes && best.error > 0.0f; pass++)
+		{
+			const auto error = best.error;
+
+			if (!LeastSquares(pRgb, 3, best.indices, fourWeights, start, end))
+			{
+				break;
+			}
+
+			TryColor(pRgb, start, end, true, best);
+
+			if (best.error >= error)
+			{
+				break;
+			}
+		}
+
+		//A half way entry fits blocks with two colours and a blend between them better than thirds
+		if (pAllowThreeColor && pQuality == CompressQuality::High && best.error > 0.0f)
+		{
+			ColorEndpoints(pRgb, pQuality, start, end);
+
+			ColorBlock three;
+			TryColor(pRgb, start, end, false, three);
+
+			for (uint32_t pass = 0; pass < passes; pass++)
+			{
+				const auto error = three.error;
+
+				if (!LeastSquares(pRgb, 3, three.indices, threeWeights, start, end))
+				{
+					break;
+				}
+
+				TryColor(pRgb, start, end, false, three);
+
+				if (three.error >= error)
+				{
+					break;
+				}
+			}
+
+			if (three.error < best.error)
+			{
+				best = three;
+			}
+		}
+
+		uint32_t indices = 0;
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			indices |= static_cast<uint32_t>(best.indices[i]) << (i * 2);
+		}
+
+		pBlock[0] = static_cast<uint8_t>(best.color0);
+		pBlock[1] = static_cast<uint8_t>(best.color0 >> 8);
+		pBlock[2] = static_cast<uint8_t>(best.color1);
+		pBlock[3] = static_cast<uint8_t>(best.color1 >> 8);
+
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			pBlock[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	// a0 > a1 interpolates six values between them, otherwise four with 0 and 255 added
+	void AlphaPalette(const uint32_t pAlpha0, const uint32_t pAlpha1, float (&pPalette)[8][1])
+	{
+		const auto a = static_cast<float>(pAlpha0);
+		const auto b = static_cast<float>(pAlpha1);
+
+		pPalette[0][0] = a;
+		pPalette[1][0] = b;
+
+		if (pAlpha0 > pAlpha1)
+		{
+			for (uint32_t i = 1; i < 7; i++)
+			{
+				pPalette[i + 1][0] = ((7 - i) * a + i * b) / 7.0f;
+			}
+		}
+		else
+		{
+			for (uint32_t i = 1; i < 5; i++)
+			{
+				pPalette[i + 1][0] = ((5 - i) * a + i * b) / 5.0f;
+			}
+
+			pPalette[6][0] = 0.0f;
+			pPalette[7][0] = 255.0f;
+		}
+	}
+
+	struct AlphaBlock
+	{
+		uint32_t alpha0 = 0;
+		uint32_t alpha1 = 0;
+		uint8_t indices[16] = {};
+		float error = FLT_MAX;
+	};
+
+	void TryAlpha(const float * pValues, const int pAlpha0, const int pAlpha1, AlphaBlock & pBest)
+	{
+		AlphaBlock block;
+		block.alpha0 = static_cast<uint32_t>(std::min(std::max(pAlpha0, 0), 255));
+		block.alpha1 = static_cast<uint32_t>(std::min(std::max(pAlpha1, 0), 255));
+
+		float palette[8][1];
+		AlphaPalette(block.alpha0, block.alpha1, palette);
+		block.error = FitIndices<1>(&pValues, palette, 8, block.indices);
+
+		if (block.error < pBest.error)
+		{
+			pBest = block;
+		}
+	}
+
+	// One BC4 block, also the alpha half of BC3 and each half of BC5
+	void EncodeAlpha(const float * pValues, const CompressQuality pQuality, uint8_t * pBlock)
+	{
+		auto minimum = 255, maximum = 0, innerMinimum = 255, innerMaximum = 0;
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const auto value = static_cast<int>(pValues[i] + 0.5f);
+
+			minimum = std::min(minimum, value);
+			maximum = std::max(maximum, value);
+
+			//The six value mode has 0 and 255 for free, its endpoints only need to span the rest
+			if (value != 0 && value != 255)
+			{
+				innerMinimum = std::min(innerMinimum, value);
+				innerMaximum = std::max(innerMaximum, value);
+			}
+		}
+
+		const auto hasInner = innerMinimum <= innerMaximum;
+
+		AlphaBlock best;
+		TryAlpha(pValues, maximum, minimum, best);
+
+		if (pQuality != CompressQuality::Fast && best.error > 0.0f && hasInner && (minimum == 0 || maximum == 255))
+		{
+			TryAlpha(pValues, innerMinimum, innerMaximum, best);
+		}
+
+		if (pQuality == CompressQuality::High && best.error > 0.0f)
+		{
+			static const float eightWeights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+			//Least squares only holds in the eight value mode, the six value mode's 0 and 255 do not move
+			if (best.alpha0 > best.alpha1)
+			{
+				for (uint32_t pass = 0; pass < 4; pass++)
+				{
+					const auto error = best.error;
+					float start, end;
+
+					if (!LeastSquares(&pValues, 1, best.indices, eightWeights, &start, &end))
+					{
+						break;
+					}
+
+					TryAlpha(pValues, static_cast<int>(start + 0.5f), static_cast<int>(end + 0.5f), best);
+
+					if (best.error >= error)
+					{
+						break;
+					}
+				}
+			}
+
+			//Rounding the endpoints can land a step off, so try their neighbours in the same mode
+			const auto alpha0 = static_cast<int>(best.alpha0);
+			const auto alpha1 = static_cast<int>(best.alpha1);
+			const auto eight = alpha0 > alpha1;
+
+			for (auto d0 = -1; d0 <= 1; d0++)
+			{
+				for (auto d1 = -1; d1 <= 1; d1++)
+				{
+					if ((d0 != 0 || d1 != 0) && (alpha0 + d0 > alpha1 + d1) == eight)
+					{
+						TryAlpha(pValues, alpha0 + d0, alpha1 + d1, best);
+					}
+				}
+			}
+		}
+
+		uint64_t indices = 0;
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			indices |= static_cast<uint64_t>(best.indices[i]) << (i * 3);
+		}
+
+		pBlock[0] = static_cast<uint8_t>(best.alpha0);
+		pBlock[1] = static_cast<uint8_t>(best.alpha1);
+
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			pBlock[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	void DecodeColor(const uint8_t * pBlock, const bool pFourColorOnly, uint8_t * pPixels)
+	{
+		const auto color0 = static_cast<uint16_t>(pBlock[0] | pBlock[1] << 8);
+		const auto color1 = static_cast<uint16_t>(pBlock[2] | pBlock[3] << 8);
+
+		uint32_t rgb0[3], rgb1[3];
+		Unpack565(color0, rgb0);
+		Unpack565(color1, rgb1);
+
+		uint8_t palette[4][4];
+
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			palette[0][c] = static_cast<uint8_t>(rgb0[c]);
+			palette[1][c] = static_cast<uint8_t>(rgb1[c]);
+
+			if (pFourColorOnly || color0 > color1)
+			{
+				palette[2][c] = static_cast<uint8_t>((2 * rgb0[c] + rgb1[c] + 1) / 3);
+				palette[3][c] = static_cast<uint8_t>((rgb0[c] + 2 * rgb1[c] + 1) / 3);
+			}
+			else
+			{
+				palette[2][c] = static_cast<uint8_t>((rgb0[c] + rgb1[c] + 1) / 2);
+				palette[3][c] = 0;
+			}
+		}
+
+		palette[0][3] = palette[1][3] = palette[2][3] = 255;
+		palette[3][3] = pFourColorOnly || color0 > color1 ? 255 : 0;
+
+		const auto indices = static_cast<uint32_t>(pBlock[4]) | static_cast<uint32_t>(pBlock[5]) << 8 |
+			static_cast<uint32_t>(pBlock[6]) << 16 | static_cast<uint32_t>(pBlock[7]) << 24;
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const auto & entry = palette[indices >> (i * 2) & 3];
+
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				pPixels[i * 4 + c] = entry[c];
+			}
+		}
+	}
+
+	void DecodeAlpha(const uint8_t * pBlock, const uint32_t pChannel, uint8_t * pPixels)
+	{
+		const uint32_t alpha0 = pBlock[0];
+		const uint32_t alpha1 = pBlock[1];
+
+		uint8_t palette[8] = { static_cast<uint8_t>(alpha0), static_cast<uint8_t>(alpha1) };
+
+		if (alpha0 > alpha1)
+		{
+			for (uint32_t i = 1; i < 7; i++)
+			{
+				palette[i + 1] = static_cast<uint8_t>(((7 - i) * alpha0 + i * alpha1 + 3) / 7);
+			}
+		}
+		else
+		{
+			for (uint32_t i = 1; i < 5; i++)
+			{
+				palette[i + 1] = static_cast<uint8_t>(((5 - i) * alpha0 + i * alpha1 + 2) / 5);
+			}
+
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			indices |= static_cast<uint64_t>(pBlock[2 + i]) << (i * 8);
+		}
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			pPixels[i * 4 + pChannel] = palette[indices >> (i * 3) & 7];
+		}
+	}
+
+	void ReadPixel(const uint8_t * pRow, const uint32_t pX, const PixelLayout pLayout, uint8_t * pPixel)
+	{
+		switch (pLayout)
+		{
+		case PixelLayout::Rgba:
+			pPixel[0] = pRow[pX * 4];
+			pPixel[1] = pRow[pX * 4 + 1];
+			pPixel[2] = pRow[pX * 4 + 2];
+			pPixel[3] = pRow[pX * 4 + 3];
+			break;
+
+		case PixelLayout::Bgra:
+		case PixelLayout::Bgrx:
+			pPixel[0] = pRow[pX * 4 + 2];
+			pPixel[1] = pRow[pX * 4 + 1];
+			pPixel[2] = pRow[pX * 4];
+			pPixel[3] = pLayout == PixelLayout::Bgra ? pRow[pX * 4 + 3] : 255;
+			break;
+
+		default:
+			pPixel[0] = pPixel[1] = pPixel[2] = pRow[pX];
+			pPixel[3] = 255;
+			break;
+		}
+	}
+}
+
+uint32_t Advanced_Rendering::BlockBytes(const BlockFormat pFormat)
+{
+	return pFormat == BlockFormat::BC1 || pFormat == BlockFormat::BC4 ? 8 : 16;
+}
+
+DdsFormat Advanced_Rendering::BlockDdsFormat(const BlockFormat pFormat)
+{
+	switch (pFormat)
+	{
+	case BlockFormat::BC1:
+		return DdsFormat::BC1_UNORM;
+
+	case BlockFormat::BC3:
+		return DdsFormat::BC3_UNORM;
+
+	case BlockFormat::BC4:
+		return DdsFormat::BC4_UNORM;
+
+	default:
+		return DdsFormat::BC5_UNORM;
+	}
+}
+
+size_t Advanced_Rendering::CompressedSize(const uint32_t pWidth, const uint32_t pHeight, const BlockFormat pFormat)
+{
+	const auto blocksWide = static_cast<size_t>(std::max(1u, (pWidth + 3) / 4));
+	const auto blocksHigh = static_cast<size_t>(std::max(1u, (pHeight + 3) / 4));
+
+	return blocksWide * blocksHigh * BlockBytes(pFormat);
+}
+
+void Advanced_Rendering::CompressBlock(const uint8_t * const pPixels, const BlockFormat pFormat, const CompressQuality pQuality, uint8_t * const pBlock)
+{
+	//Channel planes, so the index fit loads a row of pixels per register
+	alignas(32) float channels[4][16];
+
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			channels[c][i] = pPixels[i * 4 + c];
+		}
+	}
+
+	const float * const rgb[3] = { channels[0], channels[1], channels[2] };
+
+	switch (pFormat)
+	{
+	case BlockFormat::BC1:
+		EncodeColor(rgb, pQuality, true, pBlock);
+		break;
+
+	case BlockFormat::BC3:
+		EncodeAlpha(channels[3], pQuality, pBlock);
+		EncodeColor(rgb, pQuality, false, pBlock + 8);
+		break;
+
+	case BlockFormat::BC4:
+		EncodeAlpha(channels[0], pQuality, pBlock);
+		break;
+
+	case BlockFormat::BC5:
+		EncodeAlpha(channels[0], pQuality, pBlock);
+		EncodeAlpha(channels[1], pQuality, pBlock + 8);
+		break;
+	}
+}
+
+void Advanced_Rendering::DecompressBlock(const uint8_t * const pBlock, const BlockFormat pFormat, uint8_t * const pPixels)
+{
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		pPixels[i * 4] = pPixels[i * 4 + 1] = pPixels[i * 4 + 2] = 0;
+		pPixels[i * 4 + 3] = 255;
+	}
+
+	switch (pFormat)
+	{
+	case BlockFormat::BC1:
+		DecodeColor(pBlock, false, pPixels);
+		break;
+
+	case BlockFormat::BC3:
+		DecodeColor(pBlock + 8, true, pPixels);
+		DecodeAlpha(pBlock, 3, pPixels);
+		break;
+
+	case BlockFormat::BC4:
+		DecodeAlpha(pBlock, 0, pPixels);
+		break;
+
+	case BlockFormat::BC5:
+		DecodeAlpha(pBlock, 0, pPixels);
+		DecodeAlpha(pBlock + 8, 1, pPixels);
+		break;
+	}
+}
+
+void Advanced_Rendering::CompressSurface(const PixelView & pSource, const BlockFormat pFormat, const CompressQuality pQuality, uint8_t * const pOutput)
+{
+	const auto blocksWide = std::max(1u, (pSource.width + 3) / 4);
+	const auto blocksHigh = std::max(1u, (pSource.height + 3) / 4);
+	const auto blockBytes = BlockBytes(pFormat);
+
+	ParallelFor(blocksHigh, [&](const uint32_t pRow)
+	{
+		uint8_t pixels[64];
+		auto output = pOutput + static_cast<size_t>(pRow) * blocksWide * blockBytes;
+
+		for (uint32_t column = 0; column < blocksWide; column++, output += blockBytes)
+		{
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				const auto row = pSource.data + std::min(pRow * 4 + y, pSource.height - 1) * pSource.rowPitch;
+
+				for (uint32_t x = 0; x < 4; x++)
+				{
+					ReadPixel(row, std::min(column * 4 + x, pSource.width - 1), pSource.layout, pixels + (y * 4 + x) * 4);
+				}
+			}
+
+			CompressBlock(pixels, pFormat, pQuality, output);
+		}
+	});
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "DdsParser.h"
+
+namespace Advanced_Rendering
+{
+	enum class BlockFormat
+	{
+		BC1,		// RGB, 4 bits a pixel
+		BC3,		// RGBA, 8 bits a pixel
+		BC4,		// red, 4 bits a pixel, for displacement and occlusion
+		BC5			// red and green, 8 bits a pixel, for tangent space normals with z rebuilt in the shader
+	};
+
+	enum class CompressQuality
+	{
+		Fast,		// bounding box endpoints
+		Normal,		// principal axis endpoints refined once by least squares, both BC4 modes tried
+		High		// refined until it stops improving, the BC1 three colour mode and nearby BC4 endpoints tried as well
+	};
+
+	enum class PixelLayout
+	{
+		Rgba,
+		Bgra,
+		Bgrx,		// alpha is ignored and read as opaque
+		R			// one byte a pixel, read as grey
+	};
+
+	// Uncompressed 8 bit pixels, rows pRowPitch bytes apart
+	struct PixelView
+	{
+		const uint8_t * data = nullptr;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		size_t rowPitch = 0;
+		PixelLayout layout = PixelLayout::Rgba;
+	};
+
+	uint32_t BlockBytes(BlockFormat pFormat);
+	DdsFormat BlockDdsFormat(BlockFormat pFormat);
+
+	// Bytes for the 4x4 blocks covering pWidth by pHeight, row after row of blocks
+	size_t CompressedSize(uint32_t pWidth, uint32_t pHeight, BlockFormat pFormat);
+
+	// One block from 16 RGBA pixels in rows of four
+	void CompressBlock(const uint8_t * pPixels, BlockFormat pFormat, CompressQuality pQuality, uint8_t * pBlock);
+
+	// 16 RGBA pixels as Direct3D decodes them, missing channels read 0 and alpha 255
+	void DecompressBlock(const uint8_t * pBlock, BlockFormat pFormat, uint8_t * pPixels);
+
+	// Compresses the whole surface into CompressedSize bytes at pOutput, rows of blocks spread over the
+	// hardware threads. Blocks past the right and bottom edges repeat the last column and row.
+	void CompressSurface(const PixelView & pSource, BlockFormat pFormat, CompressQuality pQuality, uint8_t * pOutput);
+}
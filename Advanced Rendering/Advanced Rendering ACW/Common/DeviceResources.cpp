@@ -75,6 +75,7 @@ DX::DeviceResources::DeviceResources() :
 	m_currentOrientation(DisplayOrientations::None),
 	m_dpi(-1.0f),
 	m_effectiveDpi(-1.0f),
+	m_resourceRegistry(std::make_shared<Advanced_Rendering::ResourceRegistry>()),
 	m_deviceNotify(nullptr)
 {
 	CreateDeviceIndependentResources();
@@ -230,6 +231,8 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 	m_d2dContext->SetTarget(nullptr);
 	m_d2dTargetBitmap = nullptr;
 	m_d3dDepthStencilView = nullptr;
+	m_backBufferMemory.Reset();
+	m_depthStencilMemory.Reset();
 	m_d3dContext->Flush1(D3D11_CONTEXT_TYPE_ALL, nullptr);
 
 	UpdateRenderTargetSize();
@@ -407,7 +410,26 @@ void DX::DeviceResources::CreateWindowSizeDependentResources()
 			&m_d3dDepthStencilView
 			)
 		);
-	
+
+	// Account for both swap chain buffers and the depth stencil, sized as the render target.
+	Advanced_Rendering::ResourceDesc memory;
+	memory.kind = Advanced_Rendering::ResourceKind::SwapChain;
+	memory.owner = "DeviceResources";
+	memory.name = "Back buffers";
+	memory.format = Advanced_Rendering::DdsFormat::B8G8R8A8_UNORM;
+	memory.width = depthStencilDesc.Width;
+	memory.height = depthStencilDesc.Height;
+	memory.arraySize = 2;
+	memory.bytes = Advanced_Rendering::TextureBytes(memory.format, memory.width, memory.height, 1, 1, 2);
+	m_backBufferMemory = m_resourceRegistry->Track(memory);
+
+	memory.kind = Advanced_Rendering::ResourceKind::DepthStencil;
+	memory.name = "Depth stencil";
+	memory.format = static_cast<Advanced_Rendering::DdsFormat>(depthStencilDesc.Format);
+	memory.arraySize = 1;
+	memory.bytes = Advanced_Rendering::TextureBytes(memory.format, memory.width, memory.height, 1, 1, 1);
+	m_depthStencilMemory = m_resourceRegistry->Track(memory);
+
 	// Set the 3D rendering viewport to target the entire window.
 	m_screenViewport = CD3D11_VIEWPORT(
 		0.0f,
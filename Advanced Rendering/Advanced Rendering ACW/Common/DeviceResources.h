@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include "..\ResourceRegistry.h"
+
 namespace DX
 {
 	// Provides an interface for an application that owns DeviceResources to be notified of the device being lost or created.
@@ -50,6 +52,9 @@ namespace DX
 		IWICImagingFactory2*		GetWicImagingFactory() const			{ return m_wicFactory.Get(); }
 		D2D1::Matrix3x2F			GetOrientationTransform2D() const		{ return m_orientationTransform2D; }
 
+		// Every buffer and texture the app creates, with the swap chain and depth stencil below
+		std::shared_ptr<Advanced_Rendering::ResourceRegistry> GetResourceRegistry() const	{ return m_resourceRegistry; }
+
 	private:
 		void CreateDeviceIndependentResources();
 		void CreateDeviceResources();
@@ -66,6 +71,8 @@ namespace DX
 		Microsoft::WRL::ComPtr<ID3D11RenderTargetView1>	m_d3dRenderTargetView;
 		Microsoft::WRL::ComPtr<ID3D11DepthStencilView>	m_d3dDepthStencilView;
 		D3D11_VIEWPORT									m_screenViewport;
+		Advanced_Rendering::ResourceHandle				m_backBufferMemory;
+		Advanced_Rendering::ResourceHandle				m_depthStencilMemory;
 
 		// Direct2D drawing components.
 		Microsoft::WRL::ComPtr<ID2D1Factory3>		m_d2dFactory;
@@ -96,6 +103,8 @@ namespace DX
 		D2D1::Matrix3x2F	m_orientationTransform2D;
 		DirectX::XMFLOAT4X4	m_orientationTransform3D;
 
+		std::shared_ptr<Advanced_Rendering::ResourceRegistry> m_resourceRegistry;
+
 		// The IDeviceNotify can be held directly as it owns the DeviceResources.
 		IDeviceNotify* m_deviceNotify;
 	};
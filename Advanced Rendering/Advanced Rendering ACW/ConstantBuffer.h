@@ -1,11 +1,13 @@
 #pragma once
 
+#include <typeinfo>
 #include "..\Common\DeviceResources.h"
 
 template <class T>
 class ConstantBuffer
 {
 	Microsoft::WRL::ComPtr<ID3D11Buffer> mConstantBuffer;
+	Advanced_Rendering::ResourceHandle mMemory;
 	
 public:
 	ConstantBuffer();
@@ -44,12 +46,22 @@ void ConstantBuffer<T>::Load(std::shared_ptr<DX::DeviceResources> pDeviceResourc
 			&mConstantBuffer
 		)
 	);
+
+	//Named by its structure, which is all that tells the app's constant buffers apart
+	Advanced_Rendering::ResourceDesc memory;
+	memory.kind = Advanced_Rendering::ResourceKind::ConstantBuffer;
+	memory.owner = "ConstantBuffer";
+	memory.name = typeid(T).name();
+	memory.width = constantBufferDesc.ByteWidth;
+	memory.bytes = constantBufferDesc.ByteWidth;
+	mMemory = pDeviceResources->GetResourceRegistry()->Track(memory);
 }
 
 template<class T>
 void ConstantBuffer<T>::Reset()
 {
 	mConstantBuffer.Reset();
+	mMemory.Reset();
 }
 
 template<class T>
@@ -1,6 +1,3 @@
-#define SOBJECTS 3
-#define TOBJECTS 4
-#define QOBJECTS 6
 #define EPSILON 0.005f
 
 // A constant buffer that stores the three basic column-major matrices for composing geometry.
@@ -30,6 +27,22 @@ cbuffer LightConstantBuffer : register(b2)
     float4 lightPos;
 }
 
+// Ints like the object indices they are compared with, hitobj is -1 for a miss
+cbuffer SceneConstantBuffer : register(b3)
+{
+    int sphereCount;
+    int triangleCount;
+    int quadCount;
+    int objectCount;
+};
+
+// The scene loaded from raytracing.scene, each buffer one float4 stream after another as
+// MakeRayGpuScene lays them out
+StructuredBuffer<float4> sphereBuffer : register(t0);       // centre, radius
+StructuredBuffer<float4> triangleBuffer : register(t1);     // a | b | c
+StructuredBuffer<float4> quadBuffer : register(t2);         // centre, size.x | normal, size.y | tangent | biTangent
+StructuredBuffer<float4> materialBuffer : register(t3);     // color | Kd, ks, kr, shininess, by object
+
 // Per-pixel color data passed through the pixel shader.
 struct PixelShaderInput
 {
@@ -85,101 +98,9 @@ struct Quad
     float Kd, ks, kr, shininess;
 };
 
-static float4 sphereColor_1 = float4(1.0f, 0.0f, 0.0f, 1.0f);
-static float4 sphereColor_2 = float4(0.0f, 1.0f, 0.0f, 1.0f);
-static float4 sphereColor_3 = float4(0.0f, 0.0f, 1.0f, 1.0f);
-static float shininess = 40.0f;
-
-static Sphere sphereObjects[SOBJECTS] =
-{
-    { 0.0f, 5.0f, 0.0f, 1.0f, sphereColor_1, 0.3f, 0.5f, 0.4f, shininess },
-    { 2.0f, 5.0f, -2.0f, 0.5f, sphereColor_2, 0.5f, 0.7f, 0.3f, shininess },
-    { -2.0f, 5.0f, 2.0f, 0.25f, sphereColor_3, 0.5f, 0.3f, 0.2f, shininess }
-};
-
-static Triangle triangleObjects[TOBJECTS] =
-{
-    {
-       -1.0f, -1.0f, -1.0f,
-       1.0f, -1.0f, -1.0f,
-       0.0f, 1.0f, 0.0f,
-       1.0f, 1.0f, 0.0f, 1.0f, 0.5f, 0.3f, 0.1f, shininess
-    },
-    {
-        -1.0f, -1.0f, 1.0f,
-       1.0f, -1.0f, 1.0f,
-       0.0f, 1.0f, 0.0f,
-       1.0f, 1.0f, 0.0f, 1.0f, 0.5f, 0.3f, 0.1f, shininess
-    },
-    {
-       -1.0f, -1.0f, -1.0f,
-       -1.0f, -1.0f, 1.0f,
-       0.0f, 1.0f, 0.0f,
-       1.0f, 1.0f, 0.0f, 1.0f, 0.5f, 0.3f, 0.1f, shininess
-    },
-
-    {
-        1.0f, -1.0f, -1.0f,
-        1.0f, -1.0f, 1.0f,
-        0.0f, 1.0f, 0.0f,
-        1.0f, 1.0f, 0.0f, 1.0f, 0.5f, 0.3f, 0.1f,
-        shininess
-
-    }
-};
-
-static Quad quadObjects[QOBJECTS] =
-{
-    {
-        0.0f, 3.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f,
-        1.0f, 1.0f,
-        1.0f, 1.0f, 1.0f, 1.0f, 0.5f, 0.3f, 0.1f, shininess
-    },
-    {
-        0.0f, 1.0f, 0.0f,
-        0.0f, -1.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        0.0f, 0.0f, 1.0f,
-        1.0f, 1.0f,
-        1.0f, 1.0f, 1.0f, 1.0f, 0.5f, 0.3f, 0.1f, shininess
-    },
-    {
-        0.0f, 2.0f, 1.0f,
-        0.0f, 0.0f, 1.0f,
-        1.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        1.0f, 1.0f,
-        1.0f, 1.0f, 1.0f, 1.0f, 0.5f, 0.3f, 0.1f, shininess
-    },
-    {
-        0.0f, 2.0f, -1.0f,
-        0.0f, 0.0f, -1.0f,
-        1.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        1.0f, 1.0f,
-        1.0f, 1.0f, 1.0f, 1.0f, 0.5f, 0.3f, 0.1f, shininess
-    },
-    {
-        1.0f, 2.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 1.0f,
-        1.0f, 1.0f,
-        1.0f, 1.0f, 1.0f, 1.0f, 0.5f, 0.3f, 0.1f, shininess
-    },
-    {
-        -1.0f, 2.0f, 0.0f,
-        1.0f, 0.0f, 0.0f,
-        0.0f, 1.0f, 0.0f,
-        0.0f, 0.0f, 1.0f,
-        1.0f, 1.0f,
-        1.0f, 1.0f, 1.0f, 1.0f, 0.5f, 0.3f, 0.1f, shininess
-    }
-};
-
+Sphere LoadSphere(int index);
+Triangle LoadTriangle(int index);
+Quad LoadQuad(int index);
 float SphereIntersect(Sphere s, Ray ray, out bool hit);
 float QuadIntersect(Quad q, Ray ray, out bool hit);
 float TriangleIntersect(Triangle t, Ray ray, out bool hit);
@@ -220,6 +141,63 @@ PixelShaderOutput main(PixelShaderInput input) : SV_TARGET
     return RayTracing(eyeray);
 }
 
+Sphere LoadSphere(int index)
+{
+    float4 centre = sphereBuffer[index];
+    float4 shading = materialBuffer[objectCount + index];
+    
+    Sphere s;
+    s.centre = centre.xyz;
+    s.rad2 = centre.w;
+    s.color = materialBuffer[index];
+    s.Kd = shading.x;
+    s.ks = shading.y;
+    s.kr = shading.z;
+    s.shininess = shading.w;
+    
+    return s;
+}
+
+Triangle LoadTriangle(int index)
+{
+    int object = sphereCount + index;
+    float4 shading = materialBuffer[objectCount + object];
+    
+    Triangle tri;
+    tri.pointA = triangleBuffer[index].xyz;
+    tri.pointB = triangleBuffer[triangleCount + index].xyz;
+    tri.pointC = triangleBuffer[triangleCount * 2 + index].xyz;
+    tri.color = materialBuffer[object];
+    tri.Kd = shading.x;
+    tri.ks = shading.y;
+    tri.kr = shading.z;
+    tri.shininess = shading.w;
+    
+    return tri;
+}
+
+Quad LoadQuad(int index)
+{
+    int object = sphereCount + triangleCount + index;
+    float4 centre = quadBuffer[index];
+    float4 normal = quadBuffer[quadCount + index];
+    float4 shading = materialBuffer[objectCount + object];
+    
+    Quad q;
+    q.centre = centre.xyz;
+    q.normal = normal.xyz;
+    q.tangent = quadBuffer[quadCount * 2 + index].xyz;
+    q.biTangent = quadBuffer[quadCount * 3 + index].xyz;
+    q.size = float2(centre.w, normal.w);
+    q.color = materialBuffer[object];
+    q.Kd = shading.x;
+    q.ks = shading.y;
+    q.kr = shading.z;
+    q.shininess = shading.w;
+    
+    return q;
+}
+
 float SphereIntersect(Sphere s, Ray ray, out bool hit)
 {
     float t;
@@ -364,34 +342,37 @@ PixelShaderOutput RayTracing(Ray ray)
             output.position = pos;
         }
         
-        if (hit && hitobj < SOBJECTS)
+        if (hit && hitobj < sphereCount)
         {
-            n = SphereNormal(sphereObjects[hitobj], i);
+            Sphere s = LoadSphere(hitobj);
+            n = SphereNormal(s, i);
             c += SphereShade(i, n, ray.d, hitobj, lightIntensity);
             
-            lightIntensity *= sphereObjects[hitobj].kr;
+            lightIntensity *= s.kr;
             ray.o = i;
             ray.d = reflect(ray.d, n);
             i = NearestHit(ray, hitobj, hit);
         }
-        else if (hit && hitobj < SOBJECTS + TOBJECTS)
+        else if (hit && hitobj < sphereCount + triangleCount)
         {
-            int object = hitobj - SOBJECTS;
-            n = TriangleNormal(triangleObjects[object]);
+            int object = hitobj - sphereCount;
+            Triangle tri = LoadTriangle(object);
+            n = TriangleNormal(tri);
             c += TriangleShade(i, n, ray.d, object, lightIntensity);
             
-            lightIntensity *= triangleObjects[object].kr;
+            lightIntensity *= tri.kr;
             ray.o = i;
             ray.d = reflect(ray.d, n);
             i = NearestHit(ray, hitobj, hit);
         }
-        else if (hit && hitobj < SOBJECTS + TOBJECTS + QOBJECTS)
+        else if (hit && hitobj < sphereCount + triangleCount + quadCount)
         {
-            int object = hitobj - SOBJECTS - TOBJECTS;
-            n = quadObjects[object].normal;
+            int object = hitobj - sphereCount - triangleCount;
+            Quad q = LoadQuad(object);
+            n = q.normal;
             c += QuadShade(i, n, ray.d, object, lightIntensity);
             
-            lightIntensity *= quadObjects[object].kr;
+            lightIntensity *= q.kr;
             ray.o = i;
             ray.d = reflect(ray.d, n);
             i = NearestHit(ray, hitobj, hit);
@@ -421,10 +402,10 @@ float3 NearestHit(Ray ray, out int hitobj, out bool anyhit)
     float mint = farPlane;
     hitobj = -1;
     anyhit = false;
-    for (int i = 0; i < SOBJECTS; i++)
+    for (int i = 0; i < sphereCount; i++)
     {
         bool hit = false;
-        float t = SphereIntersect(sphereObjects[i], ray, hit);
+        float t = SphereIntersect(LoadSphere(i), ray, hit);
         if (hit)
         {
             if (t < mint)
@@ -436,12 +417,12 @@ float3 NearestHit(Ray ray, out int hitobj, out bool anyhit)
         }
     }
     
-    int newHit = SOBJECTS;
+    int newHit = sphereCount;
     
-    for (i = 0; i < TOBJECTS; i++)
+    for (i = 0; i < triangleCount; i++)
     {
         bool hit = false;
-        float t = TriangleIntersect(triangleObjects[i], ray, hit);
+        float t = TriangleIntersect(LoadTriangle(i), ray, hit);
         if (hit)
         {
             if (t < mint)
@@ -453,12 +434,12 @@ float3 NearestHit(Ray ray, out int hitobj, out bool anyhit)
         }
     }
     
-    newHit = SOBJECTS + TOBJECTS;
+    newHit = sphereCount + triangleCount;
     
-    for (i = 0; i < QOBJECTS; i++)
+    for (i = 0; i < quadCount; i++)
     {
         bool hit = false;
-        float t = QuadIntersect(quadObjects[i], ray, hit);
+        float t = QuadIntersect(LoadQuad(i), ray, hit);
         if (hit)
         {
             if (t < mint)
@@ -486,23 +467,27 @@ float4 SphereShade(float3 hitPos, float3 normal, float3 viewDir, int hitobj, flo
 {
     float3 lightDir = normalize(lightPos.xyz - hitPos);
     
-    float4 diff = sphereObjects[hitobj].color * sphereObjects[hitobj].Kd;
-    float4 spec = sphereObjects[hitobj].color * sphereObjects[hitobj].ks;
-    float4 amb = sphereObjects[hitobj].color * 0.1f;
+    Sphere s = LoadSphere(hitobj);
+    
+    float4 diff = s.color * s.Kd;
+    float4 spec = s.color * s.ks;
+    float4 amb = s.color * 0.1f;
     
     float shadow = 1.0f - Shadow(hitPos, lightPos.xyz);
     
-    return lightColor * lightIntensity * ((shadow * Phong(normal, lightDir, viewDir, sphereObjects[hitobj].shininess, diff, spec)) + amb);
+    return lightColor * lightIntensity * ((shadow * Phong(normal, lightDir, viewDir, s.shininess, diff, spec)) + amb);
 }
 
 float4 QuadShade(float3 hitPos, float3 normal, float3 viewDir, int hitobj, float lightIntensity)
 {
     float3 lightDir = normalize(lightPos.xyz - hitPos);
     
-    float4 color = quadObjects[hitobj].color;
+    Quad q = LoadQuad(hitobj);
+    
+    float4 color = q.color;
             
-    float tanSize = dot(hitPos - quadObjects[hitobj].centre, quadObjects[hitobj].tangent);
-    float biSize = dot(hitPos - quadObjects[hitobj].centre, quadObjects[hitobj].biTangent);
+    float tanSize = dot(hitPos - q.centre, q.tangent);
+    float biSize = dot(hitPos - q.centre, q.biTangent);
     
     float tempTanSize = tanSize * 5.0f;
     float tempBiSize = biSize * 5.0f;
@@ -512,19 +497,19 @@ float4 QuadShade(float3 hitPos, float3 normal, float3 viewDir, int hitobj, float
         color.xyz *= 0.1f;
     }
     
-    if (abs(tanSize) / quadObjects[hitobj].size.x > 0.8f
-        || abs(biSize) / quadObjects[hitobj].size.y > 0.8f)
+    if (abs(tanSize) / q.size.x > 0.8f
+        || abs(biSize) / q.size.y > 0.8f)
     {
         color = float4(0.59f, 0.29f, 0.0f, 1.0f);
     }
     
-    float4 diff = color * quadObjects[hitobj].Kd;
-    float4 spec = color * quadObjects[hitobj].ks;
+    float4 diff = color * q.Kd;
+    float4 spec = color * q.ks;
     float4 amb = color * 0.3f;
     
     float shadow = 1.0f - Shadow(hitPos, lightPos.xyz);
     
-    return lightColor * lightIntensity * ((shadow * Phong(normal, lightDir, viewDir, quadObjects[hitobj].shininess, diff, spec)) + amb);
+    return lightColor * lightIntensity * ((shadow * Phong(normal, lightDir, viewDir, q.shininess, diff, spec)) + amb);
 }
 
 
@@ -532,15 +517,17 @@ float4 TriangleShade(float3 hitPos, float3 normal, float3 viewDir, int hitobj, f
 {
     float3 lightDir = normalize(lightPos.xyz - hitPos);
     
-    float4 color = triangleObjects[hitobj].color;
+    Triangle tri = LoadTriangle(hitobj);
+    
+    float4 color = tri.color;
     
-    float4 diff = color * triangleObjects[hitobj].Kd;
-    float4 spec = color * triangleObjects[hitobj].ks;
+    float4 diff = color * tri.Kd;
+    float4 spec = color * tri.ks;
     float4 amb = color * 0.1f;
     
     float shadow = 1.0f - Shadow(hitPos, lightPos.xyz);
     
-    return lightColor * lightIntensity * ((shadow * Phong(normal, lightDir, viewDir, triangleObjects[hitobj].shininess, diff, spec)) + amb);
+    return lightColor * lightIntensity * ((shadow * Phong(normal, lightDir, viewDir, tri.shininess, diff, spec)) + amb);
 }
 
 float Shadow(float3 hitPos, float3 lightPos)
@@ -551,10 +538,10 @@ float Shadow(float3 hitPos, float3 lightPos)
     
     float anyHit = 0.0f;
     
-    for (int i = 0; i < SOBJECTS; i++)
+    for (int i = 0; i < sphereCount; i++)
     {
         bool hit;
-        float t = SphereIntersect(sphereObjects[i], ray, hit);
+        float t = SphereIntersect(LoadSphere(i), ray, hit);
         
         if (hit && t < length(hitPos - lightPos))
         {
@@ -562,10 +549,10 @@ float Shadow(float3 hitPos, float3 lightPos)
         }
     }
     
-    for (i = 0; i < TOBJECTS; i++)
+    for (i = 0; i < triangleCount; i++)
     {
         bool hit;
-        float t = TriangleIntersect(triangleObjects[i], ray, hit);
+        float t = TriangleIntersect(LoadTriangle(i), ray, hit);
         
         if (hit && t < length(hitPos - lightPos))
         {
@@ -573,10 +560,10 @@ float Shadow(float3 hitPos, float3 lightPos)
         }
     }
     
-    for (i = 0; i < QOBJECTS; i++)
+    for (i = 0; i < quadCount; i++)
     {
         bool hit;
-        float t = QuadIntersect(quadObjects[i], ray, hit);
+        float t = QuadIntersect(LoadQuad(i), ray, hit);
         
         if (hit && t < length(hitPos - lightPos))
         {
@@ -3,12 +3,30 @@
 
 #include "..\Common\DirectXHelper.h"
 #include "Main.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <codecvt>
+#include <fstream>
 
 using namespace Advanced_Rendering;
 
 using namespace DirectX;
 using namespace Windows::Foundation;
 
+namespace
+{
+	// Without a region the whole of the first layer is sampled, as for a texture of its own
+	PackRegionConstantBuffer RegionConstants(const PackRegion * const pRegion)
+	{
+		PackRegionConstantBuffer constants = {};
+		constants.rect = pRegion ? XMFLOAT4(pRegion->rect[0], pRegion->rect[1], pRegion->rect[2], pRegion->rect[3]) : XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f);
+		constants.layer = pRegion ? static_cast<float>(pRegion->layer) : 0.0f;
+
+		return constants;
+	}
+}
+
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
 Sample3DSceneRenderer::Sample3DSceneRenderer(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
 	m_loadingComplete(false),
@@ -70,6 +88,15 @@ void Sample3DSceneRenderer::CreateWindowSizeDependentResources()
 
 	mCamera = std::make_unique<Camera>(eye, up, at);
 
+	//The framebuffers match the output, so they are made again at the new size
+	mRayTracingFramebuffer->LoadFramebuffer(m_deviceResources);
+	mRayMarchingFramebuffer->LoadFramebuffer(m_deviceResources);
+	mGeometryFramebuffer->LoadFramebuffer(m_deviceResources);
+	mPingPongFramebuffer1->LoadFramebuffer(m_deviceResources);
+	mPingPongFramebuffer2->LoadFramebuffer(m_deviceResources);
+
+	WriteMemoryReport();
+
 	//XMStoreFloat4x4(&m_constantBufferData.view, XMMatrixTranspose(XMMatrixLookAtRH(eye, at, up)));
 }
 
@@ -104,6 +131,112 @@ void Sample3DSceneRenderer::Rotate(float radians)
 	XMStoreFloat4x4(&m_constantBufferData.model, XMMatrixTranspose(XMMatrixRotationY(radians)));
 }
 
+// Picks the level for a mesh drawn with pModel, a uniform scale
+MeshHandle Sample3DSceneRenderer::SelectLod(const LodChain & pLods, FXMMATRIX pModel) const
+{
+	const auto center = XMVector3Transform(XMLoadFloat3(&pLods.center), pModel);
+	const auto scale = XMVectorGetX(XMVector3Length(pModel.r[0]));
+
+	XMFLOAT3 eye;
+	mCamera->getViewPosition(eye);
+
+	//Clamped to the near plane
+	const auto distance = std::max(XMVectorGetX(XMVector3Length(XMVectorSubtract(center, XMLoadFloat3(&eye)))), 0.01f);
+	const auto pixelsPerUnit = m_rayConstantBufferData.height / (2.0f * tanf(m_rayConstantBufferData.fov * 0.5f)) * scale / distance;
+
+	return pLods.Select(pixelsPerUnit);
+}
+
+// The sculpture geometry shader draws ten copies at a fifth of the size and ignores the model
+// matrix, the nearest copy decides the level for all of them
+MeshHandle Sample3DSceneRenderer::SelectSculptureLod() const
+{
+	//As in SculptureGeometryShader.hlsl
+	static const XMFLOAT3 positions[] =
+	{
+		XMFLOAT3(7.5f, 10.0f, 5.0f), XMFLOAT3(7.5f, 10.0f, 15.0f), XMFLOAT3(7.5f, 10.0f, 25.0f), XMFLOAT3(7.5f, 10.0f, 35.0f), XMFLOAT3(7.5f, 10.0f, 45.0f),
+		XMFLOAT3(-7.5f, 10.0f, 5.0f), XMFLOAT3(-7.5f, 10.0f, 15.0f), XMFLOAT3(-7.5f, 10.0f, 25.0f), XMFLOAT3(-7.5f, 10.0f, 35.0f), XMFLOAT3(-7.5f, 10.0f, 45.0f)
+	};
+
+	XMFLOAT3 eye;
+	mCamera->getViewPosition(eye);
+
+	auto nearest = XMLoadFloat3(&positions[0]);
+
+	for (const auto & position : positions)
+	{
+		if (XMVector3Less(XMVector3LengthSq(XMLoadFloat3(&position) - XMLoadFloat3(&eye)), XMVector3LengthSq(nearest - XMLoadFloat3(&eye))))
+		{
+			nearest = XMLoadFloat3(&position);
+		}
+	}
+
+	return SelectLod(mSculptureLods, XMMatrixScaling(0.2f, 0.2f, 0.2f) * XMMatrixTranslationFromVector(nearest));
+}
+
+// Draws with meshlet culling against the camera, in the space of the model matrix currently in the
+// constant buffer data. pDisplacement is how far the domain shader may move the surface, in world units.
+void Sample3DSceneRenderer::DrawCulled(const MeshHandle pMesh, const float pDisplacement) const
+{
+	if (!Main::culling)
+	{
+		mGeometryPool->UseMesh(m_deviceResources, pMesh);
+		return;
+	}
+
+	const auto model = XMMatrixTranspose(XMLoadFloat4x4(&m_constantBufferData.model));
+	const auto view = XMMatrixTranspose(XMLoadFloat4x4(&m_constantBufferData.view));
+	const auto projection = XMMatrixTranspose(XMLoadFloat4x4(&m_constantBufferData.projection));
+
+	XMFLOAT4X4 modelViewProjection;
+	XMStoreFloat4x4(&modelViewProjection, model * view * projection);
+
+	XMFLOAT3 eye;
+	mCamera->getViewPosition(eye);
+	XMStoreFloat3(&eye, XMVector3Transform(XMLoadFloat3(&eye), XMMatrixInverse(nullptr, model)));
+
+	const auto scale = XMVectorGetX(XMVector3Length(model.r[0]));
+
+	MeshletCullView cullView;
+	MakeMeshletCullView(&modelViewProjection.m[0][0], &eye.x, pDisplacement / scale, cullView);
+
+	mGeometryPool->UseMesh(m_deviceResources, pMesh, cullView);
+}
+
+// Binds the pass's own texture when there is no pack, and points the pixel shader at its region
+void Sample3DSceneRenderer::UseBillboardTexture(const BillboardTexture & pBillboard) const
+{
+	if (pBillboard.texture)
+	{
+		pBillboard.texture->UseTexture(m_deviceResources, 0);
+	}
+
+	mPackRegionConstantBuffer->UpdateBuffer(m_deviceResources, pBillboard.region);
+}
+
+void Sample3DSceneRenderer::ReleaseBillboardTexture(const BillboardTexture & pBillboard) const
+{
+	if (pBillboard.texture)
+	{
+		pBillboard.texture->ReleaseTexture(m_deviceResources, 0);
+	}
+}
+
+// Writes every tracked resource to Memory.json in the local folder, and the totals to the debugger's output
+void Sample3DSceneRenderer::WriteMemoryReport() const
+{
+	const auto registry = m_deviceResources->GetResourceRegistry();
+
+	std::ofstream file(mMemoryReportFile, std::ios::trunc);
+	file << registry->ExportJson();
+
+	char message[160];
+	sprintf_s(message, "GPU memory %.1f MB (peak %.1f MB), CPU memory %.1f MB (peak %.1f MB)\n",
+		registry->CurrentBytes(ResourceHeap::Gpu) / 1048576.0, registry->PeakBytes(ResourceHeap::Gpu) / 1048576.0,
+		registry->CurrentBytes(ResourceHeap::Cpu) / 1048576.0, registry->PeakBytes(ResourceHeap::Cpu) / 1048576.0);
+	OutputDebugStringA(message);
+}
+
 void Sample3DSceneRenderer::StartTracking()
 {
 	m_tracking = true;
@@ -130,7 +263,24 @@ void Sample3DSceneRenderer::Render()
 	// Loading is asynchronous. Only draw geometry after it's loaded.
 	if (!m_loadingComplete)
 	{
-		return;
+		mLoader->RunRenderJobs();
+		Main::loadingProgress = mLoader->Progress();
+
+		if (!mLoader->IsComplete())
+		{
+			return;
+		}
+
+		m_loadingComplete = true;
+		Main::loadingMilliseconds = mLoader->Milliseconds();
+
+		char message[192];
+		sprintf_s(message, "Assets loaded in %.1f ms, %.1f ms of work over %u jobs, longest job %.1f ms, cooked cache %u hits %u misses\n",
+			mLoader->Milliseconds(), mLoader->WorkMilliseconds(), mLoader->Total(), mLoader->LongestJobMilliseconds(),
+			mAssetCache->Hits(), mAssetCache->Misses());
+		OutputDebugStringA(message);
+
+		WriteMemoryReport();
 	}
 
 	const auto context = m_deviceResources->GetD3DDeviceContext();
@@ -172,9 +322,11 @@ void Sample3DSceneRenderer::Render()
 
 		mRayVertexShader->UseProgram(m_deviceResources);
 		mRayTracingFragmentShader->UseProgram(m_deviceResources);
+		mRayScene->UseScene(m_deviceResources, 3);
 
-		mModel->UseModel(m_deviceResources);
+		mGeometryPool->UseMesh(m_deviceResources, mModel);
 
+		mRayScene->ReleaseScene(m_deviceResources);
 		mRayTracingFramebuffer->ReleaseFramebuffer(m_deviceResources);
 	}
 
@@ -185,7 +337,7 @@ void Sample3DSceneRenderer::Render()
 		mRayVertexShader->UseProgram(m_deviceResources);
 		mRayMarchingFragmentShader->UseProgram(m_deviceResources);
 
-		mModel->UseModel(m_deviceResources);
+		mGeometryPool->UseMesh(m_deviceResources, mModel);
 
 		mRayTracingFramebuffer->ReleaseFramebuffer(m_deviceResources);
 	}
@@ -272,6 +424,8 @@ void Sample3DSceneRenderer::Render()
 		mRockColorTexture->UseTexture(m_deviceResources, 0);
 		mRockNormalTexture->UseTexture(m_deviceResources, 1);
 
+		const auto quantized = Main::quantized && mRockQuantized;
+
 		//Rock1
 		{
 			DirectX::XMStoreFloat4x4(&m_constantBufferData.model, DirectX::XMMatrixTranspose(DirectX::XMMatrixMultiply(DirectX::XMMatrixScaling(0.01f, 0.01f, 0.01f), DirectX::XMMatrixTranslation(30.0f, 0.0f, 40.0f))));
@@ -284,12 +438,21 @@ void Sample3DSceneRenderer::Render()
 			mConstantBuffer->UseHSBuffer(m_deviceResources, 0);
 			mConstantBuffer->UsePSBuffer(m_deviceResources, 0);
 
-			mRockVertexShader->UseProgram(m_deviceResources);
+			if (quantized)
+			{
+				mQuantizationConstantBuffer->UseVSBuffer(m_deviceResources, 3);
+				mRockQuantizedVertexShader->UseProgram(m_deviceResources);
+			}
+			else
+			{
+				mRockVertexShader->UseProgram(m_deviceResources);
+			}
+
 			mRockViewHullShader->UseProgram(m_deviceResources);
 			mRockDomainShader->UseProgram(m_deviceResources);
 			mRockFragmentShader->UseProgram(m_deviceResources);
 
-			mTessModel->UseModel(m_deviceResources);
+			DrawCulled(SelectLod(quantized ? mQuantizedTessLods : mTessLods, XMMatrixTranspose(XMLoadFloat4x4(&m_constantBufferData.model))), Main::height);
 		}
 
 		//Rock2
@@ -304,12 +467,21 @@ void Sample3DSceneRenderer::Render()
 			mConstantBuffer->UseHSBuffer(m_deviceResources, 0);
 			mConstantBuffer->UsePSBuffer(m_deviceResources, 0);
 
-			mRockVertexShader->UseProgram(m_deviceResources);
+			if (quantized)
+			{
+				mQuantizationConstantBuffer->UseVSBuffer(m_deviceResources, 3);
+				mRockQuantizedVertexShader->UseProgram(m_deviceResources);
+			}
+			else
+			{
+				mRockVertexShader->UseProgram(m_deviceResources);
+			}
+
 			mRockUserHullShader->UseProgram(m_deviceResources);
 			mRockDomainShader->UseProgram(m_deviceResources);
 			mRockFragmentShader->UseProgram(m_deviceResources);
 
-			mTessModel->UseModel(m_deviceResources);
+			DrawCulled(SelectLod(quantized ? mQuantizedTessLods : mTessLods, XMMatrixTranspose(XMLoadFloat4x4(&m_constantBufferData.model))), Main::height);
 		}
 
 		mRockDisplacementTexture->ReleaseDomainTexture(m_deviceResources, 0);
@@ -335,7 +507,7 @@ void Sample3DSceneRenderer::Render()
 
 			mMarbleTexture->UseTexture(m_deviceResources, 0);
 
-			mSplineModel->UseModel(m_deviceResources);
+			mGeometryPool->UseMesh(m_deviceResources, mSplineModel);
 
 			mMarbleTexture->ReleaseTexture(m_deviceResources, 0);
 		}
@@ -347,17 +519,24 @@ void Sample3DSceneRenderer::Render()
 		mParametricSphereDomainShader->ReleaseProgram(m_deviceResources);
 		mParametricFragmentShader->ReleaseProgram(m_deviceResources);
 
+		//The billboard passes below share one packed texture when there is one, each pass picking out its region
+		if (mBillboardTexture)
+		{
+			mBillboardTexture->UseTexture(m_deviceResources, 0);
+		}
+
+		mPackRegionConstantBuffer->UsePSBuffer(m_deviceResources, 4);
+
 		//Billboard Soldiers
 		{
 			mBillboardVertexShader->UseProgram(m_deviceResources);
 			mBillboardGeometryShader->UseProgram(m_deviceResources);
 			mBillboardFragmentShader->UseProgram(m_deviceResources);
 
-			mSoldierTexture->UseTexture(m_deviceResources, 0);
-
-			mPointModel->UseModel(m_deviceResources);
+			UseBillboardTexture(mSoldierBillboard);
 
-			mSoldierTexture->ReleaseTexture(m_deviceResources, 0);
+			mGeometryPool->UseMesh(m_deviceResources, mPointModel);
+			ReleaseBillboardTexture(mSoldierBillboard);
 
 			mBillboardVertexShader->ReleaseProgram(m_deviceResources);
 			mBillboardGeometryShader->ReleaseProgram(m_deviceResources);
@@ -370,11 +549,10 @@ void Sample3DSceneRenderer::Render()
 			mFlagGeometryShader->UseProgram(m_deviceResources);
 			mBillboardFragmentShader->UseProgram(m_deviceResources);
 
-			mFlagTexture->UseTexture(m_deviceResources, 0);
+			UseBillboardTexture(mFlagBillboard);
 
-			mFlagModel->UseModel(m_deviceResources);
-
-			mFlagTexture->ReleaseTexture(m_deviceResources, 0);
+			mGeometryPool->UseMesh(m_deviceResources, mFlagModel);
+			ReleaseBillboardTexture(mFlagBillboard);
 
 			mBillboardVertexShader->ReleaseProgram(m_deviceResources);
 			mFlagGeometryShader->ReleaseProgram(m_deviceResources);
@@ -387,11 +565,10 @@ void Sample3DSceneRenderer::Render()
 			mCloudGeometryShader->UseProgram(m_deviceResources);
 			mCloudFragmentShader->UseProgram(m_deviceResources);
 
-			mCloudTexture->UseTexture(m_deviceResources, 0);
-
-			mCloudModel->UseModel(m_deviceResources);
+			UseBillboardTexture(mCloudBillboard);
 
-			mCloudTexture->ReleaseTexture(m_deviceResources, 0);
+			mGeometryPool->UseMesh(m_deviceResources, mCloudModel);
+			ReleaseBillboardTexture(mCloudBillboard);
 
 			mCloudVertexShader->ReleaseProgram(m_deviceResources);
 			mCloudGeometryShader->ReleaseProgram(m_deviceResources);
@@ -404,11 +581,10 @@ void Sample3DSceneRenderer::Render()
 			mSculptureGeometryShader->UseProgram(m_deviceResources);
 			mSculptureFragmentShader->UseProgram(m_deviceResources);
 
-			mMarbleTexture->UseTexture(m_deviceResources, 0);
-
-			mSculptureModel->UseModel(m_deviceResources);
+			UseBillboardTexture(mSculptureBillboard);
 
-			mMarbleTexture->ReleaseTexture(m_deviceResources, 0);
+			mGeometryPool->UseMesh(m_deviceResources, SelectSculptureLod());
+			ReleaseBillboardTexture(mSculptureBillboard);
 
 			mSculptureVertexShader->ReleaseProgram(m_deviceResources);
 			mSculptureGeometryShader->ReleaseProgram(m_deviceResources);
@@ -421,17 +597,21 @@ void Sample3DSceneRenderer::Render()
 			mPoleGeometryShader->UseProgram(m_deviceResources);
 			mSculptureFragmentShader->UseProgram(m_deviceResources);
 
-			mMarbleTexture->UseTexture(m_deviceResources, 0);
+			UseBillboardTexture(mSculptureBillboard);
 
-			mPoleModel->UseModel(m_deviceResources);
-
-			mMarbleTexture->ReleaseTexture(m_deviceResources, 0);
+			mGeometryPool->UseMesh(m_deviceResources, mPoleModel);
+			ReleaseBillboardTexture(mSculptureBillboard);
 
 			mSculptureVertexShader->ReleaseProgram(m_deviceResources);
 			mPoleGeometryShader->ReleaseProgram(m_deviceResources);
 			mSculptureFragmentShader->ReleaseProgram(m_deviceResources);
 		}
 
+		if (mBillboardTexture)
+		{
+			mBillboardTexture->ReleaseTexture(m_deviceResources, 0);
+		}
+
 	
 		mGeometryFramebuffer->ReleaseFramebuffer(m_deviceResources);
 	}
@@ -445,7 +625,7 @@ void Sample3DSceneRenderer::Render()
 	mPingPongVertexShader->UseProgram(m_deviceResources);
 	mPingPongFragmentShader->UseProgram(m_deviceResources);
 
-	mModel->UseModel(m_deviceResources);
+	mGeometryPool->UseMesh(m_deviceResources, mModel);
 
 	mRayTracingFramebuffer->ReleaseTexture(m_deviceResources, 0);
 	mRayMarchingFramebuffer->ReleaseTexture(m_deviceResources, 2);
@@ -461,7 +641,7 @@ void Sample3DSceneRenderer::Render()
 	mPingPongVertexShader->UseProgram(m_deviceResources);
 	mPingPongFragmentShader2->UseProgram(m_deviceResources);
 
-	mModel->UseModel(m_deviceResources);
+	mGeometryPool->UseMesh(m_deviceResources, mModel);
 
 	mPingPongFramebuffer1->ReleaseTexture(m_deviceResources, 0);
 	mGeometryFramebuffer->ReleaseTexture(m_deviceResources, 2);
@@ -469,6 +649,12 @@ void Sample3DSceneRenderer::Render()
 
 void Sample3DSceneRenderer::CreateDeviceDependentResources()
 {
+	//Warns in the debugger's output when a resize or load takes the GPU past the budget
+	m_deviceResources->GetResourceRegistry()->SetBudget(static_cast<uint64_t>(Main::memoryBudgetMegabytes) * 1024 * 1024, [](const std::string & pMessage)
+	{
+		OutputDebugStringA(pMessage.c_str());
+	});
+
 	D3D11_RASTERIZER_DESC rasterizerDesc = CD3D11_RASTERIZER_DESC(D3D11_DEFAULT);
 
 	rasterizerDesc.CullMode = D3D11_CULL_BACK;
@@ -483,10 +669,13 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 
 	m_deviceResources->GetD3DDevice()->CreateRasterizerState(&rasterizerDesc, m_wireframeRasterizerState.GetAddressOf());
 
+	//Files are read and parsed on the loader's workers, Render runs the uploads and waits on the fence
+	mLoader = std::make_unique<AssetLoader>();
+
 	std::vector<D3D11_INPUT_ELEMENT_DESC> normalInputLayout =
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 	};
 
 	mRayVertexShader = std::make_unique<VertexShader>(L"RayVertexShader.cso", normalInputLayout);
@@ -496,12 +685,12 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 	mPingPongFragmentShader = std::make_unique<FragmentShader>(L"PingPongPixelShader.cso");
 	mPingPongFragmentShader2 = std::make_unique<FragmentShader>(L"PingPongPixelShader2.cso");
 
-	mRayVertexShader->Load(m_deviceResources);
-	mRayTracingFragmentShader->Load(m_deviceResources);
-	mRayMarchingFragmentShader->Load(m_deviceResources);
-	mPingPongVertexShader->Load(m_deviceResources);
-	mPingPongFragmentShader->Load(m_deviceResources);
-	mPingPongFragmentShader2->Load(m_deviceResources);
+	mRayVertexShader->Load(*mLoader, m_deviceResources);
+	mRayTracingFragmentShader->Load(*mLoader, m_deviceResources);
+	mRayMarchingFragmentShader->Load(*mLoader, m_deviceResources);
+	mPingPongVertexShader->Load(*mLoader, m_deviceResources);
+	mPingPongFragmentShader->Load(*mLoader, m_deviceResources);
+	mPingPongFragmentShader2->Load(*mLoader, m_deviceResources);
 
 	mParametricVertexShader = std::make_unique<VertexShader>(L"ParametricVertexShader.cso", normalInputLayout);
 	mParametricHullShader = std::make_unique<HullShader>(L"ParametricHullShader.cso");
@@ -510,12 +699,12 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 	mParametricTorusDomainShader = std::make_unique<DomainShader>(L"ParametricTorusDomainShader.cso");
 	mParametricFragmentShader = std::make_unique<FragmentShader>(L"ParametricFragmentShader.cso");
 
-	mParametricVertexShader->Load(m_deviceResources);
-	mParametricHullShader->Load(m_deviceResources);
-	mParametricSphereDomainShader->Load(m_deviceResources);
-	mParametricElipsoidDomainShader->Load(m_deviceResources);
-	mParametricTorusDomainShader->Load(m_deviceResources);
-	mParametricFragmentShader->Load(m_deviceResources);
+	mParametricVertexShader->Load(*mLoader, m_deviceResources);
+	mParametricHullShader->Load(*mLoader, m_deviceResources);
+	mParametricSphereDomainShader->Load(*mLoader, m_deviceResources);
+	mParametricElipsoidDomainShader->Load(*mLoader, m_deviceResources);
+	mParametricTorusDomainShader->Load(*mLoader, m_deviceResources);
+	mParametricFragmentShader->Load(*mLoader, m_deviceResources);
 
 	std::vector<D3D11_INPUT_ELEMENT_DESC> tessInputLayout =
 	{
@@ -526,17 +715,28 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 		{ "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 4, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 	};
 
+	std::vector<D3D11_INPUT_ELEMENT_DESC> quantizedTessInputLayout =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 1, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 2, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 3, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "BITANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 4, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+	};
+
 	mRockVertexShader = std::make_unique<VertexShader>(L"RockVertexShader.cso", tessInputLayout);
+	mRockQuantizedVertexShader = std::make_unique<VertexShader>(L"RockQuantizedVertexShader.cso", quantizedTessInputLayout);
 	mRockUserHullShader = std::make_unique<HullShader>(L"RockUserHullShader.cso");
 	mRockViewHullShader = std::make_unique<HullShader>(L"RockViewHullShader.cso");
 	mRockDomainShader = std::make_unique<DomainShader>(L"RockDomainShader.cso");
 	mRockFragmentShader = std::make_unique<FragmentShader>(L"RockPixelShader.cso");
 
-	mRockVertexShader->Load(m_deviceResources);
-	mRockUserHullShader->Load(m_deviceResources);
-	mRockViewHullShader->Load(m_deviceResources);
-	mRockDomainShader->Load(m_deviceResources);
-	mRockFragmentShader->Load(m_deviceResources);
+	mRockVertexShader->Load(*mLoader, m_deviceResources);
+	mRockQuantizedVertexShader->Load(*mLoader, m_deviceResources);
+	mRockUserHullShader->Load(*mLoader, m_deviceResources);
+	mRockViewHullShader->Load(*mLoader, m_deviceResources);
+	mRockDomainShader->Load(*mLoader, m_deviceResources);
+	mRockFragmentShader->Load(*mLoader, m_deviceResources);
 
 	std::vector<D3D11_INPUT_ELEMENT_DESC> splineInputLayout =
 	{
@@ -549,29 +749,29 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 	mSplineDomainShader = std::make_unique<DomainShader>(L"SplineDomainShader.cso");
 	mSplineFragmentShader = std::make_unique<FragmentShader>(L"SplinePixelShader.cso");
 
-	mSplineVertexShader->Load(m_deviceResources);
-	mSplineHullShader->Load(m_deviceResources);
-	mSplineDomainShader->Load(m_deviceResources);
-	mSplineFragmentShader->Load(m_deviceResources);
+	mSplineVertexShader->Load(*mLoader, m_deviceResources);
+	mSplineHullShader->Load(*mLoader, m_deviceResources);
+	mSplineDomainShader->Load(*mLoader, m_deviceResources);
+	mSplineFragmentShader->Load(*mLoader, m_deviceResources);
 
 	mBillboardVertexShader = std::make_unique<VertexShader>(L"BillboardVertexShader.cso", normalInputLayout);
 	mBillboardGeometryShader = std::make_unique<GeometryShader>(L"BillboardGeometryShader.cso");
 	mBillboardFragmentShader = std::make_unique<FragmentShader>(L"BillboardPixelShader.cso");
 
-	mBillboardVertexShader->Load(m_deviceResources);
-	mBillboardGeometryShader->Load(m_deviceResources);
-	mBillboardFragmentShader->Load(m_deviceResources);
+	mBillboardVertexShader->Load(*mLoader, m_deviceResources);
+	mBillboardGeometryShader->Load(*mLoader, m_deviceResources);
+	mBillboardFragmentShader->Load(*mLoader, m_deviceResources);
 
 	mFlagGeometryShader = std::make_unique<GeometryShader>(L"FlagGeometryShader.cso");
-	mFlagGeometryShader->Load(m_deviceResources);
+	mFlagGeometryShader->Load(*mLoader, m_deviceResources);
 
 	mCloudVertexShader = std::make_unique<VertexShader>(L"CloudVertexShader.cso", normalInputLayout);
 	mCloudGeometryShader = std::make_unique<GeometryShader>(L"CloudGeometryShader.cso");
 	mCloudFragmentShader = std::make_unique<FragmentShader>(L"CloudFragmentShader.cso");
 
-	mCloudVertexShader->Load(m_deviceResources);
-	mCloudGeometryShader->Load(m_deviceResources);
-	mCloudFragmentShader->Load(m_deviceResources);
+	mCloudVertexShader->Load(*mLoader, m_deviceResources);
+	mCloudGeometryShader->Load(*mLoader, m_deviceResources);
+	mCloudFragmentShader->Load(*mLoader, m_deviceResources);
 
 	std::vector<D3D11_INPUT_ELEMENT_DESC> sculptureInputLayout =
 	{
@@ -585,24 +785,17 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 	mPoleGeometryShader = std::make_unique<GeometryShader>(L"PoleGeometryShader.cso");
 	mSculptureFragmentShader = std::make_unique<FragmentShader>(L"SculpturePixelShader.cso");
 
-	mSculptureVertexShader->Load(m_deviceResources);
-	mSculptureGeometryShader->Load(m_deviceResources);
-	mPoleGeometryShader->Load(m_deviceResources);
-	mSculptureFragmentShader->Load(m_deviceResources);
+	mSculptureVertexShader->Load(*mLoader, m_deviceResources);
+	mSculptureGeometryShader->Load(*mLoader, m_deviceResources);
+	mPoleGeometryShader->Load(*mLoader, m_deviceResources);
+	mSculptureFragmentShader->Load(*mLoader, m_deviceResources);
 
-	mRayTracingFramebuffer = std::make_unique<Framebuffer>();
-	mRayMarchingFramebuffer = std::make_unique<Framebuffer>();
-	mGeometryFramebuffer = std::make_unique<Framebuffer>();
-
-	mRayTracingFramebuffer->LoadFramebuffer(m_deviceResources);
-	mRayMarchingFramebuffer->LoadFramebuffer(m_deviceResources);
-	mGeometryFramebuffer->LoadFramebuffer(m_deviceResources);
-
-	mPingPongFramebuffer1 = std::make_unique<Framebuffer>();
-	mPingPongFramebuffer2 = std::make_unique<Framebuffer>();
-
-	mPingPongFramebuffer1->LoadFramebuffer(m_deviceResources);
-	mPingPongFramebuffer2->LoadFramebuffer(m_deviceResources);
+	//Loaded at the output size by CreateWindowSizeDependentResources
+	mRayTracingFramebuffer = std::make_unique<Framebuffer>("RayTracing");
+	mRayMarchingFramebuffer = std::make_unique<Framebuffer>("RayMarching");
+	mGeometryFramebuffer = std::make_unique<Framebuffer>("Geometry");
+	mPingPongFramebuffer1 = std::make_unique<Framebuffer>("PingPong1");
+	mPingPongFramebuffer2 = std::make_unique<Framebuffer>("PingPong2");
 
 	mConstantBuffer = std::make_unique<ConstantBuffer<ModelViewProjectionConstantBuffer>>();
 	mConstantBuffer->Load(m_deviceResources);
@@ -619,26 +812,103 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 	mTimeConstantBuffer = std::make_unique<ConstantBuffer<TimeConstantBuffer>>();
 	mTimeConstantBuffer->Load(m_deviceResources);
 
-	mRockColorTexture = std::make_unique<Texture>("Texture.DDS");
-	mRockColorTexture->Load(m_deviceResources);
+	mQuantizationConstantBuffer = std::make_unique<ConstantBuffer<QuantizationConstantBuffer>>();
+	mQuantizationConstantBuffer->Load(m_deviceResources);
+
+	mPackRegionConstantBuffer = std::make_unique<ConstantBuffer<PackRegionConstantBuffer>>();
+	mPackRegionConstantBuffer->Load(m_deviceResources);
+
+	//Cooked meshes and textures live in the app's local folder, the install folder is read-only
+	const auto localFolder = std::wstring_convert<std::codecvt_utf8<wchar_t>>().to_bytes(std::wstring(Windows::Storage::ApplicationData::Current->LocalFolder->Path->Data()));
+	mAssetCache = std::make_shared<AssetCache>(localFolder + "\\Cooked");
+	mMemoryReportFile = localFolder + "\\Memory.json";
+
+	//The rock's textures are block compressed on first load, the normal map keeps x and y and the shader rebuilds z
+	TextureCookOptions rockColor, rockDisplacement, rockNormal;
+	rockColor.compression = TextureCompression::Color;
+	rockDisplacement.compression = TextureCompression::Single;
+	rockNormal.compression = TextureCompression::Normal;
+	rockDisplacement.quality = rockNormal.quality = CompressQuality::High;
 
-	mRockDisplacementTexture = std::make_unique<Texture>("Displacement.DDS");
-	mRockDisplacementTexture->Load(m_deviceResources);
+	//Every texture gets a full mip chain, heights and normals are filtered as they are stored rather than as sRGB
+	rockColor.mips = rockDisplacement.mips = rockNormal.mips = true;
+	rockDisplacement.mipOptions.gammaCorrect = rockNormal.mipOptions.gammaCorrect = false;
+	rockNormal.mipOptions.normalMap = true;
 
-	mRockNormalTexture = std::make_unique<Texture>("Normal map.DDS");
-	mRockNormalTexture->Load(m_deviceResources);
+	TextureCookOptions color;
+	color.mips = true;
 
-	mSoldierTexture = std::make_unique<Texture>("Soldier.DDS");
-	mSoldierTexture->Load(m_deviceResources);
+	mRockColorTexture = std::make_unique<Texture>("Texture.DDS", rockColor);
+	mRockColorTexture->Load(*mLoader, m_deviceResources, mAssetCache);
 
-	mMarbleTexture = std::make_unique<Texture>("Marble.DDS");
-	mMarbleTexture->Load(m_deviceResources);
+	mRockDisplacementTexture = std::make_unique<Texture>("Displacement.DDS", rockDisplacement);
+	mRockDisplacementTexture->Load(*mLoader, m_deviceResources, mAssetCache);
 
-	mFlagTexture = std::make_unique<Texture>("Flag.DDS");
-	mFlagTexture->Load(m_deviceResources);
+	mRockNormalTexture = std::make_unique<Texture>("Normal map.DDS", rockNormal);
+	mRockNormalTexture->Load(*mLoader, m_deviceResources, mAssetCache);
 
-	mCloudTexture = std::make_unique<Texture>("Cloud.DDS");
-	mCloudTexture->Load(m_deviceResources);
+	mMarbleTexture = std::make_unique<Texture>("Marble.DDS", color);
+	mMarbleTexture->Load(*mLoader, m_deviceResources, mAssetCache);
+
+	//Soldiers, flags, clouds and the sculpture share one texture array, made with
+	//TextureTool pack array Billboards.DDS soldier=Soldier.DDS flag=Flag.DDS cloud=Cloud.DDS marble=Marble.DDS
+	//The pack is not in the tree, so without its manifest each pass falls back to a texture of its own
+	PackManifest manifest;
+	{
+		MappedFile file;
+
+		if (file.Open("Billboards.pack"))
+		{
+			ReadPackManifest(reinterpret_cast<const char *>(file.Data()), file.Size(), manifest);
+		}
+	}
+
+	const auto soldierRegion = manifest.Find("soldier");
+	const auto flagRegion = manifest.Find("flag");
+	const auto cloudRegion = manifest.Find("cloud");
+	const auto marbleRegion = manifest.Find("marble");
+
+	mBillboardTexture.reset();
+	mSoldierTexture.reset();
+	mFlagTexture.reset();
+	mCloudTexture.reset();
+	mSculptureTexture.reset();
+
+	if (soldierRegion && flagRegion && cloudRegion && marbleRegion)
+	{
+		//An atlas pack is a single layer, so it is viewed as an array like the fallback textures
+		mBillboardTexture = std::make_unique<Texture>("Billboards.DDS", color, true);
+		mBillboardTexture->Load(*mLoader, m_deviceResources, mAssetCache);
+
+		mSoldierBillboard = { nullptr, RegionConstants(soldierRegion) };
+		mFlagBillboard = { nullptr, RegionConstants(flagRegion) };
+		mCloudBillboard = { nullptr, RegionConstants(cloudRegion) };
+		mSculptureBillboard = { nullptr, RegionConstants(marbleRegion) };
+	}
+	else
+	{
+		//The shaders sample a layer of an array, so these are viewed as one layer arrays
+		mSoldierTexture = std::make_unique<Texture>("Soldier.DDS", color, true);
+		mSoldierTexture->Load(*mLoader, m_deviceResources, mAssetCache);
+
+		mFlagTexture = std::make_unique<Texture>("Flag.DDS", color, true);
+		mFlagTexture->Load(*mLoader, m_deviceResources, mAssetCache);
+
+		mCloudTexture = std::make_unique<Texture>("Cloud.DDS", color, true);
+		mCloudTexture->Load(*mLoader, m_deviceResources, mAssetCache);
+
+		mSculptureTexture = std::make_unique<Texture>("Marble.DDS", color, true);
+		mSculptureTexture->Load(*mLoader, m_deviceResources, mAssetCache);
+
+		mSoldierBillboard = { mSoldierTexture.get(), RegionConstants(nullptr) };
+		mFlagBillboard = { mFlagTexture.get(), RegionConstants(nullptr) };
+		mCloudBillboard = { mCloudTexture.get(), RegionConstants(nullptr) };
+		mSculptureBillboard = { mSculptureTexture.get(), RegionConstants(nullptr) };
+	}
+
+	//The ray traced spheres, triangles and quads, read from a file so the scene changes without rebuilding the shader
+	mRayScene = std::make_unique<RaySceneBuffer>("raytracing.scene");
+	mRayScene->Load(*mLoader, m_deviceResources);
 
 	// Load mesh vertices. Each vertex has a position and a color.
 	static const std::vector<VertexPositionColor> cubeVertices = 
@@ -660,8 +930,10 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 		1,3,2
 	};
 
-	mModel = std::make_unique<Model>(cubeVertices, cubeIndices);
-	mModel->Load(m_deviceResources);
+	mGeometryPool = std::make_unique<GeometryPool>();
+	mGeometryPool->SetCache(mAssetCache);
+
+	mModel = mGeometryPool->AddMesh(cubeVertices, cubeIndices, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	std::vector<VertexPositionColor> pointVertices;
 	std::vector<unsigned int> pointIndices;
@@ -678,8 +950,7 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 		}
 	}
 
-	mPointModel = std::make_unique<PointModel>(pointVertices, pointIndices);
-	mPointModel->Load(m_deviceResources);
+	mPointModel = mGeometryPool->AddMesh(pointVertices, pointIndices, D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
 
 	std::vector<VertexPositionColor> flagVertices;
 	std::vector<unsigned int> flagIndices;
@@ -692,8 +963,7 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 		flagIndices.push_back(flagIndices.size());
 	}
 
-	mFlagModel = std::make_unique<PointModel>(flagVertices, flagIndices);
-	mFlagModel->Load(m_deviceResources);
+	mFlagModel = mGeometryPool->AddMesh(flagVertices, flagIndices, D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
 
 	std::vector<VertexPositionColor> cloudVertices;
 	std::vector<unsigned int> cloudIndices;
@@ -707,20 +977,48 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 		}
 	}
 
-	mCloudModel = std::make_unique<PointModel>(cloudVertices, cloudIndices);
-	mCloudModel->Load(m_deviceResources);
+	mCloudModel = mGeometryPool->AddMesh(cloudVertices, cloudIndices, D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
 
-	mTessModel = std::make_unique<TessModel>("rock.sim");
-	mTessModel->Load(m_deviceResources);
+	//Each file is read, parsed and optimised on its own job, the pool takes meshes from any thread
+	const auto rock = mLoader->Add(JobQueue::Worker, [this]()
+	{
+		mTessLods = mGeometryPool->AddSimMeshLods("rock.sim", SimLayout::Tangent, D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST, true);
+	});
 
-	mSculptureModel = std::make_unique<SculptureModel>("Sculpture.sim");
-	mSculptureModel->Load(m_deviceResources);
+	auto quantizedRock = std::make_shared<MeshHandle>();
 
-	mPoleModel = std::make_unique<SculptureModel>("Cylinder.sim");
-	mPoleModel->Load(m_deviceResources);
+	const auto quantize = mLoader->Add(JobQueue::Worker, [this, quantizedRock]()
+	{
+		mRockQuantized = mGeometryPool->AddQuantizedSimMesh("rock.sim", D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST, m_quantizationConstantBufferData, *quantizedRock);
+	});
 
-	mSplineModel = std::make_unique<SplineModel>("vase.cur");
-	mSplineModel->Load(m_deviceResources);
+	//Without the quantised rock the quantised toggle draws the float one
+	const auto share = mLoader->Add(JobQueue::Worker, [this, quantizedRock]()
+	{
+		mQuantizedTessLods = mRockQuantized ? mGeometryPool->ShareLods(*quantizedRock, mTessLods) : mTessLods;
+	}, { rock, quantize });
+
+	const auto sculpture = mLoader->Add(JobQueue::Worker, [this]()
+	{
+		mSculptureLods = mGeometryPool->AddSimMeshLods("Sculpture.sim", SimLayout::Basic, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	});
+
+	const auto pole = mLoader->Add(JobQueue::Worker, [this]()
+	{
+		mPoleModel = mGeometryPool->AddSimMesh("Cylinder.sim", SimLayout::Basic, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	});
+
+	const auto spline = mLoader->Add(JobQueue::Worker, [this]()
+	{
+		mSplineModel = mGeometryPool->AddCurve("vase.cur", D3D11_PRIMITIVE_TOPOLOGY_4_CONTROL_POINT_PATCHLIST);
+	});
+
+	//The uploads use the immediate context, so they wait for the render thread
+	mLoader->Add(JobQueue::Render, [this]()
+	{
+		mGeometryPool->Load(m_deviceResources);
+		mQuantizationConstantBuffer->UpdateBuffer(m_deviceResources, m_quantizationConstantBufferData);
+	}, { share, sculpture, pole, spline });
 
 	D3D11_SAMPLER_DESC samplerDesc;
 	ZeroMemory(&samplerDesc, sizeof samplerDesc);
@@ -732,15 +1030,23 @@ void Sample3DSceneRenderer::CreateDeviceDependentResources()
 
 	m_deviceResources->GetD3DDevice()->CreateSamplerState(&samplerDesc, mSampler.ReleaseAndGetAddressOf());
 
-	// Once the cube is loaded, the object is ready to be rendered.
-	m_loadingComplete = true;
+	// The scene is ready to be rendered once the loader's fence is reached.
+	m_loadingComplete = false;
 }
 
 void Sample3DSceneRenderer::ReleaseDeviceDependentResources()
 {
+	//Jobs still in flight write into the resources about to be released, and the queued uploads
+	//would reach the lost context, so they are dropped rather than run
+	if (mLoader)
+	{
+		mLoader->Cancel();
+	}
+
 	m_loadingComplete = false;
 	mRayVertexShader->Reset();
 	mRayTracingFragmentShader->Reset();
 	mConstantBuffer->Reset();
-	mModel->Reset();
+	mGeometryPool->Reset();
+	mRayScene->Reset();
 }
\ No newline at end of file
@@ -8,19 +8,26 @@
 #include "HullShader.h"
 #include "DomainShader.h"
 #include "FragmentShader.h"
-#include "Model.h"
 #include "ConstantBuffer.h"
 #include "Camera.h"
 #include "Framebuffer.h"
 #include "GeometryShader.h"
-#include "PointModel.h"
-#include "TessModel.h"
 #include "Texture.h"
-#include "SplineModel.h"
-#include "SculptureModel.h"
+#include "TexturePacker.h"
+#include "GeometryPool.h"
+#include "RaySceneBuffer.h"
+#include "AssetLoader.h"
 
 namespace Advanced_Rendering
 {
+	// Where a billboard pass samples from, its region of the shared pack or, without the pack, the
+	// whole of a texture of its own
+	struct BillboardTexture
+	{
+		const Texture * texture = nullptr;	// null when the pack stays bound for every pass
+		PackRegionConstantBuffer region = {};
+	};
+
 	// This sample renderer instantiates a basic rendering pipeline.
 	class Sample3DSceneRenderer
 	{
@@ -41,6 +48,12 @@ namespace Advanced_Rendering
 
 	private:
 		void Rotate(float radians);
+		MeshHandle SelectLod(const LodChain & pLods, DirectX::FXMMATRIX pModel) const;
+		MeshHandle SelectSculptureLod() const;
+		void DrawCulled(MeshHandle pMesh, float pDisplacement) const;
+		void UseBillboardTexture(const BillboardTexture & pBillboard) const;
+		void ReleaseBillboardTexture(const BillboardTexture & pBillboard) const;
+		void WriteMemoryReport() const;
 
 	private:
 		// Cached pointer to device resources.
@@ -60,19 +73,27 @@ namespace Advanced_Rendering
 		std::unique_ptr<Framebuffer> mPingPongFramebuffer1;
 		std::unique_ptr<Framebuffer> mPingPongFramebuffer2;
 
-		std::unique_ptr<Model> mModel;
-		std::unique_ptr<PointModel> mPointModel;
-		std::unique_ptr<PointModel> mFlagModel;
-		std::unique_ptr<PointModel> mCloudModel;
-		std::unique_ptr<TessModel> mTessModel;
-		std::unique_ptr<SculptureModel> mSculptureModel;
-		std::unique_ptr<SculptureModel> mPoleModel;
-		std::unique_ptr<SplineModel> mSplineModel;
+		std::unique_ptr<AssetLoader> mLoader;
+		std::shared_ptr<AssetCache> mAssetCache;
+		std::string mMemoryReportFile;
+		std::unique_ptr<GeometryPool> mGeometryPool;
+		MeshHandle mModel;
+		MeshHandle mPointModel;
+		MeshHandle mFlagModel;
+		MeshHandle mCloudModel;
+		LodChain mTessLods;
+		LodChain mQuantizedTessLods;
+		bool mRockQuantized = false;	// whether mQuantizedTessLods holds the quantised rock
+		LodChain mSculptureLods;
+		MeshHandle mPoleModel;
+		MeshHandle mSplineModel;
 		std::unique_ptr<ConstantBuffer<ModelViewProjectionConstantBuffer>> mConstantBuffer;
 		std::unique_ptr<ConstantBuffer<RayConstantBuffer>> mRayConstantBuffer;
 		std::unique_ptr<ConstantBuffer<TessConstantBuffer>> mTessConstantBuffer;
 		std::unique_ptr<ConstantBuffer<LightConstantBuffer>> mLightConstantBuffer;
 		std::unique_ptr<ConstantBuffer<TimeConstantBuffer>> mTimeConstantBuffer;
+		std::unique_ptr<ConstantBuffer<QuantizationConstantBuffer>> mQuantizationConstantBuffer;
+		std::unique_ptr<ConstantBuffer<PackRegionConstantBuffer>> mPackRegionConstantBuffer;
 
 		std::unique_ptr<VertexShader> mParametricVertexShader;
 		std::unique_ptr<HullShader> mParametricHullShader;
@@ -82,6 +103,7 @@ namespace Advanced_Rendering
 		std::unique_ptr<FragmentShader> mParametricFragmentShader;
 
 		std::unique_ptr<VertexShader> mRockVertexShader;
+		std::unique_ptr<VertexShader> mRockQuantizedVertexShader;
 		std::unique_ptr<HullShader> mRockUserHullShader;
 		std::unique_ptr<HullShader> mRockViewHullShader;
 		std::unique_ptr<DomainShader> mRockDomainShader;
@@ -112,10 +134,13 @@ namespace Advanced_Rendering
 		std::unique_ptr<Texture> mRockColorTexture;
 		std::unique_ptr<Texture> mRockDisplacementTexture;
 		std::unique_ptr<Texture> mRockNormalTexture;
-		std::unique_ptr<Texture> mSoldierTexture;
 		std::unique_ptr<Texture> mMarbleTexture;
+		std::unique_ptr<Texture> mBillboardTexture;
+		std::unique_ptr<Texture> mSoldierTexture;
 		std::unique_ptr<Texture> mFlagTexture;
 		std::unique_ptr<Texture> mCloudTexture;
+		std::unique_ptr<Texture> mSculptureTexture;
+		std::unique_ptr<RaySceneBuffer> mRayScene;
 
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> mSampler;
 		Microsoft::WRL::ComPtr<ID3D11RasterizerState> m_normalRasterizerState;
@@ -127,6 +152,11 @@ namespace Advanced_Rendering
 		RayConstantBuffer m_rayConstantBufferData;
 		TessConstantBuffer m_tessConstantBufferData;
 		LightConstantBuffer m_lightConstantBufferData;
+		QuantizationConstantBuffer m_quantizationConstantBufferData;
+		BillboardTexture mSoldierBillboard;
+		BillboardTexture mFlagBillboard;
+		BillboardTexture mCloudBillboard;
+		BillboardTexture mSculptureBillboard;
 
 		// Variables used with the rendering loop.
 		bool	m_loadingComplete;
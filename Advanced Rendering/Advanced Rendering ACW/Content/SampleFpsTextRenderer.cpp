@@ -58,7 +58,17 @@ void SampleFpsTextRenderer::Update(DX::StepTimer const& timer)
 	stream << std::fixed << std::setprecision(1);
 	stream << "Current Tesselation: " << Main::tesselation << std::endl;
 	stream << "Current Height: " << Main::height << std::endl;
-	stream << "WireFrame: " << (Main::wireframe ? L"Enabled" : L"Disabled") << std::endl << std::endl;
+	stream << "WireFrame: " << (Main::wireframe ? L"Enabled" : L"Disabled") << std::endl;
+
+	if (Main::loadingProgress < 1.0f)
+	{
+		stream << "Loading: " << Main::loadingProgress * 100.0f << "%" << std::endl << std::endl;
+	}
+	else
+	{
+		stream << "Loaded in " << Main::loadingMilliseconds << " ms" << std::endl << std::endl;
+	}
+
 	stream << "Keys:" << std::endl;
 	stream << "Tesselation Value - 1 / 2" << std::endl;
 	stream << "Height Value - 3 / 4" << std::endl;
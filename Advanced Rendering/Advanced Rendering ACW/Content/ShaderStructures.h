@@ -44,6 +44,31 @@ namespace Advanced_Rendering
 		DirectX::XMFLOAT4 lightPos;
 	};
 
+	// Rebuilds positions from R16G16B16A16_UNORM, offset + unorm * scale.
+	struct QuantizationConstantBuffer
+	{
+		DirectX::XMFLOAT4 positionOffset;
+		DirectX::XMFLOAT4 positionScale;
+	};
+
+	// Where a billboard's texture sits in the shared pack, a UV offset in xy and size in zw, and its layer.
+	struct PackRegionConstantBuffer
+	{
+		DirectX::XMFLOAT4 rect;
+		float layer;
+		DirectX::XMFLOAT3 padding;
+	};
+
+	// How many of each primitive RaySceneBuffer holds, objectCount being all three. The shader reads
+	// them as ints, to compare with its signed object indices.
+	struct SceneConstantBuffer
+	{
+		uint32_t sphereCount;
+		uint32_t triangleCount;
+		uint32_t quadCount;
+		uint32_t objectCount;
+	};
+
 	struct TimeConstantBuffer
 	{
 		float time;
@@ -0,0 +1,799 @@
+#include "DdsParser.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace Advanced_Rendering;
+
+static_assert(static_cast<uint32_t>(DdsFormat::BC1_UNORM) == 71, "DdsFormat must match DXGI_FORMAT");
+static_assert(static_cast<uint32_t>(DdsFormat::AYUV) == 100, "DdsFormat must match DXGI_FORMAT");
+static_assert(static_cast<uint32_t>(DdsFormat::B4G4R4A4_UNORM) == 115, "DdsFormat must match DXGI_FORMAT");
+
+namespace
+{
+	// File layout, as DDS.h in DirectXTex
+	struct PixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct Header
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		PixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct HeaderDxt10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(PixelFormat) == 32 && sizeof(Header) == 124 && sizeof(HeaderDxt10) == 20, "DDS headers are packed");
+
+	constexpr uint32_t Magic = 0x20534444; // "DDS "
+
+	constexpr uint32_t PixelFourCC = 0x00000004;
+	constexpr uint32_t PixelRgb = 0x00000040;
+	constexpr uint32_t PixelLuminance = 0x00020000;
+	constexpr uint32_t PixelAlpha = 0x00000002;
+	constexpr uint32_t PixelBumpDuDv = 0x00080000;
+
+	constexpr uint32_t HeaderCaps = 0x00000001;
+	constexpr uint32_t HeaderHeight = 0x00000002;
+	constexpr uint32_t HeaderWidth = 0x00000004;
+	constexpr uint32_t HeaderPitch = 0x00000008;
+	constexpr uint32_t HeaderPixelFormat = 0x00001000;
+	constexpr uint32_t HeaderMipMapCount = 0x00020000;
+	constexpr uint32_t HeaderLinearSize = 0x00080000;
+	constexpr uint32_t HeaderVolume = 0x00800000;
+
+	constexpr uint32_t CapsComplex = 0x00000008;
+	constexpr uint32_t CapsTexture = 0x00001000;
+	constexpr uint32_t CapsMipMap = 0x00400000;
+	constexpr uint32_t Caps2Volume = 0x00200000;
+
+	constexpr uint32_t CubeMap = 0x00000200;
+	constexpr uint32_t CubeMapAllFaces = 0x0000FC00 | CubeMap;
+	constexpr uint32_t MiscTextureCube = 0x4;
+	constexpr uint32_t AlphaModeMask = 0x7;
+
+	//D3D11 hardware limits, file metadata past them is not trusted
+	constexpr uint32_t MaxMipLevels = 15;
+	constexpr uint32_t MaxArraySize = 2048;
+	constexpr uint32_t Max1DSize = 16384;
+	constexpr uint32_t Max2DSize = 16384;
+	constexpr uint32_t MaxCubeSize = 16384;
+	constexpr uint32_t Max3DSize = 2048;
+
+	constexpr uint32_t FourCC(const char pA, const char pB, const char pC, const char pD)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(pA)) | static_cast<uint32_t>(static_cast<uint8_t>(pB)) << 8 |
+			static_cast<uint32_t>(static_cast<uint8_t>(pC)) << 16 | static_cast<uint32_t>(static_cast<uint8_t>(pD)) << 24;
+	}
+
+	bool IsBitMask(const PixelFormat & pFormat, const uint32_t pR, const uint32_t pG, const uint32_t pB, const uint32_t pA)
+	{
+		return pFormat.rBitMask == pR && pFormat.gBitMask == pG && pFormat.bBitMask == pB && pFormat.aBitMask == pA;
+	}
+
+	// Legacy headers without the DX10 extension, the mapping DDSTextureLoader has always used
+	DdsFormat GetFormat(const PixelFormat & pFormat)
+	{
+		if (pFormat.flags & PixelRgb)
+		{
+			//sRGB formats are only written with the DX10 header
+			switch (pFormat.rgbBitCount)
+			{
+			case 32:
+				if (IsBitMask(pFormat, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+				{
+					return DdsFormat::R8G8B8A8_UNORM;
+				}
+
+				if (IsBitMask(pFormat, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+				{
+					return DdsFormat::B8G8R8A8_UNORM;
+				}
+
+				if (IsBitMask(pFormat, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000))
+				{
+					return DdsFormat::B8G8R8X8_UNORM;
+				}
+
+				//D3DX writes 10:10:10:2 with the red and blue masks swapped, so the 'backwards' masks are taken as RGB
+				if (IsBitMask(pFormat, 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
+				{
+					return DdsFormat::R10G10B10A2_UNORM;
+				}
+
+				if (IsBitMask(pFormat, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
+				{
+					return DdsFormat::R16G16_UNORM;
+				}
+
+				//The only 32 bit single channel format in D3D9 was R32F
+				if (IsBitMask(pFormat, 0xffffffff, 0x00000000, 0x00000000, 0x00000000))
+				{
+					return DdsFormat::R32_FLOAT;
+				}
+				break;
+
+			case 16:
+				if (IsBitMask(pFormat, 0x7c00, 0x03e0, 0x001f, 0x8000))
+				{
+					return DdsFormat::B5G5R5A1_UNORM;
+				}
+
+				if (IsBitMask(pFormat, 0xf800, 0x07e0, 0x001f, 0x0000))
+				{
+					return DdsFormat::B5G6R5_UNORM;
+				}
+
+				if (IsBitMask(pFormat, 0x0f00, 0x00f0, 0x000f, 0xf000))
+				{
+					return DdsFormat::B4G4R4A4_UNORM;
+				}
+				break;
+			}
+		}
+		else if (pFormat.flags & PixelLuminance)
+		{
+			if (pFormat.rgbBitCount == 8)
+			{
+				if (IsBitMask(pFormat, 0x000000ff, 0x00000000, 0x00000000, 0x00000000))
+				{
+					return DdsFormat::R8_UNORM;
+				}
+
+				//Some writers give A8L8 a bit count of 8
+				if (IsBitMask(pFormat, 0x000000ff, 0x00000000, 0x00000000, 0x0000ff00))
+				{
+					return DdsFormat::R8G8_UNORM;
+				}
+			}
+
+			if (pFormat.rgbBitCount == 16)
+			{
+				if (IsBitMask(pFormat, 0x0000ffff, 0x00000000, 0x00000000, 0x00000000))
+				{
+					return DdsFormat::R16_UNORM;
+				}
+
+				if (IsBitMask(pFormat, 0x000000ff, 0x00000000, 0x00000000, 0x0000ff00))
+				{
+					return DdsFormat::R8G8_UNORM;
+				}
+			}
+		}
+		else if (pFormat.flags & PixelAlpha)
+		{
+			if (pFormat.rgbBitCount == 8)
+			{
+				return DdsFormat::A8_UNORM;
+			}
+		}
+		else if (pFormat.flags & PixelBumpDuDv)
+		{
+			if (pFormat.rgbBitCount == 16 && IsBitMask(pFormat, 0x00ff, 0xff00, 0x0000, 0x0000))
+			{
+				return DdsFormat::R8G8_SNORM;
+			}
+
+			if (pFormat.rgbBitCount == 32)
+			{
+				if (IsBitMask(pFormat, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+				{
+					return DdsFormat::R8G8B8A8_SNORM;
+				}
+
+				if (IsBitMask(pFormat, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
+				{
+					return DdsFormat::R16G16_SNORM;
+				}
+			}
+		}
+		else if (pFormat.flags & PixelFourCC)
+		{
+			switch (pFormat.fourCC)
+			{
+			case FourCC('D', 'X', 'T', '1'):
+				return DdsFormat::BC1_UNORM;
+
+			//Premultiplied alpha is only a difference in the alpha mode
+			case FourCC('D', 'X', 'T', '2'):
+			case FourCC('D', 'X', 'T', '3'):
+				return DdsFormat::BC2_UNORM;
+
+			case FourCC('D', 'X', 'T', '4'):
+			case FourCC('D', 'X', 'T', '5'):
+				return DdsFormat::BC3_UNORM;
+
+			case FourCC('A', 'T', 'I', '1'):
+			case FourCC('B', 'C', '4', 'U'):
+				return DdsFormat::BC4_UNORM;
+
+			case FourCC('B', 'C', '4', 'S'):
+				return DdsFormat::BC4_SNORM;
+
+			case FourCC('A', 'T', 'I', '2'):
+			case FourCC('B', 'C', '5', 'U'):
+				return DdsFormat::BC5_UNORM;
+
+			case FourCC('B', 'C', '5', 'S'):
+				return DdsFormat::BC5_SNORM;
+
+			case FourCC('R', 'G', 'B', 'G'):
+				return DdsFormat::R8G8_B8G8_UNORM;
+
+			case FourCC('G', 'R', 'G', 'B'):
+				return DdsFormat::G8R8_G8B8_UNORM;
+
+			case FourCC('Y', 'U', 'Y', '2'):
+				return DdsFormat::YUY2;
+
+			//D3DFORMAT values written as the FourCC
+			case 36:
+				return DdsFormat::R16G16B16A16_UNORM;
+
+			case 110:
+				return DdsFormat::R16G16B16A16_SNORM;
+
+			case 111:
+				return DdsFormat::R16_FLOAT;
+
+			case 112:
+				return DdsFormat::R16G16_FLOAT;
+
+			case 113:
+				return DdsFormat::R16G16B16A16_FLOAT;
+
+			case 114:
+				return DdsFormat::R32_FLOAT;
+
+			case 115:
+				return DdsFormat::R32G32_FLOAT;
+
+			case 116:
+				return DdsFormat::R32G32B32A32_FLOAT;
+			}
+		}
+
+		return DdsFormat::Unknown;
+	}
+
+	DdsAlphaMode GetAlphaMode(const Header & pHeader, const HeaderDxt10 * pDxt10)
+	{
+		if (pDxt10)
+		{
+			const auto mode = pDxt10->miscFlags2 & AlphaModeMask;
+			return mode <= static_cast<uint32_t>(DdsAlphaMode::Custom) ? static_cast<DdsAlphaMode>(mode) : DdsAlphaMode::Unknown;
+		}
+
+		if ((pHeader.pixelFormat.flags & PixelFourCC) &&
+			(pHeader.pixelFormat.fourCC == FourCC('D', 'X', 'T', '2') || pHeader.pixelFormat.fourCC == FourCC('D', 'X', 'T', '4')))
+		{
+			return DdsAlphaMode::Premultiplied;
+		}
+
+		return DdsAlphaMode::Unknown;
+	}
+}
+
+size_t Advanced_Rendering::DdsBitsPerPixel(const DdsFormat pFormat)
+{
+	switch (pFormat)
+	{
+	case DdsFormat::R32G32B32A32_TYPELESS: case DdsFormat::R32G32B32A32_FLOAT: case DdsFormat::R32G32B32A32_UINT: case DdsFormat::R32G32B32A32_SINT:
+		return 128;
+
+	case DdsFormat::R32G32B32_TYPELESS: case DdsFormat::R32G32B32_FLOAT: case DdsFormat::R32G32B32_UINT: case DdsFormat::R32G32B32_SINT:
+		return 96;
+
+	case DdsFormat::R16G16B16A16_TYPELESS: case DdsFormat::R16G16B16A16_FLOAT: case DdsFormat::R16G16B16A16_UNORM:
+	case DdsFormat::R16G16B16A16_UINT: case DdsFormat::R16G16B16A16_SNORM: case DdsFormat::R16G16B16A16_SINT:
+	case DdsFormat::R32G32_TYPELESS: case DdsFormat::R32G32_FLOAT: case DdsFormat::R32G32_UINT: case DdsFormat::R32G32_SINT:
+	case DdsFormat::R32G8X24_TYPELESS: case DdsFormat::D32_FLOAT_S8X24_UINT: case DdsFormat::R32_FLOAT_X8X24_TYPELESS:
+	case DdsFormat::X32_TYPELESS_G8X24_UINT: case DdsFormat::Y416: case DdsFormat::Y210: case DdsFormat::Y216:
+		return 64;
+
+	case DdsFormat::R10G10B10A2_TYPELESS: case DdsFormat::R10G10B10A2_UNORM: case DdsFormat::R10G10B10A2_UINT: case DdsFormat::R11G11B10_FLOAT:
+	case DdsFormat::R8G8B8A8_TYPELESS: case DdsFormat::R8G8B8A8_UNORM: case DdsFormat::R8G8B8A8_UNORM_SRGB: case DdsFormat::R8G8B8A8_UINT:
+	case DdsFormat::R8G8B8A8_SNORM: case DdsFormat::R8G8B8A8_SINT:
+	case DdsFormat::R16G16_TYPELESS: case DdsFormat::R16G16_FLOAT: case DdsFormat::R16G16_UNORM: case DdsFormat::R16G16_UINT:
+	case DdsFormat::R16G16_SNORM: case DdsFormat::R16G16_SINT:
+	case DdsFormat::R32_TYPELESS: case DdsFormat::D32_FLOAT: case DdsFormat::R32_FLOAT: case DdsFormat::R32_UINT: case DdsFormat::R32_SINT:
+	case DdsFormat::R24G8_TYPELESS: case DdsFormat::D24_UNORM_S8_UINT: case DdsFormat::R24_UNORM_X8_TYPELESS: case DdsFormat::X24_TYPELESS_G8_UINT:
+	case DdsFormat::R9G9B9E5_SHAREDEXP: case DdsFormat::R8G8_B8G8_UNORM: case DdsFormat::G8R8_G8B8_UNORM:
+	case DdsFormat::B8G8R8A8_UNORM: case DdsFormat::B8G8R8X8_UNORM: case DdsFormat::R10G10B10_XR_BIAS_A2_UNORM:
+	case DdsFormat::B8G8R8A8_TYPELESS: case DdsFormat::B8G8R8A8_UNORM_SRGB: case DdsFormat::B8G8R8X8_TYPELESS: case DdsFormat::B8G8R8X8_UNORM_SRGB:
+	case DdsFormat::AYUV: case DdsFormat::Y410: case DdsFormat::YUY2:
+		return 32;
+
+	case DdsFormat::P010: case DdsFormat::P016:
+		return 24;
+
+	case DdsFormat::R8G8_TYPELESS: case DdsFormat::R8G8_UNORM: case DdsFormat::R8G8_UINT: case DdsFormat::R8G8_SNORM: case DdsFormat::R8G8_SINT:
+	case DdsFormat::R16_TYPELESS: case DdsFormat::R16_FLOAT: case DdsFormat::D16_UNORM: case DdsFormat::R16_UNORM: case DdsFormat::R16_UINT:
+	case DdsFormat::R16_SNORM: case DdsFormat::R16_SINT:
+	case DdsFormat::B5G6R5_UNORM: case DdsFormat::B5G5R5A1_UNORM: case DdsFormat::A8P8: case DdsFormat::B4G4R4A4_UNORM:
+		return 16;
+
+	case DdsFormat::NV12: case DdsFormat::OPAQUE_420: case DdsFormat::NV11:
+		return 12;
+
+	case DdsFormat::R8_TYPELESS: case DdsFormat::R8_UNORM: case DdsFormat::R8_UINT: case DdsFormat::R8_SNORM: case DdsFormat::R8_SINT:
+	case DdsFormat::A8_UNORM: case DdsFormat::AI44: case DdsFormat::IA44: case DdsFormat::P8:
+		return 8;
+
+	case DdsFormat::R1_UNORM:
+		return 1;
+
+	case DdsFormat::BC1_TYPELESS: case DdsFormat::BC1_UNORM: case DdsFormat::BC1_UNORM_SRGB:
+	case DdsFormat::BC4_TYPELESS: case DdsFormat::BC4_UNORM: case DdsFormat::BC4_SNORM:
+		return 4;
+
+	case DdsFormat::BC2_TYPELESS: case DdsFormat::BC2_UNORM: case DdsFormat::BC2_UNORM_SRGB:
+	case DdsFormat::BC3_TYPELESS: case DdsFormat::BC3_UNORM: case DdsFormat::BC3_UNORM_SRGB:
+	case DdsFormat::BC5_TYPELESS: case DdsFormat::BC5_UNORM: case DdsFormat::BC5_SNORM:
+	case DdsFormat::BC6H_TYPELESS: case DdsFormat::BC6H_UF16: case DdsFormat::BC6H_SF16:
+	case DdsFormat::BC7_TYPELESS: case DdsFormat::BC7_UNORM: case DdsFormat::BC7_UNORM_SRGB:
+		return 8;
+
+	default:
+		return 0;
+	}
+}
+
+bool Advanced_Rendering::IsBlockCompressed(const DdsFormat pFormat)
+{
+	return (pFormat >= DdsFormat::BC1_TYPELESS && pFormat <= DdsFormat::BC5_SNORM) ||
+		(pFormat >= DdsFormat::BC6H_TYPELESS && pFormat <= DdsFormat::BC7_UNORM_SRGB);
+}
+
+void Advanced_Rendering::GetDdsSurfaceInfo(const size_t pWidth, const size_t pHeight, const DdsFormat pFormat, size_t & pBytes, size_t & pRowBytes, size_t & pRows)
+{
+	if (IsBlockCompressed(pFormat))
+	{
+		const size_t blockBytes = DdsBitsPerPixel(pFormat) * 2;
+		const auto blocksWide = pWidth > 0 ? std::max<size_t>(1, (pWidth + 3) / 4) : 0;
+		const auto blocksHigh = pHeight > 0 ? std::max<size_t>(1, (pHeight + 3) / 4) : 0;
+
+		pRowBytes = blocksWide * blockBytes;
+		pRows = blocksHigh;
+		pBytes = pRowBytes * blocksHigh;
+		return;
+	}
+
+	switch (pFormat)
+	{
+	//Packed 4:2:2, two pixels share an element
+	case DdsFormat::R8G8_B8G8_UNORM:
+	case DdsFormat::G8R8_G8B8_UNORM:
+	case DdsFormat::YUY2:
+		pRowBytes = ((pWidth + 1) >> 1) * 4;
+		pRows = pHeight;
+		break;
+
+	case DdsFormat::Y210:
+	case DdsFormat::Y216:
+		pRowBytes = ((pWidth + 1) >> 1) * 8;
+		pRows = pHeight;
+		break;
+
+	//Direct3D sizes NV11 as twice the height, larger than its 4:1:1 data
+	case DdsFormat::NV11:
+		pRowBytes = ((pWidth + 3) >> 2) * 4;
+		pRows = pHeight * 2;
+		break;
+
+	//Planar 4:2:0, a luma plane then half as many chroma rows
+	case DdsFormat::NV12:
+	case DdsFormat::OPAQUE_420:
+	case DdsFormat::P010:
+	case DdsFormat::P016:
+	{
+		const size_t elementBytes = pFormat == DdsFormat::NV12 || pFormat == DdsFormat::OPAQUE_420 ? 2 : 4;
+		pRowBytes = ((pWidth + 1) >> 1) * elementBytes;
+		pBytes = pRowBytes * pHeight + ((pRowBytes * pHeight + 1) >> 1);
+		pRows = pHeight + ((pHeight + 1) >> 1);
+		return;
+	}
+
+	default:
+		pRowBytes = (pWidth * DdsBitsPerPixel(pFormat) + 7) / 8;
+		pRows = pHeight;
+		break;
+	}
+
+	pBytes = pRowBytes * pRows;
+}
+
+DdsFormat Advanced_Rendering::MakeSrgb(const DdsFormat pFormat)
+{
+	switch (pFormat)
+	{
+	case DdsFormat::R8G8B8A8_UNORM:
+		return DdsFormat::R8G8B8A8_UNORM_SRGB;
+
+	case DdsFormat::BC1_UNORM:
+		return DdsFormat::BC1_UNORM_SRGB;
+
+	case DdsFormat::BC2_UNORM:
+		return DdsFormat::BC2_UNORM_SRGB;
+
+	case DdsFormat::BC3_UNORM:
+		return DdsFormat::BC3_UNORM_SRGB;
+
+	case DdsFormat::B8G8R8A8_UNORM:
+		return DdsFormat::B8G8R8A8_UNORM_SRGB;
+
+	case DdsFormat::B8G8R8X8_UNORM:
+		return DdsFormat::B8G8R8X8_UNORM_SRGB;
+
+	case DdsFormat::BC7_UNORM:
+		return DdsFormat::BC7_UNORM_SRGB;
+
+	default:
+		return pFormat;
+	}
+}
+
+const char * Advanced_Rendering::DdsErrorString(const DdsError pError)
+{
+	switch (pError)
+	{
+	case DdsError::None:
+		return "ok";
+
+	case DdsError::TooSmall:
+		return "shorter than the DDS headers";
+
+	case DdsError::BadMagic:
+		return "not a DDS file";
+
+	case DdsError::BadHeader:
+		return "bad header size";
+
+	case DdsError::Unsupported:
+		return "unsupported format, dimension or size";
+
+	case DdsError::InvalidData:
+		return "contradictory header fields";
+
+	case DdsError::Truncated:
+		return "surfaces run past the end of the file";
+	}
+
+	return "unknown error";
+}
+
+DdsError Advanced_Rendering::ParseDds(const uint8_t * const pData, const size_t pSize, DdsImage & pImage)
+{
+	pImage = DdsImage();
+
+	if (!pData || pSize < sizeof(uint32_t) + sizeof(Header))
+	{
+		return DdsError::TooSmall;
+	}
+
+	//Copied out, a mapped file is only guaranteed byte alignment past the magic
+	uint32_t magic;
+	memcpy(&magic, pData, sizeof magic);
+
+	if (magic != Magic)
+	{
+		return DdsError::BadMagic;
+	}
+
+	Header header;
+	memcpy(&header, pData + sizeof(uint32_t), sizeof header);
+
+	if (header.size != sizeof(Header) || header.pixelFormat.size != sizeof(PixelFormat))
+	{
+		return DdsError::BadHeader;
+	}
+
+	size_t offset = sizeof(uint32_t) + sizeof(Header);
+
+	HeaderDxt10 dxt10;
+	const auto hasDxt10 = (header.pixelFormat.flags & PixelFourCC) && header.pixelFormat.fourCC == FourCC('D', 'X', '1', '0');
+
+	if (hasDxt10)
+	{
+		if (pSize < offset + sizeof(HeaderDxt10))
+		{
+			return DdsError::TooSmall;
+		}
+
+		memcpy(&dxt10, pData + offset, sizeof dxt10);
+		offset += sizeof(HeaderDxt10);
+	}
+
+	auto width = header.width;
+	auto height = header.height;
+	auto depth = header.depth;
+	auto arraySize = 1u;
+	auto cubeMap = false;
+	auto format = DdsFormat::Unknown;
+	auto dimension = DdsDimension::Unknown;
+	const auto mipCount = std::max(header.mipMapCount, 1u);
+
+	if (hasDxt10)
+	{
+		arraySize = dxt10.arraySize;
+
+		if (arraySize == 0)
+		{
+			return DdsError::InvalidData;
+		}
+
+		format = static_cast<DdsFormat>(dxt10.dxgiFormat);
+
+		//Palettised formats cannot be created, nor can anything DdsBitsPerPixel does not know
+		if (dxt10.dxgiFormat >= static_cast<uint32_t>(DdsFormat::Count) || DdsBitsPerPixel(format) == 0 ||
+			format == DdsFormat::AI44 || format == DdsFormat::IA44 || format == DdsFormat::P8 || format == DdsFormat::A8P8)
+		{
+			return DdsError::Unsupported;
+		}
+
+		switch (static_cast<DdsDimension>(dxt10.resourceDimension))
+		{
+		case DdsDimension::Texture1D:
+			//D3DX writes 1D textures with a height of 1
+			if ((header.flags & HeaderHeight) && height != 1)
+			{
+				return DdsError::InvalidData;
+			}
+
+			height = depth = 1;
+			break;
+
+		case DdsDimension::Texture2D:
+			if (dxt10.miscFlag & MiscTextureCube)
+			{
+				if (arraySize > MaxArraySize / 6)
+				{
+					return DdsError::Unsupported;
+				}
+
+				arraySize *= 6;
+				cubeMap = true;
+			}
+
+			depth = 1;
+			break;
+
+		case DdsDimension::Texture3D:
+			if (!(header.flags & HeaderVolume))
+			{
+				return DdsError::InvalidData;
+			}
+
+			if (arraySize > 1)
+			{
+				return DdsError::Unsupported;
+			}
+			break;
+
+		default:
+			return DdsError::Unsupported;
+		}
+
+		dimension = static_cast<DdsDimension>(dxt10.resourceDimension);
+	}
+	else
+	{
+		format = GetFormat(header.pixelFormat);
+
+		if (format == DdsFormat::Unknown)
+		{
+			return DdsError::Unsupported;
+		}
+
+		if (header.flags & HeaderVolume)
+		{
+			dimension = DdsDimension::Texture3D;
+		}
+		else
+		{
+			if (header.caps2 & CubeMap)
+			{
+				//Every face must be present
+				if ((header.caps2 & CubeMapAllFaces) != CubeMapAllFaces)
+				{
+					return DdsError::Unsupported;
+				}
+
+				arraySize = 6;
+				cubeMap = true;
+			}
+
+			//A legacy header cannot express a 1D texture
+			depth = 1;
+			dimension = DdsDimension::Texture2D;
+		}
+	}
+
+	if (mipCount > MaxMipLevels)
+	{
+		return DdsError::Unsupported;
+	}
+
+	switch (dimension)
+	{
+	case DdsDimension::Texture1D:
+		if (arraySize > MaxArraySize || width > Max1DSize)
+		{
+			return DdsError::Unsupported;
+		}
+		break;
+
+	case DdsDimension::Texture2D:
+		if (arraySize > MaxArraySize || width > (cubeMap ? MaxCubeSize : Max2DSize) || height > (cubeMap ? MaxCubeSize : Max2DSize))
+		{
+			return DdsError::Unsupported;
+		}
+		break;
+
+	default:
+		if (width > Max3DSize || height > Max3DSize || depth > Max3DSize)
+		{
+			return DdsError::Unsupported;
+		}
+		break;
+	}
+
+	if (width == 0 || height == 0 || depth == 0)
+	{
+		return DdsError::InvalidData;
+	}
+
+	//Every surface is at least a byte, so a header claiming more surfaces than bytes is cut short before allocating
+	const auto surfaceCount = static_cast<size_t>(arraySize) * mipCount;
+
+	if (surfaceCount > pSize - offset)
+	{
+		return DdsError::Truncated;
+	}
+
+	pImage.surfaces.resize(surfaceCount);
+
+	//Sizes are bounded above, so none of this can overflow a 64 bit size_t
+	const auto end = pSize;
+	auto surface = pImage.surfaces.data();
+
+	for (uint32_t item = 0; item < arraySize; item++)
+	{
+		auto mipWidth = width;
+		auto mipHeight = height;
+		auto mipDepth = depth;
+
+		for (uint32_t mip = 0; mip < mipCount; mip++, surface++)
+		{
+			size_t bytes, rowBytes, rows;
+			GetDdsSurfaceInfo(mipWidth, mipHeight, format, bytes, rowBytes, rows);
+
+			const auto total = bytes * mipDepth;
+
+			if (total > end - offset)
+			{
+				pImage.surfaces.clear();
+				return DdsError::Truncated;
+			}
+
+			surface->data = pData + offset;
+			surface->width = mipWidth;
+			surface->height = mipHeight;
+			surface->depth = mipDepth;
+			surface->rowPitch = rowBytes;
+			surface->slicePitch = bytes;
+			surface->rows = rows;
+
+			offset += total;
+
+			mipWidth = std::max(mipWidth >> 1, 1u);
+			mipHeight = std::max(mipHeight >> 1, 1u);
+			mipDepth = std::max(mipDepth >> 1, 1u);
+		}
+	}
+
+	pImage.format = format;
+	pImage.dimension = dimension;
+	pImage.alphaMode = GetAlphaMode(header, hasDxt10 ? &dxt10 : nullptr);
+	pImage.width = width;
+	pImage.height = height;
+	pImage.depth = depth;
+	pImage.mipCount = mipCount;
+	pImage.arraySize = arraySize;
+	pImage.cubeMap = cubeMap;
+
+	return DdsError::None;
+}
+
+void Advanced_Rendering::WriteDdsHeader(const DdsImage & pImage, std::vector<uint8_t> & pOutput)
+{
+	size_t bytes, rowBytes, rows;
+	GetDdsSurfaceInfo(pImage.width, pImage.height, pImage.format, bytes, rowBytes, rows);
+
+	Header header = {};
+	header.size = sizeof(Header);
+	header.flags = HeaderCaps | HeaderHeight | HeaderWidth | HeaderPixelFormat;
+	header.height = pImage.height;
+	header.width = pImage.width;
+	header.depth = pImage.dimension == DdsDimension::Texture3D ? pImage.depth : 0;
+	header.mipMapCount = pImage.mipCount;
+	header.pixelFormat.size = sizeof(PixelFormat);
+	header.pixelFormat.flags = PixelFourCC;
+	header.pixelFormat.fourCC = FourCC('D', 'X', '1', '0');
+	header.caps = CapsTexture;
+
+	if (IsBlockCompressed(pImage.format))
+	{
+		header.flags |= HeaderLinearSize;
+		header.pitchOrLinearSize = static_cast<uint32_t>(bytes);
+	}
+	else
+	{
+		header.flags |= HeaderPitch;
+		header.pitchOrLinearSize = static_cast<uint32_t>(rowBytes);
+	}
+
+	if (pImage.mipCount > 1)
+	{
+		header.flags |= HeaderMipMapCount;
+		header.caps |= CapsMipMap | CapsComplex;
+	}
+
+	if (pImage.arraySize > 1)
+	{
+		header.caps |= CapsComplex;
+	}
+
+	if (pImage.cubeMap)
+	{
+		header.caps2 = CubeMapAllFaces;
+	}
+
+	if (pImage.dimension == DdsDimension::Texture3D)
+	{
+		header.flags |= HeaderVolume;
+		header.caps2 = Caps2Volume;
+	}
+
+	HeaderDxt10 dxt10 = {};
+	dxt10.dxgiFormat = static_cast<uint32_t>(pImage.format);
+	dxt10.resourceDimension = static_cast<uint32_t>(pImage.dimension);
+	dxt10.miscFlag = pImage.cubeMap ? MiscTextureCube : 0;
+	dxt10.arraySize = pImage.cubeMap ? pImage.arraySize / 6 : pImage.arraySize;
+	dxt10.miscFlags2 = static_cast<uint32_t>(pImage.alphaMode);
+
+	const auto offset = pOutput.size();
+	pOutput.resize(offset + sizeof(uint32_t) + sizeof header + sizeof dxt10);
+
+	memcpy(pOutput.data() + offset, &Magic, sizeof Magic);
+	memcpy(pOutput.data() + offset + sizeof(uint32_t), &header, sizeof header);
+	memcpy(pOutput.data() + offset + sizeof(uint32_t) + sizeof header, &dxt10, sizeof dxt10);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Advanced_Rendering
+{
+	// DXGI_FORMAT by value, so the parser builds without the Windows headers. The D3D loader casts
+	// straight between the two.
+	enum class DdsFormat : uint32_t
+	{
+		Unknown = 0,
+		R32G32B32A32_TYPELESS, R32G32B32A32_FLOAT, R32G32B32A32_UINT, R32G32B32A32_SINT,
+		R32G32B32_TYPELESS, R32G32B32_FLOAT, R32G32B32_UINT, R32G32B32_SINT,
+		R16G16B16A16_TYPELESS, R16G16B16A16_FLOAT, R16G16B16A16_UNORM, R16G16B16A16_UINT, R16G16B16A16_SNORM, R16G16B16A16_SINT,
+		R32G32_TYPELESS, R32G32_FLOAT, R32G32_UINT, R32G32_SINT,
+		R32G8X24_TYPELESS, D32_FLOAT_S8X24_UINT, R32_FLOAT_X8X24_TYPELESS, X32_TYPELESS_G8X24_UINT,
+		R10G10B10A2_TYPELESS, R10G10B10A2_UNORM, R10G10B10A2_UINT,
+		R11G11B10_FLOAT,
+		R8G8B8A8_TYPELESS, R8G8B8A8_UNORM, R8G8B8A8_UNORM_SRGB, R8G8B8A8_UINT, R8G8B8A8_SNORM, R8G8B8A8_SINT,
+		R16G16_TYPELESS, R16G16_FLOAT, R16G16_UNORM, R16G16_UINT, R16G16_SNORM, R16G16_SINT,
+		R32_TYPELESS, D32_FLOAT, R32_FLOAT, R32_UINT, R32_SINT,
+		R24G8_TYPELESS, D24_UNORM_S8_UINT, R24_UNORM_X8_TYPELESS, X24_TYPELESS_G8_UINT,
+		R8G8_TYPELESS, R8G8_UNORM, R8G8_UINT, R8G8_SNORM, R8G8_SINT,
+		R16_TYPELESS, R16_FLOAT, D16_UNORM, R16_UNORM, R16_UINT, R16_SNORM, R16_SINT,
+		R8_TYPELESS, R8_UNORM, R8_UINT, R8_SNORM, R8_SINT, A8_UNORM,
+		R1_UNORM,
+		R9G9B9E5_SHAREDEXP,
+		R8G8_B8G8_UNORM, G8R8_G8B8_UNORM,
+		BC1_TYPELESS, BC1_UNORM, BC1_UNORM_SRGB,
+		BC2_TYPELESS, BC2_UNORM, BC2_UNORM_SRGB,
+		BC3_TYPELESS, BC3_UNORM, BC3_UNORM_SRGB,
+		BC4_TYPELESS, BC4_UNORM, BC4_SNORM,
+		BC5_TYPELESS, BC5_UNORM, BC5_SNORM,
+		B5G6R5_UNORM, B5G5R5A1_UNORM,
+		B8G8R8A8_UNORM, B8G8R8X8_UNORM,
+		R10G10B10_XR_BIAS_A2_UNORM,
+		B8G8R8A8_TYPELESS, B8G8R8A8_UNORM_SRGB, B8G8R8X8_TYPELESS, B8G8R8X8_UNORM_SRGB,
+		BC6H_TYPELESS, BC6H_UF16, BC6H_SF16,
+		BC7_TYPELESS, BC7_UNORM, BC7_UNORM_SRGB,
+		AYUV, Y410, Y416, NV12, P010, P016, OPAQUE_420, YUY2, Y210, Y216, NV11, AI44, IA44, P8, A8P8,
+		B4G4R4A4_UNORM,
+		Count
+	};
+
+	// D3D11_RESOURCE_DIMENSION by value
+	enum class DdsDimension : uint32_t
+	{
+		Unknown = 0,
+		Texture1D = 2,
+		Texture2D = 3,
+		Texture3D = 4
+	};
+
+	// DDS_ALPHA_MODE by value
+	enum class DdsAlphaMode : uint32_t
+	{
+		Unknown = 0,
+		Straight = 1,
+		Premultiplied = 2,
+		Opaque = 3,
+		Custom = 4
+	};
+
+	enum class DdsError
+	{
+		None,
+		TooSmall,			// shorter than the headers
+		BadMagic,
+		BadHeader,			// header or pixel format size fields are wrong
+		Unsupported,		// a format, dimension or size D3D11 cannot create
+		InvalidData,		// contradictory header fields
+		Truncated			// the surfaces run past the end of the file
+	};
+
+	// One mip of one array item, pointing into the parsed file. depth slices follow each other
+	// slicePitch bytes apart.
+	struct DdsSurface
+	{
+		const uint8_t * data = nullptr;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t depth = 0;
+		size_t rowPitch = 0;
+		size_t slicePitch = 0;
+		size_t rows = 0;			// block rows for compressed formats
+	};
+
+	// A validated DDS file. Every surface lies inside the file, so the views can be handed to the
+	// GPU or decoded without further checks. A cube map's six faces are array items.
+	struct DdsImage
+	{
+		DdsFormat format = DdsFormat::Unknown;
+		DdsDimension dimension = DdsDimension::Unknown;
+		DdsAlphaMode alphaMode = DdsAlphaMode::Unknown;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t depth = 0;
+		uint32_t mipCount = 0;
+		uint32_t arraySize = 0;
+		bool cubeMap = false;
+
+		// Item-major, as D3D11 numbers subresources
+		std::vector<DdsSurface> surfaces;
+
+		const DdsSurface & Surface(const uint32_t pMip, const uint32_t pItem = 0) const
+		{
+			return surfaces[pItem * mipCount + pMip];
+		}
+	};
+
+	// Checks the headers against the D3D11 limits and lays out every surface over pData, which
+	// must outlive pImage. Nothing is copied.
+	DdsError ParseDds(const uint8_t * pData, size_t pSize, DdsImage & pImage);
+
+	const char * DdsErrorString(DdsError pError);
+
+	// 0 for formats D3D11 cannot create
+	size_t DdsBitsPerPixel(DdsFormat pFormat);
+	bool IsBlockCompressed(DdsFormat pFormat);
+
+	// Bytes in a pWidth by pHeight surface and in each row of pixels, or of 4x4 blocks
+	void GetDdsSurfaceInfo(size_t pWidth, size_t pHeight, DdsFormat pFormat, size_t & pBytes, size_t & pRowBytes, size_t & pRows);
+
+	// The _SRGB twin of a UNORM format, other formats unchanged
+	DdsFormat MakeSrgb(DdsFormat pFormat);
+
+	// Appends the magic and headers, with the DX10 extension, describing pImage's format and shape.
+	// Its surfaces are not written, they follow in the order ParseDds lays them out.
+	void WriteDdsHeader(const DdsImage & pImage, std::vector<uint8_t> & pOutput);
+}
@@ -1,20 +1,16 @@
 #include "pch.h"
 #include "DomainShader.h"
 
-void DomainShader::Load(std::shared_ptr<DX::DeviceResources> pDeviceResources)
+void DomainShader::Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const uint8_t * pData, const size_t pSize)
 {
-	auto loadDSTask = DX::ReadDataAsync(mFilename);
-
-	auto createDSTask = loadDSTask.then([this, pDeviceResources](const std::vector<byte>& fileData) {
-		DX::ThrowIfFailed(
-			pDeviceResources->GetD3DDevice()->CreateDomainShader(
-				&fileData[0],
-				fileData.size(),
-				nullptr,
-				&mDomainShader
-			)
-		);
-	});
+	DX::ThrowIfFailed(
+		pDeviceResources->GetD3DDevice()->CreateDomainShader(
+			pData,
+			pSize,
+			nullptr,
+			mDomainShader.ReleaseAndGetAddressOf()
+		)
+	);
 }
 
 void DomainShader::Reset()
@@ -7,11 +7,13 @@ class DomainShader : public ShaderProgram
 private:
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> mDomainShader;
 
+protected:
+	void Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const uint8_t * pData, size_t pSize) override;
+
 public:
 	DomainShader(const std::wstring & pFilename) : ShaderProgram(pFilename) {};
 	~DomainShader() { Reset(); };
 
-	void Load(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
 	void Reset() override;
 	void UseProgram(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
 	void ReleaseProgram(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
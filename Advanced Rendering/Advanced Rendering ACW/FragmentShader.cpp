@@ -1,20 +1,16 @@
 #include "pch.h"
 #include "FragmentShader.h"
 
-void FragmentShader::Load(std::shared_ptr<DX::DeviceResources> pDeviceResources)
+void FragmentShader::Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const uint8_t * pData, const size_t pSize)
 {
-	auto loadPSTask = DX::ReadDataAsync(mFilename);
-
-	auto createPSTask = loadPSTask.then([this, pDeviceResources](const std::vector<byte>& fileData) {
-		DX::ThrowIfFailed(
-			pDeviceResources->GetD3DDevice()->CreatePixelShader(
-				&fileData[0],
-				fileData.size(),
-				nullptr,
-				&mPixelShader
-			)
-		);
-	});
+	DX::ThrowIfFailed(
+		pDeviceResources->GetD3DDevice()->CreatePixelShader(
+			pData,
+			pSize,
+			nullptr,
+			mPixelShader.ReleaseAndGetAddressOf()
+		)
+	);
 }
 
 void FragmentShader::Reset()
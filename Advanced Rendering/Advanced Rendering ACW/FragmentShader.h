@@ -7,11 +7,13 @@ class FragmentShader : public ShaderProgram
 private:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> mPixelShader;
 
+protected:
+	void Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const uint8_t * pData, size_t pSize) override;
+
 public:
 	FragmentShader(const std::wstring & pFilename) : ShaderProgram(pFilename) {};
 	~FragmentShader() { Reset(); };
 
-	void Load(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
 	void Reset() override;
 	void UseProgram(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
 	void ReleaseProgram(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
@@ -7,6 +7,11 @@ bool Framebuffer::LoadFramebuffer(std::shared_ptr<DX::DeviceResources> pDeviceRe
 	const auto height = pDeviceResources->GetOutputSize().Height;
 
 	const auto device = pDeviceResources->GetD3DDevice();
+	const auto registry = pDeviceResources->GetResourceRegistry();
+
+	//The old targets go before the new ones are made, so a resize never counts both
+	mColorMemory.Reset();
+	mDepthMemory.Reset();
 
 	D3D11_TEXTURE2D_DESC renderTextureDesc;
 	ZeroMemory(&renderTextureDesc, sizeof D3D11_TEXTURE2D_DESC);
@@ -28,6 +33,17 @@ bool Framebuffer::LoadFramebuffer(std::shared_ptr<DX::DeviceResources> pDeviceRe
 		return false;
 	}
 
+	Advanced_Rendering::ResourceDesc memory;
+	memory.kind = Advanced_Rendering::ResourceKind::RenderTarget;
+	memory.owner = "Framebuffer";
+	memory.name = mName + " color and position";
+	memory.format = static_cast<Advanced_Rendering::DdsFormat>(renderTextureDesc.Format);
+	memory.width = renderTextureDesc.Width;
+	memory.height = renderTextureDesc.Height;
+	memory.arraySize = renderTextureDesc.ArraySize;
+	memory.bytes = Advanced_Rendering::TextureBytes(memory.format, memory.width, memory.height, 1, 1, memory.arraySize);
+	mColorMemory = registry->Track(memory);
+
 	D3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc;
 	ZeroMemory(&renderTargetViewDesc, sizeof D3D11_RENDER_TARGET_VIEW_DESC);
 	renderTargetViewDesc.Format = renderTextureDesc.Format;
@@ -96,6 +112,13 @@ bool Framebuffer::LoadFramebuffer(std::shared_ptr<DX::DeviceResources> pDeviceRe
 		return false;
 	}
 
+	memory.kind = Advanced_Rendering::ResourceKind::DepthStencil;
+	memory.name = mName + " depth";
+	memory.format = static_cast<Advanced_Rendering::DdsFormat>(depthTextureDesc.Format);
+	memory.arraySize = 1;
+	memory.bytes = Advanced_Rendering::TextureBytes(memory.format, memory.width, memory.height, 1, 1, 1);
+	mDepthMemory = registry->Track(memory);
+
 	D3D11_DEPTH_STENCIL_DESC depthStateDesc;
 	ZeroMemory(&depthStateDesc, sizeof D3D11_DEPTH_STENCIL_DESC);
 	depthStateDesc.DepthEnable = true;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include "..\Common\DirectXHelper.h"
 #include "..\Common\DeviceResources.h"
 
@@ -15,8 +16,16 @@ class Framebuffer
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> mDepthState = nullptr;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> mDepthTextureTargetView = nullptr;
 
+	std::string mName;
+	Advanced_Rendering::ResourceHandle mColorMemory;
+	Advanced_Rendering::ResourceHandle mDepthMemory;
+
 public:
-	Framebuffer() = default;
+	// pName identifies the framebuffer in the memory report
+	explicit Framebuffer(const std::string & pName = "Framebuffer") : mName(pName)
+	{
+	}
+
 	~Framebuffer() = default;
 
 	Framebuffer(const Framebuffer &) = delete;
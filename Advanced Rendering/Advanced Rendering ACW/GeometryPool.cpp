@@ -0,0 +1,483 @@
+#include "pch.h"
+#include "GeometryPool.h"
+
+#include <algorithm>
+
+using namespace Advanced_Rendering;
+
+static_assert(static_cast<uint32_t>(VertexStream::BiTangent) == static_cast<uint32_t>(MeshStream::BiTangent), "VertexStream must start with the MeshStream streams");
+static_assert(MaxLods <= CookedMaxLevels, "The cooker must be able to build every level of a LodChain");
+
+namespace
+{
+	bool IsTriangleList(const D3D11_PRIMITIVE_TOPOLOGY pTopology)
+	{
+		return pTopology == D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST || pTopology == D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST;
+	}
+
+	const char * StreamName(const VertexStream pStream)
+	{
+		static const char * names[VertexStreamCount] =
+		{
+			"Position", "Normal", "TexCoord", "Tangent", "BiTangent", "Color",
+			"QuantizedPosition", "OctNormal", "HalfTexCoord", "OctTangent", "OctBiTangent"
+		};
+
+		return names[static_cast<uint32_t>(pStream)];
+	}
+}
+
+GeometryPool::~GeometryPool()
+{
+	Reset();
+}
+
+UINT GeometryPool::Stride(const VertexStream pStream)
+{
+	static const UINT strides[VertexStreamCount] =
+	{
+		sizeof(DirectX::XMFLOAT3),
+		sizeof(DirectX::XMFLOAT3),
+		sizeof(DirectX::XMFLOAT2),
+		sizeof(DirectX::XMFLOAT3),
+		sizeof(DirectX::XMFLOAT3),
+		sizeof(DirectX::XMFLOAT3),
+		sizeof(uint16_t) * 4,
+		sizeof(int16_t) * 2,
+		sizeof(uint16_t) * 2,
+		sizeof(int16_t) * 2,
+		sizeof(int16_t) * 2
+	};
+
+	return strides[static_cast<uint32_t>(pStream)];
+}
+
+void GeometryPool::Keep(std::shared_ptr<const void> pOwner)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStorage.push_back(std::move(pOwner));
+}
+
+MeshHandle GeometryPool::AddMesh(const MeshView & pMesh, const VertexStream * pSlots, const uint32_t pSlotCount, const D3D11_PRIMITIVE_TOPOLOGY pTopology, const void * const * pData)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	Mesh mesh = {};
+	mesh.topology = pTopology;
+	mesh.vertexCount = pMesh.vertexCount;
+	mesh.indexCount = pMesh.indexCount;
+	mesh.indices = pMesh.indices;
+	mesh.ownsVertices = true;
+	mesh.ownsIndices = true;
+	mesh.slotCount = pSlotCount;
+
+	//Sub-allocate the index range and each stream's byte range
+	mesh.startIndex = mIndexCount;
+	mIndexCount += pMesh.indexCount;
+
+	for (uint32_t i = 0; i < pSlotCount; i++)
+	{
+		const auto stream = static_cast<uint32_t>(pSlots[i]);
+
+		mesh.streams[i] = pSlots[i];
+		mesh.data[i] = pData ? pData[i] : stream < MeshStreamCount ? pMesh.streams[stream] : nullptr;
+		mesh.strides[i] = Stride(pSlots[i]);
+		mesh.offsets[i] = mStreamBytes[stream];
+
+		mStreamBytes[stream] += mesh.strides[i] * pMesh.vertexCount;
+	}
+
+	mMeshes.push_back(mesh);
+
+	return static_cast<MeshHandle>(mMeshes.size() - 1);
+}
+
+void GeometryPool::SetCache(std::shared_ptr<AssetCache> pCache)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mCache = std::move(pCache);
+}
+
+CookedMesh GeometryPool::Cook(const std::string & pFilename, const MeshCookOptions & pOptions)
+{
+	std::shared_ptr<AssetCache> cache;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		cache = mCache;
+	}
+
+	//A missing file gives an empty mesh, as the text loaders always have
+	CookedMesh mesh;
+	CookMesh(pFilename, pOptions, cache.get(), mesh);
+
+	for (auto & owner : mesh.storage)
+	{
+		Keep(std::move(owner));
+	}
+
+	mesh.storage.clear();
+	return mesh;
+}
+
+MeshHandle GeometryPool::AddSimMesh(const std::string & pFilename, const SimLayout pLayout, const D3D11_PRIMITIVE_TOPOLOGY pTopology)
+{
+	static const VertexStream slots[] = { VertexStream::Position, VertexStream::Normal, VertexStream::TexCoord, VertexStream::Tangent, VertexStream::BiTangent };
+	const auto slotCount = pLayout == SimLayout::Tangent ? 5u : 3u;
+
+	MeshCookOptions options;
+	options.layout = pLayout;
+	options.triangles = IsTriangleList(pTopology);
+
+	return AddMesh(Cook(pFilename, options).mesh, slots, slotCount, pTopology);
+}
+
+MeshHandle GeometryPool::AddLevel(const MeshHandle pMesh, const uint32_t * pIndices, const uint32_t pIndexCount, const MeshletMesh * pMeshlets)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	Mesh level = mMeshes[pMesh];
+	level.ownsVertices = false;
+	level.ownsIndices = true;
+	level.meshlets = pMeshlets;
+	level.indices = pIndices;
+	level.indexCount = pIndexCount;
+	level.startIndex = mIndexCount;
+
+	mIndexCount += pIndexCount;
+	mMeshes.push_back(level);
+
+	return static_cast<MeshHandle>(mMeshes.size() - 1);
+}
+
+MeshHandle GeometryPool::AddSharedLevel(const MeshHandle pMesh, const MeshHandle pLevel)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	Mesh level = mMeshes[pMesh];
+	level.ownsVertices = false;
+	level.ownsIndices = false;
+	level.meshlets = mMeshes[pLevel].meshlets;
+	level.indices = nullptr;
+	level.indexCount = mMeshes[pLevel].indexCount;
+	level.startIndex = mMeshes[pLevel].startIndex;
+
+	mMeshes.push_back(level);
+
+	return static_cast<MeshHandle>(mMeshes.size() - 1);
+}
+
+LodChain GeometryPool::AddSimMeshLods(const std::string & pFilename, const SimLayout pLayout, const D3D11_PRIMITIVE_TOPOLOGY pTopology, const bool pMeshlets)
+{
+	static const VertexStream slots[] = { VertexStream::Position, VertexStream::Normal, VertexStream::TexCoord, VertexStream::Tangent, VertexStream::BiTangent };
+	const auto slotCount = pLayout == SimLayout::Tangent ? 5u : 3u;
+
+	MeshCookOptions options;
+	options.layout = pLayout;
+	options.triangles = IsTriangleList(pTopology);
+	options.levels = MaxLods;
+	options.meshlets = pMeshlets;
+
+	const auto mesh = Cook(pFilename, options);
+
+	LodChain lods;
+	lods.count = 1;
+	lods.meshes[0] = AddMesh(mesh.mesh, slots, slotCount, pTopology);
+	lods.center = DirectX::XMFLOAT3(mesh.center[0], mesh.center[1], mesh.center[2]);
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mMeshes[lods.meshes[0]].meshlets = mesh.levels[0].meshlets;
+	}
+
+	for (uint32_t i = 1; i < mesh.levelCount; i++)
+	{
+		const auto & level = mesh.levels[i];
+
+		lods.meshes[lods.count] = AddLevel(lods.meshes[0], level.indices, level.indexCount, level.meshlets);
+		lods.errors[lods.count] = level.error;
+		lods.count++;
+	}
+
+	return lods;
+}
+
+LodChain GeometryPool::ShareLods(const MeshHandle pMesh, const LodChain & pLods)
+{
+	auto lods = pLods;
+
+	//pMesh's own index range is left unused, the base level may have been reordered into meshlets
+	for (uint32_t i = 0; i < lods.count; i++)
+	{
+		lods.meshes[i] = AddSharedLevel(pMesh, pLods.meshes[i]);
+	}
+
+	return lods;
+}
+
+MeshHandle LodChain::Select(const float pPixelsPerUnit, const float pThreshold) const
+{
+	for (auto i = count; i > 1; i--)
+	{
+		if (errors[i - 1] * pPixelsPerUnit <= pThreshold)
+		{
+			return meshes[i - 1];
+		}
+	}
+
+	return meshes[0];
+}
+
+bool GeometryPool::AddQuantizedSimMesh(const std::string & pFilename, const D3D11_PRIMITIVE_TOPOLOGY pTopology, QuantizationConstantBuffer & pConstants, MeshHandle & pMesh)
+{
+	static const VertexStream slots[] = { VertexStream::QuantizedPosition, VertexStream::OctNormal, VertexStream::HalfTexCoord, VertexStream::OctTangent, VertexStream::OctBiTangent };
+
+	MeshCookOptions options;
+	options.layout = SimLayout::Tangent;
+	options.triangles = IsTriangleList(pTopology);
+
+	auto quantized = std::make_shared<QuantizedMesh>();
+
+	//A mesh without all five streams, or one that failed to load, leaves nothing to upload
+	if (!QuantizeMesh(Cook(pFilename, options).mesh, *quantized))
+	{
+		return false;
+	}
+
+	pConstants.positionOffset = DirectX::XMFLOAT4(quantized->positionOffset[0], quantized->positionOffset[1], quantized->positionOffset[2], 0.0f);
+	pConstants.positionScale = DirectX::XMFLOAT4(quantized->positionScale[0], quantized->positionScale[1], quantized->positionScale[2], 0.0f);
+
+	MeshView view;
+	view.vertexCount = quantized->vertexCount;
+	view.indexCount = static_cast<uint32_t>(quantized->indices.size());
+	view.indices = quantized->indices.data();
+
+	//The quantised streams are past the end of MeshView's streams, so the slots point at the data directly
+	const void * data[] = { quantized->positions.data(), quantized->normals.data(), quantized->texCoords.data(), quantized->tangents.data(), quantized->biTangents.data() };
+
+	Keep(quantized);
+	pMesh = AddMesh(view, slots, 5, pTopology, data);
+	return true;
+}
+
+MeshHandle GeometryPool::AddCurve(const std::string & pFilename, const D3D11_PRIMITIVE_TOPOLOGY pTopology)
+{
+	static const VertexStream slots[] = { VertexStream::Position, VertexStream::BiTangent };
+
+	MeshCookOptions options;
+	options.curve = true;
+	options.triangles = false;
+
+	return AddMesh(Cook(pFilename, options).mesh, slots, 2, pTopology);
+}
+
+MeshHandle GeometryPool::AddMesh(const std::vector<VertexPositionColor> & pVertices, const std::vector<unsigned int> & pIndices, const D3D11_PRIMITIVE_TOPOLOGY pTopology)
+{
+	static const VertexStream slots[] = { VertexStream::Position, VertexStream::Color };
+
+	auto positions = std::make_shared<std::vector<DirectX::XMFLOAT3>>();
+	auto colors = std::make_shared<std::vector<DirectX::XMFLOAT3>>();
+	auto indices = std::make_shared<std::vector<uint32_t>>(pIndices.begin(), pIndices.end());
+
+	positions->reserve(pVertices.size());
+	colors->reserve(pVertices.size());
+
+	for (const auto & vertex : pVertices)
+	{
+		positions->push_back(vertex.pos);
+		colors->push_back(vertex.color);
+	}
+
+	MeshView view;
+	view.vertexCount = static_cast<uint32_t>(pVertices.size());
+	view.indexCount = static_cast<uint32_t>(indices->size());
+	view.indices = indices->data();
+
+	//Color is past the end of MeshView's streams, so the slots point at the data directly
+	const void * data[] = { positions->data(), colors->data() };
+
+	Keep(positions);
+	Keep(colors);
+	Keep(indices);
+
+	return AddMesh(view, slots, 2, pTopology, data);
+}
+
+MeshHandle GeometryPool::AddMesh(MeshBuffer && pMesh, const std::vector<VertexStream> & pSlots, const D3D11_PRIMITIVE_TOPOLOGY pTopology)
+{
+	auto mesh = std::make_shared<MeshBuffer>(std::move(pMesh));
+
+	Keep(mesh);
+	return AddMesh(mesh->View(), pSlots.data(), static_cast<uint32_t>(pSlots.size()), pTopology);
+}
+
+void GeometryPool::Load(std::shared_ptr<DX::DeviceResources> pDeviceResources)
+{
+	auto device = pDeviceResources->GetD3DDevice();
+	auto context = pDeviceResources->GetD3DDeviceContext();
+	auto registry = pDeviceResources->GetResourceRegistry();
+
+	ResourceDesc memory;
+	memory.owner = "GeometryPool";
+
+	//None changing data for buffers;
+	D3D11_BUFFER_DESC bufferDesc;
+	ZeroMemory(&bufferDesc, sizeof bufferDesc);
+
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = 0;
+
+	//One buffer per stream, each mesh's range is copied from where it already sits in memory
+	for (uint32_t i = 0; i < VertexStreamCount; i++)
+	{
+		if (mStreamBytes[i] == 0)
+		{
+			continue;
+		}
+
+		bufferDesc.ByteWidth = mStreamBytes[i];
+
+		DX::ThrowIfFailed(device->CreateBuffer(&bufferDesc, nullptr, mStreamBuffers[i].ReleaseAndGetAddressOf()));
+
+		memory.kind = ResourceKind::VertexBuffer;
+		memory.name = StreamName(static_cast<VertexStream>(i));
+		memory.width = memory.bytes = bufferDesc.ByteWidth;
+		mStreamMemory[i] = registry->Track(memory);
+	}
+
+	if (mIndexCount > 0)
+	{
+		bufferDesc.ByteWidth = sizeof(unsigned int) * mIndexCount;
+		bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+		DX::ThrowIfFailed(device->CreateBuffer(&bufferDesc, nullptr, mIndexBuffer.ReleaseAndGetAddressOf()));
+
+		memory.kind = ResourceKind::IndexBuffer;
+		memory.name = "Indices";
+		memory.format = DdsFormat::R32_UINT;
+		memory.width = mIndexCount;
+		memory.bytes = bufferDesc.ByteWidth;
+		mIndexMemory = registry->Track(memory);
+	}
+
+	//The meshes stay in system memory after the upload, as the cooked files and buffers they were added from
+	uint64_t meshBytes = sizeof(unsigned int) * static_cast<uint64_t>(mIndexCount);
+
+	for (const auto bytes : mStreamBytes)
+	{
+		meshBytes += bytes;
+	}
+
+	memory.kind = ResourceKind::MeshData;
+	memory.heap = ResourceHeap::Cpu;
+	memory.name = "Vertices and indices";
+	memory.format = DdsFormat::Unknown;
+	memory.width = 0;
+	memory.bytes = meshBytes;
+	mMeshDataMemory = registry->Track(memory);
+
+	for (auto & mesh : mMeshes)
+	{
+		D3D11_BOX box = { 0, 0, 0, 0, 1, 1 };
+
+		for (uint32_t i = 0; i < mesh.slotCount; i++)
+		{
+			const auto stream = static_cast<uint32_t>(mesh.streams[i]);
+
+			mesh.buffers[i] = mStreamBuffers[stream].Get();
+
+			if (!mesh.ownsVertices)
+			{
+				continue;
+			}
+
+			box.left = mesh.offsets[i];
+			box.right = mesh.offsets[i] + mesh.strides[i] * mesh.vertexCount;
+
+			if (box.right > box.left)
+			{
+				context->UpdateSubresource(mesh.buffers[i], 0, &box, mesh.data[i], 0, 0);
+			}
+		}
+
+		box.left = sizeof(unsigned int) * mesh.startIndex;
+		box.right = sizeof(unsigned int) * (mesh.startIndex + mesh.indexCount);
+
+		if (mesh.ownsIndices && box.right > box.left)
+		{
+			context->UpdateSubresource(mIndexBuffer.Get(), 0, &box, mesh.indices, 0, 0);
+		}
+	}
+}
+
+void GeometryPool::Reset()
+{
+	for (auto & mesh : mMeshes)
+	{
+		for (uint32_t i = 0; i < mesh.slotCount; i++)
+		{
+			mesh.buffers[i] = nullptr;
+		}
+	}
+
+	for (auto & buffer : mStreamBuffers)
+	{
+		buffer.Reset();
+	}
+
+	mIndexBuffer.Reset();
+
+	for (auto & memory : mStreamMemory)
+	{
+		memory.Reset();
+	}
+
+	mIndexMemory.Reset();
+}
+
+void GeometryPool::UseMesh(std::shared_ptr<DX::DeviceResources> pDeviceResources, const MeshHandle pMesh) const
+{
+	auto deviceContext = pDeviceResources->GetD3DDeviceContext();
+
+	const auto & mesh = mMeshes[pMesh];
+
+	deviceContext->IASetVertexBuffers(0, mesh.slotCount, mesh.buffers, mesh.strides, mesh.offsets);
+	deviceContext->IASetIndexBuffer(mIndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+
+	deviceContext->IASetPrimitiveTopology(mesh.topology);
+
+	deviceContext->DrawIndexed(mesh.indexCount, mesh.startIndex, 0);
+}
+
+uint32_t GeometryPool::UseMesh(std::shared_ptr<DX::DeviceResources> pDeviceResources, const MeshHandle pMesh, const MeshletCullView & pView) const
+{
+	const auto & mesh = mMeshes[pMesh];
+
+	if (!mesh.meshlets)
+	{
+		UseMesh(pDeviceResources, pMesh);
+		return mesh.indexCount / 3;
+	}
+
+	const auto triangles = CullMeshlets(mesh.meshlets->meshlets, pView, mVisibleRanges);
+
+	if (triangles == 0)
+	{
+		return 0;
+	}
+
+	auto deviceContext = pDeviceResources->GetD3DDeviceContext();
+
+	deviceContext->IASetVertexBuffers(0, mesh.slotCount, mesh.buffers, mesh.strides, mesh.offsets);
+	deviceContext->IASetIndexBuffer(mIndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+
+	deviceContext->IASetPrimitiveTopology(mesh.topology);
+
+	for (const auto & range : mVisibleRanges)
+	{
+		deviceContext->DrawIndexed(range.indexCount, mesh.startIndex + range.firstIndex, 0);
+	}
+
+	return triangles;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <d3d11.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Content/ShaderStructures.h"
+#include "..\Common\DirectXHelper.h"
+#include "..\Common\DeviceResources.h"
+#include "AssetCache.h"
+#include "MeshCooker.h"
+#include "MeshFile.h"
+#include "MeshletBuilder.h"
+#include "VertexQuantizer.h"
+
+namespace Advanced_Rendering
+{
+	// Vertex streams held by the pool. The first five match MeshStream, the quantised streams are
+	// laid out as in QuantizedMesh.
+	enum class VertexStream : uint32_t
+	{
+		Position,
+		Normal,
+		TexCoord,
+		Tangent,
+		BiTangent,
+		Color,
+		QuantizedPosition,
+		OctNormal,
+		HalfTexCoord,
+		OctTangent,
+		OctBiTangent,
+		Count
+	};
+
+	constexpr uint32_t VertexStreamCount = static_cast<uint32_t>(VertexStream::Count);
+	constexpr uint32_t MaxVertexSlots = 8;
+	constexpr uint32_t MaxLods = 5;
+
+	using MeshHandle = uint32_t;
+
+	// A mesh and its simplified levels, finest first. Every level shares the mesh's vertex ranges
+	// and only has its own index range.
+	struct LodChain
+	{
+		uint32_t count = 0;
+		MeshHandle meshes[MaxLods] = {};
+		float errors[MaxLods] = {};		// in mesh units
+		DirectX::XMFLOAT3 center = { 0.0f, 0.0f, 0.0f };
+
+		// Coarsest level whose error projects to no more than pThreshold pixels. pPixelsPerUnit is
+		// the projected size of one mesh unit at the mesh's distance.
+		MeshHandle Select(float pPixelsPerUnit, float pThreshold = 1.0f) const;
+	};
+
+	// Owns every mesh in the scene. Each vertex stream is one large vertex buffer and all indices
+	// share one index buffer; meshes are sub-allocated from them when added, so binding a mesh only
+	// sets the offsets worked out up front. The Add functions may run on several threads at once,
+	// Load and the rest only on the render thread once they have all returned.
+	class GeometryPool
+	{
+		struct Mesh
+		{
+			D3D11_PRIMITIVE_TOPOLOGY topology;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint32_t startIndex;
+			const uint32_t * indices;
+
+			//LOD levels reuse their base mesh's vertex ranges, shared LOD chains reuse index ranges too
+			bool ownsVertices;
+			bool ownsIndices;
+
+			//Set when the index range is in meshlet order
+			const MeshletMesh * meshlets;
+
+			//Input slot tables, in the order of the shader's input layout slots
+			uint32_t slotCount;
+			VertexStream streams[MaxVertexSlots];
+			const void * data[MaxVertexSlots];
+			ID3D11Buffer * buffers[MaxVertexSlots];
+			UINT strides[MaxVertexSlots];
+			UINT offsets[MaxVertexSlots];
+		};
+
+		std::vector<Mesh> mMeshes;
+		std::vector<std::shared_ptr<const void>> mStorage;
+		std::shared_ptr<AssetCache> mCache;
+
+		UINT mStreamBytes[VertexStreamCount] = {};
+		UINT mIndexCount = 0;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mStreamBuffers[VertexStreamCount];
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mIndexBuffer;
+
+		ResourceHandle mStreamMemory[VertexStreamCount];
+		ResourceHandle mIndexMemory;
+		ResourceHandle mMeshDataMemory;
+
+		mutable std::vector<IndexRange> mVisibleRanges;
+
+		//Guards everything above bar the buffers, so meshes can be added from loader jobs
+		std::mutex mMutex;
+
+		void Keep(std::shared_ptr<const void> pOwner);
+		MeshHandle AddMesh(const MeshView & pMesh, const VertexStream * pSlots, uint32_t pSlotCount, D3D11_PRIMITIVE_TOPOLOGY pTopology, const void * const * pData = nullptr);
+		CookedMesh Cook(const std::string & pFilename, const MeshCookOptions & pOptions);
+		MeshHandle AddLevel(MeshHandle pMesh, const uint32_t * pIndices, uint32_t pIndexCount, const MeshletMesh * pMeshlets);
+		MeshHandle AddSharedLevel(MeshHandle pMesh, MeshHandle pLevel);
+
+	public:
+		GeometryPool() = default;
+		~GeometryPool();
+
+		GeometryPool(const GeometryPool &) = delete;
+		GeometryPool(GeometryPool &&) = delete;
+		GeometryPool & operator= (const GeometryPool &) = delete;
+		GeometryPool & operator= (GeometryPool &&) = delete;
+
+		static UINT Stride(VertexStream pStream);
+
+		// Cooked meshes are served from and stored to pCache by the file based Add functions that
+		// follow. Without a cache every mesh is cooked from its source on each run.
+		void SetCache(std::shared_ptr<AssetCache> pCache);
+
+		// .sim/.simb mesh, slots position, normal, texcoord (+ tangent, bitangent)
+		MeshHandle AddSimMesh(const std::string & pFilename, SimLayout pLayout, D3D11_PRIMITIVE_TOPOLOGY pTopology);
+
+		// As AddSimMesh, plus a chain of simplified levels at half the triangles each. pMeshlets
+		// splits every level into meshlets and puts its indices in meshlet order, for the culling
+		// UseMesh.
+		LodChain AddSimMeshLods(const std::string & pFilename, SimLayout pLayout, D3D11_PRIMITIVE_TOPOLOGY pTopology, bool pMeshlets = false);
+
+		// Gives pMesh the levels of pLods, which must be over the same vertices in the same order.
+		// Every level, the first included, draws pLods' index ranges and meshlets.
+		LodChain ShareLods(MeshHandle pMesh, const LodChain & pLods);
+
+		// Tangent space .sim/.simb mesh quantised, slots as the QuantizedMesh streams. pConstants gets
+		// the bounds the vertex shader needs to rebuild positions. Fails, adding nothing, when the
+		// mesh cannot be quantised, the caller then draws the unquantised mesh.
+		bool AddQuantizedSimMesh(const std::string & pFilename, D3D11_PRIMITIVE_TOPOLOGY pTopology, QuantizationConstantBuffer & pConstants, MeshHandle & pMesh);
+
+		// .cur curve, slots position, bitangent
+		MeshHandle AddCurve(const std::string & pFilename, D3D11_PRIMITIVE_TOPOLOGY pTopology);
+
+		// Slots position, color
+		MeshHandle AddMesh(const std::vector<VertexPositionColor> & pVertices, const std::vector<unsigned int> & pIndices, D3D11_PRIMITIVE_TOPOLOGY pTopology);
+
+		// Takes ownership of pMesh, slots as listed
+		MeshHandle AddMesh(MeshBuffer && pMesh, const std::vector<VertexStream> & pSlots, D3D11_PRIMITIVE_TOPOLOGY pTopology);
+
+		void Load(std::shared_ptr<DX::DeviceResources> pDeviceResources);
+		void Reset();
+		void UseMesh(std::shared_ptr<DX::DeviceResources> pDeviceResources, MeshHandle pMesh) const;
+
+		// Draws only the meshlets inside pView's frustum that face the eye, one draw per run of
+		// visible meshlets. Meshes without meshlets are drawn whole. Returns the triangles drawn.
+		uint32_t UseMesh(std::shared_ptr<DX::DeviceResources> pDeviceResources, MeshHandle pMesh, const MeshletCullView & pView) const;
+	};
+}
@@ -1,20 +1,16 @@
 #include "pch.h"
 #include "GeometryShader.h"
 
-void GeometryShader::Load(std::shared_ptr<DX::DeviceResources> pDeviceResources)
+void GeometryShader::Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const uint8_t * pData, const size_t pSize)
 {
-	auto loadPSTask = DX::ReadDataAsync(mFilename);
-
-	auto createPSTask = loadPSTask.then([this, pDeviceResources](const std::vector<byte>& fileData) {
-		DX::ThrowIfFailed(
-			pDeviceResources->GetD3DDevice()->CreateGeometryShader(
-				&fileData[0],
-				fileData.size(),
-				nullptr,
-				&mGeometryShader
-			)
-		);
-	});
+	DX::ThrowIfFailed(
+		pDeviceResources->GetD3DDevice()->CreateGeometryShader(
+			pData,
+			pSize,
+			nullptr,
+			mGeometryShader.ReleaseAndGetAddressOf()
+		)
+	);
 }
 
 void GeometryShader::Reset()
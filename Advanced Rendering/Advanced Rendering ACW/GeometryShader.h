@@ -7,11 +7,13 @@ class GeometryShader : public ShaderProgram
 private:
 	Microsoft::WRL::ComPtr<ID3D11GeometryShader> mGeometryShader;
 
+protected:
+	void Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const uint8_t * pData, size_t pSize) override;
+
 public:
 	GeometryShader(const std::wstring & pFilename) : ShaderProgram(pFilename) {};
 	~GeometryShader() { Reset(); };
 
-	void Load(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
 	void Reset() override;
 	void UseProgram(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
 	void ReleaseProgram(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
@@ -1,20 +1,16 @@
 #include "pch.h"
 #include "HullShader.h"
 
-void HullShader::Load(std::shared_ptr<DX::DeviceResources> pDeviceResources)
+void HullShader::Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const uint8_t * pData, const size_t pSize)
 {
-	auto loadPSTask = DX::ReadDataAsync(mFilename);
-
-	auto createPSTask = loadPSTask.then([this, pDeviceResources](const std::vector<byte>& fileData) {
-		DX::ThrowIfFailed(
-			pDeviceResources->GetD3DDevice()->CreateHullShader(
-				&fileData[0],
-				fileData.size(),
-				nullptr,
-				&mHullShader
-			)
-		);
-	});
+	DX::ThrowIfFailed(
+		pDeviceResources->GetD3DDevice()->CreateHullShader(
+			pData,
+			pSize,
+			nullptr,
+			mHullShader.ReleaseAndGetAddressOf()
+		)
+	);
 }
 
 void HullShader::Reset()
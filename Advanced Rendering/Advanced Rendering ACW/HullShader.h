@@ -7,11 +7,13 @@ class HullShader : public ShaderProgram
 private:
 	Microsoft::WRL::ComPtr<ID3D11HullShader> mHullShader;
 
+protected:
+	void Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const uint8_t * pData, size_t pSize) override;
+
 public:
 	HullShader(const std::wstring & pFilename) : ShaderProgram(pFilename) {};
 	~HullShader() { Reset(); };
 
-	void Load(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
 	void Reset() override;
 	void UseProgram(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
 	void ReleaseProgram(std::shared_ptr<DX::DeviceResources> pDeviceResources) override;
@@ -11,6 +11,11 @@ using namespace Windows::System;
 float Main::tesselation = 1.0f;
 float Main::height = 0.1f;
 bool Main::wireframe = true;
+bool Main::quantized = true;
+bool Main::culling = true;
+float Main::loadingProgress = 0.0f;
+double Main::loadingMilliseconds = 0.0;
+uint32_t Main::memoryBudgetMegabytes = 512;
 
 // Loads and initializes application assets when the application is loaded.
 Main::Main(const std::shared_ptr<DX::DeviceResources>& deviceResources) :
@@ -86,6 +91,8 @@ bool Main::Render()
 	m_sceneRenderer->Render();
 	m_fpsTextRenderer->Render();
 
+	m_deviceResources->GetResourceRegistry()->EndFrame();
+
 	return true;
 }
 
@@ -186,6 +193,14 @@ void Main::OnKeyUp(const Windows::System::VirtualKey & pKey)
 	{
 		wireframe = !wireframe;
 	}
+	else if (pKey == VirtualKey::Number6)
+	{
+		quantized = !quantized;
+	}
+	else if (pKey == VirtualKey::Number7)
+	{
+		culling = !culling;
+	}
 }
 
 void Main::OnKeyDown(const Windows::System::VirtualKey & pKey)
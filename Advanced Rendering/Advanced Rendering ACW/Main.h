@@ -27,6 +27,11 @@ namespace Advanced_Rendering
 		static float tesselation;
 		static float height;
 		static bool wireframe;
+		static bool quantized;
+		static bool culling;
+		static float loadingProgress;
+		static double loadingMilliseconds;
+		static uint32_t memoryBudgetMegabytes;
 
 	private:
 		// Cached pointer to device resources.
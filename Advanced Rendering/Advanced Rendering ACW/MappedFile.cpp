@@ -0,0 +1,141 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Advanced_Rendering;
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::string & pFilename)
+{
+	Close();
+
+	const auto length = MultiByteToWideChar(CP_UTF8, 0, pFilename.c_str(), -1, nullptr, 0);
+	std::wstring filename(length, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, pFilename.c_str(), -1, &filename[0], length);
+
+	//CreateFile2 and the FromApp mapping calls are the ones available to Store apps
+	const auto file = CreateFile2(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	mFile = file;
+
+	FILE_STANDARD_INFO fileInfo;
+	if (!GetFileInformationByHandleEx(file, FileStandardInfo, &fileInfo, sizeof fileInfo) || fileInfo.EndOfFile.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mMapping = CreateFileMappingFromApp(file, nullptr, PAGE_READONLY, 0, nullptr);
+
+	if (!mMapping)
+	{
+		Close();
+		return false;
+	}
+
+	mData = static_cast<const uint8_t *>(MapViewOfFileFromApp(mMapping, FILE_MAP_READ, 0, 0));
+
+	if (!mData)
+	{
+		Close();
+		return false;
+	}
+
+	mSize = static_cast<size_t>(fileInfo.EndOfFile.QuadPart);
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData)
+	{
+		UnmapViewOfFile(mData);
+	}
+
+	if (mMapping)
+	{
+		CloseHandle(mMapping);
+	}
+
+	if (mFile)
+	{
+		CloseHandle(mFile);
+	}
+
+	mData = nullptr;
+	mSize = 0;
+	mMapping = nullptr;
+	mFile = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string & pFilename)
+{
+	Close();
+
+	mFile = open(pFilename.c_str(), O_RDONLY);
+
+	if (mFile < 0)
+	{
+		return false;
+	}
+
+	struct stat fileInfo;
+	if (fstat(mFile, &fileInfo) != 0 || fileInfo.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	const auto data = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, mFile, 0);
+
+	if (data == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	mData = static_cast<const uint8_t *>(data);
+	mSize = static_cast<size_t>(fileInfo.st_size);
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData)
+	{
+		munmap(const_cast<uint8_t *>(mData), mSize);
+	}
+
+	if (mFile >= 0)
+	{
+		close(mFile);
+	}
+
+	mData = nullptr;
+	mSize = 0;
+	mFile = -1;
+}
+
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Advanced_Rendering
+{
+	// Read-only memory mapping of a whole file. The view stays valid until Close or destruction.
+	class MappedFile
+	{
+		const uint8_t * mData = nullptr;
+		size_t mSize = 0;
+
+#if defined(_WIN32)
+		void * mFile = nullptr;
+		void * mMapping = nullptr;
+#else
+		int mFile = -1;
+#endif
+
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile(MappedFile &&) = delete;
+		MappedFile & operator= (const MappedFile &) = delete;
+		MappedFile & operator= (MappedFile &&) = delete;
+
+		bool Open(const std::string & pFilename);
+		void Close();
+
+		const uint8_t * Data() const
+		{
+			return mData;
+		}
+
+		size_t Size() const
+		{
+			return mSize;
+		}
+
+		bool IsOpen() const
+		{
+			return mData != nullptr;
+		}
+	};
+}
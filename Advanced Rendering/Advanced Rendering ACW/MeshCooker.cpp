@@ -0,0 +1,345 @@
+#include "MeshCooker.h"
+
+#include <algorithm>
+#include <cfloat>
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "SimParser.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr uint32_t InfoChunk = ChunkId('I', 'N', 'F', 'O');
+
+	uint32_t StreamChunk(const uint32_t pStream)
+	{
+		return ChunkId('S', 'T', 'R', static_cast<char>('0' + pStream));
+	}
+
+	uint32_t IndexChunk(const uint32_t pLevel)
+	{
+		return ChunkId('I', 'D', 'X', static_cast<char>('0' + pLevel));
+	}
+
+	uint32_t MeshletChunk(const uint32_t pLevel)
+	{
+		return ChunkId('M', 'S', 'H', static_cast<char>('0' + pLevel));
+	}
+
+	struct CookedMeshInfo
+	{
+		uint32_t vertexCount;
+		uint32_t levelCount;
+		uint32_t indexCounts[CookedMaxLevels];
+		uint32_t meshletCounts[CookedMaxLevels];
+		float errors[CookedMaxLevels];
+		float center[3];
+	};
+
+	uint64_t StreamBytes(const uint32_t pStream, const uint32_t pVertexCount)
+	{
+		return static_cast<uint64_t>(MeshStreamComponents[pStream]) * sizeof(float) * pVertexCount;
+	}
+
+	// pBinary is the converted file LoadSource prefers, when there is one
+	uint64_t Key(const MappedFile & pSource, const MappedFile & pBinary, const MeshCookOptions & pOptions)
+	{
+		//The cook reads the binary file in place of the text when it can, so a stale binary file must miss too
+		const auto binary = pBinary.IsOpen() ? AssetCache::Key(pBinary.Data(), pBinary.Size(), &MeshCookerVersion, 1) : 0;
+
+		//Meshlets are stored as they are laid out in memory, so their layout is part of the key
+		const uint32_t options[] =
+		{
+			MeshCookerVersion,
+			pOptions.curve ? 1u : 0u,
+			static_cast<uint32_t>(pOptions.layout),
+			pOptions.triangles ? 1u : 0u,
+			std::min(std::max(pOptions.levels, 1u), CookedMaxLevels),
+			pOptions.meshlets ? 1u : 0u,
+			static_cast<uint32_t>(sizeof(Meshlet)),
+			MeshletMaxVertices,
+			MeshletMaxTriangles,
+			static_cast<uint32_t>(binary),
+			static_cast<uint32_t>(binary >> 32)
+		};
+
+		return AssetCache::Key(pSource.Data(), pSource.Size(), options, static_cast<uint32_t>(sizeof options / sizeof options[0]));
+	}
+
+	// The uncached load, parsed from pSource when it is mapped or else read by filename
+	bool LoadSource(const std::string & pFilename, const MeshCookOptions & pOptions, const MappedFile & pSource, CookedMesh & pMesh)
+	{
+		const auto begin = reinterpret_cast<const char *>(pSource.Data());
+		const auto end = begin + pSource.Size();
+
+		if (pOptions.curve)
+		{
+			auto curve = std::make_shared<MeshBuffer>();
+
+			if (!(pSource.IsOpen() ? ParseCurveText(begin, end, *curve) : LoadCurveText(pFilename, *curve)))
+			{
+				return false;
+			}
+
+			pMesh.mesh = curve->View();
+			pMesh.storage.push_back(curve);
+			return true;
+		}
+
+		static const MeshStream streams[] = { MeshStream::Position, MeshStream::Normal, MeshStream::TexCoord, MeshStream::Tangent, MeshStream::BiTangent };
+		const auto streamCount = pOptions.layout == SimLayout::Tangent ? 5u : 3u;
+
+		//Prefer the converted binary file, it is mapped and used in place and was optimised when converted
+		auto file = std::make_shared<MeshFile>();
+
+		if (file->Open(GetBinaryMeshFilename(pFilename)))
+		{
+			const auto & view = file->View();
+			auto complete = true;
+
+			for (uint32_t i = 0; i < streamCount; i++)
+			{
+				complete &= view.HasStream(streams[i]);
+			}
+
+			//The level and meshlet passes trust the indices, a file that is not whole triangles falls back to the text
+			if (complete && (!pOptions.triangles || IsTriangleList(view)))
+			{
+				pMesh.mesh = view;
+				pMesh.storage.push_back(file);
+				return true;
+			}
+		}
+
+		auto mesh = std::make_shared<MeshBuffer>();
+
+		if (!(pSource.IsOpen() ? ParseSimText(begin, end, pOptions.layout, *mesh) : LoadSimText(pFilename, pOptions.layout, *mesh)))
+		{
+			return false;
+		}
+
+		if (pOptions.triangles && !OptimizeMesh(*mesh))
+		{
+			return false;
+		}
+
+		pMesh.mesh = mesh->View();
+		pMesh.storage.push_back(mesh);
+		return true;
+	}
+
+	void BuildLevels(const MeshCookOptions & pOptions, CookedMesh & pMesh)
+	{
+		const auto & view = pMesh.mesh;
+
+		pMesh.levelCount = 1;
+		pMesh.levels[0].indices = view.indices;
+		pMesh.levels[0].indexCount = view.indexCount;
+
+		const auto levels = std::min(pOptions.levels, CookedMaxLevels);
+
+		if (pOptions.triangles && levels > 1)
+		{
+			//Selection is by projected error, so the chain itself is not capped
+			auto chain = std::make_shared<std::vector<MeshLod>>(BuildLodChain(view, levels, 0.5f, FLT_MAX));
+
+			for (size_t i = 1; i < chain->size(); i++)
+			{
+				auto & level = pMesh.levels[pMesh.levelCount++];
+				level.indices = (*chain)[i].indices.data();
+				level.indexCount = static_cast<uint32_t>((*chain)[i].indices.size());
+				level.error = (*chain)[i].error;
+			}
+
+			pMesh.storage.push_back(chain);
+		}
+
+		if (pOptions.triangles && pOptions.meshlets && view.HasStream(MeshStream::Position))
+		{
+			for (uint32_t i = 0; i < pMesh.levelCount; i++)
+			{
+				auto & level = pMesh.levels[i];
+				auto meshlets = std::make_shared<MeshletMesh>();
+				BuildMeshlets(view, level.indices, level.indexCount, *meshlets);
+
+				level.indices = meshlets->indices.data();
+				level.meshlets = meshlets.get();
+				pMesh.storage.push_back(meshlets);
+			}
+
+			pMesh.mesh.indices = pMesh.levels[0].indices;
+		}
+
+		if (view.vertexCount > 0 && view.HasStream(MeshStream::Position))
+		{
+			const auto positions = view.Stream(MeshStream::Position);
+			float minimum[3] = { positions[0], positions[1], positions[2] };
+			float maximum[3] = { positions[0], positions[1], positions[2] };
+
+			for (uint32_t i = 1; i < view.vertexCount; i++)
+			{
+				for (uint32_t j = 0; j < 3; j++)
+				{
+					minimum[j] = std::min(minimum[j], positions[i * 3 + j]);
+					maximum[j] = std::max(maximum[j], positions[i * 3 + j]);
+				}
+			}
+
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				pMesh.center[j] = (minimum[j] + maximum[j]) * 0.5f;
+			}
+		}
+	}
+
+	bool Store(AssetCache & pCache, const uint64_t pKey, const CookedMesh & pMesh)
+	{
+		CookedMeshInfo info = {};
+		info.vertexCount = pMesh.mesh.vertexCount;
+		info.levelCount = pMesh.levelCount;
+		std::copy(pMesh.center, pMesh.center + 3, info.center);
+
+		std::vector<CookedChunk> chunks;
+		chunks.push_back({ InfoChunk, &info, sizeof info });
+
+		for (uint32_t i = 0; i < MeshStreamCount; i++)
+		{
+			if (pMesh.mesh.streams[i])
+			{
+				chunks.push_back({ StreamChunk(i), pMesh.mesh.streams[i], StreamBytes(i, pMesh.mesh.vertexCount) });
+			}
+		}
+
+		for (uint32_t i = 0; i < pMesh.levelCount; i++)
+		{
+			const auto & level = pMesh.levels[i];
+
+			info.indexCounts[i] = level.indexCount;
+			info.errors[i] = level.error;
+			chunks.push_back({ IndexChunk(i), level.indices, static_cast<uint64_t>(level.indexCount) * sizeof(uint32_t) });
+
+			if (level.meshlets)
+			{
+				info.meshletCounts[i] = static_cast<uint32_t>(level.meshlets->meshlets.size());
+				chunks.push_back({ MeshletChunk(i), level.meshlets->meshlets.data(), level.meshlets->meshlets.size() * sizeof(Meshlet) });
+			}
+		}
+
+		return pCache.Store(pKey, chunks);
+	}
+
+	bool Read(const std::shared_ptr<CookedFile> & pFile, CookedMesh & pMesh)
+	{
+		uint64_t size;
+		const auto info = static_cast<const CookedMeshInfo *>(pFile->Chunk(InfoChunk, size));
+
+		if (!info || size != sizeof(CookedMeshInfo) || info->levelCount == 0 || info->levelCount > CookedMaxLevels)
+		{
+			return false;
+		}
+
+		pMesh.mesh.vertexCount = info->vertexCount;
+
+		for (uint32_t i = 0; i < MeshStreamCount; i++)
+		{
+			const auto stream = pFile->Chunk(StreamChunk(i), size);
+
+			if (stream && size != StreamBytes(i, info->vertexCount))
+			{
+				return false;
+			}
+
+			pMesh.mesh.streams[i] = static_cast<const float *>(stream);
+		}
+
+		pMesh.levelCount = info->levelCount;
+		std::copy(info->center, info->center + 3, pMesh.center);
+
+		for (uint32_t i = 0; i < pMesh.levelCount; i++)
+		{
+			auto & level = pMesh.levels[i];
+			level.indices = static_cast<const uint32_t *>(pFile->Chunk(IndexChunk(i), size));
+			level.indexCount = info->indexCounts[i];
+			level.error = info->errors[i];
+
+			if (size != static_cast<uint64_t>(level.indexCount) * sizeof(uint32_t))
+			{
+				return false;
+			}
+
+			if (info->meshletCounts[i] == 0)
+			{
+				continue;
+			}
+
+			const auto meshlets = static_cast<const Meshlet *>(pFile->Chunk(MeshletChunk(i), size));
+
+			if (!meshlets || size != info->meshletCounts[i] * sizeof(Meshlet))
+			{
+				return false;
+			}
+
+			//MeshletMesh owns its arrays, so meshlet levels are copied out of the mapping
+			auto mesh = std::make_shared<MeshletMesh>();
+			mesh->meshlets.assign(meshlets, meshlets + info->meshletCounts[i]);
+			mesh->indices.assign(level.indices, level.indices + level.indexCount);
+
+			level.indices = mesh->indices.data();
+			level.meshlets = mesh.get();
+			pMesh.storage.push_back(mesh);
+		}
+
+		pMesh.mesh.indexCount = pMesh.levels[0].indexCount;
+		pMesh.mesh.indices = pMesh.levels[0].indices;
+		pMesh.storage.push_back(pFile);
+		pMesh.cached = true;
+
+		return true;
+	}
+}
+
+bool Advanced_Rendering::CookMesh(const std::string & pFilename, const MeshCookOptions & pOptions, AssetCache * const pCache, CookedMesh & pMesh)
+{
+	pMesh = CookedMesh();
+
+	MappedFile source;
+	uint64_t key = 0;
+
+	if (pCache && source.Open(pFilename))
+	{
+		MappedFile binary;
+
+		if (!pOptions.curve)
+		{
+			binary.Open(GetBinaryMeshFilename(pFilename));
+		}
+
+		key = Key(source, binary, pOptions);
+
+		const auto file = pCache->Find(key);
+
+		if (file && Read(file, pMesh))
+		{
+			return true;
+		}
+
+		pMesh = CookedMesh();
+	}
+
+	if (!LoadSource(pFilename, pOptions, source, pMesh))
+	{
+		pMesh = CookedMesh();
+		return false;
+	}
+
+	BuildLevels(pOptions, pMesh);
+
+	//A failed store only costs the next run another cook
+	if (pCache && source.IsOpen())
+	{
+		Store(*pCache, key, pMesh);
+	}
+
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AssetCache.h"
+#include "MeshFile.h"
+#include "MeshletBuilder.h"
+
+namespace Advanced_Rendering
+{
+	// Bump whenever the parsers, optimiser, simplifier or meshlet builder change their output, so
+	// every cooked mesh misses once and is cooked again.
+	constexpr uint32_t MeshCookerVersion = 1;
+	constexpr uint32_t CookedMaxLevels = 5;
+
+	struct MeshCookOptions
+	{
+		bool curve = false;					// .cur rather than .sim
+		SimLayout layout = SimLayout::Basic;
+		bool triangles = true;				// triangle or 3 control point patch list, so it can be optimised and simplified
+		uint32_t levels = 1;				// up to CookedMaxLevels, halving the triangles each time
+		bool meshlets = false;				// split every level into meshlets and put its indices in meshlet order
+	};
+
+	struct CookedLevel
+	{
+		const uint32_t * indices = nullptr;
+		uint32_t indexCount = 0;
+		float error = 0.0f;					// in mesh units
+		const MeshletMesh * meshlets = nullptr;
+	};
+
+	// A mesh as the pool draws it. Level 0's indices are the mesh's own, the views point either
+	// into the mapped cooked file or into the buffers built on a miss, both held by storage.
+	struct CookedMesh
+	{
+		MeshView mesh;
+		uint32_t levelCount = 0;
+		CookedLevel levels[CookedMaxLevels];
+		float center[3] = {};				// of the bounds, for picking a level by distance
+		bool cached = false;				// served from the cache rather than cooked
+
+		std::vector<std::shared_ptr<const void>> storage;
+	};
+
+	// Serves pFilename cooked with pOptions from pCache, or cooks it from the source and stores
+	// the result when the cache misses. Without a cache, or when the source itself cannot be
+	// read, it cooks without storing as the app did before the cache. Returns false when the
+	// mesh could not be loaded at all, leaving pMesh empty.
+	bool CookMesh(const std::string & pFilename, const MeshCookOptions & pOptions, AssetCache * pCache, CookedMesh & pMesh);
+}
@@ -0,0 +1,176 @@
+#include "MeshFile.h"
+
+#include <cstring>
+#include <fstream>
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr uint64_t Alignment = 16;
+
+	uint64_t Align(const uint64_t pOffset)
+	{
+		return (pOffset + Alignment - 1) & ~(Alignment - 1);
+	}
+
+	uint64_t StreamBytes(const uint32_t pStream, const uint32_t pVertexCount)
+	{
+		return static_cast<uint64_t>(MeshStreamComponents[pStream]) * sizeof(float) * pVertexCount;
+	}
+
+	bool InFile(const uint64_t pOffset, const uint64_t pBytes, const size_t pFileSize)
+	{
+		return pOffset % Alignment == 0 && pOffset <= pFileSize && pBytes <= pFileSize - pOffset;
+	}
+}
+
+MeshView MeshBuffer::View() const
+{
+	MeshView view;
+	view.vertexCount = vertexCount;
+	view.indexCount = static_cast<uint32_t>(indices.size());
+	view.indices = indices.data();
+
+	for (uint32_t i = 0; i < MeshStreamCount; i++)
+	{
+		view.streams[i] = streams[i].empty() ? nullptr : streams[i].data();
+	}
+
+	return view;
+}
+
+bool MeshFile::Open(const std::string & pFilename)
+{
+	Close();
+
+	if (!mFile.Open(pFilename) || mFile.Size() < sizeof(MeshFileHeader))
+	{
+		Close();
+		return false;
+	}
+
+	MeshFileHeader header;
+	memcpy(&header, mFile.Data(), sizeof header);
+
+	if (header.magic != MeshFileMagic || header.version != MeshFileVersion)
+	{
+		Close();
+		return false;
+	}
+
+	for (uint32_t i = 0; i < MeshStreamCount; i++)
+	{
+		if (header.streamOffsets[i] == 0)
+		{
+			continue;
+		}
+
+		if (!InFile(header.streamOffsets[i], StreamBytes(i, header.vertexCount), mFile.Size()))
+		{
+			Close();
+			return false;
+		}
+
+		mView.streams[i] = reinterpret_cast<const float *>(mFile.Data() + header.streamOffsets[i]);
+	}
+
+	if (!InFile(header.indexOffset, static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t), mFile.Size()))
+	{
+		Close();
+		return false;
+	}
+
+	mView.vertexCount = header.vertexCount;
+	mView.indexCount = header.indexCount;
+	mView.indices = reinterpret_cast<const uint32_t *>(mFile.Data() + header.indexOffset);
+
+	//A corrupt or stale file must not reach the mesh passes or the GPU with indices past its vertices
+	if (!MeshIndicesInRange(mView))
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshFile::Close()
+{
+	mFile.Close();
+	mView = MeshView();
+}
+
+bool Advanced_Rendering::MeshIndicesInRange(const MeshView & pMesh)
+{
+	for (uint32_t i = 0; i < pMesh.indexCount; i++)
+	{
+		if (pMesh.indices[i] >= pMesh.vertexCount)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Advanced_Rendering::WriteMeshFile(const std::string & pFilename, const MeshView & pMesh)
+{
+	MeshFileHeader header = {};
+	header.magic = MeshFileMagic;
+	header.version = MeshFileVersion;
+	header.vertexCount = pMesh.vertexCount;
+	header.indexCount = pMesh.indexCount;
+
+	auto offset = Align(sizeof header);
+
+	for (uint32_t i = 0; i < MeshStreamCount; i++)
+	{
+		if (pMesh.streams[i])
+		{
+			header.streamOffsets[i] = offset;
+			offset = Align(offset + StreamBytes(i, pMesh.vertexCount));
+		}
+	}
+
+	header.indexOffset = offset;
+
+	std::ofstream myfile(pFilename, std::ios::binary | std::ios::trunc);
+
+	if (!myfile)
+	{
+		return false;
+	}
+
+	const char padding[Alignment] = {};
+
+	myfile.write(reinterpret_cast<const char *>(&header), sizeof header);
+
+	for (uint32_t i = 0; i < MeshStreamCount; i++)
+	{
+		if (!pMesh.streams[i])
+		{
+			continue;
+		}
+
+		myfile.write(padding, header.streamOffsets[i] - static_cast<uint64_t>(myfile.tellp()));
+		myfile.write(reinterpret_cast<const char *>(pMesh.streams[i]), StreamBytes(i, pMesh.vertexCount));
+	}
+
+	myfile.write(padding, header.indexOffset - static_cast<uint64_t>(myfile.tellp()));
+	myfile.write(reinterpret_cast<const char *>(pMesh.indices), static_cast<std::streamsize>(pMesh.indexCount) * sizeof(uint32_t));
+
+	return static_cast<bool>(myfile);
+}
+
+std::string Advanced_Rendering::GetBinaryMeshFilename(const std::string & pFilename)
+{
+	const auto extension = pFilename.find_last_of('.');
+
+	if (extension == std::string::npos)
+	{
+		return pFilename + ".simb";
+	}
+
+	return pFilename.substr(0, extension) + ".simb";
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+namespace Advanced_Rendering
+{
+	// Vertex streams a mesh can carry. Each stream is tightly packed floats, so the data can go
+	// straight into the per-stream vertex buffers the models bind.
+	enum class MeshStream : uint32_t
+	{
+		Position,
+		Normal,
+		TexCoord,
+		Tangent,
+		BiTangent,
+		Count
+	};
+
+	constexpr uint32_t MeshStreamCount = static_cast<uint32_t>(MeshStream::Count);
+	constexpr uint32_t MeshStreamComponents[MeshStreamCount] = { 3, 3, 2, 3, 3 };
+
+	// Vertex layouts of the text .sim files.
+	enum class SimLayout
+	{
+		Basic,		// position, uv, normal
+		Tangent		// position, uv, normal, tangent, bitangent
+	};
+
+	// Non-owning view of mesh data, either from a MeshBuffer or a mapped MeshFile.
+	struct MeshView
+	{
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+		const float * streams[MeshStreamCount] = {};
+		const uint32_t * indices = nullptr;
+
+		const float * Stream(const MeshStream pStream) const
+		{
+			return streams[static_cast<uint32_t>(pStream)];
+		}
+
+		bool HasStream(const MeshStream pStream) const
+		{
+			return Stream(pStream) != nullptr;
+		}
+	};
+
+	// Mesh data owned in system memory, used when parsing text files.
+	struct MeshBuffer
+	{
+		uint32_t vertexCount = 0;
+		std::vector<float> streams[MeshStreamCount];
+		std::vector<uint32_t> indices;
+
+		std::vector<float> & Stream(const MeshStream pStream)
+		{
+			return streams[static_cast<uint32_t>(pStream)];
+		}
+
+		MeshView View() const;
+	};
+
+	// Binary .simb file layout. All offsets are from the start of the file and 16 byte aligned.
+	// A stream offset of zero means the stream is not present.
+	struct MeshFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint64_t streamOffsets[MeshStreamCount];
+		uint64_t indexOffset;
+	};
+
+	constexpr uint32_t MeshFileMagic = 0x424D4953; // "SIMB"
+	constexpr uint32_t MeshFileVersion = 1;
+
+	// Read-only .simb file. The view points directly into the mapped file.
+	class MeshFile
+	{
+		MappedFile mFile;
+		MeshView mView;
+
+	public:
+		MeshFile() = default;
+		~MeshFile() = default;
+
+		MeshFile(const MeshFile &) = delete;
+		MeshFile(MeshFile &&) = delete;
+		MeshFile & operator= (const MeshFile &) = delete;
+		MeshFile & operator= (MeshFile &&) = delete;
+
+		bool Open(const std::string & pFilename);
+		void Close();
+
+		const MeshView & View() const
+		{
+			return mView;
+		}
+	};
+
+	bool WriteMeshFile(const std::string & pFilename, const MeshView & pMesh);
+
+	// Whether every index names a vertex of the mesh
+	bool MeshIndicesInRange(const MeshView & pMesh);
+
+	// "rock.sim" -> "rock.simb"
+	std::string GetBinaryMeshFilename(const std::string & pFilename);
+}
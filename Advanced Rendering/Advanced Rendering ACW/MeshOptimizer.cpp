@@ -0,0 +1,561 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	//Forsyth scores against a larger LRU cache than the FIFO it is measured with, which keeps
+	//the greedy choice from thrashing at the FIFO's edge
+	constexpr uint32_t ScoreCacheSize = 32;
+	constexpr uint32_t MaxValenceScore = 32;
+	constexpr uint32_t InvalidTriangle = ~0u;
+
+	struct ScoreTables
+	{
+		float cache[ScoreCacheSize];
+		float valence[MaxValenceScore];
+
+		ScoreTables()
+		{
+			for (uint32_t i = 0; i < ScoreCacheSize; i++)
+			{
+				//The last triangle's three vertices score the same, whichever order they went in
+				cache[i] = i < 3 ? 0.75f : powf(1.0f - (i - 3) / static_cast<float>(ScoreCacheSize - 3), 1.5f);
+			}
+
+			valence[0] = 0.0f;
+
+			for (uint32_t i = 1; i < MaxValenceScore; i++)
+			{
+				//Boost vertices with few triangles left so lone triangles are not stranded
+				valence[i] = 2.0f / sqrtf(static_cast<float>(i));
+			}
+		}
+	};
+
+	float VertexScore(const ScoreTables & pTables, const int pCachePosition, const uint32_t pRemaining)
+	{
+		if (pRemaining == 0)
+		{
+			return 0.0f;
+		}
+
+		const auto cache = pCachePosition < 0 ? 0.0f : pTables.cache[pCachePosition];
+		const auto valence = pTables.valence[std::min(pRemaining, MaxValenceScore - 1)];
+
+		return cache + valence;
+	}
+
+	struct Vector
+	{
+		double x, y, z;
+
+		Vector operator+ (const Vector & pOther) const { return { x + pOther.x, y + pOther.y, z + pOther.z }; }
+		Vector operator- (const Vector & pOther) const { return { x - pOther.x, y - pOther.y, z - pOther.z }; }
+		Vector operator* (const double pScale) const { return { x * pScale, y * pScale, z * pScale }; }
+
+		double Dot(const Vector & pOther) const { return x * pOther.x + y * pOther.y + z * pOther.z; }
+
+		Vector Cross(const Vector & pOther) const
+		{
+			return { y * pOther.z - z * pOther.y, z * pOther.x - x * pOther.z, x * pOther.y - y * pOther.x };
+		}
+	};
+
+	Vector Position(const float * pPositions, const uint32_t pVertex)
+	{
+		return { pPositions[pVertex * 3], pPositions[pVertex * 3 + 1], pPositions[pVertex * 3 + 2] };
+	}
+
+	// FIFO cache simulated with timestamps, a vertex is cached if it was transformed within the
+	// last pCacheSize misses.
+	class FifoCache
+	{
+		std::vector<uint32_t> mTimestamps;
+		uint32_t mTime;
+		uint32_t mSize;
+
+	public:
+		FifoCache(const uint32_t pVertexCount, const uint32_t pCacheSize) :
+			mTimestamps(pVertexCount, 0), mTime(pCacheSize + 1), mSize(pCacheSize)
+		{
+		}
+
+		uint32_t Triangle(const uint32_t * pTriangle)
+		{
+			uint32_t misses = 0;
+
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				if (mTime - mTimestamps[pTriangle[i]] > mSize)
+				{
+					mTimestamps[pTriangle[i]] = mTime++;
+					misses++;
+				}
+			}
+
+			return misses;
+		}
+
+		void Flush()
+		{
+			mTime += mSize + 1;
+		}
+	};
+
+	// Hashes and compares a vertex across every stream the mesh has, bit for bit.
+	class VertexKey
+	{
+		const MeshBuffer & mMesh;
+
+	public:
+		explicit VertexKey(const MeshBuffer & pMesh) : mMesh(pMesh)
+		{
+		}
+
+		size_t operator() (const uint32_t pVertex) const
+		{
+			uint32_t hash = 2166136261u;
+
+			for (uint32_t i = 0; i < MeshStreamCount; i++)
+			{
+				if (mMesh.streams[i].empty())
+				{
+					continue;
+				}
+
+				const auto components = MeshStreamComponents[i];
+				const auto data = &mMesh.streams[i][static_cast<size_t>(pVertex) * components];
+
+				for (uint32_t j = 0; j < components; j++)
+				{
+					uint32_t bits;
+					memcpy(&bits, &data[j], sizeof bits);
+					hash = (hash ^ bits) * 16777619u;
+				}
+			}
+
+			return hash;
+		}
+
+		bool operator() (const uint32_t pLeft, const uint32_t pRight) const
+		{
+			for (uint32_t i = 0; i < MeshStreamCount; i++)
+			{
+				if (mMesh.streams[i].empty())
+				{
+					continue;
+				}
+
+				const auto components = MeshStreamComponents[i];
+
+				if (memcmp(&mMesh.streams[i][static_cast<size_t>(pLeft) * components], &mMesh.streams[i][static_cast<size_t>(pRight) * components], components * sizeof(float)) != 0)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+	};
+}
+
+bool Advanced_Rendering::IsTriangleList(const MeshView & pMesh)
+{
+	return pMesh.indexCount % 3 == 0 && MeshIndicesInRange(pMesh);
+}
+
+void Advanced_Rendering::WeldVertices(MeshBuffer & pMesh)
+{
+	const VertexKey key(pMesh);
+	std::unordered_map<uint32_t, uint32_t, VertexKey, VertexKey> unique(pMesh.vertexCount, key, key);
+
+	//Point every index at the first vertex with the same data, OptimizeVertexFetch then drops
+	//the duplicates no index refers to any more
+	for (auto & index : pMesh.indices)
+	{
+		index = unique.emplace(index, index).first->second;
+	}
+}
+
+VertexCacheStats Advanced_Rendering::AnalyzeVertexCache(const uint32_t * pIndices, const uint32_t pIndexCount, const uint32_t pVertexCount, const uint32_t pCacheSize)
+{
+	VertexCacheStats stats;
+	const auto triangleCount = pIndexCount / 3;
+
+	if (triangleCount == 0)
+	{
+		return stats;
+	}
+
+	FifoCache cache(pVertexCount, pCacheSize);
+	std::vector<bool> referenced(pVertexCount, false);
+	uint32_t referencedCount = 0;
+
+	for (uint32_t i = 0; i < triangleCount * 3; i += 3)
+	{
+		stats.transformed += cache.Triangle(pIndices + i);
+
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			if (!referenced[pIndices[i + j]])
+			{
+				referenced[pIndices[i + j]] = true;
+				referencedCount++;
+			}
+		}
+	}
+
+	stats.acmr = static_cast<float>(stats.transformed) / triangleCount;
+	stats.atvr = static_cast<float>(stats.transformed) / referencedCount;
+
+	return stats;
+}
+
+void Advanced_Rendering::OptimizeVertexCache(uint32_t * pIndices, const uint32_t pIndexCount, const uint32_t pVertexCount)
+{
+	static const ScoreTables tables;
+
+	const auto triangleCount = pIndexCount / 3;
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	//Triangles using each vertex; the first remaining[v] entries of a vertex's range are the
+	//triangles still to be emitted
+	std::vector<uint32_t> offsets(pVertexCount + 1, 0);
+	std::vector<uint32_t> remaining(pVertexCount, 0);
+
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[pIndices[i]]++;
+	}
+
+	for (uint32_t i = 0; i < pVertexCount; i++)
+	{
+		offsets[i + 1] = offsets[i] + remaining[i];
+		remaining[i] = 0;
+	}
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			const auto vertex = pIndices[i * 3 + j];
+			adjacency[offsets[vertex] + remaining[vertex]++] = i;
+		}
+	}
+
+	std::vector<float> vertexScores(pVertexCount);
+	std::vector<float> triangleScores(triangleCount, 0.0f);
+	std::vector<bool> emitted(triangleCount, false);
+
+	for (uint32_t i = 0; i < pVertexCount; i++)
+	{
+		vertexScores[i] = VertexScore(tables, -1, remaining[i]);
+	}
+
+	auto best = 0u;
+
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		triangleScores[i] = vertexScores[pIndices[i * 3]] + vertexScores[pIndices[i * 3 + 1]] + vertexScores[pIndices[i * 3 + 2]];
+
+		if (triangleScores[i] > triangleScores[best])
+		{
+			best = i;
+		}
+	}
+
+	const std::vector<uint32_t> input(pIndices, pIndices + triangleCount * 3);
+
+	uint32_t cache[ScoreCacheSize + 3];
+	uint32_t cacheSize = 0;
+	uint32_t cursor = 0;
+
+	for (uint32_t output = 0; output < triangleCount; output++)
+	{
+		//Nothing adjacent to the cache is left, restart from the first triangle not yet emitted
+		if (best == InvalidTriangle)
+		{
+			while (emitted[cursor])
+			{
+				cursor++;
+			}
+
+			best = cursor;
+		}
+
+		const auto triangle = &input[best * 3];
+
+		pIndices[output * 3] = triangle[0];
+		pIndices[output * 3 + 1] = triangle[1];
+		pIndices[output * 3 + 2] = triangle[2];
+		emitted[best] = true;
+
+		//Take the triangle out of its vertices' remaining lists
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			const auto vertex = triangle[i];
+			const auto begin = adjacency.begin() + offsets[vertex];
+			const auto end = begin + remaining[vertex];
+
+			std::iter_swap(std::find(begin, end, best), end - 1);
+			remaining[vertex]--;
+		}
+
+		//The emitted triangle's vertices move to the front, everything else shifts back
+		uint32_t newCache[ScoreCacheSize + 3];
+		uint32_t newCacheSize = 0;
+
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			if (std::find(newCache, newCache + newCacheSize, triangle[i]) == newCache + newCacheSize)
+			{
+				newCache[newCacheSize++] = triangle[i];
+			}
+		}
+
+		for (uint32_t i = 0; i < cacheSize; i++)
+		{
+			const auto vertex = cache[i];
+
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+			{
+				newCache[newCacheSize++] = vertex;
+			}
+		}
+
+		//Rescore every vertex whose position changed, including those pushed out, and carry the
+		//change through to their remaining triangles
+		for (uint32_t i = 0; i < newCacheSize; i++)
+		{
+			const auto vertex = newCache[i];
+			const auto score = VertexScore(tables, i < ScoreCacheSize ? static_cast<int>(i) : -1, remaining[vertex]);
+			const auto delta = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+
+			for (auto j = offsets[vertex]; j < offsets[vertex] + remaining[vertex]; j++)
+			{
+				triangleScores[adjacency[j]] += delta;
+			}
+		}
+
+		cacheSize = std::min(newCacheSize, ScoreCacheSize);
+		std::copy(newCache, newCache + cacheSize, cache);
+
+		//The next triangle is the best one touching the cache
+		best = InvalidTriangle;
+		auto bestScore = 0.0f;
+
+		for (uint32_t i = 0; i < cacheSize; i++)
+		{
+			const auto vertex = cache[i];
+
+			for (auto j = offsets[vertex]; j < offsets[vertex] + remaining[vertex]; j++)
+			{
+				if (triangleScores[adjacency[j]] > bestScore)
+				{
+					best = adjacency[j];
+					bestScore = triangleScores[adjacency[j]];
+				}
+			}
+		}
+	}
+}
+
+void Advanced_Rendering::OptimizeOverdraw(uint32_t * pIndices, const uint32_t pIndexCount, const float * pPositions, const uint32_t pVertexCount, const float pThreshold)
+{
+	const auto triangleCount = pIndexCount / 3;
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	//Hard boundaries are where the cache order already restarts, every vertex missing
+	FifoCache cache(pVertexCount, VertexCacheSize);
+	std::vector<uint32_t> hardClusters(1, 0);
+	uint32_t misses = 0;
+
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		const auto triangleMisses = cache.Triangle(pIndices + i * 3);
+
+		if (i > 0 && triangleMisses == 3)
+		{
+			hardClusters.push_back(i);
+		}
+
+		misses += triangleMisses;
+	}
+
+	hardClusters.push_back(triangleCount);
+
+	//Soft boundaries split a hard cluster wherever its ACMR so far is within the threshold of
+	//the mesh's, so a cold cache at the split costs no more than the threshold allows
+	const auto targetAcmr = pThreshold * misses / triangleCount;
+	std::vector<uint32_t> clusters;
+
+	for (size_t i = 0; i + 1 < hardClusters.size(); i++)
+	{
+		const auto end = hardClusters[i + 1];
+		auto start = hardClusters[i];
+		uint32_t clusterMisses = 0;
+
+		clusters.push_back(start);
+		cache.Flush();
+
+		for (auto j = start; j < end; j++)
+		{
+			clusterMisses += cache.Triangle(pIndices + j * 3);
+
+			if (j + 1 < end && clusterMisses <= targetAcmr * (j + 1 - start))
+			{
+				start = j + 1;
+				clusterMisses = 0;
+
+				clusters.push_back(start);
+				cache.Flush();
+			}
+		}
+	}
+
+	clusters.push_back(triangleCount);
+
+	//Area weighted centroid and normal of each cluster
+	const auto clusterCount = static_cast<uint32_t>(clusters.size() - 1);
+	std::vector<Vector> centroids(clusterCount, Vector{ 0.0, 0.0, 0.0 });
+	std::vector<Vector> normals(clusterCount, Vector{ 0.0, 0.0, 0.0 });
+	std::vector<double> areas(clusterCount, 0.0);
+
+	Vector meshCentroid = { 0.0, 0.0, 0.0 };
+	auto meshArea = 0.0;
+
+	for (uint32_t i = 0; i < clusterCount; i++)
+	{
+		for (auto j = clusters[i]; j < clusters[i + 1]; j++)
+		{
+			const auto a = Position(pPositions, pIndices[j * 3]);
+			const auto b = Position(pPositions, pIndices[j * 3 + 1]);
+			const auto c = Position(pPositions, pIndices[j * 3 + 2]);
+
+			const auto normal = (b - a).Cross(c - a);
+			const auto area = sqrt(normal.Dot(normal));
+
+			centroids[i] = centroids[i] + (a + b + c) * (area / 3.0);
+			normals[i] = normals[i] + normal;
+			areas[i] += area;
+		}
+
+		meshCentroid = meshCentroid + centroids[i];
+		meshArea += areas[i];
+
+		if (areas[i] > 0.0)
+		{
+			centroids[i] = centroids[i] * (1.0 / areas[i]);
+		}
+	}
+
+	if (meshArea > 0.0)
+	{
+		meshCentroid = meshCentroid * (1.0 / meshArea);
+	}
+
+	//Clusters facing away from the centre are the likely occluders, draw them first
+	std::vector<double> keys(clusterCount);
+	std::vector<uint32_t> order(clusterCount);
+
+	for (uint32_t i = 0; i < clusterCount; i++)
+	{
+		const auto length = sqrt(normals[i].Dot(normals[i]));
+		keys[i] = length > 0.0 ? (centroids[i] - meshCentroid).Dot(normals[i]) / length : 0.0;
+		order[i] = i;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&keys](const uint32_t pLeft, const uint32_t pRight)
+	{
+		return keys[pLeft] > keys[pRight];
+	});
+
+	const std::vector<uint32_t> input(pIndices, pIndices + triangleCount * 3);
+	auto output = pIndices;
+
+	for (const auto cluster : order)
+	{
+		output = std::copy(input.begin() + clusters[cluster] * 3, input.begin() + clusters[cluster + 1] * 3, output);
+	}
+}
+
+void Advanced_Rendering::OptimizeVertexFetch(MeshBuffer & pMesh)
+{
+	const auto unused = ~0u;
+	std::vector<uint32_t> remap(pMesh.vertexCount, unused);
+	uint32_t vertexCount = 0;
+
+	for (auto & index : pMesh.indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = vertexCount++;
+		}
+
+		index = remap[index];
+	}
+
+	for (uint32_t i = 0; i < MeshStreamCount; i++)
+	{
+		auto & stream = pMesh.streams[i];
+
+		if (stream.empty())
+		{
+			continue;
+		}
+
+		const auto components = MeshStreamComponents[i];
+		std::vector<float> reordered(static_cast<size_t>(vertexCount) * components);
+
+		for (uint32_t j = 0; j < pMesh.vertexCount; j++)
+		{
+			if (remap[j] != unused)
+			{
+				std::copy_n(stream.begin() + static_cast<size_t>(j) * components, components, reordered.begin() + static_cast<size_t>(remap[j]) * components);
+			}
+		}
+
+		stream.swap(reordered);
+	}
+
+	pMesh.vertexCount = vertexCount;
+}
+
+bool Advanced_Rendering::OptimizeMesh(MeshBuffer & pMesh)
+{
+	if (!IsTriangleList(pMesh.View()))
+	{
+		return false;
+	}
+
+	const auto indexCount = static_cast<uint32_t>(pMesh.indices.size());
+
+	WeldVertices(pMesh);
+	OptimizeVertexCache(pMesh.indices.data(), indexCount, pMesh.vertexCount);
+
+	if (!pMesh.Stream(MeshStream::Position).empty())
+	{
+		OptimizeOverdraw(pMesh.indices.data(), indexCount, pMesh.Stream(MeshStream::Position).data(), pMesh.vertexCount);
+	}
+
+	OptimizeVertexFetch(pMesh);
+	return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include "MeshFile.h"
+
+namespace Advanced_Rendering
+{
+	// Post-transform cache size the stats are simulated with, a FIFO like most hardware.
+	constexpr uint32_t VertexCacheSize = 16;
+
+	struct VertexCacheStats
+	{
+		uint32_t transformed = 0;	// vertex shader (or hull/domain control point) invocations
+		float acmr = 0.0f;			// transformed vertices per triangle, 0.5 at best, 3 at worst
+		float atvr = 0.0f;			// transformed vertices per referenced vertex, 1 at best
+	};
+
+	// Whether the mesh is whole triangles (or 3 control point patches) of its own vertices. The passes
+	// here, the simplifier and the meshlet builder index the vertex data unchecked, so a mesh from a
+	// file is validated once before the first of them.
+	bool IsTriangleList(const MeshView & pMesh);
+
+	// Simulates a FIFO cache over a triangle (or 3 control point patch) index list.
+	VertexCacheStats AnalyzeVertexCache(const uint32_t * pIndices, uint32_t pIndexCount, uint32_t pVertexCount, uint32_t pCacheSize = VertexCacheSize);
+
+	// Merges vertices whose streams are all bit-identical, the text exporters write one vertex per
+	// face corner so a shared corner is otherwise transformed once per face.
+	void WeldVertices(MeshBuffer & pMesh);
+
+	// Reorders triangles for post-transform cache reuse, Forsyth's linear-speed greedy method.
+	void OptimizeVertexCache(uint32_t * pIndices, uint32_t pIndexCount, uint32_t pVertexCount);
+
+	// Reorders clusters of an already cache optimised list so outward facing clusters draw first,
+	// as in Sander et al.'s "Fast Triangle Reordering". Clusters are only split where that costs
+	// less than pThreshold times the current ACMR.
+	void OptimizeOverdraw(uint32_t * pIndices, uint32_t pIndexCount, const float * pPositions, uint32_t pVertexCount, float pThreshold = 1.05f);
+
+	// Renumbers vertices in first-use order so fetches walk the streams forwards. Vertices no
+	// index refers to are dropped.
+	void OptimizeVertexFetch(MeshBuffer & pMesh);
+
+	// Welds, then the three ordering passes in order. Fails, leaving the mesh as it was, unless it is
+	// a triangle or 3 control point patch list.
+	bool OptimizeMesh(MeshBuffer & pMesh);
+}
@@ -0,0 +1,549 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr uint32_t NoVertex = ~0u;
+	constexpr double BorderWeight = 10.0;
+
+	enum class VertexKind : uint8_t
+	{
+		Manifold,	// moves onto any neighbour
+		Border,		// moves along its open border only
+		Locked		// seam or non-manifold, never moves
+	};
+
+	struct Vector
+	{
+		double x, y, z;
+
+		Vector operator+ (const Vector & pOther) const { return { x + pOther.x, y + pOther.y, z + pOther.z }; }
+		Vector operator- (const Vector & pOther) const { return { x - pOther.x, y - pOther.y, z - pOther.z }; }
+		Vector operator* (const double pScale) const { return { x * pScale, y * pScale, z * pScale }; }
+
+		double Dot(const Vector & pOther) const { return x * pOther.x + y * pOther.y + z * pOther.z; }
+		double Length() const { return sqrt(Dot(*this)); }
+
+		Vector Cross(const Vector & pOther) const
+		{
+			return { y * pOther.z - z * pOther.y, z * pOther.x - x * pOther.z, x * pOther.y - y * pOther.x };
+		}
+	};
+
+	// Sum of weighted squared distances to a set of planes, Q(p) = pAp + 2bp + c.
+	struct Quadric
+	{
+		double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0, c = 0.0;
+		double weight = 0.0;
+
+		void AddPlane(const Vector & pNormal, const double pDistance, const double pWeight)
+		{
+			a00 += pWeight * pNormal.x * pNormal.x;
+			a11 += pWeight * pNormal.y * pNormal.y;
+			a22 += pWeight * pNormal.z * pNormal.z;
+			a01 += pWeight * pNormal.x * pNormal.y;
+			a02 += pWeight * pNormal.x * pNormal.z;
+			a12 += pWeight * pNormal.y * pNormal.z;
+			b0 += pWeight * pNormal.x * pDistance;
+			b1 += pWeight * pNormal.y * pDistance;
+			b2 += pWeight * pNormal.z * pDistance;
+			c += pWeight * pDistance * pDistance;
+			weight += pWeight;
+		}
+
+		void Add(const Quadric & pOther)
+		{
+			a00 += pOther.a00; a11 += pOther.a11; a22 += pOther.a22;
+			a01 += pOther.a01; a02 += pOther.a02; a12 += pOther.a12;
+			b0 += pOther.b0; b1 += pOther.b1; b2 += pOther.b2;
+			c += pOther.c;
+			weight += pOther.weight;
+		}
+
+		double Evaluate(const Vector & pPoint) const
+		{
+			const auto & p = pPoint;
+			const auto result = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+				+ 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+				+ 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+
+			return std::max(result, 0.0);
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double cost;	// mean squared distance
+	};
+
+	uint64_t EdgeKey(const uint32_t pFrom, const uint32_t pTo)
+	{
+		return static_cast<uint64_t>(pFrom) << 32 | pTo;
+	}
+
+	// Maps every vertex to the first vertex with the same position, bit for bit.
+	std::vector<uint32_t> PositionGroups(const float * pPositions, const uint32_t pVertexCount)
+	{
+		struct Hash
+		{
+			const float * positions;
+
+			size_t operator() (const uint32_t pVertex) const
+			{
+				uint32_t bits[3];
+				memcpy(bits, positions + pVertex * 3, sizeof bits);
+				return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			}
+
+			bool operator() (const uint32_t pLeft, const uint32_t pRight) const
+			{
+				return memcmp(positions + pLeft * 3, positions + pRight * 3, sizeof(float) * 3) == 0;
+			}
+		};
+
+		const Hash hash = { pPositions };
+		std::unordered_map<uint32_t, uint32_t, Hash, Hash> groups(pVertexCount, hash, hash);
+		std::vector<uint32_t> result(pVertexCount);
+
+		for (uint32_t i = 0; i < pVertexCount; i++)
+		{
+			result[i] = groups.emplace(i, i).first->second;
+		}
+
+		return result;
+	}
+
+	class Simplifier
+	{
+		const MeshView & mMesh;
+		std::vector<uint32_t> mGroups;
+		std::vector<VertexKind> mKinds;
+		std::vector<uint32_t> mBorderNext;
+		std::vector<uint32_t> mBorderPrevious;
+		std::vector<Quadric> mQuadrics;
+
+		Vector Position(const uint32_t pVertex) const
+		{
+			const auto position = mMesh.Stream(MeshStream::Position) + pVertex * 3;
+			return { position[0], position[1], position[2] };
+		}
+
+		void Classify(const uint32_t * pIndices, const uint32_t pIndexCount)
+		{
+			const auto vertexCount = mMesh.vertexCount;
+
+			std::vector<uint32_t> groupSizes(vertexCount, 0);
+
+			for (uint32_t i = 0; i < vertexCount; i++)
+			{
+				groupSizes[mGroups[i]]++;
+			}
+
+			//Half-edges between position groups, so a seam does not look like a border
+			std::unordered_set<uint64_t> edges;
+
+			for (uint32_t i = 0; i + 2 < pIndexCount; i += 3)
+			{
+				for (uint32_t j = 0; j < 3; j++)
+				{
+					edges.insert(EdgeKey(mGroups[pIndices[i + j]], mGroups[pIndices[i + (j + 1) % 3]]));
+				}
+			}
+
+			mKinds.assign(vertexCount, VertexKind::Manifold);
+			mBorderNext.assign(vertexCount, NoVertex);
+			mBorderPrevious.assign(vertexCount, NoVertex);
+
+			std::vector<uint32_t> borderEdges(vertexCount, 0);
+
+			for (uint32_t i = 0; i + 2 < pIndexCount; i += 3)
+			{
+				for (uint32_t j = 0; j < 3; j++)
+				{
+					const auto from = mGroups[pIndices[i + j]];
+					const auto to = mGroups[pIndices[i + (j + 1) % 3]];
+
+					if (edges.count(EdgeKey(to, from)) == 0)
+					{
+						mBorderNext[from] = to;
+						mBorderPrevious[to] = from;
+						borderEdges[from]++;
+						borderEdges[to]++;
+					}
+				}
+			}
+
+			for (uint32_t i = 0; i < vertexCount; i++)
+			{
+				const auto group = mGroups[i];
+
+				if (groupSizes[group] > 1)
+				{
+					mKinds[i] = VertexKind::Locked;
+				}
+				else if (borderEdges[group] == 2 && mBorderNext[group] != NoVertex && mBorderPrevious[group] != NoVertex)
+				{
+					mKinds[i] = VertexKind::Border;
+				}
+				else if (borderEdges[group] != 0)
+				{
+					mKinds[i] = VertexKind::Locked;
+				}
+			}
+		}
+
+		void BuildQuadrics(const uint32_t * pIndices, const uint32_t pIndexCount)
+		{
+			mQuadrics.assign(mMesh.vertexCount, Quadric());
+
+			for (uint32_t i = 0; i + 2 < pIndexCount; i += 3)
+			{
+				const uint32_t triangle[3] = { pIndices[i], pIndices[i + 1], pIndices[i + 2] };
+				const Vector corners[3] = { Position(triangle[0]), Position(triangle[1]), Position(triangle[2]) };
+
+				const auto cross = (corners[1] - corners[0]).Cross(corners[2] - corners[0]);
+				const auto area = cross.Length();
+
+				if (area <= 0.0)
+				{
+					continue;
+				}
+
+				const auto normal = cross * (1.0 / area);
+
+				Quadric plane;
+				plane.AddPlane(normal, -normal.Dot(corners[0]), area);
+
+				for (uint32_t j = 0; j < 3; j++)
+				{
+					mQuadrics[mGroups[triangle[j]]].Add(plane);
+				}
+
+				//Open edges get a plane at right angles to the triangle to hold the border in place
+				for (uint32_t j = 0; j < 3; j++)
+				{
+					const auto from = mGroups[triangle[j]];
+					const auto to = mGroups[triangle[(j + 1) % 3]];
+
+					if (mBorderNext[from] != to)
+					{
+						continue;
+					}
+
+					const auto edge = corners[(j + 1) % 3] - corners[j];
+					const auto length = edge.Length();
+
+					if (length <= 0.0)
+					{
+						continue;
+					}
+
+					const auto borderNormal = edge.Cross(normal) * (1.0 / length);
+
+					Quadric border;
+					border.AddPlane(borderNormal, -borderNormal.Dot(corners[j]), length * length * BorderWeight);
+
+					mQuadrics[from].Add(border);
+					mQuadrics[to].Add(border);
+				}
+			}
+		}
+
+		bool CanCollapse(const uint32_t pFrom, const uint32_t pTo) const
+		{
+			const auto from = mGroups[pFrom];
+			const auto to = mGroups[pTo];
+
+			if (from == to)
+			{
+				return false;
+			}
+
+			switch (mKinds[pFrom])
+			{
+			case VertexKind::Manifold:
+				return true;
+			case VertexKind::Border:
+				return mBorderNext[from] == to || mBorderPrevious[from] == to;
+			default:
+				return false;
+			}
+		}
+
+		double Cost(const uint32_t pFrom, const uint32_t pTo) const
+		{
+			Quadric quadric = mQuadrics[mGroups[pFrom]];
+			quadric.Add(mQuadrics[mGroups[pTo]]);
+
+			return quadric.weight > 0.0 ? quadric.Evaluate(Position(pTo)) / quadric.weight : 0.0;
+		}
+
+		//Moving pFrom onto pTo must not turn any surviving triangle around it over
+		bool Flips(const std::vector<uint32_t> & pIndices, const uint32_t * pTriangles, const uint32_t pCount, const uint32_t pFrom, const uint32_t pTo) const
+		{
+			const auto target = Position(pTo);
+
+			for (uint32_t i = 0; i < pCount; i++)
+			{
+				const auto triangle = &pIndices[pTriangles[i] * 3];
+
+				if (mGroups[triangle[0]] == mGroups[pTo] || mGroups[triangle[1]] == mGroups[pTo] || mGroups[triangle[2]] == mGroups[pTo])
+				{
+					continue;
+				}
+
+				Vector before[3];
+				Vector after[3];
+
+				for (uint32_t j = 0; j < 3; j++)
+				{
+					before[j] = Position(triangle[j]);
+					after[j] = triangle[j] == pFrom ? target : before[j];
+				}
+
+				const auto normalBefore = (before[1] - before[0]).Cross(before[2] - before[0]);
+				const auto normalAfter = (after[1] - after[0]).Cross(after[2] - after[0]);
+
+				if (normalBefore.Dot(normalAfter) <= 0.0)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+	public:
+		Simplifier(const MeshView & pMesh, const uint32_t * pIndices, const uint32_t pIndexCount) :
+			mMesh(pMesh), mGroups(PositionGroups(pMesh.Stream(MeshStream::Position), pMesh.vertexCount))
+		{
+			Classify(pIndices, pIndexCount);
+			BuildQuadrics(pIndices, pIndexCount);
+		}
+
+		MeshLod Simplify(const uint32_t * pIndices, const uint32_t pIndexCount, const uint32_t pTargetIndexCount, const float pMaxError)
+		{
+			MeshLod lod;
+			lod.indices.assign(pIndices, pIndices + pIndexCount - pIndexCount % 3);
+
+			const auto vertexCount = mMesh.vertexCount;
+			const auto maxCost = static_cast<double>(pMaxError) * pMaxError;
+			auto worstCost = 0.0;
+
+			std::vector<uint32_t> offsets(vertexCount + 1);
+			std::vector<uint32_t> triangles;
+			std::vector<Collapse> collapses;
+			std::vector<uint32_t> remap(vertexCount);
+			std::vector<bool> touched(vertexCount);
+
+			//Each pass collapses the cheapest edges that do not share a neighbourhood, then
+			//rebuilds the index list; most passes remove around a fifth of the triangles
+			while (lod.indices.size() > pTargetIndexCount)
+			{
+				const auto triangleCount = static_cast<uint32_t>(lod.indices.size() / 3);
+
+				std::fill(offsets.begin(), offsets.end(), 0);
+
+				for (const auto index : lod.indices)
+				{
+					offsets[index + 1]++;
+				}
+
+				for (uint32_t i = 0; i < vertexCount; i++)
+				{
+					offsets[i + 1] += offsets[i];
+				}
+
+				triangles.resize(lod.indices.size());
+				std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+
+				for (uint32_t i = 0; i < lod.indices.size(); i++)
+				{
+					triangles[fill[lod.indices[i]]++] = i / 3;
+				}
+
+				collapses.clear();
+
+				for (uint32_t i = 0; i < triangleCount; i++)
+				{
+					for (uint32_t j = 0; j < 3; j++)
+					{
+						const auto a = lod.indices[i * 3 + j];
+						const auto b = lod.indices[i * 3 + (j + 1) % 3];
+
+						if (CanCollapse(a, b))
+						{
+							collapses.push_back({ a, b, Cost(a, b) });
+						}
+
+						if (CanCollapse(b, a))
+						{
+							collapses.push_back({ b, a, Cost(b, a) });
+						}
+					}
+				}
+
+				std::sort(collapses.begin(), collapses.end(), [](const Collapse & pLeft, const Collapse & pRight)
+				{
+					return pLeft.cost < pRight.cost;
+				});
+
+				for (uint32_t i = 0; i < vertexCount; i++)
+				{
+					remap[i] = i;
+				}
+
+				std::fill(touched.begin(), touched.end(), false);
+
+				const auto trianglesToRemove = (triangleCount * 3 - pTargetIndexCount) / 3;
+				uint32_t removed = 0;
+				uint32_t applied = 0;
+
+				for (const auto & collapse : collapses)
+				{
+					if (collapse.cost > maxCost || removed >= trianglesToRemove)
+					{
+						break;
+					}
+
+					if (touched[collapse.from] || touched[collapse.to])
+					{
+						continue;
+					}
+
+					const auto first = &triangles[offsets[collapse.from]];
+					const auto count = offsets[collapse.from + 1] - offsets[collapse.from];
+
+					if (Flips(lod.indices, first, count, collapse.from, collapse.to))
+					{
+						continue;
+					}
+
+					remap[collapse.from] = collapse.to;
+					mQuadrics[mGroups[collapse.to]].Add(mQuadrics[mGroups[collapse.from]]);
+					worstCost = std::max(worstCost, collapse.cost);
+					applied++;
+
+					//Lock the whole neighbourhood so later collapses this pass see the same triangles
+					for (uint32_t j = 0; j < count; j++)
+					{
+						const auto triangle = &lod.indices[first[j] * 3];
+						touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+					}
+
+					if (mKinds[collapse.from] == VertexKind::Border)
+					{
+						//The border now runs straight past the removed vertex
+						const auto from = mGroups[collapse.from];
+						const auto to = mGroups[collapse.to];
+						const auto other = mBorderNext[from] == to ? mBorderPrevious[from] : mBorderNext[from];
+
+						if (mBorderNext[from] == to)
+						{
+							mBorderPrevious[to] = other;
+							mBorderNext[other] = to;
+						}
+						else
+						{
+							mBorderNext[to] = other;
+							mBorderPrevious[other] = to;
+						}
+
+						removed += 1;
+					}
+					else
+					{
+						removed += 2;
+					}
+				}
+
+				if (applied == 0)
+				{
+					break;
+				}
+
+				//Rewrite, dropping triangles that collapsed to a line
+				size_t write = 0;
+
+				for (size_t i = 0; i < lod.indices.size(); i += 3)
+				{
+					const auto a = remap[lod.indices[i]];
+					const auto b = remap[lod.indices[i + 1]];
+					const auto c = remap[lod.indices[i + 2]];
+
+					if (mGroups[a] == mGroups[b] || mGroups[b] == mGroups[c] || mGroups[a] == mGroups[c])
+					{
+						continue;
+					}
+
+					lod.indices[write++] = a;
+					lod.indices[write++] = b;
+					lod.indices[write++] = c;
+				}
+
+				lod.indices.resize(write);
+			}
+
+			lod.error = static_cast<float>(sqrt(worstCost));
+			return lod;
+		}
+	};
+}
+
+MeshLod Advanced_Rendering::SimplifyMesh(const MeshView & pMesh, const uint32_t * pIndices, const uint32_t pIndexCount, const uint32_t pTargetIndexCount, const float pMaxError)
+{
+	if (!pMesh.HasStream(MeshStream::Position))
+	{
+		MeshLod lod;
+		lod.indices.assign(pIndices, pIndices + pIndexCount);
+		return lod;
+	}
+
+	Simplifier simplifier(pMesh, pIndices, pIndexCount);
+	return simplifier.Simplify(pIndices, pIndexCount, pTargetIndexCount, pMaxError);
+}
+
+std::vector<MeshLod> Advanced_Rendering::BuildLodChain(const MeshView & pMesh, const uint32_t pLevels, const float pRatio, const float pMaxError)
+{
+	std::vector<MeshLod> chain(1);
+	chain[0].indices.assign(pMesh.indices, pMesh.indices + pMesh.indexCount);
+
+	if (!pMesh.HasStream(MeshStream::Position))
+	{
+		return chain;
+	}
+
+	//One simplifier for the whole chain, so the quadrics carry each level's error into the next
+	Simplifier simplifier(pMesh, pMesh.indices, pMesh.indexCount);
+
+	while (chain.size() < pLevels)
+	{
+		const auto & previous = chain.back();
+		const auto previousCount = static_cast<uint32_t>(previous.indices.size());
+		const auto target = static_cast<uint32_t>(previousCount * pRatio) / 3 * 3;
+
+		auto lod = simplifier.Simplify(previous.indices.data(), previousCount, target, pMaxError);
+
+		if (lod.indices.empty() || lod.indices.size() >= previousCount * 0.9)
+		{
+			break;
+		}
+
+		lod.error = std::max(lod.error, previous.error);
+		OptimizeVertexCache(lod.indices.data(), static_cast<uint32_t>(lod.indices.size()), pMesh.vertexCount);
+		chain.push_back(std::move(lod));
+	}
+
+	return chain;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "MeshFile.h"
+
+namespace Advanced_Rendering
+{
+	// One level of a LOD chain, an index list over the original mesh's vertices.
+	struct MeshLod
+	{
+		std::vector<uint32_t> indices;
+		float error = 0.0f;		// largest quadric distance from the original surface, in mesh units
+	};
+
+	// Quadric error edge collapse (Garland and Heckbert) over a triangle or 3 control point patch
+	// list. Collapses move a vertex onto a neighbour, so no vertex data is created and every level
+	// shares the original vertex streams. Vertices that share a position with another vertex sit
+	// on a UV or normal seam and are never moved; open borders only slide along themselves.
+	// Stops at pTargetIndexCount or when the next collapse would cost more than pMaxError.
+	MeshLod SimplifyMesh(const MeshView & pMesh, const uint32_t * pIndices, uint32_t pIndexCount, uint32_t pTargetIndexCount, float pMaxError);
+
+	// Level 0 is the mesh, each level after simplifies the one before to pRatio of its indices and
+	// is reordered for the vertex cache. The chain ends early once a level stops shrinking.
+	std::vector<MeshLod> BuildLodChain(const MeshView & pMesh, uint32_t pLevels, float pRatio, float pMaxError);
+}
@@ -0,0 +1,496 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	//How much a neighbour's normal counts against the vertices it adds, a normal at right angles
+	//to the cluster's costs as much as half a vertex
+	constexpr float ConeWeight = 0.5f;
+
+	//And how much each unused triangle still around its corners counts, favouring triangles the
+	//cluster would otherwise strand
+	constexpr float LiveWeight = 0.2f;
+
+	struct Vector
+	{
+		float x, y, z;
+
+		Vector operator+ (const Vector & pOther) const { return { x + pOther.x, y + pOther.y, z + pOther.z }; }
+		Vector operator- (const Vector & pOther) const { return { x - pOther.x, y - pOther.y, z - pOther.z }; }
+		Vector operator* (const float pScale) const { return { x * pScale, y * pScale, z * pScale }; }
+
+		float Dot(const Vector & pOther) const { return x * pOther.x + y * pOther.y + z * pOther.z; }
+		float Length() const { return sqrtf(Dot(*this)); }
+
+		Vector Cross(const Vector & pOther) const
+		{
+			return { y * pOther.z - z * pOther.y, z * pOther.x - x * pOther.z, x * pOther.y - y * pOther.x };
+		}
+
+		Vector Normalized() const
+		{
+			const auto length = Length();
+			return length > 0.0f ? *this * (1.0f / length) : Vector{ 0.0f, 0.0f, 0.0f };
+		}
+	};
+
+	Vector Load(const float * pValues, const uint32_t pIndex = 0)
+	{
+		return { pValues[pIndex * 3], pValues[pIndex * 3 + 1], pValues[pIndex * 3 + 2] };
+	}
+
+	void Store(const Vector & pVector, float * pValues)
+	{
+		pValues[0] = pVector.x;
+		pValues[1] = pVector.y;
+		pValues[2] = pVector.z;
+	}
+
+	// Ritter's sphere, within a few percent of the smallest and linear in the vertex count.
+	void ComputeSphere(const float * pPositions, const uint32_t * pVertices, const uint32_t pCount, Meshlet & pMeshlet)
+	{
+		const auto first = Load(pPositions, pVertices[0]);
+
+		auto farthest = [&](const Vector & pFrom)
+		{
+			auto best = pFrom;
+			auto bestDistance = -1.0f;
+
+			for (uint32_t i = 0; i < pCount; i++)
+			{
+				const auto point = Load(pPositions, pVertices[i]);
+				const auto distance = (point - pFrom).Dot(point - pFrom);
+
+				if (distance > bestDistance)
+				{
+					best = point;
+					bestDistance = distance;
+				}
+			}
+
+			return best;
+		};
+
+		const auto a = farthest(first);
+		const auto b = farthest(a);
+
+		auto center = (a + b) * 0.5f;
+		auto radius = (b - a).Length() * 0.5f;
+
+		for (uint32_t i = 0; i < pCount; i++)
+		{
+			const auto point = Load(pPositions, pVertices[i]);
+			const auto distance = (point - center).Length();
+
+			if (distance > radius)
+			{
+				//Grow just enough to reach the point, keeping the far side where it was
+				const auto grown = (radius + distance) * 0.5f;
+				center = center + (point - center) * ((grown - radius) / distance);
+				radius = grown;
+			}
+		}
+
+		Store(center, pMeshlet.center);
+		pMeshlet.radius = radius;
+	}
+
+	// Normal cone as in meshoptimizer's meshopt_computeClusterBounds, the apex sits far enough
+	// back along the axis that every triangle's plane passes in front of it.
+	void ComputeCone(const Vector * pNormals, const float * pPositions, const uint32_t * pIndices, const uint32_t pTriangleCount, Meshlet & pMeshlet)
+	{
+		auto sum = Vector{ 0.0f, 0.0f, 0.0f };
+
+		for (uint32_t i = 0; i < pTriangleCount; i++)
+		{
+			sum = sum + pNormals[i];
+		}
+
+		const auto axis = sum.Normalized();
+		auto minimum = 1.0f;
+
+		for (uint32_t i = 0; i < pTriangleCount; i++)
+		{
+			minimum = std::min(minimum, axis.Dot(pNormals[i]));
+		}
+
+		Store(axis, pMeshlet.coneAxis);
+		Store(Load(pMeshlet.center), pMeshlet.coneApex);
+
+		//Normals spread past a hemisphere, some triangle always faces the eye
+		if (minimum <= 0.0f)
+		{
+			pMeshlet.coneCutoff = 1.0f;
+			return;
+		}
+
+		const auto center = Load(pMeshlet.center);
+		auto distance = 0.0f;
+
+		for (uint32_t i = 0; i < pTriangleCount; i++)
+		{
+			const auto toCenter = center - Load(pPositions, pIndices[i * 3]);
+			const auto along = axis.Dot(pNormals[i]);
+
+			if (along > 0.0f)
+			{
+				distance = std::max(distance, toCenter.Dot(pNormals[i]) / along);
+			}
+		}
+
+		Store(center - axis * distance, pMeshlet.coneApex);
+		pMeshlet.coneCutoff = sqrtf(1.0f - minimum * minimum);
+	}
+}
+
+void Advanced_Rendering::BuildMeshlets(const MeshView & pMesh, const uint32_t * pIndices, const uint32_t pIndexCount, MeshletMesh & pMeshlets,
+	const uint32_t pMaxVertices, const uint32_t pMaxTriangles)
+{
+	pMeshlets.meshlets.clear();
+	pMeshlets.indices.clear();
+
+	const auto positions = pMesh.Stream(MeshStream::Position);
+	const auto triangleCount = pIndexCount / 3;
+
+	if (!positions || triangleCount == 0)
+	{
+		return;
+	}
+
+	//Face normals, turned to agree with the vertex normals where there are any so the cones do
+	//not depend on the exporter's winding
+	std::vector<Vector> normals(triangleCount);
+	auto agreement = 0.0f;
+
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		const auto a = Load(positions, pIndices[i * 3]);
+		const auto b = Load(positions, pIndices[i * 3 + 1]);
+		const auto c = Load(positions, pIndices[i * 3 + 2]);
+
+		normals[i] = (b - a).Cross(c - a).Normalized();
+
+		if (pMesh.HasStream(MeshStream::Normal))
+		{
+			const auto vertexNormals = pMesh.Stream(MeshStream::Normal);
+			const auto sum = Load(vertexNormals, pIndices[i * 3]) + Load(vertexNormals, pIndices[i * 3 + 1]) + Load(vertexNormals, pIndices[i * 3 + 2]);
+
+			agreement += normals[i].Dot(sum);
+		}
+	}
+
+	if (agreement < 0.0f)
+	{
+		for (auto & normal : normals)
+		{
+			normal = normal * -1.0f;
+		}
+	}
+
+	//Vertex to triangle adjacency through shared positions, offsets then lists, so clusters grow
+	//across UV and normal seams
+	std::vector<uint32_t> positionVertex(pMesh.vertexCount);
+	{
+		struct PositionHash
+		{
+			size_t operator() (const std::pair<uint64_t, uint32_t> & pKey) const
+			{
+				return std::hash<uint64_t>()(pKey.first * 31 + pKey.second);
+			}
+		};
+
+		std::unordered_map<std::pair<uint64_t, uint32_t>, uint32_t, PositionHash> first;
+		first.reserve(pMesh.vertexCount);
+
+		for (uint32_t i = 0; i < pMesh.vertexCount; i++)
+		{
+			uint32_t bits[3];
+			memcpy(bits, positions + i * 3, sizeof(bits));
+
+			const auto key = std::make_pair(static_cast<uint64_t>(bits[0]) << 32 | bits[1], bits[2]);
+			positionVertex[i] = first.emplace(key, i).first->second;
+		}
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(pMesh.vertexCount + 1, 0);
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacencyOffsets[positionVertex[pIndices[i]] + 1]++;
+	}
+
+	for (uint32_t i = 0; i < pMesh.vertexCount; i++)
+	{
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	}
+
+	{
+		auto fill = adjacencyOffsets;
+
+		for (uint32_t i = 0; i < triangleCount * 3; i++)
+		{
+			adjacency[fill[positionVertex[pIndices[i]]]++] = i / 3;
+		}
+	}
+
+	//Unused triangles left around each position
+	std::vector<uint32_t> live(pMesh.vertexCount);
+
+	for (uint32_t i = 0; i < pMesh.vertexCount; i++)
+	{
+		live[i] = adjacencyOffsets[i + 1] - adjacencyOffsets[i];
+	}
+
+	auto liveScore = [&](const uint32_t pTriangle)
+	{
+		return live[positionVertex[pIndices[pTriangle * 3]]] + live[positionVertex[pIndices[pTriangle * 3 + 1]]] + live[positionVertex[pIndices[pTriangle * 3 + 2]]];
+	};
+
+	std::vector<bool> used(triangleCount, false);
+	std::vector<uint32_t> vertexMeshlet(pMesh.vertexCount, ~0u);
+	std::vector<uint32_t> vertices;
+	std::vector<uint32_t> triangles;
+	std::vector<Vector> triangleNormals;
+
+	pMeshlets.indices.reserve(triangleCount * 3);
+	uint32_t cursor = 0;
+
+	while (true)
+	{
+		//Seed next to the last cluster, falling back to the first unused triangle in cache order
+		auto seed = ~0u;
+
+		for (const auto vertex : vertices)
+		{
+			const auto shared = positionVertex[vertex];
+
+			for (auto j = adjacencyOffsets[shared]; j < adjacencyOffsets[shared + 1]; j++)
+			{
+				const auto triangle = adjacency[j];
+
+				if (!used[triangle] && (seed == ~0u || liveScore(triangle) < liveScore(seed)))
+				{
+					seed = triangle;
+				}
+			}
+		}
+
+		if (seed == ~0u)
+		{
+			while (cursor < triangleCount && used[cursor])
+			{
+				cursor++;
+			}
+
+			if (cursor == triangleCount)
+			{
+				break;
+			}
+
+			seed = cursor;
+		}
+
+		const auto id = static_cast<uint32_t>(pMeshlets.meshlets.size());
+		auto normalSum = Vector{ 0.0f, 0.0f, 0.0f };
+
+		vertices.clear();
+		triangles.clear();
+
+		auto add = [&](const uint32_t pTriangle)
+		{
+			used[pTriangle] = true;
+			triangles.push_back(pTriangle);
+
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				live[positionVertex[pIndices[pTriangle * 3 + j]]]--;
+			}
+
+			normalSum = normalSum + normals[pTriangle];
+
+			for (uint32_t j = 0; j < 3; j++)
+			{
+				const auto vertex = pIndices[pTriangle * 3 + j];
+
+				if (vertexMeshlet[vertex] != id)
+				{
+					vertexMeshlet[vertex] = id;
+					vertices.push_back(vertex);
+				}
+			}
+		};
+
+		add(seed);
+
+		while (triangles.size() < pMaxTriangles)
+		{
+			const auto axis = normalSum.Normalized();
+			auto best = ~0u;
+			auto bestScore = 0.0f;
+
+			for (const auto vertex : vertices)
+			{
+				const auto shared = positionVertex[vertex];
+
+				for (auto j = adjacencyOffsets[shared]; j < adjacencyOffsets[shared + 1]; j++)
+				{
+					const auto triangle = adjacency[j];
+
+					if (used[triangle])
+					{
+						continue;
+					}
+
+					uint32_t extra = 0;
+
+					for (uint32_t k = 0; k < 3; k++)
+					{
+						extra += vertexMeshlet[pIndices[triangle * 3 + k]] != id ? 1 : 0;
+					}
+
+					if (vertices.size() + extra > pMaxVertices)
+					{
+						continue;
+					}
+
+					const auto score = extra + ConeWeight * (1.0f - axis.Dot(normals[triangle])) + LiveWeight * liveScore(triangle);
+
+					if (best == ~0u || score < bestScore)
+					{
+						best = triangle;
+						bestScore = score;
+					}
+				}
+			}
+
+			//Nothing connected fits, a disconnected triangle would only loosen the bounds
+			if (best == ~0u)
+			{
+				break;
+			}
+
+			add(best);
+		}
+
+		Meshlet meshlet;
+		meshlet.firstIndex = static_cast<uint32_t>(pMeshlets.indices.size());
+		meshlet.triangleCount = static_cast<uint32_t>(triangles.size());
+		meshlet.vertexCount = static_cast<uint32_t>(vertices.size());
+
+		triangleNormals.clear();
+
+		for (const auto triangle : triangles)
+		{
+			pMeshlets.indices.insert(pMeshlets.indices.end(), pIndices + triangle * 3, pIndices + triangle * 3 + 3);
+			triangleNormals.push_back(normals[triangle]);
+		}
+
+		ComputeSphere(positions, vertices.data(), meshlet.vertexCount, meshlet);
+		ComputeCone(triangleNormals.data(), positions, pMeshlets.indices.data() + meshlet.firstIndex, meshlet.triangleCount, meshlet);
+
+		pMeshlets.meshlets.push_back(meshlet);
+	}
+}
+
+void Advanced_Rendering::MakeMeshletCullView(const float * pModelViewProjection, const float * pEye, const float pPadding, MeshletCullView & pView)
+{
+	//Gribb and Hartmann, with clip = v * M each plane is a sum of the matrix's columns. D3D clips
+	//z to [0, w], so the near plane is the z column alone
+	for (uint32_t j = 0; j < 4; j++)
+	{
+		const auto x = pModelViewProjection[j * 4];
+		const auto y = pModelViewProjection[j * 4 + 1];
+		const auto z = pModelViewProjection[j * 4 + 2];
+		const auto w = pModelViewProjection[j * 4 + 3];
+
+		pView.planes[0][j] = w + x;
+		pView.planes[1][j] = w - x;
+		pView.planes[2][j] = w + y;
+		pView.planes[3][j] = w - y;
+		pView.planes[4][j] = z;
+		pView.planes[5][j] = w - z;
+	}
+
+	for (auto & plane : pView.planes)
+	{
+		const auto length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+
+		for (auto & value : plane)
+		{
+			value /= length;
+		}
+	}
+
+	pView.eye[0] = pEye[0];
+	pView.eye[1] = pEye[1];
+	pView.eye[2] = pEye[2];
+	pView.padding = pPadding;
+}
+
+MeshletVisibility Advanced_Rendering::CullMeshlet(const Meshlet & pMeshlet, const MeshletCullView & pView)
+{
+	const auto center = Load(pMeshlet.center);
+	const auto radius = pMeshlet.radius + pView.padding;
+
+	for (const auto & plane : pView.planes)
+	{
+		if (plane[0] * center.x + plane[1] * center.y + plane[2] * center.z + plane[3] < -radius)
+		{
+			return MeshletVisibility::OutsideFrustum;
+		}
+	}
+
+	if (pMeshlet.coneCutoff >= 1.0f)
+	{
+		return MeshletVisibility::Visible;
+	}
+
+	const auto axis = Load(pMeshlet.coneAxis);
+	const auto eye = Load(pView.eye);
+
+	//Undisplaced clusters use the tighter apex test, displaced ones the sphere form with the padded radius
+	if (pView.padding <= 0.0f)
+	{
+		const auto direction = (Load(pMeshlet.coneApex) - eye).Normalized();
+
+		return direction.Dot(axis) >= pMeshlet.coneCutoff ? MeshletVisibility::BackFacing : MeshletVisibility::Visible;
+	}
+
+	const auto toCenter = center - eye;
+
+	return toCenter.Dot(axis) >= pMeshlet.coneCutoff * toCenter.Length() + radius ? MeshletVisibility::BackFacing : MeshletVisibility::Visible;
+}
+
+uint32_t Advanced_Rendering::CullMeshlets(const std::vector<Meshlet> & pMeshlets, const MeshletCullView & pView, std::vector<IndexRange> & pRanges)
+{
+	pRanges.clear();
+	uint32_t triangles = 0;
+
+	for (const auto & meshlet : pMeshlets)
+	{
+		if (CullMeshlet(meshlet, pView) != MeshletVisibility::Visible)
+		{
+			continue;
+		}
+
+		triangles += meshlet.triangleCount;
+
+		if (!pRanges.empty() && pRanges.back().firstIndex + pRanges.back().indexCount == meshlet.firstIndex)
+		{
+			pRanges.back().indexCount += meshlet.triangleCount * 3;
+		}
+		else
+		{
+			pRanges.push_back({ meshlet.firstIndex, meshlet.triangleCount * 3 });
+		}
+	}
+
+	return triangles;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "MeshFile.h"
+
+namespace Advanced_Rendering
+{
+	constexpr uint32_t MeshletMaxVertices = 64;
+	constexpr uint32_t MeshletMaxTriangles = 124;
+
+	// A cluster of triangles that is culled as a whole, bounds in mesh space.
+	struct Meshlet
+	{
+		uint32_t firstIndex = 0;		// into the reordered index list
+		uint32_t triangleCount = 0;
+		uint32_t vertexCount = 0;
+
+		float center[3] = {};			// bounding sphere
+		float radius = 0.0f;
+
+		float coneApex[3] = {};			// normal cone, the cluster faces away from any eye inside the
+		float coneAxis[3] = {};			// cone of directions about coneAxis through coneApex
+		float coneCutoff = 1.0f;		// sine of the normals' spread, 1 when the normals have no usable cone
+	};
+
+	struct MeshletMesh
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> indices;	// the mesh's triangles in meshlet order
+	};
+
+	// Grows clusters over a triangle or 3 control point patch list, each from the first unused
+	// triangle and then through the neighbour that adds the fewest vertices and keeps the normals
+	// closest. Triangles keep their original vertex indices, so the mesh's vertex streams are unchanged.
+	void BuildMeshlets(const MeshView & pMesh, const uint32_t * pIndices, uint32_t pIndexCount, MeshletMesh & pMeshlets,
+		uint32_t pMaxVertices = MeshletMaxVertices, uint32_t pMaxTriangles = MeshletMaxTriangles);
+
+	// Frustum planes and eye in mesh space. pPadding grows every bounding sphere, for meshes that are
+	// displaced after the vertex shader.
+	struct MeshletCullView
+	{
+		float planes[6][4];
+		float eye[3];
+		float padding;
+	};
+
+	// pModelViewProjection is row-major for row vectors, as DirectXMath stores it before transposing.
+	void MakeMeshletCullView(const float * pModelViewProjection, const float * pEye, float pPadding, MeshletCullView & pView);
+
+	enum class MeshletVisibility
+	{
+		Visible,
+		OutsideFrustum,
+		BackFacing
+	};
+
+	MeshletVisibility CullMeshlet(const Meshlet & pMeshlet, const MeshletCullView & pView);
+
+	struct IndexRange
+	{
+		uint32_t firstIndex;
+		uint32_t indexCount;
+	};
+
+	// Index ranges of the visible meshlets, neighbouring meshlets merged into one range. Returns the
+	// number of visible triangles.
+	uint32_t CullMeshlets(const std::vector<Meshlet> & pMeshlets, const MeshletCullView & pView, std::vector<IndexRange> & pRanges);
+}
@@ -0,0 +1,457 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include "Parallel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MIP_GENERATOR_AVX2
+#define MIP_GENERATOR_SSE2
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2
+#endif
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr float Pi = 3.14159265358979f;
+	constexpr float KaiserWidth = 2.0f;		// in texels of the level being made
+	constexpr float KaiserAlpha = 4.0f;
+
+	//Rows are handed out in bands of about this many texels, small levels stay on one thread
+	constexpr uint32_t BandTexels = 16384;
+
+	// Premultiplied RGBA, linear when gamma correcting
+	struct FloatImage
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<float> texels;
+	};
+
+	// Each target texel reads width source texels, clamped to the edge, with weights summing to one
+	struct Taps
+	{
+		uint32_t width = 0;
+		std::vector<uint32_t> indices;
+		std::vector<float> weights;
+	};
+
+	const float * SrgbToLinear()
+	{
+		static const auto table = []()
+		{
+			std::array<float, 256> values;
+
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				const auto c = i / 255.0f;
+				values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+
+			return values;
+		}();
+
+		return table.data();
+	}
+
+	// Indexed by linear light in 16 bits, fine enough that every sRGB step near black has its own entries
+	const uint8_t * LinearToSrgb()
+	{
+		static const auto table = []()
+		{
+			std::vector<uint8_t> values(65536);
+
+			for (uint32_t i = 0; i < 65536; i++)
+			{
+				const auto l = i / 65535.0f;
+				const auto s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+				values[i] = static_cast<uint8_t>(std::min(std::max(s * 255.0f + 0.5f, 0.0f), 255.0f));
+			}
+
+			return values;
+		}();
+
+		return table.data();
+	}
+
+	float BesselI0(const float pX)
+	{
+		auto sum = 1.0f, term = 1.0f;
+
+		for (auto k = 1; k < 20; k++)
+		{
+			const auto factor = pX / (2.0f * k);
+			term *= factor * factor;
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	float Kaiser(const float pX)
+	{
+		if (std::fabs(pX) >= KaiserWidth)
+		{
+			return 0.0f;
+		}
+
+		const auto t = pX / KaiserWidth;
+		const auto sinc = std::fabs(pX) < 1e-4f ? 1.0f : std::sin(Pi * pX) / (Pi * pX);
+
+		return sinc * BesselI0(KaiserAlpha * std::sqrt(1.0f - t * t)) / BesselI0(KaiserAlpha);
+	}
+
+	Taps BuildTaps(const uint32_t pSource, const uint32_t pTarget, const MipFilter pFilter)
+	{
+		//A level halves with rounding down, so odd sizes squeeze a little more than two texels into one
+		const auto scale = static_cast<float>(pSource) / pTarget;
+		const auto support = pFilter == MipFilter::Box ? scale * 0.5f : KaiserWidth * scale;
+
+		std::vector<std::vector<std::pair<uint32_t, float>>> texels(pTarget);
+		Taps taps;
+
+		for (uint32_t x = 0; x < pTarget; x++)
+		{
+			const auto centre = (x + 0.5f) * scale;
+			const auto first = static_cast<int>(std::floor(centre - support));
+			const auto last = static_cast<int>(std::ceil(centre + support));
+			auto total = 0.0f;
+
+			for (auto i = first; i <= last; i++)
+			{
+				const auto weight = pFilter == MipFilter::Box ?
+					std::max(0.0f, std::min(i + 1.0f, centre + support) - std::max(static_cast<float>(i), centre - support)) :
+					Kaiser((i + 0.5f - centre) / scale);
+
+				if (weight != 0.0f)
+				{
+					texels[x].emplace_back(static_cast<uint32_t>(std::min(std::max(i, 0), static_cast<int>(pSource) - 1)), weight);
+					total += weight;
+				}
+			}
+
+			for (auto & texel : texels[x])
+			{
+				texel.second /= total;
+			}
+
+			taps.width = std::max(taps.width, static_cast<uint32_t>(texels[x].size()));
+		}
+
+		//Padded to the widest, the padding reads the last tap with no weight
+		taps.indices.resize(static_cast<size_t>(pTarget) * taps.width);
+		taps.weights.resize(static_cast<size_t>(pTarget) * taps.width);
+
+		for (uint32_t x = 0; x < pTarget; x++)
+		{
+			for (uint32_t t = 0; t < taps.width; t++)
+			{
+				const auto & texel = texels[x][std::min<size_t>(t, texels[x].size() - 1)];
+				taps.indices[x * taps.width + t] = texel.first;
+				taps.weights[x * taps.width + t] = t < texels[x].size() ? texel.second : 0.0f;
+			}
+		}
+
+		return taps;
+	}
+
+	// Calls pFunction(first, end) for bands of rows across the hardware threads
+	template <class Function>
+	void ForBands(const uint32_t pRows, const uint32_t pTexelsPerRow, Function && pFunction)
+	{
+		const auto bandRows = std::max(1u, BandTexels / std::max(1u, pTexelsPerRow));
+		const auto bands = (pRows + bandRows - 1) / bandRows;
+
+		if (bands <= 1)
+		{
+			pFunction(0u, pRows);
+			return;
+		}
+
+		ParallelFor(bands, [&](const uint32_t pBand)
+		{
+			pFunction(pBand * bandRows, std::min(pRows, (pBand + 1) * bandRows));
+		});
+	}
+
+	// pTarget[i] += pWeight * pSource[i]
+	void AddScaled(float * pTarget, const float * pSource, const float pWeight, const size_t pCount)
+	{
+		size_t i = 0;
+
+#if defined(MIP_GENERATOR_AVX2)
+		const auto weight8 = _mm256_set1_ps(pWeight);
+
+		for (; i + 8 <= pCount; i += 8)
+		{
+			_mm256_storeu_ps(pTarget + i, _mm256_add_ps(_mm256_loadu_ps(pTarget + i), _mm256_mul_ps(weight8, _mm256_loadu_ps(pSource + i))));
+		}
+#endif
+#if defined(MIP_GENERATOR_SSE2)
+		const auto weight4 = _mm_set1_ps(pWeight);
+
+		for (; i + 4 <= pCount; i += 4)
+		{
+			_mm_storeu_ps(pTarget + i, _mm_add_ps(_mm_loadu_ps(pTarget + i), _mm_mul_ps(weight4, _mm_loadu_ps(pSource + i))));
+		}
+#endif
+
+		for (; i < pCount; i++)
+		{
+			pTarget[i] += pWeight * pSource[i];
+		}
+	}
+
+	// Filters across each row, then down each column of the narrowed rows
+	void Downsample(const FloatImage & pSource, const MipFilter pFilter, const bool pNormalMap, FloatImage & pTarget)
+	{
+		pTarget.width = std::max(1u, pSource.width >> 1);
+		pTarget.height = std::max(1u, pSource.height >> 1);
+		pTarget.texels.assign(static_cast<size_t>(pTarget.width) * pTarget.height * 4, 0.0f);
+
+		const auto horizontal = BuildTaps(pSource.width, pTarget.width, pFilter);
+		const auto vertical = BuildTaps(pSource.height, pTarget.height, pFilter);
+
+		std::vector<float> rows(static_cast<size_t>(pTarget.width) * pSource.height * 4);
+
+		ForBands(pSource.height, pSource.width, [&](const uint32_t pFirst, const uint32_t pEnd)
+		{
+			for (auto y = pFirst; y < pEnd; y++)
+			{
+				const auto source = pSource.texels.data() + static_cast<size_t>(y) * pSource.width * 4;
+				auto target = rows.data() + static_cast<size_t>(y) * pTarget.width * 4;
+
+				for (uint32_t x = 0; x < pTarget.width; x++, target += 4)
+				{
+					const auto indices = horizontal.indices.data() + x * horizontal.width;
+					const auto weights = horizontal.weights.data() + x * horizontal.width;
+
+#if defined(MIP_GENERATOR_SSE2)
+					//One RGBA texel to a register
+					auto sum = _mm_setzero_ps();
+
+					for (uint32_t t = 0; t < horizontal.width; t++)
+					{
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(source + indices[t] * 4)));
+					}
+
+					_mm_storeu_ps(target, sum);
+#else
+					for (uint32_t c = 0; c < 4; c++)
+					{
+						auto sum = 0.0f;
+
+						for (uint32_t t = 0; t < horizontal.width; t++)
+						{
+							sum += weights[t] * source[indices[t] * 4 + c];
+						}
+
+						target[c] = sum;
+					}
+#endif
+				}
+			}
+		});
+
+		const auto rowFloats = static_cast<size_t>(pTarget.width) * 4;
+
+		ForBands(pTarget.height, pTarget.width, [&](const uint32_t pFirst, const uint32_t pEnd)
+		{
+			for (auto y = pFirst; y < pEnd; y++)
+			{
+				const auto target = pTarget.texels.data() + y * rowFloats;
+
+				for (uint32_t t = 0; t < vertical.width; t++)
+				{
+					AddScaled(target, rows.data() + vertical.indices[y * vertical.width + t] * rowFloats, vertical.weights[y * vertical.width + t], rowFloats);
+				}
+
+				if (!pNormalMap)
+				{
+					continue;
+				}
+
+				for (uint32_t x = 0; x < pTarget.width; x++)
+				{
+					const auto texel = target + x * 4;
+					const float n[3] = { texel[0] * 2.0f - 1.0f, texel[1] * 2.0f - 1.0f, texel[2] * 2.0f - 1.0f };
+					const auto length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+					if (length > 1e-6f)
+					{
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							texel[c] = n[c] / length * 0.5f + 0.5f;
+						}
+					}
+				}
+			}
+		});
+	}
+
+	bool HasAlpha(const PixelLayout pLayout)
+	{
+		return pLayout == PixelLayout::Rgba || pLayout == PixelLayout::Bgra;
+	}
+
+	void Decode(const PixelView & pSource, const MipOptions & pOptions, FloatImage & pImage)
+	{
+		pImage.width = pSource.width;
+		pImage.height = pSource.height;
+		pImage.texels.resize(static_cast<size_t>(pSource.width) * pSource.height * 4);
+
+		const auto linear = SrgbToLinear();
+		const auto premultiply = HasAlpha(pSource.layout) && !pOptions.normalMap;
+
+		ForBands(pSource.height, pSource.width, [&](const uint32_t pFirst, const uint32_t pEnd)
+		{
+			for (auto y = pFirst; y < pEnd; y++)
+			{
+				const auto row = pSource.data + y * pSource.rowPitch;
+				auto texel = pImage.texels.data() + static_cast<size_t>(y) * pSource.width * 4;
+
+				for (uint32_t x = 0; x < pSource.width; x++, texel += 4)
+				{
+					uint8_t rgba[4];
+
+					switch (pSource.layout)
+					{
+					case PixelLayout::Rgba:
+						rgba[0] = row[x * 4];
+						rgba[1] = row[x * 4 + 1];
+						rgba[2] = row[x * 4 + 2];
+						rgba[3] = row[x * 4 + 3];
+						break;
+
+					case PixelLayout::Bgra:
+					case PixelLayout::Bgrx:
+						rgba[0] = row[x * 4 + 2];
+						rgba[1] = row[x * 4 + 1];
+						rgba[2] = row[x * 4];
+						rgba[3] = pSource.layout == PixelLayout::Bgra ? row[x * 4 + 3] : 255;
+						break;
+
+					default:
+						rgba[0] = rgba[1] = rgba[2] = row[x];
+						rgba[3] = 255;
+						break;
+					}
+
+					const auto alpha = rgba[3] / 255.0f;
+					const auto weight = premultiply ? alpha : 1.0f;
+
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						texel[c] = (pOptions.gammaCorrect ? linear[rgba[c]] : rgba[c] / 255.0f) * weight;
+					}
+
+					texel[3] = alpha;
+				}
+			}
+		});
+	}
+
+	void Encode(const FloatImage & pImage, const PixelLayout pLayout, const MipOptions & pOptions, uint8_t * pOutput)
+	{
+		const auto srgb = LinearToSrgb();
+		const auto premultiplied = HasAlpha(pLayout) && !pOptions.normalMap;
+		const auto texelBytes = pLayout == PixelLayout::R ? 1u : 4u;
+
+		ForBands(pImage.height, pImage.width, [&](const uint32_t pFirst, const uint32_t pEnd)
+		{
+			for (auto y = pFirst; y < pEnd; y++)
+			{
+				auto texel = pImage.texels.data() + static_cast<size_t>(y) * pImage.width * 4;
+				auto output = pOutput + static_cast<size_t>(y) * pImage.width * texelBytes;
+
+				for (uint32_t x = 0; x < pImage.width; x++, texel += 4, output += texelBytes)
+				{
+					//The Kaiser lobes can ring a little past the ends of the range
+					const auto alpha = std::min(std::max(texel[3], 0.0f), 1.0f);
+					const auto scale = premultiplied && alpha > 0.0f ? 1.0f / alpha : 1.0f;
+					uint8_t rgba[4];
+
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						const auto value = std::min(std::max(texel[c] * scale, 0.0f), 1.0f);
+						rgba[c] = pOptions.gammaCorrect ? srgb[static_cast<uint32_t>(value * 65535.0f + 0.5f)] : static_cast<uint8_t>(value * 255.0f + 0.5f);
+					}
+
+					rgba[3] = static_cast<uint8_t>(alpha * 255.0f + 0.5f);
+
+					switch (pLayout)
+					{
+					case PixelLayout::Rgba:
+						output[0] = rgba[0];
+						output[1] = rgba[1];
+						output[2] = rgba[2];
+						output[3] = rgba[3];
+						break;
+
+					case PixelLayout::Bgra:
+					case PixelLayout::Bgrx:
+						output[0] = rgba[2];
+						output[1] = rgba[1];
+						output[2] = rgba[0];
+						output[3] = pLayout == PixelLayout::Bgra ? rgba[3] : 255;
+						break;
+
+					default:
+						output[0] = rgba[0];
+						break;
+					}
+				}
+			}
+		});
+	}
+}
+
+uint32_t Advanced_Rendering::FullMipCount(uint32_t pWidth, uint32_t pHeight)
+{
+	uint32_t count = 1;
+
+	while (pWidth > 1 || pHeight > 1)
+	{
+		pWidth = std::max(1u, pWidth >> 1);
+		pHeight = std::max(1u, pHeight >> 1);
+		count++;
+	}
+
+	return count;
+}
+
+size_t Advanced_Rendering::MipLevelSize(const uint32_t pWidth, const uint32_t pHeight, const PixelLayout pLayout)
+{
+	return static_cast<size_t>(pWidth) * pHeight * (pLayout == PixelLayout::R ? 1 : 4);
+}
+
+void Advanced_Rendering::GenerateMips(const PixelView & pSource, const MipOptions & pOptions, std::vector<uint8_t> & pOutput)
+{
+	const auto count = FullMipCount(pSource.width, pSource.height);
+
+	if (count <= 1)
+	{
+		return;
+	}
+
+	//Each level is made from the unquantised level above, so rounding does not build up down the chain
+	FloatImage level;
+	Decode(pSource, pOptions, level);
+
+	for (uint32_t i = 1; i < count; i++)
+	{
+		FloatImage next;
+		Downsample(level, pOptions.filter, pOptions.normalMap, next);
+
+		const auto offset = pOutput.size();
+		pOutput.resize(offset + MipLevelSize(next.width, next.height, pSource.layout));
+		Encode(next, pSource.layout, pOptions, pOutput.data() + offset);
+
+		level = std::move(next);
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BlockCompressor.h"
+
+namespace Advanced_Rendering
+{
+	enum class MipFilter
+	{
+		Box,		// the average of the texels each level texel covers
+		Kaiser		// Kaiser windowed sinc over two level texels either side, sharper distant detail without aliasing
+	};
+
+	struct MipOptions
+	{
+		MipFilter filter = MipFilter::Kaiser;
+		bool gammaCorrect = true;	// colour stored as sRGB, filtered in linear light. Off for heights and normals
+		bool normalMap = false;		// renormalise every texel, RGB holding a unit vector as 0.5 * n + 0.5
+	};
+
+	// Levels in a full chain, down to 1x1
+	uint32_t FullMipCount(uint32_t pWidth, uint32_t pHeight);
+
+	// Bytes of a level's tightly packed rows
+	size_t MipLevelSize(uint32_t pWidth, uint32_t pHeight, PixelLayout pLayout);
+
+	// Appends levels 1 to FullMipCount - 1 of pSource to pOutput, each in pSource's layout with tightly
+	// packed rows, as a DDS file stores them after the top level. Colour with alpha is filtered
+	// weighted by alpha so transparent texels do not bleed into the edges of billboards. Rows of
+	// each level are filtered across the hardware threads.
+	void GenerateMips(const PixelView & pSource, const MipOptions & pOptions, std::vector<uint8_t> & pOutput);
+}
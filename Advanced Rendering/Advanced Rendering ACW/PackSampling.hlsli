@@ -0,0 +1,18 @@
+// The billboard pack, shared by the soldier, flag, cloud and sculpture pixel shaders
+Texture2DArray colorTexture : register(t0);
+SamplerState Sampler : register(s0);
+
+// Where this pass's texture sits in the billboard pack
+cbuffer PackRegionConstantBuffer : register(b4)
+{
+    float4 regionRect;
+    float regionLayer;
+};
+
+// Wraps within the region, with gradients from the unwrapped UV so mips do not jump at the seams
+float4 SamplePack(float2 uv)
+{
+    float2 packUv = regionRect.xy + frac(uv) * regionRect.zw;
+
+    return colorTexture.SampleGrad(Sampler, float3(packUv, regionLayer), ddx(uv) * regionRect.zw, ddy(uv) * regionRect.zw);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Advanced_Rendering
+{
+	inline uint32_t WorkerCount()
+	{
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Calls pFunction(i) for every i in [0, pCount) across pThreadCount threads. Items are handed out
+	// one at a time, so uneven items balance themselves. The calling thread takes part as well.
+	template <class Function>
+	void ParallelFor(const uint32_t pCount, const uint32_t pThreadCount, Function && pFunction)
+	{
+		const auto threadCount = std::min(pThreadCount, pCount);
+
+		if (threadCount <= 1)
+		{
+			for (uint32_t i = 0; i < pCount; i++)
+			{
+				pFunction(i);
+			}
+
+			return;
+		}
+
+		std::atomic<uint32_t> next(0);
+
+		auto worker = [&]()
+		{
+			for (auto i = next++; i < pCount; i = next++)
+			{
+				pFunction(i);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+
+		for (uint32_t i = 1; i < threadCount; i++)
+		{
+			threads.emplace_back(worker);
+		}
+
+		worker();
+
+		for (auto & thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	// As above, across the hardware threads
+	template <class Function>
+	void ParallelFor(const uint32_t pCount, Function && pFunction)
+	{
+		ParallelFor(pCount, WorkerCount(), std::forward<Function>(pFunction));
+	}
+}
@@ -0,0 +1,679 @@
+#include "RayBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Parallel.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr uint32_t SubtreeObjects = 4096;		// ranges this small are built whole by one thread
+	constexpr uint32_t BinningChunk = 16384;		// objects binned by each thread of a large node
+	constexpr float BoundsPadding = 1e-4f;			// of a box's size and distance from the origin
+
+	struct Box
+	{
+		RayVector min = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		RayVector max = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+
+		void Grow(const RayVector & pPoint)
+		{
+			min = { std::min(min.x, pPoint.x), std::min(min.y, pPoint.y), std::min(min.z, pPoint.z) };
+			max = { std::max(max.x, pPoint.x), std::max(max.y, pPoint.y), std::max(max.z, pPoint.z) };
+		}
+
+		void Grow(const Box & pBox)
+		{
+			min = { std::min(min.x, pBox.min.x), std::min(min.y, pBox.min.y), std::min(min.z, pBox.min.z) };
+			max = { std::max(max.x, pBox.max.x), std::max(max.y, pBox.max.y), std::max(max.z, pBox.max.z) };
+		}
+
+		float Area() const
+		{
+			const auto size = max - min;
+			return size.x < 0.0f ? 0.0f : 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+		}
+	};
+
+	float Axis(const RayVector & pVector, const uint32_t pAxis)
+	{
+		return pAxis == 0 ? pVector.x : pAxis == 1 ? pVector.y : pVector.z;
+	}
+
+	RayVector Abs(const RayVector & pVector)
+	{
+		return { std::abs(pVector.x), std::abs(pVector.y), std::abs(pVector.z) };
+	}
+
+	//Padded so the hits the intersection code rounds just outside a primitive still fall in its box
+	Box ObjectBounds(const RayScene & pScene, const uint32_t pObject)
+	{
+		const auto triangleStart = static_cast<uint32_t>(pScene.spheres.size());
+		const auto quadStart = triangleStart + static_cast<uint32_t>(pScene.triangles.size());
+
+		Box box;
+
+		if (pObject < triangleStart)
+		{
+			const auto & sphere = pScene.spheres[pObject];
+			const RayVector radius = { sphere.radius, sphere.radius, sphere.radius };
+
+			box.Grow(sphere.centre - radius);
+			box.Grow(sphere.centre + radius);
+		}
+		else if (pObject < quadStart)
+		{
+			const auto & triangle = pScene.triangles[pObject - triangleStart];
+
+			box.Grow(triangle.a);
+			box.Grow(triangle.b);
+			box.Grow(triangle.c);
+		}
+		else
+		{
+			//The tangent and bitangent are taken to be at right angles, as the quads' checks assume
+			const auto & quad = pScene.quads[pObject - quadStart];
+			const auto extent = Abs(quad.tangent) * quad.size[0] + Abs(quad.biTangent) * quad.size[1];
+
+			box.Grow(quad.centre - extent);
+			box.Grow(quad.centre + extent);
+		}
+
+		const auto size = box.max - box.min;
+		const auto reach = std::max({ std::abs(box.min.x), std::abs(box.min.y), std::abs(box.min.z), std::abs(box.max.x), std::abs(box.max.y),
+			std::abs(box.max.z) });
+		const auto padding = BoundsPadding * (std::max({ size.x, size.y, size.z }) + reach) + std::numeric_limits<float>::min();
+
+		box.min = box.min - RayVector{ padding, padding, padding };
+		box.max = box.max + RayVector{ padding, padding, padding };
+
+		return box;
+	}
+
+	// Moved about with its object while the ranges are split, so binning reads memory in order
+	struct BuildItem
+	{
+		Box bounds;
+		RayVector centroid;
+		uint32_t object;
+	};
+
+	struct Bin
+	{
+		Box bounds;
+		uint32_t count = 0;
+	};
+
+	struct Range
+	{
+		uint32_t node;
+		uint32_t first;
+		uint32_t count;
+		uint32_t depth;
+	};
+
+	class BvhBuilder
+	{
+		std::vector<BuildItem> mItems;
+		const RayBvhOptions & mOptions;
+		uint32_t mThreadCount;
+
+		//Calls pFunction(first, count) over chunks of the range, across the threads when it is large
+		template <class Function>
+		void ForChunks(const uint32_t pFirst, const uint32_t pCount, const bool pParallel, Function && pFunction) const
+		{
+			const auto chunks = pParallel ? (pCount + BinningChunk - 1) / BinningChunk : 1;
+
+			ParallelFor(chunks, mThreadCount, [&](const uint32_t pChunk)
+			{
+				const auto first = pFirst + pChunk * (pCount / chunks);
+				pFunction(pChunk, first, pChunk + 1 == chunks ? pFirst + pCount - first : pCount / chunks);
+			});
+		}
+
+		void RangeBounds(const Range & pRange, const bool pParallel, Box & pBounds, Box & pCentroidBounds) const
+		{
+			const auto chunks = pParallel ? (pRange.count + BinningChunk - 1) / BinningChunk : 1;
+			Box localBounds[2];
+			std::vector<Box> chunkBounds(pParallel ? chunks * 2 : 0);
+			const auto bounds = pParallel ? chunkBounds.data() : localBounds;
+
+			ForChunks(pRange.first, pRange.count, pParallel, [&](const uint32_t pChunk, const uint32_t pFirst, const uint32_t pCount)
+			{
+				for (auto i = pFirst; i < pFirst + pCount; i++)
+				{
+					bounds[pChunk * 2].Grow(mItems[i].bounds);
+					bounds[pChunk * 2 + 1].Grow(mItems[i].centroid);
+				}
+			});
+
+			//Minima and maxima come out the same whichever way the chunks fall
+			for (uint32_t chunk = 0; chunk < chunks; chunk++)
+			{
+				pBounds.Grow(bounds[chunk * 2]);
+				pCentroidBounds.Grow(bounds[chunk * 2 + 1]);
+			}
+		}
+
+		static uint32_t BinOf(const RayVector & pCentroid, const uint32_t pAxis, const float pMin, const float pScale)
+		{
+			const auto bin = static_cast<int>((Axis(pCentroid, pAxis) - pMin) * pScale);
+			return static_cast<uint32_t>(std::min(std::max(bin, 0), static_cast<int>(RayBvhBinCount) - 1));
+		}
+
+		// The cheapest plane between bins on any axis, in intersection tests per ray reaching the node.
+		// False when the centroids all sit at one point and no plane separates them.
+		bool FindSplit(const Range & pRange, const bool pParallel, const Box & pBounds, const Box & pCentroidBounds, uint32_t & pAxis, uint32_t & pBin,
+			float & pCost) const
+		{
+			const auto chunks = pParallel ? (pRange.count + BinningChunk - 1) / BinningChunk : 1;
+			Bin localBins[3 * RayBvhBinCount];
+			std::vector<Bin> parallelBins(pParallel ? static_cast<size_t>(chunks) * 3 * RayBvhBinCount : 0);
+			const auto chunkBins = pParallel ? parallelBins.data() : localBins;
+			float scales[3];
+
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				const auto extent = Axis(pCentroidBounds.max, axis) - Axis(pCentroidBounds.min, axis);
+				scales[axis] = extent > 0.0f ? RayBvhBinCount / extent : 0.0f;
+				scales[axis] = std::isfinite(scales[axis]) ? scales[axis] : 0.0f;
+			}
+
+			ForChunks(pRange.first, pRange.count, pParallel, [&](const uint32_t pChunk, const uint32_t pFirst, const uint32_t pCount)
+			{
+				auto bins = &chunkBins[static_cast<size_t>(pChunk) * 3 * RayBvhBinCount];
+
+				for (auto i = pFirst; i < pFirst + pCount; i++)
+				{
+					const auto & item = mItems[i];
+
+					for (uint32_t axis = 0; axis < 3; axis++)
+					{
+						auto & bin = bins[axis * RayBvhBinCount + BinOf(item.centroid, axis, Axis(pCentroidBounds.min, axis), scales[axis])];
+						bin.bounds.Grow(item.bounds);
+						bin.count++;
+					}
+				}
+			});
+
+			auto found = false;
+			pCost = std::numeric_limits<float>::max();
+
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				if (scales[axis] == 0.0f)
+				{
+					continue;
+				}
+
+				Bin bins[RayBvhBinCount];
+
+				for (uint32_t chunk = 0; chunk < chunks; chunk++)
+				{
+					for (uint32_t bin = 0; bin < RayBvhBinCount; bin++)
+					{
+						const auto & chunkBin = chunkBins[(static_cast<size_t>(chunk) * 3 + axis) * RayBvhBinCount + bin];
+						bins[bin].bounds.Grow(chunkBin.bounds);
+						bins[bin].count += chunkBin.count;
+					}
+				}
+
+				//Sweep from the right to get the area and count beyond every plane, then from the left
+				float rightArea[RayBvhBinCount];
+				uint32_t rightCount[RayBvhBinCount];
+				Box right;
+				uint32_t count = 0;
+
+				for (auto bin = RayBvhBinCount - 1; bin > 0; bin--)
+				{
+					right.Grow(bins[bin].bounds);
+					count += bins[bin].count;
+					rightArea[bin] = right.Area();
+					rightCount[bin] = count;
+				}
+
+				Box left;
+				count = 0;
+
+				for (uint32_t bin = 1; bin < RayBvhBinCount; bin++)
+				{
+					left.Grow(bins[bin - 1].bounds);
+					count += bins[bin - 1].count;
+
+					if (count == 0 || rightCount[bin] == 0)
+					{
+						continue;
+					}
+
+					const auto cost = left.Area() * count + rightArea[bin] * rightCount[bin];
+
+					if (cost < pCost)
+					{
+						pCost = cost;
+						pAxis = axis;
+						pBin = bin;
+						found = true;
+					}
+				}
+			}
+
+			pCost = mOptions.traversalCost + pCost / std::max(pBounds.Area(), std::numeric_limits<float>::min());
+			return found;
+		}
+
+		// Makes pRange's node a leaf, or splits it and queues the two halves on pPending. With
+		// pSubtrees, ranges of SubtreeObjects or fewer below the root go there instead.
+		void BuildRange(const Range & pRange, std::vector<RayBvhNode> & pNodes, std::vector<Range> & pPending, std::vector<Range> * pSubtrees)
+		{
+			const auto parallel = pSubtrees && pRange.count > 2 * BinningChunk;
+
+			Box bounds, centroidBounds;
+			RangeBounds(pRange, parallel, bounds, centroidBounds);
+
+			auto & node = pNodes[pRange.node];
+			node = { { bounds.min.x, bounds.min.y, bounds.min.z }, pRange.first, { bounds.max.x, bounds.max.y, bounds.max.z }, pRange.count };
+
+			if (pRange.count <= 1)
+			{
+				return;
+			}
+
+			uint32_t axis = 0, bin = 0;
+			float cost;
+			auto middle = pRange.first + pRange.count / 2;
+
+			//Past half the stack only median splits are made, so no leaf lies deeper than RayBvhStackSize
+			const auto found = pRange.depth < RayBvhStackSize / 2 && FindSplit(pRange, parallel, bounds, centroidBounds, axis, bin, cost);
+
+			if (found && cost >= pRange.count && pRange.count <= mOptions.maxLeafSize)
+			{
+				return;
+			}
+
+			if (found)
+			{
+				const auto min = Axis(centroidBounds.min, axis);
+				const auto scale = RayBvhBinCount / (Axis(centroidBounds.max, axis) - min);
+
+				middle = static_cast<uint32_t>(std::partition(mItems.begin() + pRange.first, mItems.begin() + pRange.first + pRange.count,
+					[&](const BuildItem & pItem) { return BinOf(pItem.centroid, axis, min, scale) < bin; }) - mItems.begin());
+			}
+			else if (pRange.count <= mOptions.maxLeafSize)
+			{
+				return;
+			}
+			else
+			{
+				const auto extent = centroidBounds.max - centroidBounds.min;
+				axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+
+				std::nth_element(mItems.begin() + pRange.first, mItems.begin() + middle, mItems.begin() + pRange.first + pRange.count,
+					[&](const BuildItem & pA, const BuildItem & pB)
+				{
+					const auto a = Axis(pA.centroid, axis);
+					const auto b = Axis(pB.centroid, axis);
+					return a < b || (a == b && pA.object < pB.object);
+				});
+			}
+
+			const auto child = static_cast<uint32_t>(pNodes.size());
+			pNodes[pRange.node].first = child;
+			pNodes[pRange.node].count = 0;
+			pNodes.resize(pNodes.size() + 2);
+
+			//The left half is popped first, so each subtree's nodes follow its root
+			pPending.push_back({ child + 1, middle, pRange.first + pRange.count - middle, pRange.depth + 1 });
+			pPending.push_back({ child, pRange.first, middle - pRange.first, pRange.depth + 1 });
+		}
+
+	public:
+		// pBounds(i) gives object i's box
+		template <class Bounds>
+		BvhBuilder(const uint32_t pObjectCount, const RayBvhOptions & pOptions, Bounds && pBounds) :
+			mOptions(pOptions), mThreadCount(pOptions.threadCount != 0 ? pOptions.threadCount : WorkerCount())
+		{
+			mItems.resize(pObjectCount);
+
+			ForChunks(0, pObjectCount, true, [&](uint32_t, const uint32_t pFirst, const uint32_t pCount)
+			{
+				for (auto object = pFirst; object < pFirst + pCount; object++)
+				{
+					auto & item = mItems[object];
+					item.bounds = pBounds(object);
+					item.centroid = (item.bounds.min + item.bounds.max) * 0.5f;
+					item.object = object;
+				}
+			});
+		}
+
+		void Build(std::vector<RayBvhNode> & pNodes, std::vector<uint32_t> & pObjects)
+		{
+			pNodes.assign(1, RayBvhNode());
+
+			std::vector<Range> pending = { { 0, 0, static_cast<uint32_t>(mItems.size()), 0 } };
+			std::vector<Range> subtrees;
+
+			while (!pending.empty())
+			{
+				const auto range = pending.back();
+				pending.pop_back();
+
+				if (range.count <= SubtreeObjects)
+				{
+					subtrees.push_back(range);
+				}
+				else
+				{
+					BuildRange(range, pNodes, pending, &subtrees);
+				}
+			}
+
+			//Each subtree is built into its own nodes, its root first, then appended in the order found
+			std::vector<std::vector<RayBvhNode>> subtreeNodes(subtrees.size());
+
+			ParallelFor(static_cast<uint32_t>(subtrees.size()), mThreadCount, [&](const uint32_t pSubtree)
+			{
+				auto & nodes = subtreeNodes[pSubtree];
+				nodes.resize(1);
+
+				std::vector<Range> local = { { 0, subtrees[pSubtree].first, subtrees[pSubtree].count, subtrees[pSubtree].depth } };
+
+				while (!local.empty())
+				{
+					const auto range = local.back();
+					local.pop_back();
+					BuildRange(range, nodes, local, nullptr);
+				}
+			});
+
+			for (size_t subtree = 0; subtree < subtrees.size(); subtree++)
+			{
+				auto & nodes = subtreeNodes[subtree];
+				const auto offset = static_cast<uint32_t>(pNodes.size()) - 1;
+
+				for (auto & node : nodes)
+				{
+					if (node.count == 0)
+					{
+						node.first += offset;
+					}
+				}
+
+				pNodes[subtrees[subtree].node] = nodes[0];
+				pNodes.insert(pNodes.end(), nodes.begin() + 1, nodes.end());
+			}
+
+			pObjects.resize(mItems.size());
+
+			for (size_t i = 0; i < mItems.size(); i++)
+			{
+				pObjects[i] = mItems[i].object;
+			}
+		}
+	};
+
+}
+
+void Advanced_Rendering::BuildRayBvh(const std::vector<RayBvhBox> & pBoxes, const RayBvhOptions & pOptions, std::vector<RayBvhNode> & pNodes,
+	std::vector<uint32_t> & pObjects)
+{
+	pNodes.clear();
+	pObjects.clear();
+
+	if (pBoxes.empty())
+	{
+		return;
+	}
+
+	BvhBuilder(static_cast<uint32_t>(pBoxes.size()), pOptions, [&](const uint32_t pObject)
+	{
+		Box box;
+		box.min = pBoxes[pObject].min;
+		box.max = pBoxes[pObject].max;
+		return box;
+	}).Build(pNodes, pObjects);
+}
+
+RayBvhStats Advanced_Rendering::MeasureRayBvh(const std::vector<RayBvhNode> & pNodes, const float pTraversalCost)
+{
+	RayBvhStats stats;
+
+	if (pNodes.empty())
+	{
+		return stats;
+	}
+
+	//Walk the finished tree for its shape and cost, relative to a ray that hits the root
+	struct Visit
+	{
+		uint32_t node;
+		uint32_t depth;
+	};
+
+	const auto area = [&](const RayBvhNode & pNode)
+	{
+		Box box;
+		box.Grow(RayVector{ pNode.min[0], pNode.min[1], pNode.min[2] });
+		box.Grow(RayVector{ pNode.max[0], pNode.max[1], pNode.max[2] });
+		return box.Area();
+	};
+
+	const auto rootArea = std::max(area(pNodes[0]), std::numeric_limits<float>::min());
+	std::vector<Visit> visits = { { 0, 1 } };
+	stats.nodes = static_cast<uint32_t>(pNodes.size());
+
+	while (!visits.empty())
+	{
+		const auto visit = visits.back();
+		visits.pop_back();
+
+		const auto & node = pNodes[visit.node];
+		const auto share = area(node) / rootArea;
+
+		stats.maxDepth = std::max(stats.maxDepth, visit.depth);
+
+		if (node.count != 0)
+		{
+			stats.leaves++;
+			stats.maxLeafObjects = std::max(stats.maxLeafObjects, node.count);
+			stats.cost += share * node.count;
+		}
+		else
+		{
+			stats.cost += share * pTraversalCost;
+			visits.push_back({ node.first, visit.depth + 1 });
+			visits.push_back({ node.first + 1, visit.depth + 1 });
+		}
+	}
+
+	return stats;
+}
+
+RayBvh::RayBvh(const RayScene & pScene, const RayBvhOptions & pOptions) : mScene(&pScene)
+{
+	const auto objectCount = static_cast<uint32_t>(pScene.spheres.size() + pScene.triangles.size() + pScene.quads.size());
+
+	if (objectCount == 0)
+	{
+		return;
+	}
+
+	BvhBuilder(objectCount, pOptions, [&](const uint32_t pObject)
+	{
+		return ObjectBounds(pScene, pObject);
+	}).Build(mNodes, mObjects);
+
+	mStats = MeasureRayBvh(mNodes, pOptions.traversalCost);
+}
+
+float RayBvh::NearestHit(const RayVector & pOrigin, const RayVector & pDirection, const float pFarPlane, int & pHitObject) const
+{
+	struct Entry
+	{
+		uint32_t node;
+		float enter;
+	};
+
+	auto nearest = pFarPlane;
+	pHitObject = -1;
+
+	const RayVector inverse = { 1.0f / pDirection.x, 1.0f / pDirection.y, 1.0f / pDirection.z };
+	float enter;
+
+	if (mNodes.empty() || !EnterRayBvhNode(mNodes[0], pOrigin, inverse, nearest, enter))
+	{
+		return nearest;
+	}
+
+	Entry stack[RayBvhStackSize];
+	uint32_t stackSize = 0;
+	uint32_t node = 0;
+
+	for (;;)
+	{
+		const auto & current = mNodes[node];
+
+		if (current.count != 0)
+		{
+			for (auto i = current.first; i < current.first + current.count; i++)
+			{
+				const auto object = static_cast<int>(mObjects[i]);
+				bool hit;
+				const auto t = RayObjectIntersect(*mScene, object, pOrigin, pDirection, pFarPlane, hit);
+
+				//Leaves are not visited in object order, so equal hits go to the lower object as a scan would
+				if (hit && (t < nearest || (t == nearest && pHitObject >= 0 && object < pHitObject)))
+				{
+					nearest = t;
+					pHitObject = object;
+				}
+			}
+		}
+		else
+		{
+			auto nearChild = current.first;
+			auto farChild = current.first + 1;
+			float nearEnter, farEnter;
+
+			const auto nearHit = EnterRayBvhNode(mNodes[nearChild], pOrigin, inverse, nearest, nearEnter);
+			const auto farHit = EnterRayBvhNode(mNodes[farChild], pOrigin, inverse, nearest, farEnter);
+
+			if (nearHit && farHit)
+			{
+				if (farEnter < nearEnter)
+				{
+					std::swap(nearChild, farChild);
+					std::swap(nearEnter, farEnter);
+				}
+
+				stack[stackSize++] = { farChild, farEnter };
+				node = nearChild;
+				continue;
+			}
+
+			if (nearHit || farHit)
+			{
+				node = nearHit ? nearChild : farChild;
+				continue;
+			}
+		}
+
+		//Children pushed before a closer hit was found may now lie beyond it
+		for (;;)
+		{
+			if (stackSize == 0)
+			{
+				return nearest;
+			}
+
+			const auto & entry = stack[--stackSize];
+
+			if (!(entry.enter > nearest))
+			{
+				node = entry.node;
+				break;
+			}
+		}
+	}
+}
+
+bool RayBvh::Occluded(const RayVector & pOrigin, const RayVector & pDirection, const float pMinT, const float pMaxT) const
+{
+	const RayVector inverse = { 1.0f / pDirection.x, 1.0f / pDirection.y, 1.0f / pDirection.z };
+
+	if (mNodes.empty() || !CrossesRayBvhNode(mNodes[0], pOrigin, inverse, pMinT, pMaxT))
+	{
+		return false;
+	}
+
+	//Children are put in order along the axis the ray runs furthest in, which costs a compare
+	//rather than the two entry distances NearestHit needs
+	const auto x = std::abs(pDirection.x);
+	const auto y = std::abs(pDirection.y);
+	const auto z = std::abs(pDirection.z);
+	const auto axis = x >= y && x >= z ? 0 : y >= z ? 1 : 2;
+	const auto backwards = (axis == 0 ? pDirection.x : axis == 1 ? pDirection.y : pDirection.z) < 0.0f;
+
+	//Far children go on the stack untested, as a hit under the near one means their boxes are never needed
+	uint32_t stack[RayBvhStackSize];
+	uint32_t stackSize = 0;
+	uint32_t node = 0;
+
+	for (;;)
+	{
+		const auto & current = mNodes[node];
+
+		if (current.count != 0)
+		{
+			for (auto i = current.first; i < current.first + current.count; i++)
+			{
+				bool hit;
+				const auto t = RayObjectIntersect(*mScene, static_cast<int>(mObjects[i]), pOrigin, pDirection, pMaxT, hit);
+
+				if (hit && !(t < pMinT) && t < pMaxT)
+				{
+					return true;
+				}
+			}
+		}
+		else
+		{
+			const auto & left = mNodes[current.first];
+			const auto & right = mNodes[current.first + 1];
+			const auto leftFirst = (left.min[axis] + left.max[axis] <= right.min[axis] + right.max[axis]) != backwards;
+
+			const auto nearChild = leftFirst ? current.first : current.first + 1;
+			const auto farChild = leftFirst ? current.first + 1 : current.first;
+
+			if (CrossesRayBvhNode(mNodes[nearChild], pOrigin, inverse, pMinT, pMaxT))
+			{
+				stack[stackSize++] = farChild;
+				node = nearChild;
+				continue;
+			}
+
+			if (CrossesRayBvhNode(mNodes[farChild], pOrigin, inverse, pMinT, pMaxT))
+			{
+				node = farChild;
+				continue;
+			}
+		}
+
+		for (;;)
+		{
+			if (stackSize == 0)
+			{
+				return false;
+			}
+
+			node = stack[--stackSize];
+
+			if (CrossesRayBvhNode(mNodes[node], pOrigin, inverse, pMinT, pMaxT))
+			{
+				break;
+			}
+		}
+	}
+}
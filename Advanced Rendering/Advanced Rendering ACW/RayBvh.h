@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "RayTracer.h"
+
+namespace Advanced_Rendering
+{
+	constexpr uint32_t RayBvhBinCount = 16;
+	constexpr uint32_t RayBvhStackSize = 64;
+
+	// 32 bytes, two to a cache line. An interior node's children sit side by side from first.
+	struct RayBvhNode
+	{
+		float min[3];
+		uint32_t first;				// first child, or a leaf's first entry in the object list
+		float max[3];
+		uint32_t count;				// objects in a leaf, 0 for an interior node
+	};
+
+	struct RayBvhOptions
+	{
+		uint32_t maxLeafSize = 4;		// larger leaves are split even where the heuristic would not
+		float traversalCost = 1.0f;		// of visiting a node, against 1 for an intersection test
+		uint32_t threadCount = 0;		// 0 for every hardware thread
+	};
+
+	struct RayBvhStats
+	{
+		uint32_t nodes = 0;
+		uint32_t leaves = 0;
+		uint32_t maxDepth = 0;
+		uint32_t maxLeafObjects = 0;
+		float cost = 0.0f;				// surface area heuristic cost of the whole tree
+	};
+
+	struct RayBvhBox
+	{
+		RayVector min;
+		RayVector max;
+	};
+
+	// The builder RayBvh uses, over boxes of anything. pObjects is filled with the box numbers in
+	// leaf order. The boxes are used as they are, so padding them for rounding is up to the caller.
+	void BuildRayBvh(const std::vector<RayBvhBox> & pBoxes, const RayBvhOptions & pOptions, std::vector<RayBvhNode> & pNodes,
+		std::vector<uint32_t> & pObjects);
+
+	RayBvhStats MeasureRayBvh(const std::vector<RayBvhNode> & pNodes, float pTraversalCost);
+
+	// Where the ray enters and leaves pNode's box, pInverse being 1 over its direction. NaNs from a
+	// ray running along a face count as inside.
+	inline void RayBvhNodeSpan(const RayBvhNode & pNode, const RayVector & pOrigin, const RayVector & pInverse, float & pEnter, float & pLeave)
+	{
+		const auto x0 = (pNode.min[0] - pOrigin.x) * pInverse.x;
+		const auto x1 = (pNode.max[0] - pOrigin.x) * pInverse.x;
+		const auto y0 = (pNode.min[1] - pOrigin.y) * pInverse.y;
+		const auto y1 = (pNode.max[1] - pOrigin.y) * pInverse.y;
+		const auto z0 = (pNode.min[2] - pOrigin.z) * pInverse.z;
+		const auto z1 = (pNode.max[2] - pOrigin.z) * pInverse.z;
+
+		pEnter = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::min(z0, z1));
+		pLeave = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::max(z0, z1));
+	}
+
+	// The distance along the ray where it enters pNode's box, false when it misses or enters beyond pFarthest
+	inline bool EnterRayBvhNode(const RayBvhNode & pNode, const RayVector & pOrigin, const RayVector & pInverse, const float pFarthest, float & pEnter)
+	{
+		float leave;
+		RayBvhNodeSpan(pNode, pOrigin, pInverse, pEnter, leave);
+
+		return !(pEnter > leave) && !(pEnter > pFarthest) && !(leave < 0.0f);
+	}
+
+	// Whether the ray passes through pNode's box anywhere between pMinT and pMaxT
+	inline bool CrossesRayBvhNode(const RayBvhNode & pNode, const RayVector & pOrigin, const RayVector & pInverse, const float pMinT, const float pMaxT)
+	{
+		float enter, leave;
+		RayBvhNodeSpan(pNode, pOrigin, pInverse, enter, leave);
+
+		return !(enter > leave) && !(enter > pMaxT) && !(leave < pMinT);
+	}
+
+	// A bounding volume hierarchy over a RayScene's spheres, triangles and quads, split where the
+	// surface area heuristic finds cheapest among RayBvhBinCount bins a node per axis. The top of the
+	// tree is built on the calling thread, binning large nodes across the threads, and the subtrees
+	// below are built in parallel and joined in a fixed order, so the nodes are the same for any
+	// thread count. Queries test primitives with the shader's own intersection code and return the
+	// hits NearestRayHit does, ties going to the lower object as they do there.
+	class RayBvh
+	{
+		const RayScene * mScene = nullptr;
+		std::vector<RayBvhNode> mNodes;
+		std::vector<uint32_t> mObjects;		// object numbers in leaf order
+		RayBvhStats mStats;
+
+	public:
+		// pScene must outlive the hierarchy and not change while it is in use
+		RayBvh(const RayScene & pScene, const RayBvhOptions & pOptions = RayBvhOptions());
+		~RayBvh() = default;
+
+		RayBvh(const RayBvh &) = delete;
+		RayBvh(RayBvh &&) = delete;
+		RayBvh & operator= (const RayBvh &) = delete;
+		RayBvh & operator= (RayBvh &&) = delete;
+
+		// NearestRayHit through the hierarchy, visiting the nearer child first and skipping nodes
+		// entered beyond the closest hit so far
+		float NearestHit(const RayVector & pOrigin, const RayVector & pDirection, float pFarPlane, int & pHitObject) const;
+
+		// Whether any primitive is hit from pMinT up to, but not at, pMaxT, the test the shader's
+		// Shadow makes against the light's distance. Returns at the first such hit without looking for
+		// the nearest, and goes down the child lying further along the ray's main axis second.
+		bool Occluded(const RayVector & pOrigin, const RayVector & pDirection, float pMinT, float pMaxT) const;
+
+		const RayScene & Scene() const
+		{
+			return *mScene;
+		}
+
+		const std::vector<RayBvhNode> & Nodes() const
+		{
+			return mNodes;
+		}
+
+		const std::vector<uint32_t> & Objects() const
+		{
+			return mObjects;
+		}
+
+		const RayBvhStats & Stats() const
+		{
+			return mStats;
+		}
+	};
+}
@@ -0,0 +1,327 @@
+#include "RayInstances.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr float BoundsPadding = 1e-4f;			// of a box's size and distance from the origin, as RayBvh pads
+
+	//The ray in an instance's space, scaled to unit length, and what that scale does to distances
+	struct ObjectRay
+	{
+		RayVector origin;
+		RayVector direction;
+		float scale;
+	};
+
+	ObjectRay ToObject(const RayTransform & pWorldToObject, const RayVector & pOrigin, const RayVector & pDirection)
+	{
+		ObjectRay ray;
+		const auto direction = pWorldToObject.Direction(pDirection);
+
+		ray.origin = pWorldToObject.Point(pOrigin);
+		ray.scale = direction.Length();
+		ray.direction = direction * (1.0f / ray.scale);
+
+		return ray;
+	}
+
+	//The box round the 8 corners of pNode's, carried out to the world
+	RayBvhBox WorldBounds(const RayTransform & pObjectToWorld, const RayBvhNode & pNode)
+	{
+		RayBvhBox box;
+		box.min = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+		box.max = { -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+
+		for (auto corner = 0; corner < 8; corner++)
+		{
+			const auto point = pObjectToWorld.Point({
+				(corner & 1) ? pNode.max[0] : pNode.min[0],
+				(corner & 2) ? pNode.max[1] : pNode.min[1],
+				(corner & 4) ? pNode.max[2] : pNode.min[2] });
+
+			box.min = { std::min(box.min.x, point.x), std::min(box.min.y, point.y), std::min(box.min.z, point.z) };
+			box.max = { std::max(box.max.x, point.x), std::max(box.max.y, point.y), std::max(box.max.z, point.z) };
+		}
+
+		//The corners are rounded on the way out, so the box is padded again as the mesh's own were
+		const auto size = box.max - box.min;
+		const auto reach = std::max(std::max(std::abs(box.min.x), std::abs(box.max.x)), std::max(std::max(std::abs(box.min.y), std::abs(box.max.y)),
+			std::max(std::abs(box.min.z), std::abs(box.max.z))));
+		const auto padding = BoundsPadding * (std::max(std::max(size.x, size.y), size.z) + reach);
+
+		box.min = box.min - RayVector{ padding, padding, padding };
+		box.max = box.max + RayVector{ padding, padding, padding };
+
+		return box;
+	}
+}
+
+RayTransform Advanced_Rendering::MakeRayTransform(const float pScale, const float pYaw, const RayVector & pTranslation)
+{
+	const auto c = std::cos(pYaw) * pScale;
+	const auto s = std::sin(pYaw) * pScale;
+
+	//XMMatrixRotationY's turn, x towards -z
+	RayTransform transform;
+	transform.rows[0][0] = c;
+	transform.rows[0][2] = s;
+	transform.rows[1][1] = pScale;
+	transform.rows[2][0] = -s;
+	transform.rows[2][2] = c;
+	transform.rows[0][3] = pTranslation.x;
+	transform.rows[1][3] = pTranslation.y;
+	transform.rows[2][3] = pTranslation.z;
+
+	return transform;
+}
+
+bool Advanced_Rendering::InvertRayTransform(const RayTransform & pTransform, RayTransform & pInverse)
+{
+	const auto & m = pTransform.rows;
+
+	//Cofactors of the 3x3, the inverse being their transpose over the determinant
+	const float cofactors[3][3] =
+	{
+		{ m[1][1] * m[2][2] - m[1][2] * m[2][1], m[1][2] * m[2][0] - m[1][0] * m[2][2], m[1][0] * m[2][1] - m[1][1] * m[2][0] },
+		{ m[0][2] * m[2][1] - m[0][1] * m[2][2], m[0][0] * m[2][2] - m[0][2] * m[2][0], m[0][1] * m[2][0] - m[0][0] * m[2][1] },
+		{ m[0][1] * m[1][2] - m[0][2] * m[1][1], m[0][2] * m[1][0] - m[0][0] * m[1][2], m[0][0] * m[1][1] - m[0][1] * m[1][0] }
+	};
+
+	const auto determinant = m[0][0] * cofactors[0][0] + m[0][1] * cofactors[0][1] + m[0][2] * cofactors[0][2];
+
+	if (!(std::abs(determinant) > std::numeric_limits<float>::min()))
+	{
+		return false;
+	}
+
+	RayTransform inverse;
+
+	for (auto row = 0; row < 3; row++)
+	{
+		for (auto column = 0; column < 3; column++)
+		{
+			inverse.rows[row][column] = cofactors[column][row] / determinant;
+		}
+	}
+
+	const auto translation = inverse.Direction({ m[0][3], m[1][3], m[2][3] });
+
+	inverse.rows[0][3] = -translation.x;
+	inverse.rows[1][3] = -translation.y;
+	inverse.rows[2][3] = -translation.z;
+
+	pInverse = inverse;
+	return true;
+}
+
+RayInstanceBvh::RayInstanceBvh(const std::vector<const RayBvh *> & pMeshes, const std::vector<RayInstance> & pInstances, const RayBvhOptions & pOptions) :
+	mMeshes(pMeshes), mInstances(pInstances), mWorldToObject(pInstances.size())
+{
+	std::vector<RayBvhBox> boxes;
+	std::vector<uint32_t> placed;		// instance numbers of the boxes
+
+	boxes.reserve(mInstances.size());
+	placed.reserve(mInstances.size());
+
+	for (size_t i = 0; i < mInstances.size(); i++)
+	{
+		const auto & instance = mInstances[i];
+
+		if (instance.mesh >= mMeshes.size() || mMeshes[instance.mesh]->Nodes().empty() ||
+			!InvertRayTransform(instance.objectToWorld, mWorldToObject[i]))
+		{
+			continue;
+		}
+
+		boxes.push_back(WorldBounds(instance.objectToWorld, mMeshes[instance.mesh]->Nodes()[0]));
+		placed.push_back(static_cast<uint32_t>(i));
+	}
+
+	BuildRayBvh(boxes, pOptions, mNodes, mOrder);
+
+	for (auto & box : mOrder)
+	{
+		box = placed[box];
+	}
+
+	mStats = MeasureRayBvh(mNodes, pOptions.traversalCost);
+}
+
+float RayInstanceBvh::NearestHit(const RayVector & pOrigin, const RayVector & pDirection, const float pFarPlane, int & pHitInstance, int & pHitObject) const
+{
+	struct Entry
+	{
+		uint32_t node;
+		float enter;
+	};
+
+	auto nearest = pFarPlane;
+	pHitInstance = -1;
+	pHitObject = -1;
+
+	const RayVector inverse = { 1.0f / pDirection.x, 1.0f / pDirection.y, 1.0f / pDirection.z };
+	float enter;
+
+	if (mNodes.empty() || !EnterRayBvhNode(mNodes[0], pOrigin, inverse, nearest, enter))
+	{
+		return nearest;
+	}
+
+	Entry stack[RayBvhStackSize];
+	uint32_t stackSize = 0;
+	uint32_t node = 0;
+
+	for (;;)
+	{
+		const auto & current = mNodes[node];
+
+		if (current.count != 0)
+		{
+			for (auto i = current.first; i < current.first + current.count; i++)
+			{
+				const auto instance = mOrder[i];
+				const auto ray = ToObject(mWorldToObject[instance], pOrigin, pDirection);
+
+				//The mesh's hierarchy stops at the closest hit so far, measured in its own space
+				int object;
+				const auto t = mMeshes[mInstances[instance].mesh]->NearestHit(ray.origin, ray.direction, nearest * ray.scale, object) / ray.scale;
+
+				if (object >= 0 && t < nearest)
+				{
+					nearest = t;
+					pHitInstance = static_cast<int>(instance);
+					pHitObject = object;
+				}
+			}
+		}
+		else
+		{
+			auto nearChild = current.first;
+			auto farChild = current.first + 1;
+			float nearEnter, farEnter;
+
+			const auto nearHit = EnterRayBvhNode(mNodes[nearChild], pOrigin, inverse, nearest, nearEnter);
+			const auto farHit = EnterRayBvhNode(mNodes[farChild], pOrigin, inverse, nearest, farEnter);
+
+			if (nearHit && farHit)
+			{
+				if (farEnter < nearEnter)
+				{
+					std::swap(nearChild, farChild);
+					std::swap(nearEnter, farEnter);
+				}
+
+				stack[stackSize++] = { farChild, farEnter };
+				node = nearChild;
+				continue;
+			}
+
+			if (nearHit || farHit)
+			{
+				node = nearHit ? nearChild : farChild;
+				continue;
+			}
+		}
+
+		for (;;)
+		{
+			if (stackSize == 0)
+			{
+				return nearest;
+			}
+
+			const auto & entry = stack[--stackSize];
+
+			if (!(entry.enter > nearest))
+			{
+				node = entry.node;
+				break;
+			}
+		}
+	}
+}
+
+bool RayInstanceBvh::Occluded(const RayVector & pOrigin, const RayVector & pDirection, const float pMinT, const float pMaxT) const
+{
+	const RayVector inverse = { 1.0f / pDirection.x, 1.0f / pDirection.y, 1.0f / pDirection.z };
+
+	if (mNodes.empty() || !CrossesRayBvhNode(mNodes[0], pOrigin, inverse, pMinT, pMaxT))
+	{
+		return false;
+	}
+
+	//Instances overlap far less than a mesh's triangles do, so the children are simply taken in order
+	uint32_t stack[RayBvhStackSize];
+	uint32_t stackSize = 0;
+	uint32_t node = 0;
+
+	for (;;)
+	{
+		const auto & current = mNodes[node];
+
+		if (current.count != 0)
+		{
+			for (auto i = current.first; i < current.first + current.count; i++)
+			{
+				const auto instance = mOrder[i];
+				const auto ray = ToObject(mWorldToObject[instance], pOrigin, pDirection);
+
+				if (mMeshes[mInstances[instance].mesh]->Occluded(ray.origin, ray.direction, pMinT * ray.scale, pMaxT * ray.scale))
+				{
+					return true;
+				}
+			}
+		}
+		else
+		{
+			if (CrossesRayBvhNode(mNodes[current.first], pOrigin, inverse, pMinT, pMaxT))
+			{
+				stack[stackSize++] = current.first + 1;
+				node = current.first;
+				continue;
+			}
+
+			if (CrossesRayBvhNode(mNodes[current.first + 1], pOrigin, inverse, pMinT, pMaxT))
+			{
+				node = current.first + 1;
+				continue;
+			}
+		}
+
+		for (;;)
+		{
+			if (stackSize == 0)
+			{
+				return false;
+			}
+
+			node = stack[--stackSize];
+
+			if (CrossesRayBvhNode(mNodes[node], pOrigin, inverse, pMinT, pMaxT))
+			{
+				break;
+			}
+		}
+	}
+}
+
+RaySurface RayInstanceBvh::Surface(const int pHitInstance, const int pHitObject, const RayVector & pHitPosition) const
+{
+	const auto & worldToObject = mWorldToObject[pHitInstance];
+	auto surface = HitSurface(mMeshes[mInstances[pHitInstance].mesh]->Scene(), pHitObject, worldToObject.Point(pHitPosition));
+
+	surface.normal = worldToObject.TransposedDirection(surface.normal).Normalized();
+
+	return surface;
+}
+
+size_t RayInstanceBvh::Bytes() const
+{
+	return mMeshes.size() * sizeof(const RayBvh *) + mInstances.size() * (sizeof(RayInstance) + sizeof(RayTransform)) +
+		mNodes.size() * sizeof(RayBvhNode) + mOrder.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "RayBvh.h"
+#include "RayTracer.h"
+
+namespace Advanced_Rendering
+{
+	// An affine transform as the 3 rows of a 3x4 matrix taking a column point (x, y, z, 1)
+	struct RayTransform
+	{
+		float rows[3][4] = { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } };
+
+		RayVector Point(const RayVector & pPoint) const
+		{
+			return Direction(pPoint) + RayVector{ rows[0][3], rows[1][3], rows[2][3] };
+		}
+
+		RayVector Direction(const RayVector & pDirection) const
+		{
+			return {
+				rows[0][0] * pDirection.x + rows[0][1] * pDirection.y + rows[0][2] * pDirection.z,
+				rows[1][0] * pDirection.x + rows[1][1] * pDirection.y + rows[1][2] * pDirection.z,
+				rows[2][0] * pDirection.x + rows[2][1] * pDirection.y + rows[2][2] * pDirection.z
+			};
+		}
+
+		// Through the transpose of the 3x3, which for the inverse of a transform carries its normals
+		RayVector TransposedDirection(const RayVector & pDirection) const
+		{
+			return {
+				rows[0][0] * pDirection.x + rows[1][0] * pDirection.y + rows[2][0] * pDirection.z,
+				rows[0][1] * pDirection.x + rows[1][1] * pDirection.y + rows[2][1] * pDirection.z,
+				rows[0][2] * pDirection.x + rows[1][2] * pDirection.y + rows[2][2] * pDirection.z
+			};
+		}
+	};
+
+	// Scaled by pScale, turned pYaw radians about y, then moved by pTranslation, which with a yaw of 0
+	// is XMMatrixScaling * XMMatrixTranslation as the rocks are drawn
+	RayTransform MakeRayTransform(float pScale, float pYaw, const RayVector & pTranslation);
+
+	// False, leaving pInverse alone, when the transform flattens space and has none
+	bool InvertRayTransform(const RayTransform & pTransform, RayTransform & pInverse);
+
+	struct RayInstance
+	{
+		uint32_t mesh;					// into the hierarchies RayInstanceBvh is given
+		RayTransform objectToWorld;
+	};
+
+	// A top level hierarchy over instances of meshes that each have their own RayBvh, built once in
+	// the mesh's space however many times it is placed. A ray reaching an instance is taken into its
+	// space and normalised, as the shader's intersection tests expect, and the distances scaled back,
+	// so hits match those of the mesh copied into the world to rounding. An instance costs its
+	// transforms and a share of the top level however big its mesh is, and moving instances only
+	// needs the top level built again.
+	class RayInstanceBvh
+	{
+		std::vector<const RayBvh *> mMeshes;
+		std::vector<RayInstance> mInstances;
+		std::vector<RayTransform> mWorldToObject;
+		std::vector<RayBvhNode> mNodes;
+		std::vector<uint32_t> mOrder;		// instance numbers in leaf order
+		RayBvhStats mStats;
+
+	public:
+		// The meshes must outlive the hierarchy. An instance whose transform has no inverse, or whose
+		// mesh is out of range or empty, is left out of the top level and never hit.
+		RayInstanceBvh(const std::vector<const RayBvh *> & pMeshes, const std::vector<RayInstance> & pInstances,
+			const RayBvhOptions & pOptions = RayBvhOptions());
+		~RayInstanceBvh() = default;
+
+		RayInstanceBvh(const RayInstanceBvh &) = delete;
+		RayInstanceBvh(RayInstanceBvh &&) = delete;
+		RayInstanceBvh & operator= (const RayInstanceBvh &) = delete;
+		RayInstanceBvh & operator= (RayInstanceBvh &&) = delete;
+
+		// RayBvh::NearestHit over every instance, pDirection being of unit length. pHitObject is
+		// numbered within pHitInstance's mesh, both -1 when nothing is hit.
+		float NearestHit(const RayVector & pOrigin, const RayVector & pDirection, float pFarPlane, int & pHitInstance, int & pHitObject) const;
+
+		// RayBvh::Occluded over every instance
+		bool Occluded(const RayVector & pOrigin, const RayVector & pDirection, float pMinT, float pMaxT) const;
+
+		// HitSurface of the mesh at the hit, with the normal brought out to the world
+		RaySurface Surface(int pHitInstance, int pHitObject, const RayVector & pHitPosition) const;
+
+		// What the top level and the instances take, leaving out the meshes they share
+		size_t Bytes() const;
+
+		const std::vector<RayInstance> & Instances() const
+		{
+			return mInstances;
+		}
+
+		const RayBvhStats & Stats() const
+		{
+			return mStats;
+		}
+	};
+}
@@ -0,0 +1,856 @@
+#include "RayMarcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include "Parallel.h"
+#include "TileScheduler.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr float MarchEpsilon = 0.005f;			// RayMarchingPixelShader.hlsl's EPSILON
+	constexpr float Pi = 3.14159265f;
+
+	//HLSL's intrinsics, as the shader uses them
+
+	float Clamp(const float pValue, const float pMin, const float pMax)
+	{
+		return std::min(std::max(pValue, pMin), pMax);
+	}
+
+	float Saturate(const float pValue)
+	{
+		return Clamp(pValue, 0.0f, 1.0f);
+	}
+
+	float Sign(const float pValue)
+	{
+		return pValue > 0.0f ? 1.0f : pValue < 0.0f ? -1.0f : 0.0f;
+	}
+
+	float Frac(const float pValue)
+	{
+		return pValue - std::floor(pValue);
+	}
+
+	float Lerp(const float pA, const float pB, const float pT)
+	{
+		return pA + (pB - pA) * pT;
+	}
+
+	RayVector Lerp(const RayVector & pA, const RayVector & pB, const float pT)
+	{
+		return pA + (pB - pA) * pT;
+	}
+
+	float Smoothstep(const float pMin, const float pMax, const float pValue)
+	{
+		const auto t = Saturate((pValue - pMin) / (pMax - pMin));
+		return t * t * (3.0f - 2.0f * t);
+	}
+
+	float Length(const float pX, const float pY)
+	{
+		return std::sqrt(pX * pX + pY * pY);
+	}
+
+	RayVector Abs(const RayVector & pVector)
+	{
+		return { std::abs(pVector.x), std::abs(pVector.y), std::abs(pVector.z) };
+	}
+
+	RayVector Max0(const RayVector & pVector)
+	{
+		return { std::max(pVector.x, 0.0f), std::max(pVector.y, 0.0f), std::max(pVector.z, 0.0f) };
+	}
+
+	RayVector Divide(const RayVector & pA, const RayVector & pB)
+	{
+		return { pA.x / pB.x, pA.y / pB.y, pA.z / pB.z };
+	}
+
+	//Distance functions, as the shader takes them from iquilezles.org
+
+	float SdSphere(const RayVector & pPosition, const float pRadius)
+	{
+		return pPosition.Length() - pRadius;
+	}
+
+	float SdBox(const RayVector & pPosition, const RayVector & pSize)
+	{
+		const auto q = Abs(pPosition) - pSize;
+		return Max0(q).Length() + std::min(std::max(q.x, std::max(q.y, q.z)), 0.0f);
+	}
+
+	float SdRoundBox(const RayVector & pPosition, const RayVector & pSize, const float pRadius)
+	{
+		return SdBox(pPosition, pSize) - pRadius;
+	}
+
+	float SdHexPrism(RayVector pPosition, const float pRadius, const float pHeight)
+	{
+		const RayVector k = { -0.8660254f, 0.5f, 0.57735f };
+
+		pPosition = Abs(pPosition);
+
+		const auto fold = 2.0f * std::min(k.x * pPosition.x + k.y * pPosition.y, 0.0f);
+		pPosition.x -= fold * k.x;
+		pPosition.y -= fold * k.y;
+
+		const auto dx = Length(pPosition.x - Clamp(pPosition.x, -k.z * pRadius, k.z * pRadius), pPosition.y - pRadius) * Sign(pPosition.y - pRadius);
+		const auto dy = pPosition.z - pHeight;
+
+		return std::min(std::max(dx, dy), 0.0f) + Length(std::max(dx, 0.0f), std::max(dy, 0.0f));
+	}
+
+	float SdTriPrism(RayVector pPosition, float pRadius, const float pHeight)
+	{
+		const auto k = std::sqrt(3.0f);
+
+		pRadius *= 0.5f * k;
+		pPosition.x /= pRadius;
+		pPosition.y /= pRadius;
+		pPosition.x = std::abs(pPosition.x) - 1.0f;
+		pPosition.y = pPosition.y + 1.0f / k;
+
+		if (pPosition.x + k * pPosition.y > 0.0f)
+		{
+			const auto x = pPosition.x;
+			pPosition.x = (x - k * pPosition.y) / 2.0f;
+			pPosition.y = (-k * x - pPosition.y) / 2.0f;
+		}
+
+		pPosition.x -= Clamp(pPosition.x, -2.0f, 0.0f);
+
+		const auto d1 = Length(pPosition.x, pPosition.y) * Sign(-pPosition.y) * pRadius;
+		const auto d2 = std::abs(pPosition.z) - pHeight;
+
+		return Length(std::max(d1, 0.0f), std::max(d2, 0.0f)) + std::min(std::max(d1, d2), 0.0f);
+	}
+
+	float SdVerticalCapsule(RayVector pPosition, const float pHeight, const float pRadius)
+	{
+		pPosition.y -= Clamp(pPosition.y, 0.0f, pHeight);
+		return pPosition.Length() - pRadius;
+	}
+
+	float SdCappedCylinder(const RayVector & pPosition, const RayVector & pA, const RayVector & pB, const float pRadius)
+	{
+		const auto ba = pB - pA;
+		const auto pa = pPosition - pA;
+		const auto baba = ba.Dot(ba);
+		const auto paba = pa.Dot(ba);
+		const auto x = (pa * baba - ba * paba).Length() - pRadius * baba;
+		const auto y = std::abs(paba - baba * 0.5f) - baba * 0.5f;
+		const auto x2 = x * x;
+		const auto y2 = y * y * baba;
+		const auto d = std::max(x, y) < 0.0f ? -std::min(x2, y2) : (x > 0.0f ? x2 : 0.0f) + (y > 0.0f ? y2 : 0.0f);
+
+		return Sign(d) * std::sqrt(std::abs(d)) / baba;
+	}
+
+	float SdCappedCone(const RayVector & pPosition, const float pHeight, const float pRadius1, const float pRadius2)
+	{
+		const auto qx = Length(pPosition.x, pPosition.z);
+		const auto qy = pPosition.y;
+		const auto k2x = pRadius2 - pRadius1;
+		const auto k2y = 2.0f * pHeight;
+
+		const auto cax = qx - std::min(qx, qy < 0.0f ? pRadius1 : pRadius2);
+		const auto cay = std::abs(qy) - pHeight;
+		const auto t = Clamp(((pRadius2 - qx) * k2x + (pHeight - qy) * k2y) / (k2x * k2x + k2y * k2y), 0.0f, 1.0f);
+		const auto cbx = qx - pRadius2 + k2x * t;
+		const auto cby = qy - pHeight + k2y * t;
+		const auto s = cbx < 0.0f && cay < 0.0f ? -1.0f : 1.0f;
+
+		return s * std::sqrt(std::min(cax * cax + cay * cay, cbx * cbx + cby * cby));
+	}
+
+	float SdRoundCone(const RayVector & pPosition, const float pRadius1, const float pRadius2, const float pHeight)
+	{
+		const auto qx = Length(pPosition.x, pPosition.z);
+		const auto qy = pPosition.y;
+
+		const auto b = (pRadius1 - pRadius2) / pHeight;
+		const auto a = std::sqrt(1.0f - b * b);
+		const auto k = qx * -b + qy * a;
+
+		if (k < 0.0f)
+		{
+			return Length(qx, qy) - pRadius1;
+		}
+
+		if (k > a * pHeight)
+		{
+			return Length(qx, qy - pHeight) - pRadius2;
+		}
+
+		return qx * a + qy * b - pRadius1;
+	}
+
+	float SdEllipsoid(const RayVector & pPosition, const RayVector & pRadii)
+	{
+		const auto k0 = Divide(pPosition, pRadii).Length();
+		const auto k1 = Divide(pPosition, RayVector{ pRadii.x * pRadii.x, pRadii.y * pRadii.y, pRadii.z * pRadii.z }).Length();
+
+		return k0 * (k0 - 1.0f) / k1;
+	}
+
+	float SdTorus(const RayVector & pPosition, const float pRadius, const float pThickness)
+	{
+		return Length(Length(pPosition.x, pPosition.z) - pRadius, pPosition.y) - pThickness;
+	}
+
+	float SdOctahedron(RayVector pPosition, const float pSize)
+	{
+		pPosition = Abs(pPosition);
+
+		const auto m = pPosition.x + pPosition.y + pPosition.z - pSize;
+		RayVector q;
+
+		if (3.0f * pPosition.x < m)
+		{
+			q = pPosition;
+		}
+		else if (3.0f * pPosition.y < m)
+		{
+			q = { pPosition.y, pPosition.z, pPosition.x };
+		}
+		else if (3.0f * pPosition.z < m)
+		{
+			q = { pPosition.z, pPosition.x, pPosition.y };
+		}
+		else
+		{
+			return m * 0.57735027f;
+		}
+
+		const auto k = Clamp(0.5f * (q.z - q.y + pSize), 0.0f, pSize);
+		return RayVector{ q.x, q.y - pSize + k, q.z - k }.Length();
+	}
+
+	float SdPyramid(RayVector pPosition, const float pHeight)
+	{
+		const auto m2 = pHeight * pHeight + 0.25f;
+
+		pPosition.x = std::abs(pPosition.x);
+		pPosition.z = std::abs(pPosition.z);
+
+		if (pPosition.z > pPosition.x)
+		{
+			std::swap(pPosition.x, pPosition.z);
+		}
+
+		pPosition.x -= 0.5f;
+		pPosition.z -= 0.5f;
+
+		const RayVector q = { pPosition.z, pHeight * pPosition.y - 0.5f * pPosition.x, pHeight * pPosition.x + 0.5f * pPosition.y };
+
+		const auto s = std::max(-q.x, 0.0f);
+		const auto t = Clamp((q.y - 0.5f * pPosition.z) / (m2 + 0.25f), 0.0f, 1.0f);
+
+		const auto a = m2 * (q.x + s) * (q.x + s) + q.y * q.y;
+		const auto b = m2 * (q.x + 0.5f * t) * (q.x + 0.5f * t) + (q.y - m2 * t) * (q.y - m2 * t);
+
+		const auto d2 = std::min(q.y, -q.x * m2 - q.y * 0.5f) > 0.0f ? 0.0f : std::min(a, b);
+
+		return std::sqrt((d2 + q.z * q.z) / m2) * Sign(std::max(q.z, -pPosition.y));
+	}
+
+	//Blending
+
+	float SoftAbs2(const float pX, const float pA)
+	{
+		const auto xx = 2.0f * pX / pA;
+		auto abs2 = std::abs(xx);
+
+		if (abs2 < 2.0f)
+		{
+			abs2 = 0.5f * xx * xx * (1.0f - abs2 / 6.0f) + 2.0f / 3.0f;
+		}
+
+		return abs2 * pA / 2.0f;
+	}
+
+	float SoftMin2(const float pX, const float pY, const float pA)
+	{
+		return -0.5f * (-pX - pY + SoftAbs2(pX - pY, pA));
+	}
+
+	float SoftMax2(const float pX, const float pY, const float pA)
+	{
+		return 0.5f * (pX + pY + SoftAbs2(pX - pY, pA));
+	}
+
+	float Subtract(const float pShape1, const float pShape2)
+	{
+		return std::max(pShape1, -pShape2);
+	}
+
+	//Perlin noise, as the shader adapts it from thebookofshaders.com
+
+	float Random(const float pX, const float pY)
+	{
+		return Frac(std::sin(pX * 12.9898f + pY * 78.233f) * 43758.543123f);
+	}
+
+	float Noise(const float pX, const float pY)
+	{
+		const auto ix = std::floor(pX);
+		const auto iy = std::floor(pY);
+		const auto fx = Frac(pX);
+		const auto fy = Frac(pY);
+
+		const auto a = Random(ix, iy);
+		const auto b = Random(ix + 1.0f, iy);
+		const auto c = Random(ix, iy + 1.0f);
+		const auto d = Random(ix + 1.0f, iy + 1.0f);
+
+		const auto ux = fx * fx * fx * (fx * (fx * 6.0f - 15.0f) + 10.0f);
+		const auto uy = fy * fy * fy * (fy * (fy * 6.0f - 15.0f) + 10.0f);
+
+		return Lerp(a, b, ux) + (c - a) * uy * (1.0f - ux) + (d - b) * ux * uy;
+	}
+
+	//The shader's blend from 0 at one corner to 1 along the two far edges
+	float CornerBlend(const float pU, const float pV)
+	{
+		const auto a = 0.0f, b = 1.0f, c = 1.0f, d = 1.0f;
+		return Lerp(a, b, pU) + (c - a) * pV * (1.0f - pU) + (d - b) * pU * pV;
+	}
+
+	enum class TerrainRegion
+	{
+		Path,				// flat under the colonnade and temple
+		PathEdge,			// blending from the path into the hills
+		Field,				// flat either side, out to the walls
+		FieldEdge,
+		Hills
+	};
+
+	//sdTerrain and sdTerrainColor make the same tests in the same order, so they share them here.
+	//pBlend is how far an edge has gone over to the hills.
+	TerrainRegion FindTerrainRegion(const RayVector & pPosition, float & pBlend)
+	{
+		const auto x = std::abs(pPosition.x);
+		const auto z = pPosition.z;
+
+		pBlend = 0.0f;
+
+		if (x < 10.0f && z > 0.0f && z < 100.0f)
+		{
+			return TerrainRegion::Path;
+		}
+
+		if (x < 15.0f && z > -5.0f && z < 105.0f)
+		{
+			if (x < 15.0f && z > 0.0f && z < 100.0f)
+			{
+				pBlend = Smoothstep(10.0f, 15.0f, x);
+			}
+
+			if (z < 0.0f)
+			{
+				pBlend = 1.0f - Smoothstep(-5.0f, 0.0f, z);
+			}
+
+			if (z > 100.0f)
+			{
+				pBlend = Smoothstep(100.0f, 105.0f, z);
+			}
+
+			if (x < 15.0f && z > -5.0f)
+			{
+				pBlend = CornerBlend(Smoothstep(10.0f, 15.0f, x), 1.0f - Smoothstep(-5.0f, 0.0f, z));
+			}
+
+			if (x < 15.0f && z > 100.0f)
+			{
+				pBlend = CornerBlend(Smoothstep(10.0f, 15.0f, x), Smoothstep(100.0f, 105.0f, z));
+			}
+
+			return TerrainRegion::PathEdge;
+		}
+
+		if (x > 50.0f && x < 150.0f && z > 0.0f && z < 100.0f)
+		{
+			return TerrainRegion::Field;
+		}
+
+		if (x > 45.0f && x < 155.0f && z > -5.0f && z < 105.0f)
+		{
+			if (x < 50.0f && z > 0.0f && z < 100.0f)
+			{
+				pBlend = 1.0f - Smoothstep(45.0f, 50.0f, x);
+			}
+
+			if (x > 150.0f && z > 0.0f && z < 100.0f)
+			{
+				pBlend = Smoothstep(150.0f, 155.0f, x);
+			}
+
+			if (z < 0.0f)
+			{
+				pBlend = 1.0f - Smoothstep(-5.0f, 0.0f, z);
+			}
+
+			if (z > 100.0f)
+			{
+				pBlend = Smoothstep(100.0f, 105.0f, z);
+			}
+
+			if (x < 155.0f && x > 150.0f && z > -5.0f)
+			{
+				pBlend = CornerBlend(Smoothstep(150.0f, 155.0f, x), 1.0f - Smoothstep(-5.0f, 0.0f, z));
+			}
+
+			if (x < 155.0f && x > 150.0f && z > 100.0f)
+			{
+				pBlend = CornerBlend(Smoothstep(150.0f, 155.0f, x), Smoothstep(100.0f, 105.0f, z));
+			}
+
+			if (x < 50.0f && x > 45.0f && z > -5.0f)
+			{
+				pBlend = CornerBlend(1.0f - Smoothstep(45.0f, 50.0f, x), 1.0f - Smoothstep(-5.0f, 0.0f, z));
+			}
+
+			if (x < 50.0f && x > 45.0f && z > 100.0f)
+			{
+				pBlend = CornerBlend(1.0f - Smoothstep(45.0f, 50.0f, x), Smoothstep(100.0f, 105.0f, z));
+			}
+
+			return TerrainRegion::FieldEdge;
+		}
+
+		return TerrainRegion::Hills;
+	}
+
+	float SdTerrain(const RayVector & pPosition)
+	{
+		float blend;
+		const auto region = FindTerrainRegion(pPosition, blend);
+
+		const auto flat = [&]()
+		{
+			return pPosition.y - Noise(pPosition.x * 10.0f, pPosition.z * 10.0f) * 0.01f;
+		};
+
+		const auto hills = [&]()
+		{
+			return pPosition.y - Noise(pPosition.x * 0.1f, pPosition.z * 0.1f) * 2.0f;
+		};
+
+		switch (region)
+		{
+		case TerrainRegion::Path:
+		case TerrainRegion::Field:
+			return flat();
+		case TerrainRegion::PathEdge:
+		case TerrainRegion::FieldEdge:
+			return Lerp(flat(), hills(), blend);
+		default:
+			return hills();
+		}
+	}
+
+	RayVector TerrainColor(const RayVector & pPosition)
+	{
+		auto octaves = Noise(pPosition.x, pPosition.z) * 0.5f;
+		octaves += Noise(pPosition.x * 2.0f, pPosition.z * 2.0f) * 0.25f;
+		octaves += Noise(pPosition.x * 4.0f, pPosition.z * 4.0f) * 0.125f;
+		octaves += Noise(pPosition.x * 8.0f, pPosition.z * 8.0f) * 0.0675f;
+
+		const auto green = Lerp(RayVector{ 0.0f, 1.0f, 0.0f }, RayVector{ 1.0f, 0.5f, 0.0f }, octaves);
+		const RayVector grey = { 0.7f, 0.7f, 0.7f };
+
+		float blend;
+
+		switch (FindTerrainRegion(pPosition, blend))
+		{
+		case TerrainRegion::Path:
+		case TerrainRegion::Field:
+			return Lerp(grey, green, Noise(pPosition.x * 20.0f, pPosition.z * 20.0f) * 0.1f);
+		case TerrainRegion::PathEdge:
+		case TerrainRegion::FieldEdge:
+			return Lerp(grey, green, blend);
+		default:
+			return green;
+		}
+	}
+
+	//A column of the colonnade and temple, before its fluting
+	float SdPillar(const RayVector & pPosition)
+	{
+		const auto boxBottom = SdRoundBox(pPosition - RayVector{ 2.5f, 0.25f, 0.0f }, { 1.0f, 0.25f, 1.0f }, 0.1f);
+		const auto boxTop = SdRoundBox(pPosition - RayVector{ 2.5f, 9.75f, 0.0f }, { 1.0f, 0.25f, 1.0f }, 0.1f);
+		const auto cylinder = SdCappedCylinder(pPosition, { 2.5f, 0.5f, 0.0f }, { 2.5f, 9.5f, 0.0f }, 0.75f);
+
+		return SoftMin2(SoftMin2(boxBottom, cylinder, 1.0f), boxTop, 1.0f);
+	}
+
+	//The position folded into one 10 unit square of a row of columns
+	RayVector ColumnCell(const RayVector & pPosition)
+	{
+		return { std::fmod(std::abs(pPosition.x), 10.0f) - 5.0f, pPosition.y, std::fmod(std::abs(pPosition.z), 10.0f) - 5.0f };
+	}
+
+	void SetColor(MarchObject & pObject, const float pRed, const float pGreen, const float pBlue)
+	{
+		pObject.color[0] = pRed;
+		pObject.color[1] = pGreen;
+		pObject.color[2] = pBlue;
+		pObject.color[3] = 1.0f;
+	}
+
+	void Nearer(MarchObject & pObject, const float pDistance, const float pRed, const float pGreen, const float pBlue)
+	{
+		if (pDistance < pObject.distance)
+		{
+			pObject.distance = pDistance;
+			SetColor(pObject, pRed, pGreen, pBlue);
+		}
+	}
+
+	//The shape gallery beyond the walls, four rows of four repeated every 30 units
+	void Gallery(const RayVector & pPosition, MarchObject & pObject)
+	{
+		const auto foldX = std::fmod(std::abs(pPosition.x), 30.0f);
+		const auto foldZ = std::fmod(std::abs(pPosition.z), 30.0f);
+
+		auto row = [&](const float pX)
+		{
+			return RayVector{ foldX - pX, pPosition.y - 5.0f, foldZ - 7.5f };
+		};
+
+		const RayVector step = { 0.0f, 0.0f, 5.0f };
+
+		//Row one, whose torus replaces the distance to the walls
+		auto pos = row(7.5f);
+		pObject.distance = SdTorus(pos, 1.0f, 0.1f);
+		SetColor(pObject, 1.0f, 0.0f, 0.0f);
+
+		pos = pos - step;
+		Nearer(pObject, SdSphere(pos, 1.0f), 0.0f, 1.0f, 0.0f);
+		pos = pos - step;
+		Nearer(pObject, SdPyramid(pos * 0.5f, 1.0f) * 2.0f, 0.0f, 0.0f, 1.0f);
+		pos = pos - step;
+		Nearer(pObject, SdOctahedron(pos, 1.0f), 1.0f, 1.0f, 1.0f);
+
+		pos = row(12.5f);
+		Nearer(pObject, SdTriPrism(pos, 1.0f, 1.0f), 1.0f, 1.0f, 0.0f);
+		pos = pos - step;
+		Nearer(pObject, SdBox(pos, { 0.5f, 0.5f, 0.5f }), 1.0f, 0.0f, 1.0f);
+		pos = pos - step;
+		Nearer(pObject, SdRoundBox(pos, { 0.5f, 0.5f, 0.5f }, 0.25f), 0.0f, 1.0f, 1.0f);
+		pos = pos - step;
+		Nearer(pObject, SdHexPrism(pos, 0.5f, 1.0f), 1.0f, 0.5f, 0.5f);
+
+		pos = row(17.5f);
+		Nearer(pObject, SdVerticalCapsule(pos, 2.0f, 0.1f), 0.5f, 1.0f, 0.5f);
+		pos = pos - step;
+		Nearer(pObject, SdCappedCone(pos, 1.0f, 1.0f, 0.5f), 0.5f, 0.5f, 1.0f);
+		pos = pos - step;
+		Nearer(pObject, SdRoundCone(pos, 1.0f, 0.5f, 1.0f), 1.0f, 1.0f, 0.5f);
+		pos = pos - step;
+		Nearer(pObject, SdEllipsoid(pos, { 1.0f, 0.5f, 0.25f }), 1.0f, 0.5f, 1.0f);
+
+		pos = row(22.5f);
+		Nearer(pObject, SdRoundBox(pos, { 0.5f, 0.5f, 0.5f }, 0.25f), 0.5f, 1.0f, 1.0f);
+		pos = pos - step;
+		Nearer(pObject, SdTorus(pos, 1.0f, 0.1f), 1.0f, 0.5f, 0.0f);
+		pos = pos - step;
+		Nearer(pObject, SdHexPrism(pos, 0.5f, 1.0f), 0.0f, 1.0f, 0.5f);
+		pos = pos - step;
+		Nearer(pObject, SdOctahedron(pos, 1.0f), 0.5f, 1.0f, 0.0f);
+	}
+
+	//The fluted columns either side of the path
+	void Colonnade(const RayVector & pPosition, MarchObject & pObject)
+	{
+		struct Fluting
+		{
+			float x[12];
+			float z[12];
+
+			Fluting()
+			{
+				for (auto j = 0; j < 12; j++)
+				{
+					x[j] = std::sin(30.0f * j * Pi / 180.0f) * 0.75f + 2.5f;
+					z[j] = std::cos(30.0f * j * Pi / 180.0f) * 0.75f;
+				}
+			}
+		};
+
+		static const Fluting fluting;
+
+		const auto bounds = SdBox(pPosition - RayVector{ 0.0f, 5.0f, 25.0f }, { 9.5f, 5.0f, 24.5f });
+
+		if (!(bounds < pObject.distance))
+		{
+			return;
+		}
+
+		pObject.distance = bounds;
+
+		if (std::abs(pPosition.x) < 10.0f && pPosition.z > 0.0f && pPosition.z < 50.0f)
+		{
+			const auto pos = ColumnCell(pPosition);
+			auto distance = SdPillar(pos);
+
+			for (auto j = 0; j < 12; j++)
+			{
+				const auto cutout = SdCappedCylinder(pos, { fluting.x[j], 1.0f, fluting.z[j] }, { fluting.x[j], 9.0f, fluting.z[j] }, 0.05f);
+				distance = SoftMax2(distance, -cutout, 0.1f);
+			}
+
+			pObject.distance = distance;
+			SetColor(pObject, 0.84f, 0.77f, 0.67f);
+		}
+	}
+
+	//The roof at the end of the path and the columns under it
+	void Temple(const RayVector & pPosition, MarchObject & pObject)
+	{
+		const RayVector squash = { 1.0f, 0.5f, 1.0f };
+
+		auto roof = SdTriPrism(Divide(pPosition - RayVector{ 0.0f, 12.5f, 80.0f }, squash), 10.0f, 20.0f) * 0.5f;
+		roof = SoftMax2(roof, -SdTriPrism(Divide(pPosition - RayVector{ 0.0f, 12.5f, 60.0f }, squash), 8.0f, 0.5f) * 0.5f, 0.3f);
+		roof = SoftMax2(roof, -SdTriPrism(Divide(pPosition - RayVector{ 0.0f, 12.5f, 100.0f }, squash), 8.0f, 0.5f) * 0.5f, 0.3f);
+		roof = Subtract(roof, SdTriPrism(Divide(pPosition - RayVector{ 0.0f, 10.5f, 80.0f }, squash), 9.0f, 18.0f) * 0.5f);
+
+		if (std::abs(pPosition.x) < 10.0f && pPosition.z > 60.0f && pPosition.z < 100.0f)
+		{
+			Nearer(pObject, SdPillar(ColumnCell(pPosition)), 0.84f, 0.77f, 0.67f);
+		}
+
+		Nearer(pObject, SdPillar(pPosition - RayVector{ 0.0f, 0.0f, 99.0f }), 0.84f, 0.77f, 0.67f);
+		Nearer(pObject, SdPillar(pPosition - RayVector{ -5.0f, 0.0f, 99.0f }), 0.84f, 0.77f, 0.67f);
+		Nearer(pObject, roof, 0.84f, 0.77f, 0.67f);
+	}
+
+	//The block with a sphere swinging through it and another cutting into it, on a 5 second loop
+	void Animation(const RayVector & pPosition, const float pTime, MarchObject & pObject)
+	{
+		const auto time = std::fmod(pTime, 5.0f);
+		auto distance = SdRoundBox(pPosition - RayVector{ 0.0f, 7.5f, -20.0f }, { 1.0f, 1.0f, 1.0f }, 1.0f);
+
+		const RayVector left = { 5.0f, 7.5f, -20.0f }, right = { -5.0f, 7.5f, -20.0f };
+		const RayVector front = { 0.0f, 7.5f, -15.0f }, back = { 0.0f, 7.5f, -25.0f };
+
+		const auto across = time < 2.5f ? Lerp(left, right, Smoothstep(0.0f, 2.5f, time)) : Lerp(right, left, Smoothstep(2.5f, 5.0f, time));
+		const auto along = time < 2.5f ? Lerp(front, back, Smoothstep(0.0f, 2.5f, time)) : Lerp(back, front, Smoothstep(2.5f, 5.0f, time));
+
+		distance = SoftMin2(distance, SdSphere(pPosition - across, 1.0f), 1.0f);
+		distance = SoftMax2(distance, -SdSphere(pPosition - along, 1.0f), 1.0f);
+
+		Nearer(pObject, distance, 1.0f, 1.0f, 1.0f);
+	}
+
+	void Arch(const RayVector & pPosition, MarchObject & pObject)
+	{
+		auto distance = SdBox(pPosition - RayVector{ 0.0f, 10.0f, -50.0f }, { 20.0f, 20.0f, 5.0f });
+		distance = SoftMax2(distance, -SdBox(pPosition - RayVector{ 0.0f, 7.5f, -50.0f }, { 5.0f, 7.5f, 5.0f }), 0.5f);
+		distance = SoftMax2(distance, -SdBox(pPosition - RayVector{ 12.5f, 4.5f, -50.0f }, { 3.0f, 4.5f, 5.0f }), 0.5f);
+		distance = SoftMax2(distance, -SdBox(pPosition - RayVector{ -12.5f, 4.5f, -50.0f }, { 3.0f, 4.5f, 5.0f }), 0.5f);
+		distance = SoftMax2(distance, -SdCappedCylinder(pPosition, { 0.0f, 16.0f, -45.0f }, { 0.0f, 16.0f, -55.0f }, 5.0f), 0.5f);
+		distance = SoftMax2(distance, -SdCappedCylinder(pPosition, { 12.5f, 10.0f, -45.0f }, { 12.5f, 10.0f, -55.0f }, 3.0f), 0.5f);
+		distance = SoftMax2(distance, -SdCappedCylinder(pPosition, { -12.5f, 10.0f, -45.0f }, { -12.5f, 10.0f, -55.0f }, 3.0f), 0.5f);
+
+		for (const auto y : { 2.5f, 17.5f })
+		{
+			for (const auto x : { 7.5f, -7.5f, 17.5f, -17.5f })
+			{
+				distance = std::min(distance, SdBox(pPosition - RayVector{ x, y, -44.0f }, { 1.0f, 2.5f, 1.0f }));
+			}
+		}
+
+		for (const auto x : { 7.5f, -7.5f, 17.5f, -17.5f })
+		{
+			distance = SoftMin2(distance, SdCappedCylinder(pPosition, { x, 5.0f, -44.0f }, { x, 15.0f, -44.0f }, 0.75f), 1.0f);
+		}
+
+		Nearer(pObject, distance, 0.84f, 0.77f, 0.67f);
+	}
+
+	RayVector Normal(const RayVector & pPosition, const float pTime, const float pFarPlane)
+	{
+		auto distance = [&](const float pX, const float pY, const float pZ)
+		{
+			return MarchScene({ pPosition.x + pX, pPosition.y + pY, pPosition.z + pZ }, pTime, pFarPlane).distance;
+		};
+
+		const auto minX = distance(-MarchEpsilon, 0.0f, 0.0f);
+		const auto maxX = distance(MarchEpsilon, 0.0f, 0.0f);
+		const auto minY = distance(0.0f, -MarchEpsilon, 0.0f);
+		const auto maxY = distance(0.0f, MarchEpsilon, 0.0f);
+		const auto minZ = distance(0.0f, 0.0f, -MarchEpsilon);
+		const auto maxZ = distance(0.0f, 0.0f, MarchEpsilon);
+
+		return RayVector{ maxX - minX, maxY - minY, maxZ - minZ }.Normalized();
+	}
+
+	void Lighting(const RayCamera & pCamera, const float pTime, const RayVector & pHitPosition, const RayVector & pDirection,
+		const MarchObject & pObject, float * pColor)
+	{
+		const auto normal = Normal(pHitPosition, pTime, pCamera.farPlane);
+		const auto lightDirection = (pCamera.lightPosition - pHitPosition).Normalized();
+
+		float color[4];
+		std::copy(pObject.color, pObject.color + 4, color);
+
+		if (pObject.objectType == 1)
+		{
+			const auto terrain = TerrainColor(pHitPosition);
+
+			color[0] = terrain.x;
+			color[1] = terrain.y;
+			color[2] = terrain.z;
+			color[3] = 1.0f;
+		}
+
+		//Phong, which reflects the light direction rather than its opposite as the ray tracer does
+		const auto nDotL = normal.Dot(lightDirection);
+		const auto diffuse = Saturate(nDotL);
+		const auto specular = nDotL > 0.0f ? std::pow(Saturate(pDirection.Dot(lightDirection.Reflect(normal))), 40.0f) : 0.0f;
+
+		for (auto i = 0; i < 3; i++)
+		{
+			pColor[i] = pCamera.lightColor[i] * (diffuse * color[i] + specular * color[i] + color[i] * 0.1f);
+		}
+
+		pColor[3] = 1.0f;
+	}
+}
+
+MarchObject Advanced_Rendering::MarchScene(const RayVector & pPosition, const float pTime, const float pFarPlane)
+{
+	MarchObject object = { pFarPlane, { 0.0f, 0.0f, 0.0f, 0.0f }, 0 };
+
+	//The inside of the walls, past which the gallery repeats
+	const auto walls = SdBox(pPosition - RayVector{ 0.0f, 0.0f, 50.0f }, { 160.5f, 1000.0f, 70.5f });
+
+	if (-walls < object.distance)
+	{
+		object.distance = -walls;
+
+		if (pPosition.z < -20.0f || pPosition.z > 120.0f || std::abs(pPosition.x) > 160.0f)
+		{
+			Gallery(pPosition, object);
+		}
+	}
+
+	Colonnade(pPosition, object);
+	Temple(pPosition, object);
+	Animation(pPosition, pTime, object);
+	Arch(pPosition, object);
+
+	const auto terrain = SdTerrain(pPosition);
+
+	if (terrain < object.distance)
+	{
+		object.distance = terrain;
+		SetColor(object, 0.1f, 1.0f, 0.1f);
+		object.objectType = 1;
+	}
+
+	return object;
+}
+
+uint32_t Advanced_Rendering::MarchRay(const RayCamera & pCamera, const float pTime, const RayVector & pOrigin, const RayVector & pDirection,
+	float * pColor, float * pPosition)
+{
+	std::fill(pColor, pColor + 4, 0.0f);
+	std::fill(pPosition, pPosition + 4, 0.0f);
+
+	auto depth = 0.0f;
+
+	for (uint32_t step = 0; step < MarchMaxSteps; step++)
+	{
+		const auto position = pOrigin + pDirection * depth;
+		const auto object = MarchScene(position, pTime, pCamera.farPlane);
+
+		if (object.distance < MarchEpsilon)
+		{
+			Lighting(pCamera, pTime, position, pDirection, object, pColor);
+			ClipPosition(pCamera, position, pPosition);
+			return step + 1;
+		}
+
+		depth += object.distance;
+
+		if (depth >= pCamera.farPlane)
+		{
+			return step + 1;
+		}
+	}
+
+	return MarchMaxSteps;
+}
+
+MarchStats Advanced_Rendering::MarchRays(const RayCamera & pCamera, const float pTime, RayTargets & pTargets, const MarchOptions & pOptions)
+{
+	if (pTargets.width != pCamera.width || pTargets.height != pCamera.height)
+	{
+		pTargets.Resize(pCamera.width, pCamera.height);
+	}
+
+	auto march = [&](const uint32_t pLeft, const uint32_t pTop, const uint32_t pRight, const uint32_t pBottom, MarchStats & pStats)
+	{
+		for (auto y = pTop; y < pBottom; y++)
+		{
+			for (auto x = pLeft; x < pRight; x++)
+			{
+				const auto pixel = (static_cast<size_t>(y) * pCamera.width + x) * 4;
+				RayVector origin, direction;
+
+				MakeEyeRay(pCamera, x + 0.5f, y + 0.5f, origin, direction);
+
+				pStats.steps += MarchRay(pCamera, pTime, origin, direction, &pTargets.color[pixel], &pTargets.position[pixel]);
+				pStats.hits += pTargets.color[pixel + 3] != 0.0f ? 1 : 0;
+				pStats.rays++;
+			}
+		}
+	};
+
+	std::vector<MarchStats> partStats;
+
+	if (pOptions.scheduler)
+	{
+		pOptions.scheduler->Resize(pCamera.width, pCamera.height);
+		partStats.resize(pOptions.scheduler->ThreadCount());
+
+		pOptions.scheduler->Run([&](const RenderTile & pTile, const uint32_t pThread)
+		{
+			march(pTile.x, pTile.y, pTile.x + pTile.width, pTile.y + pTile.height, partStats[pThread]);
+		});
+	}
+	else
+	{
+		const auto tileSize = std::max(pOptions.tileSize, 1u);
+		const auto tilesWide = (pCamera.width + tileSize - 1) / tileSize;
+		const auto tilesHigh = (pCamera.height + tileSize - 1) / tileSize;
+
+		partStats.resize(static_cast<size_t>(tilesWide) * tilesHigh);
+
+		ParallelFor(static_cast<uint32_t>(partStats.size()), pOptions.threadCount != 0 ? pOptions.threadCount : WorkerCount(), [&](const uint32_t pTile)
+		{
+			const auto left = pTile % tilesWide * tileSize;
+			const auto top = pTile / tilesWide * tileSize;
+
+			march(left, top, std::min(left + tileSize, pCamera.width), std::min(top + tileSize, pCamera.height), partStats[pTile]);
+		});
+	}
+
+	MarchStats stats;
+
+	for (const auto & part : partStats)
+	{
+		stats.rays += part.rays;
+		stats.steps += part.steps;
+		stats.hits += part.hits;
+	}
+
+	return stats;
+}
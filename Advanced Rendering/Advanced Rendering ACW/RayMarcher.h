@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include "RayTracer.h"
+
+namespace Advanced_Rendering
+{
+	class TileScheduler;
+
+	constexpr uint32_t MarchMaxSteps = 300;		// RayMarchingPixelShader.hlsl's MAX_MARCHING_STEPS
+
+	// What the shader's Scene finds nearest a point. objectType 1 is the terrain, whose colour
+	// Lighting works out from where it is hit.
+	struct MarchObject
+	{
+		float distance;
+		float color[4];
+		int objectType;
+	};
+
+	// The shader's Scene: the shape gallery outside the walls, the colonnade, the temple, the
+	// animated block, the arch and the terrain. pTime is TimeConstantBuffer's, in seconds.
+	MarchObject MarchScene(const RayVector & pPosition, float pTime, float pFarPlane);
+
+	// The shader's RayMarching for one eye ray: the lit colour and the clip space position of the
+	// surface reached, both zero when the ray leaves the far plane or runs out of steps. Returns the
+	// steps taken. pColor and pPosition take 4 floats each.
+	uint32_t MarchRay(const RayCamera & pCamera, float pTime, const RayVector & pOrigin, const RayVector & pDirection, float * pColor,
+		float * pPosition);
+
+	struct MarchOptions
+	{
+		uint32_t tileSize = 16;				// pixels a side of the squares handed to threads
+		uint32_t threadCount = 0;			// 0 for every hardware thread
+		TileScheduler * scheduler = nullptr;	// hands out the tiles instead when set, with its own threads
+	};
+
+	struct MarchStats
+	{
+		uint64_t rays = 0;
+		uint64_t steps = 0;
+		uint64_t hits = 0;
+	};
+
+	// The whole ray marching pass into pTargets, the eye rays made as the ray tracing pass makes them
+	MarchStats MarchRays(const RayCamera & pCamera, float pTime, RayTargets & pTargets, const MarchOptions & pOptions = MarchOptions());
+}
@@ -0,0 +1,682 @@
+#include "RayPacket.h"
+
+#include <algorithm>
+#include <cstring>
+#include "Parallel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RAY_PACKET_AVX2
+#define RAY_PACKET_SSE2
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define RAY_PACKET_SSE2
+#endif
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	// Four lanes, in an SSE register where there is one. Comparisons set a lane's bits all to one
+	// where they hold and to zero where they do not, NaN included, as the scalar comparisons answer.
+	struct Float4
+	{
+		static constexpr uint32_t Lanes = 4;
+
+#if defined(RAY_PACKET_SSE2)
+		__m128 v;
+
+		static Float4 Load(const float * pValues) { return { _mm_loadu_ps(pValues) }; }
+		static Float4 Set(const float pValue) { return { _mm_set1_ps(pValue) }; }
+		void Store(float * pValues) const { _mm_storeu_ps(pValues, v); }
+#else
+		float v[4];
+
+		static Float4 Load(const float * pValues) { return { { pValues[0], pValues[1], pValues[2], pValues[3] } }; }
+		static Float4 Set(const float pValue) { return { { pValue, pValue, pValue, pValue } }; }
+		void Store(float * pValues) const { std::copy(v, v + 4, pValues); }
+#endif
+	};
+
+#if defined(RAY_PACKET_SSE2)
+	Float4 operator+ (const Float4 & pA, const Float4 & pB) { return { _mm_add_ps(pA.v, pB.v) }; }
+	Float4 operator- (const Float4 & pA, const Float4 & pB) { return { _mm_sub_ps(pA.v, pB.v) }; }
+	Float4 operator* (const Float4 & pA, const Float4 & pB) { return { _mm_mul_ps(pA.v, pB.v) }; }
+	Float4 operator/ (const Float4 & pA, const Float4 & pB) { return { _mm_div_ps(pA.v, pB.v) }; }
+	Float4 Sqrt(const Float4 & pA) { return { _mm_sqrt_ps(pA.v) }; }
+	Float4 Abs(const Float4 & pA) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), pA.v) }; }
+	Float4 Less(const Float4 & pA, const Float4 & pB) { return { _mm_cmplt_ps(pA.v, pB.v) }; }
+	Float4 LessEqual(const Float4 & pA, const Float4 & pB) { return { _mm_cmple_ps(pA.v, pB.v) }; }
+	Float4 Greater(const Float4 & pA, const Float4 & pB) { return { _mm_cmpgt_ps(pA.v, pB.v) }; }
+	Float4 And(const Float4 & pA, const Float4 & pB) { return { _mm_and_ps(pA.v, pB.v) }; }
+	Float4 Or(const Float4 & pA, const Float4 & pB) { return { _mm_or_ps(pA.v, pB.v) }; }
+	Float4 AndNot(const Float4 & pA, const Float4 & pB) { return { _mm_andnot_ps(pA.v, pB.v) }; }
+	uint32_t Mask(const Float4 & pA) { return static_cast<uint32_t>(_mm_movemask_ps(pA.v)); }
+#else
+	uint32_t Bits(const float pValue)
+	{
+		uint32_t bits;
+		memcpy(&bits, &pValue, sizeof bits);
+		return bits;
+	}
+
+	float Lane(const uint32_t pBits)
+	{
+		float value;
+		memcpy(&value, &pBits, sizeof value);
+		return value;
+	}
+
+	template <class Operation>
+	Float4 EachLane(const Float4 & pA, const Float4 & pB, Operation pOperation)
+	{
+		return { { pOperation(pA.v[0], pB.v[0]), pOperation(pA.v[1], pB.v[1]), pOperation(pA.v[2], pB.v[2]), pOperation(pA.v[3], pB.v[3]) } };
+	}
+
+	Float4 operator+ (const Float4 & pA, const Float4 & pB) { return EachLane(pA, pB, [](const float pX, const float pY) { return pX + pY; }); }
+	Float4 operator- (const Float4 & pA, const Float4 & pB) { return EachLane(pA, pB, [](const float pX, const float pY) { return pX - pY; }); }
+	Float4 operator* (const Float4 & pA, const Float4 & pB) { return EachLane(pA, pB, [](const float pX, const float pY) { return pX * pY; }); }
+	Float4 operator/ (const Float4 & pA, const Float4 & pB) { return EachLane(pA, pB, [](const float pX, const float pY) { return pX / pY; }); }
+	Float4 Sqrt(const Float4 & pA) { return EachLane(pA, pA, [](const float pX, float) { return std::sqrt(pX); }); }
+	Float4 Abs(const Float4 & pA) { return EachLane(pA, pA, [](const float pX, float) { return std::abs(pX); }); }
+	Float4 Less(const Float4 & pA, const Float4 & pB) { return EachLane(pA, pB, [](const float pX, const float pY) { return Lane(pX < pY ? ~0u : 0u); }); }
+	Float4 LessEqual(const Float4 & pA, const Float4 & pB) { return EachLane(pA, pB, [](const float pX, const float pY) { return Lane(pX <= pY ? ~0u : 0u); }); }
+	Float4 Greater(const Float4 & pA, const Float4 & pB) { return EachLane(pA, pB, [](const float pX, const float pY) { return Lane(pX > pY ? ~0u : 0u); }); }
+	Float4 And(const Float4 & pA, const Float4 & pB) { return EachLane(pA, pB, [](const float pX, const float pY) { return Lane(Bits(pX) & Bits(pY)); }); }
+	Float4 Or(const Float4 & pA, const Float4 & pB) { return EachLane(pA, pB, [](const float pX, const float pY) { return Lane(Bits(pX) | Bits(pY)); }); }
+	Float4 AndNot(const Float4 & pA, const Float4 & pB) { return EachLane(pA, pB, [](const float pX, const float pY) { return Lane(~Bits(pX) & Bits(pY)); }); }
+
+	uint32_t Mask(const Float4 & pA)
+	{
+		return Bits(pA.v[0]) >> 31 | Bits(pA.v[1]) >> 31 << 1 | Bits(pA.v[2]) >> 31 << 2 | Bits(pA.v[3]) >> 31 << 3;
+	}
+#endif
+
+	// Twice the lanes of Half, for 8 lanes without AVX
+	template <class Half>
+	struct Pair
+	{
+		static constexpr uint32_t Lanes = Half::Lanes * 2;
+
+		Half low;
+		Half high;
+
+		static Pair Load(const float * pValues) { return { Half::Load(pValues), Half::Load(pValues + Half::Lanes) }; }
+		static Pair Set(const float pValue) { return { Half::Set(pValue), Half::Set(pValue) }; }
+
+		void Store(float * pValues) const
+		{
+			low.Store(pValues);
+			high.Store(pValues + Half::Lanes);
+		}
+	};
+
+	template <class Half> Pair<Half> operator+ (const Pair<Half> & pA, const Pair<Half> & pB) { return { pA.low + pB.low, pA.high + pB.high }; }
+	template <class Half> Pair<Half> operator- (const Pair<Half> & pA, const Pair<Half> & pB) { return { pA.low - pB.low, pA.high - pB.high }; }
+	template <class Half> Pair<Half> operator* (const Pair<Half> & pA, const Pair<Half> & pB) { return { pA.low * pB.low, pA.high * pB.high }; }
+	template <class Half> Pair<Half> operator/ (const Pair<Half> & pA, const Pair<Half> & pB) { return { pA.low / pB.low, pA.high / pB.high }; }
+	template <class Half> Pair<Half> Sqrt(const Pair<Half> & pA) { return { Sqrt(pA.low), Sqrt(pA.high) }; }
+	template <class Half> Pair<Half> Abs(const Pair<Half> & pA) { return { Abs(pA.low), Abs(pA.high) }; }
+	template <class Half> Pair<Half> Less(const Pair<Half> & pA, const Pair<Half> & pB) { return { Less(pA.low, pB.low), Less(pA.high, pB.high) }; }
+	template <class Half> Pair<Half> LessEqual(const Pair<Half> & pA, const Pair<Half> & pB) { return { LessEqual(pA.low, pB.low), LessEqual(pA.high, pB.high) }; }
+	template <class Half> Pair<Half> Greater(const Pair<Half> & pA, const Pair<Half> & pB) { return { Greater(pA.low, pB.low), Greater(pA.high, pB.high) }; }
+	template <class Half> Pair<Half> And(const Pair<Half> & pA, const Pair<Half> & pB) { return { And(pA.low, pB.low), And(pA.high, pB.high) }; }
+	template <class Half> Pair<Half> Or(const Pair<Half> & pA, const Pair<Half> & pB) { return { Or(pA.low, pB.low), Or(pA.high, pB.high) }; }
+	template <class Half> Pair<Half> AndNot(const Pair<Half> & pA, const Pair<Half> & pB) { return { AndNot(pA.low, pB.low), AndNot(pA.high, pB.high) }; }
+	template <class Half> uint32_t Mask(const Pair<Half> & pA) { return Mask(pA.low) | Mask(pA.high) << Half::Lanes; }
+
+#if defined(RAY_PACKET_AVX2)
+	struct Float8
+	{
+		static constexpr uint32_t Lanes = 8;
+
+		__m256 v;
+
+		static Float8 Load(const float * pValues) { return { _mm256_loadu_ps(pValues) }; }
+		static Float8 Set(const float pValue) { return { _mm256_set1_ps(pValue) }; }
+		void Store(float * pValues) const { _mm256_storeu_ps(pValues, v); }
+	};
+
+	Float8 operator+ (const Float8 & pA, const Float8 & pB) { return { _mm256_add_ps(pA.v, pB.v) }; }
+	Float8 operator- (const Float8 & pA, const Float8 & pB) { return { _mm256_sub_ps(pA.v, pB.v) }; }
+	Float8 operator* (const Float8 & pA, const Float8 & pB) { return { _mm256_mul_ps(pA.v, pB.v) }; }
+	Float8 operator/ (const Float8 & pA, const Float8 & pB) { return { _mm256_div_ps(pA.v, pB.v) }; }
+	Float8 Sqrt(const Float8 & pA) { return { _mm256_sqrt_ps(pA.v) }; }
+	Float8 Abs(const Float8 & pA) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), pA.v) }; }
+	Float8 Less(const Float8 & pA, const Float8 & pB) { return { _mm256_cmp_ps(pA.v, pB.v, _CMP_LT_OQ) }; }
+	Float8 LessEqual(const Float8 & pA, const Float8 & pB) { return { _mm256_cmp_ps(pA.v, pB.v, _CMP_LE_OQ) }; }
+	Float8 Greater(const Float8 & pA, const Float8 & pB) { return { _mm256_cmp_ps(pA.v, pB.v, _CMP_GT_OQ) }; }
+	Float8 And(const Float8 & pA, const Float8 & pB) { return { _mm256_and_ps(pA.v, pB.v) }; }
+	Float8 Or(const Float8 & pA, const Float8 & pB) { return { _mm256_or_ps(pA.v, pB.v) }; }
+	Float8 AndNot(const Float8 & pA, const Float8 & pB) { return { _mm256_andnot_ps(pA.v, pB.v) }; }
+#else
+	using Float8 = Pair<Float4>;
+#endif
+
+	template <class F>
+	F Select(const F & pMask, const F & pA, const F & pB)
+	{
+		return Or(And(pMask, pA), AndNot(pMask, pB));
+	}
+
+	// All ones in the lanes whose bit is set
+	template <class F>
+	F LaneMask(const uint32_t pBits)
+	{
+		float lanes[F::Lanes];
+
+		for (uint32_t i = 0; i < F::Lanes; i++)
+		{
+			const auto bits = pBits >> i & 1 ? ~0u : 0u;
+			memcpy(&lanes[i], &bits, sizeof bits);
+		}
+
+		return F::Load(lanes);
+	}
+
+	// Products summed in the order RayVector::Dot sums them, so every lane rounds as the scalar port does
+	template <class F>
+	F Dot(const F * pA, const F * pB)
+	{
+		return pA[0] * pB[0] + pA[1] * pB[1] + pA[2] * pB[2];
+	}
+
+	template <class F>
+	void Broadcast(const std::vector<float> * pComponents, const uint32_t pIndex, F * pLanes)
+	{
+		for (auto c = 0; c < 3; c++)
+		{
+			pLanes[c] = F::Set(pComponents[c][pIndex]);
+		}
+	}
+
+	template <class F>
+	struct Rays
+	{
+		F origin[3];
+		F direction[3];
+	};
+
+	// The kernels follow SphereIntersect, TriangleIntersect and QuadIntersect in RayTracer.cpp a lane
+	// at a time. pHit is set in the active lanes that hit, and the distances are those the scalar
+	// functions return.
+	template <class F>
+	F SphereLanes(const RaySoaScene & pScene, const uint32_t pIndex, const Rays<F> & pRays, const F & pActive, const F & pFarPlane, F & pHit)
+	{
+		F v[3];
+		Broadcast(pScene.sphereCentre, pIndex, v);
+
+		for (auto c = 0; c < 3; c++)
+		{
+			v[c] = v[c] - pRays.origin[c];
+		}
+
+		const auto a = Dot(v, pRays.direction);
+		const auto b = Dot(v, v) - a * a;
+		const auto r = F::Set(pScene.sphereRadius[pIndex]);
+		const auto miss = Greater(b, r * r);
+		const auto t = a - Sqrt(r * r - b);
+
+		pHit = AndNot(Or(miss, Less(t, F::Set(0.0f))), pActive);
+
+		return Select(miss, pFarPlane, t);
+	}
+
+	template <class F>
+	F TriangleLanes(const RaySoaScene & pScene, const uint32_t pIndex, const Rays<F> & pRays, const F & pActive, const F & pFarPlane, F & pHit)
+	{
+		F normal[3], a[3], b[3], c[3];
+		Broadcast(pScene.triangleNormal, pIndex, normal);
+		Broadcast(pScene.triangleA, pIndex, a);
+		Broadcast(pScene.triangleB, pIndex, b);
+		Broadcast(pScene.triangleC, pIndex, c);
+
+		const auto cosine = Dot(pRays.direction, normal);
+		const auto parallel = Less(Abs(cosine), F::Set(RayEpsilon));
+
+		F toA[3], p[3];
+
+		for (auto i = 0; i < 3; i++)
+		{
+			toA[i] = a[i] - pRays.origin[i];
+		}
+
+		const auto t = Dot(toA, normal) / cosine;
+
+		for (auto i = 0; i < 3; i++)
+		{
+			p[i] = pRays.origin[i] + pRays.direction[i] * t;
+		}
+
+		auto miss = Or(parallel, Less(t, F::Set(RayEpsilon)));
+		const F * corners[3] = { a, b, c };
+
+		for (auto e = 0; e < 3; e++)
+		{
+			F edge[3], toP[3];
+			Broadcast(pScene.triangleEdge[e], pIndex, edge);
+
+			for (auto i = 0; i < 3; i++)
+			{
+				toP[i] = p[i] - corners[e][i];
+			}
+
+			const F cross[3] = {
+				edge[1] * toP[2] - edge[2] * toP[1],
+				edge[2] * toP[0] - edge[0] * toP[2],
+				edge[0] * toP[1] - edge[1] * toP[0]
+			};
+
+			miss = Or(miss, Less(Dot(normal, cross), F::Set(0.0f)));
+		}
+
+		pHit = AndNot(miss, pActive);
+
+		return Select(parallel, pFarPlane, t);
+	}
+
+	template <class F>
+	F QuadLanes(const RaySoaScene & pScene, const uint32_t pIndex, const Rays<F> & pRays, const F & pActive, const F & pFarPlane, F & pHit)
+	{
+		F centre[3], normal[3], tangent[3], biTangent[3];
+		Broadcast(pScene.quadCentre, pIndex, centre);
+		Broadcast(pScene.quadNormal, pIndex, normal);
+		Broadcast(pScene.quadTangent, pIndex, tangent);
+		Broadcast(pScene.quadBiTangent, pIndex, biTangent);
+
+		const auto cosine = Dot(pRays.direction, normal);
+		const auto parallel = Less(Abs(cosine), F::Set(RayEpsilon));
+
+		F toCentre[3], offset[3];
+
+		for (auto i = 0; i < 3; i++)
+		{
+			toCentre[i] = centre[i] - pRays.origin[i];
+		}
+
+		const auto t = Dot(toCentre, normal) / cosine;
+
+		for (auto i = 0; i < 3; i++)
+		{
+			offset[i] = pRays.origin[i] + pRays.direction[i] * t - centre[i];
+		}
+
+		const auto inside = And(LessEqual(Abs(Dot(offset, tangent)), F::Set(pScene.quadSize[0][pIndex])),
+			LessEqual(Abs(Dot(offset, biTangent)), F::Set(pScene.quadSize[1][pIndex])));
+
+		pHit = And(AndNot(Or(parallel, Less(t, F::Set(RayEpsilon))), pActive), inside);
+
+		return Select(parallel, pFarPlane, t);
+	}
+
+	template <class F>
+	Rays<F> LoadRays(const float (&pOrigin)[3][F::Lanes], const float (&pDirection)[3][F::Lanes])
+	{
+		Rays<F> rays;
+
+		for (auto c = 0; c < 3; c++)
+		{
+			rays.origin[c] = F::Load(pOrigin[c]);
+			rays.direction[c] = F::Load(pDirection[c]);
+		}
+
+		return rays;
+	}
+
+	RayVector PacketLane(const float (&pComponents)[3][RayPacketWidth], const uint32_t pLane)
+	{
+		return { pComponents[0][pLane], pComponents[1][pLane], pComponents[2][pLane] };
+	}
+
+	void SetPacketLane(float (&pComponents)[3][RayPacketWidth], const uint32_t pLane, const RayVector & pVector)
+	{
+		pComponents[0][pLane] = pVector.x;
+		pComponents[1][pLane] = pVector.y;
+		pComponents[2][pLane] = pVector.z;
+	}
+
+	uint32_t BitCount(uint32_t pBits)
+	{
+		uint32_t count = 0;
+
+		for (; pBits != 0; pBits &= pBits - 1)
+		{
+			count++;
+		}
+
+		return count;
+	}
+
+	// TraceRay for the active lanes of pPacket, pColor and pPosition pointing into the targets
+	RayStats TracePacket(const RayScene & pScene, const RaySoaScene & pSoaScene, const RayCamera & pCamera, RayPacket & pPacket, uint32_t pActive,
+		float * const * pColor, float * const * pPosition)
+	{
+		RayStats stats;
+		stats.primaryRays = BitCount(pActive);
+
+		float t[RayPacketWidth];
+		int hitObject[RayPacketWidth];
+		float lightIntensity[RayPacketWidth];
+		RayVector hitPosition[RayPacketWidth];
+		RaySurface surface[RayPacketWidth];
+
+		for (uint32_t lane = 0; lane < RayPacketWidth; lane++)
+		{
+			lightIntensity[lane] = 1.0f;
+
+			if (pActive >> lane & 1)
+			{
+				std::fill(pColor[lane], pColor[lane] + 4, 0.0f);
+				std::fill(pPosition[lane], pPosition[lane] + 4, 0.0f);
+			}
+		}
+
+		for (auto depth = 1; depth < 5 && pActive != 0; depth++)
+		{
+			NearestHitPacket(pSoaScene, pPacket, pActive, pCamera.farPlane, t, hitObject);
+
+			//The lanes that hit cast their shadow rays together, packed 4 at a time
+			ShadowPacket shadows[RayPacketWidth / ShadowPacketWidth] = {};
+			uint32_t shadowLanes[RayPacketWidth];
+			uint32_t shadowCount = 0;
+			uint32_t hits = 0;
+
+			for (uint32_t lane = 0; lane < RayPacketWidth; lane++)
+			{
+				if (!(pActive >> lane & 1) || hitObject[lane] < 0)
+				{
+					continue;
+				}
+
+				hits |= 1u << lane;
+				hitPosition[lane] = PacketLane(pPacket.origin, lane) + PacketLane(pPacket.direction, lane) * t[lane];
+
+				if (depth == 1)
+				{
+					ClipPosition(pCamera, hitPosition[lane], pPosition[lane]);
+				}
+
+				surface[lane] = HitSurface(pScene, hitObject[lane], hitPosition[lane]);
+
+				RayVector origin, direction;
+				float distance;
+				MakeShadowRay(pCamera, hitPosition[lane], origin, direction, distance);
+
+				auto & shadow = shadows[shadowCount / ShadowPacketWidth];
+				const auto slot = shadowCount % ShadowPacketWidth;
+
+				shadow.origin[0][slot] = origin.x;
+				shadow.origin[1][slot] = origin.y;
+				shadow.origin[2][slot] = origin.z;
+				shadow.direction[0][slot] = direction.x;
+				shadow.direction[1][slot] = direction.y;
+				shadow.direction[2][slot] = direction.z;
+				shadow.distance[slot] = distance;
+				shadowLanes[shadowCount++] = lane;
+			}
+
+			uint32_t shadowed = 0;
+
+			for (uint32_t packet = 0; packet * ShadowPacketWidth < shadowCount; packet++)
+			{
+				const auto count = std::min(shadowCount - packet * ShadowPacketWidth, ShadowPacketWidth);
+
+				//A last packet that is not full has its empty slots masked off
+				shadowed |= ShadowPacketMask(pSoaScene, shadows[packet], (1u << count) - 1, pCamera.farPlane) << packet * ShadowPacketWidth;
+			}
+
+			for (uint32_t i = 0; i < shadowCount; i++)
+			{
+				const auto lane = shadowLanes[i];
+				ShadeHit(pCamera, hitPosition[lane], surface[lane], PacketLane(pPacket.direction, lane), shadowed >> i & 1 ? 1.0f : 0.0f,
+					lightIntensity[lane], pColor[lane]);
+			}
+
+			stats.shadowRays += shadowCount;
+
+			//The shader traces a fifth ray after the last bounce and never uses it
+			if (depth == 4)
+			{
+				break;
+			}
+
+			for (uint32_t lane = 0; lane < RayPacketWidth; lane++)
+			{
+				if (hits >> lane & 1)
+				{
+					lightIntensity[lane] *= surface[lane].material->kr;
+					SetPacketLane(pPacket.direction, lane, PacketLane(pPacket.direction, lane).Reflect(surface[lane].normal));
+					SetPacketLane(pPacket.origin, lane, hitPosition[lane]);
+				}
+			}
+
+			stats.reflectionRays += BitCount(hits);
+			pActive = hits;
+		}
+
+		return stats;
+	}
+}
+
+RaySoaScene Advanced_Rendering::MakeRaySoaScene(const RayScene & pScene)
+{
+	RaySoaScene soa;
+
+	auto append = [](std::vector<float> * pComponents, const RayVector & pVector)
+	{
+		pComponents[0].push_back(pVector.x);
+		pComponents[1].push_back(pVector.y);
+		pComponents[2].push_back(pVector.z);
+	};
+
+	soa.sphereCount = static_cast<uint32_t>(pScene.spheres.size());
+
+	for (const auto & sphere : pScene.spheres)
+	{
+		append(soa.sphereCentre, sphere.centre);
+		soa.sphereRadius.push_back(sphere.radius);
+	}
+
+	soa.triangleCount = static_cast<uint32_t>(pScene.triangles.size());
+
+	for (const auto & triangle : pScene.triangles)
+	{
+		append(soa.triangleA, triangle.a);
+		append(soa.triangleB, triangle.b);
+		append(soa.triangleC, triangle.c);
+		append(soa.triangleEdge[0], triangle.b - triangle.a);
+		append(soa.triangleEdge[1], triangle.c - triangle.b);
+		append(soa.triangleEdge[2], triangle.a - triangle.c);
+		append(soa.triangleNormal, (triangle.b - triangle.a).Cross(triangle.c - triangle.a).Normalized());
+	}
+
+	soa.quadCount = static_cast<uint32_t>(pScene.quads.size());
+
+	for (const auto & quad : pScene.quads)
+	{
+		append(soa.quadCentre, quad.centre);
+		append(soa.quadNormal, quad.normal);
+		append(soa.quadTangent, quad.tangent);
+		append(soa.quadBiTangent, quad.biTangent);
+		soa.quadSize[0].push_back(quad.size[0]);
+		soa.quadSize[1].push_back(quad.size[1]);
+	}
+
+	return soa;
+}
+
+void Advanced_Rendering::NearestHitPacket(const RaySoaScene & pScene, const RayPacket & pPacket, const uint32_t pActiveMask, const float pFarPlane,
+	float * pT, int * pHitObject)
+{
+	const auto rays = LoadRays<Float8>(pPacket.origin, pPacket.direction);
+	const auto active = LaneMask<Float8>(pActiveMask);
+	const auto farPlane = Float8::Set(pFarPlane);
+
+	auto minT = farPlane;
+	auto hitObject = Float8::Set(-1.0f);
+	auto object = 0.0f;
+
+	//Object numbers are kept as floats, exact far beyond any scene this traces, so they blend with the distances
+	auto closest = [&](const Float8 & pT, const Float8 & pHit)
+	{
+		const auto closer = And(pHit, Less(pT, minT));
+
+		minT = Select(closer, pT, minT);
+		hitObject = Select(closer, Float8::Set(object), hitObject);
+		object += 1.0f;
+	};
+
+	Float8 hit;
+
+	for (uint32_t i = 0; i < pScene.sphereCount; i++)
+	{
+		const auto t = SphereLanes(pScene, i, rays, active, farPlane, hit);
+		closest(t, hit);
+	}
+
+	for (uint32_t i = 0; i < pScene.triangleCount; i++)
+	{
+		const auto t = TriangleLanes(pScene, i, rays, active, farPlane, hit);
+		closest(t, hit);
+	}
+
+	for (uint32_t i = 0; i < pScene.quadCount; i++)
+	{
+		const auto t = QuadLanes(pScene, i, rays, active, farPlane, hit);
+		closest(t, hit);
+	}
+
+	float t[RayPacketWidth], objects[RayPacketWidth];
+	minT.Store(t);
+	hitObject.Store(objects);
+
+	for (uint32_t lane = 0; lane < RayPacketWidth; lane++)
+	{
+		if (pActiveMask >> lane & 1)
+		{
+			pT[lane] = t[lane];
+			pHitObject[lane] = static_cast<int>(objects[lane]);
+		}
+	}
+}
+
+uint32_t Advanced_Rendering::ShadowPacketMask(const RaySoaScene & pScene, const ShadowPacket & pPacket, const uint32_t pActiveMask, const float pFarPlane)
+{
+	const auto rays = LoadRays<Float4>(pPacket.origin, pPacket.direction);
+	const auto active = LaneMask<Float4>(pActiveMask);
+	const auto farPlane = Float4::Set(pFarPlane);
+	const auto distance = Float4::Load(pPacket.distance);
+
+	auto shadowed = Float4::Set(0.0f);
+	Float4 hit;
+
+	//Each lane's answer is settled by its first blocker, so the packet is done once every lane has one
+	auto block = [&](const Float4 & pT, const Float4 & pHit)
+	{
+		shadowed = Or(shadowed, And(pHit, Less(pT, distance)));
+		return Mask(shadowed) == pActiveMask;
+	};
+
+	for (uint32_t i = 0; i < pScene.sphereCount; i++)
+	{
+		const auto t = SphereLanes(pScene, i, rays, active, farPlane, hit);
+
+		if (block(t, hit))
+		{
+			return pActiveMask;
+		}
+	}
+
+	for (uint32_t i = 0; i < pScene.triangleCount; i++)
+	{
+		const auto t = TriangleLanes(pScene, i, rays, active, farPlane, hit);
+
+		if (block(t, hit))
+		{
+			return pActiveMask;
+		}
+	}
+
+	for (uint32_t i = 0; i < pScene.quadCount; i++)
+	{
+		const auto t = QuadLanes(pScene, i, rays, active, farPlane, hit);
+
+		if (block(t, hit))
+		{
+			return pActiveMask;
+		}
+	}
+
+	return Mask(shadowed);
+}
+
+RayStats Advanced_Rendering::TraceRayPackets(const RayScene & pScene, const RaySoaScene & pSoaScene, const RayCamera & pCamera, RayTargets & pTargets,
+	const RayTraceOptions & pOptions)
+{
+	if (pTargets.width != pCamera.width || pTargets.height != pCamera.height)
+	{
+		pTargets.Resize(pCamera.width, pCamera.height);
+	}
+
+	const auto tileSize = std::max(pOptions.tileSize, 1u);
+	const auto tilesWide = (pCamera.width + tileSize - 1) / tileSize;
+	const auto tilesHigh = (pCamera.height + tileSize - 1) / tileSize;
+
+	std::vector<RayStats> tileStats(static_cast<size_t>(tilesWide) * tilesHigh);
+
+	ParallelFor(static_cast<uint32_t>(tileStats.size()), pOptions.threadCount != 0 ? pOptions.threadCount : WorkerCount(), [&](const uint32_t pTile)
+	{
+		const auto left = pTile % tilesWide * tileSize;
+		const auto top = pTile / tilesWide * tileSize;
+		const auto right = std::min(left + tileSize, pCamera.width);
+		const auto bottom = std::min(top + tileSize, pCamera.height);
+		RayStats stats;
+
+		//4x2 blocks, lanes past the tile's edge left off
+		for (auto y = top; y < bottom; y += 2)
+		{
+			for (auto x = left; x < right; x += 4)
+			{
+				RayPacket packet = {};
+				float * color[RayPacketWidth] = {};
+				float * position[RayPacketWidth] = {};
+				uint32_t active = 0;
+
+				for (uint32_t lane = 0; lane < RayPacketWidth; lane++)
+				{
+					const auto pixelX = x + lane % 4;
+					const auto pixelY = y + lane / 4;
+
+					if (pixelX >= right || pixelY >= bottom)
+					{
+						continue;
+					}
+
+					const auto pixel = (static_cast<size_t>(pixelY) * pCamera.width + pixelX) * 4;
+					RayVector origin, direction;
+
+					MakeEyeRay(pCamera, pixelX + 0.5f, pixelY + 0.5f, origin, direction);
+					SetPacketLane(packet.origin, lane, origin);
+					SetPacketLane(packet.direction, lane, direction);
+
+					color[lane] = &pTargets.color[pixel];
+					position[lane] = &pTargets.position[pixel];
+					active |= 1u << lane;
+				}
+
+				stats += TracePacket(pScene, pSoaScene, pCamera, packet, active, color, position);
+			}
+		}
+
+		tileStats[pTile] = stats;
+	});
+
+	RayStats stats;
+
+	for (const auto & tile : tileStats)
+	{
+		stats += tile;
+	}
+
+	return stats;
+}
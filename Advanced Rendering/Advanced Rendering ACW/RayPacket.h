@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "RayTracer.h"
+
+namespace Advanced_Rendering
+{
+	constexpr uint32_t RayPacketWidth = 8;			// a 4x2 block of eye rays, or their reflections
+	constexpr uint32_t ShadowPacketWidth = 4;
+
+	// A RayScene's primitives with one array per component, so a kernel loads each component of
+	// a primitive from the same few cache lines whichever ray packet asks. Triangle normals and
+	// edges, which the shader works out for every ray, are made once.
+	struct RaySoaScene
+	{
+		uint32_t sphereCount = 0;
+		std::vector<float> sphereCentre[3];
+		std::vector<float> sphereRadius;
+
+		uint32_t triangleCount = 0;
+		std::vector<float> triangleA[3];
+		std::vector<float> triangleB[3];
+		std::vector<float> triangleC[3];
+		std::vector<float> triangleEdge[3][3];		// b - a, c - b and a - c
+		std::vector<float> triangleNormal[3];
+
+		uint32_t quadCount = 0;
+		std::vector<float> quadCentre[3];
+		std::vector<float> quadNormal[3];
+		std::vector<float> quadTangent[3];
+		std::vector<float> quadBiTangent[3];
+		std::vector<float> quadSize[2];
+	};
+
+	RaySoaScene MakeRaySoaScene(const RayScene & pScene);
+
+	// Rays a component to an array, a lane to a ray
+	struct RayPacket
+	{
+		float origin[3][RayPacketWidth];
+		float direction[3][RayPacketWidth];
+	};
+
+	struct ShadowPacket
+	{
+		float origin[3][ShadowPacketWidth];
+		float direction[3][ShadowPacketWidth];
+		float distance[ShadowPacketWidth];			// to the light
+	};
+
+	// NearestRayHit for the lanes set in pActiveMask, bit i for lane i. The others are left alone.
+	void NearestHitPacket(const RaySoaScene & pScene, const RayPacket & pPacket, uint32_t pActiveMask, float pFarPlane, float * pT, int * pHitObject);
+
+	// RayShadow for the lanes set in pActiveMask, returning the mask of those in shadow. Stops once
+	// every active lane is.
+	uint32_t ShadowPacketMask(const RaySoaScene & pScene, const ShadowPacket & pPacket, uint32_t pActiveMask, float pFarPlane);
+
+	// TraceRays with the eye rays traced 8 at a time through every bounce. Lanes whose rays have
+	// stopped are masked off, and the shadow rays of the lanes still going are gathered 4 to a packet.
+	// The targets match TraceRays bit for bit.
+	RayStats TraceRayPackets(const RayScene & pScene, const RaySoaScene & pSoaScene, const RayCamera & pCamera, RayTargets & pTargets,
+		const RayTraceOptions & pOptions = RayTraceOptions());
+}
@@ -0,0 +1,395 @@
+#include "RaySampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "Parallel.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// The cells of the 4x4 grid by a Bayer matrix, so samples 0 to 3 fall in different quadrants
+	// and 0 to 7 two to a quadrant
+	const uint8_t StratumOrder[RaySampleStrata] = { 0, 10, 2, 8, 5, 15, 7, 13, 1, 11, 3, 9, 4, 14, 6, 12 };
+
+	uint32_t Hash(uint32_t pValue)
+	{
+		pValue ^= pValue >> 16;
+		pValue *= 0x7feb352du;
+		pValue ^= pValue >> 15;
+		pValue *= 0x846ca68bu;
+		pValue ^= pValue >> 16;
+		return pValue;
+	}
+
+	float Unit(const uint32_t pBits)
+	{
+		return (pBits >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// What a pixel's samples add up to
+	struct PixelSum
+	{
+		float color[4];
+		float luminance;
+		float luminanceSquares;
+		uint32_t count;
+	};
+
+	float DisplayLuminance(const float * pColor)
+	{
+		const auto channel = [](const float pValue)
+		{
+			return std::min(std::max(pValue, 0.0f), 1.0f);
+		};
+
+		return 0.2126f * channel(pColor[0]) + 0.7152f * channel(pColor[1]) + 0.0722f * channel(pColor[2]);
+	}
+
+	float MeanLuminance(const PixelSum & pPixel)
+	{
+		return pPixel.count ? pPixel.luminance / pPixel.count : 0.0f;
+	}
+
+	// A tile's samples so far and the ones a round adds
+	struct TileWork
+	{
+		uint32_t tile;
+		uint32_t first;
+		uint32_t end;
+	};
+
+	class AdaptiveSampler
+	{
+		const RayScene & mScene;
+		const RayCamera & mCamera;
+		const RaySampleOptions & mOptions;
+		RayTargets & mTargets;
+		uint32_t mTileSize;
+		uint32_t mTilesWide;
+		uint32_t mTilesHigh;
+		std::vector<PixelSum> mPixels;
+		std::vector<uint32_t> mTileSamples;
+		std::vector<float> mTileErrors;
+
+	public:
+		AdaptiveSampler(const RayScene & pScene, const RayCamera & pCamera, const RaySampleOptions & pOptions, RayTargets & pTargets) :
+			mScene(pScene), mCamera(pCamera), mOptions(pOptions), mTargets(pTargets), mTileSize(std::max(pOptions.tileSize, 1u)),
+			mTilesWide((pCamera.width + mTileSize - 1) / mTileSize), mTilesHigh((pCamera.height + mTileSize - 1) / mTileSize),
+			mPixels(static_cast<size_t>(pCamera.width) * pCamera.height, PixelSum()),
+			mTileSamples(static_cast<size_t>(mTilesWide) * mTilesHigh, 0), mTileErrors(mTileSamples.size(), 0.0f)
+		{
+		}
+
+		AdaptiveSampler(const AdaptiveSampler &) = delete;
+		AdaptiveSampler(AdaptiveSampler &&) = delete;
+		AdaptiveSampler & operator= (const AdaptiveSampler &) = delete;
+		AdaptiveSampler & operator= (AdaptiveSampler &&) = delete;
+
+		uint32_t TileCount() const
+		{
+			return static_cast<uint32_t>(mTileSamples.size());
+		}
+
+		uint32_t TilePixels(const uint32_t pTile) const
+		{
+			const auto left = pTile % mTilesWide * mTileSize;
+			const auto top = pTile / mTilesWide * mTileSize;
+
+			return (std::min(left + mTileSize, mCamera.width) - left) * (std::min(top + mTileSize, mCamera.height) - top);
+		}
+
+		uint32_t TileSamples(const uint32_t pTile) const
+		{
+			return mTileSamples[pTile];
+		}
+
+		float TileError(const uint32_t pTile) const
+		{
+			return mTileErrors[pTile];
+		}
+
+		// Samples pWork.first up to pWork.end of every pixel in the tile
+		RayStats Trace(const TileWork & pWork)
+		{
+			const auto left = pWork.tile % mTilesWide * mTileSize;
+			const auto top = pWork.tile / mTilesWide * mTileSize;
+			RayStats stats;
+
+			for (auto y = top; y < std::min(top + mTileSize, mCamera.height); y++)
+			{
+				for (auto x = left; x < std::min(left + mTileSize, mCamera.width); x++)
+				{
+					const auto pixel = static_cast<size_t>(y) * mCamera.width + x;
+					auto & sum = mPixels[pixel];
+
+					for (auto sample = pWork.first; sample < pWork.end; sample++)
+					{
+						float offsetX, offsetY;
+						RaySamplePosition(x, y, sample, offsetX, offsetY);
+
+						RayVector origin, direction;
+						MakeEyeRay(mCamera, x + offsetX, y + offsetY, origin, direction);
+
+						//The position target keeps the first sample's hit, later ones are thrown away
+						float color[4];
+						float position[4];
+						stats += TraceRay(mScene, mCamera, origin, direction, color, sample == 0 ? &mTargets.position[pixel * 4] : position, mOptions.bvh);
+
+						const auto luminance = DisplayLuminance(color);
+
+						for (auto i = 0; i < 4; i++)
+						{
+							sum.color[i] += color[i];
+						}
+
+						sum.luminance += luminance;
+						sum.luminanceSquares += luminance * luminance;
+						sum.count++;
+					}
+				}
+			}
+
+			mTileSamples[pWork.tile] = pWork.end;
+
+			return stats;
+		}
+
+		// Only reads the pixels, so it can run for every tile at once between rounds
+		void UpdateError(const uint32_t pTile)
+		{
+			const auto left = pTile % mTilesWide * mTileSize;
+			const auto top = pTile / mTilesWide * mTileSize;
+			auto error = 0.0f;
+
+			for (auto y = top; y < std::min(top + mTileSize, mCamera.height); y++)
+			{
+				for (auto x = left; x < std::min(left + mTileSize, mCamera.width); x++)
+				{
+					const auto & sum = mPixels[static_cast<size_t>(y) * mCamera.width + x];
+					const auto count = static_cast<float>(sum.count);
+					const auto mean = MeanLuminance(sum);
+
+					//One sample has no spread of its own to measure, which leaves the contrast to decide
+					const auto variance = sum.count > 1 ? std::max(sum.luminanceSquares - sum.luminance * mean, 0.0f) / (count - 1.0f) : 0.0f;
+
+					auto contrast = 0.0f;
+
+					const auto neighbour = [&](const uint32_t pX, const uint32_t pY)
+					{
+						contrast = std::max(contrast, std::abs(mean - MeanLuminance(mPixels[static_cast<size_t>(pY) * mCamera.width + pX])));
+					};
+
+					if (x > 0)
+					{
+						neighbour(x - 1, y);
+					}
+
+					if (x + 1 < mCamera.width)
+					{
+						neighbour(x + 1, y);
+					}
+
+					if (y > 0)
+					{
+						neighbour(x, y - 1);
+					}
+
+					if (y + 1 < mCamera.height)
+					{
+						neighbour(x, y + 1);
+					}
+
+					error = std::max(error, std::sqrt(variance / count) + mOptions.contrastWeight * contrast / count);
+				}
+			}
+
+			mTileErrors[pTile] = error;
+		}
+
+		void Resolve(std::vector<uint32_t> * pPixelSamples) const
+		{
+			if (pPixelSamples)
+			{
+				pPixelSamples->resize(mPixels.size());
+			}
+
+			for (size_t pixel = 0; pixel < mPixels.size(); pixel++)
+			{
+				const auto & sum = mPixels[pixel];
+				const auto scale = sum.count ? 1.0f / sum.count : 0.0f;
+
+				for (auto i = 0; i < 4; i++)
+				{
+					mTargets.color[pixel * 4 + i] = sum.color[i] * scale;
+				}
+
+				if (pPixelSamples)
+				{
+					(*pPixelSamples)[pixel] = sum.count;
+				}
+			}
+		}
+	};
+}
+
+void Advanced_Rendering::RaySamplePosition(const uint32_t pX, const uint32_t pY, const uint32_t pSample, float & pOffsetX, float & pOffsetY)
+{
+	const auto stratum = StratumOrder[pSample % RaySampleStrata];
+	const auto bits = Hash(pX * 0x8da6b343u ^ Hash(pY * 0xd8163841u ^ Hash(pSample)));
+
+	pOffsetX = (stratum % 4 + Unit(bits)) * 0.25f;
+	pOffsetY = (stratum / 4 + Unit(Hash(bits))) * 0.25f;
+}
+
+RaySampleStats Advanced_Rendering::TraceRaysAdaptive(const RayScene & pScene, const RayCamera & pCamera, RayTargets & pTargets,
+	const RaySampleOptions & pOptions, std::vector<uint32_t> * pPixelSamples)
+{
+	if (pTargets.width != pCamera.width || pTargets.height != pCamera.height)
+	{
+		pTargets.Resize(pCamera.width, pCamera.height);
+	}
+
+	const auto start = Clock::now();
+	const auto threadCount = pOptions.threadCount != 0 ? pOptions.threadCount : WorkerCount();
+	const auto maxSamples = std::max(pOptions.maxSamples, 1u);
+	const auto firstSamples = std::min(std::max(pOptions.firstSamples, 1u), maxSamples);
+	const auto roundSamples = std::max(pOptions.roundSamples, 1u);
+	const auto pixels = static_cast<uint64_t>(pCamera.width) * pCamera.height;
+	const auto budget = pOptions.sampleBudget > 0.0f ? static_cast<uint64_t>(pOptions.sampleBudget * pixels) : std::numeric_limits<uint64_t>::max();
+
+	const auto overTime = [&]()
+	{
+		return pOptions.timeBudget > 0.0 && std::chrono::duration<double, std::milli>(Clock::now() - start).count() >= pOptions.timeBudget;
+	};
+
+	AdaptiveSampler sampler(pScene, pCamera, pOptions, pTargets);
+	RaySampleStats stats;
+
+	//Runs a round's work. When timed, tiles the time budget leaves untraced keep the samples they had.
+	const auto run = [&](const std::vector<TileWork> & pWork, const bool pTimed)
+	{
+		std::vector<RayStats> workStats(pWork.size());
+		std::vector<uint8_t> traced(pWork.size(), 0);
+
+		ParallelFor(static_cast<uint32_t>(pWork.size()), threadCount, [&](const uint32_t pIndex)
+		{
+			if (pTimed && pIndex > 0 && overTime())
+			{
+				return;
+			}
+
+			workStats[pIndex] = sampler.Trace(pWork[pIndex]);
+			traced[pIndex] = 1;
+		});
+
+		for (size_t i = 0; i < pWork.size(); i++)
+		{
+			if (traced[i])
+			{
+				stats.rays += workStats[i];
+				stats.samples += static_cast<uint64_t>(pWork[i].end - pWork[i].first) * sampler.TilePixels(pWork[i].tile);
+			}
+		}
+	};
+
+	const auto updateErrors = [&]()
+	{
+		ParallelFor(sampler.TileCount(), threadCount, [&](const uint32_t pTile)
+		{
+			sampler.UpdateError(pTile);
+		});
+	};
+
+	const auto needsSamples = [&](const uint32_t pTile)
+	{
+		return sampler.TileError(pTile) > pOptions.threshold && sampler.TileSamples(pTile) < maxSamples;
+	};
+
+	//The first pass always runs whole, or there would be pixels with nothing in them
+	std::vector<TileWork> work;
+
+	for (uint32_t tile = 0; tile < sampler.TileCount(); tile++)
+	{
+		work.push_back({ tile, 0, firstSamples });
+	}
+
+	run(work, false);
+
+	std::vector<uint32_t> candidates;
+
+	for (;;)
+	{
+		updateErrors();
+
+		candidates.clear();
+
+		for (uint32_t tile = 0; tile < sampler.TileCount(); tile++)
+		{
+			if (needsSamples(tile))
+			{
+				candidates.push_back(tile);
+			}
+		}
+
+		if (candidates.empty() || overTime())
+		{
+			break;
+		}
+
+		//Worst first, so a budget that runs out mid round goes where it helps most
+		std::stable_sort(candidates.begin(), candidates.end(), [&](const uint32_t pA, const uint32_t pB)
+		{
+			return sampler.TileError(pA) > sampler.TileError(pB);
+		});
+
+		work.clear();
+		auto planned = stats.samples;
+
+		for (const auto tile : candidates)
+		{
+			const auto first = sampler.TileSamples(tile);
+			const auto end = std::min(first + roundSamples, maxSamples);
+			const auto cost = static_cast<uint64_t>(end - first) * sampler.TilePixels(tile);
+
+			if (planned + cost > budget)
+			{
+				break;
+			}
+
+			planned += cost;
+			work.push_back({ tile, first, end });
+		}
+
+		if (work.empty())
+		{
+			break;
+		}
+
+		run(work, true);
+		stats.rounds++;
+	}
+
+	for (uint32_t tile = 0; tile < sampler.TileCount(); tile++)
+	{
+		stats.tilesOverThreshold += needsSamples(tile);
+	}
+
+	std::vector<uint32_t> counts;
+	sampler.Resolve(pPixelSamples ? pPixelSamples : &counts);
+
+	const auto & pixelSamples = pPixelSamples ? *pPixelSamples : counts;
+
+	if (!pixelSamples.empty())
+	{
+		const auto range = std::minmax_element(pixelSamples.begin(), pixelSamples.end());
+		stats.minPixelSamples = *range.first;
+		stats.maxPixelSamples = *range.second;
+	}
+
+	return stats;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "RayTracer.h"
+
+namespace Advanced_Rendering
+{
+	constexpr uint32_t RaySampleStrata = 16;		// a 4x4 grid over each pixel
+
+	struct RaySampleOptions
+	{
+		uint32_t tileSize = 8;			// pixels a side of the squares whose error decides where samples go
+		uint32_t firstSamples = 2;		// a pixel in the first pass
+		uint32_t maxSamples = 16;		// a pixel at most
+		uint32_t roundSamples = 2;		// a pixel added to each tile chosen in a round
+		float sampleBudget = 0.0f;		// samples a pixel over the whole image, 0 for no limit
+		double timeBudget = 0.0;		// milliseconds, 0 for no limit
+		float threshold = 0.01f;		// error in display luminance a tile is left at
+		float contrastWeight = 0.25f;	// of the step in mean luminance to a neighbouring pixel, divided by the samples
+		uint32_t threadCount = 0;		// 0 for every hardware thread
+		const RayBvh * bvh = nullptr;
+	};
+
+	struct RaySampleStats
+	{
+		RayStats rays;
+		uint64_t samples = 0;
+		uint32_t rounds = 0;			// after the first pass
+		uint32_t minPixelSamples = 0;
+		uint32_t maxPixelSamples = 0;
+		uint32_t tilesOverThreshold = 0;	// when a budget ran out first
+
+		double SamplesPerPixel(const uint32_t pPixels) const
+		{
+			return pPixels ? static_cast<double>(samples) / pPixels : 0.0;
+		}
+	};
+
+	// The pass supersampled where the image needs it. Every pixel is traced firstSamples times, then
+	// each round the tiles whose error is over threshold, worst first, get roundSamples more a pixel
+	// until they are under it, reach maxSamples or a budget runs out. A tile's error is the largest
+	// over its pixels of the standard error of the mean luminance, clamped to the display's 0 to 1,
+	// and the contrast to the next pixels, which catches edges a pixel's own samples all fell to one
+	// side of. Sample i of a pixel is jittered inside stratum i of the 4x4 grid, taken in an order
+	// whose every prefix of 4 covers the quadrants, so a pixel's samples stay stratified whatever
+	// its count, and the image is the same for any thread count unless the time budget stops it.
+	// firstSamples equal to maxSamples gives uniform supersampling. The colour target holds the
+	// mean of the samples and the position target a pixel's first sample's hit. pPixelSamples, if
+	// given, is filled with each pixel's sample count.
+	RaySampleStats TraceRaysAdaptive(const RayScene & pScene, const RayCamera & pCamera, RayTargets & pTargets,
+		const RaySampleOptions & pOptions = RaySampleOptions(), std::vector<uint32_t> * pPixelSamples = nullptr);
+
+	// Where sample pSample of a pixel falls in it, each coordinate in [0, 1)
+	void RaySamplePosition(uint32_t pX, uint32_t pY, uint32_t pSample, float & pOffsetX, float & pOffsetY);
+}
@@ -0,0 +1,136 @@
+#include "pch.h"
+#include "RaySceneBuffer.h"
+#include <algorithm>
+#include "Content/ShaderStructures.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	const char * const BufferNames[] = { "Spheres", "Triangles", "Quads", "Materials" };
+}
+
+RaySceneBuffer::RaySceneBuffer(const std::string & pSceneFile) : mSceneFile(pSceneFile)
+{
+}
+
+RaySceneBuffer::~RaySceneBuffer()
+{
+}
+
+void RaySceneBuffer::Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const RayGpuScene & pScene)
+{
+	auto device = pDeviceResources->GetD3DDevice();
+	auto registry = pDeviceResources->GetResourceRegistry();
+
+	const std::vector<float> * const streams[BufferCount] = { &pScene.spheres, &pScene.triangles, &pScene.quads, &pScene.materials };
+
+	ResourceDesc memory;
+	memory.kind = ResourceKind::StructuredBuffer;
+	memory.owner = "RaySceneBuffer";
+	memory.format = DdsFormat::R32G32B32A32_FLOAT;
+
+	for (unsigned int i = 0; i < BufferCount; i++)
+	{
+		//A buffer cannot be empty, so a scene without a kind of primitive keeps one unread element
+		const float empty[4] = {};
+		const auto elements = std::max<size_t>(streams[i]->size() / 4, 1);
+
+		D3D11_BUFFER_DESC bufferDesc;
+		ZeroMemory(&bufferDesc, sizeof bufferDesc);
+
+		bufferDesc.ByteWidth = static_cast<UINT>(elements * sizeof empty);
+		bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.StructureByteStride = sizeof empty;
+
+		D3D11_SUBRESOURCE_DATA data = { streams[i]->empty() ? empty : streams[i]->data(), 0, 0 };
+
+		DX::ThrowIfFailed(device->CreateBuffer(&bufferDesc, &data, mBuffers[i].ReleaseAndGetAddressOf()));
+
+		CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(D3D11_SRV_DIMENSION_BUFFER, DXGI_FORMAT_UNKNOWN, 0, static_cast<UINT>(elements));
+
+		DX::ThrowIfFailed(device->CreateShaderResourceView(mBuffers[i].Get(), &viewDesc, mViews[i].ReleaseAndGetAddressOf()));
+
+		memory.name = mSceneFile + " " + BufferNames[i];
+		memory.width = static_cast<uint32_t>(elements);
+		memory.bytes = bufferDesc.ByteWidth;
+		mMemory[i] = registry->Track(memory);
+	}
+
+	const SceneConstantBuffer counts = { pScene.sphereCount, pScene.triangleCount, pScene.quadCount,
+		pScene.sphereCount + pScene.triangleCount + pScene.quadCount };
+
+	CD3D11_BUFFER_DESC countsDesc(sizeof counts, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_IMMUTABLE);
+	D3D11_SUBRESOURCE_DATA countsData = { &counts, 0, 0 };
+
+	DX::ThrowIfFailed(device->CreateBuffer(&countsDesc, &countsData, mCounts.ReleaseAndGetAddressOf()));
+
+	memory.kind = ResourceKind::ConstantBuffer;
+	memory.format = DdsFormat::Unknown;
+	memory.name = mSceneFile + " Counts";
+	memory.width = countsDesc.ByteWidth;
+	memory.bytes = countsDesc.ByteWidth;
+	mCountsMemory = registry->Track(memory);
+}
+
+void RaySceneBuffer::Load(std::shared_ptr<DX::DeviceResources> pDeviceResources)
+{
+	RayScene scene;
+	uint32_t errorLine = 0;
+
+	//The pass still binds the scene, so one that does not load is reported and created empty
+	if (!LoadRayScene(mSceneFile, scene, errorLine))
+	{
+		const auto message = errorLine > 0 ?
+			mSceneFile + "(" + std::to_string(errorLine) + "): does not parse, the ray traced scene is empty\n" :
+			mSceneFile + ": cannot be read, the ray traced scene is empty\n";
+		OutputDebugStringA(message.c_str());
+
+		scene = RayScene();
+	}
+
+	Create(pDeviceResources, MakeRayGpuScene(scene));
+}
+
+JobHandle RaySceneBuffer::Load(AssetLoader & pLoader, std::shared_ptr<DX::DeviceResources> pDeviceResources)
+{
+	//Creating immutable buffers needs no immediate context, so this runs off the render thread
+	return pLoader.Add(JobQueue::Worker, [this, pDeviceResources]()
+	{
+		Load(pDeviceResources);
+	});
+}
+
+void RaySceneBuffer::UseScene(std::shared_ptr<DX::DeviceResources> pDeviceResources, const unsigned int pCountsSlot) const
+{
+	auto context = pDeviceResources->GetD3DDeviceContext();
+
+	ID3D11ShaderResourceView * const views[BufferCount] = { mViews[0].Get(), mViews[1].Get(), mViews[2].Get(), mViews[3].Get() };
+
+	context->PSSetShaderResources(0, BufferCount, views);
+	context->PSSetConstantBuffers(pCountsSlot, 1, mCounts.GetAddressOf());
+}
+
+void RaySceneBuffer::ReleaseScene(std::shared_ptr<DX::DeviceResources> pDeviceResources) const
+{
+	auto context = pDeviceResources->GetD3DDeviceContext();
+
+	ID3D11ShaderResourceView * const views[BufferCount] = {};
+
+	context->PSSetShaderResources(0, BufferCount, views);
+}
+
+void RaySceneBuffer::Reset()
+{
+	for (unsigned int i = 0; i < BufferCount; i++)
+	{
+		mViews[i].Reset();
+		mBuffers[i].Reset();
+		mMemory[i].Reset();
+	}
+
+	mCounts.Reset();
+	mCountsMemory.Reset();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include "..\Common\DirectXHelper.h"
+#include "..\Common\DeviceResources.h"
+#include "AssetLoader.h"
+#include "RaySceneFile.h"
+
+namespace Advanced_Rendering
+{
+	// A .scene file as the ray tracing pixel shader's structured buffers, bound to t0 to t3, and the
+	// counts that go with them as an immutable constant buffer
+	class RaySceneBuffer
+	{
+		static constexpr unsigned int BufferCount = 4;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mBuffers[BufferCount];
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> mViews[BufferCount];
+		Microsoft::WRL::ComPtr<ID3D11Buffer> mCounts;
+		std::string mSceneFile;
+		ResourceHandle mMemory[BufferCount];
+		ResourceHandle mCountsMemory;
+
+		void Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const RayGpuScene & pScene);
+
+	public:
+		RaySceneBuffer(const std::string & pSceneFile);
+		~RaySceneBuffer();
+
+		RaySceneBuffer(const RaySceneBuffer &) = delete;
+		RaySceneBuffer(RaySceneBuffer &&) = delete;
+		RaySceneBuffer & operator= (const RaySceneBuffer &) = delete;
+		RaySceneBuffer & operator= (RaySceneBuffer &&) = delete;
+
+		void Load(std::shared_ptr<DX::DeviceResources> pDeviceResources);
+
+		// Parses and creates on the worker threads, returns the job. A scene that does not load is
+		// reported in the debugger's output and created empty, so the counts and buffers are always bound.
+		JobHandle Load(AssetLoader & pLoader, std::shared_ptr<DX::DeviceResources> pDeviceResources);
+		void UseScene(std::shared_ptr<DX::DeviceResources> pDeviceResources, unsigned int pCountsSlot) const;
+		void ReleaseScene(std::shared_ptr<DX::DeviceResources> pDeviceResources) const;
+		void Reset();
+	};
+}
@@ -0,0 +1,498 @@
+#include "RaySceneFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include "MappedFile.h"
+#include "TextScan.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	// One statement, past any comment and with the keyword read
+	class Statement
+	{
+		const char * mPosition;
+		const char * mEnd;
+
+	public:
+		Statement(const char * pBegin, const char * pEnd) : mPosition(pBegin), mEnd(pEnd)
+		{
+		}
+
+		bool Word(const char * & pBegin, const char * & pEnd)
+		{
+			pBegin = SkipSpace(mPosition, mEnd);
+			pEnd = pBegin;
+
+			while (pEnd < mEnd && !IsSpace(*pEnd))
+			{
+				pEnd++;
+			}
+
+			mPosition = pEnd;
+
+			return pBegin < pEnd;
+		}
+
+		bool Floats(float * pValues, const uint32_t pCount)
+		{
+			for (uint32_t i = 0; i < pCount; i++)
+			{
+				const auto begin = SkipSpace(mPosition, mEnd);
+				const auto end = ParseFloat(begin, mEnd, pValues[i]);
+
+				//A value runs to the next space, so 1.0x is not taken for 1.0
+				if (!end || (end < mEnd && !IsSpace(*end)))
+				{
+					return false;
+				}
+
+				mPosition = end;
+			}
+
+			return true;
+		}
+
+		bool Vector(RayVector & pVector)
+		{
+			float values[3];
+
+			if (!Floats(values, 3))
+			{
+				return false;
+			}
+
+			pVector = { values[0], values[1], values[2] };
+
+			return true;
+		}
+
+		bool AtEnd() const
+		{
+			return SkipSpace(mPosition, mEnd) == mEnd;
+		}
+	};
+
+	bool IsWord(const char * pBegin, const char * pEnd, const char * pWord)
+	{
+		const auto length = std::strlen(pWord);
+
+		return static_cast<size_t>(pEnd - pBegin) == length && std::memcmp(pBegin, pWord, length) == 0;
+	}
+
+	using MaterialMap = std::unordered_map<std::string, RayMaterial>;
+
+	bool ParseMaterial(Statement & pStatement, const MaterialMap & pMaterials, RayMaterial & pMaterial)
+	{
+		const char * begin;
+		const char * end;
+
+		if (!pStatement.Word(begin, end))
+		{
+			return false;
+		}
+
+		const auto material = pMaterials.find(std::string(begin, end));
+
+		if (material == pMaterials.end())
+		{
+			return false;
+		}
+
+		pMaterial = material->second;
+
+		return true;
+	}
+
+	bool ParseStatement(Statement & pStatement, RayScene & pScene, MaterialMap & pMaterials)
+	{
+		const char * begin;
+		const char * end;
+
+		//Blank and comment lines
+		if (!pStatement.Word(begin, end))
+		{
+			return true;
+		}
+
+		if (IsWord(begin, end, "material"))
+		{
+			const char * nameBegin;
+			const char * nameEnd;
+			float values[8];
+
+			if (!pStatement.Word(nameBegin, nameEnd) || !pStatement.Floats(values, 8))
+			{
+				return false;
+			}
+
+			const RayMaterial material = { { values[0], values[1], values[2], values[3] }, values[4], values[5], values[6], values[7] };
+			pMaterials[std::string(nameBegin, nameEnd)] = material;
+
+			return true;
+		}
+
+		if (IsWord(begin, end, "sphere"))
+		{
+			RaySphere sphere;
+
+			if (!ParseMaterial(pStatement, pMaterials, sphere.material) || !pStatement.Vector(sphere.centre) || !pStatement.Floats(&sphere.radius, 1))
+			{
+				return false;
+			}
+
+			pScene.spheres.push_back(sphere);
+
+			return true;
+		}
+
+		if (IsWord(begin, end, "triangle"))
+		{
+			RayTriangle triangle;
+
+			if (!ParseMaterial(pStatement, pMaterials, triangle.material) || !pStatement.Vector(triangle.a) || !pStatement.Vector(triangle.b) ||
+				!pStatement.Vector(triangle.c))
+			{
+				return false;
+			}
+
+			pScene.triangles.push_back(triangle);
+
+			return true;
+		}
+
+		if (IsWord(begin, end, "quad"))
+		{
+			RayQuad quad;
+
+			if (!ParseMaterial(pStatement, pMaterials, quad.material) || !pStatement.Vector(quad.centre) || !pStatement.Vector(quad.normal) ||
+				!pStatement.Vector(quad.tangent) || !pStatement.Vector(quad.biTangent) || !pStatement.Floats(quad.size, 2))
+			{
+				return false;
+			}
+
+			pScene.quads.push_back(quad);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool SameMaterial(const RayMaterial & pA, const RayMaterial & pB)
+	{
+		return std::memcmp(&pA, &pB, sizeof(RayMaterial)) == 0;
+	}
+
+	void PutFloats(std::string & pLine, const float * pValues, const uint32_t pCount)
+	{
+		char buffer[32];
+
+		for (uint32_t i = 0; i < pCount; i++)
+		{
+			//Nine significant digits are enough to read back any float exactly
+			std::snprintf(buffer, sizeof buffer, " %.9g", pValues[i]);
+			pLine += buffer;
+		}
+	}
+
+	void PutVector(std::string & pLine, const RayVector & pVector)
+	{
+		const float values[3] = { pVector.x, pVector.y, pVector.z };
+		PutFloats(pLine, values, 3);
+	}
+
+	void PutVector(std::vector<float> & pStream, const RayVector & pVector, const float pW)
+	{
+		pStream.insert(pStream.end(), { pVector.x, pVector.y, pVector.z, pW });
+	}
+
+	RayVector GetVector(const float * pValues)
+	{
+		return { pValues[0], pValues[1], pValues[2] };
+	}
+}
+
+bool Advanced_Rendering::ParseRayScene(const char * pBegin, const char * pEnd, RayScene & pScene, uint32_t & pErrorLine)
+{
+	RayScene scene;
+	MaterialMap materials;
+
+	pErrorLine = 0;
+	uint32_t line = 1;
+
+	for (auto begin = pBegin; begin < pEnd; line++)
+	{
+		auto end = static_cast<const char *>(std::memchr(begin, '\n', pEnd - begin));
+		end = end ? end : pEnd;
+
+		auto comment = static_cast<const char *>(std::memchr(begin, '#', end - begin));
+		Statement statement(begin, comment ? comment : end);
+
+		if (!ParseStatement(statement, scene, materials) || !statement.AtEnd())
+		{
+			pErrorLine = line;
+			return false;
+		}
+
+		begin = end + 1;
+	}
+
+	pScene = std::move(scene);
+
+	return true;
+}
+
+bool Advanced_Rendering::LoadRayScene(const std::string & pFilename, RayScene & pScene, uint32_t & pErrorLine)
+{
+	MappedFile file;
+	pErrorLine = 0;
+
+	if (!file.Open(pFilename))
+	{
+		return false;
+	}
+
+	const auto begin = reinterpret_cast<const char *>(file.Data());
+
+	return ParseRayScene(begin, begin + file.Size(), pScene, pErrorLine);
+}
+
+bool Advanced_Rendering::WriteRayScene(const std::string & pFilename, const RayScene & pScene)
+{
+	std::ofstream myfile(pFilename, std::ios::binary | std::ios::trunc);
+
+	if (!myfile)
+	{
+		return false;
+	}
+
+	std::vector<RayMaterial> materials;
+	std::string line;
+
+	//Name each distinct material by its place in the list, writing it before its first use
+	const auto materialName = [&](const RayMaterial & pMaterial)
+	{
+		uint32_t index = 0;
+
+		while (index < materials.size() && !SameMaterial(materials[index], pMaterial))
+		{
+			index++;
+		}
+
+		const auto name = "m" + std::to_string(index);
+
+		if (index == materials.size())
+		{
+			materials.push_back(pMaterial);
+
+			line = "material " + name;
+			PutFloats(line, pMaterial.color, 4);
+			PutFloats(line, &pMaterial.kd, 1);
+			PutFloats(line, &pMaterial.ks, 1);
+			PutFloats(line, &pMaterial.kr, 1);
+			PutFloats(line, &pMaterial.shininess, 1);
+			myfile << line << '\n';
+		}
+
+		return name;
+	};
+
+	for (const auto & sphere : pScene.spheres)
+	{
+		const auto material = materialName(sphere.material);
+
+		line = "sphere " + material;
+		PutVector(line, sphere.centre);
+		PutFloats(line, &sphere.radius, 1);
+		myfile << line << '\n';
+	}
+
+	for (const auto & triangle : pScene.triangles)
+	{
+		const auto material = materialName(triangle.material);
+
+		line = "triangle " + material;
+		PutVector(line, triangle.a);
+		PutVector(line, triangle.b);
+		PutVector(line, triangle.c);
+		myfile << line << '\n';
+	}
+
+	for (const auto & quad : pScene.quads)
+	{
+		const auto material = materialName(quad.material);
+
+		line = "quad " + material;
+		PutVector(line, quad.centre);
+		PutVector(line, quad.normal);
+		PutVector(line, quad.tangent);
+		PutVector(line, quad.biTangent);
+		PutFloats(line, quad.size, 2);
+		myfile << line << '\n';
+	}
+
+	return static_cast<bool>(myfile);
+}
+
+RayGpuScene Advanced_Rendering::MakeRayGpuScene(const RayScene & pScene)
+{
+	RayGpuScene gpuScene;
+
+	gpuScene.sphereCount = static_cast<uint32_t>(pScene.spheres.size());
+	gpuScene.triangleCount = static_cast<uint32_t>(pScene.triangles.size());
+	gpuScene.quadCount = static_cast<uint32_t>(pScene.quads.size());
+
+	const auto objectCount = gpuScene.sphereCount + gpuScene.triangleCount + gpuScene.quadCount;
+
+	gpuScene.spheres.reserve(static_cast<size_t>(gpuScene.sphereCount) * RayGpuSphereStreams * 4);
+	gpuScene.triangles.reserve(static_cast<size_t>(gpuScene.triangleCount) * RayGpuTriangleStreams * 4);
+	gpuScene.quads.reserve(static_cast<size_t>(gpuScene.quadCount) * RayGpuQuadStreams * 4);
+	gpuScene.materials.resize(static_cast<size_t>(objectCount) * RayGpuMaterialStreams * 4);
+
+	for (const auto & sphere : pScene.spheres)
+	{
+		PutVector(gpuScene.spheres, sphere.centre, sphere.radius);
+	}
+
+	for (const auto & triangle : pScene.triangles)
+	{
+		PutVector(gpuScene.triangles, triangle.a, 0.0f);
+	}
+
+	for (const auto & triangle : pScene.triangles)
+	{
+		PutVector(gpuScene.triangles, triangle.b, 0.0f);
+	}
+
+	for (const auto & triangle : pScene.triangles)
+	{
+		PutVector(gpuScene.triangles, triangle.c, 0.0f);
+	}
+
+	for (const auto & quad : pScene.quads)
+	{
+		PutVector(gpuScene.quads, quad.centre, quad.size[0]);
+	}
+
+	for (const auto & quad : pScene.quads)
+	{
+		PutVector(gpuScene.quads, quad.normal, quad.size[1]);
+	}
+
+	for (const auto & quad : pScene.quads)
+	{
+		PutVector(gpuScene.quads, quad.tangent, 0.0f);
+	}
+
+	for (const auto & quad : pScene.quads)
+	{
+		PutVector(gpuScene.quads, quad.biTangent, 0.0f);
+	}
+
+	uint32_t object = 0;
+
+	const auto putMaterial = [&](const RayMaterial & pMaterial)
+	{
+		auto color = gpuScene.materials.data() + static_cast<size_t>(object) * 4;
+		auto shading = color + static_cast<size_t>(objectCount) * 4;
+
+		std::memcpy(color, pMaterial.color, sizeof pMaterial.color);
+		shading[0] = pMaterial.kd;
+		shading[1] = pMaterial.ks;
+		shading[2] = pMaterial.kr;
+		shading[3] = pMaterial.shininess;
+
+		object++;
+	};
+
+	for (const auto & sphere : pScene.spheres)
+	{
+		putMaterial(sphere.material);
+	}
+
+	for (const auto & triangle : pScene.triangles)
+	{
+		putMaterial(triangle.material);
+	}
+
+	for (const auto & quad : pScene.quads)
+	{
+		putMaterial(quad.material);
+	}
+
+	return gpuScene;
+}
+
+RayScene Advanced_Rendering::RaySceneFromGpu(const RayGpuScene & pGpuScene)
+{
+	RayScene scene;
+
+	scene.spheres.resize(pGpuScene.sphereCount);
+	scene.triangles.resize(pGpuScene.triangleCount);
+	scene.quads.resize(pGpuScene.quadCount);
+
+	const auto objectCount = static_cast<size_t>(pGpuScene.sphereCount) + pGpuScene.triangleCount + pGpuScene.quadCount;
+
+	//Field f of primitive i in a buffer of count primitives
+	const auto field = [](const std::vector<float> & pBuffer, const size_t pCount, const uint32_t pField, const size_t pIndex)
+	{
+		return pBuffer.data() + (pField * pCount + pIndex) * 4;
+	};
+
+	size_t object = 0;
+
+	const auto getMaterial = [&](RayMaterial & pMaterial)
+	{
+		const auto color = field(pGpuScene.materials, objectCount, 0, object);
+		const auto shading = field(pGpuScene.materials, objectCount, 1, object);
+
+		std::memcpy(pMaterial.color, color, sizeof pMaterial.color);
+		pMaterial.kd = shading[0];
+		pMaterial.ks = shading[1];
+		pMaterial.kr = shading[2];
+		pMaterial.shininess = shading[3];
+
+		object++;
+	};
+
+	for (size_t i = 0; i < scene.spheres.size(); i++)
+	{
+		auto & sphere = scene.spheres[i];
+		const auto centre = field(pGpuScene.spheres, scene.spheres.size(), 0, i);
+
+		sphere.centre = GetVector(centre);
+		sphere.radius = centre[3];
+		getMaterial(sphere.material);
+	}
+
+	for (size_t i = 0; i < scene.triangles.size(); i++)
+	{
+		auto & triangle = scene.triangles[i];
+
+		triangle.a = GetVector(field(pGpuScene.triangles, scene.triangles.size(), 0, i));
+		triangle.b = GetVector(field(pGpuScene.triangles, scene.triangles.size(), 1, i));
+		triangle.c = GetVector(field(pGpuScene.triangles, scene.triangles.size(), 2, i));
+		getMaterial(triangle.material);
+	}
+
+	for (size_t i = 0; i < scene.quads.size(); i++)
+	{
+		auto & quad = scene.quads[i];
+		const auto centre = field(pGpuScene.quads, scene.quads.size(), 0, i);
+		const auto normal = field(pGpuScene.quads, scene.quads.size(), 1, i);
+
+		quad.centre = GetVector(centre);
+		quad.normal = GetVector(normal);
+		quad.tangent = GetVector(field(pGpuScene.quads, scene.quads.size(), 2, i));
+		quad.biTangent = GetVector(field(pGpuScene.quads, scene.quads.size(), 3, i));
+		quad.size[0] = centre[3];
+		quad.size[1] = normal[3];
+		getMaterial(quad.material);
+	}
+
+	return scene;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RayTracer.h"
+
+namespace Advanced_Rendering
+{
+	// .scene: the ray traced scene, one statement a line and # to the end of a line a comment.
+	//   material <name> <r> <g> <b> <a> <kd> <ks> <kr> <shininess>
+	//   sphere <material> <centre xyz> <radius>
+	//   triangle <material> <a xyz> <b xyz> <c xyz>
+	//   quad <material> <centre xyz> <normal xyz> <tangent xyz> <bitangent xyz> <half width> <half height>
+	// A material is named before it is used. Each kind of primitive is numbered in file order, and
+	// hits run through the spheres, then the triangles, then the quads as in RayScene.
+
+	// pErrorLine is set to the first line that does not parse, or 0 when the text does
+	bool ParseRayScene(const char * pBegin, const char * pEnd, RayScene & pScene, uint32_t & pErrorLine);
+
+	bool LoadRayScene(const std::string & pFilename, RayScene & pScene, uint32_t & pErrorLine);
+
+	// Writes every float to the digit, so LoadRayScene gives back the same scene. Materials that are
+	// equal are written once.
+	bool WriteRayScene(const std::string & pFilename, const RayScene & pScene);
+
+	// The scene as the pixel shader's structured buffers of float4, a buffer to each kind of primitive
+	// and one to the materials. Each buffer holds one stream after another, a stream being a single
+	// float4 of every primitive, so the threads of a wave loading the same field of neighbouring
+	// primitives read neighbouring memory.
+	//   spheres:   centre, radius
+	//   triangles: a | b | c
+	//   quads:     centre, half width | normal, half height | tangent | bitangent
+	//   materials: color | kd, ks, kr, shininess, over every object in hit order
+	struct RayGpuScene
+	{
+		uint32_t sphereCount = 0;
+		uint32_t triangleCount = 0;
+		uint32_t quadCount = 0;
+
+		std::vector<float> spheres;
+		std::vector<float> triangles;
+		std::vector<float> quads;
+		std::vector<float> materials;
+	};
+
+	constexpr uint32_t RayGpuSphereStreams = 1;
+	constexpr uint32_t RayGpuTriangleStreams = 3;
+	constexpr uint32_t RayGpuQuadStreams = 4;
+	constexpr uint32_t RayGpuMaterialStreams = 2;
+
+	RayGpuScene MakeRayGpuScene(const RayScene & pScene);
+
+	// Reads the scene back out of its buffers
+	RayScene RaySceneFromGpu(const RayGpuScene & pGpuScene);
+}
@@ -0,0 +1,527 @@
+#include "RayTracer.h"
+
+#include <algorithm>
+#include "Parallel.h"
+#include "RayBvh.h"
+#include "TileScheduler.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	// The functions below follow RayTracingPixelShader.hlsl line for line, quirks included, so the CPU
+	// and GPU images agree
+	float SphereIntersect(const RaySphere & pSphere, const RayVector & pOrigin, const RayVector & pDirection, const float pFarPlane, bool & pHit)
+	{
+		const auto v = pSphere.centre - pOrigin;
+		const auto a = v.Dot(pDirection);
+		const auto b = v.Dot(v) - a * a;
+		const auto r = pSphere.radius;
+
+		if (b > r * r)
+		{
+			pHit = false;
+			return pFarPlane;
+		}
+
+		const auto t = a - std::sqrt(r * r - b);
+		pHit = !(t < 0.0f);
+
+		return t;
+	}
+
+	float QuadIntersect(const RayQuad & pQuad, const RayVector & pOrigin, const RayVector & pDirection, const float pFarPlane, bool & pHit)
+	{
+		const auto c = pDirection.Dot(pQuad.normal);
+
+		pHit = false;
+
+		if (std::abs(c) < RayEpsilon)
+		{
+			return pFarPlane;
+		}
+
+		const auto t = (pQuad.centre - pOrigin).Dot(pQuad.normal) / c;
+
+		if (!(t < RayEpsilon))
+		{
+			const auto offset = pOrigin + pDirection * t - pQuad.centre;
+			pHit = std::abs(offset.Dot(pQuad.tangent)) <= pQuad.size[0] && std::abs(offset.Dot(pQuad.biTangent)) <= pQuad.size[1];
+		}
+
+		return t;
+	}
+
+	RayVector TriangleNormal(const RayTriangle & pTriangle)
+	{
+		return (pTriangle.b - pTriangle.a).Cross(pTriangle.c - pTriangle.a).Normalized();
+	}
+
+	float TriangleIntersect(const RayTriangle & pTriangle, const RayVector & pOrigin, const RayVector & pDirection, const float pFarPlane, bool & pHit)
+	{
+		const auto normal = TriangleNormal(pTriangle);
+		const auto c = pDirection.Dot(normal);
+
+		pHit = false;
+
+		if (std::abs(c) < RayEpsilon)
+		{
+			return pFarPlane;
+		}
+
+		const auto t = (pTriangle.a - pOrigin).Dot(normal) / c;
+		const auto p = pOrigin + pDirection * t;
+
+		pHit = !(t < RayEpsilon) &&
+			!(normal.Dot((pTriangle.b - pTriangle.a).Cross(p - pTriangle.a)) < 0.0f) &&
+			!(normal.Dot((pTriangle.c - pTriangle.b).Cross(p - pTriangle.b)) < 0.0f) &&
+			!(normal.Dot((pTriangle.a - pTriangle.c).Cross(p - pTriangle.c)) < 0.0f);
+
+		return t;
+	}
+
+	float Saturate(const float pValue)
+	{
+		return std::min(std::max(pValue, 0.0f), 1.0f);
+	}
+
+	float Frac(const float pValue)
+	{
+		return pValue - std::floor(pValue);
+	}
+
+	void Transform(const float * pVector, const float * pMatrix, float * pOutput)
+	{
+		for (auto column = 0; column < 4; column++)
+		{
+			pOutput[column] = pVector[0] * pMatrix[column] + pVector[1] * pMatrix[4 + column] + pVector[2] * pMatrix[8 + column] +
+				pVector[3] * pMatrix[12 + column];
+		}
+	}
+
+	RayMaterial Material(const float pRed, const float pGreen, const float pBlue, const float pKd, const float pKs, const float pKr)
+	{
+		return { { pRed, pGreen, pBlue, 1.0f }, pKd, pKs, pKr, 40.0f };
+	}
+}
+
+RayScene Advanced_Rendering::DefaultRayScene()
+{
+	RayScene scene;
+
+	scene.spheres = {
+		{ { 0.0f, 5.0f, 0.0f }, 1.0f, Material(1.0f, 0.0f, 0.0f, 0.3f, 0.5f, 0.4f) },
+		{ { 2.0f, 5.0f, -2.0f }, 0.5f, Material(0.0f, 1.0f, 0.0f, 0.5f, 0.7f, 0.3f) },
+		{ { -2.0f, 5.0f, 2.0f }, 0.25f, Material(0.0f, 0.0f, 1.0f, 0.5f, 0.3f, 0.2f) }
+	};
+
+	const auto yellow = Material(1.0f, 1.0f, 0.0f, 0.5f, 0.3f, 0.1f);
+
+	scene.triangles = {
+		{ { -1.0f, -1.0f, -1.0f }, { 1.0f, -1.0f, -1.0f }, { 0.0f, 1.0f, 0.0f }, yellow },
+		{ { -1.0f, -1.0f, 1.0f }, { 1.0f, -1.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }, yellow },
+		{ { -1.0f, -1.0f, -1.0f }, { -1.0f, -1.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }, yellow },
+		{ { 1.0f, -1.0f, -1.0f }, { 1.0f, -1.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }, yellow }
+	};
+
+	const auto white = Material(1.0f, 1.0f, 1.0f, 0.5f, 0.3f, 0.1f);
+
+	scene.quads = {
+		{ { 0.0f, 3.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f }, white },
+		{ { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f }, white },
+		{ { 0.0f, 2.0f, 1.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f }, white },
+		{ { 0.0f, 2.0f, -1.0f }, { 0.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f }, white },
+		{ { 1.0f, 2.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f }, white },
+		{ { -1.0f, 2.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f }, white }
+	};
+
+	return scene;
+}
+
+RayCamera Advanced_Rendering::MakeRayCamera(const RayVector & pEye, const RayVector & pTarget, const RayVector & pUp, const uint32_t pWidth,
+	const uint32_t pHeight, const float pFov)
+{
+	RayCamera camera = {};
+
+	const auto zAxis = (pEye - pTarget).Normalized();
+	const auto xAxis = pUp.Cross(zAxis).Normalized();
+	const auto yAxis = zAxis.Cross(xAxis);
+
+	const float view[16] = {
+		xAxis.x, yAxis.x, zAxis.x, 0.0f,
+		xAxis.y, yAxis.y, zAxis.y, 0.0f,
+		xAxis.z, yAxis.z, zAxis.z, 0.0f,
+		-xAxis.Dot(pEye), -yAxis.Dot(pEye), -zAxis.Dot(pEye), 1.0f
+	};
+
+	std::copy(view, view + 16, camera.view);
+
+	camera.eye = pEye;
+	camera.aspectRatio = static_cast<float>(pWidth) / pHeight;
+	camera.fov = pFov;
+	camera.nearPlane = 1.0f;
+	camera.farPlane = 1000.0f;
+	camera.width = pWidth;
+	camera.height = pHeight;
+
+	const auto height = 1.0f / std::tan(pFov * 0.5f);
+	const auto range = camera.farPlane / (camera.nearPlane - camera.farPlane);
+
+	camera.projection[0] = height / camera.aspectRatio;
+	camera.projection[5] = height;
+	camera.projection[10] = range;
+	camera.projection[11] = -1.0f;
+	camera.projection[14] = range * camera.nearPlane;
+
+	camera.lightPosition = pEye + RayVector{ 0.0f, 5.0f, 0.0f };
+	std::fill(camera.lightColor, camera.lightColor + 4, 1.0f);
+
+	return camera;
+}
+
+void Advanced_Rendering::MakeEyeRay(const RayCamera & pCamera, const float pX, const float pY, RayVector & pOrigin, RayVector & pDirection)
+{
+	//The full screen quad's canvas runs -1 to 1 left to right and top to bottom
+	const auto canvasX = pX / pCamera.width * 2.0f - 1.0f;
+	const auto canvasY = pY / pCamera.height * 2.0f - 1.0f;
+	const auto scale = std::tan(pCamera.fov / 2.0f);
+
+	const auto pixel = RayVector{ canvasX * scale * pCamera.aspectRatio, canvasY * scale, -1.0f }.Normalized();
+
+	const auto xAxis = RayVector{ pCamera.view[0], pCamera.view[4], pCamera.view[8] };
+	const auto yAxis = RayVector{ pCamera.view[1], pCamera.view[5], pCamera.view[9] };
+	const auto zAxis = RayVector{ pCamera.view[2], pCamera.view[6], pCamera.view[10] };
+
+	pOrigin = pCamera.eye;
+	pDirection = (xAxis * pixel.x + yAxis * pixel.y + zAxis * pixel.z).Normalized();
+}
+
+float Advanced_Rendering::NearestRayHit(const RayScene & pScene, const RayVector & pOrigin, const RayVector & pDirection, const float pFarPlane,
+	int & pHitObject)
+{
+	auto minT = pFarPlane;
+	auto object = 0;
+
+	pHitObject = -1;
+
+	auto test = [&](const float pT, const bool pHit)
+	{
+		if (pHit && pT < minT)
+		{
+			pHitObject = object;
+			minT = pT;
+		}
+
+		object++;
+	};
+
+	for (const auto & sphere : pScene.spheres)
+	{
+		bool hit;
+		const auto t = SphereIntersect(sphere, pOrigin, pDirection, pFarPlane, hit);
+		test(t, hit);
+	}
+
+	for (const auto & triangle : pScene.triangles)
+	{
+		bool hit;
+		const auto t = TriangleIntersect(triangle, pOrigin, pDirection, pFarPlane, hit);
+		test(t, hit);
+	}
+
+	for (const auto & quad : pScene.quads)
+	{
+		bool hit;
+		const auto t = QuadIntersect(quad, pOrigin, pDirection, pFarPlane, hit);
+		test(t, hit);
+	}
+
+	return minT;
+}
+
+float Advanced_Rendering::RayObjectIntersect(const RayScene & pScene, const int pObject, const RayVector & pOrigin, const RayVector & pDirection,
+	const float pFarPlane, bool & pHit)
+{
+	const auto triangleStart = static_cast<int>(pScene.spheres.size());
+	const auto quadStart = triangleStart + static_cast<int>(pScene.triangles.size());
+
+	if (pObject < triangleStart)
+	{
+		return SphereIntersect(pScene.spheres[pObject], pOrigin, pDirection, pFarPlane, pHit);
+	}
+
+	if (pObject < quadStart)
+	{
+		return TriangleIntersect(pScene.triangles[pObject - triangleStart], pOrigin, pDirection, pFarPlane, pHit);
+	}
+
+	return QuadIntersect(pScene.quads[pObject - quadStart], pOrigin, pDirection, pFarPlane, pHit);
+}
+
+void Advanced_Rendering::MakeShadowRay(const RayCamera & pCamera, const RayVector & pHitPosition, RayVector & pOrigin, RayVector & pDirection,
+	float & pDistance)
+{
+	pDirection = (pCamera.lightPosition - pHitPosition).Normalized();
+	pOrigin = pHitPosition + pDirection * RayEpsilon;
+	pDistance = (pHitPosition - pCamera.lightPosition).Length();
+}
+
+float Advanced_Rendering::RayShadow(const RayScene & pScene, const RayVector & pOrigin, const RayVector & pDirection, const float pDistance,
+	const float pFarPlane)
+{
+	auto anyHit = 0.0f;
+
+	for (const auto & sphere : pScene.spheres)
+	{
+		bool hit;
+		const auto t = SphereIntersect(sphere, pOrigin, pDirection, pFarPlane, hit);
+
+		if (hit && t < pDistance)
+		{
+			anyHit = 1.0f;
+		}
+	}
+
+	for (const auto & triangle : pScene.triangles)
+	{
+		bool hit;
+		const auto t = TriangleIntersect(triangle, pOrigin, pDirection, pFarPlane, hit);
+
+		if (hit && t < pDistance)
+		{
+			anyHit = 1.0f;
+		}
+	}
+
+	for (const auto & quad : pScene.quads)
+	{
+		bool hit;
+		const auto t = QuadIntersect(quad, pOrigin, pDirection, pFarPlane, hit);
+
+		if (hit && t < pDistance)
+		{
+			anyHit = 1.0f;
+		}
+	}
+
+	return anyHit;
+}
+
+RaySurface Advanced_Rendering::HitSurface(const RayScene & pScene, const int pHitObject, const RayVector & pHitPosition)
+{
+	const auto triangleStart = static_cast<int>(pScene.spheres.size());
+	const auto quadStart = triangleStart + static_cast<int>(pScene.triangles.size());
+
+	RaySurface surface;
+
+	if (pHitObject < triangleStart)
+	{
+		const auto & sphere = pScene.spheres[pHitObject];
+
+		surface.normal = (pHitPosition - sphere.centre).Normalized();
+		surface.material = &sphere.material;
+		std::copy(sphere.material.color, sphere.material.color + 4, surface.color);
+		surface.ambient = 0.1f;
+	}
+	else if (pHitObject < quadStart)
+	{
+		const auto & triangle = pScene.triangles[pHitObject - triangleStart];
+
+		surface.normal = TriangleNormal(triangle);
+		surface.material = &triangle.material;
+		std::copy(triangle.material.color, triangle.material.color + 4, surface.color);
+		surface.ambient = 0.1f;
+	}
+	else
+	{
+		const auto & quad = pScene.quads[pHitObject - quadStart];
+		const auto offset = pHitPosition - quad.centre;
+		const auto tangentSize = offset.Dot(quad.tangent);
+		const auto biTangentSize = offset.Dot(quad.biTangent);
+
+		surface.normal = quad.normal;
+		surface.material = &quad.material;
+		std::copy(quad.material.color, quad.material.color + 4, surface.color);
+		surface.ambient = 0.3f;
+
+		if (Frac((std::floor(tangentSize * 5.0f) + std::floor(biTangentSize * 5.0f)) * 0.5f) * 2.0f != 0.0f)
+		{
+			surface.color[0] *= 0.1f;
+			surface.color[1] *= 0.1f;
+			surface.color[2] *= 0.1f;
+		}
+
+		if (std::abs(tangentSize) / quad.size[0] > 0.8f || std::abs(biTangentSize) / quad.size[1] > 0.8f)
+		{
+			surface.color[0] = 0.59f;
+			surface.color[1] = 0.29f;
+			surface.color[2] = 0.0f;
+			surface.color[3] = 1.0f;
+		}
+	}
+
+	return surface;
+}
+
+void Advanced_Rendering::HitPhong(const RayCamera & pCamera, const RayVector & pHitPosition, const RaySurface & pSurface, const RayVector & pViewDirection,
+	float * pPhong)
+{
+	const auto lightDirection = (pCamera.lightPosition - pHitPosition).Normalized();
+
+	const auto nDotL = pSurface.normal.Dot(lightDirection);
+	const auto diffuse = Saturate(nDotL);
+	const auto specular = nDotL > 0.0f ? std::pow(Saturate(pViewDirection.Dot(lightDirection.Reflect(pSurface.normal))), pSurface.material->shininess) : 0.0f;
+
+	for (auto i = 0; i < 4; i++)
+	{
+		pPhong[i] = diffuse * pSurface.color[i] * pSurface.material->kd + specular * pSurface.color[i] * pSurface.material->ks;
+	}
+}
+
+void Advanced_Rendering::ShadeHit(const RayCamera & pCamera, const RayVector & pHitPosition, const RaySurface & pSurface, const RayVector & pViewDirection,
+	const float pShadow, const float pLightIntensity, float * pColor)
+{
+	float phong[4];
+	HitPhong(pCamera, pHitPosition, pSurface, pViewDirection, phong);
+
+	const auto lit = 1.0f - pShadow;
+
+	for (auto i = 0; i < 4; i++)
+	{
+		pColor[i] += pCamera.lightColor[i] * pLightIntensity * (lit * phong[i] + pSurface.color[i] * pSurface.ambient);
+	}
+}
+
+void Advanced_Rendering::ClipPosition(const RayCamera & pCamera, const RayVector & pHitPosition, float * pPosition)
+{
+	const float position[4] = { pHitPosition.x, pHitPosition.y, pHitPosition.z, 1.0f };
+	float viewPosition[4];
+
+	Transform(position, pCamera.view, viewPosition);
+	Transform(viewPosition, pCamera.projection, pPosition);
+}
+
+RayStats Advanced_Rendering::TraceRay(const RayScene & pScene, const RayCamera & pCamera, const RayVector & pOrigin, const RayVector & pDirection,
+	float * pColor, float * pPosition, const RayBvh * pBvh)
+{
+	RayStats stats;
+	stats.primaryRays = 1;
+
+	auto origin = pOrigin;
+	auto direction = pDirection;
+	auto lightIntensity = 1.0f;
+	int hitObject;
+
+	auto nearestHit = [&]()
+	{
+		return pBvh ? pBvh->NearestHit(origin, direction, pCamera.farPlane, hitObject) : NearestRayHit(pScene, origin, direction, pCamera.farPlane, hitObject);
+	};
+
+	auto shadow = [&](const RayVector & pShadowOrigin, const RayVector & pShadowDirection, const float pLightDistance)
+	{
+		if (!pBvh)
+		{
+			return RayShadow(pScene, pShadowOrigin, pShadowDirection, pLightDistance, pCamera.farPlane);
+		}
+
+		return pBvh->Occluded(pShadowOrigin, pShadowDirection, 0.0f, pLightDistance) ? 1.0f : 0.0f;
+	};
+
+	std::fill(pColor, pColor + 4, 0.0f);
+	std::fill(pPosition, pPosition + 4, 0.0f);
+
+	auto hitPosition = origin + direction * nearestHit();
+
+	for (auto depth = 1; depth < 5 && hitObject >= 0; depth++)
+	{
+		if (depth == 1)
+		{
+			ClipPosition(pCamera, hitPosition, pPosition);
+		}
+
+		const auto surface = HitSurface(pScene, hitObject, hitPosition);
+
+		RayVector shadowOrigin, shadowDirection;
+		float lightDistance;
+
+		MakeShadowRay(pCamera, hitPosition, shadowOrigin, shadowDirection, lightDistance);
+		ShadeHit(pCamera, hitPosition, surface, direction, shadow(shadowOrigin, shadowDirection, lightDistance), lightIntensity, pColor);
+		stats.shadowRays++;
+
+		//The shader traces a fifth ray after the last bounce and never uses it
+		if (depth == 4)
+		{
+			break;
+		}
+
+		lightIntensity *= surface.material->kr;
+		origin = hitPosition;
+		direction = direction.Reflect(surface.normal);
+		hitPosition = origin + direction * nearestHit();
+		stats.reflectionRays++;
+	}
+
+	return stats;
+}
+
+RayStats Advanced_Rendering::TraceRays(const RayScene & pScene, const RayCamera & pCamera, RayTargets & pTargets, const RayTraceOptions & pOptions)
+{
+	if (pTargets.width != pCamera.width || pTargets.height != pCamera.height)
+	{
+		pTargets.Resize(pCamera.width, pCamera.height);
+	}
+
+	auto trace = [&](const uint32_t pLeft, const uint32_t pTop, const uint32_t pRight, const uint32_t pBottom, RayStats & pStats)
+	{
+		for (auto y = pTop; y < pBottom; y++)
+		{
+			for (auto x = pLeft; x < pRight; x++)
+			{
+				const auto pixel = (static_cast<size_t>(y) * pCamera.width + x) * 4;
+				RayVector origin, direction;
+
+				MakeEyeRay(pCamera, x + 0.5f, y + 0.5f, origin, direction);
+				pStats += TraceRay(pScene, pCamera, origin, direction, &pTargets.color[pixel], &pTargets.position[pixel], pOptions.bvh);
+			}
+		}
+	};
+
+	std::vector<RayStats> tileStats;
+
+	if (pOptions.scheduler)
+	{
+		//One per thread rather than per tile, as the tiles change from run to run
+		pOptions.scheduler->Resize(pCamera.width, pCamera.height);
+		tileStats.resize(pOptions.scheduler->ThreadCount());
+
+		pOptions.scheduler->Run([&](const RenderTile & pTile, const uint32_t pThread)
+		{
+			trace(pTile.x, pTile.y, pTile.x + pTile.width, pTile.y + pTile.height, tileStats[pThread]);
+		});
+	}
+	else
+	{
+		const auto tileSize = std::max(pOptions.tileSize, 1u);
+		const auto tilesWide = (pCamera.width + tileSize - 1) / tileSize;
+		const auto tilesHigh = (pCamera.height + tileSize - 1) / tileSize;
+
+		tileStats.resize(static_cast<size_t>(tilesWide) * tilesHigh);
+
+		ParallelFor(static_cast<uint32_t>(tileStats.size()), pOptions.threadCount != 0 ? pOptions.threadCount : WorkerCount(), [&](const uint32_t pTile)
+		{
+			const auto left = pTile % tilesWide * tileSize;
+			const auto top = pTile / tilesWide * tileSize;
+
+			trace(left, top, std::min(left + tileSize, pCamera.width), std::min(top + tileSize, pCamera.height), tileStats[pTile]);
+		});
+	}
+
+	RayStats stats;
+
+	for (const auto & tile : tileStats)
+	{
+		stats += tile;
+	}
+
+	return stats;
+}
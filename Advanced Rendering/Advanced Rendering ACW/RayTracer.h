@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace Advanced_Rendering
+{
+	constexpr float RayEpsilon = 0.005f;
+
+	class RayBvh;
+	class TileScheduler;
+
+	struct RayVector
+	{
+		float x, y, z;
+
+		RayVector operator+ (const RayVector & pOther) const { return { x + pOther.x, y + pOther.y, z + pOther.z }; }
+		RayVector operator- (const RayVector & pOther) const { return { x - pOther.x, y - pOther.y, z - pOther.z }; }
+		RayVector operator* (const float pScale) const { return { x * pScale, y * pScale, z * pScale }; }
+
+		float Dot(const RayVector & pOther) const { return x * pOther.x + y * pOther.y + z * pOther.z; }
+		float Length() const { return std::sqrt(Dot(*this)); }
+
+		RayVector Cross(const RayVector & pOther) const
+		{
+			return { y * pOther.z - z * pOther.y, z * pOther.x - x * pOther.z, x * pOther.y - y * pOther.x };
+		}
+
+		RayVector Normalized() const
+		{
+			return *this * (1.0f / Length());
+		}
+
+		// HLSL's reflect, this being the incident direction
+		RayVector Reflect(const RayVector & pNormal) const
+		{
+			return *this - pNormal * (2.0f * Dot(pNormal));
+		}
+	};
+
+	// How a primitive is shaded, as the shader's objects store it
+	struct RayMaterial
+	{
+		float color[4];
+		float kd;
+		float ks;
+		float kr;						// share of the light carried on by the reflection
+		float shininess;
+	};
+
+	// The shader's Sphere calls the radius rad2, it is not squared
+	struct RaySphere
+	{
+		RayVector centre;
+		float radius;
+		RayMaterial material;
+	};
+
+	struct RayTriangle
+	{
+		RayVector a;
+		RayVector b;
+		RayVector c;
+		RayMaterial material;
+	};
+
+	// Checkered, with a border, over size half extents along the tangent and bitangent
+	struct RayQuad
+	{
+		RayVector centre;
+		RayVector normal;
+		RayVector tangent;
+		RayVector biTangent;
+		float size[2];
+		RayMaterial material;
+	};
+
+	// Hit indices run through the spheres, then the triangles, then the quads, as the shader numbers them
+	struct RayScene
+	{
+		std::vector<RaySphere> spheres;
+		std::vector<RayTriangle> triangles;
+		std::vector<RayQuad> quads;
+	};
+
+	// The three spheres, four triangles and six quads of raytracing.scene, which the app traces
+	RayScene DefaultRayScene();
+
+	// What the shader reads from its constant buffers. view and projection are row-major for row
+	// vectors, as DirectXMath builds them before they are transposed for upload.
+	struct RayCamera
+	{
+		float view[16];
+		float projection[16];
+		RayVector eye;
+
+		float aspectRatio;				// RayConstantBuffer
+		float fov;
+		float nearPlane;
+		float farPlane;
+		uint32_t width;
+		uint32_t height;
+
+		RayVector lightPosition;		// LightConstantBuffer
+		float lightColor[4];
+	};
+
+	// The camera as Camera::update and CreateWindowSizeDependentResources set it up, an
+	// XMMatrixLookAtRH view and XMMatrixPerspectiveFovRH projection from 1 to 1000, with the white
+	// light the renderer hangs 5 above the eye.
+	RayCamera MakeRayCamera(const RayVector & pEye, const RayVector & pTarget, const RayVector & pUp, uint32_t pWidth, uint32_t pHeight, float pFov);
+
+	// The pass's two R32G32B32A32_FLOAT targets, row by row from the top: the shaded colour, and the
+	// clip space position of the first hit, zero where the eye ray missed.
+	struct RayTargets
+	{
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<float> color;
+		std::vector<float> position;
+
+		void Resize(const uint32_t pWidth, const uint32_t pHeight)
+		{
+			width = pWidth;
+			height = pHeight;
+			color.assign(static_cast<size_t>(pWidth) * pHeight * 4, 0.0f);
+			position.assign(static_cast<size_t>(pWidth) * pHeight * 4, 0.0f);
+		}
+	};
+
+	struct RayStats
+	{
+		uint64_t primaryRays = 0;
+		uint64_t reflectionRays = 0;
+		uint64_t shadowRays = 0;
+
+		uint64_t Rays() const
+		{
+			return primaryRays + reflectionRays + shadowRays;
+		}
+
+		RayStats & operator+= (const RayStats & pOther)
+		{
+			primaryRays += pOther.primaryRays;
+			reflectionRays += pOther.reflectionRays;
+			shadowRays += pOther.shadowRays;
+			return *this;
+		}
+	};
+
+	struct RayTraceOptions
+	{
+		uint32_t tileSize = 16;			// pixels a side of the squares handed to threads
+		uint32_t threadCount = 0;		// 0 for every hardware thread
+		const RayBvh * bvh = nullptr;	// TraceRays finds hits through it when set, it must be built over the same scene
+		TileScheduler * scheduler = nullptr;	// hands out the tiles instead when set, with its own threads
+	};
+
+	// The eye ray of a pixel as the shader's main makes it, pX and pY from the top left corner with
+	// pixel centres at .5
+	void MakeEyeRay(const RayCamera & pCamera, float pX, float pY, RayVector & pOrigin, RayVector & pDirection);
+
+	// The shader's NearestHit: the distance to the closest primitive, pFarPlane with pHitObject -1
+	// when there is none
+	float NearestRayHit(const RayScene & pScene, const RayVector & pOrigin, const RayVector & pDirection, float pFarPlane, int & pHitObject);
+
+	// The shader's intersection test for the one primitive pObject, numbered as hits are
+	float RayObjectIntersect(const RayScene & pScene, int pObject, const RayVector & pOrigin, const RayVector & pDirection, float pFarPlane, bool & pHit);
+
+	// The ray the shader's Shadow casts from a hit towards the light, and how far the light is
+	void MakeShadowRay(const RayCamera & pCamera, const RayVector & pHitPosition, RayVector & pOrigin, RayVector & pDirection, float & pDistance);
+
+	// 1 when a primitive lies closer along the shadow ray than pDistance, testing every one as the shader does
+	float RayShadow(const RayScene & pScene, const RayVector & pOrigin, const RayVector & pDirection, float pDistance, float pFarPlane);
+
+	// What a hit is shaded with, the quads' checks and border already in the colour
+	struct RaySurface
+	{
+		RayVector normal;
+		float color[4];
+		const RayMaterial * material;
+		float ambient;
+	};
+
+	RaySurface HitSurface(const RayScene & pScene, int pHitObject, const RayVector & pHitPosition);
+
+	// The diffuse and specular light a hit reflects in each of the 4 channels of pPhong, before the
+	// shadow, the light's colour and the ray's intensity
+	void HitPhong(const RayCamera & pCamera, const RayVector & pHitPosition, const RaySurface & pSurface, const RayVector & pViewDirection,
+		float * pPhong);
+
+	// Adds the Phong and ambient light of a hit to pColor, pShadow being RayShadow's answer
+	void ShadeHit(const RayCamera & pCamera, const RayVector & pHitPosition, const RaySurface & pSurface, const RayVector & pViewDirection,
+		float pShadow, float pLightIntensity, float * pColor);
+
+	// Through the view and projection into the 4 floats of the position target
+	void ClipPosition(const RayCamera & pCamera, const RayVector & pHitPosition, float * pPosition);
+
+	// One eye ray through the shader's RayTracing: the colour of up to 4 bounces, each with a shadow
+	// ray, and the clip space position of the first hit. pColor and pPosition take 4 floats each.
+	// With pBvh the hits come from the hierarchy instead of from every primitive, and are the same.
+	RayStats TraceRay(const RayScene & pScene, const RayCamera & pCamera, const RayVector & pOrigin, const RayVector & pDirection,
+		float * pColor, float * pPosition, const RayBvh * pBvh = nullptr);
+
+	// The whole pass, in tiles handed out to the threads one at a time so those full of reflections
+	// even out. Each pixel is traced alone, so the targets are the same for any thread count.
+	RayStats TraceRays(const RayScene & pScene, const RayCamera & pCamera, RayTargets & pTargets, const RayTraceOptions & pOptions = RayTraceOptions());
+}
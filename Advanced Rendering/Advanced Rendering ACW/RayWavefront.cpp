@@ -0,0 +1,516 @@
+#include "RayWavefront.h"
+
+#include <algorithm>
+#include <chrono>
+#include "Parallel.h"
+#include "RayBvh.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr uint32_t KindCount = 3;				// spheres, triangles and quads, shaded apart
+	constexpr uint32_t NoPixel = 0xffffffffu;		// a lane of a block past the edge of the image
+
+	using Clock = std::chrono::high_resolution_clock;
+
+	double Milliseconds(const Clock::time_point pStart)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - pStart).count();
+	}
+
+	//Rays waiting for their closest hit
+	struct RayQueue
+	{
+		std::vector<float> origin[3];
+		std::vector<float> direction[3];
+		std::vector<float> intensity;
+		std::vector<uint32_t> pixel;
+
+		std::vector<float> t;
+		std::vector<int> object;
+
+		void Resize(const size_t pSize)
+		{
+			for (auto c = 0; c < 3; c++)
+			{
+				origin[c].resize(pSize);
+				direction[c].resize(pSize);
+			}
+
+			intensity.resize(pSize);
+			pixel.resize(pSize);
+			t.resize(pSize);
+			object.resize(pSize);
+		}
+
+		RayVector Origin(const size_t pRay) const
+		{
+			return { origin[0][pRay], origin[1][pRay], origin[2][pRay] };
+		}
+
+		RayVector Direction(const size_t pRay) const
+		{
+			return { direction[0][pRay], direction[1][pRay], direction[2][pRay] };
+		}
+
+		void Set(const size_t pRay, const RayVector & pOrigin, const RayVector & pDirection, const float pIntensity, const uint32_t pPixel)
+		{
+			origin[0][pRay] = pOrigin.x;
+			origin[1][pRay] = pOrigin.y;
+			origin[2][pRay] = pOrigin.z;
+			direction[0][pRay] = pDirection.x;
+			direction[1][pRay] = pDirection.y;
+			direction[2][pRay] = pDirection.z;
+			intensity[pRay] = pIntensity;
+			pixel[pRay] = pPixel;
+		}
+	};
+
+	//Hits waiting to be shaded, then to have their light added once their shadow is known
+	struct HitQueue
+	{
+		std::vector<float> position[3];
+		std::vector<float> direction[3];
+		std::vector<float> intensity;
+		std::vector<uint32_t> pixel;
+		std::vector<int> object;
+
+		std::vector<float> phong[4];
+		std::vector<float> ambient[4];
+
+		void Resize(const size_t pSize)
+		{
+			for (auto c = 0; c < 3; c++)
+			{
+				position[c].resize(pSize);
+				direction[c].resize(pSize);
+			}
+
+			for (auto c = 0; c < 4; c++)
+			{
+				phong[c].resize(pSize);
+				ambient[c].resize(pSize);
+			}
+
+			intensity.resize(pSize);
+			pixel.resize(pSize);
+			object.resize(pSize);
+		}
+	};
+
+	//A shadow ray to each hit, by the same number
+	struct ShadowQueue
+	{
+		std::vector<float> origin[3];
+		std::vector<float> direction[3];
+		std::vector<float> distance;
+		std::vector<uint8_t> shadowed;
+
+		void Resize(const size_t pSize)
+		{
+			for (auto c = 0; c < 3; c++)
+			{
+				origin[c].resize(pSize);
+				direction[c].resize(pSize);
+			}
+
+			distance.resize(pSize);
+			shadowed.resize(pSize);
+		}
+	};
+
+	class Wavefront
+	{
+		const RayScene & mScene;
+		const RaySoaScene & mSoaScene;
+		const RayCamera & mCamera;
+		RayTargets & mTargets;
+		const RayWavefrontOptions & mOptions;
+
+		uint32_t mThreadCount;
+		uint32_t mChunkSize;
+		uint32_t mBlocksWide;
+		uint32_t mTriangleStart;
+		uint32_t mQuadStart;
+
+		RayQueue mRays;
+		RayQueue mNextRays;
+		HitQueue mHits;
+		ShadowQueue mShadows;
+
+		std::vector<uint32_t> mKindCounts;		// KindCount to a chunk of the ray queue, then where its hits go
+		uint32_t mHitCount = 0;
+
+		RayWavefrontStats mStats;
+
+		uint32_t Kind(const int pObject) const
+		{
+			const auto object = static_cast<uint32_t>(pObject);
+			return object < mTriangleStart ? 0 : object < mQuadStart ? 1 : 2;
+		}
+
+		uint32_t Chunks(const uint32_t pCount) const
+		{
+			return (pCount + mChunkSize - 1) / mChunkSize;
+		}
+
+		template <class Function>
+		void ForChunks(const uint32_t pCount, Function && pFunction)
+		{
+			ParallelFor(Chunks(pCount), mThreadCount, [&](const uint32_t pChunk)
+			{
+				const auto first = pChunk * mChunkSize;
+				pFunction(pChunk, first, std::min(first + mChunkSize, pCount));
+			});
+		}
+
+		//Blocks [pFirstBlock, pFirstBlock + pBlocks) of 4x2 pixels into the ray queue, and their targets cleared
+		void Generate(const uint32_t pFirstBlock, const uint32_t pBlocks)
+		{
+			const auto count = pBlocks * RayPacketWidth;
+
+			ForChunks(count, [&](uint32_t, const uint32_t pFirst, const uint32_t pEnd)
+			{
+				for (auto ray = pFirst; ray < pEnd; ray++)
+				{
+					const auto block = pFirstBlock + ray / RayPacketWidth;
+					const auto lane = ray % RayPacketWidth;
+					const auto x = block % mBlocksWide * 4 + lane % 4;
+					const auto y = block / mBlocksWide * 2 + lane / 4;
+
+					if (x >= mCamera.width || y >= mCamera.height)
+					{
+						mRays.Set(ray, {}, { 0.0f, 0.0f, 1.0f }, 0.0f, NoPixel);
+						continue;
+					}
+
+					const auto pixel = y * mCamera.width + x;
+					RayVector origin, direction;
+
+					MakeEyeRay(mCamera, x + 0.5f, y + 0.5f, origin, direction);
+					mRays.Set(ray, origin, direction, 1.0f, pixel);
+
+					std::fill(&mTargets.color[pixel * 4], &mTargets.color[pixel * 4] + 4, 0.0f);
+					std::fill(&mTargets.position[pixel * 4], &mTargets.position[pixel * 4] + 4, 0.0f);
+				}
+			});
+		}
+
+		//The closest hit of each of the first pCount queued rays, and how many of each chunk's hit each kind
+		void Extend(const uint32_t pCount)
+		{
+			mKindCounts.assign(static_cast<size_t>(Chunks(pCount)) * KindCount, 0);
+
+			ForChunks(pCount, [&](const uint32_t pChunk, const uint32_t pFirst, const uint32_t pEnd)
+			{
+				if (mOptions.bvh)
+				{
+					for (auto ray = pFirst; ray < pEnd; ray++)
+					{
+						if (mRays.pixel[ray] == NoPixel)
+						{
+							mRays.object[ray] = -1;
+							continue;
+						}
+
+						mRays.t[ray] = mOptions.bvh->NearestHit(mRays.Origin(ray), mRays.Direction(ray), mCamera.farPlane, mRays.object[ray]);
+					}
+				}
+				else
+				{
+					for (auto first = pFirst; first < pEnd; first += RayPacketWidth)
+					{
+						RayPacket packet;
+						uint32_t mask = 0;
+
+						for (uint32_t lane = 0; lane < RayPacketWidth; lane++)
+						{
+							const auto ray = std::min(first + lane, pEnd - 1);
+
+							for (auto c = 0; c < 3; c++)
+							{
+								packet.origin[c][lane] = mRays.origin[c][ray];
+								packet.direction[c][lane] = mRays.direction[c][ray];
+							}
+
+							mask |= first + lane < pEnd && mRays.pixel[ray] != NoPixel ? 1u << lane : 0u;
+						}
+
+						float t[RayPacketWidth] = {};
+						int object[RayPacketWidth];
+						std::fill(object, object + RayPacketWidth, -1);
+
+						NearestHitPacket(mSoaScene, packet, mask, mCamera.farPlane, t, object);
+
+						for (auto ray = first; ray < std::min(first + RayPacketWidth, pEnd); ray++)
+						{
+							mRays.t[ray] = t[ray - first];
+							mRays.object[ray] = object[ray - first];
+						}
+					}
+				}
+
+				for (auto ray = pFirst; ray < pEnd; ray++)
+				{
+					if (mRays.object[ray] >= 0)
+					{
+						mKindCounts[pChunk * KindCount + Kind(mRays.object[ray])]++;
+					}
+				}
+			});
+
+			if (!mOptions.bvh)
+			{
+				mStats.packets += (pCount + RayPacketWidth - 1) / RayPacketWidth;
+			}
+		}
+
+		//The hits moved out of the ray queue grouped by kind, each chunk's in queue order after those of
+		//the chunks before, so the order is the same for any thread count
+		void Compact(const uint32_t pCount)
+		{
+			const auto chunks = Chunks(pCount);
+			uint32_t next = 0;
+
+			for (uint32_t kind = 0; kind < KindCount; kind++)
+			{
+				for (uint32_t chunk = 0; chunk < chunks; chunk++)
+				{
+					const auto count = mKindCounts[chunk * KindCount + kind];
+					mKindCounts[chunk * KindCount + kind] = next;
+					next += count;
+				}
+			}
+
+			mHitCount = next;
+
+			ForChunks(pCount, [&](const uint32_t pChunk, const uint32_t pFirst, const uint32_t pEnd)
+			{
+				uint32_t * offsets = &mKindCounts[pChunk * KindCount];
+
+				for (auto ray = pFirst; ray < pEnd; ray++)
+				{
+					if (mRays.object[ray] < 0)
+					{
+						continue;
+					}
+
+					const auto hit = offsets[Kind(mRays.object[ray])]++;
+					const auto position = mRays.Origin(ray) + mRays.Direction(ray) * mRays.t[ray];
+
+					mHits.position[0][hit] = position.x;
+					mHits.position[1][hit] = position.y;
+					mHits.position[2][hit] = position.z;
+
+					for (auto c = 0; c < 3; c++)
+					{
+						mHits.direction[c][hit] = mRays.direction[c][ray];
+					}
+
+					mHits.intensity[hit] = mRays.intensity[ray];
+					mHits.pixel[hit] = mRays.pixel[ray];
+					mHits.object[hit] = mRays.object[ray];
+				}
+			});
+		}
+
+		//Each hit's surface and unshadowed light, its shadow ray and, but for the last bounce, its reflection
+		void Shade(const int pDepth)
+		{
+			ForChunks(mHitCount, [&](uint32_t, const uint32_t pFirst, const uint32_t pEnd)
+			{
+				for (auto hit = pFirst; hit < pEnd; hit++)
+				{
+					const RayVector position = { mHits.position[0][hit], mHits.position[1][hit], mHits.position[2][hit] };
+					const RayVector direction = { mHits.direction[0][hit], mHits.direction[1][hit], mHits.direction[2][hit] };
+					const auto pixel = mHits.pixel[hit];
+					const auto surface = HitSurface(mScene, mHits.object[hit], position);
+
+					if (pDepth == 1)
+					{
+						ClipPosition(mCamera, position, &mTargets.position[static_cast<size_t>(pixel) * 4]);
+					}
+
+					float phong[4];
+					HitPhong(mCamera, position, surface, direction, phong);
+
+					for (auto c = 0; c < 4; c++)
+					{
+						mHits.phong[c][hit] = phong[c];
+						mHits.ambient[c][hit] = surface.color[c] * surface.ambient;
+					}
+
+					RayVector shadowOrigin, shadowDirection;
+					MakeShadowRay(mCamera, position, shadowOrigin, shadowDirection, mShadows.distance[hit]);
+
+					mShadows.origin[0][hit] = shadowOrigin.x;
+					mShadows.origin[1][hit] = shadowOrigin.y;
+					mShadows.origin[2][hit] = shadowOrigin.z;
+					mShadows.direction[0][hit] = shadowDirection.x;
+					mShadows.direction[1][hit] = shadowDirection.y;
+					mShadows.direction[2][hit] = shadowDirection.z;
+
+					//The shader traces a fifth ray after the last bounce and never uses it
+					if (pDepth < 4)
+					{
+						mNextRays.Set(hit, position, direction.Reflect(surface.normal), mHits.intensity[hit] * surface.material->kr, pixel);
+					}
+				}
+			});
+		}
+
+		void Shadow()
+		{
+			ForChunks(mHitCount, [&](uint32_t, const uint32_t pFirst, const uint32_t pEnd)
+			{
+				if (mOptions.bvh)
+				{
+					for (auto hit = pFirst; hit < pEnd; hit++)
+					{
+						const RayVector origin = { mShadows.origin[0][hit], mShadows.origin[1][hit], mShadows.origin[2][hit] };
+						const RayVector direction = { mShadows.direction[0][hit], mShadows.direction[1][hit], mShadows.direction[2][hit] };
+
+						mShadows.shadowed[hit] = mOptions.bvh->Occluded(origin, direction, 0.0f, mShadows.distance[hit]) ? 1 : 0;
+					}
+
+					return;
+				}
+
+				for (auto first = pFirst; first < pEnd; first += ShadowPacketWidth)
+				{
+					ShadowPacket packet;
+					uint32_t mask = 0;
+
+					for (uint32_t lane = 0; lane < ShadowPacketWidth; lane++)
+					{
+						const auto hit = std::min(first + lane, pEnd - 1);
+
+						for (auto c = 0; c < 3; c++)
+						{
+							packet.origin[c][lane] = mShadows.origin[c][hit];
+							packet.direction[c][lane] = mShadows.direction[c][hit];
+						}
+
+						packet.distance[lane] = mShadows.distance[hit];
+						mask |= first + lane < pEnd ? 1u << lane : 0u;
+					}
+
+					const auto shadowed = ShadowPacketMask(mSoaScene, packet, mask, mCamera.farPlane);
+
+					for (auto hit = first; hit < std::min(first + ShadowPacketWidth, pEnd); hit++)
+					{
+						mShadows.shadowed[hit] = shadowed >> (hit - first) & 1;
+					}
+				}
+			});
+		}
+
+		//ShadeHit's sum, each pixel having at most one hit a bounce
+		void Accumulate()
+		{
+			ForChunks(mHitCount, [&](uint32_t, const uint32_t pFirst, const uint32_t pEnd)
+			{
+				for (auto hit = pFirst; hit < pEnd; hit++)
+				{
+					auto color = &mTargets.color[static_cast<size_t>(mHits.pixel[hit]) * 4];
+					const auto lit = 1.0f - (mShadows.shadowed[hit] ? 1.0f : 0.0f);
+
+					for (auto c = 0; c < 4; c++)
+					{
+						color[c] += mCamera.lightColor[c] * mHits.intensity[hit] * (lit * mHits.phong[c][hit] + mHits.ambient[c][hit]);
+					}
+				}
+			});
+		}
+
+	public:
+		Wavefront(const RayScene & pScene, const RaySoaScene & pSoaScene, const RayCamera & pCamera, RayTargets & pTargets,
+			const RayWavefrontOptions & pOptions) :
+			mScene(pScene), mSoaScene(pSoaScene), mCamera(pCamera), mTargets(pTargets), mOptions(pOptions),
+			mThreadCount(pOptions.threadCount != 0 ? pOptions.threadCount : WorkerCount()),
+			mChunkSize((std::max(pOptions.chunkSize, 1u) + RayPacketWidth - 1) / RayPacketWidth * RayPacketWidth),
+			mBlocksWide((pCamera.width + 3) / 4),
+			mTriangleStart(static_cast<uint32_t>(pScene.spheres.size())),
+			mQuadStart(static_cast<uint32_t>(pScene.spheres.size() + pScene.triangles.size()))
+		{
+		}
+
+		~Wavefront() = default;
+
+		Wavefront(const Wavefront &) = delete;
+		Wavefront(Wavefront &&) = delete;
+		Wavefront & operator= (const Wavefront &) = delete;
+		Wavefront & operator= (Wavefront &&) = delete;
+
+		RayWavefrontStats Run()
+		{
+			const auto blocks = mBlocksWide * ((mCamera.height + 1) / 2);
+			const auto waveBlocks = std::max(mOptions.waveSize / RayPacketWidth, 1u);
+			const auto queueSize = static_cast<size_t>(std::min(blocks, waveBlocks)) * RayPacketWidth;
+
+			mRays.Resize(queueSize);
+			mNextRays.Resize(queueSize);
+			mHits.Resize(queueSize);
+			mShadows.Resize(queueSize);
+
+			for (uint32_t firstBlock = 0; firstBlock < blocks; firstBlock += waveBlocks)
+			{
+				const auto waveBlockCount = std::min(waveBlocks, blocks - firstBlock);
+
+				auto start = Clock::now();
+				Generate(firstBlock, waveBlockCount);
+				mStats.generateMilliseconds += Milliseconds(start);
+
+				auto count = waveBlockCount * RayPacketWidth;
+
+				for (auto depth = 1; depth < 5 && count != 0; depth++)
+				{
+					start = Clock::now();
+					Extend(count);
+					mStats.extendMilliseconds += Milliseconds(start);
+
+					start = Clock::now();
+					Compact(count);
+					Shade(depth);
+					mStats.shadeMilliseconds += Milliseconds(start);
+
+					start = Clock::now();
+					Shadow();
+					mStats.shadowMilliseconds += Milliseconds(start);
+
+					start = Clock::now();
+					Accumulate();
+					mStats.accumulateMilliseconds += Milliseconds(start);
+
+					mStats.rays.shadowRays += mHitCount;
+
+					if (depth < 4)
+					{
+						mStats.rays.reflectionRays += mHitCount;
+					}
+
+					count = mHitCount;
+					std::swap(mRays, mNextRays);
+				}
+
+				mStats.waves++;
+			}
+
+			mStats.rays.primaryRays = static_cast<uint64_t>(mCamera.width) * mCamera.height;
+
+			return mStats;
+		}
+	};
+}
+
+RayWavefrontStats Advanced_Rendering::TraceRaysWavefront(const RayScene & pScene, const RaySoaScene & pSoaScene, const RayCamera & pCamera,
+	RayTargets & pTargets, const RayWavefrontOptions & pOptions)
+{
+	if (pTargets.width != pCamera.width || pTargets.height != pCamera.height)
+	{
+		pTargets.Resize(pCamera.width, pCamera.height);
+	}
+
+	return Wavefront(pScene, pSoaScene, pCamera, pTargets, pOptions).Run();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include "RayPacket.h"
+#include "RayTracer.h"
+
+namespace Advanced_Rendering
+{
+	struct RayWavefrontOptions
+	{
+		uint32_t waveSize = 16384;		// eye rays in flight, each stage going over all of them before the next starts
+		uint32_t chunkSize = 1024;		// queue entries handed to a thread at a time, rounded up to a whole packet
+		uint32_t threadCount = 0;		// 0 for every hardware thread
+		const RayBvh * bvh = nullptr;	// extends and shadows through it when set, it must be built over the same scene
+	};
+
+	struct RayWavefrontStats
+	{
+		RayStats rays;
+		uint32_t waves = 0;
+		uint64_t packets = 0;			// extend packets traced, each of RayPacketWidth lanes, when there is no BVH
+
+		//Summed over the waves
+		double generateMilliseconds = 0.0;
+		double extendMilliseconds = 0.0;
+		double shadeMilliseconds = 0.0;
+		double shadowMilliseconds = 0.0;
+		double accumulateMilliseconds = 0.0;
+	};
+
+	// TraceRays as a wavefront: rather than each thread taking a ray through every bounce, a wave of
+	// eye rays goes through one stage at a time with a queue of structures of arrays between each.
+	//   generate:   the eye rays, in TraceRayPackets' 4x2 blocks
+	//   extend:     the closest hit of every queued ray, 8 at a time through the packet kernel
+	//   shade:      the hits compacted out of the rays, misses dropped, and grouped by the kind of
+	//               primitive, so spheres, triangles and checked quads are each shaded together,
+	//               making the shadow rays and the reflected rays the next extend takes
+	//   shadow:     the shadow rays, 4 at a time through the packet kernel
+	//   accumulate: each hit's light added to its pixel, lit or not
+	// Extend to accumulate repeat for each of the 4 bounces, so the packets stay full however many
+	// rays have stopped. Every stage splits its queue into chunks across the threads. The targets
+	// match TraceRays bit for bit.
+	RayWavefrontStats TraceRaysWavefront(const RayScene & pScene, const RaySoaScene & pSoaScene, const RayCamera & pCamera, RayTargets & pTargets,
+		const RayWavefrontOptions & pOptions = RayWavefrontOptions());
+}
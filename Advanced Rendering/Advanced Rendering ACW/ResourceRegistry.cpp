@@ -0,0 +1,337 @@
+#include "ResourceRegistry.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <sstream>
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	const char * KindName(const ResourceKind pKind)
+	{
+		switch (pKind)
+		{
+		case ResourceKind::Texture:
+			return "texture";
+		case ResourceKind::RenderTarget:
+			return "render target";
+		case ResourceKind::DepthStencil:
+			return "depth stencil";
+		case ResourceKind::SwapChain:
+			return "swap chain";
+		case ResourceKind::ConstantBuffer:
+			return "constant buffer";
+		case ResourceKind::VertexBuffer:
+			return "vertex buffer";
+		case ResourceKind::IndexBuffer:
+			return "index buffer";
+		case ResourceKind::StructuredBuffer:
+			return "structured buffer";
+		default:
+			return "mesh data";
+		}
+	}
+
+	std::string Megabytes(const uint64_t pBytes)
+	{
+		char text[32];
+		snprintf(text, sizeof text, "%.1f MB", pBytes / 1048576.0);
+		return text;
+	}
+
+	// Owners and names are file names and type names, which only need quotes, backslashes and
+	// control characters escaped
+	std::string Quote(const std::string & pText)
+	{
+		std::string quoted = "\"";
+
+		for (const auto c : pText)
+		{
+			if (c == '"' || c == '\\')
+			{
+				quoted += '\\';
+				quoted += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char escape[8];
+				snprintf(escape, sizeof escape, "\\u%04x", c);
+				quoted += escape;
+			}
+			else
+			{
+				quoted += c;
+			}
+		}
+
+		return quoted + '"';
+	}
+
+	int HeapIndex(const ResourceHeap pHeap)
+	{
+		return pHeap == ResourceHeap::Gpu ? 0 : 1;
+	}
+}
+
+uint64_t Advanced_Rendering::TextureBytes(const DdsFormat pFormat, const uint32_t pWidth, const uint32_t pHeight, const uint32_t pDepth,
+	const uint32_t pMipCount, const uint32_t pArraySize)
+{
+	uint64_t total = 0;
+
+	for (uint32_t mip = 0; mip < std::max(pMipCount, 1u); mip++)
+	{
+		size_t bytes, rowBytes, rows;
+		GetDdsSurfaceInfo(std::max(pWidth >> mip, 1u), std::max(pHeight >> mip, 1u), pFormat, bytes, rowBytes, rows);
+
+		total += static_cast<uint64_t>(bytes) * std::max(pDepth >> mip, 1u);
+	}
+
+	return total * std::max(pArraySize, 1u);
+}
+
+ResourceHandle::~ResourceHandle()
+{
+	Reset();
+}
+
+ResourceHandle::ResourceHandle(ResourceHandle && pHandle) noexcept : mRegistry(std::move(pHandle.mRegistry)), mId(pHandle.mId)
+{
+	pHandle.mId = 0;
+}
+
+ResourceHandle & ResourceHandle::operator= (ResourceHandle && pHandle) noexcept
+{
+	if (this != &pHandle)
+	{
+		Reset();
+
+		mRegistry = std::move(pHandle.mRegistry);
+		mId = pHandle.mId;
+		pHandle.mId = 0;
+	}
+
+	return *this;
+}
+
+void ResourceHandle::Reset()
+{
+	if (mRegistry)
+	{
+		mRegistry->Release(mId);
+		mRegistry.reset();
+	}
+
+	mId = 0;
+}
+
+ResourceHandle ResourceRegistry::Track(const ResourceDesc & pDesc)
+{
+	ResourceHandle handle;
+	std::function<void(const std::string &)> warning;
+	std::string message;
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		const auto heap = HeapIndex(pDesc.heap);
+
+		handle.mId = mNextId++;
+		mResources.emplace(handle.mId, pDesc);
+
+		mCurrent[heap] += pDesc.bytes;
+		mPeak[heap] = std::max(mPeak[heap], mCurrent[heap]);
+		mFramePeak[heap] = std::max(mFramePeak[heap], mCurrent[heap]);
+
+		if (pDesc.heap == ResourceHeap::Gpu && mBudget != 0 && mCurrent[0] > mBudget && !mOverBudget)
+		{
+			mOverBudget = true;
+			warning = mWarning;
+			message = OverBudgetMessage(pDesc);
+		}
+	}
+
+	handle.mRegistry = shared_from_this();
+
+	//Outside the lock, so the warning can read the registry
+	if (warning)
+	{
+		warning(message);
+	}
+
+	return handle;
+}
+
+void ResourceRegistry::Release(const uint32_t pId)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	const auto resource = mResources.find(pId);
+
+	if (resource == mResources.end())
+	{
+		return;
+	}
+
+	mCurrent[HeapIndex(resource->second.heap)] -= resource->second.bytes;
+	mResources.erase(resource);
+
+	if (mOverBudget && mCurrent[0] <= mBudget)
+	{
+		mOverBudget = false;
+	}
+}
+
+std::string ResourceRegistry::OverBudgetMessage(const ResourceDesc & pCause) const
+{
+	std::map<std::string, uint64_t> owners;
+
+	for (const auto & resource : mResources)
+	{
+		if (resource.second.heap == ResourceHeap::Gpu)
+		{
+			owners[resource.second.owner] += resource.second.bytes;
+		}
+	}
+
+	std::vector<std::pair<std::string, uint64_t>> largest(owners.begin(), owners.end());
+	std::sort(largest.begin(), largest.end(), [](const std::pair<std::string, uint64_t> & pA, const std::pair<std::string, uint64_t> & pB)
+	{
+		return pA.second > pB.second;
+	});
+
+	std::string message = "GPU memory " + Megabytes(mCurrent[0]) + " is over the " + Megabytes(mBudget) + " budget after " +
+		pCause.owner + " " + pCause.name + " (" + std::to_string(pCause.width) + "x" + std::to_string(pCause.height) + ", " + Megabytes(pCause.bytes) + "). Largest:";
+
+	for (size_t i = 0; i < std::min<size_t>(largest.size(), 3); i++)
+	{
+		message += (i ? ", " : " ") + largest[i].first + " " + Megabytes(largest[i].second);
+	}
+
+	return message + "\n";
+}
+
+void ResourceRegistry::SetBudget(const uint64_t pGpuBytes, std::function<void(const std::string &)> pWarning)
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	mBudget = pGpuBytes;
+	mWarning = std::move(pWarning);
+	mOverBudget = false;
+}
+
+void ResourceRegistry::EndFrame()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	FrameMemory frame;
+	frame.frame = mFrame++;
+	frame.gpuPeak = mFramePeak[0];
+	frame.gpuEnd = mCurrent[0];
+	frame.cpuPeak = mFramePeak[1];
+	frame.cpuEnd = mCurrent[1];
+
+	if (mFrames.size() < FrameHistory)
+	{
+		mFrames.push_back(frame);
+	}
+	else
+	{
+		mFrames[mNextFrame] = frame;
+	}
+
+	mNextFrame = (mNextFrame + 1) % FrameHistory;
+	mFramePeak[0] = mCurrent[0];
+	mFramePeak[1] = mCurrent[1];
+}
+
+uint64_t ResourceRegistry::CurrentBytes(const ResourceHeap pHeap) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mCurrent[HeapIndex(pHeap)];
+}
+
+uint64_t ResourceRegistry::PeakBytes(const ResourceHeap pHeap) const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	return mPeak[HeapIndex(pHeap)];
+}
+
+std::vector<FrameMemory> ResourceRegistry::Frames() const
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	if (mFrames.size() < FrameHistory)
+	{
+		return mFrames;
+	}
+
+	std::vector<FrameMemory> frames(mFrames.begin() + mNextFrame, mFrames.end());
+	frames.insert(frames.end(), mFrames.begin(), mFrames.begin() + mNextFrame);
+
+	return frames;
+}
+
+std::string ResourceRegistry::ExportJson() const
+{
+	const auto frames = Frames();
+
+	std::lock_guard<std::mutex> lock(mMutex);
+
+	std::vector<const ResourceDesc *> resources;
+	std::map<std::string, std::pair<uint64_t, uint32_t>> owners;
+
+	for (const auto & resource : mResources)
+	{
+		resources.push_back(&resource.second);
+
+		auto & owner = owners[resource.second.owner];
+		owner.first += resource.second.bytes;
+		owner.second++;
+	}
+
+	std::sort(resources.begin(), resources.end(), [](const ResourceDesc * pA, const ResourceDesc * pB)
+	{
+		return pA->bytes != pB->bytes ? pA->bytes > pB->bytes : pA->owner != pB->owner ? pA->owner < pB->owner : pA->name < pB->name;
+	});
+
+	std::ostringstream json;
+
+	json << "{\n  \"budgetBytes\": " << mBudget << ",\n";
+	json << "  \"gpu\": { \"currentBytes\": " << mCurrent[0] << ", \"peakBytes\": " << mPeak[0] << " },\n";
+	json << "  \"cpu\": { \"currentBytes\": " << mCurrent[1] << ", \"peakBytes\": " << mPeak[1] << " },\n";
+	json << "  \"frames\": [";
+
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		json << (i ? ",\n" : "\n") << "    { \"frame\": " << frames[i].frame << ", \"gpuPeak\": " << frames[i].gpuPeak << ", \"gpuEnd\": " << frames[i].gpuEnd <<
+			", \"cpuPeak\": " << frames[i].cpuPeak << ", \"cpuEnd\": " << frames[i].cpuEnd << " }";
+	}
+
+	json << (frames.empty() ? "],\n" : "\n  ],\n") << "  \"owners\": [";
+
+	auto first = true;
+
+	for (const auto & owner : owners)
+	{
+		json << (first ? "\n" : ",\n") << "    { \"owner\": " << Quote(owner.first) << ", \"bytes\": " << owner.second.first << ", \"count\": " << owner.second.second << " }";
+		first = false;
+	}
+
+	json << (owners.empty() ? "],\n" : "\n  ],\n") << "  \"resources\": [";
+
+	for (size_t i = 0; i < resources.size(); i++)
+	{
+		const auto & resource = *resources[i];
+
+		json << (i ? ",\n" : "\n") << "    { \"kind\": " << Quote(KindName(resource.kind)) << ", \"heap\": " << (resource.heap == ResourceHeap::Gpu ? "\"gpu\"" : "\"cpu\"") <<
+			", \"owner\": " << Quote(resource.owner) << ", \"name\": " << Quote(resource.name) << ", \"format\": " << static_cast<uint32_t>(resource.format) <<
+			", \"width\": " << resource.width << ", \"height\": " << resource.height << ", \"depth\": " << resource.depth <<
+			", \"mips\": " << resource.mipCount << ", \"arraySize\": " << resource.arraySize << ", \"bytes\": " << resource.bytes << " }";
+	}
+
+	json << (resources.empty() ? "]\n" : "\n  ]\n") << "}\n";
+
+	return json.str();
+}
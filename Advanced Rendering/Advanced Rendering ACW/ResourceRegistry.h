@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DdsParser.h"
+
+namespace Advanced_Rendering
+{
+	enum class ResourceKind
+	{
+		Texture,
+		RenderTarget,
+		DepthStencil,
+		SwapChain,
+		ConstantBuffer,
+		VertexBuffer,
+		IndexBuffer,
+		StructuredBuffer,
+		MeshData			// vertices and indices kept in system memory for uploads
+	};
+
+	enum class ResourceHeap
+	{
+		Gpu,
+		Cpu
+	};
+
+	// What a resource is and who made it. Formats are DXGI_FORMAT by value, as with DdsFormat.
+	struct ResourceDesc
+	{
+		ResourceKind kind = ResourceKind::Texture;
+		ResourceHeap heap = ResourceHeap::Gpu;
+		std::string owner;
+		std::string name;
+		DdsFormat format = DdsFormat::Unknown;
+		uint32_t width = 0;
+		uint32_t height = 1;
+		uint32_t depth = 1;
+		uint32_t mipCount = 1;
+		uint32_t arraySize = 1;
+		uint64_t bytes = 0;
+	};
+
+	// Memory in use at the end of a frame and the most it reached during it
+	struct FrameMemory
+	{
+		uint64_t frame = 0;
+		uint64_t gpuPeak = 0;
+		uint64_t gpuEnd = 0;
+		uint64_t cpuPeak = 0;
+		uint64_t cpuEnd = 0;
+	};
+
+	// Bytes of every mip of every item of a texture, as the surfaces of a DDS file of the same shape
+	uint64_t TextureBytes(DdsFormat pFormat, uint32_t pWidth, uint32_t pHeight, uint32_t pDepth, uint32_t pMipCount, uint32_t pArraySize);
+
+	class ResourceRegistry;
+
+	// Keeps a resource on the registry's books until it is reset, reassigned or destroyed. Owners
+	// hold one beside each buffer or texture and reset it when they release the resource.
+	class ResourceHandle
+	{
+		std::shared_ptr<ResourceRegistry> mRegistry;
+		uint32_t mId = 0;
+
+		friend class ResourceRegistry;
+
+	public:
+		ResourceHandle() = default;
+		~ResourceHandle();
+
+		ResourceHandle(const ResourceHandle &) = delete;
+		ResourceHandle(ResourceHandle && pHandle) noexcept;
+		ResourceHandle & operator= (const ResourceHandle &) = delete;
+		ResourceHandle & operator= (ResourceHandle && pHandle) noexcept;
+
+		void Reset();
+	};
+
+	// Every render resource with its size, format and owner, and the memory they add up to now, at
+	// their peak and over the last frames. Resources may be tracked and released from any thread.
+	// With a budget set, crossing it calls the warning with the resource that did it and the largest
+	// owners, once until usage drops back under.
+	class ResourceRegistry : public std::enable_shared_from_this<ResourceRegistry>
+	{
+		mutable std::mutex mMutex;
+		std::unordered_map<uint32_t, ResourceDesc> mResources;
+		uint32_t mNextId = 1;
+
+		uint64_t mCurrent[2] = {};
+		uint64_t mPeak[2] = {};
+		uint64_t mFramePeak[2] = {};
+		uint64_t mFrame = 0;
+		std::vector<FrameMemory> mFrames;			// ring of the last FrameHistory frames
+		size_t mNextFrame = 0;
+
+		uint64_t mBudget = 0;
+		bool mOverBudget = false;
+		std::function<void(const std::string &)> mWarning;
+
+		friend class ResourceHandle;
+
+		void Release(uint32_t pId);
+		std::string OverBudgetMessage(const ResourceDesc & pCause) const;
+
+	public:
+		static constexpr size_t FrameHistory = 240;
+
+		ResourceRegistry() = default;
+		~ResourceRegistry() = default;
+
+		ResourceRegistry(const ResourceRegistry &) = delete;
+		ResourceRegistry(ResourceRegistry &&) = delete;
+		ResourceRegistry & operator= (const ResourceRegistry &) = delete;
+		ResourceRegistry & operator= (ResourceRegistry &&) = delete;
+
+		// The registry must be owned by a shared_ptr
+		ResourceHandle Track(const ResourceDesc & pDesc);
+
+		// A GPU budget of 0 turns the check off. The warning is called on the thread that tracked
+		// the resource taking usage over.
+		void SetBudget(uint64_t pGpuBytes, std::function<void(const std::string &)> pWarning);
+
+		// Closes the frame's peak and starts the next one
+		void EndFrame();
+
+		uint64_t CurrentBytes(ResourceHeap pHeap) const;
+		uint64_t PeakBytes(ResourceHeap pHeap) const;
+
+		// Frames oldest first
+		std::vector<FrameMemory> Frames() const;
+
+		// Totals, the per frame history, each owner's share and every resource largest first
+		std::string ExportJson() const;
+	};
+}
@@ -29,9 +29,10 @@ PS_OUTPUT main(DS_OUTPUT input)
 {
     PS_OUTPUT output = (PS_OUTPUT) 0;
     
-    float3 norm = normalTexture.Sample(Sampler, input.TexCoord).xyz;
+    //The normal map is cooked to BC5, which keeps x and y, so z is rebuilt facing out of the surface
+    float2 normXY = 2.0f * normalTexture.Sample(Sampler, input.TexCoord).xy - 1.0f;
     
-    norm = 2.0f * norm - 1.0f;
+    float3 norm = float3(normXY, sqrt(saturate(1.0f - dot(normXY, normXY))));
     
     float3 normal = normalize(mul(norm, input.TBN));
     float3 viewDirection = normalize(input.ViewPosition - input.FragmentPos.xyz);
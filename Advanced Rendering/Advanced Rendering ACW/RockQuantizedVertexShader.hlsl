@@ -0,0 +1,48 @@
+//Based on example in Frank Luna's Introduction to 3D Game Programming with DirectX11
+//Decodes the quantised streams from VertexQuantizer, the hull and domain shaders are unchanged
+
+cbuffer QuantizationConstantBuffer : register(b3)
+{
+    float4 positionOffset;
+    float4 positionScale;
+};
+
+struct VS_INPUT
+{
+    float4 Pos : POSITION;
+    float2 Normal : NORMAL;
+    float2 TexCoord : TEXCOORD;
+    float2 Tangent : TANGENT;
+    float2 BiTangent : BITANGENT;
+};
+
+struct VS_OUTPUT
+{
+    float3 Pos : POSITION0;
+    float3 Normal : NORMAL0;
+    float2 TexCoord : TEXCOORD0;
+    float3 Tangent : TANGENT0;
+    float3 BiTangent : BITANGENT0;
+};
+
+float3 OctDecode(float2 oct)
+{
+    float3 direction = float3(oct, 1.0f - abs(oct.x) - abs(oct.y));
+    float t = saturate(-direction.z);
+    
+    direction.xy += (direction.xy >= 0.0f) ? -t : t;
+    
+    return normalize(direction);
+}
+
+VS_OUTPUT main(VS_INPUT input)
+{
+    VS_OUTPUT output = (VS_OUTPUT) 0;
+    output.Pos = positionOffset.xyz + input.Pos.xyz * positionScale.xyz;
+    output.Normal = OctDecode(input.Normal);
+    output.TexCoord = input.TexCoord;
+    output.Tangent = OctDecode(input.Tangent);
+    output.BiTangent = OctDecode(input.BiTangent);
+
+    return output;
+}
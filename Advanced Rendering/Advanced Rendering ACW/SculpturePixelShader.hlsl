@@ -1,5 +1,4 @@
-Texture2D colorTexture : register(t0);
-SamplerState Sampler : register(s0);
+#include "PackSampling.hlsli"
 
 cbuffer ModelViewProjectionConstantBuffer : register(b0)
 {
@@ -43,7 +42,7 @@ PixelShaderOutput main(VertexShaderOutput input)
 
     float3 lightDir = normalize(lightPos.xyz - pos);
 
-    float4 color = colorTexture.Sample(Sampler, input.uv);
+    float4 color = SamplePack(input.uv);
 
     float4 diffuseColor = color;
     float4 specularColor = color;
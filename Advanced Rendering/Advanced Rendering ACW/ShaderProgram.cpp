@@ -1,5 +1,8 @@
 #include "pch.h"
 #include "ShaderProgram.h"
+#include <codecvt>
+
+using namespace Advanced_Rendering;
 
 ShaderProgram::ShaderProgram(const std::wstring & pFilename) : mFilename(pFilename)
 {
@@ -7,4 +10,34 @@ ShaderProgram::ShaderProgram(const std::wstring & pFilename) : mFilename(pFilena
 
 ShaderProgram::~ShaderProgram()
 {
+}
+
+void ShaderProgram::Load(std::shared_ptr<DX::DeviceResources> pDeviceResources)
+{
+	const auto file = ReadAssetFile(std::wstring_convert<std::codecvt_utf8<wchar_t>>().to_bytes(mFilename));
+
+	Create(pDeviceResources, file->Data(), file->Size());
+}
+
+JobHandle ShaderProgram::Load(AssetLoader & pLoader, std::shared_ptr<DX::DeviceResources> pDeviceResources)
+{
+	auto file = std::make_shared<std::shared_ptr<MappedFile>>();
+	const auto filename = std::wstring_convert<std::codecvt_utf8<wchar_t>>().to_bytes(mFilename);
+
+	const auto read = pLoader.Add(JobQueue::Worker, [file, filename]()
+	{
+		*file = ReadAssetFile(filename);
+	});
+
+	return pLoader.Add(JobQueue::Worker, [this, file, pDeviceResources]()
+	{
+		//The read job failed and has reported it
+		if (!*file)
+		{
+			return;
+		}
+
+		Create(pDeviceResources, (*file)->Data(), (*file)->Size());
+		file->reset();
+	}, { read });
 }
\ No newline at end of file
@@ -2,17 +2,26 @@
 
 #include "..\Common\DirectXHelper.h"
 #include "..\Common\DeviceResources.h"
+#include "AssetLoader.h"
 
 class ShaderProgram
 {
 protected:
 	std::wstring mFilename;
 
+	// Creates the shader from compiled bytecode, from any thread
+	virtual void Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const uint8_t * pData, size_t pSize) = 0;
+
 public:
 	ShaderProgram(const std::wstring & pFilename);
 	virtual ~ShaderProgram();
 
-	virtual void Load(std::shared_ptr<DX::DeviceResources> pDeviceResources) = 0;
+	// Reads the .cso and creates the shader before returning
+	void Load(std::shared_ptr<DX::DeviceResources> pDeviceResources);
+
+	// Adds a read job and a create job that depends on it, returns the create job
+	Advanced_Rendering::JobHandle Load(Advanced_Rendering::AssetLoader & pLoader, std::shared_ptr<DX::DeviceResources> pDeviceResources);
+
 	virtual void Reset() = 0;
 	virtual void UseProgram(std::shared_ptr<DX::DeviceResources> pDeviceResources) = 0;
 	virtual void ReleaseProgram(std::shared_ptr<DX::DeviceResources> pDeviceResources) = 0;
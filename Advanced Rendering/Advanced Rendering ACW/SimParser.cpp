@@ -0,0 +1,375 @@
+#include "SimParser.h"
+
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include "MappedFile.h"
+#include "Parallel.h"
+#include "TextScan.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr uint32_t MaxChunks = 64;
+	constexpr size_t MinChunkBytes = 16 * 1024;
+	constexpr uint32_t MaxFields = 14;
+
+	struct Chunk
+	{
+		const char * begin;
+		const char * end;
+		uint64_t firstToken;
+		uint64_t tokenCount;
+	};
+
+	// Where each value after the header count goes. The first vertexTokens values are vertex fields,
+	// field c of vertex v is written to fields[c][v * strides[c]]. If hasIndices is set they are
+	// followed by the index count and the indices, each of which must be below vertexCount.
+	struct TokenLayout
+	{
+		uint32_t vertexCount = 0;
+		uint64_t vertexTokens = 0;
+		uint32_t fieldCount = 0;
+		float * fields[MaxFields] = {};
+		uint32_t strides[MaxFields] = {};
+		bool hasIndices = false;
+		uint32_t indexCount = 0;
+		uint32_t * indices = nullptr;
+	};
+
+	uint32_t SplitChunks(const char * pBegin, const char * pEnd, Chunk (&pChunks)[MaxChunks])
+	{
+		const auto size = static_cast<size_t>(pEnd - pBegin);
+		const auto target = std::min<size_t>(std::min(MaxChunks, WorkerCount() * 4), size / MinChunkBytes + 1);
+
+		uint32_t count = 0;
+		auto start = pBegin;
+
+		for (size_t i = 1; i <= target && start < pEnd; i++)
+		{
+			auto split = i == target ? pEnd : std::max(start, pBegin + size * i / target);
+
+			//Move the split past the end of the line so no value straddles two chunks
+			while (split < pEnd && *split != '\n')
+			{
+				split++;
+			}
+
+			if (split < pEnd)
+			{
+				split++;
+			}
+
+			pChunks[count++] = { start, split, 0, 0 };
+			start = split;
+		}
+
+		return count;
+	}
+
+	uint64_t CountTokens(const char * pBegin, const char * pEnd)
+	{
+		uint64_t count = 0;
+		auto inToken = false;
+
+		for (auto p = pBegin; p < pEnd; p++)
+		{
+			const auto space = IsSpace(*p);
+			count += !space && !inToken;
+			inToken = !space;
+		}
+
+		return count;
+	}
+
+	bool ParseChunk(const Chunk & pChunk, const TokenLayout & pLayout)
+	{
+		auto token = pChunk.firstToken;
+		auto vertex = token < pLayout.vertexTokens ? token / pLayout.fieldCount : 0;
+		auto field = token < pLayout.vertexTokens ? static_cast<uint32_t>(token % pLayout.fieldCount) : 0;
+
+		auto p = SkipSpace(pChunk.begin, pChunk.end);
+
+		while (p < pChunk.end)
+		{
+			if (token < pLayout.vertexTokens)
+			{
+				float value;
+				p = ParseFloat(p, pChunk.end, value);
+
+				if (!p)
+				{
+					return false;
+				}
+
+				pLayout.fields[field][vertex * pLayout.strides[field]] = value;
+
+				if (++field == pLayout.fieldCount)
+				{
+					field = 0;
+					vertex++;
+				}
+			}
+			else if (token == pLayout.vertexTokens)
+			{
+				uint32_t indexCount;
+				p = ParseUInt(p, pChunk.end, indexCount);
+
+				if (!p || indexCount != pLayout.indexCount)
+				{
+					return false;
+				}
+			}
+			else
+			{
+				auto & index = pLayout.indices[token - pLayout.vertexTokens - 1];
+				p = ParseUInt(p, pChunk.end, index);
+
+				if (!p || index >= pLayout.vertexCount)
+				{
+					return false;
+				}
+			}
+
+			if (p < pChunk.end && !IsSpace(*p))
+			{
+				return false;
+			}
+
+			token++;
+			p = SkipSpace(p, pChunk.end);
+		}
+
+		return true;
+	}
+
+	// Reads the header count, sizes the output through pPrepare and parses the rest in parallel.
+	// pPrepare receives the header count and the number of values that follow it and returns
+	// false if they do not agree.
+	template <class Prepare>
+	bool ParseTokens(const char * pBegin, const char * pEnd, Prepare && pPrepare)
+	{
+		auto p = SkipSpace(pBegin, pEnd);
+
+		uint32_t headerCount;
+		p = ParseUInt(p, pEnd, headerCount);
+
+		if (!p)
+		{
+			return false;
+		}
+
+		Chunk chunks[MaxChunks];
+		const auto chunkCount = SplitChunks(p, pEnd, chunks);
+
+		ParallelFor(chunkCount, [&chunks](const uint32_t pIndex)
+		{
+			chunks[pIndex].tokenCount = CountTokens(chunks[pIndex].begin, chunks[pIndex].end);
+		});
+
+		uint64_t tokenCount = 0;
+
+		for (uint32_t i = 0; i < chunkCount; i++)
+		{
+			chunks[i].firstToken = tokenCount;
+			tokenCount += chunks[i].tokenCount;
+		}
+
+		TokenLayout layout;
+
+		if (!pPrepare(headerCount, tokenCount, layout))
+		{
+			return false;
+		}
+
+		std::atomic<bool> valid(true);
+
+		ParallelFor(chunkCount, [&chunks, &layout, &valid](const uint32_t pIndex)
+		{
+			if (!ParseChunk(chunks[pIndex], layout))
+			{
+				valid = false;
+			}
+		});
+
+		return valid;
+	}
+
+	void AddFields(TokenLayout & pLayout, std::vector<float> & pStream, const uint32_t pComponents)
+	{
+		for (uint32_t i = 0; i < pComponents; i++)
+		{
+			pLayout.fields[pLayout.fieldCount] = pStream.data() + i;
+			pLayout.strides[pLayout.fieldCount] = pComponents;
+			pLayout.fieldCount++;
+		}
+	}
+}
+
+bool Advanced_Rendering::ParseSimText(const char * pBegin, const char * pEnd, const SimLayout pLayout, MeshBuffer & pMesh)
+{
+	return ParseTokens(pBegin, pEnd, [&pMesh, pLayout](const uint32_t pVertexCount, const uint64_t pTokenCount, TokenLayout & pTokens)
+	{
+		const auto fieldsPerVertex = pLayout == SimLayout::Tangent ? 14u : 8u;
+		const auto vertexTokens = static_cast<uint64_t>(pVertexCount) * fieldsPerVertex;
+
+		//The indices make a triangle list
+		if (pTokenCount < vertexTokens + 1 || pTokenCount - vertexTokens - 1 > UINT32_MAX || (pTokenCount - vertexTokens - 1) % 3 != 0)
+		{
+			return false;
+		}
+
+		pMesh = MeshBuffer();
+		pMesh.vertexCount = pVertexCount;
+		pMesh.indices.resize(static_cast<size_t>(pTokenCount - vertexTokens - 1));
+
+		auto & positions = pMesh.Stream(MeshStream::Position);
+		auto & normals = pMesh.Stream(MeshStream::Normal);
+		auto & texCoords = pMesh.Stream(MeshStream::TexCoord);
+		auto & tangents = pMesh.Stream(MeshStream::Tangent);
+		auto & biTangents = pMesh.Stream(MeshStream::BiTangent);
+
+		positions.resize(pVertexCount * 3);
+		texCoords.resize(pVertexCount * 2);
+		normals.resize(pVertexCount * 3);
+
+		AddFields(pTokens, positions, 3);
+		AddFields(pTokens, texCoords, 2);
+		AddFields(pTokens, normals, 3);
+
+		if (pLayout == SimLayout::Tangent)
+		{
+			tangents.resize(pVertexCount * 3);
+			biTangents.resize(pVertexCount * 3);
+
+			AddFields(pTokens, tangents, 3);
+			AddFields(pTokens, biTangents, 3);
+		}
+
+		pTokens.vertexCount = pVertexCount;
+		pTokens.vertexTokens = vertexTokens;
+		pTokens.hasIndices = true;
+		pTokens.indexCount = static_cast<uint32_t>(pMesh.indices.size());
+		pTokens.indices = pMesh.indices.data();
+
+		return true;
+	});
+}
+
+bool Advanced_Rendering::ParseCurveText(const char * pBegin, const char * pEnd, MeshBuffer & pCurve)
+{
+	return ParseTokens(pBegin, pEnd, [&pCurve](const uint32_t pSegmentCount, const uint64_t pTokenCount, TokenLayout & pTokens)
+	{
+		const auto pointCount = static_cast<uint64_t>(pSegmentCount) * 4;
+
+		if (pointCount > UINT32_MAX || pTokenCount != pointCount * 6)
+		{
+			return false;
+		}
+
+		pCurve = MeshBuffer();
+		pCurve.vertexCount = static_cast<uint32_t>(pointCount);
+
+		auto & positions = pCurve.Stream(MeshStream::Position);
+		auto & biTangents = pCurve.Stream(MeshStream::BiTangent);
+
+		positions.resize(pCurve.vertexCount * 3);
+		biTangents.resize(pCurve.vertexCount * 3);
+
+		AddFields(pTokens, positions, 3);
+		AddFields(pTokens, biTangents, 3);
+
+		pTokens.vertexTokens = pTokenCount;
+
+		pCurve.indices.resize(pCurve.vertexCount);
+
+		for (uint32_t i = 0; i < pCurve.vertexCount; i++)
+		{
+			pCurve.indices[i] = i;
+		}
+
+		return true;
+	});
+}
+
+bool Advanced_Rendering::DetectSimLayout(const char * pBegin, const char * pEnd, SimLayout & pLayout)
+{
+	//Count the values on the first vertex line
+	auto line = pBegin;
+
+	while (line < pEnd && *line != '\n')
+	{
+		line++;
+	}
+
+	if (line < pEnd)
+	{
+		line++;
+	}
+
+	auto lineEnd = line;
+
+	while (lineEnd < pEnd && *lineEnd != '\n')
+	{
+		lineEnd++;
+	}
+
+	const auto count = CountTokens(line, lineEnd);
+
+	if (count == 14)
+	{
+		pLayout = SimLayout::Tangent;
+		return true;
+	}
+
+	if (count == 8)
+	{
+		pLayout = SimLayout::Basic;
+		return true;
+	}
+
+	return false;
+}
+
+bool Advanced_Rendering::LoadSimText(const std::string & pFilename, const SimLayout pLayout, MeshBuffer & pMesh)
+{
+	MappedFile file;
+
+	if (!file.Open(pFilename))
+	{
+		return false;
+	}
+
+	const auto begin = reinterpret_cast<const char *>(file.Data());
+
+	return ParseSimText(begin, begin + file.Size(), pLayout, pMesh);
+}
+
+bool Advanced_Rendering::LoadCurveText(const std::string & pFilename, MeshBuffer & pCurve)
+{
+	MappedFile file;
+
+	if (!file.Open(pFilename))
+	{
+		return false;
+	}
+
+	const auto begin = reinterpret_cast<const char *>(file.Data());
+
+	return ParseCurveText(begin, begin + file.Size(), pCurve);
+}
+
+bool Advanced_Rendering::DetectSimLayout(const std::string & pFilename, SimLayout & pLayout)
+{
+	MappedFile file;
+
+	if (!file.Open(pFilename))
+	{
+		return false;
+	}
+
+	const auto begin = reinterpret_cast<const char *>(file.Data());
+
+	return DetectSimLayout(begin, begin + file.Size(), pLayout);
+}
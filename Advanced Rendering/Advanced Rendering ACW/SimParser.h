@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include "MeshFile.h"
+
+namespace Advanced_Rendering
+{
+	// Text asset parsers. The file is split into line-aligned chunks that are counted and then
+	// parsed on all hardware threads straight into the output streams, so the parse loop itself
+	// never allocates. Every count in the file is checked against the number of values present.
+
+	// .sim: vertex count, one vertex per line in the given layout, index count, indices. Fails
+	// unless the indices are whole triangles of vertices in the file.
+	bool ParseSimText(const char * pBegin, const char * pEnd, SimLayout pLayout, MeshBuffer & pMesh);
+
+	// .cur: segment count, then four control points per segment of position and bitangent.
+	// Fills the Position and BiTangent streams and a sequential index list.
+	bool ParseCurveText(const char * pBegin, const char * pEnd, MeshBuffer & pCurve);
+
+	bool DetectSimLayout(const char * pBegin, const char * pEnd, SimLayout & pLayout);
+
+	bool LoadSimText(const std::string & pFilename, SimLayout pLayout, MeshBuffer & pMesh);
+	bool LoadCurveText(const std::string & pFilename, MeshBuffer & pCurve);
+	bool DetectSimLayout(const std::string & pFilename, SimLayout & pLayout);
+}
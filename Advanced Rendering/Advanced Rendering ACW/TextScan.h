@@ -0,0 +1,128 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+
+namespace Advanced_Rendering
+{
+	// Scanning for the text asset parsers. Each returns past what it read, or null when the text
+	// does not hold a value of its type.
+
+	inline bool IsSpace(const char pChar)
+	{
+		return pChar == ' ' || pChar == '\t' || pChar == '\n' || pChar == '\r';
+	}
+
+	inline const char * SkipSpace(const char * pBegin, const char * pEnd)
+	{
+		while (pBegin < pEnd && IsSpace(*pBegin))
+		{
+			pBegin++;
+		}
+
+		return pBegin;
+	}
+
+	inline const char * ParseUInt(const char * pBegin, const char * pEnd, uint32_t & pValue)
+	{
+		const auto result = std::from_chars(pBegin, pEnd, pValue);
+
+		return result.ec == std::errc() ? result.ptr : nullptr;
+	}
+
+#if defined(__cpp_lib_to_chars)
+	inline const char * ParseFloat(const char * pBegin, const char * pEnd, float & pValue)
+	{
+		const auto result = std::from_chars(pBegin, pEnd, pValue);
+
+		return result.ec == std::errc() ? result.ptr : nullptr;
+	}
+#else
+	// Standard libraries without floating point from_chars. The assets are short decimals, which
+	// are exact in a double before the single scale, so the result matches from_chars.
+	inline const char * ParseFloat(const char * pBegin, const char * pEnd, float & pValue)
+	{
+		static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+		auto p = pBegin;
+		const auto negative = p < pEnd && *p == '-';
+
+		if (negative)
+		{
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		auto exponent = 0;
+		auto digits = 0;
+
+		for (; p < pEnd && *p >= '0' && *p <= '9'; p++, digits++)
+		{
+			if (mantissa < 100000000000000000ull)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+			}
+			else
+			{
+				exponent++;
+			}
+		}
+
+		if (p < pEnd && *p == '.')
+		{
+			for (p++; p < pEnd && *p >= '0' && *p <= '9'; p++, digits++)
+			{
+				if (mantissa < 100000000000000000ull)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					exponent--;
+				}
+			}
+		}
+
+		if (digits == 0)
+		{
+			return nullptr;
+		}
+
+		if (p < pEnd && (*p == 'e' || *p == 'E'))
+		{
+			p++;
+
+			const auto negativeExponent = p < pEnd && *p == '-';
+
+			if (p < pEnd && (*p == '-' || *p == '+'))
+			{
+				p++;
+			}
+
+			uint32_t value;
+			p = ParseUInt(p, pEnd, value);
+
+			if (!p)
+			{
+				return nullptr;
+			}
+
+			exponent += negativeExponent ? -static_cast<int>(value) : static_cast<int>(value);
+		}
+
+		auto result = static_cast<double>(mantissa);
+
+		if (exponent < 0)
+		{
+			result /= -exponent <= 22 ? powers[-exponent] : std::pow(10.0, -exponent);
+		}
+		else if (exponent > 0)
+		{
+			result *= exponent <= 22 ? powers[exponent] : std::pow(10.0, exponent);
+		}
+
+		pValue = static_cast<float>(negative ? -result : result);
+
+		return p;
+	}
+#endif
+}
@@ -5,7 +5,95 @@
 
 using namespace Advanced_Rendering;
 
-Texture::Texture(const std::string & pTextureFile) : mTextureFile(pTextureFile)
+namespace
+{
+	// Records the texture behind pView, whatever shape the DDS file gave it
+	ResourceHandle TrackTexture(const std::shared_ptr<DX::DeviceResources> & pDeviceResources, ID3D11ShaderResourceView * const pView, const std::string & pName)
+	{
+		if (!pView)
+		{
+			return ResourceHandle();
+		}
+
+		Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture2D;
+		Microsoft::WRL::ComPtr<ID3D11Texture3D> texture3D;
+		pView->GetResource(resource.GetAddressOf());
+
+		ResourceDesc memory;
+		memory.kind = ResourceKind::Texture;
+		memory.owner = "Texture";
+		memory.name = pName;
+
+		if (SUCCEEDED(resource.As(&texture2D)))
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			texture2D->GetDesc(&desc);
+
+			memory.format = static_cast<DdsFormat>(desc.Format);
+			memory.width = desc.Width;
+			memory.height = desc.Height;
+			memory.mipCount = desc.MipLevels;
+			memory.arraySize = desc.ArraySize;
+		}
+		else if (SUCCEEDED(resource.As(&texture3D)))
+		{
+			D3D11_TEXTURE3D_DESC desc;
+			texture3D->GetDesc(&desc);
+
+			memory.format = static_cast<DdsFormat>(desc.Format);
+			memory.width = desc.Width;
+			memory.height = desc.Height;
+			memory.depth = desc.Depth;
+			memory.mipCount = desc.MipLevels;
+		}
+		else
+		{
+			return ResourceHandle();
+		}
+
+		memory.bytes = TextureBytes(memory.format, memory.width, memory.height, memory.depth, memory.mipCount, memory.arraySize);
+
+		return pDeviceResources->GetResourceRegistry()->Track(memory);
+	}
+
+	// Swaps a 2D view for a one layer array view of the same texture, other views are left as they are
+	void ViewAsArray(ID3D11Device * const pDevice, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> & pView)
+	{
+		if (!pView)
+		{
+			return;
+		}
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC desc;
+		pView->GetDesc(&desc);
+
+		if (desc.ViewDimension != D3D11_SRV_DIMENSION_TEXTURE2D)
+		{
+			return;
+		}
+
+		Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+		pView->GetResource(resource.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC arrayDesc = {};
+		arrayDesc.Format = desc.Format;
+		arrayDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		arrayDesc.Texture2DArray.MostDetailedMip = desc.Texture2D.MostDetailedMip;
+		arrayDesc.Texture2DArray.MipLevels = desc.Texture2D.MipLevels;
+		arrayDesc.Texture2DArray.FirstArraySlice = 0;
+		arrayDesc.Texture2DArray.ArraySize = 1;
+
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> arrayView;
+
+		if (SUCCEEDED(pDevice->CreateShaderResourceView(resource.Get(), &arrayDesc, arrayView.GetAddressOf())))
+		{
+			pView = arrayView;
+		}
+	}
+}
+
+Texture::Texture(const std::string & pTextureFile, const TextureCookOptions & pOptions, const bool pArrayView) : mTextureFile(pTextureFile), mOptions(pOptions), mArrayView(pArrayView)
 {
 }
 
@@ -15,6 +103,43 @@ void Texture::Load(std::shared_ptr<DX::DeviceResources> pDeviceResources)
 	auto device = pDeviceResources->GetD3DDevice();
 
 	auto result = DirectX::CreateDDSTextureFromFile(device, temp.c_str(), nullptr, mTexture.ReleaseAndGetAddressOf());
+
+	if (mArrayView)
+	{
+		ViewAsArray(device, mTexture);
+	}
+
+	mMemory = TrackTexture(pDeviceResources, mTexture.Get(), mTextureFile);
+}
+
+JobHandle Texture::Load(AssetLoader & pLoader, std::shared_ptr<DX::DeviceResources> pDeviceResources, std::shared_ptr<AssetCache> pCache)
+{
+	auto texture = std::make_shared<CookedTexture>();
+
+	//A missing or bad texture cooks to nothing and is left unbound, as with the synchronous Load
+	const auto cook = pLoader.Add(JobQueue::Worker, [this, texture, pCache]()
+	{
+		CookTexture(mTextureFile, mOptions, pCache.get(), *texture);
+	});
+
+	//Creating from memory needs no immediate context, so this runs off the render thread too
+	return pLoader.Add(JobQueue::Worker, [this, texture, pDeviceResources]()
+	{
+		if (!texture->data)
+		{
+			return;
+		}
+
+		DirectX::CreateDDSTextureFromMemory(pDeviceResources->GetD3DDevice(), texture->data, texture->size, nullptr, mTexture.ReleaseAndGetAddressOf());
+
+		if (mArrayView)
+		{
+			ViewAsArray(pDeviceResources->GetD3DDevice(), mTexture);
+		}
+
+		mMemory = TrackTexture(pDeviceResources, mTexture.Get(), mTextureFile);
+		*texture = CookedTexture();
+	}, { cook });
 }
 
 Texture::~Texture()
@@ -57,4 +182,5 @@ void Texture::ReleaseDomainTexture(std::shared_ptr<DX::DeviceResources> pDeviceR
 void Texture::Reset()
 {
 	mTexture.Reset();
+	mMemory.Reset();
 }
\ No newline at end of file
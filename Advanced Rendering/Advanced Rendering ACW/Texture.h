@@ -5,6 +5,8 @@
 
 #include "..\Common\DirectXHelper.h"
 #include "..\Common\DeviceResources.h"
+#include "AssetLoader.h"
+#include "TextureCooker.h"
 
 namespace Advanced_Rendering
 {
@@ -12,9 +14,14 @@ namespace Advanced_Rendering
 	{
 		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> mTexture = nullptr;
 		std::string mTextureFile;
+		TextureCookOptions mOptions;
+		ResourceHandle mMemory;
+		bool mArrayView;
 
 	public:
-		Texture(const std::string & pTextureFile);
+		// pArrayView views a single 2D texture as a one layer array, for shaders that sample a layer
+		// of a pack and a texture of its own alike.
+		Texture(const std::string & pTextureFile, const TextureCookOptions & pOptions = TextureCookOptions(), bool pArrayView = false);
 		~Texture();
 
 		Texture(const Texture &) = delete;
@@ -23,6 +30,10 @@ namespace Advanced_Rendering
 		Texture & operator= (Texture &&) = delete;
 
 		void Load(std::shared_ptr<DX::DeviceResources> pDeviceResources);
+
+		// Cook job then a create job on the worker threads, returns the create job. Without a cache
+		// the texture is still compressed as its options ask, just every time it loads.
+		JobHandle Load(AssetLoader & pLoader, std::shared_ptr<DX::DeviceResources> pDeviceResources, std::shared_ptr<AssetCache> pCache = nullptr);
 		void UseTexture(std::shared_ptr<DX::DeviceResources> pDeviceResources, unsigned int pIndex) const;
 		void ReleaseTexture(std::shared_ptr<DX::DeviceResources> pDeviceResources, unsigned int pIndex) const;
 
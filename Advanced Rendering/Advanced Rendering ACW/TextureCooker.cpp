@@ -0,0 +1,278 @@
+#include "TextureCooker.h"
+
+#include <algorithm>
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr uint32_t DdsChunk = ChunkId('D', 'D', 'S', ' ');
+
+	bool GetLayout(const DdsFormat pFormat, PixelLayout & pLayout)
+	{
+		switch (pFormat)
+		{
+		case DdsFormat::R8G8B8A8_UNORM:
+		case DdsFormat::R8G8B8A8_UNORM_SRGB:
+			pLayout = PixelLayout::Rgba;
+			return true;
+
+		case DdsFormat::B8G8R8A8_UNORM:
+		case DdsFormat::B8G8R8A8_UNORM_SRGB:
+			pLayout = PixelLayout::Bgra;
+			return true;
+
+		case DdsFormat::B8G8R8X8_UNORM:
+		case DdsFormat::B8G8R8X8_UNORM_SRGB:
+			pLayout = PixelLayout::Bgrx;
+			return true;
+
+		case DdsFormat::R8_UNORM:
+			pLayout = PixelLayout::R;
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	bool IsSrgb(const DdsFormat pFormat)
+	{
+		return pFormat == DdsFormat::R8G8B8A8_UNORM_SRGB || pFormat == DdsFormat::B8G8R8A8_UNORM_SRGB || pFormat == DdsFormat::B8G8R8X8_UNORM_SRGB;
+	}
+
+	bool IsOpaque(const DdsImage & pImage, const PixelLayout pLayout)
+	{
+		if (pLayout != PixelLayout::Rgba && pLayout != PixelLayout::Bgra)
+		{
+			return true;
+		}
+
+		for (const auto & surface : pImage.surfaces)
+		{
+			for (uint32_t z = 0; z < surface.depth; z++)
+			{
+				for (uint32_t y = 0; y < surface.height; y++)
+				{
+					const auto row = surface.data + z * surface.slicePitch + y * surface.rowPitch;
+
+					for (uint32_t x = 0; x < surface.width; x++)
+					{
+						if (row[x * 4 + 3] != 255)
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	uint64_t Key(const MappedFile & pSource, const TextureCookOptions & pOptions)
+	{
+		const uint32_t options[] =
+		{
+			TextureCookerVersion,
+			static_cast<uint32_t>(pOptions.compression),
+			static_cast<uint32_t>(pOptions.quality),
+			pOptions.mips ? 1u : 0u,
+			static_cast<uint32_t>(pOptions.mipOptions.filter),
+			pOptions.mipOptions.gammaCorrect ? 1u : 0u,
+			pOptions.mipOptions.normalMap ? 1u : 0u
+		};
+
+		return AssetCache::Key(pSource.Data(), pSource.Size(), options, static_cast<uint32_t>(sizeof options / sizeof options[0]));
+	}
+}
+
+bool Advanced_Rendering::CompressTexture(const DdsImage & pSource, const TextureCookOptions & pOptions, std::vector<uint8_t> & pOutput)
+{
+	pOutput.clear();
+
+	PixelLayout layout;
+
+	if (pOptions.compression == TextureCompression::None || pSource.dimension != DdsDimension::Texture2D ||
+		!GetLayout(pSource.format, layout) || pSource.width % 4 != 0 || pSource.height % 4 != 0)
+	{
+		return false;
+	}
+
+	auto format = BlockFormat::BC1;
+
+	switch (pOptions.compression)
+	{
+	case TextureCompression::Color:
+		format = IsOpaque(pSource, layout) ? BlockFormat::BC1 : BlockFormat::BC3;
+		break;
+
+	case TextureCompression::Single:
+		format = BlockFormat::BC4;
+		break;
+
+	default:
+		format = BlockFormat::BC5;
+		break;
+	}
+
+	DdsImage image;
+	image.format = IsSrgb(pSource.format) ? MakeSrgb(BlockDdsFormat(format)) : BlockDdsFormat(format);
+	image.dimension = pSource.dimension;
+	image.alphaMode = format == BlockFormat::BC3 ? pSource.alphaMode : DdsAlphaMode::Unknown;
+	image.width = pSource.width;
+	image.height = pSource.height;
+	image.depth = pSource.depth;
+	image.mipCount = pSource.mipCount;
+	image.arraySize = pSource.arraySize;
+	image.cubeMap = pSource.cubeMap;
+
+	WriteDdsHeader(image, pOutput);
+
+	auto size = pOutput.size();
+
+	for (const auto & surface : pSource.surfaces)
+	{
+		size += CompressedSize(surface.width, surface.height, format);
+	}
+
+	auto output = pOutput.size();
+	pOutput.resize(size);
+
+	//Surfaces go out in the order they came in, which is the order ParseDds expects them
+	for (const auto & surface : pSource.surfaces)
+	{
+		PixelView view;
+		view.data = surface.data;
+		view.width = surface.width;
+		view.height = surface.height;
+		view.rowPitch = surface.rowPitch;
+		view.layout = layout;
+
+		CompressSurface(view, format, pOptions.quality, pOutput.data() + output);
+		output += CompressedSize(surface.width, surface.height, format);
+	}
+
+	return true;
+}
+
+bool Advanced_Rendering::GenerateMipChain(const DdsImage & pSource, const TextureCookOptions & pOptions, std::vector<uint8_t> & pOutput)
+{
+	pOutput.clear();
+
+	PixelLayout layout;
+
+	if (!pOptions.mips || pSource.mipCount != 1 || pSource.dimension != DdsDimension::Texture2D ||
+		!GetLayout(pSource.format, layout) || FullMipCount(pSource.width, pSource.height) == 1)
+	{
+		return false;
+	}
+
+	auto image = pSource;
+	image.mipCount = FullMipCount(pSource.width, pSource.height);
+
+	WriteDdsHeader(image, pOutput);
+
+	//One surface per array item or cube face, each followed by its chain
+	for (const auto & surface : pSource.surfaces)
+	{
+		const auto offset = pOutput.size();
+		const auto rowBytes = MipLevelSize(surface.width, 1, layout);
+
+		pOutput.resize(offset + MipLevelSize(surface.width, surface.height, layout));
+
+		for (uint32_t y = 0; y < surface.height; y++)
+		{
+			std::copy(surface.data + y * surface.rowPitch, surface.data + y * surface.rowPitch + rowBytes, pOutput.data() + offset + y * rowBytes);
+		}
+
+		PixelView view;
+		view.data = surface.data;
+		view.width = surface.width;
+		view.height = surface.height;
+		view.rowPitch = surface.rowPitch;
+		view.layout = layout;
+
+		GenerateMips(view, pOptions.mipOptions, pOutput);
+	}
+
+	return true;
+}
+
+bool Advanced_Rendering::CookTexture(const std::string & pFilename, const TextureCookOptions & pOptions, AssetCache * const pCache, CookedTexture & pTexture)
+{
+	pTexture = CookedTexture();
+
+	auto source = std::make_shared<MappedFile>();
+
+	if (!source->Open(pFilename))
+	{
+		return false;
+	}
+
+	pTexture.sourceSize = source->Size();
+
+	uint64_t key = 0;
+
+	if (pCache && (pOptions.compression != TextureCompression::None || pOptions.mips))
+	{
+		key = Key(*source, pOptions);
+
+		const auto file = pCache->Find(key);
+		uint64_t size = 0;
+		const auto data = file ? file->Chunk(DdsChunk, size) : nullptr;
+
+		if (data)
+		{
+			pTexture.data = static_cast<const uint8_t *>(data);
+			pTexture.size = static_cast<size_t>(size);
+			pTexture.cached = true;
+			pTexture.storage.push_back(file);
+			return true;
+		}
+	}
+
+	DdsImage image;
+
+	if (ParseDds(source->Data(), source->Size(), image) != DdsError::None)
+	{
+		pTexture = CookedTexture();
+		return false;
+	}
+
+	auto cooked = std::make_shared<std::vector<uint8_t>>();
+	std::vector<uint8_t> chain;
+
+	//The chain is parsed back so the compressor sees every level as surfaces, like any other file
+	if (GenerateMipChain(image, pOptions, chain) && ParseDds(chain.data(), chain.size(), image) != DdsError::None)
+	{
+		pTexture = CookedTexture();
+		return false;
+	}
+
+	if (!CompressTexture(image, pOptions, *cooked))
+	{
+		if (chain.empty())
+		{
+			//Nothing to cook, the loader reads the source as it did before
+			pTexture.data = source->Data();
+			pTexture.size = source->Size();
+			pTexture.storage.push_back(source);
+			return true;
+		}
+
+		cooked->swap(chain);
+	}
+
+	//A failed store only costs the next run another compression
+	if (pCache)
+	{
+		pCache->Store(key, { { DdsChunk, cooked->data(), cooked->size() } });
+	}
+
+	pTexture.data = cooked->data();
+	pTexture.size = cooked->size();
+	pTexture.storage.push_back(cooked);
+
+	return true;
+}
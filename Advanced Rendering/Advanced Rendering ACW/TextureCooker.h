@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AssetCache.h"
+#include "BlockCompressor.h"
+#include "DdsParser.h"
+#include "MipGenerator.h"
+
+namespace Advanced_Rendering
+{
+	// Bump whenever the compressor or mip generator changes its output, so every cooked texture
+	// misses once and is cooked again.
+	constexpr uint32_t TextureCookerVersion = 2;
+
+	enum class TextureCompression
+	{
+		None,			// as the file is
+		Color,			// BC1, or BC3 when any pixel is not opaque
+		Single,			// BC4 from red, for displacement and occlusion
+		Normal			// BC5 from red and green, the shader rebuilds z
+	};
+
+	struct TextureCookOptions
+	{
+		TextureCompression compression = TextureCompression::None;
+		CompressQuality quality = CompressQuality::Normal;
+		bool mips = false;				// build the full chain when the file only has its top level
+		MipOptions mipOptions;
+	};
+
+	// A DDS file ready for CreateDDSTextureFromMemory. It points into the mapped cooked file, the
+	// buffer built on a miss or the mapped source when there was nothing to cook, all held by storage.
+	struct CookedTexture
+	{
+		const uint8_t * data = nullptr;
+		size_t size = 0;
+		size_t sourceSize = 0;
+		bool cached = false;				// served from the cache rather than cooked
+
+		std::vector<std::shared_ptr<const void>> storage;
+	};
+
+	// Block compresses every surface of an uncompressed 8 bit RGBA, BGRA or R texture into a new DDS
+	// file in pOutput. False, leaving pOutput empty, when pOptions ask for no compression or the
+	// source cannot be compressed: other formats, or a top level Direct3D 11 cannot make a block
+	// compressed texture of because it is not a multiple of 4.
+	bool CompressTexture(const DdsImage & pSource, const TextureCookOptions & pOptions, std::vector<uint8_t> & pOutput);
+
+	// Builds a new uncompressed DDS file in pOutput holding pSource's top levels and the full mip chain
+	// below each. False, leaving pOutput empty, when pOptions ask for no mips or pSource already has
+	// more than one level, is not a 2D texture or is not 8 bit RGBA, BGRA or R.
+	bool GenerateMipChain(const DdsImage & pSource, const TextureCookOptions & pOptions, std::vector<uint8_t> & pOutput);
+
+	// Serves pFilename cooked with pOptions from pCache, or cooks it and stores the result when the
+	// cache misses. Textures with nothing to cook are served from the mapped source. Returns false
+	// when the file cannot be read or is not a DDS file, leaving pTexture empty.
+	bool CookTexture(const std::string & pFilename, const TextureCookOptions & pOptions, AssetCache * pCache, CookedTexture & pTexture);
+}
@@ -0,0 +1,292 @@
+#include "TexturePacker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include "DdsParser.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	uint32_t RoundUp4(const uint32_t pValue)
+	{
+		return (pValue + 3) & ~3u;
+	}
+
+	// Writes the texel as B8G8R8A8, whatever the layout it came in
+	void CopyTexel(const PixelView & pView, const uint32_t pX, const uint32_t pY, uint8_t * pOutput)
+	{
+		const auto row = pView.data + pY * pView.rowPitch;
+
+		switch (pView.layout)
+		{
+		case PixelLayout::Rgba:
+			pOutput[0] = row[pX * 4 + 2];
+			pOutput[1] = row[pX * 4 + 1];
+			pOutput[2] = row[pX * 4];
+			pOutput[3] = row[pX * 4 + 3];
+			break;
+
+		case PixelLayout::Bgra:
+		case PixelLayout::Bgrx:
+			pOutput[0] = row[pX * 4];
+			pOutput[1] = row[pX * 4 + 1];
+			pOutput[2] = row[pX * 4 + 2];
+			pOutput[3] = pView.layout == PixelLayout::Bgra ? row[pX * 4 + 3] : 255;
+			break;
+
+		default:
+			pOutput[0] = pOutput[1] = pOutput[2] = row[pX];
+			pOutput[3] = 255;
+			break;
+		}
+	}
+
+	// Fills the area of the layer from pLeft, pTop to pRight, pBottom with the region at pRegion,
+	// clamping to its edges outside it
+	void FillArea(const PixelView & pSource, const PackRegion & pRegion, const uint32_t pLeft, const uint32_t pTop,
+		const uint32_t pRight, const uint32_t pBottom, const uint32_t pLayerWidth, uint8_t * pLayer)
+	{
+		for (auto y = pTop; y < pBottom; y++)
+		{
+			const auto sourceY = static_cast<uint32_t>(std::min(std::max(static_cast<int>(y) - static_cast<int>(pRegion.y), 0), static_cast<int>(pSource.height) - 1));
+
+			for (auto x = pLeft; x < pRight; x++)
+			{
+				const auto sourceX = static_cast<uint32_t>(std::min(std::max(static_cast<int>(x) - static_cast<int>(pRegion.x), 0), static_cast<int>(pSource.width) - 1));
+				CopyTexel(pSource, sourceX, sourceY, pLayer + (static_cast<size_t>(y) * pLayerWidth + x) * 4);
+			}
+		}
+	}
+
+	void SetRect(const PackManifest & pManifest, PackRegion & pRegion)
+	{
+		pRegion.rect[0] = static_cast<float>(pRegion.x) / pManifest.width;
+		pRegion.rect[1] = static_cast<float>(pRegion.y) / pManifest.height;
+		pRegion.rect[2] = static_cast<float>(pRegion.width) / pManifest.width;
+		pRegion.rect[3] = static_cast<float>(pRegion.height) / pManifest.height;
+	}
+}
+
+const PackRegion * PackManifest::Find(const std::string & pName) const
+{
+	for (const auto & region : regions)
+	{
+		if (region.name == pName)
+		{
+			return &region;
+		}
+	}
+
+	return nullptr;
+}
+
+bool Advanced_Rendering::PackTextures(const std::vector<PackSource> & pSources, const PackOptions & pOptions, std::vector<uint8_t> & pOutput, PackManifest & pManifest)
+{
+	pOutput.clear();
+	pManifest = PackManifest();
+
+	if (pSources.empty())
+	{
+		return false;
+	}
+
+	pManifest.layout = pOptions.layout;
+	pManifest.regions.resize(pSources.size());
+
+	//Each region's cell, the region and its gutter, which the region's edges are repeated across
+	std::vector<uint32_t> cells(pSources.size() * 4);
+
+	if (pOptions.layout == PackLayout::Array)
+	{
+		for (size_t i = 0; i < pSources.size(); i++)
+		{
+			pManifest.width = std::max(pManifest.width, RoundUp4(pSources[i].pixels.width));
+			pManifest.height = std::max(pManifest.height, RoundUp4(pSources[i].pixels.height));
+		}
+
+		pManifest.layers = static_cast<uint32_t>(pSources.size());
+
+		for (size_t i = 0; i < pSources.size(); i++)
+		{
+			pManifest.regions[i].layer = static_cast<uint32_t>(i);
+
+			cells[i * 4 + 2] = pManifest.width;
+			cells[i * 4 + 3] = pManifest.height;
+		}
+	}
+	else
+	{
+		const auto gutter = RoundUp4(pOptions.gutter);
+		uint64_t area = 0;
+		uint32_t widest = 0;
+
+		for (const auto & source : pSources)
+		{
+			const auto width = RoundUp4(source.pixels.width) + gutter * 2;
+			area += static_cast<uint64_t>(width) * (RoundUp4(source.pixels.height) + gutter * 2);
+			widest = std::max(widest, width);
+		}
+
+		//Shelves as wide as a square holding every cell. Tallest first, each going on the first shelf
+		//with room left, so later shelves are no taller than the ones above
+		pManifest.width = std::max(widest, RoundUp4(static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(area))))));
+		pManifest.layers = 1;
+
+		std::vector<size_t> order(pSources.size());
+
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = i;
+		}
+
+		std::stable_sort(order.begin(), order.end(), [&pSources](const size_t pA, const size_t pB)
+		{
+			return pSources[pA].pixels.height > pSources[pB].pixels.height;
+		});
+
+		//Top and used width of each shelf
+		std::vector<std::pair<uint32_t, uint32_t>> shelves;
+
+		for (const auto i : order)
+		{
+			const auto width = RoundUp4(pSources[i].pixels.width) + gutter * 2;
+			const auto height = RoundUp4(pSources[i].pixels.height) + gutter * 2;
+
+			auto shelf = std::find_if(shelves.begin(), shelves.end(), [&pManifest, width](const std::pair<uint32_t, uint32_t> & pShelf)
+			{
+				return pShelf.second + width <= pManifest.width;
+			});
+
+			if (shelf == shelves.end())
+			{
+				shelves.emplace_back(pManifest.height, 0);
+				pManifest.height += height;
+				shelf = shelves.end() - 1;
+			}
+
+			cells[i * 4] = shelf->second;
+			cells[i * 4 + 1] = shelf->first;
+			cells[i * 4 + 2] = shelf->second + width;
+			cells[i * 4 + 3] = shelf->first + height;
+
+			pManifest.regions[i].x = shelf->second + gutter;
+			pManifest.regions[i].y = shelf->first + gutter;
+
+			shelf->second += width;
+		}
+	}
+
+	for (size_t i = 0; i < pSources.size(); i++)
+	{
+		auto & region = pManifest.regions[i];
+		region.name = pSources[i].name;
+		region.width = pSources[i].pixels.width;
+		region.height = pSources[i].pixels.height;
+		SetRect(pManifest, region);
+	}
+
+	DdsImage image;
+	image.format = DdsFormat::B8G8R8A8_UNORM;
+	image.dimension = DdsDimension::Texture2D;
+	image.width = pManifest.width;
+	image.height = pManifest.height;
+	image.depth = 1;
+	image.mipCount = 1;
+	image.arraySize = pManifest.layers;
+
+	WriteDdsHeader(image, pOutput);
+
+	const auto header = pOutput.size();
+	const auto layerBytes = static_cast<size_t>(pManifest.width) * pManifest.height * 4;
+
+	//Atlas texels outside every cell stay transparent black
+	pOutput.resize(header + layerBytes * pManifest.layers, 0);
+
+	for (size_t i = 0; i < pSources.size(); i++)
+	{
+		const auto & region = pManifest.regions[i];
+
+		FillArea(pSources[i].pixels, region, cells[i * 4], cells[i * 4 + 1], cells[i * 4 + 2], cells[i * 4 + 3], pManifest.width,
+			pOutput.data() + header + layerBytes * region.layer);
+	}
+
+	return true;
+}
+
+std::string Advanced_Rendering::WritePackManifest(const PackManifest & pManifest)
+{
+	std::ostringstream text;
+
+	text << "# TextureTool pack, texel rects of each region\n";
+	text << "pack " << (pManifest.layout == PackLayout::Array ? "array" : "atlas") << ' ' << pManifest.width << ' ' << pManifest.height << ' ' << pManifest.layers << '\n';
+
+	for (const auto & region : pManifest.regions)
+	{
+		text << "region " << region.name << ' ' << region.layer << ' ' << region.x << ' ' << region.y << ' ' << region.width << ' ' << region.height << '\n';
+	}
+
+	return text.str();
+}
+
+bool Advanced_Rendering::ReadPackManifest(const char * const pText, const size_t pSize, PackManifest & pManifest)
+{
+	pManifest = PackManifest();
+
+	std::istringstream text(std::string(pText, pSize));
+	std::string line;
+	auto hasPack = false;
+
+	while (std::getline(text, line))
+	{
+		std::istringstream fields(line);
+		std::string keyword;
+
+		if (!(fields >> keyword) || keyword[0] == '#')
+		{
+			continue;
+		}
+
+		if (keyword == "pack" && !hasPack)
+		{
+			std::string layout;
+
+			if (!(fields >> layout >> pManifest.width >> pManifest.height >> pManifest.layers) || (layout != "array" && layout != "atlas") ||
+				pManifest.width == 0 || pManifest.height == 0 || pManifest.layers == 0)
+			{
+				break;
+			}
+
+			pManifest.layout = layout == "array" ? PackLayout::Array : PackLayout::Atlas;
+			hasPack = true;
+		}
+		else if (keyword == "region" && hasPack)
+		{
+			PackRegion region;
+
+			if (!(fields >> region.name >> region.layer >> region.x >> region.y >> region.width >> region.height) || region.layer >= pManifest.layers ||
+				region.x > pManifest.width || region.width > pManifest.width - region.x ||
+				region.y > pManifest.height || region.height > pManifest.height - region.y)
+			{
+				hasPack = false;
+				break;
+			}
+
+			SetRect(pManifest, region);
+			pManifest.regions.push_back(region);
+		}
+		else
+		{
+			hasPack = false;
+			break;
+		}
+	}
+
+	if (!hasPack)
+	{
+		pManifest = PackManifest();
+	}
+
+	return hasPack;
+}
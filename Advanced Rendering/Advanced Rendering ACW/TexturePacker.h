@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BlockCompressor.h"
+
+namespace Advanced_Rendering
+{
+	enum class PackLayout
+	{
+		Array,			// one layer per texture, each in the top left corner of a layer as large as the largest
+		Atlas			// every texture on shelves of a single layer, with gutters between them
+	};
+
+	struct PackSource
+	{
+		std::string name;
+		PixelView pixels;
+	};
+
+	// Where a packed texture ended up, in texels of its layer. The rect is the same area as a UV
+	// offset and size, which shaders apply to the wrapped UV of the original texture.
+	struct PackRegion
+	{
+		std::string name;
+		uint32_t layer = 0;
+		uint32_t x = 0;
+		uint32_t y = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		float rect[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+	};
+
+	struct PackManifest
+	{
+		PackLayout layout = PackLayout::Array;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t layers = 0;
+		std::vector<PackRegion> regions;
+
+		// Null when there is no region called pName
+		const PackRegion * Find(const std::string & pName) const;
+	};
+
+	struct PackOptions
+	{
+		PackLayout layout = PackLayout::Array;
+		uint32_t gutter = 4;		// texels of repeated edge around each atlas region, kept to whole blocks for the compressor
+	};
+
+	// Packs pSources into one uncompressed B8G8R8A8 DDS file in pOutput, a texture array or a single
+	// layer atlas, with the region of each source in pManifest. The rest of a region's layer, or its
+	// gutter in an atlas, repeats the nearest edge texel so bilinear filtering and the first mips do not
+	// pull in other regions. Regions start on a multiple of 4 so no block mixes two textures. False
+	// when pSources is empty.
+	bool PackTextures(const std::vector<PackSource> & pSources, const PackOptions & pOptions, std::vector<uint8_t> & pOutput, PackManifest & pManifest);
+
+	// The manifest is text, one region a line in texels, so it can be read and diffed alongside the
+	// assets. Names cannot hold spaces. Reading fills in each rect, and fails on regions outside the pack.
+	std::string WritePackManifest(const PackManifest & pManifest);
+	bool ReadPackManifest(const char * pText, size_t pSize, PackManifest & pManifest);
+}
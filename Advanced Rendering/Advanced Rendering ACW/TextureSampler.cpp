@@ -0,0 +1,688 @@
+#include "TextureSampler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define TEXTURE_SAMPLER_SSE2
+#endif
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	//512 blocks of float texels, 128 KB a thread, four ways to a set
+	constexpr uint32_t CacheSetBits = 7;
+	constexpr uint32_t CacheWays = 4;
+	constexpr uint32_t CacheBlocks = (1u << CacheSetBits) * CacheWays;
+
+	std::atomic<uint32_t> nextSerial(1);
+
+	struct DecodedBlock
+	{
+		alignas(16) float texels[64];
+	};
+
+	const float * SrgbToLinear()
+	{
+		static const auto table = []()
+		{
+			std::array<float, 256> values;
+
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				const auto c = i / 255.0f;
+				values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+
+			return values;
+		}();
+
+		return table.data();
+	}
+
+	// Fills all 16 texels with one RGBA value
+	void Fill(const float * pColor, float * pTexels)
+	{
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			memcpy(pTexels + i * 4, pColor, sizeof(float) * 4);
+		}
+	}
+
+	// A BC1 colour block, rounded as BlockCompressor decodes it so the two agree. BC2 and BC3 colour
+	// is always four colours, and leaves alpha alone.
+	void DecodeColor(const uint8_t * pBlock, const bool pFourColorOnly, const bool pSrgb, float * pTexels)
+	{
+		const auto color0 = static_cast<uint32_t>(pBlock[0] | pBlock[1] << 8);
+		const auto color1 = static_cast<uint32_t>(pBlock[2] | pBlock[3] << 8);
+		const auto fourColor = pFourColorOnly || color0 > color1;
+
+		const uint32_t rgb0[3] = { (color0 >> 11 & 31) << 3 | (color0 >> 13 & 7), (color0 >> 5 & 63) << 2 | (color0 >> 9 & 3), (color0 & 31) << 3 | (color0 >> 2 & 7) };
+		const uint32_t rgb1[3] = { (color1 >> 11 & 31) << 3 | (color1 >> 13 & 7), (color1 >> 5 & 63) << 2 | (color1 >> 9 & 3), (color1 & 31) << 3 | (color1 >> 2 & 7) };
+
+		const auto linear = SrgbToLinear();
+		alignas(16) float palette[4][4];
+
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			const uint32_t values[4] =
+			{
+				rgb0[c],
+				rgb1[c],
+				fourColor ? (2 * rgb0[c] + rgb1[c] + 1) / 3 : (rgb0[c] + rgb1[c] + 1) / 2,
+				fourColor ? (rgb0[c] + 2 * rgb1[c] + 1) / 3 : 0
+			};
+
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				palette[i][c] = pSrgb ? linear[values[i]] : values[i] / 255.0f;
+			}
+		}
+
+		palette[0][3] = palette[1][3] = palette[2][3] = 1.0f;
+		palette[3][3] = fourColor ? 1.0f : 0.0f;
+
+		const auto indices = static_cast<uint32_t>(pBlock[4]) | static_cast<uint32_t>(pBlock[5]) << 8 |
+			static_cast<uint32_t>(pBlock[6]) << 16 | static_cast<uint32_t>(pBlock[7]) << 24;
+		const auto channels = pFourColorOnly ? 3 : 4;
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+#if defined(TEXTURE_SAMPLER_SSE2)
+			if (!pFourColorOnly)
+			{
+				_mm_storeu_ps(pTexels + i * 4, _mm_load_ps(palette[indices >> (i * 2) & 3]));
+				continue;
+			}
+#endif
+			memcpy(pTexels + i * 4, palette[indices >> (i * 2) & 3], sizeof(float) * channels);
+		}
+	}
+
+	// A BC4 UNORM block into one channel of 16 texels, rounded as BlockCompressor decodes it
+	void DecodeChannel(const uint8_t * pBlock, const uint32_t pChannel, float * pTexels)
+	{
+		const uint32_t alpha0 = pBlock[0];
+		const uint32_t alpha1 = pBlock[1];
+
+		float palette[8] = { alpha0 / 255.0f, alpha1 / 255.0f };
+
+		if (alpha0 > alpha1)
+		{
+			for (uint32_t i = 1; i < 7; i++)
+			{
+				palette[i + 1] = (((7 - i) * alpha0 + i * alpha1 + 3) / 7) / 255.0f;
+			}
+		}
+		else
+		{
+			for (uint32_t i = 1; i < 5; i++)
+			{
+				palette[i + 1] = (((5 - i) * alpha0 + i * alpha1 + 2) / 5) / 255.0f;
+			}
+
+			palette[6] = 0.0f;
+			palette[7] = 1.0f;
+		}
+
+		uint64_t indices = 0;
+
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			indices |= static_cast<uint64_t>(pBlock[2 + i]) << (8 * i);
+		}
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			pTexels[i * 4 + pChannel] = palette[(indices >> (3 * i)) & 7];
+		}
+	}
+
+	// A BC4 SNORM block into one channel of 16 texels
+	void DecodeSignedChannel(const uint8_t * pBlock, const uint32_t pChannel, float * pTexels)
+	{
+		const auto r0 = static_cast<int8_t>(pBlock[0]);
+		const auto r1 = static_cast<int8_t>(pBlock[1]);
+
+		//-128 and -127 both mean -1
+		const auto e0 = std::max(r0 / 127.0f, -1.0f);
+		const auto e1 = std::max(r1 / 127.0f, -1.0f);
+
+		float palette[8] = { e0, e1 };
+
+		if (r0 > r1)
+		{
+			for (auto i = 1; i < 7; i++)
+			{
+				palette[i + 1] = (e0 * (7 - i) + e1 * i) / 7.0f;
+			}
+		}
+		else
+		{
+			for (auto i = 1; i < 5; i++)
+			{
+				palette[i + 1] = (e0 * (5 - i) + e1 * i) / 5.0f;
+			}
+
+			palette[6] = -1.0f;
+			palette[7] = 1.0f;
+		}
+
+		uint64_t indices = 0;
+
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			indices |= static_cast<uint64_t>(pBlock[2 + i]) << (8 * i);
+		}
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			pTexels[i * 4 + pChannel] = palette[(indices >> (3 * i)) & 7];
+		}
+	}
+
+	float HalfToFloat(const uint16_t pHalf)
+	{
+		const auto sign = (pHalf >> 15) ? -1.0f : 1.0f;
+		const auto exponent = (pHalf >> 10) & 31;
+		const auto mantissa = pHalf & 1023;
+
+		if (exponent == 0)
+		{
+			return sign * std::ldexp(static_cast<float>(mantissa), -24);
+		}
+
+		if (exponent == 31)
+		{
+			return mantissa ? NAN : sign * INFINITY;
+		}
+
+		return sign * std::ldexp(static_cast<float>(mantissa + 1024), exponent - 25);
+	}
+
+	template <class T>
+	T ReadValue(const uint8_t * pData, const uint32_t pIndex)
+	{
+		T value;
+		memcpy(&value, pData + pIndex * sizeof(T), sizeof(T));
+		return value;
+	}
+
+	// One texel of an uncompressed format, missing channels filled as Direct3D fills them
+	void ReadTexel(const DdsFormat pFormat, const uint8_t * pTexel, float * pColor)
+	{
+		pColor[0] = pColor[1] = pColor[2] = 0.0f;
+		pColor[3] = 1.0f;
+
+		switch (pFormat)
+		{
+		case DdsFormat::R8G8B8A8_UNORM:
+		case DdsFormat::R8G8B8A8_UNORM_SRGB:
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				pColor[c] = pTexel[c] / 255.0f;
+			}
+			break;
+
+		case DdsFormat::B8G8R8A8_UNORM:
+		case DdsFormat::B8G8R8A8_UNORM_SRGB:
+		case DdsFormat::B8G8R8X8_UNORM:
+		case DdsFormat::B8G8R8X8_UNORM_SRGB:
+			pColor[0] = pTexel[2] / 255.0f;
+			pColor[1] = pTexel[1] / 255.0f;
+			pColor[2] = pTexel[0] / 255.0f;
+			pColor[3] = pFormat == DdsFormat::B8G8R8A8_UNORM || pFormat == DdsFormat::B8G8R8A8_UNORM_SRGB ? pTexel[3] / 255.0f : 1.0f;
+			break;
+
+		case DdsFormat::R8G8_UNORM:
+			pColor[1] = pTexel[1] / 255.0f;
+			pColor[0] = pTexel[0] / 255.0f;
+			break;
+
+		case DdsFormat::R8_UNORM:
+			pColor[0] = pTexel[0] / 255.0f;
+			break;
+
+		case DdsFormat::A8_UNORM:
+			pColor[3] = pTexel[0] / 255.0f;
+			break;
+
+		case DdsFormat::R16G16B16A16_UNORM:
+			pColor[3] = ReadValue<uint16_t>(pTexel, 3) / 65535.0f;
+			pColor[2] = ReadValue<uint16_t>(pTexel, 2) / 65535.0f;
+			[[fallthrough]];
+		case DdsFormat::R16G16_UNORM:
+			pColor[1] = ReadValue<uint16_t>(pTexel, 1) / 65535.0f;
+			pColor[0] = ReadValue<uint16_t>(pTexel, 0) / 65535.0f;
+			break;
+
+		case DdsFormat::R16_UNORM:
+			pColor[0] = ReadValue<uint16_t>(pTexel, 0) / 65535.0f;
+			break;
+
+		case DdsFormat::R16G16B16A16_FLOAT:
+			pColor[3] = HalfToFloat(ReadValue<uint16_t>(pTexel, 3));
+			pColor[2] = HalfToFloat(ReadValue<uint16_t>(pTexel, 2));
+			[[fallthrough]];
+		case DdsFormat::R16G16_FLOAT:
+			pColor[1] = HalfToFloat(ReadValue<uint16_t>(pTexel, 1));
+			[[fallthrough]];
+		case DdsFormat::R16_FLOAT:
+			pColor[0] = HalfToFloat(ReadValue<uint16_t>(pTexel, 0));
+			break;
+
+		case DdsFormat::R32G32B32A32_FLOAT:
+			pColor[3] = ReadValue<float>(pTexel, 3);
+			[[fallthrough]];
+		case DdsFormat::R32G32B32_FLOAT:
+			pColor[2] = ReadValue<float>(pTexel, 2);
+			[[fallthrough]];
+		case DdsFormat::R32G32_FLOAT:
+			pColor[1] = ReadValue<float>(pTexel, 1);
+			[[fallthrough]];
+		case DdsFormat::R32_FLOAT:
+			pColor[0] = ReadValue<float>(pTexel, 0);
+			break;
+
+		case DdsFormat::R10G10B10A2_UNORM:
+		{
+			const auto value = ReadValue<uint32_t>(pTexel, 0);
+			pColor[0] = (value & 1023) / 1023.0f;
+			pColor[1] = ((value >> 10) & 1023) / 1023.0f;
+			pColor[2] = ((value >> 20) & 1023) / 1023.0f;
+			pColor[3] = (value >> 30) / 3.0f;
+			break;
+		}
+
+		case DdsFormat::B5G6R5_UNORM:
+		{
+			const auto value = ReadValue<uint16_t>(pTexel, 0);
+			pColor[0] = (value >> 11) / 31.0f;
+			pColor[1] = ((value >> 5) & 63) / 63.0f;
+			pColor[2] = (value & 31) / 31.0f;
+			break;
+		}
+
+		case DdsFormat::B5G5R5A1_UNORM:
+		{
+			const auto value = ReadValue<uint16_t>(pTexel, 0);
+			pColor[0] = ((value >> 10) & 31) / 31.0f;
+			pColor[1] = ((value >> 5) & 31) / 31.0f;
+			pColor[2] = (value & 31) / 31.0f;
+			pColor[3] = static_cast<float>(value >> 15);
+			break;
+		}
+
+		default:
+			break;
+		}
+
+		if (pFormat == DdsFormat::R8G8B8A8_UNORM_SRGB || pFormat == DdsFormat::B8G8R8A8_UNORM_SRGB || pFormat == DdsFormat::B8G8R8X8_UNORM_SRGB)
+		{
+			const auto linear = SrgbToLinear();
+
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				pColor[c] = linear[static_cast<uint32_t>(pColor[c] * 255.0f + 0.5f)];
+			}
+		}
+	}
+
+	class BlockCache
+	{
+		const uint8_t * mBlocks[CacheBlocks] = {};
+		uint32_t mSerials[CacheBlocks] = {};
+		uint32_t mStamps[CacheBlocks] = {};
+		std::unique_ptr<DecodedBlock[]> mDecoded;
+		uint32_t mClock = 0;
+
+		//Neighbouring taps mostly land in the block the last one did
+		const uint8_t * mLastBlock = nullptr;
+		uint32_t mLastSerial = 0;
+		const float * mLastTexels = nullptr;
+
+	public:
+		BlockCacheStats stats;
+
+		BlockCache() : mDecoded(new DecodedBlock[CacheBlocks])
+		{
+		}
+
+		void Reset()
+		{
+			std::fill(mBlocks, mBlocks + CacheBlocks, nullptr);
+			std::fill(mStamps, mStamps + CacheBlocks, 0u);
+			mLastBlock = nullptr;
+			mLastTexels = nullptr;
+			stats = BlockCacheStats();
+		}
+
+		// The 16 texels of the block at pBlock, decoded on a miss over the least recently used way
+		const float * Find(const uint32_t pSerial, const uint8_t * pBlock, const DdsFormat pFormat)
+		{
+			if (pBlock == mLastBlock && pSerial == mLastSerial)
+			{
+				stats.hits++;
+				return mLastTexels;
+			}
+
+			//Blocks sit 8 or 16 bytes apart, so the address is shifted and mixed before picking a set
+			const auto key = (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pBlock)) >> 3) ^ (static_cast<uint64_t>(pSerial) << 40);
+			const auto set = static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - CacheSetBits)) * CacheWays;
+
+			auto way = set;
+
+			for (auto i = set; i < set + CacheWays; i++)
+			{
+				if (mBlocks[i] == pBlock && mSerials[i] == pSerial)
+				{
+					stats.hits++;
+					way = i;
+					break;
+				}
+
+				if (mStamps[i] < mStamps[way])
+				{
+					way = i;
+				}
+			}
+
+			if (mBlocks[way] != pBlock || mSerials[way] != pSerial)
+			{
+				stats.misses++;
+				DecodeBlock(pFormat, pBlock, mDecoded[way].texels);
+				mBlocks[way] = pBlock;
+				mSerials[way] = pSerial;
+			}
+
+			mStamps[way] = ++mClock;
+			mLastBlock = pBlock;
+			mLastSerial = pSerial;
+			mLastTexels = mDecoded[way].texels;
+
+			return mLastTexels;
+		}
+	};
+
+	BlockCache & ThreadCache()
+	{
+		thread_local std::unique_ptr<BlockCache> cache;
+
+		if (!cache)
+		{
+			cache = std::make_unique<BlockCache>();
+		}
+
+		return *cache;
+	}
+
+	// pCoordinate is within a texture's size of the texture, as Reduce leaves it
+	int Address(const int pCoordinate, const int pSize, const SampleAddress pAddress)
+	{
+		if (pAddress == SampleAddress::Clamp)
+		{
+			return std::min(std::max(pCoordinate, 0), pSize - 1);
+		}
+
+		return pCoordinate < 0 ? pCoordinate + pSize : pCoordinate >= pSize ? pCoordinate - pSize : pCoordinate;
+	}
+
+	// Keeps a coordinate in a range its texel index cannot overflow in, NaN going to 0
+	float Reduce(const float pCoordinate, const SampleAddress pAddress)
+	{
+		if (!(pCoordinate == pCoordinate))
+		{
+			return 0.0f;
+		}
+
+		return pAddress == SampleAddress::Wrap ? pCoordinate - std::floor(pCoordinate) : std::min(std::max(pCoordinate, -1.0f), 2.0f);
+	}
+
+	void Lerp(const float * pA, const float * pB, const float pT, float * pResult)
+	{
+#if defined(TEXTURE_SAMPLER_SSE2)
+		const auto a = _mm_loadu_ps(pA);
+		_mm_storeu_ps(pResult, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pB), a), _mm_set1_ps(pT))));
+#else
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			pResult[c] = pA[c] + (pB[c] - pA[c]) * pT;
+		}
+#endif
+	}
+}
+
+bool Advanced_Rendering::CanSample(const DdsFormat pFormat)
+{
+	switch (pFormat)
+	{
+	case DdsFormat::BC1_UNORM:
+	case DdsFormat::BC1_UNORM_SRGB:
+	case DdsFormat::BC2_UNORM:
+	case DdsFormat::BC2_UNORM_SRGB:
+	case DdsFormat::BC3_UNORM:
+	case DdsFormat::BC3_UNORM_SRGB:
+	case DdsFormat::BC4_UNORM:
+	case DdsFormat::BC4_SNORM:
+	case DdsFormat::BC5_UNORM:
+	case DdsFormat::BC5_SNORM:
+	case DdsFormat::R8G8B8A8_UNORM:
+	case DdsFormat::R8G8B8A8_UNORM_SRGB:
+	case DdsFormat::B8G8R8A8_UNORM:
+	case DdsFormat::B8G8R8A8_UNORM_SRGB:
+	case DdsFormat::B8G8R8X8_UNORM:
+	case DdsFormat::B8G8R8X8_UNORM_SRGB:
+	case DdsFormat::R8G8_UNORM:
+	case DdsFormat::R8_UNORM:
+	case DdsFormat::A8_UNORM:
+	case DdsFormat::R16G16B16A16_UNORM:
+	case DdsFormat::R16G16_UNORM:
+	case DdsFormat::R16_UNORM:
+	case DdsFormat::R16G16B16A16_FLOAT:
+	case DdsFormat::R16G16_FLOAT:
+	case DdsFormat::R16_FLOAT:
+	case DdsFormat::R32G32B32A32_FLOAT:
+	case DdsFormat::R32G32B32_FLOAT:
+	case DdsFormat::R32G32_FLOAT:
+	case DdsFormat::R32_FLOAT:
+	case DdsFormat::R10G10B10A2_UNORM:
+	case DdsFormat::B5G6R5_UNORM:
+	case DdsFormat::B5G5R5A1_UNORM:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+bool Advanced_Rendering::DecodeBlock(const DdsFormat pFormat, const uint8_t * const pBlock, float * const pTexels)
+{
+	static const float opaqueBlack[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	switch (pFormat)
+	{
+	case DdsFormat::BC1_UNORM:
+	case DdsFormat::BC1_UNORM_SRGB:
+		DecodeColor(pBlock, false, pFormat == DdsFormat::BC1_UNORM_SRGB, pTexels);
+		return true;
+
+	case DdsFormat::BC2_UNORM:
+	case DdsFormat::BC2_UNORM_SRGB:
+		DecodeColor(pBlock + 8, true, pFormat == DdsFormat::BC2_UNORM_SRGB, pTexels);
+
+		//4 bits of alpha a texel
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			pTexels[i * 4 + 3] = ((pBlock[i / 2] >> (i % 2 * 4)) & 15) / 15.0f;
+		}
+		return true;
+
+	case DdsFormat::BC3_UNORM:
+	case DdsFormat::BC3_UNORM_SRGB:
+		DecodeColor(pBlock + 8, true, pFormat == DdsFormat::BC3_UNORM_SRGB, pTexels);
+		DecodeChannel(pBlock, 3, pTexels);
+		return true;
+
+	case DdsFormat::BC4_UNORM:
+	case DdsFormat::BC5_UNORM:
+		Fill(opaqueBlack, pTexels);
+		DecodeChannel(pBlock, 0, pTexels);
+
+		if (pFormat == DdsFormat::BC5_UNORM)
+		{
+			DecodeChannel(pBlock + 8, 1, pTexels);
+		}
+		return true;
+
+	case DdsFormat::BC4_SNORM:
+	case DdsFormat::BC5_SNORM:
+		Fill(opaqueBlack, pTexels);
+		DecodeSignedChannel(pBlock, 0, pTexels);
+
+		if (pFormat == DdsFormat::BC5_SNORM)
+		{
+			DecodeSignedChannel(pBlock + 8, 1, pTexels);
+		}
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+TextureSampler::TextureSampler(const DdsImage & pImage, const SamplerDesc & pDesc) :
+	mImage(&pImage),
+	mDesc(pDesc),
+	mSerial(nextSerial++),
+	mCompressed(IsBlockCompressed(pImage.format)),
+	mValid(CanSample(pImage.format) && pImage.dimension != DdsDimension::Texture3D && !pImage.surfaces.empty())
+{
+	mStride = static_cast<uint32_t>(DdsBitsPerPixel(pImage.format) * (mCompressed ? 16 : 1) / 8);
+}
+
+void TextureSampler::Fetch(const uint32_t pMip, const uint32_t pItem, const uint32_t pX, const uint32_t pY, float * const pColor) const
+{
+	if (!mValid)
+	{
+		pColor[0] = pColor[1] = pColor[2] = 0.0f;
+		pColor[3] = 1.0f;
+		return;
+	}
+
+	const auto & surface = mImage->Surface(pMip, pItem);
+
+	if (!mCompressed)
+	{
+		ReadTexel(mImage->format, surface.data + pY * surface.rowPitch + pX * mStride, pColor);
+		return;
+	}
+
+	const auto texels = ThreadCache().Find(mSerial, surface.data + (pY >> 2) * surface.rowPitch + (pX >> 2) * mStride, mImage->format);
+	memcpy(pColor, texels + ((pY & 3) * 4 + (pX & 3)) * 4, sizeof(float) * 4);
+}
+
+void TextureSampler::Bilinear(const uint32_t pMip, const uint32_t pItem, const float pU, const float pV, float * const pColor) const
+{
+	const auto & surface = mImage->Surface(pMip, pItem);
+	const auto width = static_cast<int>(surface.width);
+	const auto height = static_cast<int>(surface.height);
+
+	const auto x = Reduce(pU, mDesc.address) * width - 0.5f;
+	const auto y = Reduce(pV, mDesc.address) * height - 0.5f;
+	const auto left = std::floor(x);
+	const auto top = std::floor(y);
+
+	const auto x0 = static_cast<uint32_t>(Address(static_cast<int>(left), width, mDesc.address));
+	const auto x1 = static_cast<uint32_t>(Address(static_cast<int>(left) + 1, width, mDesc.address));
+	const auto y0 = static_cast<uint32_t>(Address(static_cast<int>(top), height, mDesc.address));
+	const auto y1 = static_cast<uint32_t>(Address(static_cast<int>(top) + 1, height, mDesc.address));
+
+	const uint32_t columns[2] = { x0, x1 };
+	const uint32_t rows[2] = { y0, y1 };
+	float texels[4][4];
+
+	if (mCompressed)
+	{
+		//One cache for the four taps, which mostly share a block
+		auto & cache = ThreadCache();
+
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			const auto column = columns[i & 1], row = rows[i >> 1];
+			const auto block = cache.Find(mSerial, surface.data + (row >> 2) * surface.rowPitch + (column >> 2) * mStride, mImage->format);
+			memcpy(texels[i], block + ((row & 3) * 4 + (column & 3)) * 4, sizeof(float) * 4);
+		}
+	}
+	else
+	{
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			ReadTexel(mImage->format, surface.data + rows[i >> 1] * surface.rowPitch + columns[i & 1] * mStride, texels[i]);
+		}
+	}
+
+	Lerp(texels[0], texels[1], x - left, texels[0]);
+	Lerp(texels[2], texels[3], x - left, texels[2]);
+	Lerp(texels[0], texels[2], y - top, pColor);
+}
+
+void TextureSampler::Sample(const float pU, const float pV, const float pLod, float * const pColor, const uint32_t pItem) const
+{
+	if (!mValid)
+	{
+		Fetch(0, 0, 0, 0, pColor);
+		return;
+	}
+
+	const auto lod = pLod == pLod ? std::min(std::max(pLod, 0.0f), static_cast<float>(mImage->mipCount - 1)) : 0.0f;
+
+	switch (mDesc.filter)
+	{
+	case SampleFilter::Point:
+	{
+		const auto mip = static_cast<uint32_t>(lod + 0.5f);
+		const auto & surface = mImage->Surface(mip, pItem);
+		const auto x = Address(static_cast<int>(std::floor(Reduce(pU, mDesc.address) * surface.width)), static_cast<int>(surface.width), mDesc.address);
+		const auto y = Address(static_cast<int>(std::floor(Reduce(pV, mDesc.address) * surface.height)), static_cast<int>(surface.height), mDesc.address);
+
+		Fetch(mip, pItem, static_cast<uint32_t>(x), static_cast<uint32_t>(y), pColor);
+		break;
+	}
+
+	case SampleFilter::Bilinear:
+		Bilinear(static_cast<uint32_t>(lod + 0.5f), pItem, pU, pV, pColor);
+		break;
+
+	default:
+	{
+		const auto mip = static_cast<uint32_t>(lod);
+		const auto blend = lod - mip;
+
+		Bilinear(mip, pItem, pU, pV, pColor);
+
+		if (blend > 0.0f && mip + 1 < mImage->mipCount)
+		{
+			float next[4];
+			Bilinear(mip + 1, pItem, pU, pV, next);
+			Lerp(pColor, next, blend, pColor);
+		}
+		break;
+	}
+	}
+}
+
+BlockCacheStats Advanced_Rendering::ThreadBlockCacheStats()
+{
+	return ThreadCache().stats;
+}
+
+void Advanced_Rendering::ResetThreadBlockCache()
+{
+	ThreadCache().Reset();
+}
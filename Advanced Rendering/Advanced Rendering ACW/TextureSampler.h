@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "DdsParser.h"
+
+namespace Advanced_Rendering
+{
+	enum class SampleFilter
+	{
+		Point,			// nearest texel of the nearest mip
+		Bilinear,		// four texels of the nearest mip
+		Trilinear		// four texels of the two mips either side of the LOD, blended
+	};
+
+	enum class SampleAddress
+	{
+		Wrap,
+		Clamp
+	};
+
+	struct SamplerDesc
+	{
+		SampleFilter filter = SampleFilter::Trilinear;
+		SampleAddress address = SampleAddress::Wrap;
+	};
+
+	struct BlockCacheStats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+	};
+
+	// True for the formats a TextureSampler can read: BC1 to BC5 and the 8, 16 and 32 bit per channel
+	// UNORM and FLOAT formats, plus R10G10B10A2, B5G6R5 and B5G5R5A1. BC6H and BC7 are not decoded.
+	bool CanSample(DdsFormat pFormat);
+
+	// Decodes one BC1 to BC5 block into 16 RGBA texels in rows, as a GPU reads them. sRGB formats
+	// are converted to linear. False for other formats.
+	bool DecodeBlock(DdsFormat pFormat, const uint8_t * pBlock, float * pTexels);
+
+	// Samples a parsed DDS image on the CPU, for rendering without a GPU. Block compressed surfaces are
+	// decoded a block at a time into a small LRU cache owned by the calling thread, so a bilinear tap
+	// that lands in a recently used block costs about as much as one into uncompressed texels.
+	// The image and the data it points into must outlive the sampler.
+	class TextureSampler
+	{
+		const DdsImage * mImage = nullptr;
+		SamplerDesc mDesc;
+		uint32_t mSerial = 0;
+		uint32_t mStride = 0;			// bytes of a block when compressed, otherwise of a texel
+		bool mCompressed = false;
+		bool mValid = false;
+
+		void Bilinear(uint32_t pMip, uint32_t pItem, float pU, float pV, float * pColor) const;
+
+	public:
+		explicit TextureSampler(const DdsImage & pImage, const SamplerDesc & pDesc = SamplerDesc());
+
+		// False for volume textures and formats CanSample rejects, which sample as opaque black
+		bool IsValid() const
+		{
+			return mValid;
+		}
+
+		// UV in texture space with texel centres at half texels, as Direct3D samples. pLod picks the
+		// mip, clamped to the chain.
+		void Sample(float pU, float pV, float pLod, float * pColor, uint32_t pItem = 0) const;
+
+		// One texel of a mip, without filtering or addressing
+		void Fetch(uint32_t pMip, uint32_t pItem, uint32_t pX, uint32_t pY, float * pColor) const;
+	};
+
+	// Hits and misses of the calling thread's block cache since it was last reset
+	BlockCacheStats ThreadBlockCacheStats();
+
+	// Empties the calling thread's block cache and zeroes its counters
+	void ResetThreadBlockCache();
+}
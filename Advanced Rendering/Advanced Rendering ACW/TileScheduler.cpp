@@ -0,0 +1,501 @@
+#include "TileScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "Parallel.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	double Nanoseconds(const Clock::time_point pStart, const Clock::time_point pEnd)
+	{
+		return std::chrono::duration<double, std::nano>(pEnd - pStart).count();
+	}
+
+	//The bits of pValue moved apart, one zero between each
+	uint64_t SpreadBits(const uint32_t pValue)
+	{
+		uint64_t bits = pValue;
+
+		bits = (bits | bits << 16) & 0x0000FFFF0000FFFFull;
+		bits = (bits | bits << 8) & 0x00FF00FF00FF00FFull;
+		bits = (bits | bits << 4) & 0x0F0F0F0F0F0F0F0Full;
+		bits = (bits | bits << 2) & 0x3333333333333333ull;
+		bits = (bits | bits << 1) & 0x5555555555555555ull;
+
+		return bits;
+	}
+
+	uint64_t MortonIndex(const uint32_t pX, const uint32_t pY)
+	{
+		return SpreadBits(pX) | SpreadBits(pY) << 1;
+	}
+
+	//Where (pX, pY) falls along the Hilbert curve over a pSide square, pSide a power of 2. Every
+	//aligned square of side 2^k covers a run of 4^k indices starting at a multiple of 4^k.
+	uint64_t HilbertIndex(const uint32_t pSide, uint32_t pX, uint32_t pY)
+	{
+		uint64_t index = 0;
+
+		for (auto half = pSide / 2; half > 0; half /= 2)
+		{
+			const uint32_t right = (pX & half) != 0 ? 1 : 0;
+			const uint32_t below = (pY & half) != 0 ? 1 : 0;
+
+			index += static_cast<uint64_t>(half) * half * ((3 * right) ^ below);
+
+			if (below == 0)
+			{
+				if (right == 1)
+				{
+					pX = pSide - 1 - pX;
+					pY = pSide - 1 - pY;
+				}
+
+				std::swap(pX, pY);
+			}
+		}
+
+		return index;
+	}
+
+	//A thread's tiles still to render, [first, end) of the curve packed in one word so the owner
+	//taking from the front and a thief taking from the back never both get a tile
+	struct alignas(64) TileRun
+	{
+		std::atomic<uint64_t> range;
+
+		static uint64_t Pack(const uint32_t pFirst, const uint32_t pEnd)
+		{
+			return static_cast<uint64_t>(pEnd) << 32 | pFirst;
+		}
+
+		bool Pop(uint32_t & pTile)
+		{
+			auto range = this->range.load();
+
+			for (;;)
+			{
+				const auto first = static_cast<uint32_t>(range);
+				const auto end = static_cast<uint32_t>(range >> 32);
+
+				if (first >= end)
+				{
+					return false;
+				}
+
+				if (this->range.compare_exchange_weak(range, Pack(first + 1, end)))
+				{
+					pTile = first;
+					return true;
+				}
+			}
+		}
+
+		uint32_t Remaining() const
+		{
+			const auto range = this->range.load();
+			const auto first = static_cast<uint32_t>(range);
+			const auto end = static_cast<uint32_t>(range >> 32);
+
+			return end > first ? end - first : 0;
+		}
+	};
+}
+
+TileScheduler::TileScheduler(const TileScheduleOptions & pOptions) : mOptions(pOptions)
+{
+	mOptions.minTileSize = std::max(mOptions.minTileSize, 1u);
+	mOptions.tilesPerThread = std::max(mOptions.tilesPerThread, 1u);
+
+	while ((mOptions.minTileSize << (mLevels + 1)) <= mOptions.maxTileSize && mLevels < 16)
+	{
+		mLevels++;
+	}
+
+	mOptions.maxTileSize = mOptions.minTileSize << mLevels;
+}
+
+void TileScheduler::Resize(const uint32_t pWidth, const uint32_t pHeight)
+{
+	if (pWidth == mWidth && pHeight == mHeight)
+	{
+		return;
+	}
+
+	mWidth = pWidth;
+	mHeight = pHeight;
+	mCellsWide = (pWidth + mOptions.minTileSize - 1) / mOptions.minTileSize;
+	mCellsHigh = (pHeight + mOptions.minTileSize - 1) / mOptions.minTileSize;
+	mCellCosts.clear();
+}
+
+uint32_t TileScheduler::ThreadCount() const
+{
+	return mOptions.threadCount != 0 ? mOptions.threadCount : WorkerCount();
+}
+
+void TileScheduler::Plan()
+{
+	struct Planned
+	{
+		uint64_t key;
+		RenderTile tile;
+		float estimate;
+	};
+
+	struct Block
+	{
+		uint32_t x;						// in cells
+		uint32_t y;
+		uint32_t level;
+	};
+
+	mTiles.clear();
+	mTileEstimates.clear();
+
+	if (mCellsWide == 0 || mCellsHigh == 0)
+	{
+		return;
+	}
+
+	const auto cellSize = mOptions.minTileSize;
+
+	//Pixels stand in for time until a run has measured some
+	auto cellCost = [&](const uint32_t pX, const uint32_t pY)
+	{
+		const auto pixels = static_cast<float>(std::min(cellSize, mWidth - pX * cellSize) * std::min(cellSize, mHeight - pY * cellSize));
+		return mCellCosts.empty() ? pixels : pixels * mCellCosts[pY * mCellsWide + pX];
+	};
+
+	auto blockCost = [&](const Block & pBlock)
+	{
+		const auto side = 1u << pBlock.level;
+		auto cost = 0.0f;
+
+		for (auto y = pBlock.y; y < std::min(pBlock.y + side, mCellsHigh); y++)
+		{
+			for (auto x = pBlock.x; x < std::min(pBlock.x + side, mCellsWide); x++)
+			{
+				cost += cellCost(x, y);
+			}
+		}
+
+		return cost;
+	};
+
+	auto total = 0.0f;
+
+	for (uint32_t y = 0; y < mCellsHigh; y++)
+	{
+		for (uint32_t x = 0; x < mCellsWide; x++)
+		{
+			total += cellCost(x, y);
+		}
+	}
+
+	const auto target = total / (static_cast<float>(ThreadCount()) * mOptions.tilesPerThread);
+
+	uint32_t curveSide = 1;
+
+	while (curveSide < std::max(mCellsWide, mCellsHigh))
+	{
+		curveSide *= 2;
+	}
+
+	std::vector<Planned> planned;
+	std::vector<Block> blocks;
+	const auto rootSide = 1u << mLevels;
+
+	for (uint32_t y = 0; y < mCellsHigh; y += rootSide)
+	{
+		for (uint32_t x = 0; x < mCellsWide; x += rootSide)
+		{
+			blocks.push_back({ x, y, mLevels });
+		}
+	}
+
+	while (!blocks.empty())
+	{
+		const auto block = blocks.back();
+		blocks.pop_back();
+
+		if (block.x >= mCellsWide || block.y >= mCellsHigh)
+		{
+			continue;
+		}
+
+		const auto estimate = blockCost(block);
+
+		if (block.level > 0 && estimate > target)
+		{
+			const auto half = 1u << (block.level - 1);
+
+			blocks.push_back({ block.x, block.y, block.level - 1 });
+			blocks.push_back({ block.x + half, block.y, block.level - 1 });
+			blocks.push_back({ block.x, block.y + half, block.level - 1 });
+			blocks.push_back({ block.x + half, block.y + half, block.level - 1 });
+			continue;
+		}
+
+		const auto tileSize = cellSize << block.level;
+		const auto x = block.x * cellSize;
+		const auto y = block.y * cellSize;
+		const RenderTile tile = { x, y, std::min(tileSize, mWidth - x), std::min(tileSize, mHeight - y) };
+
+		//Blocks are aligned to their size, so clearing the low bits of any cell's index gives the
+		//block's first place on the curve
+		uint64_t key;
+
+		switch (mOptions.order)
+		{
+		case TileOrder::Rows:
+			key = static_cast<uint64_t>(block.y) << 32 | block.x;
+			break;
+		case TileOrder::Morton:
+			key = MortonIndex(block.x, block.y) >> (2 * block.level) << (2 * block.level);
+			break;
+		default:
+			key = HilbertIndex(curveSide, block.x, block.y) >> (2 * block.level) << (2 * block.level);
+			break;
+		}
+
+		planned.push_back({ key, tile, estimate });
+	}
+
+	std::sort(planned.begin(), planned.end(), [](const Planned & pA, const Planned & pB)
+	{
+		return pA.key < pB.key;
+	});
+
+	mTiles.reserve(planned.size());
+	mTileEstimates.reserve(planned.size());
+
+	for (const auto & tile : planned)
+	{
+		mTiles.push_back(tile.tile);
+		mTileEstimates.push_back(tile.estimate);
+	}
+}
+
+const TileScheduleStats & TileScheduler::Run(const std::function<void(const RenderTile & pTile, uint32_t pThread)> & pRender)
+{
+	const auto start = Clock::now();
+
+	Plan();
+
+	const auto tileCount = static_cast<uint32_t>(mTiles.size());
+	const auto threadCount = std::max(1u, std::min(ThreadCount(), tileCount));
+
+	mTileCosts.assign(tileCount, 0.0f);
+
+	std::vector<double> busy(threadCount, 0.0);
+	std::vector<TileRun> runs(threadCount);
+	std::atomic<uint32_t> next(0);
+	std::atomic<uint32_t> steals(0);
+
+	//Each thread's run of the curve is about as costly as the others'
+	auto total = 0.0;
+
+	for (const auto estimate : mTileEstimates)
+	{
+		total += estimate;
+	}
+
+	auto prefix = 0.0;
+	uint32_t first = 0;
+
+	for (uint32_t thread = 0; thread < threadCount; thread++)
+	{
+		auto end = first;
+
+		while (end < tileCount && (thread + 1 == threadCount || prefix + mTileEstimates[end] * 0.5 < total * (thread + 1) / threadCount))
+		{
+			prefix += mTileEstimates[end++];
+		}
+
+		runs[thread].range.store(TileRun::Pack(first, end));
+		first = end;
+	}
+
+	auto render = [&](const uint32_t pTile, const uint32_t pThread)
+	{
+		const auto tileStart = Clock::now();
+		pRender(mTiles[pTile], pThread);
+		const auto time = Nanoseconds(tileStart, Clock::now());
+
+		mTileCosts[pTile] = static_cast<float>(time);
+		busy[pThread] += time;
+	};
+
+	//Half of the fullest other run, from its far end, leaving the owner the tiles next to those it has done
+	auto steal = [&](const uint32_t pThread, uint32_t & pTile)
+	{
+		for (;;)
+		{
+			uint32_t victim = 0, most = 0;
+
+			for (uint32_t thread = 0; thread < threadCount; thread++)
+			{
+				const auto remaining = thread == pThread ? 0 : runs[thread].Remaining();
+
+				if (remaining > most)
+				{
+					victim = thread;
+					most = remaining;
+				}
+			}
+
+			if (most == 0)
+			{
+				return false;
+			}
+
+			auto range = runs[victim].range.load();
+			const auto victimFirst = static_cast<uint32_t>(range);
+			const auto victimEnd = static_cast<uint32_t>(range >> 32);
+
+			if (victimFirst >= victimEnd)
+			{
+				continue;
+			}
+
+			const auto split = victimEnd - (victimEnd - victimFirst + 1) / 2;
+
+			if (runs[victim].range.compare_exchange_strong(range, TileRun::Pack(victimFirst, split)))
+			{
+				runs[pThread].range.store(TileRun::Pack(split + 1, victimEnd));
+				pTile = split;
+				steals++;
+				return true;
+			}
+		}
+	};
+
+	auto worker = [&](const uint32_t pThread)
+	{
+		uint32_t tile;
+
+		if (!mOptions.stealing)
+		{
+			for (tile = next++; tile < tileCount; tile = next++)
+			{
+				render(tile, pThread);
+			}
+
+			return;
+		}
+
+		while (runs[pThread].Pop(tile) || steal(pThread, tile))
+		{
+			render(tile, pThread);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+
+	for (uint32_t thread = 1; thread < threadCount; thread++)
+	{
+		threads.emplace_back(worker, thread);
+	}
+
+	worker(0);
+
+	for (auto & thread : threads)
+	{
+		thread.join();
+	}
+
+	//A running average over the runs, so one slow tile does not swing the next split
+	const auto firstRun = mCellCosts.empty();
+	mCellCosts.resize(static_cast<size_t>(mCellsWide) * mCellsHigh, 0.0f);
+
+	for (uint32_t i = 0; i < tileCount; i++)
+	{
+		const auto & tile = mTiles[i];
+		const auto perPixel = mTileCosts[i] / (tile.width * tile.height);
+		const auto cellSize = mOptions.minTileSize;
+
+		for (auto y = tile.y / cellSize; y < (tile.y + tile.height + cellSize - 1) / cellSize; y++)
+		{
+			for (auto x = tile.x / cellSize; x < (tile.x + tile.width + cellSize - 1) / cellSize; x++)
+			{
+				auto & cost = mCellCosts[y * mCellsWide + x];
+				cost = firstRun ? perPixel : 0.5f * (cost + perPixel);
+			}
+		}
+	}
+
+	mStats = TileScheduleStats();
+	mStats.tiles = tileCount;
+	mStats.steals = steals;
+	mStats.milliseconds = Nanoseconds(start, Clock::now()) * 1e-6;
+
+	for (const auto time : busy)
+	{
+		mStats.busiestMilliseconds = std::max(mStats.busiestMilliseconds, time * 1e-6);
+		mStats.meanBusyMilliseconds += time * 1e-6 / threadCount;
+	}
+
+	return mStats;
+}
+
+void TileScheduler::Heatmap(std::vector<float> & pTexels, const bool pOutlineTiles) const
+{
+	pTexels.assign(static_cast<size_t>(mWidth) * mHeight * 4, 0.0f);
+
+	if (mCellCosts.empty())
+	{
+		return;
+	}
+
+	const auto most = std::max(*std::max_element(mCellCosts.begin(), mCellCosts.end()), 1e-6f);
+
+	for (uint32_t y = 0; y < mHeight; y++)
+	{
+		for (uint32_t x = 0; x < mWidth; x++)
+		{
+			const auto heat = mCellCosts[y / mOptions.minTileSize * mCellsWide + x / mOptions.minTileSize] / most * 3.0f;
+			auto texel = &pTexels[(static_cast<size_t>(y) * mWidth + x) * 4];
+
+			texel[0] = std::min(std::max(heat, 0.0f), 1.0f);
+			texel[1] = std::min(std::max(heat - 1.0f, 0.0f), 1.0f);
+			texel[2] = std::min(std::max(heat - 2.0f, 0.0f), 1.0f);
+			texel[3] = 1.0f;
+		}
+	}
+
+	if (!pOutlineTiles)
+	{
+		return;
+	}
+
+	auto darken = [&](const uint32_t pX, const uint32_t pY)
+	{
+		auto texel = &pTexels[(static_cast<size_t>(pY) * mWidth + pX) * 4];
+
+		for (auto c = 0; c < 3; c++)
+		{
+			texel[c] = texel[c] * 0.5f + 0.1f;
+		}
+	};
+
+	for (const auto & tile : mTiles)
+	{
+		for (auto x = tile.x; x < tile.x + tile.width; x++)
+		{
+			darken(x, tile.y);
+		}
+
+		for (auto y = tile.y + 1; y < tile.y + tile.height; y++)
+		{
+			darken(tile.x, y);
+		}
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Advanced_Rendering
+{
+	enum class TileOrder
+	{
+		Rows,			// left to right, top to bottom
+		Morton,
+		Hilbert			// never jumps between tiles that do not touch
+	};
+
+	struct RenderTile
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	struct TileScheduleOptions
+	{
+		TileOrder order = TileOrder::Hilbert;
+		uint32_t minTileSize = 8;		// pixels a side of the smallest tile, and of the cells costs are kept for
+		uint32_t maxTileSize = 64;		// rounded down to minTileSize times a power of 2, equal to it for fixed tiles
+		uint32_t tilesPerThread = 8;	// tiles of even cost a thread is meant to get, setting how far costly tiles split
+		bool stealing = true;			// each thread starts on its own run of the curve and steals from the others when
+										// done, rather than all taking the next tile from one queue
+		uint32_t threadCount = 0;		// 0 for every hardware thread
+	};
+
+	struct TileScheduleStats
+	{
+		uint32_t tiles = 0;
+		uint32_t steals = 0;
+		double milliseconds = 0.0;
+		double busiestMilliseconds = 0.0;	// the most any thread spent in tiles
+		double meanBusyMilliseconds = 0.0;
+	};
+
+	// Hands the tiles of an image to threads in the order of a space filling curve, so the tiles a
+	// thread renders one after another, and those neighbouring threads render at once, lie close
+	// together and share what they bring into cache. Each tile is timed, and the time of every
+	// minTileSize cell of the image kept as a running average, so the next run splits tiles that
+	// cost much more than the rest, such as the ray marcher's terrain against its sky, into
+	// quarters down to minTileSize, and leaves cheap ones whole up to maxTileSize. Quarters keep
+	// their place on the curve. The first run, having no times, splits by pixel count.
+	class TileScheduler
+	{
+		TileScheduleOptions mOptions;
+		uint32_t mWidth = 0;
+		uint32_t mHeight = 0;
+		uint32_t mLevels = 0;					// tile sizes above minTileSize, each twice the last
+		uint32_t mCellsWide = 0;
+		uint32_t mCellsHigh = 0;
+		std::vector<float> mCellCosts;			// nanoseconds a pixel, empty before the first run
+		std::vector<RenderTile> mTiles;			// of the last run, in curve order
+		std::vector<float> mTileEstimates;		// what each was expected to cost, in any unit
+		std::vector<float> mTileCosts;			// nanoseconds each took
+		TileScheduleStats mStats;
+
+		void Plan();
+
+	public:
+		TileScheduler(const TileScheduleOptions & pOptions = TileScheduleOptions());
+		~TileScheduler() = default;
+
+		TileScheduler(const TileScheduler &) = delete;
+		TileScheduler(TileScheduler &&) = delete;
+		TileScheduler & operator= (const TileScheduler &) = delete;
+		TileScheduler & operator= (TileScheduler &&) = delete;
+
+		// Forgets the times when the size changes
+		void Resize(uint32_t pWidth, uint32_t pHeight);
+
+		// Calls pRender on every tile of the image once, pThread being the number of the thread below
+		// ThreadCount calling it
+		const TileScheduleStats & Run(const std::function<void(const RenderTile & pTile, uint32_t pThread)> & pRender);
+
+		uint32_t ThreadCount() const;
+
+		// The last run's cost of each pixel as R32G32B32A32_FLOAT texels, row by row from the top,
+		// black through red and yellow to white at the costliest cell. With pOutlineTiles the top and
+		// left edges of each tile are darkened.
+		void Heatmap(std::vector<float> & pTexels, bool pOutlineTiles) const;
+
+		const std::vector<RenderTile> & Tiles() const
+		{
+			return mTiles;
+		}
+
+		const std::vector<float> & TileCosts() const
+		{
+			return mTileCosts;
+		}
+
+		const std::vector<float> & CellCosts() const
+		{
+			return mCellCosts;
+		}
+
+		uint32_t CellsWide() const
+		{
+			return mCellsWide;
+		}
+
+		uint32_t CellsHigh() const
+		{
+			return mCellsHigh;
+		}
+
+		const TileScheduleStats & Stats() const
+		{
+			return mStats;
+		}
+	};
+}
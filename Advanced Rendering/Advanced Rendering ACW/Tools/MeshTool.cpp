@@ -0,0 +1,1115 @@
+// Offline mesh tool, built outside the app from the portable mesh sources:
+//
+//   g++ -std=c++17 -O2 -pthread -I.. MeshTool.cpp ../AssetCache.cpp ../MappedFile.cpp ../MeshCooker.cpp ../MeshFile.cpp ../MeshletBuilder.cpp ../MeshOptimizer.cpp ../MeshSimplifier.cpp ../SimParser.cpp ../VertexQuantizer.cpp -o MeshTool
+//
+//   MeshTool convert <input.sim> [output.simb]   Optimise a text .sim file and write it in the binary .simb format
+//   MeshTool optimize <file.sim>...              Vertex cache ACMR/ATVR before and after optimisation
+//   MeshTool quantize [file.sim]...              SSE2 against scalar and the error against its bounds for a generated mesh and
+//                                                each tangent-layout file (others are skipped), then quantised stream size, speed and error
+//   MeshTool lod <file.sim>...                   Triangles, error and build time of each simplified level
+//   MeshTool cull <file.sim> [views] [padding]   Meshlet frustum and cone culling along a camera path past the rocks
+//   MeshTool bench <input.sim> [iterations]      Time the text loader and optimiser against the mapped binary loader
+//   MeshTool parse [file.sim|file.cur]...        Texts the parsers must accept or reject, then each file's parser throughput
+//                                                in MB/s against a stream reference
+//   MeshTool cache <dir> <file.sim|file.cur>...  Uncached, cold and warm loads through a cooked cache in dir, as the app cooks them
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "AssetCache.h"
+#include "MeshCooker.h"
+#include "MeshFile.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "SimParser.h"
+#include "VertexQuantizer.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	double Milliseconds(const Clock::time_point pStart)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - pStart).count();
+	}
+
+	// Touches every byte of the view so the mapped path pays for its page faults like the
+	// text path pays for its reads.
+	uint32_t Checksum(const MeshView & pMesh)
+	{
+		uint32_t sum = 0;
+
+		for (uint32_t i = 0; i < MeshStreamCount; i++)
+		{
+			if (!pMesh.streams[i])
+			{
+				continue;
+			}
+
+			const auto words = reinterpret_cast<const uint32_t *>(pMesh.streams[i]);
+			const auto count = pMesh.vertexCount * MeshStreamComponents[i];
+
+			for (uint32_t j = 0; j < count; j++)
+			{
+				sum += words[j];
+			}
+		}
+
+		for (uint32_t i = 0; i < pMesh.indexCount; i++)
+		{
+			sum += pMesh.indices[i];
+		}
+
+		return sum;
+	}
+
+	bool IsCurve(const std::string & pFilename)
+	{
+		return pFilename.size() > 4 && pFilename.compare(pFilename.size() - 4, 4, ".cur") == 0;
+	}
+
+	// The one token at a time std::ifstream loader the models used before SimParser, kept as
+	// the reference for correctness and speed.
+	bool StreamParse(const std::string & pFilename, MeshBuffer & pMesh)
+	{
+		std::ifstream myfile(pFilename);
+
+		uint32_t size;
+		myfile >> size;
+
+		pMesh = MeshBuffer();
+
+		if (IsCurve(pFilename))
+		{
+			pMesh.vertexCount = size * 4;
+
+			auto & positions = pMesh.Stream(MeshStream::Position);
+			auto & biTangents = pMesh.Stream(MeshStream::BiTangent);
+			positions.resize(pMesh.vertexCount * 3);
+			biTangents.resize(pMesh.vertexCount * 3);
+			pMesh.indices.resize(pMesh.vertexCount);
+
+			for (uint32_t i = 0; i < pMesh.vertexCount; i++)
+			{
+				myfile >> positions[i * 3] >> positions[i * 3 + 1] >> positions[i * 3 + 2];
+				myfile >> biTangents[i * 3] >> biTangents[i * 3 + 1] >> biTangents[i * 3 + 2];
+				pMesh.indices[i] = i;
+			}
+
+			return static_cast<bool>(myfile);
+		}
+
+		SimLayout layout;
+		if (!DetectSimLayout(pFilename, layout))
+		{
+			return false;
+		}
+
+		const uint32_t streams[] = { 0, 2, 1, 3, 4 };
+		const auto streamCount = layout == SimLayout::Tangent ? 5u : 3u;
+
+		pMesh.vertexCount = size;
+
+		for (uint32_t i = 0; i < streamCount; i++)
+		{
+			pMesh.streams[streams[i]].resize(size * MeshStreamComponents[streams[i]]);
+		}
+
+		for (uint32_t i = 0; i < size; i++)
+		{
+			for (uint32_t j = 0; j < streamCount; j++)
+			{
+				const auto components = MeshStreamComponents[streams[j]];
+
+				for (uint32_t k = 0; k < components; k++)
+				{
+					myfile >> pMesh.streams[streams[j]][i * components + k];
+				}
+			}
+		}
+
+		myfile >> size;
+		pMesh.indices.resize(size);
+
+		for (uint32_t i = 0; i < size; i++)
+		{
+			myfile >> pMesh.indices[i];
+		}
+
+		return static_cast<bool>(myfile);
+	}
+
+	bool Same(const MeshBuffer & pLeft, const MeshBuffer & pRight)
+	{
+		if (pLeft.vertexCount != pRight.vertexCount || pLeft.indices != pRight.indices)
+		{
+			return false;
+		}
+
+		for (uint32_t i = 0; i < MeshStreamCount; i++)
+		{
+			if (pLeft.streams[i].size() != pRight.streams[i].size() ||
+				(!pLeft.streams[i].empty() && memcmp(pLeft.streams[i].data(), pRight.streams[i].data(), pLeft.streams[i].size() * sizeof(float)) != 0))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Parses pText and checks the outcome against pValid. Valid texts are also checked against
+	// pExpected when given.
+	bool ParseCase(const char * pName, const std::string & pText, const bool pCurve, const bool pValid, const MeshBuffer * pExpected = nullptr)
+	{
+		const auto begin = pText.data();
+		const auto end = begin + pText.size();
+
+		MeshBuffer mesh;
+		SimLayout layout = SimLayout::Basic;
+		auto valid = pCurve ? ParseCurveText(begin, end, mesh) : DetectSimLayout(begin, end, layout) && ParseSimText(begin, end, layout, mesh);
+
+		if (valid && pExpected && !Same(mesh, *pExpected))
+		{
+			fprintf(stderr, "  %s: parsed but differs from the expected mesh\n", pName);
+			return false;
+		}
+
+		if (valid != pValid)
+		{
+			fprintf(stderr, "  %s: %s\n", pName, pValid ? "rejected" : "accepted");
+			return false;
+		}
+
+		return true;
+	}
+
+	// A basic layout .sim of pVertexCount vertices and pTriangles triangles, with values of
+	// varying length so the chunk splits land all over the lines, and the mesh it holds
+	std::string MakeSimText(const uint32_t pVertexCount, const uint32_t pTriangles, const char * pNewline, MeshBuffer & pMesh)
+	{
+		pMesh = MeshBuffer();
+		pMesh.vertexCount = pVertexCount;
+
+		auto & positions = pMesh.Stream(MeshStream::Position);
+		auto & texCoords = pMesh.Stream(MeshStream::TexCoord);
+		auto & normals = pMesh.Stream(MeshStream::Normal);
+
+		std::string text = std::to_string(pVertexCount) + pNewline;
+		char value[32];
+
+		auto field = [&](std::vector<float> & pStream, const uint32_t pIndex)
+		{
+			//Short decimals parse exactly, as the shipped assets' do
+			const auto scaled = static_cast<int>((pIndex * 7919u) % 200001u) - 100000;
+			snprintf(value, sizeof value, "%.*f ", static_cast<int>(pIndex % 5), scaled / 1000.0);
+			pStream.push_back(strtof(value, nullptr));
+			text += value;
+		};
+
+		for (uint32_t v = 0; v < pVertexCount; v++)
+		{
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				field(positions, v * 8 + c);
+			}
+
+			for (uint32_t c = 0; c < 2; c++)
+			{
+				field(texCoords, v * 8 + 3 + c);
+			}
+
+			for (uint32_t c = 0; c < 3; c++)
+			{
+				field(normals, v * 8 + 5 + c);
+			}
+
+			text += pNewline;
+		}
+
+		text += std::to_string(pTriangles * 3) + pNewline;
+
+		for (uint32_t i = 0; i < pTriangles * 3; i++)
+		{
+			pMesh.indices.push_back(i * 31 % pVertexCount);
+			text += std::to_string(pMesh.indices.back()) + (i % 3 == 2 ? pNewline : " ");
+		}
+
+		return text;
+	}
+
+	// Texts the parsers must accept or reject, exiting non-zero on any that do otherwise
+	int ParseCases()
+	{
+		auto failures = 0;
+
+		auto check = [&](const char * pName, const std::string & pText, const bool pCurve, const bool pValid, const MeshBuffer * pExpected = nullptr)
+		{
+			failures += ParseCase(pName, pText, pCurve, pValid, pExpected) ? 0 : 1;
+		};
+
+		const std::string vertices = "3\n0 0 0 0 0 0 0 1\n1 0 0 1 0 0 0 1\n0 1 0 0 1 0 0 1\n";
+		const auto basic = vertices + "3\n0 1 2\n";
+
+		MeshBuffer triangle;
+		check("basic", basic, false, true);
+		ParseSimText(basic.data(), basic.data() + basic.size(), SimLayout::Basic, triangle);
+
+		//Line endings and layouts
+		check("basic, CRLF", "3\r\n0 0 0 0 0 0 0 1\r\n1 0 0 1 0 0 0 1\r\n0 1 0 0 1 0 0 1\r\n3\r\n0 1 2\r\n", false, true, &triangle);
+		check("basic, no final newline", vertices + "3\n0 1 2", false, true, &triangle);
+		check("tangent", "1\n0 0 0 0 0 0 1 0 1 0 0 0 0 1\n3\n0 0 0\n", false, true);
+
+		//Counts that do not match the values
+		check("vertex count above the vertices", "4" + basic.substr(1), false, false);
+		check("vertex count below the vertices", "2" + basic.substr(1), false, false);
+		check("index count above the indices", vertices + "6\n0 1 2\n", false, false);
+		check("index count below the indices", vertices + "2\n0 1 2\n", false, false);
+		check("indices not whole triangles", vertices + "4\n0 1 2 0\n", false, false);
+		check("no index count", vertices, false, false);
+		check("empty", "", false, false);
+
+		//Indices past the vertices
+		check("index of the vertex count", vertices + "3\n0 1 3\n", false, false);
+		check("index far past the vertices", vertices + "3\n0 1 900000\n", false, false);
+
+		//Malformed values
+		check("letter after a value", "3\n0 0 0 0 0 0 0 1x\n1 0 0 1 0 0 0 1\n0 1 0 0 1 0 0 1\n3\n0 1 2\n", false, false);
+		check("word for a value", "3\n0 0 0 0 abc 0 0 1\n1 0 0 1 0 0 0 1\n0 1 0 0 1 0 0 1\n3\n0 1 2\n", false, false);
+		check("double minus", "3\n0 0 --1 0 0 0 0 1\n1 0 0 1 0 0 0 1\n0 1 0 0 1 0 0 1\n3\n0 1 2\n", false, false);
+		check("fractional index", vertices + "3\n0 1 1.5\n", false, false);
+		check("negative index", vertices + "3\n0 1 -1\n", false, false);
+		check("fractional vertex count", "3.0" + basic.substr(1), false, false);
+
+		//Large enough to split into chunks, which must not change a value at their edges
+		MeshBuffer large;
+		check("chunked", MakeSimText(20000, 30000, "\n", large), false, true, &large);
+		check("chunked, CRLF", MakeSimText(20000, 30000, "\r\n", large), false, true, &large);
+
+		auto corrupt = MakeSimText(20000, 30000, "\n", large);
+		corrupt[corrupt.size() / 2] = '#';
+		check("chunked, bad value mid file", corrupt, false, false);
+
+		corrupt = MakeSimText(20000, 30000, "\n", large);
+		corrupt = corrupt.substr(0, corrupt.rfind(' ') + 1) + "20000\n";
+		check("chunked, last index past the vertices", corrupt, false, false);
+
+		//Curves
+		check("curve", "1\n0 0 0 0 1 0\n1 0 0 0 1 0\n2 0 0 0 1 0\n3 0 0 0 1 0\n", true, true);
+		check("curve, CRLF", "1\r\n0 0 0 0 1 0\r\n1 0 0 0 1 0\r\n2 0 0 0 1 0\r\n3 0 0 0 1 0\r\n", true, true);
+		check("curve, missing point", "1\n0 0 0 0 1 0\n1 0 0 0 1 0\n2 0 0 0 1 0\n", true, false);
+		check("curve, extra value", "1\n0 0 0 0 1 0\n1 0 0 0 1 0\n2 0 0 0 1 0\n3 0 0 0 1 0 7\n", true, false);
+		check("curve, malformed value", "1\n0 0 0 0 1 0\n1 0 0 0 1e\n2 0 0 0 1 0\n3 0 0 0 1 0\n", true, false);
+
+		printf("parser cases: %d failed\n", failures);
+		return failures == 0 ? 0 : 1;
+	}
+
+	int Parse(char ** pFiles, const int pCount)
+	{
+		auto result = ParseCases();
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			const std::string filename = pFiles[i];
+
+			MappedFile file;
+			if (!file.Open(filename))
+			{
+				fprintf(stderr, "%s: cannot open\n", filename.c_str());
+				result = 1;
+				continue;
+			}
+
+			const auto begin = reinterpret_cast<const char *>(file.Data());
+			const auto end = begin + file.Size();
+			const auto megabytes = file.Size() / (1024.0 * 1024.0);
+
+			SimLayout layout = SimLayout::Basic;
+			if (!IsCurve(filename) && !DetectSimLayout(begin, end, layout))
+			{
+				fprintf(stderr, "%s: unrecognised vertex layout\n", filename.c_str());
+				result = 1;
+				continue;
+			}
+
+			MeshBuffer reference;
+			const auto referenceValid = StreamParse(filename, reference);
+
+			//Repeat small files so each measurement covers at least 64 MB of text
+			const auto iterations = std::max(1, static_cast<int>(64.0 / megabytes));
+
+			auto start = Clock::now();
+			for (auto j = 0; j < iterations; j++)
+			{
+				StreamParse(filename, reference);
+			}
+			const auto stream = Milliseconds(start) / iterations;
+
+			MeshBuffer mesh;
+			auto valid = true;
+
+			start = Clock::now();
+			for (auto j = 0; j < iterations; j++)
+			{
+				valid &= IsCurve(filename) ? ParseCurveText(begin, end, mesh) : ParseSimText(begin, end, layout, mesh);
+			}
+			const auto parallel = Milliseconds(start) / iterations;
+
+			const auto matches = valid && referenceValid && Same(mesh, reference);
+
+			printf("%s (%.2f MB)\n  stream   %8.1f MB/s\n  parallel %8.1f MB/s  %s\n", filename.c_str(), megabytes,
+				megabytes * 1000.0 / stream, megabytes * 1000.0 / parallel, matches ? "matches reference" : "DIFFERS FROM REFERENCE");
+
+			if (!matches)
+			{
+				result = 1;
+			}
+		}
+
+		return result;
+	}
+
+	void PrintCacheStats(const char * pLabel, const MeshBuffer & pMesh)
+	{
+		const auto stats = AnalyzeVertexCache(pMesh.indices.data(), static_cast<uint32_t>(pMesh.indices.size()), pMesh.vertexCount);
+
+		printf("  %-6s ACMR %.3f  ATVR %.3f  (%u transforms)\n", pLabel, stats.acmr, stats.atvr, stats.transformed);
+	}
+
+	int Optimize(char ** pFiles, const int pCount)
+	{
+		auto result = 0;
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			const std::string filename = pFiles[i];
+
+			SimLayout layout;
+			MeshBuffer mesh;
+
+			if (!DetectSimLayout(filename, layout) || !LoadSimText(filename, layout, mesh) || !IsTriangleList(mesh.View()))
+			{
+				fprintf(stderr, "%s: failed to parse\n", filename.c_str());
+				result = 1;
+				continue;
+			}
+
+			printf("%s (%u vertices, %u triangles, FIFO %u)\n", filename.c_str(), mesh.vertexCount, static_cast<uint32_t>(mesh.indices.size() / 3), VertexCacheSize);
+			PrintCacheStats("before", mesh);
+
+			const auto start = Clock::now();
+			OptimizeMesh(mesh);
+			const auto time = Milliseconds(start);
+
+			PrintCacheStats("after", mesh);
+			printf("  optimised in %.2f ms\n", time);
+		}
+
+		return result;
+	}
+
+	// Checks the SSE2 code against the scalar code bit for bit, and the decoded mesh against the
+	// rounding each encoding allows.
+	bool CheckQuantization(const std::string & pName, const MeshView & pMesh)
+	{
+		QuantizedMesh vectorised;
+		QuantizedMesh scalar;
+
+		if (!QuantizeMesh(pMesh, vectorised) || !QuantizeMesh(pMesh, scalar, false))
+		{
+			fprintf(stderr, "%s: FAILED, not quantised\n", pName.c_str());
+			return false;
+		}
+
+		if (vectorised.positions != scalar.positions || vectorised.normals != scalar.normals || vectorised.texCoords != scalar.texCoords ||
+			vectorised.tangents != scalar.tangents || vectorised.biTangents != scalar.biTangents || vectorised.indices != scalar.indices ||
+			memcmp(vectorised.positionOffset, scalar.positionOffset, sizeof scalar.positionOffset) != 0 ||
+			memcmp(vectorised.positionScale, scalar.positionScale, sizeof scalar.positionScale) != 0)
+		{
+			fprintf(stderr, "%s: FAILED, the SSE2 encode differs from the scalar encode\n", pName.c_str());
+			return false;
+		}
+
+		MeshBuffer decoded;
+		MeshBuffer scalarDecoded;
+		DequantizeMesh(vectorised, decoded);
+		DequantizeMesh(vectorised, scalarDecoded, false);
+
+		if (!Same(decoded, scalarDecoded))
+		{
+			fprintf(stderr, "%s: FAILED, the SSE2 decode differs from the scalar decode\n", pName.c_str());
+			return false;
+		}
+
+		//A position is off by at most half a step of the 65535 across the bounds on each axis, plus
+		//float rounding. A half float keeps 11 significant bits, so a texcoord is within 2^-11 of
+		//itself plus half the smallest denormal. The directions' bound is mostly acos's precision near 1.
+		float step = 0.0f;
+		float largest = 0.0f;
+
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			step += (vectorised.positionScale[i] / 65535.0f) * (vectorised.positionScale[i] / 65535.0f);
+			largest = std::max(largest, fabsf(vectorised.positionOffset[i]) + vectorised.positionScale[i]);
+		}
+
+		float texCoord = 0.0f;
+
+		for (uint32_t i = 0; i < pMesh.vertexCount * 2; i++)
+		{
+			texCoord = std::max(texCoord, fabsf(pMesh.Stream(MeshStream::TexCoord)[i]));
+		}
+
+		const auto positionBound = 0.5f * sqrtf(step) + largest * 8.0f * FLT_EPSILON;
+		const auto texCoordBound = texCoord / 2048.0f + 1.0f / 33554432.0f;
+		const auto directionBound = 0.05f;
+
+		//Written so a NaN fails too
+		const auto error = MeasureQuantizationError(pMesh, decoded.View());
+
+		if (!(error.position <= positionBound) || !(error.texCoord <= texCoordBound) ||
+			!(error.normal <= directionBound) || !(error.tangent <= directionBound) || !(error.bitangent <= directionBound))
+		{
+			fprintf(stderr, "%s: FAILED, error past its bounds: position %g (%g), texcoord %g (%g), normal %g, tangent %g, bitangent %g deg (%g)\n",
+				pName.c_str(), error.position, positionBound, error.texCoord, texCoordBound, error.normal, error.tangent, error.bitangent, directionBound);
+			return false;
+		}
+
+		return true;
+	}
+
+	// Random unit directions and positions in a flat slab, so one axis has no extent, with a
+	// vertex count that leaves the scalar tail some work.
+	MeshBuffer MakeQuantizeMesh(const uint32_t pVertexCount)
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		MeshBuffer mesh;
+		mesh.vertexCount = pVertexCount;
+
+		for (uint32_t i = 0; i < pVertexCount; i++)
+		{
+			auto & positions = mesh.Stream(MeshStream::Position);
+			positions.push_back(unit(random) * 50.0f);
+			positions.push_back(unit(random) * 0.001f);
+			positions.push_back(2.0f);
+
+			mesh.Stream(MeshStream::TexCoord).push_back(unit(random) * 3.0f);
+			mesh.Stream(MeshStream::TexCoord).push_back(unit(random) * 0.01f);
+
+			for (const auto stream : { MeshStream::Normal, MeshStream::Tangent, MeshStream::BiTangent })
+			{
+				float direction[3];
+				float length;
+
+				do
+				{
+					direction[0] = unit(random);
+					direction[1] = unit(random);
+					direction[2] = unit(random);
+					length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+				} while (length < 0.1f || length > 1.0f);
+
+				for (const auto component : direction)
+				{
+					mesh.Stream(stream).push_back(component / length);
+				}
+			}
+		}
+
+		for (uint32_t i = 0; i + 2 < pVertexCount; i += 3)
+		{
+			mesh.indices.insert(mesh.indices.end(), { i, i + 1, i + 2 });
+		}
+
+		return mesh;
+	}
+
+	int Quantize(char ** pFiles, const int pCount)
+	{
+		//Files that cannot be read or checked fail the command, but only the checks fail the summary
+		const auto generated = MakeQuantizeMesh(1027);
+		auto passed = CheckQuantization("generated", generated.View());
+		auto result = 0;
+		auto skipped = 0;
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			const std::string filename = pFiles[i];
+
+			SimLayout layout;
+			MeshBuffer mesh;
+
+			if (!DetectSimLayout(filename, layout))
+			{
+				fprintf(stderr, "%s: failed to parse\n", filename.c_str());
+				result = 1;
+				continue;
+			}
+
+			//Only tangent space meshes are quantised, any other layout says nothing about the quantiser
+			if (layout != SimLayout::Tangent)
+			{
+				printf("%s: skipped, not a tangent-layout mesh\n", filename.c_str());
+				skipped++;
+				continue;
+			}
+
+			if (!LoadSimText(filename, layout, mesh))
+			{
+				fprintf(stderr, "%s: failed to parse\n", filename.c_str());
+				result = 1;
+				continue;
+			}
+
+			if (!OptimizeMesh(mesh))
+			{
+				fprintf(stderr, "%s: not a triangle list\n", filename.c_str());
+				result = 1;
+				continue;
+			}
+
+			const auto view = mesh.View();
+			const auto iterations = std::max(1u, 4000000u / std::max(mesh.vertexCount, 1u));
+
+			passed &= CheckQuantization(filename, view);
+
+			QuantizedMesh quantized;
+			auto start = Clock::now();
+			for (uint32_t j = 0; j < iterations; j++)
+			{
+				QuantizeMesh(view, quantized);
+			}
+			const auto encode = Milliseconds(start) / iterations;
+
+			MeshBuffer decoded;
+			start = Clock::now();
+			for (uint32_t j = 0; j < iterations; j++)
+			{
+				DequantizeMesh(quantized, decoded);
+			}
+			const auto decode = Milliseconds(start) / iterations;
+
+			const auto error = MeasureQuantizationError(view, decoded.View());
+
+			const auto fullBytes = mesh.vertexCount * 14.0 * sizeof(float);
+			const auto quantizedBytes = mesh.vertexCount * static_cast<double>(QuantizedVertexBytes);
+			const auto millions = mesh.vertexCount / 1000000.0;
+
+			printf("%s (%u vertices)\n", filename.c_str(), mesh.vertexCount);
+			printf("  vertex bytes  %.0f -> %.0f (%.1f%% smaller)\n", fullBytes, quantizedBytes, 100.0 * (1.0 - quantizedBytes / fullBytes));
+			printf("  encode %7.1f Mverts/s  decode %7.1f Mverts/s\n", millions * 1000.0 / encode, millions * 1000.0 / decode);
+			printf("  max error  position %g  texcoord %g  normal %.3f deg  tangent %.3f deg  bitangent %.3f deg\n",
+				error.position, error.texCoord, error.normal, error.tangent, error.bitangent);
+		}
+
+		printf("quantisation checks: %s, %d file%s skipped\n", passed ? "passed" : "FAILED", skipped, skipped == 1 ? "" : "s");
+		return passed ? result : 1;
+	}
+
+	int Lod(char ** pFiles, const int pCount)
+	{
+		auto result = 0;
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			const std::string filename = pFiles[i];
+
+			SimLayout layout;
+			MeshBuffer mesh;
+
+			if (!DetectSimLayout(filename, layout) || !LoadSimText(filename, layout, mesh))
+			{
+				fprintf(stderr, "%s: failed to parse\n", filename.c_str());
+				result = 1;
+				continue;
+			}
+
+			if (!OptimizeMesh(mesh))
+			{
+				fprintf(stderr, "%s: not a triangle list\n", filename.c_str());
+				result = 1;
+				continue;
+			}
+
+			const auto start = Clock::now();
+			const auto chain = BuildLodChain(mesh.View(), 5, 0.5f, 1e30f);
+			const auto time = Milliseconds(start);
+
+			printf("%s (%u vertices)\n", filename.c_str(), mesh.vertexCount);
+
+			for (size_t j = 0; j < chain.size(); j++)
+			{
+				const auto & level = chain[j];
+				const auto stats = AnalyzeVertexCache(level.indices.data(), static_cast<uint32_t>(level.indices.size()), mesh.vertexCount);
+
+				printf("  lod %u  %6u triangles  error %10.4f  ACMR %.3f\n", static_cast<uint32_t>(j), static_cast<uint32_t>(level.indices.size() / 3), level.error, stats.acmr);
+			}
+
+			printf("  built in %.2f ms\n", time);
+		}
+
+		return result;
+	}
+
+	struct Float3
+	{
+		float x, y, z;
+
+		Float3 operator- (const Float3 & pOther) const { return { x - pOther.x, y - pOther.y, z - pOther.z }; }
+		float Dot(const Float3 & pOther) const { return x * pOther.x + y * pOther.y + z * pOther.z; }
+
+		Float3 Cross(const Float3 & pOther) const
+		{
+			return { y * pOther.z - z * pOther.y, z * pOther.x - x * pOther.z, x * pOther.y - y * pOther.x };
+		}
+
+		Float3 Normalized() const
+		{
+			const auto length = sqrtf(Dot(*this));
+			return { x / length, y / length, z / length };
+		}
+	};
+
+	// Row-major for row vectors, as XMMatrixMultiply
+	void Multiply(const float * pA, const float * pB, float * pResult)
+	{
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			for (uint32_t j = 0; j < 4; j++)
+			{
+				pResult[i * 4 + j] = pA[i * 4] * pB[j] + pA[i * 4 + 1] * pB[4 + j] + pA[i * 4 + 2] * pB[8 + j] + pA[i * 4 + 3] * pB[12 + j];
+			}
+		}
+	}
+
+	// As XMMatrixLookAtRH
+	void LookAt(const Float3 & pEye, const Float3 & pAt, const Float3 & pUp, float * pMatrix)
+	{
+		const auto z = (pEye - pAt).Normalized();
+		const auto x = pUp.Cross(z).Normalized();
+		const auto y = z.Cross(x);
+
+		const float matrix[16] =
+		{
+			x.x, y.x, z.x, 0.0f,
+			x.y, y.y, z.y, 0.0f,
+			x.z, y.z, z.z, 0.0f,
+			-x.Dot(pEye), -y.Dot(pEye), -z.Dot(pEye), 1.0f
+		};
+
+		std::copy(matrix, matrix + 16, pMatrix);
+	}
+
+	// As XMMatrixPerspectiveFovRH
+	void Perspective(const float pFov, const float pAspect, const float pNear, const float pFar, float * pMatrix)
+	{
+		const auto height = 1.0f / tanf(pFov * 0.5f);
+		const auto range = pFar / (pNear - pFar);
+
+		const float matrix[16] =
+		{
+			height / pAspect, 0.0f, 0.0f, 0.0f,
+			0.0f, height, 0.0f, 0.0f,
+			0.0f, 0.0f, range, -1.0f,
+			0.0f, 0.0f, range * pNear, 0.0f
+		};
+
+		std::copy(matrix, matrix + 16, pMatrix);
+	}
+
+	// Walks an ellipse through the scene looking ahead, passing 10 units outside each rock, with the
+	// mesh drawn at both rock transforms. Reports how many triangles the meshlet bounds reject
+	// against the exact per-triangle back face count.
+	int Cull(const std::string & pFilename, const uint32_t pViews, const float pPadding)
+	{
+		SimLayout layout;
+		MeshBuffer mesh;
+
+		if (!DetectSimLayout(pFilename, layout) || !LoadSimText(pFilename, layout, mesh))
+		{
+			fprintf(stderr, "%s: failed to parse\n", pFilename.c_str());
+			return 1;
+		}
+
+		if (!OptimizeMesh(mesh))
+		{
+			fprintf(stderr, "%s: not a triangle list\n", pFilename.c_str());
+			return 1;
+		}
+
+		MeshletMesh meshlets;
+		const auto start = Clock::now();
+		BuildMeshlets(mesh.View(), mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size()), meshlets);
+		const auto buildTime = Milliseconds(start);
+
+		const auto triangleCount = static_cast<uint32_t>(mesh.indices.size() / 3);
+		const auto meshletCount = static_cast<uint32_t>(meshlets.meshlets.size());
+		uint32_t vertexSum = 0;
+
+		for (const auto & meshlet : meshlets.meshlets)
+		{
+			vertexSum += meshlet.vertexCount;
+		}
+
+		printf("%s: %u triangles in %u meshlets (%.1f vertices, %.1f triangles each), built in %.2f ms\n", pFilename.c_str(), triangleCount,
+			meshletCount, vertexSum / static_cast<float>(meshletCount), triangleCount / static_cast<float>(meshletCount), buildTime);
+
+		//The renderer's rocks and projection
+		const float scale = 0.01f;
+		const Float3 translations[] = { { 30.0f, 0.0f, 40.0f }, { -30.0f, 0.0f, 40.0f } };
+		float projection[16];
+		Perspective(70.0f * 3.14159265f / 180.0f, 16.0f / 9.0f, 1.0f, 1000.0f, projection);
+
+		const auto positions = mesh.Stream(MeshStream::Position).data();
+		const auto normals = mesh.Stream(MeshStream::Normal).data();
+
+		uint64_t frustumRejected = 0;
+		uint64_t backFaceRejected = 0;
+		uint64_t exactBackFaces = 0;
+		uint64_t submitted = 0;
+		double cullTime = 0.0;
+		std::vector<IndexRange> ranges;
+
+		const auto instances = static_cast<uint32_t>(sizeof(translations) / sizeof(translations[0]));
+
+		for (uint32_t view = 0; view < pViews; view++)
+		{
+			const auto angle = 2.0f * 3.14159265f * view / pViews;
+			const Float3 eye = { 40.0f * cosf(angle), 5.0f, 40.0f + 20.0f * sinf(angle) };
+			const Float3 ahead = { eye.x - 40.0f * sinf(angle), 5.0f, eye.z + 20.0f * cosf(angle) };
+
+			float viewMatrix[16];
+			float viewProjection[16];
+			LookAt(eye, ahead, { 0.0f, 1.0f, 0.0f }, viewMatrix);
+			Multiply(viewMatrix, projection, viewProjection);
+
+			uint32_t viewRejected = 0;
+
+			for (uint32_t instance = 0; instance < instances; instance++)
+			{
+				const auto & translation = translations[instance];
+				const float model[16] =
+				{
+					scale, 0.0f, 0.0f, 0.0f,
+					0.0f, scale, 0.0f, 0.0f,
+					0.0f, 0.0f, scale, 0.0f,
+					translation.x, translation.y, translation.z, 1.0f
+				};
+
+				float modelViewProjection[16];
+				Multiply(model, viewProjection, modelViewProjection);
+
+				const float meshEye[3] = { (eye.x - translation.x) / scale, (eye.y - translation.y) / scale, (eye.z - translation.z) / scale };
+
+				MeshletCullView cullView;
+				MakeMeshletCullView(modelViewProjection, meshEye, pPadding, cullView);
+
+				const auto cullStart = Clock::now();
+				submitted += CullMeshlets(meshlets.meshlets, cullView, ranges);
+				cullTime += Milliseconds(cullStart);
+
+				for (const auto & meshlet : meshlets.meshlets)
+				{
+					const auto visibility = CullMeshlet(meshlet, cullView);
+
+					if (visibility == MeshletVisibility::OutsideFrustum)
+					{
+						frustumRejected += meshlet.triangleCount;
+						viewRejected += meshlet.triangleCount;
+					}
+					else if (visibility == MeshletVisibility::BackFacing)
+					{
+						backFaceRejected += meshlet.triangleCount;
+						viewRejected += meshlet.triangleCount;
+					}
+				}
+
+				//Reference, each triangle against its own plane, oriented by its vertex normal
+				for (uint32_t i = 0; i < triangleCount; i++)
+				{
+					const auto a = mesh.indices[i * 3];
+					const Float3 p0 = { positions[a * 3], positions[a * 3 + 1], positions[a * 3 + 2] };
+					const Float3 p1 = { positions[mesh.indices[i * 3 + 1] * 3], positions[mesh.indices[i * 3 + 1] * 3 + 1], positions[mesh.indices[i * 3 + 1] * 3 + 2] };
+					const Float3 p2 = { positions[mesh.indices[i * 3 + 2] * 3], positions[mesh.indices[i * 3 + 2] * 3 + 1], positions[mesh.indices[i * 3 + 2] * 3 + 2] };
+
+					auto normal = (p1 - p0).Cross(p2 - p0);
+
+					if (normals && normal.Dot({ normals[a * 3], normals[a * 3 + 1], normals[a * 3 + 2] }) < 0.0f)
+					{
+						normal = { -normal.x, -normal.y, -normal.z };
+					}
+
+					if (normal.Dot(p0 - Float3{ meshEye[0], meshEye[1], meshEye[2] }) >= 0.0f)
+					{
+						exactBackFaces++;
+					}
+				}
+			}
+
+			if (view % std::max(1u, pViews / 8) == 0)
+			{
+				printf("  view %4u  eye (%6.1f, %4.1f, %5.1f)  rejected %5u of %u triangles\n", view, eye.x, eye.y, eye.z, viewRejected, triangleCount * instances);
+			}
+		}
+
+		const auto total = static_cast<double>(triangleCount) * instances * pViews;
+
+		printf("  per view: %.0f triangles, %.0f outside the frustum, %.0f back facing, %.0f submitted (%.1f%% rejected)\n",
+			total / pViews, frustumRejected / static_cast<double>(pViews), backFaceRejected / static_cast<double>(pViews),
+			submitted / static_cast<double>(pViews), 100.0 * (frustumRejected + backFaceRejected) / total);
+		printf("  exact back faces per view %.0f, meshlet cones catch %.1f%% of them\n", exactBackFaces / static_cast<double>(pViews),
+			exactBackFaces > 0 ? 100.0 * backFaceRejected / exactBackFaces : 0.0);
+		printf("  culling %.2f us per view, %.1f Mmeshlets/s\n", 1000.0 * cullTime / pViews, meshletCount * instances * pViews / (cullTime * 1000.0));
+
+		return 0;
+	}
+
+	int Convert(const std::string & pInput, const std::string & pOutput)
+	{
+		SimLayout layout;
+		if (!DetectSimLayout(pInput, layout))
+		{
+			fprintf(stderr, "%s: unrecognised vertex layout\n", pInput.c_str());
+			return 1;
+		}
+
+		MeshBuffer mesh;
+		if (!LoadSimText(pInput, layout, mesh))
+		{
+			fprintf(stderr, "%s: failed to parse\n", pInput.c_str());
+			return 1;
+		}
+
+		if (!OptimizeMesh(mesh))
+		{
+			fprintf(stderr, "%s: not a triangle list\n", pInput.c_str());
+			return 1;
+		}
+
+		if (!WriteMeshFile(pOutput, mesh.View()))
+		{
+			fprintf(stderr, "%s: failed to write\n", pOutput.c_str());
+			return 1;
+		}
+
+		MeshFile check;
+		if (!check.Open(pOutput) || Checksum(check.View()) != Checksum(mesh.View()))
+		{
+			fprintf(stderr, "%s: verification failed\n", pOutput.c_str());
+			return 1;
+		}
+
+		printf("%s -> %s: %u vertices, %u indices\n", pInput.c_str(), pOutput.c_str(), mesh.vertexCount, static_cast<uint32_t>(mesh.indices.size()));
+		return 0;
+	}
+
+	// Covers the streams and every level's indices and meshlets
+	uint64_t Checksum(const CookedMesh & pMesh)
+	{
+		auto sum = HashBytes(pMesh.mesh.indices, pMesh.mesh.indexCount * sizeof(uint32_t), Checksum(pMesh.mesh));
+
+		for (uint32_t i = 0; i < pMesh.levelCount; i++)
+		{
+			const auto & level = pMesh.levels[i];
+			sum = HashBytes(level.indices, level.indexCount * sizeof(uint32_t), sum ^ level.indexCount);
+
+			if (level.meshlets)
+			{
+				sum = HashBytes(level.meshlets->meshlets.data(), level.meshlets->meshlets.size() * sizeof(Meshlet), sum);
+			}
+		}
+
+		return sum;
+	}
+
+	int Cache(const std::string & pDirectory, char ** pFiles, const int pCount)
+	{
+		//Only the cooked files are cleared, so dir can be the app's own cache folder
+		std::error_code error;
+		for (const auto & entry : std::filesystem::directory_iterator(pDirectory, error))
+		{
+			if (entry.path().extension() == ".cooked")
+			{
+				std::filesystem::remove(entry.path(), error);
+			}
+		}
+
+		AssetCache cache(pDirectory);
+		const auto warmRuns = 20;
+		double uncachedTotal = 0.0, coldTotal = 0.0, warmTotal = 0.0;
+		auto result = 0;
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			const std::string filename = pFiles[i];
+
+			//As the app loads its meshes, the LOD chain and meshlets of the rock being the costliest
+			MeshCookOptions options;
+			options.curve = IsCurve(filename);
+			options.triangles = !options.curve;
+			options.levels = options.curve ? 1 : CookedMaxLevels;
+			options.meshlets = !options.curve;
+
+			if (!options.curve && !DetectSimLayout(filename, options.layout))
+			{
+				fprintf(stderr, "%s: unrecognised vertex layout\n", filename.c_str());
+				result = 1;
+				continue;
+			}
+
+			CookedMesh uncached, cold, warm;
+
+			auto start = Clock::now();
+			const auto loaded = CookMesh(filename, options, nullptr, uncached);
+			const auto uncachedTime = Milliseconds(start);
+
+			start = Clock::now();
+			CookMesh(filename, options, &cache, cold);
+			const auto coldTime = Milliseconds(start);
+
+			start = Clock::now();
+			for (auto j = 0; j < warmRuns; j++)
+			{
+				CookMesh(filename, options, &cache, warm);
+			}
+			const auto warmTime = Milliseconds(start) / warmRuns;
+
+			const auto matches = loaded && warm.cached && !cold.cached && Checksum(warm) == Checksum(uncached) && Checksum(cold) == Checksum(uncached);
+
+			printf("%s (%u vertices, %u levels)\n  uncached %8.3f ms\n  cold     %8.3f ms  (cook and store)\n  warm     %8.3f ms  %s\n",
+				filename.c_str(), uncached.mesh.vertexCount, uncached.levelCount, uncachedTime, coldTime, warmTime,
+				matches ? "matches uncached" : "DIFFERS FROM UNCACHED");
+
+			uncachedTotal += uncachedTime;
+			coldTotal += coldTime;
+			warmTotal += warmTime;
+
+			if (!matches)
+			{
+				result = 1;
+			}
+		}
+
+		uint64_t cookedBytes = 0;
+		for (const auto & entry : std::filesystem::directory_iterator(pDirectory, error))
+		{
+			if (entry.path().extension() == ".cooked")
+			{
+				cookedBytes += entry.file_size(error);
+			}
+		}
+
+		printf("startup\n  uncached %8.3f ms\n  cold     %8.3f ms\n  warm     %8.3f ms  (%.1fx faster than cold, %.1f KB cooked, %u hits %u misses)\n",
+			uncachedTotal, coldTotal, warmTotal, coldTotal / warmTotal, cookedBytes / 1024.0, cache.Hits(), cache.Misses());
+
+		return result;
+	}
+
+	int Bench(const std::string & pInput, const int pIterations)
+	{
+		SimLayout layout;
+		if (!DetectSimLayout(pInput, layout))
+		{
+			fprintf(stderr, "%s: unrecognised vertex layout\n", pInput.c_str());
+			return 1;
+		}
+
+		const auto binary = GetBinaryMeshFilename(pInput);
+		uint32_t sum = 0;
+
+		auto start = Clock::now();
+		for (auto i = 0; i < pIterations; i++)
+		{
+			//The app optimises text meshes as it loads them, the binary file is optimised already
+			MeshBuffer mesh;
+			LoadSimText(pInput, layout, mesh);
+			OptimizeMesh(mesh);
+			sum += Checksum(mesh.View());
+		}
+		const auto text = Milliseconds(start) / pIterations;
+
+		start = Clock::now();
+		for (auto i = 0; i < pIterations; i++)
+		{
+			MeshFile mesh;
+			if (!mesh.Open(binary))
+			{
+				fprintf(stderr, "%s: missing, run convert first\n", binary.c_str());
+				return 1;
+			}
+			sum -= Checksum(mesh.View());
+		}
+		const auto mapped = Milliseconds(start) / pIterations;
+
+		printf("%s\n  text   %8.3f ms\n  mapped %8.3f ms\n  speedup %.1fx%s\n", pInput.c_str(), text, mapped, text / mapped,
+			sum == 0 ? "" : "  (checksum mismatch)");
+		return sum == 0 ? 0 : 1;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc >= 3 && std::string(argv[1]) == "convert")
+	{
+		return Convert(argv[2], argc >= 4 ? argv[3] : GetBinaryMeshFilename(argv[2]));
+	}
+
+	if (argc >= 3 && std::string(argv[1]) == "optimize")
+	{
+		return Optimize(argv + 2, argc - 2);
+	}
+
+	if (argc >= 2 && std::string(argv[1]) == "quantize")
+	{
+		return Quantize(argv + 2, argc - 2);
+	}
+
+	if (argc >= 3 && std::string(argv[1]) == "lod")
+	{
+		return Lod(argv + 2, argc - 2);
+	}
+
+	if (argc >= 3 && std::string(argv[1]) == "cull")
+	{
+		return Cull(argv[2], argc >= 4 ? std::max(1, atoi(argv[3])) : 360, argc >= 5 ? static_cast<float>(atof(argv[4])) : 0.0f);
+	}
+
+	if (argc >= 3 && std::string(argv[1]) == "bench")
+	{
+		return Bench(argv[2], argc >= 4 ? atoi(argv[3]) : 20);
+	}
+
+	if (argc >= 2 && std::string(argv[1]) == "parse")
+	{
+		return Parse(argv + 2, argc - 2);
+	}
+
+	if (argc >= 4 && std::string(argv[1]) == "cache")
+	{
+		return Cache(argv[2], argv + 3, argc - 3);
+	}
+
+	fprintf(stderr, "usage: MeshTool convert <input.sim> [output.simb]\n       MeshTool optimize <file.sim>...\n"
+		"       MeshTool quantize [file.sim]...\n"
+		"       MeshTool lod <file.sim>...\n"
+		"       MeshTool cull <file.sim> [views] [padding]\n"
+		"       MeshTool bench <input.sim> [iterations]\n"
+		"       MeshTool parse [file.sim|file.cur]...\n"
+		"       MeshTool cache <dir> <file.sim|file.cur>...\n");
+	return 1;
+}
@@ -0,0 +1,1691 @@
+// Offline ray tracing tool, built outside the app from the portable ray tracing sources:
+//
+//   g++ -std=c++17 -O2 -pthread -mavx2 -I.. RayTool.cpp ../DdsParser.cpp ../MappedFile.cpp ../MeshFile.cpp ../RayBvh.cpp ../RayInstances.cpp ../RayMarcher.cpp ../RayPacket.cpp ../RaySampler.cpp ../RaySceneFile.cpp ../RayTracer.cpp ../RayWavefront.cpp ../SimParser.cpp ../TileScheduler.cpp -o RayTool
+//
+//   RayTool render <width> <height> <color.dds> <position.dds> [eyeX eyeY eyeZ targetX targetY targetZ]
+//                                                Trace the ray tracing pass's scene into its two R32G32B32A32_FLOAT targets,
+//                                                from the app's start camera unless one is given
+//   RayTool bench [width] [height] [frames]      Mrays/s at 1, 2, 4... threads up to every hardware thread, the scaling over
+//                                                one thread and the cost of each tile size, checking every image matches
+//   RayTool packets [width] [height] [frames]    The eye and shadow ray kernels and whole frames, scalar against 8 and 4 wide
+//                                                packets, checking the packets give the scalar answers bit for bit
+//   RayTool bvh [file.sim]...                    BVH build time and closest hit Mrays/s over random spheres, triangles and quads
+//                                                from 10 to 1M of them, then each mesh's triangles, checking hits against a scan
+//   RayTool shadows [file.sim]...                Shadow rays from the hits of the bvh scenes' eye rays, the any-hit occlusion query
+//                                                against a closest hit capped at the light and a scan, checking all three agree
+//   RayTool scene <file.scene> [width] [height]  Load a scene file, checking it survives the shader's buffers and a rewrite, then
+//                                                trace it through a BVH, and by scan and packets if it is small enough
+//   RayTool generate <file.scene> <count> [seed] Write count random spheres, triangles and quads as a scene file
+//   RayTool adaptive [width] [height] [color.dds] Adaptive supersampling against uniform at 1, 4 and 16 samples a pixel and under
+//                                                sample and time budgets, the error of each against 64 samples a pixel
+//   RayTool instances <rock.sim> <sculpture.sim> The rocks and sculptures placed as instances of meshes built once, against their
+//                                                triangles copied into the world, as 10 to 1000 more rocks are scattered
+//   RayTool wavefront [width] [height] [frames]  The wavefront tracer against the megakernel, scanning and through a BVH, with its
+//                                                stage times and wave sizes, checking every image matches TraceRays
+//   RayTool tiles [width] [height] [frames] [heatmap prefix]
+//                                                The ray tracer, and the ray marcher at a quarter of the size, over the tile
+//                                                scheduler's orders, with stealing and adaptive tiles, checking every image matches
+//                                                the pass's own; the prefix writes each pass's tile cost heatmap as <prefix>tracer.dds
+//                                                and <prefix>marcher.dds
+//
+// Without -mavx2 the packets run as pairs of SSE2 registers.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DdsParser.h"
+#include "MeshFile.h"
+#include "Parallel.h"
+#include "RayBvh.h"
+#include "RayInstances.h"
+#include "RayMarcher.h"
+#include "RayPacket.h"
+#include "RaySampler.h"
+#include "RaySceneFile.h"
+#include "RayTracer.h"
+#include "RayWavefront.h"
+#include "SimParser.h"
+#include "TileScheduler.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	double Milliseconds(const Clock::time_point pStart)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - pStart).count();
+	}
+
+	// The camera Sample3DSceneRenderer starts with, and its field of view for the output's shape
+	RayCamera StartCamera(const uint32_t pWidth, const uint32_t pHeight, const RayVector & pEye = { 0.0f, 5.0f, -5.0f },
+		const RayVector & pTarget = { 0.0f, 5.0f, 0.0f })
+	{
+		auto fov = 70.0f * 3.14159265f / 180.0f;
+
+		if (pWidth < pHeight)
+		{
+			fov *= 2.0f;
+		}
+
+		return MakeRayCamera(pEye, pTarget, { 0.0f, -1.0f, 0.0f }, pWidth, pHeight, fov);
+	}
+
+	bool WriteTarget(const char * pFile, const uint32_t pWidth, const uint32_t pHeight, const std::vector<float> & pTexels)
+	{
+		DdsImage header;
+		header.format = DdsFormat::R32G32B32A32_FLOAT;
+		header.dimension = DdsDimension::Texture2D;
+		header.width = pWidth;
+		header.height = pHeight;
+		header.depth = header.arraySize = header.mipCount = 1;
+
+		std::vector<uint8_t> output;
+		WriteDdsHeader(header, output);
+
+		const auto top = output.size();
+		output.resize(top + pTexels.size() * sizeof(float));
+		memcpy(output.data() + top, pTexels.data(), pTexels.size() * sizeof(float));
+
+		std::ofstream file(pFile, std::ios::binary);
+		file.write(reinterpret_cast<const char *>(output.data()), output.size());
+
+		return file.good();
+	}
+
+	bool SameTargets(const RayTargets & pA, const RayTargets & pB)
+	{
+		return pA.color.size() == pB.color.size() && pA.position.size() == pB.position.size() &&
+			memcmp(pA.color.data(), pB.color.data(), pA.color.size() * sizeof(float)) == 0 &&
+			memcmp(pA.position.data(), pB.position.data(), pA.position.size() * sizeof(float)) == 0;
+	}
+
+	int Render(const uint32_t pWidth, const uint32_t pHeight, const char * pColorFile, const char * pPositionFile, const float * pView)
+	{
+		if (pWidth == 0 || pHeight == 0)
+		{
+			fprintf(stderr, "render: width and height must be positive\n");
+			return 1;
+		}
+
+		const auto camera = pView ? StartCamera(pWidth, pHeight, { pView[0], pView[1], pView[2] }, { pView[3], pView[4], pView[5] }) :
+			StartCamera(pWidth, pHeight);
+		const auto scene = DefaultRayScene();
+
+		RayTargets targets;
+
+		const auto start = Clock::now();
+		const auto stats = TraceRays(scene, camera, targets);
+		const auto time = Milliseconds(start);
+
+		uint32_t covered = 0;
+
+		for (size_t i = 3; i < targets.position.size(); i += 4)
+		{
+			covered += targets.position[i] != 0.0f;
+		}
+
+		printf("%ux%u on %u threads: %.1f ms, %.2f Mrays/s\n", pWidth, pHeight, WorkerCount(), time, stats.Rays() / time / 1000.0);
+		printf("  %llu primary, %llu reflection, %llu shadow rays, %.2f a pixel, %.1f%% of pixels hit\n",
+			static_cast<unsigned long long>(stats.primaryRays), static_cast<unsigned long long>(stats.reflectionRays),
+			static_cast<unsigned long long>(stats.shadowRays), static_cast<double>(stats.Rays()) / stats.primaryRays,
+			100.0 * covered / stats.primaryRays);
+
+		if (!WriteTarget(pColorFile, pWidth, pHeight, targets.color) || !WriteTarget(pPositionFile, pWidth, pHeight, targets.position))
+		{
+			fprintf(stderr, "render: cannot write the targets\n");
+			return 1;
+		}
+
+		return 0;
+	}
+
+	// Best of pFrames, so a frame that lost the core to something else does not count
+	double BestTime(const RayScene & pScene, const RayCamera & pCamera, RayTargets & pTargets, const RayTraceOptions & pOptions, const uint32_t pFrames,
+		RayStats & pStats)
+	{
+		auto best = 0.0;
+
+		for (uint32_t frame = 0; frame < pFrames; frame++)
+		{
+			const auto start = Clock::now();
+			pStats = TraceRays(pScene, pCamera, pTargets, pOptions);
+			const auto time = Milliseconds(start);
+
+			best = frame == 0 ? time : std::min(best, time);
+		}
+
+		return best;
+	}
+
+	int Bench(const uint32_t pWidth, const uint32_t pHeight, const uint32_t pFrames)
+	{
+		if (pWidth == 0 || pHeight == 0 || pFrames == 0)
+		{
+			fprintf(stderr, "bench: width, height and frames must be positive\n");
+			return 1;
+		}
+
+		const auto camera = StartCamera(pWidth, pHeight);
+		const auto scene = DefaultRayScene();
+
+		std::vector<uint32_t> threadCounts;
+
+		for (uint32_t threads = 1; threads < WorkerCount(); threads *= 2)
+		{
+			threadCounts.push_back(threads);
+		}
+
+		threadCounts.push_back(WorkerCount());
+
+		RayTargets reference;
+		RayStats stats;
+		auto result = 0;
+
+		printf("%ux%u, best of %u frames, %u hardware threads\n", pWidth, pHeight, pFrames, WorkerCount());
+		printf("  threads         ms    Mrays/s   speedup  efficiency\n");
+
+		auto single = 0.0;
+
+		for (const auto threads : threadCounts)
+		{
+			RayTraceOptions options;
+			options.threadCount = threads;
+
+			RayTargets targets;
+			const auto time = BestTime(scene, camera, targets, options, pFrames, stats);
+
+			if (threads == 1)
+			{
+				single = time;
+				reference = targets;
+			}
+			else if (!SameTargets(targets, reference))
+			{
+				fprintf(stderr, "  %u threads: the targets differ from one thread's\n", threads);
+				result = 1;
+			}
+
+			printf("  %7u %10.1f %10.2f %8.2fx %10.0f%%\n", threads, time, stats.Rays() / time / 1000.0, single / time,
+				100.0 * single / time / threads);
+		}
+
+		printf("  %.2f rays a pixel\n\n  tile size      ms    Mrays/s\n", static_cast<double>(stats.Rays()) / stats.primaryRays);
+
+		for (const auto tileSize : { 4u, 8u, 16u, 32u, 64u })
+		{
+			RayTraceOptions options;
+			options.tileSize = tileSize;
+
+			RayTargets targets;
+			const auto time = BestTime(scene, camera, targets, options, pFrames, stats);
+
+			if (!SameTargets(targets, reference))
+			{
+				fprintf(stderr, "  %u tiles: the targets differ from one thread's\n", tileSize);
+				result = 1;
+			}
+
+			printf("  %9u %7.1f %10.2f\n", tileSize, time, stats.Rays() / time / 1000.0);
+		}
+
+		return result;
+	}
+
+	int Packets(const uint32_t pWidth, const uint32_t pHeight, const uint32_t pFrames)
+	{
+		if (pWidth == 0 || pHeight == 0 || pFrames == 0)
+		{
+			fprintf(stderr, "packets: width, height and frames must be positive\n");
+			return 1;
+		}
+
+		const auto camera = StartCamera(pWidth, pHeight);
+		const auto scene = DefaultRayScene();
+		const auto soaScene = MakeRaySoaScene(scene);
+		auto result = 0;
+
+		//Eye rays in the 4x2 blocks TraceRayPackets makes, with the lanes past the right or bottom edge off
+		std::vector<RayPacket> packets;
+		std::vector<uint32_t> masks;
+		std::vector<RayVector> origins, directions;
+
+		for (uint32_t y = 0; y < pHeight; y += 2)
+		{
+			for (uint32_t x = 0; x < pWidth; x += 4)
+			{
+				RayPacket packet = {};
+				uint32_t mask = 0;
+
+				for (uint32_t lane = 0; lane < RayPacketWidth; lane++)
+				{
+					if (x + lane % 4 >= pWidth || y + lane / 4 >= pHeight)
+					{
+						continue;
+					}
+
+					RayVector origin, direction;
+					MakeEyeRay(camera, x + lane % 4 + 0.5f, y + lane / 4 + 0.5f, origin, direction);
+
+					for (auto c = 0; c < 3; c++)
+					{
+						packet.origin[c][lane] = (&origin.x)[c];
+						packet.direction[c][lane] = (&direction.x)[c];
+					}
+
+					origins.push_back(origin);
+					directions.push_back(direction);
+					mask |= 1u << lane;
+				}
+
+				packets.push_back(packet);
+				masks.push_back(mask);
+			}
+		}
+
+		const auto rays = origins.size();
+		std::vector<float> scalarT(rays), packetT(rays);
+		std::vector<int> scalarObject(rays), packetObject(rays);
+
+#if defined(__AVX2__)
+		printf("%ux%u, best of %u, AVX2 packets\n", pWidth, pHeight, pFrames);
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+		printf("%ux%u, best of %u, SSE2 packets\n", pWidth, pHeight, pFrames);
+#else
+		printf("%ux%u, best of %u, scalar packets\n", pWidth, pHeight, pFrames);
+#endif
+		printf("  %-22s %10s %10s %10s\n", "", "scalar", "packets", "speedup");
+
+		auto best = [pFrames](const std::function<void()> & pRun)
+		{
+			auto time = 0.0;
+
+			for (uint32_t frame = 0; frame < pFrames; frame++)
+			{
+				const auto start = Clock::now();
+				pRun();
+				time = frame == 0 ? Milliseconds(start) : std::min(time, Milliseconds(start));
+			}
+
+			return time;
+		};
+
+		auto report = [](const char * pName, const size_t pRays, const double pScalar, const double pPacket)
+		{
+			printf("  %-22s %10.2f %10.2f %9.2fx  Mrays/s\n", pName, pRays / pScalar / 1000.0, pRays / pPacket / 1000.0, pScalar / pPacket);
+		};
+
+		const auto scalarEye = best([&]()
+		{
+			for (size_t i = 0; i < rays; i++)
+			{
+				scalarT[i] = NearestRayHit(scene, origins[i], directions[i], camera.farPlane, scalarObject[i]);
+			}
+		});
+
+		const auto packetEye = best([&]()
+		{
+			size_t ray = 0;
+
+			for (size_t i = 0; i < packets.size(); i++)
+			{
+				float t[RayPacketWidth];
+				int object[RayPacketWidth];
+
+				NearestHitPacket(soaScene, packets[i], masks[i], camera.farPlane, t, object);
+
+				for (uint32_t lane = 0; lane < RayPacketWidth; lane++)
+				{
+					if (masks[i] >> lane & 1)
+					{
+						packetT[ray] = t[lane];
+						packetObject[ray++] = object[lane];
+					}
+				}
+			}
+		});
+
+		report("eye rays, 8 wide", rays, scalarEye, packetEye);
+
+		if (memcmp(scalarT.data(), packetT.data(), rays * sizeof(float)) != 0 || scalarObject != packetObject)
+		{
+			fprintf(stderr, "  the eye ray packets disagree with the scalar hits\n");
+			result = 1;
+		}
+
+		//Shadow rays from every eye ray hit, in the order they were found
+		std::vector<ShadowPacket> shadowPackets;
+		std::vector<RayVector> shadowOrigins, shadowDirections;
+		std::vector<float> distances;
+
+		for (size_t i = 0; i < rays; i++)
+		{
+			if (scalarObject[i] < 0)
+			{
+				continue;
+			}
+
+			RayVector origin, direction;
+			float distance;
+			MakeShadowRay(camera, origins[i] + directions[i] * scalarT[i], origin, direction, distance);
+
+			const auto slot = shadowOrigins.size() % ShadowPacketWidth;
+
+			if (slot == 0)
+			{
+				shadowPackets.push_back({});
+			}
+
+			for (auto c = 0; c < 3; c++)
+			{
+				shadowPackets.back().origin[c][slot] = (&origin.x)[c];
+				shadowPackets.back().direction[c][slot] = (&direction.x)[c];
+			}
+
+			shadowPackets.back().distance[slot] = distance;
+			shadowOrigins.push_back(origin);
+			shadowDirections.push_back(direction);
+			distances.push_back(distance);
+		}
+
+		const auto shadowRays = shadowOrigins.size();
+		std::vector<uint8_t> scalarShadow(shadowRays), packetShadow(shadowRays);
+
+		const auto scalarTime = best([&]()
+		{
+			for (size_t i = 0; i < shadowRays; i++)
+			{
+				scalarShadow[i] = RayShadow(scene, shadowOrigins[i], shadowDirections[i], distances[i], camera.farPlane) != 0.0f;
+			}
+		});
+
+		const auto packetTime = best([&]()
+		{
+			for (size_t i = 0; i < shadowPackets.size(); i++)
+			{
+				const auto count = std::min<size_t>(shadowRays - i * ShadowPacketWidth, ShadowPacketWidth);
+				const auto shadowed = ShadowPacketMask(soaScene, shadowPackets[i], (1u << count) - 1, camera.farPlane);
+
+				for (size_t lane = 0; lane < count; lane++)
+				{
+					packetShadow[i * ShadowPacketWidth + lane] = shadowed >> lane & 1;
+				}
+			}
+		});
+
+		report("shadow rays, 4 wide", shadowRays, scalarTime, packetTime);
+
+		if (scalarShadow != packetShadow)
+		{
+			fprintf(stderr, "  the shadow ray packets disagree with the scalar rays\n");
+			result = 1;
+		}
+
+		for (const auto threads : { 1u, WorkerCount() })
+		{
+			RayTraceOptions options;
+			options.threadCount = threads;
+
+			RayTargets scalarTargets, packetTargets;
+			RayStats scalarStats, packetStats;
+
+			const auto scalarFrame = best([&]()
+			{
+				scalarStats = TraceRays(scene, camera, scalarTargets, options);
+			});
+
+			const auto packetFrame = best([&]()
+			{
+				packetStats = TraceRayPackets(scene, soaScene, camera, packetTargets, options);
+			});
+
+			char name[32];
+			snprintf(name, sizeof name, "frames, %u threads", threads);
+			report(name, scalarStats.Rays(), scalarFrame, packetFrame);
+
+			if (!SameTargets(scalarTargets, packetTargets) || scalarStats.Rays() != packetStats.Rays())
+			{
+				fprintf(stderr, "  the packet frame differs from the scalar one\n");
+				result = 1;
+			}
+
+			if (WorkerCount() == 1)
+			{
+				break;
+			}
+		}
+
+		return result;
+	}
+
+	// A third each of spheres, triangles and quads scattered through a cube that grows with their
+	// number, so they stay as crowded at any count
+	RayScene RandomScene(const uint32_t pCount, const uint32_t pSeed)
+	{
+		std::mt19937 random(pSeed);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		const auto half = std::cbrt(static_cast<float>(pCount)) * 0.5f;
+		const RayMaterial material = { { 1.0f, 1.0f, 1.0f, 1.0f }, 0.5f, 0.3f, 0.1f, 40.0f };
+
+		auto point = [&](const float pScale)
+		{
+			return RayVector{ unit(random) * pScale, unit(random) * pScale, unit(random) * pScale };
+		};
+
+		RayScene scene;
+
+		for (uint32_t i = 0; i < pCount; i++)
+		{
+			const auto centre = point(half);
+
+			if (i % 3 == 0)
+			{
+				scene.spheres.push_back({ centre, 0.1f + 0.15f * (unit(random) + 1.0f), material });
+			}
+			else if (i % 3 == 1)
+			{
+				scene.triangles.push_back({ centre + point(0.4f), centre + point(0.4f), centre + point(0.4f), material });
+			}
+			else
+			{
+				auto normal = point(1.0f);
+				const auto axis = std::abs(normal.x) < 0.5f ? RayVector{ 1.0f, 0.0f, 0.0f } : RayVector{ 0.0f, 1.0f, 0.0f };
+				normal = normal.Length() > 0.01f ? normal.Normalized() : RayVector{ 0.0f, 0.0f, 1.0f };
+
+				const auto tangent = axis.Cross(normal).Normalized();
+				const auto biTangent = normal.Cross(tangent);
+				const auto sizeX = 0.1f + 0.1f * (unit(random) + 1.0f);
+				const auto sizeY = 0.1f + 0.1f * (unit(random) + 1.0f);
+
+				scene.quads.push_back({ centre, normal, tangent, biTangent, { sizeX, sizeY }, material });
+			}
+		}
+
+		return scene;
+	}
+
+	// Every indexed triangle of a .sim mesh
+	bool LoadMeshScene(const std::string & pFilename, RayScene & pScene)
+	{
+		SimLayout layout;
+		MeshBuffer mesh;
+
+		if (!DetectSimLayout(pFilename, layout) || !LoadSimText(pFilename, layout, mesh))
+		{
+			return false;
+		}
+
+		const auto & positions = mesh.Stream(MeshStream::Position);
+		const RayMaterial material = { { 1.0f, 1.0f, 1.0f, 1.0f }, 0.5f, 0.3f, 0.1f, 40.0f };
+
+		auto vertex = [&](const uint32_t pIndex)
+		{
+			return RayVector{ positions[pIndex * 3], positions[pIndex * 3 + 1], positions[pIndex * 3 + 2] };
+		};
+
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			pScene.triangles.push_back({ vertex(mesh.indices[i]), vertex(mesh.indices[i + 1]), vertex(mesh.indices[i + 2]), material });
+		}
+
+		return !pScene.triangles.empty();
+	}
+
+	// A pSide square grid of eye rays from a camera standing off the corner of the scene's box,
+	// framing all of it, returning how far past the box they need to reach
+	float SceneRays(const RayBvhNode & pRoot, const uint32_t pSide, std::vector<RayVector> & pOrigins, std::vector<RayVector> & pDirections)
+	{
+		const RayVector min = { pRoot.min[0], pRoot.min[1], pRoot.min[2] };
+		const RayVector max = { pRoot.max[0], pRoot.max[1], pRoot.max[2] };
+		const auto centre = (min + max) * 0.5f;
+		const auto radius = (max - min).Length() * 0.5f;
+
+		const auto eye = centre + RayVector{ 0.4f, 0.5f, -1.0f }.Normalized() * (radius * 2.5f);
+		const auto camera = MakeRayCamera(eye, centre, { 0.0f, 1.0f, 0.0f }, pSide, pSide, 50.0f * 3.14159265f / 180.0f);
+
+		pOrigins.resize(static_cast<size_t>(pSide) * pSide);
+		pDirections.resize(pOrigins.size());
+
+		for (uint32_t y = 0; y < pSide; y++)
+		{
+			for (uint32_t x = 0; x < pSide; x++)
+			{
+				MakeEyeRay(camera, x + 0.5f, y + 0.5f, pOrigins[y * pSide + x], pDirections[y * pSide + x]);
+			}
+		}
+
+		return radius * 4.0f;
+	}
+
+	// Times pQuery over every ray, its rows of 512 handed to the threads, best of three passes
+	template <class Query>
+	double QueryRate(const uint32_t pRayCount, Query && pQuery)
+	{
+		auto best = 0.0;
+
+		for (auto pass = 0; pass < 3; pass++)
+		{
+			const auto start = Clock::now();
+
+			ParallelFor((pRayCount + 511) / 512, [&](const uint32_t pRow)
+			{
+				for (auto ray = pRow * 512; ray < std::min(pRow * 512 + 512, pRayCount); ray++)
+				{
+					pQuery(ray);
+				}
+			});
+
+			const auto time = Milliseconds(start);
+			best = pass == 0 ? time : std::min(best, time);
+		}
+
+		return pRayCount / best / 1000.0;
+	}
+
+	template <class T>
+	bool SameArray(const std::vector<T> & pA, const std::vector<T> & pB)
+	{
+		return pA.size() == pB.size() && (pA.empty() || memcmp(pA.data(), pB.data(), pA.size() * sizeof(T)) == 0);
+	}
+
+	// Builds with every thread and with one, checking they make the same tree, then times closest
+	// hits through it against a scan of every primitive on a sample of the rays
+	bool BenchBvh(const char * pName, const RayScene & pScene)
+	{
+		const auto objects = pScene.spheres.size() + pScene.triangles.size() + pScene.quads.size();
+		const auto builds = objects >= 100000 ? 1u : objects >= 10000 ? 3u : 10u;
+
+		auto buildTime = [&](const uint32_t pThreads, std::vector<RayBvhNode> & pNodes)
+		{
+			RayBvhOptions options;
+			options.threadCount = pThreads;
+
+			auto best = 0.0;
+
+			for (uint32_t build = 0; build < builds; build++)
+			{
+				const auto start = Clock::now();
+				RayBvh bvh(pScene, options);
+				const auto time = Milliseconds(start);
+
+				best = build == 0 ? time : std::min(best, time);
+				pNodes = bvh.Nodes();
+			}
+
+			return best;
+		};
+
+		std::vector<RayBvhNode> singleNodes, nodes;
+		const auto singleBuild = buildTime(1, singleNodes);
+		const auto build = buildTime(0, nodes);
+		const RayBvh bvh(pScene);
+
+		auto result = true;
+
+		if (!SameArray(nodes, singleNodes))
+		{
+			fprintf(stderr, "  %s: the tree differs between one thread and %u\n", pName, WorkerCount());
+			result = false;
+		}
+
+		std::vector<RayVector> origins, directions;
+		const auto farPlane = SceneRays(bvh.Nodes()[0], 512, origins, directions);
+
+		const auto rayCount = static_cast<uint32_t>(origins.size());
+		std::vector<float> t(rayCount);
+		std::vector<int> hitObject(rayCount);
+
+		const auto traceRate = QueryRate(rayCount, [&](const uint32_t pRay)
+		{
+			t[pRay] = bvh.NearestHit(origins[pRay], directions[pRay], farPlane, hitObject[pRay]);
+		});
+
+		//Enough of the rays that the scan takes about as long at every size
+		const auto step = std::max(1u, static_cast<uint32_t>(objects * rayCount / (1u << 27)));
+		uint32_t checked = 0, hits = 0, mismatches = 0;
+		const auto scanStart = Clock::now();
+
+		for (uint32_t ray = 0; ray < rayCount; ray += step)
+		{
+			int scanObject;
+			const auto scanT = NearestRayHit(pScene, origins[ray], directions[ray], farPlane, scanObject);
+
+			mismatches += scanObject != hitObject[ray] || (scanObject >= 0 && scanT != t[ray]) ? 1 : 0;
+			hits += scanObject >= 0 ? 1 : 0;
+			checked++;
+		}
+
+		const auto scanRate = checked / Milliseconds(scanStart) / 1000.0;
+
+		if (mismatches != 0)
+		{
+			fprintf(stderr, "  %s: %u of %u rays hit something other than the scan found\n", pName, mismatches, checked);
+			result = false;
+		}
+
+		const auto & stats = bvh.Stats();
+
+		printf("  %-12s %8zu %9.2f %9.2f %8u %5u %7.1f %9.3f %9.4f %8.0fx %5.0f%%\n", pName, objects, build, singleBuild, stats.nodes, stats.maxDepth,
+			stats.cost, traceRate, scanRate, traceRate / scanRate, 100.0 * hits / checked);
+
+		return result;
+	}
+
+	// Casts shadow rays, as the shader makes them, from where the eye rays of SceneRays hit towards a
+	// light above the scene, and times the occlusion query against a closest hit stopping at the light
+	bool BenchShadows(const char * pName, const RayScene & pScene)
+	{
+		const RayBvh bvh(pScene);
+		const auto & root = bvh.Nodes()[0];
+
+		std::vector<RayVector> origins, directions;
+		const auto farPlane = SceneRays(root, 512, origins, directions);
+
+		const RayVector min = { root.min[0], root.min[1], root.min[2] };
+		const RayVector max = { root.max[0], root.max[1], root.max[2] };
+
+		RayCamera camera = {};
+		camera.lightPosition = (min + max) * 0.5f + RayVector{ 0.3f, 1.0f, 0.2f }.Normalized() * ((max - min).Length() * 0.75f);
+
+		std::vector<RayVector> shadowOrigins, shadowDirections;
+		std::vector<float> distances;
+
+		for (size_t ray = 0; ray < origins.size(); ray++)
+		{
+			int hitObject;
+			const auto t = bvh.NearestHit(origins[ray], directions[ray], farPlane, hitObject);
+
+			if (hitObject >= 0)
+			{
+				RayVector origin, direction;
+				float distance;
+
+				MakeShadowRay(camera, origins[ray] + directions[ray] * t, origin, direction, distance);
+				shadowOrigins.push_back(origin);
+				shadowDirections.push_back(direction);
+				distances.push_back(distance);
+			}
+		}
+
+		const auto rayCount = static_cast<uint32_t>(shadowOrigins.size());
+
+		if (rayCount == 0)
+		{
+			printf("  %-12s no eye ray hit anything\n", pName);
+			return true;
+		}
+
+		std::vector<uint8_t> nearest(rayCount), occluded(rayCount);
+
+		const auto nearestRate = QueryRate(rayCount, [&](const uint32_t pRay)
+		{
+			int hitObject;
+			bvh.NearestHit(shadowOrigins[pRay], shadowDirections[pRay], distances[pRay], hitObject);
+			nearest[pRay] = hitObject >= 0 ? 1 : 0;
+		});
+
+		const auto occludedRate = QueryRate(rayCount, [&](const uint32_t pRay)
+		{
+			occluded[pRay] = bvh.Occluded(shadowOrigins[pRay], shadowDirections[pRay], 0.0f, distances[pRay]) ? 1 : 0;
+		});
+
+		const auto objects = pScene.spheres.size() + pScene.triangles.size() + pScene.quads.size();
+		const auto step = std::max(1u, static_cast<uint32_t>(objects * rayCount / (1u << 27)));
+		uint32_t checked = 0, shadowed = 0, mismatches = 0;
+		const auto scanStart = Clock::now();
+
+		for (uint32_t ray = 0; ray < rayCount; ray += step)
+		{
+			const auto scan = RayShadow(pScene, shadowOrigins[ray], shadowDirections[ray], distances[ray], farPlane) != 0.0f ? 1 : 0;
+			mismatches += scan != occluded[ray] ? 1 : 0;
+			checked++;
+		}
+
+		const auto scanRate = checked / Milliseconds(scanStart) / 1000.0;
+
+		for (uint32_t ray = 0; ray < rayCount; ray++)
+		{
+			mismatches += nearest[ray] != occluded[ray] ? 1 : 0;
+			shadowed += occluded[ray];
+		}
+
+		printf("  %-12s %8zu %7u %5.0f%% %9.4f %10.3f %10.3f %7.2fx\n", pName, objects, rayCount, 100.0 * shadowed / rayCount, scanRate, nearestRate,
+			occludedRate, occludedRate / nearestRate);
+
+		if (mismatches != 0)
+		{
+			fprintf(stderr, "  %s: %u shadow rays disagree between the scan, the closest hit and the occlusion query\n", pName, mismatches);
+			return false;
+		}
+
+		return true;
+	}
+
+	// Runs pBench over the random scenes and then each mesh
+	int BenchScenes(const std::vector<std::string> & pMeshes, const std::function<bool(const char *, const RayScene &)> & pBench)
+	{
+		auto result = 0;
+
+		for (const auto count : { 10u, 100u, 1000u, 10000u, 100000u, 1000000u })
+		{
+			const auto name = "random " + std::to_string(count);
+
+			if (!pBench(name.c_str(), RandomScene(count, count)))
+			{
+				result = 1;
+			}
+		}
+
+		for (const auto & mesh : pMeshes)
+		{
+			RayScene scene;
+
+			if (!LoadMeshScene(mesh, scene))
+			{
+				fprintf(stderr, "%s: failed to load\n", mesh.c_str());
+				result = 1;
+				continue;
+			}
+
+			const auto slash = mesh.find_last_of("/\\");
+
+			if (!pBench(mesh.substr(slash == std::string::npos ? 0 : slash + 1).c_str(), scene))
+			{
+				result = 1;
+			}
+		}
+
+		return result;
+	}
+
+	int Bvh(const std::vector<std::string> & pMeshes)
+	{
+		printf("%u hardware threads, %u bins, 512x512 eye rays, Mrays/s across every thread\n", WorkerCount(), RayBvhBinCount);
+		printf("  scene         objects  build ms  1 thread    nodes depth    cost  bvh Mr/s scan Mr/s  speedup  hits\n");
+
+		auto result = BenchScenes(pMeshes, BenchBvh);
+
+		//The pass itself through the hierarchy, which must not change a pixel
+		const auto scene = DefaultRayScene();
+		const auto camera = StartCamera(1280, 720);
+		const RayBvh bvh(scene);
+
+		RayTraceOptions options;
+		RayTargets scanTargets, bvhTargets;
+
+		const auto scanTime = Clock::now();
+		const auto stats = TraceRays(scene, camera, scanTargets, options);
+		const auto scanFrame = Milliseconds(scanTime);
+
+		options.bvh = &bvh;
+		const auto bvhTime = Clock::now();
+		TraceRays(scene, camera, bvhTargets, options);
+		const auto bvhFrame = Milliseconds(bvhTime);
+
+		printf("\n  ray tracing pass, 1280x720: %.1f ms scanning, %.1f ms through the BVH, %.2f Mrays/s\n", scanFrame, bvhFrame,
+			stats.Rays() / bvhFrame / 1000.0);
+
+		if (!SameTargets(scanTargets, bvhTargets))
+		{
+			fprintf(stderr, "  the pass traced through the BVH differs from the scan\n");
+			result = 1;
+		}
+
+		return result;
+	}
+
+	int Shadows(const std::vector<std::string> & pMeshes)
+	{
+		printf("%u hardware threads, shadow rays from 512x512 eye rays' hits, Mrays/s across every thread\n", WorkerCount());
+		printf("  scene         objects    rays shadow scan Mr/s closest hit    any hit  speedup\n");
+
+		auto result = BenchScenes(pMeshes, BenchShadows);
+
+		//A frame's worth, where every hit casts one
+		const auto scene = DefaultRayScene();
+		const auto camera = StartCamera(1280, 720);
+		const RayBvh bvh(scene);
+
+		RayTraceOptions options;
+		options.bvh = &bvh;
+
+		RayTargets targets, scanTargets;
+		RayStats stats;
+		const auto time = BestTime(scene, camera, targets, options, 3, stats);
+
+		TraceRays(scene, camera, scanTargets);
+		printf("\n  ray tracing pass, 1280x720 through the BVH: %.1f ms, %.0f%% of its rays shadow rays\n", time, 100.0 * stats.shadowRays / stats.Rays());
+
+		if (!SameTargets(targets, scanTargets))
+		{
+			fprintf(stderr, "  the pass traced through the BVH differs from the scan\n");
+			result = 1;
+		}
+
+		return result;
+	}
+
+	bool SameScene(const RayScene & pA, const RayScene & pB)
+	{
+		return SameArray(pA.spheres, pB.spheres) && SameArray(pA.triangles, pB.triangles) && SameArray(pA.quads, pB.quads);
+	}
+
+	int Scene(const std::string & pFilename, const uint32_t pWidth, const uint32_t pHeight)
+	{
+		if (pWidth == 0 || pHeight == 0)
+		{
+			fprintf(stderr, "scene: width and height must be positive\n");
+			return 1;
+		}
+
+		RayScene scene;
+		uint32_t errorLine;
+
+		const auto loadStart = Clock::now();
+
+		if (!LoadRayScene(pFilename, scene, errorLine))
+		{
+			if (errorLine)
+			{
+				fprintf(stderr, "%s:%u: not a statement, or a material used before it is named\n", pFilename.c_str(), errorLine);
+			}
+			else
+			{
+				fprintf(stderr, "%s: failed to open\n", pFilename.c_str());
+			}
+
+			return 1;
+		}
+
+		const auto loadTime = Milliseconds(loadStart);
+		const auto gpuStart = Clock::now();
+		const auto gpuScene = MakeRayGpuScene(scene);
+		const auto gpuTime = Milliseconds(gpuStart);
+		const auto objects = scene.spheres.size() + scene.triangles.size() + scene.quads.size();
+
+		printf("%s: %zu spheres, %zu triangles, %zu quads, loaded in %.2f ms\n", pFilename.c_str(), scene.spheres.size(), scene.triangles.size(),
+			scene.quads.size(), loadTime);
+		printf("  shader buffers in %.2f ms: spheres %zu, triangles %zu, quads %zu, materials %zu bytes\n", gpuTime,
+			gpuScene.spheres.size() * sizeof(float), gpuScene.triangles.size() * sizeof(float), gpuScene.quads.size() * sizeof(float),
+			gpuScene.materials.size() * sizeof(float));
+
+		auto result = 0;
+
+		if (!SameScene(RaySceneFromGpu(gpuScene), scene))
+		{
+			fprintf(stderr, "  the scene read back from the shader buffers differs\n");
+			result = 1;
+		}
+
+		//Written and read again, every float has to come back the same
+		const auto rewritten = pFilename + ".rewrite";
+		RayScene reloaded;
+
+		if (!WriteRayScene(rewritten, scene) || !LoadRayScene(rewritten, reloaded, errorLine) || !SameScene(reloaded, scene))
+		{
+			fprintf(stderr, "  the scene does not survive being written and loaded again\n");
+			result = 1;
+		}
+
+		std::remove(rewritten.c_str());
+
+		const auto isDefault = SameScene(scene, DefaultRayScene());
+		printf("  %s DefaultRayScene\n", isDefault ? "matches" : "is not");
+
+		if (objects == 0)
+		{
+			return result;
+		}
+
+		const auto bvhStart = Clock::now();
+		const RayBvh bvh(scene);
+		const auto bvhTime = Milliseconds(bvhStart);
+
+		//The app's camera for its own scene, otherwise one standing off the corner of the scene's bounds
+		auto camera = StartCamera(pWidth, pHeight);
+
+		if (!isDefault)
+		{
+			const auto & root = bvh.Nodes()[0];
+			const RayVector min = { root.min[0], root.min[1], root.min[2] };
+			const RayVector max = { root.max[0], root.max[1], root.max[2] };
+			const auto centre = (min + max) * 0.5f;
+			const auto radius = (max - min).Length() * 0.5f;
+
+			camera = StartCamera(pWidth, pHeight, centre + RayVector{ -0.6f, 0.5f, -0.6f } * (radius * 2.0f), centre);
+			camera.farPlane = std::max(camera.farPlane, radius * 4.0f);
+		}
+
+		RayTraceOptions options;
+		options.bvh = &bvh;
+
+		RayTargets bvhTargets;
+		RayStats stats;
+		const auto bvhFrame = BestTime(scene, camera, bvhTargets, options, 3, stats);
+
+		printf("  %ux%u through the BVH, built in %.1f ms: %.1f ms, %.2f Mrays/s\n", pWidth, pHeight, bvhTime, bvhFrame, stats.Rays() / bvhFrame / 1000.0);
+
+		//Scanning is every primitive a ray, too slow to wait for on big scenes
+		if (objects > 4096)
+		{
+			return result;
+		}
+
+		RayTargets scanTargets, packetTargets;
+		const auto scanFrame = BestTime(scene, camera, scanTargets, RayTraceOptions(), 3, stats);
+
+		const auto soaScene = MakeRaySoaScene(scene);
+		const auto packetStart = Clock::now();
+		TraceRayPackets(scene, soaScene, camera, packetTargets);
+		const auto packetFrame = Milliseconds(packetStart);
+
+		printf("  scanning %.1f ms, in packets %.1f ms\n", scanFrame, packetFrame);
+
+		if (!SameTargets(bvhTargets, scanTargets) || !SameTargets(packetTargets, scanTargets))
+		{
+			fprintf(stderr, "  the BVH, scan and packet images differ\n");
+			result = 1;
+		}
+
+		return result;
+	}
+
+	int Generate(const std::string & pFilename, const uint32_t pCount, const uint32_t pSeed)
+	{
+		if (!WriteRayScene(pFilename, RandomScene(pCount, pSeed)))
+		{
+			fprintf(stderr, "generate: cannot write %s\n", pFilename.c_str());
+			return 1;
+		}
+
+		return 0;
+	}
+	// Root mean square difference of the colour targets as they are displayed, clamped to 0 to 1
+	double DisplayError(const RayTargets & pA, const RayTargets & pB)
+	{
+		auto sum = 0.0;
+
+		for (size_t i = 0; i < pA.color.size(); i++)
+		{
+			if (i % 4 == 3)
+			{
+				continue;
+			}
+
+			const auto difference = std::min(std::max(pA.color[i], 0.0f), 1.0f) - std::min(std::max(pB.color[i], 0.0f), 1.0f);
+			sum += difference * difference;
+		}
+
+		return std::sqrt(sum / (pA.color.size() / 4 * 3));
+	}
+
+	int Adaptive(const uint32_t pWidth, const uint32_t pHeight, const char * pColorFile)
+	{
+		if (pWidth == 0 || pHeight == 0)
+		{
+			fprintf(stderr, "adaptive: width and height must be positive\n");
+			return 1;
+		}
+
+		const auto camera = StartCamera(pWidth, pHeight);
+		const auto scene = DefaultRayScene();
+		const RayBvh bvh(scene);
+		const auto pixels = pWidth * pHeight;
+
+		const auto uniform = [&](const uint32_t pSamples)
+		{
+			RaySampleOptions options;
+			options.firstSamples = options.maxSamples = pSamples;
+			options.bvh = &bvh;
+			return options;
+		};
+
+		printf("%ux%u on %u threads, error is the RMS of the displayed colour against 64 samples a pixel\n", pWidth, pHeight, WorkerCount());
+
+		RayTargets reference;
+		TraceRaysAdaptive(scene, camera, reference, uniform(64));
+
+		printf("  sampling              ms  samples/px  min  max   Mrays  rounds  error x1000  x Mrays\n");
+
+		auto result = 0;
+		auto uniformFourTime = 0.0;
+
+		const auto row = [&](const char * pName, const RaySampleOptions & pOptions, RayTargets & pTargets)
+		{
+			const auto start = Clock::now();
+			const auto stats = TraceRaysAdaptive(scene, camera, pTargets, pOptions);
+			const auto time = Milliseconds(start);
+			const auto error = DisplayError(pTargets, reference);
+
+			printf("  %-18s %7.1f %11.2f %4u %4u %7.2f %7u %12.2f %8.2f\n", pName, time, stats.SamplesPerPixel(pixels), stats.minPixelSamples,
+				stats.maxPixelSamples, stats.rays.Rays() / 1e6, stats.rounds, error * 1000.0, error * 1000.0 * stats.rays.Rays() / 1e6);
+
+			return time;
+		};
+
+		RayTargets targets;
+		row("uniform 1", uniform(1), targets);
+		uniformFourTime = row("uniform 4", uniform(4), targets);
+		row("uniform 16", uniform(16), targets);
+
+		RaySampleOptions adaptive;
+		adaptive.bvh = &bvh;
+
+		RayTargets adaptiveTargets;
+		row("adaptive", adaptive, adaptiveTargets);
+
+		auto budgeted = adaptive;
+		budgeted.sampleBudget = 2.5f;
+		row("adaptive, 2.5/px", budgeted, targets);
+
+		auto timed = adaptive;
+		timed.timeBudget = uniformFourTime;
+		row("adaptive, 4's ms", timed, targets);
+
+		//Every sample is placed and chosen the same way whoever traces it
+		auto single = adaptive;
+		single.threadCount = 1;
+
+		RayTargets singleTargets;
+		TraceRaysAdaptive(scene, camera, singleTargets, single);
+
+		if (!SameTargets(singleTargets, adaptiveTargets))
+		{
+			fprintf(stderr, "  adaptive sampling on one thread differs from on %u\n", WorkerCount());
+			result = 1;
+		}
+
+		if (pColorFile && !WriteTarget(pColorFile, pWidth, pHeight, adaptiveTargets.color))
+		{
+			fprintf(stderr, "adaptive: cannot write %s\n", pColorFile);
+			result = 1;
+		}
+
+		return result;
+	}
+
+	size_t MeshBytes(const RayBvh & pBvh)
+	{
+		const auto & scene = pBvh.Scene();
+
+		return scene.spheres.size() * sizeof(RaySphere) + scene.triangles.size() * sizeof(RayTriangle) + scene.quads.size() * sizeof(RayQuad) +
+			pBvh.Nodes().size() * sizeof(RayBvhNode) + pBvh.Objects().size() * sizeof(uint32_t);
+	}
+
+	// The rocks and sculptures as Render draws them, then pScattered more rocks at random
+	std::vector<RayInstance> AppInstances(const RayVector & pEye, const uint32_t pScattered)
+	{
+		std::vector<RayInstance> instances;
+
+		instances.push_back({ 0, MakeRayTransform(0.01f, 0.0f, { 30.0f, 0.0f, 40.0f }) });
+		instances.push_back({ 0, MakeRayTransform(0.01f, 0.0f, { -30.0f, 0.0f, 40.0f }) });
+
+		//SculptureGeometryShader.hlsl's ten, turned about y to face the eye as it turns them
+		for (const auto x : { 7.5f, -7.5f })
+		{
+			for (const auto z : { 5.0f, 15.0f, 25.0f, 35.0f, 45.0f })
+			{
+				instances.push_back({ 1, MakeRayTransform(0.2f, std::atan2(pEye.x - x, pEye.z - z), { x, 10.0f, z }) });
+			}
+		}
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> x(-45.0f, 45.0f), z(-5.0f, 70.0f), scale(0.005f, 0.015f), yaw(0.0f, 6.2831853f);
+
+		for (uint32_t rock = 0; rock < pScattered; rock++)
+		{
+			const auto rockScale = scale(random);
+			const auto rockYaw = yaw(random);
+			const RayVector position = { x(random), 0.0f, z(random) };
+
+			instances.push_back({ 0, MakeRayTransform(rockScale, rockYaw, position) });
+		}
+
+		return instances;
+	}
+
+	// Each instance's primitives copied into the world, pStarts taking where each instance's begin
+	RayScene FlattenInstances(const std::vector<const RayBvh *> & pMeshes, const std::vector<RayInstance> & pInstances, std::vector<uint32_t> & pStarts)
+	{
+		RayScene scene;
+		pStarts.clear();
+
+		for (const auto & instance : pInstances)
+		{
+			const auto & transform = instance.objectToWorld;
+
+			pStarts.push_back(static_cast<uint32_t>(scene.triangles.size()));
+
+			for (auto triangle : pMeshes[instance.mesh]->Scene().triangles)
+			{
+				triangle.a = transform.Point(triangle.a);
+				triangle.b = transform.Point(triangle.b);
+				triangle.c = transform.Point(triangle.c);
+				scene.triangles.push_back(triangle);
+			}
+		}
+
+		return scene;
+	}
+
+	// The meshes' hierarchies are built once and placed with a top level as ever more rocks are
+	// scattered, against every instance's triangles copied into the world under one hierarchy. Only
+	// triangles are copied, as the meshes are.
+	int Instances(const std::string & pRockFile, const std::string & pSculptureFile)
+	{
+		RayScene rock, sculpture;
+
+		if (!LoadMeshScene(pRockFile, rock) || !LoadMeshScene(pSculptureFile, sculpture))
+		{
+			fprintf(stderr, "instances: failed to load %s or %s\n", pRockFile.c_str(), pSculptureFile.c_str());
+			return 1;
+		}
+
+		const auto meshStart = Clock::now();
+		const RayBvh rockBvh(rock);
+		const RayBvh sculptureBvh(sculpture);
+		const auto meshBuild = Milliseconds(meshStart);
+
+		const std::vector<const RayBvh *> meshes = { &rockBvh, &sculptureBvh };
+		const auto meshBytes = MeshBytes(rockBvh) + MeshBytes(sculptureBvh);
+
+		const RayVector eye = { 0.0f, 15.0f, -15.0f };
+		const auto camera = MakeRayCamera(eye, { 0.0f, 2.0f, 35.0f }, { 0.0f, 1.0f, 0.0f }, 512, 512, 60.0f * 3.14159265f / 180.0f);
+		const RayVector light = { 0.0f, 40.0f, 25.0f };
+		const auto farPlane = 1000.0f;
+
+		std::vector<RayVector> origins(512 * 512), directions(origins.size());
+
+		for (uint32_t y = 0; y < 512; y++)
+		{
+			for (uint32_t x = 0; x < 512; x++)
+			{
+				MakeEyeRay(camera, x + 0.5f, y + 0.5f, origins[y * 512 + x], directions[y * 512 + x]);
+			}
+		}
+
+		const auto rayCount = static_cast<uint32_t>(origins.size());
+
+		printf("%u hardware threads, meshes of %zu and %zu triangles built once in %.2f ms into %.2f MB, 512x512 eye rays, Mrays/s\n",
+			WorkerCount(), rock.triangles.size(), sculpture.triangles.size(), meshBuild, meshBytes / 1048576.0);
+		printf("  scattered instances triangles    flat MB inst MB  flat ms  top ms  flat Mr/s inst Mr/s  flat shadow inst shadow  hits  differ\n");
+
+		auto result = 0;
+
+		for (const auto scattered : { 0u, 10u, 100u, 1000u })
+		{
+			const auto instances = AppInstances(eye, scattered);
+
+			std::vector<uint32_t> starts;
+			const auto flatScene = FlattenInstances(meshes, instances, starts);
+
+			auto start = Clock::now();
+			const RayBvh flat(flatScene);
+			const auto flatBuild = Milliseconds(start);
+
+			start = Clock::now();
+			const RayInstanceBvh instanced(meshes, instances);
+			const auto topBuild = Milliseconds(start);
+
+			std::vector<float> flatT(rayCount), instancedT(rayCount);
+			std::vector<int> flatObject(rayCount), instancedObject(rayCount), instancedInstance(rayCount);
+
+			const auto flatRate = QueryRate(rayCount, [&](const uint32_t pRay)
+			{
+				flatT[pRay] = flat.NearestHit(origins[pRay], directions[pRay], farPlane, flatObject[pRay]);
+			});
+
+			const auto instancedRate = QueryRate(rayCount, [&](const uint32_t pRay)
+			{
+				instancedT[pRay] = instanced.NearestHit(origins[pRay], directions[pRay], farPlane, instancedInstance[pRay], instancedObject[pRay]);
+			});
+
+			std::vector<RayVector> shadowOrigins, shadowDirections;
+			std::vector<float> distances;
+			uint32_t hits = 0, differ = 0, mismatches = 0;
+
+			for (uint32_t ray = 0; ray < rayCount; ray++)
+			{
+				const auto flatHit = flatObject[ray] >= 0;
+				const auto instancedHit = instancedObject[ray] >= 0;
+
+				//A different triangle at the same distance is an edge shared within a mesh
+				if (flatHit != instancedHit || (flatHit && std::abs(flatT[ray] - instancedT[ray]) > 1e-3f * flatT[ray]))
+				{
+					differ++;
+				}
+				else if (flatHit && flatObject[ray] != static_cast<int>(starts[instancedInstance[ray]]) + instancedObject[ray] &&
+					flatT[ray] != instancedT[ray])
+				{
+					differ++;
+				}
+
+				if (instancedHit)
+				{
+					RayVector origin, direction;
+					float distance;
+					RayCamera lightCamera = {};
+					lightCamera.lightPosition = light;
+
+					MakeShadowRay(lightCamera, origins[ray] + directions[ray] * instancedT[ray], origin, direction, distance);
+					shadowOrigins.push_back(origin);
+					shadowDirections.push_back(direction);
+					distances.push_back(distance);
+					hits++;
+				}
+			}
+
+			const auto shadowCount = static_cast<uint32_t>(shadowOrigins.size());
+			std::vector<uint8_t> flatShadow(shadowCount), instancedShadow(shadowCount);
+
+			const auto flatShadowRate = QueryRate(shadowCount, [&](const uint32_t pRay)
+			{
+				flatShadow[pRay] = flat.Occluded(shadowOrigins[pRay], shadowDirections[pRay], 0.0f, distances[pRay]) ? 1 : 0;
+			});
+
+			const auto instancedShadowRate = QueryRate(shadowCount, [&](const uint32_t pRay)
+			{
+				instancedShadow[pRay] = instanced.Occluded(shadowOrigins[pRay], shadowDirections[pRay], 0.0f, distances[pRay]) ? 1 : 0;
+			});
+
+			for (uint32_t ray = 0; ray < shadowCount; ray++)
+			{
+				int hitInstance, hitObject;
+				instanced.NearestHit(shadowOrigins[ray], shadowDirections[ray], distances[ray], hitInstance, hitObject);
+
+				differ += flatShadow[ray] != instancedShadow[ray] ? 1 : 0;
+				mismatches += (hitObject >= 0 ? 1 : 0) != instancedShadow[ray] ? 1 : 0;
+			}
+
+			const auto flatBytes = MeshBytes(flat);
+			const auto instancedBytes = meshBytes + instanced.Bytes();
+
+			printf("  %9u %9zu %9zu %10.2f %7.2f %8.2f %7.3f %10.3f %9.3f %12.3f %11.3f %4.0f%% %6.3f%%\n", scattered, instances.size(),
+				flatScene.triangles.size(), flatBytes / 1048576.0, instancedBytes / 1048576.0, flatBuild, topBuild, flatRate, instancedRate,
+				flatShadowRate, instancedShadowRate, 100.0 * hits / rayCount, 100.0 * differ / (rayCount + shadowCount));
+
+			//Rounding in and out of an instance's space moves grazing hits, so only a few may differ
+			//from the copied triangles, but the instances' own queries must agree exactly
+			if (differ * 1000 > rayCount + shadowCount)
+			{
+				fprintf(stderr, "  %u scattered: %u of %u rays differ from the copied triangles\n", scattered, differ, rayCount + shadowCount);
+				result = 1;
+			}
+
+			if (mismatches != 0)
+			{
+				fprintf(stderr, "  %u scattered: %u shadow rays disagree between the occlusion query and the closest hit\n", scattered, mismatches);
+				result = 1;
+			}
+		}
+
+		return result;
+	}
+
+	// The wavefront against the megakernel TraceRays and TraceRayPackets, scanning and through a BVH,
+	// with where the wavefront's time goes and what its wave size costs. Every image must match
+	// TraceRays'.
+	int Wavefront(const uint32_t pWidth, const uint32_t pHeight, const uint32_t pFrames)
+	{
+		if (pWidth == 0 || pHeight == 0 || pFrames == 0)
+		{
+			fprintf(stderr, "wavefront: width, height and frames must be positive\n");
+			return 1;
+		}
+
+		const auto camera = StartCamera(pWidth, pHeight);
+		const auto scene = DefaultRayScene();
+		const auto soaScene = MakeRaySoaScene(scene);
+		const RayBvh bvh(scene);
+
+		auto result = 0;
+		RayTargets reference;
+		const auto stats = TraceRays(scene, camera, reference);
+
+		printf("%ux%u, best of %u frames, %u hardware threads, %.2f rays a pixel, %llu primary, %llu reflection, %llu shadow\n", pWidth, pHeight,
+			pFrames, WorkerCount(), static_cast<double>(stats.Rays()) / stats.primaryRays, static_cast<unsigned long long>(stats.primaryRays),
+			static_cast<unsigned long long>(stats.reflectionRays), static_cast<unsigned long long>(stats.shadowRays));
+		printf("  %-24s %9s %9s %8s\n", "", "ms", "Mrays/s", "speedup");
+
+		auto frame = [&](const char * pName, const std::function<void(RayTargets &)> & pTrace, const double pBaseline)
+		{
+			RayTargets targets;
+			auto time = 0.0;
+
+			for (uint32_t i = 0; i < pFrames; i++)
+			{
+				const auto start = Clock::now();
+				pTrace(targets);
+				time = i == 0 ? Milliseconds(start) : std::min(time, Milliseconds(start));
+			}
+
+			if (!SameTargets(targets, reference))
+			{
+				fprintf(stderr, "  %s: the targets differ from TraceRays'\n", pName);
+				result = 1;
+			}
+
+			printf("  %-24s %9.1f %9.2f %7.2fx\n", pName, time, stats.Rays() / time / 1000.0, pBaseline > 0.0 ? pBaseline / time : 1.0);
+			return time;
+		};
+
+		RayWavefrontStats waveStats;
+
+		const auto megakernel = frame("megakernel", [&](RayTargets & pTargets)
+		{
+			TraceRays(scene, camera, pTargets);
+		}, 0.0);
+
+		const auto megakernelPackets = frame("megakernel packets", [&](RayTargets & pTargets)
+		{
+			TraceRayPackets(scene, soaScene, camera, pTargets);
+		}, megakernel);
+
+		frame("wavefront", [&](RayTargets & pTargets)
+		{
+			waveStats = TraceRaysWavefront(scene, soaScene, camera, pTargets);
+		}, megakernelPackets);
+
+		RayTraceOptions bvhOptions;
+		bvhOptions.bvh = &bvh;
+
+		const auto megakernelBvh = frame("megakernel BVH", [&](RayTargets & pTargets)
+		{
+			TraceRays(scene, camera, pTargets, bvhOptions);
+		}, megakernel);
+
+		RayWavefrontOptions waveBvhOptions;
+		waveBvhOptions.bvh = &bvh;
+
+		frame("wavefront BVH", [&](RayTargets & pTargets)
+		{
+			TraceRaysWavefront(scene, soaScene, camera, pTargets, waveBvhOptions);
+		}, megakernelBvh);
+
+		//The megakernel's packets carry lanes whose rays have stopped, where the wavefront's are full but for each queue's last
+		const auto bounceRays = stats.primaryRays + stats.reflectionRays;
+
+		printf("\n  wavefront stages of the last frame, ms: generate %.2f, extend %.2f, shade %.2f, shadow %.2f, accumulate %.2f\n",
+			waveStats.generateMilliseconds, waveStats.extendMilliseconds, waveStats.shadeMilliseconds, waveStats.shadowMilliseconds,
+			waveStats.accumulateMilliseconds);
+		printf("  extend packets %.1f%% full over %u waves\n\n  wave size       ms   Mrays/s\n",
+			100.0 * bounceRays / (waveStats.packets * RayPacketWidth), waveStats.waves);
+
+		for (const auto waveSize : { 4096u, 16384u, 65536u, 262144u, 1048576u })
+		{
+			RayWavefrontOptions options;
+			options.waveSize = waveSize;
+
+			RayTargets targets;
+			auto time = 0.0;
+
+			for (uint32_t i = 0; i < pFrames; i++)
+			{
+				const auto start = Clock::now();
+				TraceRaysWavefront(scene, soaScene, camera, targets, options);
+				time = i == 0 ? Milliseconds(start) : std::min(time, Milliseconds(start));
+			}
+
+			if (!SameTargets(targets, reference))
+			{
+				fprintf(stderr, "  waves of %u: the targets differ from TraceRays'\n", waveSize);
+				result = 1;
+			}
+
+			printf("  %9u %8.1f %9.2f\n", waveSize, time, stats.Rays() / time / 1000.0);
+		}
+
+		return result;
+	}
+
+	//The scheduler's tile orders, with a shared queue and with stealing, and with fixed and adaptive
+	//tiles, against the pass's own rows of 16 pixel tiles. Each schedule is run for every frame so the
+	//adaptive ones learn the costs, and the best frame kept.
+	bool BenchTiles(const char * pName, const uint32_t pWidth, const uint32_t pHeight, const uint32_t pFrames,
+		const std::function<void(RayTargets &, TileScheduler *)> & pPass, const std::string & pHeatmapFile)
+	{
+		struct Schedule
+		{
+			const char * name;
+			TileOrder order;
+			uint32_t minTileSize;
+			uint32_t maxTileSize;
+			bool stealing;
+		};
+
+		const Schedule schedules[] =
+		{
+			{ "rows, queue", TileOrder::Rows, 16, 16, false },
+			{ "morton, queue", TileOrder::Morton, 16, 16, false },
+			{ "hilbert, queue", TileOrder::Hilbert, 16, 16, false },
+			{ "hilbert, stealing", TileOrder::Hilbert, 16, 16, true },
+			{ "rows, adaptive, stealing", TileOrder::Rows, 8, 64, true },
+			{ "hilbert, adaptive, stealing", TileOrder::Hilbert, 8, 64, true }
+		};
+
+		auto result = true;
+		RayTargets reference;
+
+		auto best = [&](TileScheduler * pScheduler, RayTargets & pTargets)
+		{
+			auto time = 0.0;
+
+			for (uint32_t i = 0; i < pFrames; i++)
+			{
+				const auto start = Clock::now();
+				pPass(pTargets, pScheduler);
+				time = i == 0 ? Milliseconds(start) : std::min(time, Milliseconds(start));
+			}
+
+			return time;
+		};
+
+		const auto baseline = best(nullptr, reference);
+
+		printf("%s, %ux%u, best of %u frames, %u hardware threads\n", pName, pWidth, pHeight, pFrames, WorkerCount());
+		printf("  %-28s %8s %8s %6s %7s %9s\n", "", "ms", "speedup", "tiles", "steals", "imbalance");
+		printf("  %-28s %8.1f %7.2fx\n", "rows of 16, ParallelFor", baseline, 1.0);
+
+		for (const auto & schedule : schedules)
+		{
+			TileScheduleOptions options;
+			options.order = schedule.order;
+			options.minTileSize = schedule.minTileSize;
+			options.maxTileSize = schedule.maxTileSize;
+			options.stealing = schedule.stealing;
+
+			TileScheduler scheduler(options);
+			RayTargets targets;
+			const auto time = best(&scheduler, targets);
+			const auto & stats = scheduler.Stats();
+
+			if (!SameTargets(targets, reference))
+			{
+				fprintf(stderr, "  %s: the targets differ from the pass's own tiles'\n", schedule.name);
+				result = false;
+			}
+
+			printf("  %-28s %8.1f %7.2fx %6u %7u %8.2fx\n", schedule.name, time, baseline / time, stats.tiles, stats.steals,
+				stats.meanBusyMilliseconds > 0.0 ? stats.busiestMilliseconds / stats.meanBusyMilliseconds : 1.0);
+
+			if (&schedule != &schedules[std::size(schedules) - 1])
+			{
+				continue;
+			}
+
+			//How uneven the last schedule found the image, and the tiles it cut to match
+			auto costs = scheduler.CellCosts();
+			std::sort(costs.begin(), costs.end());
+
+			auto percentile = [&](const double pShare)
+			{
+				return costs[std::min(costs.size() - 1, static_cast<size_t>(pShare * costs.size()))];
+			};
+
+			printf("  ns a pixel over %u cells: least %.0f, median %.0f, 90%% %.0f, most %.0f\n  tiles of", scheduler.CellsWide() * scheduler.CellsHigh(),
+				costs.front(), percentile(0.5), percentile(0.9), costs.back());
+
+			for (auto size = options.minTileSize; size <= options.maxTileSize; size *= 2)
+			{
+				const auto count = std::count_if(scheduler.Tiles().begin(), scheduler.Tiles().end(), [&](const RenderTile & pTile)
+				{
+					return std::max(pTile.width, pTile.height) > size / 2 && std::max(pTile.width, pTile.height) <= size;
+				});
+
+				printf(" %u: %u", size, static_cast<uint32_t>(count));
+			}
+
+			printf("\n");
+
+			if (!pHeatmapFile.empty())
+			{
+				std::vector<float> heatmap;
+				scheduler.Heatmap(heatmap, true);
+
+				if (!WriteTarget(pHeatmapFile.c_str(), pWidth, pHeight, heatmap))
+				{
+					fprintf(stderr, "  could not write %s\n", pHeatmapFile.c_str());
+					result = false;
+				}
+				else
+				{
+					printf("  heatmap written to %s\n", pHeatmapFile.c_str());
+				}
+			}
+		}
+
+		return result;
+	}
+
+	int Tiles(const uint32_t pWidth, const uint32_t pHeight, const uint32_t pFrames, const std::string & pHeatmapPrefix)
+	{
+		if (pWidth < 4 || pHeight < 4 || pFrames == 0)
+		{
+			fprintf(stderr, "tiles: width and height must be at least 4 and frames positive\n");
+			return 1;
+		}
+
+		const auto scene = DefaultRayScene();
+		const RayBvh bvh(scene);
+		const auto traceCamera = StartCamera(pWidth, pHeight);
+
+		auto result = BenchTiles("ray tracer through a BVH", pWidth, pHeight, pFrames, [&](RayTargets & pTargets, TileScheduler * pScheduler)
+		{
+			RayTraceOptions options;
+			options.bvh = &bvh;
+			options.scheduler = pScheduler;
+
+			TraceRays(scene, traceCamera, pTargets, options);
+		}, pHeatmapPrefix.empty() ? "" : pHeatmapPrefix + "tracer.dds");
+
+		printf("\n");
+
+		//A quarter of the size each way, the marcher taking up to 300 scene evaluations a pixel
+		const auto marchCamera = StartCamera(pWidth / 4, pHeight / 4);
+
+		result &= BenchTiles("ray marcher", pWidth / 4, pHeight / 4, pFrames, [&](RayTargets & pTargets, TileScheduler * pScheduler)
+		{
+			MarchOptions options;
+			options.scheduler = pScheduler;
+
+			MarchRays(marchCamera, 0.0f, pTargets, options);
+		}, pHeatmapPrefix.empty() ? "" : pHeatmapPrefix + "marcher.dds");
+
+		return result ? 0 : 1;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if ((argc == 6 || argc == 12) && std::string(argv[1]) == "render")
+	{
+		float view[6];
+
+		for (auto i = 0; argc == 12 && i < 6; i++)
+		{
+			view[i] = static_cast<float>(atof(argv[6 + i]));
+		}
+
+		return Render(static_cast<uint32_t>(atoi(argv[2])), static_cast<uint32_t>(atoi(argv[3])), argv[4], argv[5], argc == 12 ? view : nullptr);
+	}
+
+	if (argc >= 2 && argc <= 5 && std::string(argv[1]) == "bench")
+	{
+		return Bench(argc >= 3 ? static_cast<uint32_t>(atoi(argv[2])) : 1280, argc >= 4 ? static_cast<uint32_t>(atoi(argv[3])) : 720,
+			argc >= 5 ? static_cast<uint32_t>(atoi(argv[4])) : 5);
+	}
+
+	if (argc >= 2 && argc <= 5 && std::string(argv[1]) == "packets")
+	{
+		return Packets(argc >= 3 ? static_cast<uint32_t>(atoi(argv[2])) : 1280, argc >= 4 ? static_cast<uint32_t>(atoi(argv[3])) : 720,
+			argc >= 5 ? static_cast<uint32_t>(atoi(argv[4])) : 5);
+	}
+
+	if (argc >= 2 && std::string(argv[1]) == "bvh")
+	{
+		return Bvh(std::vector<std::string>(argv + 2, argv + argc));
+	}
+
+	if (argc >= 2 && std::string(argv[1]) == "shadows")
+	{
+		return Shadows(std::vector<std::string>(argv + 2, argv + argc));
+	}
+
+	if (argc >= 3 && argc <= 5 && std::string(argv[1]) == "scene")
+	{
+		return Scene(argv[2], argc >= 4 ? static_cast<uint32_t>(atoi(argv[3])) : 1280, argc >= 5 ? static_cast<uint32_t>(atoi(argv[4])) : 720);
+	}
+
+	if (argc >= 2 && argc <= 5 && std::string(argv[1]) == "adaptive")
+	{
+		return Adaptive(argc >= 3 ? static_cast<uint32_t>(atoi(argv[2])) : 640, argc >= 4 ? static_cast<uint32_t>(atoi(argv[3])) : 360,
+			argc >= 5 ? argv[4] : nullptr);
+	}
+
+	if ((argc == 4 || argc == 5) && std::string(argv[1]) == "generate")
+	{
+		return Generate(argv[2], static_cast<uint32_t>(atoi(argv[3])), argc == 5 ? static_cast<uint32_t>(atoi(argv[4])) : 1);
+	}
+
+	if (argc >= 2 && argc <= 5 && std::string(argv[1]) == "wavefront")
+	{
+		return Wavefront(argc >= 3 ? static_cast<uint32_t>(atoi(argv[2])) : 1280, argc >= 4 ? static_cast<uint32_t>(atoi(argv[3])) : 720,
+			argc >= 5 ? static_cast<uint32_t>(atoi(argv[4])) : 5);
+	}
+
+	if (argc >= 2 && argc <= 6 && std::string(argv[1]) == "tiles")
+	{
+		return Tiles(argc >= 3 ? static_cast<uint32_t>(atoi(argv[2])) : 1280, argc >= 4 ? static_cast<uint32_t>(atoi(argv[3])) : 720,
+			argc >= 5 ? static_cast<uint32_t>(atoi(argv[4])) : 5, argc >= 6 ? argv[5] : "");
+	}
+
+	if (argc == 4 && std::string(argv[1]) == "instances")
+	{
+		return Instances(argv[2], argv[3]);
+	}
+
+	fprintf(stderr, "usage: RayTool render <width> <height> <color.dds> <position.dds> [eyeX eyeY eyeZ targetX targetY targetZ]\n"
+		"       RayTool bench [width] [height] [frames]\n"
+		"       RayTool packets [width] [height] [frames]\n"
+		"       RayTool bvh [file.sim]...\n"
+		"       RayTool shadows [file.sim]...\n"
+		"       RayTool scene <file.scene> [width] [height]\n"
+		"       RayTool generate <file.scene> <count> [seed]\n"
+		"       RayTool adaptive [width] [height] [color.dds]\n"
+		"       RayTool instances <rock.sim> <sculpture.sim>\n"
+		"       RayTool wavefront [width] [height] [frames]\n"
+		"       RayTool tiles [width] [height] [frames] [heatmap prefix]\n");
+	return 1;
+}
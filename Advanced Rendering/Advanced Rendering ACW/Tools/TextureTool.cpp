@@ -0,0 +1,1424 @@
+// Offline texture tool, built outside the app from the portable texture sources:
+//
+//   g++ -std=c++17 -O2 -pthread -mavx2 -I.. TextureTool.cpp ../AssetCache.cpp ../BlockCompressor.cpp ../DdsParser.cpp ../MappedFile.cpp ../MipGenerator.cpp ../TextureCooker.cpp ../TexturePacker.cpp ../TextureSampler.cpp ../VirtualTexture.cpp -o TextureTool
+//
+//   TextureTool info <file.dds>...                            Format, size and surface layout as the loader sees it
+//   TextureTool parse <file.dds>...                           Parse rate of the mapped file, and the cost of reading every surface
+//   TextureTool fuzz [iterations] <file.dds>...               Parse mutated copies of each file and of built in seeds, checking every surface view
+//   TextureTool compress <color|single|normal> <fast|normal|high> <input.dds> <output.dds>
+//                                                             Block compress a texture as the app cooks it
+//   TextureTool encode <file.dds>...                          Megapixels per second, PSNR and size of every format and quality
+//   TextureTool mips <file.dds>...                            Time to build the full chain with each filter, and the 1x1 level it ends at
+//   TextureTool cook <dir> <file.dds>...                      Uncached, cold and warm cooks through a cooked cache in dir, as the app cooks them
+//   TextureTool pack <array|atlas> <output.dds> <name=file.dds>...
+//                                                             Pack textures into one array or atlas, writing the manifest beside it as .pack
+//   TextureTool sample <file.dds>...                          CPU sampling cost of the mipped texture uncompressed and block compressed
+//   TextureTool virtual <size> <file.dds> [path.txt]          Replay a camera path over a size square virtual texture made from the file,
+//                                                             reporting tile hit rates and resident bytes at several budgets
+//
+// Build fuzz with -fsanitize=address,undefined so a view past the end of the buffer faults. Without
+// -mavx2 the compressor and mip generator use their SSE2 paths.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BlockCompressor.h"
+#include "DdsParser.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "Parallel.h"
+#include "TextureCooker.h"
+#include "TexturePacker.h"
+#include "TextureSampler.h"
+#include "VirtualTexture.h"
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	double Milliseconds(const Clock::time_point pStart)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - pStart).count();
+	}
+
+	// Reads every byte of every surface, so a parse is only counted as good once its views can be used
+	uint32_t Checksum(const DdsImage & pImage)
+	{
+		uint32_t sum = 0;
+
+		for (const auto & surface : pImage.surfaces)
+		{
+			const auto bytes = surface.slicePitch * surface.depth;
+
+			for (size_t i = 0; i < bytes; i++)
+			{
+				sum = sum * 31 + surface.data[i];
+			}
+		}
+
+		return sum;
+	}
+
+	// Checks the views against the buffer they were parsed from and against each other
+	bool Valid(const DdsImage & pImage, const uint8_t * pData, const size_t pSize)
+	{
+		if (pImage.surfaces.size() != static_cast<size_t>(pImage.mipCount) * pImage.arraySize)
+		{
+			return false;
+		}
+
+		const uint8_t * previous = pData;
+
+		for (const auto & surface : pImage.surfaces)
+		{
+			const auto bytes = surface.slicePitch * surface.depth;
+
+			if (surface.data < previous || surface.data > pData + pSize || bytes > static_cast<size_t>(pData + pSize - surface.data) ||
+				surface.width == 0 || surface.height == 0 || surface.depth == 0 || surface.rowPitch * surface.rows != surface.slicePitch)
+			{
+				return false;
+			}
+
+			previous = surface.data + bytes;
+		}
+
+		return true;
+	}
+
+	const char * DimensionName(const DdsDimension pDimension)
+	{
+		switch (pDimension)
+		{
+		case DdsDimension::Texture1D:
+			return "1D";
+		case DdsDimension::Texture2D:
+			return "2D";
+		case DdsDimension::Texture3D:
+			return "3D";
+		default:
+			return "unknown";
+		}
+	}
+
+	int Info(char ** pFiles, const int pCount)
+	{
+		auto result = 0;
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			MappedFile file;
+			if (!file.Open(pFiles[i]))
+			{
+				fprintf(stderr, "%s: cannot open\n", pFiles[i]);
+				result = 1;
+				continue;
+			}
+
+			DdsImage image;
+			const auto error = ParseDds(file.Data(), file.Size(), image);
+
+			if (error != DdsError::None)
+			{
+				fprintf(stderr, "%s: %s\n", pFiles[i], DdsErrorString(error));
+				result = 1;
+				continue;
+			}
+
+			printf("%s\n  %s %ux%ux%u, format %u, %u mips, %u items%s\n", pFiles[i], DimensionName(image.dimension),
+				image.width, image.height, image.depth, static_cast<uint32_t>(image.format), image.mipCount, image.arraySize,
+				image.cubeMap ? " (cube)" : "");
+
+			for (uint32_t j = 0; j < image.mipCount; j++)
+			{
+				const auto & surface = image.Surface(j);
+				printf("  mip %2u  %5ux%-5u offset %8zu  pitch %6zu  %8zu bytes\n", j, surface.width, surface.height,
+					static_cast<size_t>(surface.data - file.Data()), surface.rowPitch, surface.slicePitch * surface.depth);
+			}
+		}
+
+		return result;
+	}
+
+	int Parse(char ** pFiles, const int pCount)
+	{
+		auto result = 0;
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			MappedFile file;
+			if (!file.Open(pFiles[i]))
+			{
+				fprintf(stderr, "%s: cannot open\n", pFiles[i]);
+				result = 1;
+				continue;
+			}
+
+			const auto megabytes = file.Size() / (1024.0 * 1024.0);
+			DdsImage image;
+
+			if (ParseDds(file.Data(), file.Size(), image) != DdsError::None || !Valid(image, file.Data(), file.Size()))
+			{
+				fprintf(stderr, "%s: does not parse\n", pFiles[i]);
+				result = 1;
+				continue;
+			}
+
+			//Parsing only reads the headers, so it is repeated enough to time it
+			const auto parses = 1000000;
+			auto valid = true;
+
+			auto start = Clock::now();
+			for (auto j = 0; j < parses; j++)
+			{
+				valid &= ParseDds(file.Data(), file.Size(), image) == DdsError::None;
+			}
+			const auto parse = Milliseconds(start) / parses;
+
+			//Reading the views is what an upload or decode pays on top, from the page cache
+			const auto reads = std::max(1, static_cast<int>(256.0 / megabytes));
+			uint32_t sum = 0;
+
+			start = Clock::now();
+			for (auto j = 0; j < reads; j++)
+			{
+				sum += Checksum(image);
+			}
+			const auto read = Milliseconds(start) / reads;
+
+			printf("%s (%.2f MB, %u surfaces)\n  parse %8.1f ns  %10.0f parses/s  %10.0f MB/s\n  read  %8.3f ms  %10.1f MB/s  (%08x)\n",
+				pFiles[i], megabytes, static_cast<uint32_t>(image.surfaces.size()), parse * 1000000.0, 1000.0 / parse,
+				megabytes * 1000.0 / parse, read, megabytes * 1000.0 / read, sum);
+
+			if (!valid)
+			{
+				result = 1;
+			}
+		}
+
+		return result;
+	}
+
+	void Put32(std::vector<uint8_t> & pData, const size_t pOffset, const uint32_t pValue)
+	{
+		memcpy(pData.data() + pOffset, &pValue, sizeof pValue);
+	}
+
+	// A DDS file with the given header fields and zero filled surfaces. pFourCC of "DX10" adds the
+	// extended header with pFormat, pDimension, pMisc and pArraySize.
+	std::vector<uint8_t> MakeSeed(const uint32_t pWidth, const uint32_t pHeight, const uint32_t pDepth, const uint32_t pMips,
+		const uint32_t pFourCC, const uint32_t pFormat, const uint32_t pDimension, const uint32_t pMisc, const uint32_t pArraySize,
+		const uint32_t pFlags, const uint32_t pCaps2, const size_t pBytes)
+	{
+		const auto dx10 = pFourCC == 0x30315844;
+		std::vector<uint8_t> data(128 + (dx10 ? 20 : 0) + pBytes);
+
+		Put32(data, 0, 0x20534444);
+		Put32(data, 4, 124);
+		Put32(data, 8, 0x1007 | pFlags);
+		Put32(data, 12, pHeight);
+		Put32(data, 16, pWidth);
+		Put32(data, 24, pDepth);
+		Put32(data, 28, pMips);
+		Put32(data, 76, 32);
+		Put32(data, 80, 0x4);
+		Put32(data, 84, pFourCC);
+		Put32(data, 112, 0x1000);
+		Put32(data, 116, pCaps2);
+
+		if (dx10)
+		{
+			Put32(data, 128, pFormat);
+			Put32(data, 132, pDimension);
+			Put32(data, 136, pMisc);
+			Put32(data, 140, pArraySize);
+		}
+
+		return data;
+	}
+
+	// Files for the layouts the app's own textures do not cover: DX10 arrays, cube maps, volumes
+	// and block compression with full mip chains.
+	std::vector<std::vector<uint8_t>> BuiltInSeeds()
+	{
+		std::vector<std::vector<uint8_t>> seeds;
+
+		//BC1 64x64 array of 2, 7 mips: 2 * (2048 + 512 + 128 + 32 + 8 + 8 + 8) bytes
+		seeds.push_back(MakeSeed(64, 64, 0, 7, 0x30315844, 71, 3, 0, 2, 0x20000, 0, 2 * 2744));
+
+		//DXT5 16x16 cube, 5 mips: 6 * (256 + 64 + 16 + 16 + 16) bytes
+		seeds.push_back(MakeSeed(16, 16, 0, 5, 0x35545844, 0, 0, 0, 0, 0x20000, 0xFE00, 6 * 368));
+
+		//R8G8B8A8 8x8x8 volume, 4 mips: 2048 + 256 + 32 + 4 bytes
+		seeds.push_back(MakeSeed(8, 8, 8, 4, 0x30315844, 28, 4, 0, 1, 0x820000, 0, 2340));
+
+		//R16 256 wide 1D array of 3, 9 mips
+		seeds.push_back(MakeSeed(256, 1, 0, 9, 0x30315844, 56, 2, 0, 3, 0x20000, 0, 3 * 1022));
+
+		return seeds;
+	}
+
+	// One of the header words, a single bit, or the length
+	void Mutate(std::vector<uint8_t> & pData, std::mt19937 & pRandom)
+	{
+		static const uint32_t interesting[] = { 0, 1, 2, 3, 4, 6, 7, 0xFF, 0x8000, 0xFFFF, 0x10000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF };
+
+		const auto headerWords = std::min<size_t>(pData.size(), 148) / 4;
+
+		switch (pRandom() % 4)
+		{
+		case 0:
+			if (headerWords > 0)
+			{
+				Put32(pData, (pRandom() % headerWords) * 4, interesting[pRandom() % (sizeof interesting / sizeof interesting[0])]);
+			}
+			break;
+
+		case 1:
+			if (headerWords > 0)
+			{
+				Put32(pData, (pRandom() % headerWords) * 4, static_cast<uint32_t>(pRandom()));
+			}
+			break;
+
+		case 2:
+			if (!pData.empty())
+			{
+				pData[pRandom() % pData.size()] ^= static_cast<uint8_t>(1u << (pRandom() % 8));
+			}
+			break;
+
+		default:
+			pData.resize(pData.empty() ? 0 : pRandom() % pData.size());
+			break;
+		}
+	}
+
+	int Fuzz(const int pIterations, char ** pFiles, const int pCount)
+	{
+		auto seeds = BuiltInSeeds();
+		auto result = 0;
+
+		for (auto i = 0; i < static_cast<int>(seeds.size()); i++)
+		{
+			DdsImage image;
+			const auto error = ParseDds(seeds[i].data(), seeds[i].size(), image);
+
+			if (error != DdsError::None)
+			{
+				fprintf(stderr, "built in seed %d: %s\n", i, DdsErrorString(error));
+				result = 1;
+			}
+		}
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			MappedFile file;
+			if (!file.Open(pFiles[i]))
+			{
+				fprintf(stderr, "%s: cannot open\n", pFiles[i]);
+				result = 1;
+				continue;
+			}
+
+			seeds.emplace_back(file.Data(), file.Data() + file.Size());
+		}
+
+		std::mt19937 random(1234);
+		uint32_t errors[static_cast<int>(DdsError::Truncated) + 1] = {};
+		uint32_t sum = 0;
+
+		const auto start = Clock::now();
+
+		for (auto i = 0; i < pIterations; i++)
+		{
+			//Mutations stack, so most iterations get past the magic and size checks with a few changes
+			auto data = seeds[i % seeds.size()];
+			const auto mutations = 1 + random() % 4;
+
+			for (uint32_t j = 0; j < mutations; j++)
+			{
+				Mutate(data, random);
+			}
+
+			//Exactly sized, so the sanitisers catch a read one past the end
+			std::unique_ptr<uint8_t[]> buffer(new uint8_t[std::max<size_t>(data.size(), 1)]);
+			std::copy(data.begin(), data.end(), buffer.get());
+
+			DdsImage image;
+			const auto error = ParseDds(buffer.get(), data.size(), image);
+			errors[static_cast<int>(error)]++;
+
+			if (error == DdsError::None)
+			{
+				if (!Valid(image, buffer.get(), data.size()))
+				{
+					fprintf(stderr, "iteration %d: surface outside the file\n", i);
+					return 1;
+				}
+
+				sum += Checksum(image);
+			}
+		}
+
+		printf("%d iterations over %u seeds in %.0f ms (%08x)\n", pIterations, static_cast<uint32_t>(seeds.size()), Milliseconds(start), sum);
+
+		for (auto i = 0; i <= static_cast<int>(DdsError::Truncated); i++)
+		{
+			printf("  %8u  %s\n", errors[i], DdsErrorString(static_cast<DdsError>(i)));
+		}
+
+		return result;
+	}
+
+	bool ReadLayout(const DdsFormat pFormat, PixelLayout & pLayout)
+	{
+		switch (pFormat)
+		{
+		case DdsFormat::R8G8B8A8_UNORM:
+		case DdsFormat::R8G8B8A8_UNORM_SRGB:
+			pLayout = PixelLayout::Rgba;
+			return true;
+
+		case DdsFormat::B8G8R8A8_UNORM:
+		case DdsFormat::B8G8R8A8_UNORM_SRGB:
+			pLayout = PixelLayout::Bgra;
+			return true;
+
+		case DdsFormat::B8G8R8X8_UNORM:
+		case DdsFormat::B8G8R8X8_UNORM_SRGB:
+			pLayout = PixelLayout::Bgrx;
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	// Peak signal to noise ratio in dB over the channels the format keeps
+	double Psnr(const PixelView & pSource, const BlockFormat pFormat, const uint8_t * pBlocks)
+	{
+		static const uint32_t channelCounts[] = { 3, 4, 1, 2 };
+		const auto channels = channelCounts[static_cast<int>(pFormat)];
+		const auto blocksWide = (pSource.width + 3) / 4;
+
+		double squared = 0.0;
+		uint8_t source[64], decoded[64];
+
+		for (uint32_t y = 0; y < pSource.height; y += 4)
+		{
+			for (uint32_t x = 0; x < pSource.width; x += 4)
+			{
+				DecompressBlock(pBlocks + ((y / 4) * blocksWide + x / 4) * BlockBytes(pFormat), pFormat, decoded);
+
+				for (uint32_t i = 0; i < 16 && y + i / 4 < pSource.height; i++)
+				{
+					if (x + i % 4 >= pSource.width)
+					{
+						continue;
+					}
+
+					const auto pixel = pSource.data + (y + i / 4) * pSource.rowPitch + (x + i % 4) * 4;
+					source[i * 4] = pSource.layout == PixelLayout::Rgba ? pixel[0] : pixel[2];
+					source[i * 4 + 1] = pixel[1];
+					source[i * 4 + 2] = pSource.layout == PixelLayout::Rgba ? pixel[2] : pixel[0];
+					source[i * 4 + 3] = pSource.layout == PixelLayout::Bgrx ? 255 : pixel[3];
+
+					for (uint32_t c = 0; c < channels; c++)
+					{
+						const double delta = static_cast<int>(source[i * 4 + c]) - static_cast<int>(decoded[i * 4 + c]);
+						squared += delta * delta;
+					}
+				}
+			}
+		}
+
+		const auto mean = squared / (static_cast<double>(pSource.width) * pSource.height * channels);
+		return mean > 0.0 ? 10.0 * log10(255.0 * 255.0 / mean) : 99.0;
+	}
+
+	int Encode(char ** pFiles, const int pCount)
+	{
+		static const char * formatNames[] = { "BC1", "BC3", "BC4", "BC5" };
+		static const char * qualityNames[] = { "fast", "normal", "high" };
+
+		auto result = 0;
+
+		printf("%u threads\n", WorkerCount());
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			MappedFile file;
+			DdsImage image;
+			PixelView view;
+
+			if (!file.Open(pFiles[i]) || ParseDds(file.Data(), file.Size(), image) != DdsError::None || !ReadLayout(image.format, view.layout))
+			{
+				fprintf(stderr, "%s: not an 8 bit RGBA or BGRA texture\n", pFiles[i]);
+				result = 1;
+				continue;
+			}
+
+			const auto & surface = image.Surface(0);
+			view.data = surface.data;
+			view.width = surface.width;
+			view.height = surface.height;
+			view.rowPitch = surface.rowPitch;
+
+			const auto megapixels = view.width * static_cast<double>(view.height) / 1000000.0;
+			printf("%s (%ux%u, %.2f MB uncompressed)\n", pFiles[i], view.width, view.height, surface.slicePitch / (1024.0 * 1024.0));
+
+			for (auto format = 0; format < 4; format++)
+			{
+				const auto blockFormat = static_cast<BlockFormat>(format);
+				std::vector<uint8_t> blocks(CompressedSize(view.width, view.height, blockFormat));
+
+				for (auto quality = 0; quality < 3; quality++)
+				{
+					const auto compressQuality = static_cast<CompressQuality>(quality);
+
+					//Warm once, then repeat until at least half a second has been timed
+					CompressSurface(view, blockFormat, compressQuality, blocks.data());
+
+					auto iterations = 0;
+					const auto start = Clock::now();
+
+					do
+					{
+						CompressSurface(view, blockFormat, compressQuality, blocks.data());
+						iterations++;
+					} while (Milliseconds(start) < 500.0);
+
+					const auto milliseconds = Milliseconds(start) / iterations;
+
+					printf("  %s %-6s %8.1f ms  %7.2f MP/s  %6.2f dB  %8.2f MB  %4.1fx smaller\n", formatNames[format], qualityNames[quality],
+						milliseconds, megapixels * 1000.0 / milliseconds, Psnr(view, blockFormat, blocks.data()),
+						blocks.size() / (1024.0 * 1024.0), static_cast<double>(surface.slicePitch) / blocks.size());
+				}
+			}
+		}
+
+		return result;
+	}
+
+	int Compress(const std::string & pCompression, const std::string & pQuality, const std::string & pInput, const std::string & pOutput)
+	{
+		TextureCookOptions options;
+
+		if (pCompression == "color")
+		{
+			options.compression = TextureCompression::Color;
+		}
+		else if (pCompression == "single")
+		{
+			options.compression = TextureCompression::Single;
+		}
+		else if (pCompression == "normal")
+		{
+			options.compression = TextureCompression::Normal;
+		}
+		else
+		{
+			fprintf(stderr, "unknown compression %s\n", pCompression.c_str());
+			return 1;
+		}
+
+		options.quality = pQuality == "fast" ? CompressQuality::Fast : pQuality == "high" ? CompressQuality::High : CompressQuality::Normal;
+
+		MappedFile file;
+		DdsImage image;
+
+		if (!file.Open(pInput) || ParseDds(file.Data(), file.Size(), image) != DdsError::None)
+		{
+			fprintf(stderr, "%s: cannot read\n", pInput.c_str());
+			return 1;
+		}
+
+		std::vector<uint8_t> cooked;
+		const auto start = Clock::now();
+
+		if (!CompressTexture(image, options, cooked))
+		{
+			fprintf(stderr, "%s: cannot be block compressed, it must be 8 bit RGBA, BGRA or R and a multiple of 4 wide and high\n", pInput.c_str());
+			return 1;
+		}
+
+		const auto milliseconds = Milliseconds(start);
+
+		std::ofstream myfile(pOutput, std::ios::binary | std::ios::trunc);
+		myfile.write(reinterpret_cast<const char *>(cooked.data()), static_cast<std::streamsize>(cooked.size()));
+
+		if (!myfile)
+		{
+			fprintf(stderr, "%s: cannot write\n", pOutput.c_str());
+			return 1;
+		}
+
+		printf("%s -> %s  %.2f MB -> %.2f MB in %.1f ms\n", pInput.c_str(), pOutput.c_str(), file.Size() / (1024.0 * 1024.0),
+			cooked.size() / (1024.0 * 1024.0), milliseconds);
+		return 0;
+	}
+
+	int Mips(char ** pFiles, const int pCount)
+	{
+		static const char * filterNames[] = { "box", "kaiser" };
+
+		auto result = 0;
+
+		printf("%u threads\n", WorkerCount());
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			MappedFile file;
+			DdsImage image;
+			PixelView view;
+
+			if (!file.Open(pFiles[i]) || ParseDds(file.Data(), file.Size(), image) != DdsError::None || !ReadLayout(image.format, view.layout))
+			{
+				fprintf(stderr, "%s: not an 8 bit RGBA or BGRA texture\n", pFiles[i]);
+				result = 1;
+				continue;
+			}
+
+			const auto & surface = image.Surface(0);
+			view.data = surface.data;
+			view.width = surface.width;
+			view.height = surface.height;
+			view.rowPitch = surface.rowPitch;
+
+			const auto megapixels = view.width * static_cast<double>(view.height) / 1000000.0;
+			printf("%s (%ux%u, %u levels)\n", pFiles[i], view.width, view.height, FullMipCount(view.width, view.height));
+
+			for (auto filter = 0; filter < 2; filter++)
+			{
+				for (auto gamma = 0; gamma < 2; gamma++)
+				{
+					MipOptions options;
+					options.filter = static_cast<MipFilter>(filter);
+					options.gammaCorrect = gamma != 0;
+
+					std::vector<uint8_t> chain;
+					GenerateMips(view, options, chain);
+
+					auto iterations = 0;
+					const auto start = Clock::now();
+
+					do
+					{
+						chain.clear();
+						GenerateMips(view, options, chain);
+						iterations++;
+					} while (Milliseconds(start) < 500.0);
+
+					const auto milliseconds = Milliseconds(start) / iterations;
+
+					//The last level is the filtered average of the whole texture, brighter when averaged in linear light
+					const auto last = chain.data() + chain.size() - MipLevelSize(1, 1, view.layout);
+
+					printf("  %-6s %-6s %8.2f ms  %7.1f MP/s  %6.2f MB  1x1 %3u %3u %3u %3u\n", filterNames[filter], gamma ? "sRGB" : "linear",
+						milliseconds, megapixels * 1000.0 / milliseconds, chain.size() / (1024.0 * 1024.0),
+						last[0], view.layout == PixelLayout::R ? 0 : last[1], view.layout == PixelLayout::R ? 0 : last[2], view.layout == PixelLayout::R ? 0 : last[3]);
+				}
+			}
+		}
+
+		return result;
+	}
+
+	uint32_t Checksum(const CookedTexture & pTexture)
+	{
+		uint32_t sum = 0;
+
+		for (size_t i = 0; i < pTexture.size; i++)
+		{
+			sum = sum * 31 + pTexture.data[i];
+		}
+
+		return sum;
+	}
+
+	int Cook(const std::string & pDirectory, char ** pFiles, const int pCount)
+	{
+		//Only the cooked files are cleared, so dir can be the app's own cache folder
+		std::error_code error;
+		for (const auto & entry : std::filesystem::directory_iterator(pDirectory, error))
+		{
+			if (entry.path().extension() == ".cooked")
+			{
+				std::filesystem::remove(entry.path(), error);
+			}
+		}
+
+		AssetCache cache(pDirectory);
+		const auto warmRuns = 20;
+		double uncachedTotal = 0.0, coldTotal = 0.0, warmTotal = 0.0;
+		auto result = 0;
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			const std::string filename = pFiles[i];
+
+			//As the app cooks its colour textures
+			TextureCookOptions options;
+			options.compression = TextureCompression::Color;
+			options.mips = true;
+
+			CookedTexture uncached, cold, warm;
+
+			auto start = Clock::now();
+			const auto loaded = CookTexture(filename, options, nullptr, uncached);
+			const auto uncachedTime = Milliseconds(start);
+
+			start = Clock::now();
+			CookTexture(filename, options, &cache, cold);
+			const auto coldTime = Milliseconds(start);
+
+			start = Clock::now();
+			for (auto j = 0; j < warmRuns; j++)
+			{
+				CookTexture(filename, options, &cache, warm);
+			}
+			const auto warmTime = Milliseconds(start) / warmRuns;
+
+			DdsImage image;
+			const auto parsed = loaded && ParseDds(warm.data, warm.size, image) == DdsError::None;
+			const auto matches = parsed && warm.cached && !cold.cached && Checksum(warm) == Checksum(uncached) && Checksum(cold) == Checksum(uncached);
+
+			printf("%s (%ux%u, %u levels, %s, %.2f MB -> %.2f MB)\n  uncached %8.3f ms\n  cold     %8.3f ms  (cook and store)\n  warm     %8.3f ms  %s\n",
+				filename.c_str(), image.width, image.height, image.mipCount, IsBlockCompressed(image.format) ? "compressed" : "uncompressed",
+				uncached.sourceSize / (1024.0 * 1024.0), uncached.size / (1024.0 * 1024.0), uncachedTime, coldTime, warmTime,
+				matches ? "matches uncached" : "DIFFERS FROM UNCACHED");
+
+			uncachedTotal += uncachedTime;
+			coldTotal += coldTime;
+			warmTotal += warmTime;
+
+			if (!matches)
+			{
+				result = 1;
+			}
+		}
+
+		printf("startup\n  uncached %8.3f ms\n  cold     %8.3f ms\n  warm     %8.3f ms  (%.1fx faster than cold, %u hits %u misses)\n",
+			uncachedTotal, coldTotal, warmTotal, coldTotal / warmTotal, cache.Hits(), cache.Misses());
+
+		return result;
+	}
+
+	int Pack(const std::string & pLayout, const std::string & pOutput, char ** pSources, const int pCount)
+	{
+		PackOptions options;
+
+		if (pLayout == "array" || pLayout == "atlas")
+		{
+			options.layout = pLayout == "array" ? PackLayout::Array : PackLayout::Atlas;
+		}
+		else
+		{
+			fprintf(stderr, "unknown layout %s\n", pLayout.c_str());
+			return 1;
+		}
+
+		std::vector<MappedFile> files(pCount);
+		std::vector<PackSource> sources;
+		size_t sourceBytes = 0;
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			const std::string argument = pSources[i];
+			const auto equals = argument.find('=');
+			const auto filename = equals == std::string::npos ? argument : argument.substr(equals + 1);
+
+			PackSource source;
+			source.name = equals == std::string::npos ? argument.substr(0, argument.find('.')) : argument.substr(0, equals);
+
+			DdsImage image;
+
+			if (source.name.empty() || source.name.find_first_of(" \t") != std::string::npos)
+			{
+				fprintf(stderr, "%s: names cannot be empty or hold spaces\n", argument.c_str());
+				return 1;
+			}
+
+			if (!files[i].Open(filename) || ParseDds(files[i].Data(), files[i].Size(), image) != DdsError::None || !ReadLayout(image.format, source.pixels.layout))
+			{
+				fprintf(stderr, "%s: not an 8 bit RGBA or BGRA texture\n", filename.c_str());
+				return 1;
+			}
+
+			//Only the top level of the first item, the cooker builds the mips of the pack
+			const auto & surface = image.Surface(0);
+			source.pixels.data = surface.data;
+			source.pixels.width = surface.width;
+			source.pixels.height = surface.height;
+			source.pixels.rowPitch = surface.rowPitch;
+
+			sourceBytes += surface.slicePitch;
+			sources.push_back(source);
+		}
+
+		std::vector<uint8_t> packed;
+		PackManifest manifest;
+		const auto start = Clock::now();
+
+		if (!PackTextures(sources, options, packed, manifest))
+		{
+			fprintf(stderr, "nothing to pack\n");
+			return 1;
+		}
+
+		const auto milliseconds = Milliseconds(start);
+		const auto manifestFile = pOutput.substr(0, pOutput.find_last_of('.')) + ".pack";
+		const auto text = WritePackManifest(manifest);
+
+		std::ofstream ddsFile(pOutput, std::ios::binary | std::ios::trunc);
+		ddsFile.write(reinterpret_cast<const char *>(packed.data()), static_cast<std::streamsize>(packed.size()));
+
+		std::ofstream packFile(manifestFile, std::ios::binary | std::ios::trunc);
+		packFile.write(text.data(), static_cast<std::streamsize>(text.size()));
+
+		if (!ddsFile || !packFile)
+		{
+			fprintf(stderr, "%s: cannot write\n", pOutput.c_str());
+			return 1;
+		}
+
+		printf("%s + %s  %ux%u x %u, %.2f MB of sources -> %.2f MB (%.0f%% used) in %.1f ms\n%s", pOutput.c_str(), manifestFile.c_str(),
+			manifest.width, manifest.height, manifest.layers, sourceBytes / (1024.0 * 1024.0), packed.size() / (1024.0 * 1024.0),
+			100.0 * sourceBytes / (static_cast<double>(manifest.width) * manifest.height * manifest.layers * 4), milliseconds, text.c_str());
+		return 0;
+	}
+
+	struct SampleResult
+	{
+		double nanoseconds = 0.0;
+		double hitRate = 0.0;
+		float sum = 0.0f;
+	};
+
+	// pCoherent walks the samples along scanlines of 64x64 pixel screen tiles a texel apart, as a
+	// renderer would, rather than jumping anywhere in the texture
+	SampleResult TimeSamples(const TextureSampler & pSampler, const uint32_t pWidth, const bool pCoherent, const float pLod)
+	{
+		const uint32_t count = 1 << 22;
+		std::vector<float> coordinates(count * 2);
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (pCoherent)
+			{
+				if (i % 4096 == 0)
+				{
+					coordinates[i * 2] = unit(random);
+					coordinates[i * 2 + 1] = unit(random);
+				}
+				else
+				{
+					coordinates[i * 2] = coordinates[(i - i % 4096) * 2] + (i % 64) / static_cast<float>(pWidth);
+					coordinates[i * 2 + 1] = coordinates[(i - i % 4096) * 2 + 1] + (i / 64 % 64) / static_cast<float>(pWidth);
+				}
+			}
+			else
+			{
+				coordinates[i * 2] = unit(random);
+				coordinates[i * 2 + 1] = unit(random);
+			}
+		}
+
+		ResetThreadBlockCache();
+
+		SampleResult result;
+		float color[4];
+		const auto start = Clock::now();
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			pSampler.Sample(coordinates[i * 2], coordinates[i * 2 + 1], pLod, color);
+			result.sum += color[0] + color[3];
+		}
+
+		result.nanoseconds = Milliseconds(start) * 1000000.0 / count;
+
+		const auto stats = ThreadBlockCacheStats();
+		result.hitRate = stats.hits + stats.misses ? 100.0 * stats.hits / (stats.hits + stats.misses) : 0.0;
+
+		return result;
+	}
+
+	int Sample(char ** pFiles, const int pCount)
+	{
+		static const char * filterNames[] = { "point", "bilinear", "trilinear" };
+		static const DdsFormat formats[] = { DdsFormat::BC1_UNORM, DdsFormat::BC3_UNORM, DdsFormat::BC4_UNORM, DdsFormat::BC5_UNORM };
+
+		auto result = 0;
+
+		//The sampler's decoder must agree with the compressor's, which the encode PSNR is measured with
+		std::mt19937 blockRandom(5);
+		auto mismatches = 0;
+
+		for (auto format = 0; format < 4; format++)
+		{
+			for (auto j = 0; j < 100000; j++)
+			{
+				uint8_t block[16], pixels[64];
+				float texels[64];
+
+				for (auto & value : block)
+				{
+					value = static_cast<uint8_t>(blockRandom());
+				}
+
+				DecompressBlock(block, static_cast<BlockFormat>(format), pixels);
+				DecodeBlock(formats[format], block, texels);
+
+				for (auto c = 0; c < 64; c++)
+				{
+					if (std::fabs(texels[c] - pixels[c] / 255.0f) > 1e-6f)
+					{
+						mismatches++;
+						break;
+					}
+				}
+			}
+		}
+
+		printf("decoder %s the compressor's on 400000 random BC1, BC3, BC4 and BC5 blocks\n", mismatches ? "DIFFERS FROM" : "matches");
+
+		if (mismatches)
+		{
+			result = 1;
+		}
+
+		for (auto i = 0; i < pCount; i++)
+		{
+			//The same mipped texture both ways, as the app would cook it with and without compression
+			TextureCookOptions uncompressedOptions, compressedOptions;
+			uncompressedOptions.mips = compressedOptions.mips = true;
+			compressedOptions.compression = TextureCompression::Color;
+
+			CookedTexture uncompressed, compressed;
+			DdsImage uncompressedImage, compressedImage;
+
+			if (!CookTexture(pFiles[i], uncompressedOptions, nullptr, uncompressed) || !CookTexture(pFiles[i], compressedOptions, nullptr, compressed) ||
+				ParseDds(uncompressed.data, uncompressed.size, uncompressedImage) != DdsError::None ||
+				ParseDds(compressed.data, compressed.size, compressedImage) != DdsError::None)
+			{
+				fprintf(stderr, "%s: cannot read\n", pFiles[i]);
+				result = 1;
+				continue;
+			}
+
+			printf("%s (%ux%u, %u levels, format %u and %u)\n", pFiles[i], compressedImage.width, compressedImage.height, compressedImage.mipCount,
+				static_cast<uint32_t>(uncompressedImage.format), static_cast<uint32_t>(compressedImage.format));
+
+			if (!TextureSampler(compressedImage).IsValid() || !TextureSampler(uncompressedImage).IsValid())
+			{
+				fprintf(stderr, "%s: format cannot be sampled\n", pFiles[i]);
+				result = 1;
+				continue;
+			}
+
+			//Bilinear at texel centres is the texel itself, which checks the half texel offset and the block addressing
+			SamplerDesc bilinear;
+			bilinear.filter = SampleFilter::Bilinear;
+			const TextureSampler centres(compressedImage, bilinear);
+			std::mt19937 random(3);
+			auto worst = 0.0f;
+
+			for (auto j = 0; j < 100000; j++)
+			{
+				const auto mip = random() % compressedImage.mipCount;
+				const auto & surface = compressedImage.Surface(mip);
+				const auto x = random() % surface.width, y = random() % surface.height;
+
+				float sampled[4], fetched[4];
+				centres.Sample((x + 0.5f) / surface.width, (y + 0.5f) / surface.height, static_cast<float>(mip), sampled);
+				centres.Fetch(mip, 0, x, y, fetched);
+
+				for (auto c = 0; c < 4; c++)
+				{
+					worst = std::max(worst, std::fabs(sampled[c] - fetched[c]));
+				}
+			}
+
+			//The fraction left at a centre is rounding, a few millionths of the difference between neighbours
+			printf("  texel centres  %s (largest difference %g)\n", worst < 1e-3f ? "match" : "DIFFER", worst);
+
+			if (worst >= 1e-3f)
+			{
+				result = 1;
+			}
+
+			for (auto filter = 0; filter < 3; filter++)
+			{
+				SamplerDesc desc;
+				desc.filter = static_cast<SampleFilter>(filter);
+
+				const TextureSampler plain(uncompressedImage, desc), blocks(compressedImage, desc);
+
+				for (auto coherent = 0; coherent < 2; coherent++)
+				{
+					const auto lod = filter == 2 ? 0.5f : 0.0f;
+					const auto a = TimeSamples(plain, compressedImage.width, coherent != 0, lod);
+					const auto b = TimeSamples(blocks, compressedImage.width, coherent != 0, lod);
+
+					printf("  %-9s %-8s uncompressed %6.1f ns  compressed %6.1f ns (%.2fx, %5.1f%% block hits)\n", filterNames[filter],
+						coherent ? "coherent" : "random", a.nanoseconds, b.nanoseconds, b.nanoseconds / a.nanoseconds, b.hitRate);
+				}
+			}
+		}
+
+		return result;
+	}
+
+	struct PathFrame
+	{
+		float eye[3];
+		float target[3];
+	};
+
+	// The texture covers a square of the y = 0 plane this many units a side, repeating beyond it
+	const float VirtualWorldSize = 64.0f;
+
+	// A lap of the plane over 20 seconds at 60 frames a second, bobbing and looking down ahead
+	std::vector<PathFrame> DefaultPath()
+	{
+		std::vector<PathFrame> path(1200);
+
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			const auto angle = 6.2831853f * i / path.size();
+			const auto ahead = angle + 0.15f;
+			const auto height = 2.5f + 1.5f * std::sin(angle * 3.0f);
+
+			path[i] = { { 32.0f + 20.0f * std::cos(angle), height, 32.0f + 20.0f * std::sin(angle) },
+				{ 32.0f + 20.0f * std::cos(ahead), 0.0f, 32.0f + 20.0f * std::sin(ahead) } };
+		}
+
+		return path;
+	}
+
+	// One line a frame, the eye then the target, in units of the plane
+	bool ReadPath(const char * pFilename, std::vector<PathFrame> & pPath)
+	{
+		std::ifstream file(pFilename);
+		std::string line;
+
+		while (std::getline(file, line))
+		{
+			PathFrame frame;
+
+			if (line.empty() || line[0] == '#')
+			{
+				continue;
+			}
+
+			if (sscanf(line.c_str(), "%f %f %f %f %f %f", &frame.eye[0], &frame.eye[1], &frame.eye[2], &frame.target[0], &frame.target[1], &frame.target[2]) != 6)
+			{
+				return false;
+			}
+
+			pPath.push_back(frame);
+		}
+
+		return !pPath.empty();
+	}
+
+	// Where the ray through a full resolution pixel meets the plane, in texture UV. False when it misses.
+	bool PlaneHit(const PathFrame & pFrame, const float * pForward, const float * pRight, const float * pUp, const float pX, const float pY, float & pU, float & pV)
+	{
+		const auto tanY = std::tan(35.0f * 3.14159265f / 180.0f);
+		const auto x = (pX / 1280.0f * 2.0f - 1.0f) * tanY * 1280.0f / 720.0f;
+		const auto y = (1.0f - pY / 720.0f * 2.0f) * tanY;
+		float direction[3];
+
+		for (auto c = 0; c < 3; c++)
+		{
+			direction[c] = pForward[c] + pRight[c] * x + pUp[c] * y;
+		}
+
+		if (direction[1] > -1e-4f)
+		{
+			return false;
+		}
+
+		const auto t = -pFrame.eye[1] / direction[1];
+		pU = (pFrame.eye[0] + direction[0] * t) / VirtualWorldSize;
+		pV = (pFrame.eye[2] + direction[2] * t) / VirtualWorldSize;
+
+		return true;
+	}
+
+	// What a feedback pass at an eighth of 1280x720 would write, one pixel of each 8x8 a frame in turn
+	// so every pixel is covered every 64 frames. The LOD comes from the UV of the neighbouring full
+	// resolution pixels, as the hardware's derivatives do.
+	void RenderFeedback(const PathFrame & pFrame, const uint32_t pIndex, const uint32_t pSize, const uint32_t pMipCount, std::vector<TileFeedback> & pFeedback)
+	{
+		float forward[3], right[3], up[3];
+		auto length = 0.0f;
+
+		for (auto c = 0; c < 3; c++)
+		{
+			forward[c] = pFrame.target[c] - pFrame.eye[c];
+			length += forward[c] * forward[c];
+		}
+
+		for (auto & value : forward)
+		{
+			value /= std::sqrt(length);
+		}
+
+		//Right of forward with y up, then up completing the basis
+		length = std::sqrt(forward[0] * forward[0] + forward[2] * forward[2]);
+		right[0] = -forward[2] / length;
+		right[1] = 0.0f;
+		right[2] = forward[0] / length;
+		up[0] = right[1] * forward[2] - right[2] * forward[1];
+		up[1] = right[2] * forward[0] - right[0] * forward[2];
+		up[2] = right[0] * forward[1] - right[1] * forward[0];
+
+		const auto jitter = pIndex * 29 % 64;
+		pFeedback.clear();
+
+		for (uint32_t y = 0; y < 90; y++)
+		{
+			for (uint32_t x = 0; x < 160; x++)
+			{
+				const auto pixelX = static_cast<float>(x * 8 + jitter % 8) + 0.5f;
+				const auto pixelY = static_cast<float>(y * 8 + jitter / 8) + 0.5f;
+				TileFeedback feedback;
+				float u1, v1, u2, v2;
+
+				if (!PlaneHit(pFrame, forward, right, up, pixelX, pixelY, feedback.u, feedback.v))
+				{
+					continue;
+				}
+
+				if (PlaneHit(pFrame, forward, right, up, pixelX + 1.0f, pixelY, u1, v1) && PlaneHit(pFrame, forward, right, up, pixelX, pixelY + 1.0f, u2, v2))
+				{
+					const auto dx = std::hypot(u1 - feedback.u, v1 - feedback.v) * pSize;
+					const auto dy = std::hypot(u2 - feedback.u, v2 - feedback.v) * pSize;
+					feedback.lod = std::log2(std::max(std::max(dx, dy), 1e-8f));
+				}
+				else
+				{
+					feedback.lod = static_cast<float>(pMipCount);
+				}
+
+				pFeedback.push_back(feedback);
+			}
+		}
+	}
+
+	// Every entry must name the finest resident tile at or above its own, found here from the slots
+	// rather than the page table
+	bool CheckPageTable(const VirtualTexture & pTexture)
+	{
+		std::vector<std::vector<uint32_t>> slots(pTexture.MipCount());
+
+		for (uint32_t mip = 0; mip < pTexture.MipCount(); mip++)
+		{
+			slots[mip].assign(pTexture.GridWidth(mip) * pTexture.GridHeight(mip), VirtualNoSlot);
+		}
+
+		for (uint32_t slot = 0; slot < pTexture.SlotCount(); slot++)
+		{
+			uint32_t mip, x, y;
+
+			if (pTexture.SlotTile(slot, mip, x, y))
+			{
+				slots[mip][y * pTexture.GridWidth(mip) + x] = slot;
+			}
+		}
+
+		for (uint32_t mip = 0; mip < pTexture.MipCount(); mip++)
+		{
+			for (uint32_t y = 0; y < pTexture.GridHeight(mip); y++)
+			{
+				for (uint32_t x = 0; x < pTexture.GridWidth(mip); x++)
+				{
+					auto resident = mip;
+
+					while (slots[resident][(y >> (resident - mip)) * pTexture.GridWidth(resident) + (x >> (resident - mip))] == VirtualNoSlot)
+					{
+						resident++;
+					}
+
+					const auto slot = slots[resident][(y >> (resident - mip)) * pTexture.GridWidth(resident) + (x >> (resident - mip))];
+
+					if (pTexture.Lookup(mip, x, y) != PageEntry(slot, resident))
+					{
+						return false;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Each resident slot against the blocks of its level it should hold, its border wrapping round
+	bool CheckSlots(const VirtualTexture & pTexture, const DdsImage & pImage)
+	{
+		const auto blockBytes = DdsBitsPerPixel(pImage.format) * 2;
+		const auto slotBlocks = (VirtualTileSize + VirtualTileBorder * 2) / 4;
+
+		for (uint32_t slot = 0; slot < pTexture.SlotCount(); slot++)
+		{
+			uint32_t mip, x, y;
+
+			if (!pTexture.SlotTile(slot, mip, x, y))
+			{
+				continue;
+			}
+
+			const auto & surface = pImage.Surface(mip);
+			const auto blocksWide = static_cast<int>(surface.rowPitch / blockBytes), blocksHigh = static_cast<int>(surface.rows);
+
+			for (uint32_t row = 0; row < slotBlocks; row++)
+			{
+				for (uint32_t column = 0; column < slotBlocks; column++)
+				{
+					const auto sourceX = ((static_cast<int>(x * VirtualTileSize + column * 4) - static_cast<int>(VirtualTileBorder)) / 4 % blocksWide + blocksWide) % blocksWide;
+					const auto sourceY = ((static_cast<int>(y * VirtualTileSize + row * 4) - static_cast<int>(VirtualTileBorder)) / 4 % blocksHigh + blocksHigh) % blocksHigh;
+
+					if (memcmp(pTexture.SlotData(slot) + (row * slotBlocks + column) * blockBytes, surface.data + sourceY * surface.rowPitch + sourceX * blockBytes, blockBytes) != 0)
+					{
+						return false;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// A pSize square displacement map, pFile repeated across it, mipped and cooked to BC4 as the rock's
+	// displacement is, then a camera path replayed through the residency manager at several budgets
+	int Virtual(const uint32_t pSize, const char * pFile, const char * pPath)
+	{
+		if (pSize < VirtualTileSize || (pSize & (pSize - 1)) != 0)
+		{
+			fprintf(stderr, "size must be a power of two of at least %u\n", VirtualTileSize);
+			return 1;
+		}
+
+		std::vector<PathFrame> path;
+
+		if (!pPath)
+		{
+			path = DefaultPath();
+		}
+		else if (!ReadPath(pPath, path))
+		{
+			fprintf(stderr, "%s: expected lines of eye x y z and target x y z\n", pPath);
+			return 1;
+		}
+
+		MappedFile file;
+		DdsImage source;
+		PixelLayout layout;
+
+		if (!file.Open(pFile) || ParseDds(file.Data(), file.Size(), source) != DdsError::None || !ReadLayout(source.format, layout))
+		{
+			fprintf(stderr, "%s: not an 8 bit RGBA or BGRA texture\n", pFile);
+			return 1;
+		}
+
+		auto start = Clock::now();
+		std::vector<uint8_t> compressed;
+
+		{
+			DdsImage header;
+			header.format = source.format;
+			header.dimension = DdsDimension::Texture2D;
+			header.width = header.height = pSize;
+			header.depth = header.arraySize = 1;
+			header.mipCount = FullMipCount(pSize, pSize);
+
+			std::vector<uint8_t> mipped;
+			WriteDdsHeader(header, mipped);
+
+			const auto top = mipped.size();
+			const auto & surface = source.Surface(0);
+			mipped.resize(top + static_cast<size_t>(pSize) * pSize * 4);
+
+			for (uint32_t y = 0; y < pSize; y++)
+			{
+				for (uint32_t x = 0; x < pSize; x += surface.width)
+				{
+					memcpy(mipped.data() + top + (static_cast<size_t>(y) * pSize + x) * 4, surface.data + y % surface.height * surface.rowPitch,
+						std::min(surface.width, pSize - x) * 4);
+				}
+			}
+
+			PixelView view;
+			view.data = mipped.data() + top;
+			view.width = view.height = pSize;
+			view.rowPitch = static_cast<size_t>(pSize) * 4;
+			view.layout = layout;
+
+			MipOptions mipOptions;
+			mipOptions.filter = MipFilter::Box;
+			mipOptions.gammaCorrect = false;
+
+			std::vector<uint8_t> levels;
+			GenerateMips(view, mipOptions, levels);
+			mipped.insert(mipped.end(), levels.begin(), levels.end());
+			levels = std::vector<uint8_t>();
+
+			DdsImage image;
+			TextureCookOptions options;
+			options.compression = TextureCompression::Single;
+			options.quality = CompressQuality::Fast;
+
+			if (ParseDds(mipped.data(), mipped.size(), image) != DdsError::None || !CompressTexture(image, options, compressed))
+			{
+				fprintf(stderr, "%s: cannot cook a %ux%u copy\n", pFile, pSize, pSize);
+				return 1;
+			}
+		}
+
+		DdsImage image;
+		ParseDds(compressed.data(), compressed.size(), image);
+
+		const auto whole = compressed.size();
+		printf("%s repeated to %ux%u, %u levels of BC4, %.1f MB whole, cooked in %.0f ms\n", pFile, pSize, pSize, image.mipCount, whole / 1048576.0, Milliseconds(start));
+		printf("%zu frames of %ux%u feedback, %u loads a frame at most\n\n", path.size(), 160, 90, ResidencyOptions().loadsPerFrame);
+		printf("  budget    slots  texel hits  tile hits  mip gap  loads  peak/frame  evictions  deferred  resident avg/peak  us/frame\n");
+
+		auto result = 0;
+		std::vector<TileFeedback> feedback;
+
+		for (const auto fraction : { 32, 16, 8, 4 })
+		{
+			ResidencyOptions options;
+			options.budgetBytes = whole / fraction;
+
+			VirtualTexture texture(image, options);
+
+			if (!texture.IsValid())
+			{
+				fprintf(stderr, "cannot make a virtual texture of %s\n", pFile);
+				return 1;
+			}
+
+			double residentTotal = 0.0, managerTime = 0.0;
+			size_t residentPeak = 0, loadPeak = 0;
+			auto consistent = true;
+
+			for (size_t i = 0; i < path.size(); i++)
+			{
+				RenderFeedback(path[i], static_cast<uint32_t>(i), pSize, image.mipCount, feedback);
+
+				start = Clock::now();
+				texture.ProcessFeedback(feedback.data(), feedback.size());
+				texture.Update();
+				managerTime += Milliseconds(start);
+
+				residentTotal += texture.ResidentBytes();
+				residentPeak = std::max(residentPeak, texture.ResidentBytes());
+				loadPeak = std::max(loadPeak, texture.Uploads().size());
+
+				if (i % 100 == 99 && !CheckPageTable(texture))
+				{
+					consistent = false;
+				}
+			}
+
+			if (!consistent || !CheckPageTable(texture) || !CheckSlots(texture, image))
+			{
+				fprintf(stderr, "  1/%d budget: page table or slots DO NOT MATCH the resident tiles\n", fraction);
+				result = 1;
+			}
+
+			const auto & stats = texture.Stats();
+			printf("  %5.1f MB %6u  %9.1f%%  %8.1f%%  %7.2f  %5llu  %10zu  %9llu  %8llu  %5.1f/%5.1f MB  %10.1f\n", options.budgetBytes / 1048576.0, texture.SlotCount(),
+				100.0 * stats.sampleHits / std::max<uint64_t>(stats.samples, 1), 100.0 * stats.hits / std::max<uint64_t>(stats.requests, 1),
+				static_cast<double>(stats.mipGap) / std::max<uint64_t>(stats.samples, 1), static_cast<unsigned long long>(stats.loads), loadPeak,
+				static_cast<unsigned long long>(stats.evictions), static_cast<unsigned long long>(stats.deferred),
+				residentTotal / path.size() / 1048576.0, residentPeak / 1048576.0, managerTime * 1000.0 / path.size());
+		}
+
+		return result;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	if (argc >= 3 && std::string(argv[1]) == "info")
+	{
+		return Info(argv + 2, argc - 2);
+	}
+
+	if (argc >= 3 && std::string(argv[1]) == "parse")
+	{
+		return Parse(argv + 2, argc - 2);
+	}
+
+	if (argc >= 2 && std::string(argv[1]) == "fuzz")
+	{
+		const auto iterations = argc >= 3 ? atoi(argv[2]) : 0;
+		return iterations > 0 ? Fuzz(iterations, argv + 3, argc - 3) : Fuzz(100000, argv + 2, argc - 2);
+	}
+
+	if (argc >= 6 && std::string(argv[1]) == "compress")
+	{
+		return Compress(argv[2], argv[3], argv[4], argv[5]);
+	}
+
+	if (argc >= 3 && std::string(argv[1]) == "encode")
+	{
+		return Encode(argv + 2, argc - 2);
+	}
+
+	if (argc >= 3 && std::string(argv[1]) == "mips")
+	{
+		return Mips(argv + 2, argc - 2);
+	}
+
+	if (argc >= 4 && std::string(argv[1]) == "cook")
+	{
+		return Cook(argv[2], argv + 3, argc - 3);
+	}
+
+	if (argc >= 5 && std::string(argv[1]) == "pack")
+	{
+		return Pack(argv[2], argv[3], argv + 4, argc - 4);
+	}
+
+	if (argc >= 3 && std::string(argv[1]) == "sample")
+	{
+		return Sample(argv + 2, argc - 2);
+	}
+
+	if (argc >= 4 && std::string(argv[1]) == "virtual")
+	{
+		return Virtual(static_cast<uint32_t>(atoi(argv[2])), argv[3], argc >= 5 ? argv[4] : nullptr);
+	}
+
+	fprintf(stderr, "usage: TextureTool info <file.dds>...\n"
+		"       TextureTool parse <file.dds>...\n"
+		"       TextureTool fuzz [iterations] <file.dds>...\n"
+		"       TextureTool compress <color|single|normal> <fast|normal|high> <input.dds> <output.dds>\n"
+		"       TextureTool encode <file.dds>...\n"
+		"       TextureTool mips <file.dds>...\n"
+		"       TextureTool cook <dir> <file.dds>...\n"
+		"       TextureTool pack <array|atlas> <output.dds> <name=file.dds>...\n"
+		"       TextureTool sample <file.dds>...\n"
+		"       TextureTool virtual <size> <file.dds> [path.txt]\n");
+	return 1;
+}
@@ -0,0 +1,550 @@
+#include "VertexQuantizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QUANTIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	constexpr float UnormMax = 65535.0f;
+	constexpr float SnormMax = 32767.0f;
+	constexpr float RadiansToDegrees = 57.2957795f;
+
+	uint32_t FloatBits(const float pValue)
+	{
+		uint32_t bits;
+		memcpy(&bits, &pValue, sizeof bits);
+		return bits;
+	}
+
+	float BitsFloat(const uint32_t pBits)
+	{
+		float value;
+		memcpy(&value, &pBits, sizeof value);
+		return value;
+	}
+
+	//Round to nearest even with overflow to infinity, after Fabian Giesen's float_to_half_fast3_rtne
+	uint16_t FloatToHalf(const float pValue)
+	{
+		auto bits = FloatBits(pValue);
+		const auto sign = bits & 0x80000000u;
+		bits ^= sign;
+
+		uint32_t half;
+
+		if (bits >= 0x47800000u)
+		{
+			//Too large for a half, or infinity or NaN already
+			half = bits > 0x7f800000u ? 0x7e00u : 0x7c00u;
+		}
+		else if (bits < 0x38800000u)
+		{
+			//Subnormal half, let the float adder do the rounding
+			const auto magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+			half = FloatBits(BitsFloat(bits) + BitsFloat(magic)) - magic;
+		}
+		else
+		{
+			const auto odd = (bits >> 13) & 1u;
+			bits += 0xc8000fffu + odd;
+			half = bits >> 13;
+		}
+
+		return static_cast<uint16_t>(half | (sign >> 16));
+	}
+
+	float HalfToFloat(const uint16_t pHalf)
+	{
+		auto value = BitsFloat((pHalf & 0x7fffu) << 13) * BitsFloat((254u - 15u) << 23);
+
+		if (value >= BitsFloat((127u + 16u) << 23))
+		{
+			value = BitsFloat(FloatBits(value) | (255u << 23));
+		}
+
+		return BitsFloat(FloatBits(value) | ((pHalf & 0x8000u) << 16));
+	}
+
+	float Clamp(const float pValue, const float pMin, const float pMax)
+	{
+		return std::min(std::max(pValue, pMin), pMax);
+	}
+
+	float SignNotZero(const float pValue)
+	{
+		return std::signbit(pValue) ? -1.0f : 1.0f;
+	}
+
+	void OctEncode(const float * pVector, int16_t * pOut)
+	{
+		const auto l1 = std::max(fabsf(pVector[0]) + fabsf(pVector[1]) + fabsf(pVector[2]), FLT_MIN);
+		auto u = pVector[0] / l1;
+		auto v = pVector[1] / l1;
+
+		//Fold the lower hemisphere over the diagonals
+		if (pVector[2] < 0.0f)
+		{
+			const auto foldedU = (1.0f - fabsf(v)) * SignNotZero(u);
+			v = (1.0f - fabsf(u)) * SignNotZero(v);
+			u = foldedU;
+		}
+
+		pOut[0] = static_cast<int16_t>(lrintf(Clamp(u, -1.0f, 1.0f) * SnormMax));
+		pOut[1] = static_cast<int16_t>(lrintf(Clamp(v, -1.0f, 1.0f) * SnormMax));
+	}
+
+	void Normalize(float * pVector)
+	{
+		const auto length = sqrtf(pVector[0] * pVector[0] + pVector[1] * pVector[1] + pVector[2] * pVector[2]);
+		const auto scale = 1.0f / std::max(length, FLT_MIN);
+
+		pVector[0] *= scale;
+		pVector[1] *= scale;
+		pVector[2] *= scale;
+	}
+
+	void OctDecode(const int16_t * pIn, float * pVector)
+	{
+		auto x = std::max(pIn[0] / SnormMax, -1.0f);
+		auto y = std::max(pIn[1] / SnormMax, -1.0f);
+		const auto z = 1.0f - fabsf(x) - fabsf(y);
+		const auto t = std::max(-z, 0.0f);
+
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+
+		pVector[0] = x;
+		pVector[1] = y;
+		pVector[2] = z;
+		Normalize(pVector);
+	}
+
+	float Dot(const float * pLeft, const float * pRight)
+	{
+		return pLeft[0] * pRight[0] + pLeft[1] * pRight[1] + pLeft[2] * pRight[2];
+	}
+
+	float AngleDegrees(const float * pLeft, const float * pRight)
+	{
+		float left[3] = { pLeft[0], pLeft[1], pLeft[2] };
+		float right[3] = { pRight[0], pRight[1], pRight[2] };
+
+		Normalize(left);
+		Normalize(right);
+
+		return acosf(Clamp(Dot(left, right), -1.0f, 1.0f)) * RadiansToDegrees;
+	}
+
+	struct EncodeStreams
+	{
+		const float * positions;
+		const float * normals;
+		const float * texCoords;
+		const float * tangents;
+		const float * biTangents;
+		float invScale[3];
+	};
+
+	void EncodeVertex(const EncodeStreams & pIn, QuantizedMesh & pOut, const uint32_t pVertex)
+	{
+		const auto position = pIn.positions + pVertex * 3;
+		const auto normal = pIn.normals + pVertex * 3;
+		const auto tangent = pIn.tangents + pVertex * 3;
+		const auto biTangent = pIn.biTangents + pVertex * 3;
+
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			const auto unorm = Clamp((position[i] - pOut.positionOffset[i]) * pIn.invScale[i], 0.0f, UnormMax);
+			pOut.positions[pVertex * 4 + i] = static_cast<uint16_t>(lrintf(unorm));
+		}
+
+		pOut.positions[pVertex * 4 + 3] = 65535;
+
+		OctEncode(normal, &pOut.normals[pVertex * 2]);
+		OctEncode(tangent, &pOut.tangents[pVertex * 2]);
+		OctEncode(biTangent, &pOut.biTangents[pVertex * 2]);
+
+		pOut.texCoords[pVertex * 2] = FloatToHalf(pIn.texCoords[pVertex * 2]);
+		pOut.texCoords[pVertex * 2 + 1] = FloatToHalf(pIn.texCoords[pVertex * 2 + 1]);
+	}
+
+	void DecodeVertex(const QuantizedMesh & pIn, MeshBuffer & pOut, const float * pStep, const uint32_t pVertex)
+	{
+		auto position = &pOut.Stream(MeshStream::Position)[pVertex * 3];
+		auto normal = &pOut.Stream(MeshStream::Normal)[pVertex * 3];
+		auto tangent = &pOut.Stream(MeshStream::Tangent)[pVertex * 3];
+		auto biTangent = &pOut.Stream(MeshStream::BiTangent)[pVertex * 3];
+		auto texCoord = &pOut.Stream(MeshStream::TexCoord)[pVertex * 2];
+
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			position[i] = pIn.positions[pVertex * 4 + i] * pStep[i] + pIn.positionOffset[i];
+		}
+
+		OctDecode(&pIn.normals[pVertex * 2], normal);
+		OctDecode(&pIn.tangents[pVertex * 2], tangent);
+		OctDecode(&pIn.biTangents[pVertex * 2], biTangent);
+
+		texCoord[0] = HalfToFloat(pIn.texCoords[pVertex * 2]);
+		texCoord[1] = HalfToFloat(pIn.texCoords[pVertex * 2 + 1]);
+	}
+
+#ifdef QUANTIZER_SSE2
+	//Four packed float3s to x, y, z vectors without reading past the twelfth float
+	void Load3x4(const float * pIn, __m128 & pX, __m128 & pY, __m128 & pZ)
+	{
+		auto r0 = _mm_loadu_ps(pIn);
+		auto r1 = _mm_loadu_ps(pIn + 3);
+		auto r2 = _mm_loadu_ps(pIn + 6);
+		auto r3 = _mm_loadu_ps(pIn + 8);
+		r3 = _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(3, 3, 2, 1));
+
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+		pX = r0;
+		pY = r1;
+		pZ = r2;
+	}
+
+	void Store3x4(float * pOut, __m128 pX, __m128 pY, __m128 pZ)
+	{
+		auto w = _mm_setzero_ps();
+
+		_MM_TRANSPOSE4_PS(pX, pY, pZ, w);
+
+		//Each store's fourth float is overwritten by the next, the last is split to stop at twelve
+		_mm_storeu_ps(pOut, pX);
+		_mm_storeu_ps(pOut + 3, pY);
+		_mm_storeu_ps(pOut + 6, pZ);
+		_mm_storel_pi(reinterpret_cast<__m64 *>(pOut + 9), w);
+		_mm_store_ss(pOut + 11, _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 2, 2)));
+	}
+
+	void Load2x4(const float * pIn, __m128 & pU, __m128 & pV)
+	{
+		const auto a = _mm_loadu_ps(pIn);
+		const auto b = _mm_loadu_ps(pIn + 4);
+
+		pU = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		pV = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+	}
+
+	void Store2x4(float * pOut, const __m128 pU, const __m128 pV)
+	{
+		_mm_storeu_ps(pOut, _mm_unpacklo_ps(pU, pV));
+		_mm_storeu_ps(pOut + 4, _mm_unpackhi_ps(pU, pV));
+	}
+
+	__m128 Abs(const __m128 pValue)
+	{
+		return _mm_andnot_ps(_mm_set1_ps(-0.0f), pValue);
+	}
+
+	__m128 Select(const __m128 pMask, const __m128 pTrue, const __m128 pFalse)
+	{
+		return _mm_or_ps(_mm_and_ps(pMask, pTrue), _mm_andnot_ps(pMask, pFalse));
+	}
+
+	__m128 SignNotZero(const __m128 pValue)
+	{
+		return _mm_or_ps(_mm_and_ps(pValue, _mm_set1_ps(-0.0f)), _mm_set1_ps(1.0f));
+	}
+
+	__m128 Clamp(const __m128 pValue, const float pMin, const float pMax)
+	{
+		return _mm_min_ps(_mm_max_ps(pValue, _mm_set1_ps(pMin)), _mm_set1_ps(pMax));
+	}
+
+	//Packs four u and four v 32-bit lanes into u0 v0 u1 v1 ... as 16-bit
+	__m128i Interleave16(const __m128i pU, const __m128i pV)
+	{
+		const auto packed = _mm_packs_epi32(pU, pV);
+		return _mm_unpacklo_epi16(packed, _mm_srli_si128(packed, 8));
+	}
+
+	__m128i OctEncode(const __m128 pX, const __m128 pY, const __m128 pZ)
+	{
+		const auto l1 = _mm_max_ps(_mm_add_ps(_mm_add_ps(Abs(pX), Abs(pY)), Abs(pZ)), _mm_set1_ps(FLT_MIN));
+		const auto u = _mm_div_ps(pX, l1);
+		const auto v = _mm_div_ps(pY, l1);
+
+		const auto one = _mm_set1_ps(1.0f);
+		const auto foldedU = _mm_mul_ps(_mm_sub_ps(one, Abs(v)), SignNotZero(u));
+		const auto foldedV = _mm_mul_ps(_mm_sub_ps(one, Abs(u)), SignNotZero(v));
+		const auto lower = _mm_cmplt_ps(pZ, _mm_setzero_ps());
+
+		const auto qu = _mm_cvtps_epi32(_mm_mul_ps(Clamp(Select(lower, foldedU, u), -1.0f, 1.0f), _mm_set1_ps(SnormMax)));
+		const auto qv = _mm_cvtps_epi32(_mm_mul_ps(Clamp(Select(lower, foldedV, v), -1.0f, 1.0f), _mm_set1_ps(SnormMax)));
+
+		return Interleave16(qu, qv);
+	}
+
+	void Normalize(__m128 & pX, __m128 & pY, __m128 & pZ)
+	{
+		const auto lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pX, pX), _mm_mul_ps(pY, pY)), _mm_mul_ps(pZ, pZ));
+		const auto scale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_max_ps(_mm_sqrt_ps(lengthSquared), _mm_set1_ps(FLT_MIN)));
+
+		pX = _mm_mul_ps(pX, scale);
+		pY = _mm_mul_ps(pY, scale);
+		pZ = _mm_mul_ps(pZ, scale);
+	}
+
+	void OctDecode(const __m128i pPacked, __m128 & pX, __m128 & pY, __m128 & pZ)
+	{
+		const auto scale = _mm_set1_ps(SnormMax);
+		const auto minusOne = _mm_set1_ps(-1.0f);
+
+		auto x = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(pPacked, 16), 16)), scale), minusOne);
+		auto y = _mm_max_ps(_mm_div_ps(_mm_cvtepi32_ps(_mm_srai_epi32(pPacked, 16)), scale), minusOne);
+		const auto z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), Abs(x)), Abs(y));
+		const auto t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+		const auto zero = _mm_setzero_ps();
+
+		x = _mm_add_ps(x, Select(_mm_cmpge_ps(x, zero), _mm_sub_ps(zero, t), t));
+		y = _mm_add_ps(y, Select(_mm_cmpge_ps(y, zero), _mm_sub_ps(zero, t), t));
+
+		pX = x;
+		pY = y;
+		pZ = z;
+		Normalize(pX, pY, pZ);
+	}
+
+	//SSE2 float_to_half_fast3_rtne, the result is in the low 16 bits of each lane
+	__m128i FloatToHalf(const __m128 pValue)
+	{
+		const auto sign = _mm_and_ps(pValue, _mm_set1_ps(-0.0f));
+		const auto absolute = _mm_xor_ps(pValue, sign);
+		const auto bits = _mm_castps_si128(absolute);
+
+		const auto isNan = _mm_castps_si128(_mm_cmpunord_ps(absolute, absolute));
+		const auto isRegular = _mm_cmpgt_epi32(_mm_set1_epi32(0x47800000), bits);
+		const auto infOrNan = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00));
+
+		const auto isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32(0x38800000), bits);
+		const auto magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+		const auto subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, _mm_castsi128_ps(magic))), magic);
+
+		const auto odd = _mm_srli_epi32(_mm_slli_epi32(bits, 31 - 13), 31);
+		const auto normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(bits, _mm_set1_epi32(static_cast<int>(0xc8000fffu))), odd), 13);
+
+		const auto finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+		const auto half = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, infOrNan));
+
+		return _mm_or_si128(half, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+	}
+
+	__m128 HalfToFloat(const __m128i pHalf)
+	{
+		const auto magnitude = _mm_and_si128(pHalf, _mm_set1_epi32(0x7fff));
+		const auto sign = _mm_slli_epi32(_mm_xor_si128(pHalf, magnitude), 16);
+		const auto scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(magnitude, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+		const auto wasInfNan = _mm_cmpge_ps(scaled, _mm_castsi128_ps(_mm_set1_epi32((127 + 16) << 23)));
+		const auto exponent = _mm_and_ps(wasInfNan, _mm_castsi128_ps(_mm_set1_epi32(255 << 23)));
+
+		return _mm_or_ps(_mm_or_ps(scaled, exponent), _mm_castsi128_ps(sign));
+	}
+
+	void EncodeBlock(const EncodeStreams & pIn, QuantizedMesh & pOut, const uint32_t pVertex)
+	{
+		__m128 x, y, z;
+
+		//Position, unsigned values are biased into the signed range to pack without SSE4.1
+		Load3x4(pIn.positions + pVertex * 3, x, y, z);
+
+		const auto bias = _mm_set1_epi32(32768);
+		const auto qx = _mm_sub_epi32(_mm_cvtps_epi32(Clamp(_mm_mul_ps(_mm_sub_ps(x, _mm_set1_ps(pOut.positionOffset[0])), _mm_set1_ps(pIn.invScale[0])), 0.0f, UnormMax)), bias);
+		const auto qy = _mm_sub_epi32(_mm_cvtps_epi32(Clamp(_mm_mul_ps(_mm_sub_ps(y, _mm_set1_ps(pOut.positionOffset[1])), _mm_set1_ps(pIn.invScale[1])), 0.0f, UnormMax)), bias);
+		const auto qz = _mm_sub_epi32(_mm_cvtps_epi32(Clamp(_mm_mul_ps(_mm_sub_ps(z, _mm_set1_ps(pOut.positionOffset[2])), _mm_set1_ps(pIn.invScale[2])), 0.0f, UnormMax)), bias);
+
+		const auto flip = _mm_set1_epi16(static_cast<short>(0x8000));
+		const auto xy = _mm_xor_si128(Interleave16(qx, qy), flip);
+		const auto zw = _mm_xor_si128(Interleave16(qz, _mm_set1_epi32(32767)), flip);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(&pOut.positions[pVertex * 4]), _mm_unpacklo_epi32(xy, zw));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(&pOut.positions[pVertex * 4 + 8]), _mm_unpackhi_epi32(xy, zw));
+
+		Load3x4(pIn.normals + pVertex * 3, x, y, z);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(&pOut.normals[pVertex * 2]), OctEncode(x, y, z));
+
+		Load3x4(pIn.tangents + pVertex * 3, x, y, z);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(&pOut.tangents[pVertex * 2]), OctEncode(x, y, z));
+
+		Load3x4(pIn.biTangents + pVertex * 3, x, y, z);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(&pOut.biTangents[pVertex * 2]), OctEncode(x, y, z));
+
+		__m128 u, v;
+		Load2x4(pIn.texCoords + pVertex * 2, u, v);
+
+		const auto halves = _mm_or_si128(_mm_and_si128(FloatToHalf(u), _mm_set1_epi32(0xffff)), _mm_slli_epi32(FloatToHalf(v), 16));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(&pOut.texCoords[pVertex * 2]), halves);
+	}
+
+	void DecodeBlock(const QuantizedMesh & pIn, MeshBuffer & pOut, const float * pStep, const uint32_t pVertex)
+	{
+		//Position, x y z w of two vertices per register, widened and transposed
+		const auto zero = _mm_setzero_si128();
+		const auto p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pIn.positions[pVertex * 4]));
+		const auto p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pIn.positions[pVertex * 4 + 8]));
+
+		auto x = _mm_cvtepi32_ps(_mm_unpacklo_epi16(p0, zero));
+		auto y = _mm_cvtepi32_ps(_mm_unpackhi_epi16(p0, zero));
+		auto z = _mm_cvtepi32_ps(_mm_unpacklo_epi16(p1, zero));
+		auto w = _mm_cvtepi32_ps(_mm_unpackhi_epi16(p1, zero));
+
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		x = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(pStep[0])), _mm_set1_ps(pIn.positionOffset[0]));
+		y = _mm_add_ps(_mm_mul_ps(y, _mm_set1_ps(pStep[1])), _mm_set1_ps(pIn.positionOffset[1]));
+		z = _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(pStep[2])), _mm_set1_ps(pIn.positionOffset[2]));
+
+		Store3x4(&pOut.Stream(MeshStream::Position)[pVertex * 3], x, y, z);
+
+		OctDecode(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&pIn.normals[pVertex * 2])), x, y, z);
+		Store3x4(&pOut.Stream(MeshStream::Normal)[pVertex * 3], x, y, z);
+
+		OctDecode(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&pIn.tangents[pVertex * 2])), x, y, z);
+		Store3x4(&pOut.Stream(MeshStream::Tangent)[pVertex * 3], x, y, z);
+
+		OctDecode(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&pIn.biTangents[pVertex * 2])), x, y, z);
+		Store3x4(&pOut.Stream(MeshStream::BiTangent)[pVertex * 3], x, y, z);
+
+		const auto halves = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pIn.texCoords[pVertex * 2]));
+		const auto u = HalfToFloat(_mm_and_si128(halves, _mm_set1_epi32(0xffff)));
+		const auto v = HalfToFloat(_mm_srli_epi32(halves, 16));
+
+		Store2x4(&pOut.Stream(MeshStream::TexCoord)[pVertex * 2], u, v);
+	}
+#endif
+}
+
+bool Advanced_Rendering::QuantizeMesh(const MeshView & pMesh, QuantizedMesh & pQuantized, const bool pVectorised)
+{
+	EncodeStreams streams;
+	streams.positions = pMesh.Stream(MeshStream::Position);
+	streams.normals = pMesh.Stream(MeshStream::Normal);
+	streams.texCoords = pMesh.Stream(MeshStream::TexCoord);
+	streams.tangents = pMesh.Stream(MeshStream::Tangent);
+	streams.biTangents = pMesh.Stream(MeshStream::BiTangent);
+
+	if (!streams.positions || !streams.normals || !streams.texCoords || !streams.tangents || !streams.biTangents)
+	{
+		return false;
+	}
+
+	pQuantized = QuantizedMesh();
+	pQuantized.vertexCount = pMesh.vertexCount;
+	pQuantized.positions.resize(pMesh.vertexCount * 4);
+	pQuantized.normals.resize(pMesh.vertexCount * 2);
+	pQuantized.texCoords.resize(pMesh.vertexCount * 2);
+	pQuantized.tangents.resize(pMesh.vertexCount * 2);
+	pQuantized.biTangents.resize(pMesh.vertexCount * 2);
+	pQuantized.indices.assign(pMesh.indices, pMesh.indices + pMesh.indexCount);
+
+	//Positions are stored against the mesh bounds
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	for (uint32_t i = 0; i < pMesh.vertexCount; i++)
+	{
+		for (uint32_t j = 0; j < 3; j++)
+		{
+			minimum[j] = std::min(minimum[j], streams.positions[i * 3 + j]);
+			maximum[j] = std::max(maximum[j], streams.positions[i * 3 + j]);
+		}
+	}
+
+	for (uint32_t i = 0; i < 3 && pMesh.vertexCount > 0; i++)
+	{
+		const auto extent = maximum[i] - minimum[i];
+
+		pQuantized.positionOffset[i] = minimum[i];
+		pQuantized.positionScale[i] = extent;
+		streams.invScale[i] = extent > 0.0f ? UnormMax / extent : 0.0f;
+	}
+
+	uint32_t vertex = 0;
+
+#ifdef QUANTIZER_SSE2
+	for (; pVectorised && vertex + 4 <= pMesh.vertexCount; vertex += 4)
+	{
+		EncodeBlock(streams, pQuantized, vertex);
+	}
+#endif
+
+	for (; vertex < pMesh.vertexCount; vertex++)
+	{
+		EncodeVertex(streams, pQuantized, vertex);
+	}
+
+	return true;
+}
+
+void Advanced_Rendering::DequantizeMesh(const QuantizedMesh & pQuantized, MeshBuffer & pMesh, const bool pVectorised)
+{
+	pMesh = MeshBuffer();
+	pMesh.vertexCount = pQuantized.vertexCount;
+	pMesh.indices = pQuantized.indices;
+
+	for (uint32_t i = 0; i < MeshStreamCount; i++)
+	{
+		pMesh.streams[i].resize(static_cast<size_t>(pQuantized.vertexCount) * MeshStreamComponents[i]);
+	}
+
+	const float step[3] =
+	{
+		pQuantized.positionScale[0] / UnormMax,
+		pQuantized.positionScale[1] / UnormMax,
+		pQuantized.positionScale[2] / UnormMax
+	};
+
+	uint32_t vertex = 0;
+
+#ifdef QUANTIZER_SSE2
+	for (; pVectorised && vertex + 4 <= pQuantized.vertexCount; vertex += 4)
+	{
+		DecodeBlock(pQuantized, pMesh, step, vertex);
+	}
+#endif
+
+	for (; vertex < pQuantized.vertexCount; vertex++)
+	{
+		DecodeVertex(pQuantized, pMesh, step, vertex);
+	}
+}
+
+QuantizationError Advanced_Rendering::MeasureQuantizationError(const MeshView & pOriginal, const MeshView & pDecoded)
+{
+	QuantizationError error;
+
+	const auto vertexCount = std::min(pOriginal.vertexCount, pDecoded.vertexCount);
+
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		const auto original = pOriginal.Stream(MeshStream::Position) + i * 3;
+		const auto decoded = pDecoded.Stream(MeshStream::Position) + i * 3;
+		const float difference[3] = { original[0] - decoded[0], original[1] - decoded[1], original[2] - decoded[2] };
+
+		error.position = std::max(error.position, sqrtf(Dot(difference, difference)));
+
+		for (uint32_t j = 0; j < 2; j++)
+		{
+			const auto texCoord = fabsf(pOriginal.Stream(MeshStream::TexCoord)[i * 2 + j] - pDecoded.Stream(MeshStream::TexCoord)[i * 2 + j]);
+			error.texCoord = std::max(error.texCoord, texCoord);
+		}
+
+		error.normal = std::max(error.normal, AngleDegrees(pOriginal.Stream(MeshStream::Normal) + i * 3, pDecoded.Stream(MeshStream::Normal) + i * 3));
+		error.tangent = std::max(error.tangent, AngleDegrees(pOriginal.Stream(MeshStream::Tangent) + i * 3, pDecoded.Stream(MeshStream::Tangent) + i * 3));
+		error.bitangent = std::max(error.bitangent, AngleDegrees(pOriginal.Stream(MeshStream::BiTangent) + i * 3, pDecoded.Stream(MeshStream::BiTangent) + i * 3));
+	}
+
+	return error;
+}
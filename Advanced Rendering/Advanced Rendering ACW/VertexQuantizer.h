@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "MeshFile.h"
+
+namespace Advanced_Rendering
+{
+	// Compressed streams for tangent space meshes, 24 bytes a vertex against 56 as floats.
+	//   position   R16G16B16A16_UNORM  xyz against the mesh bounds, w is padding
+	//   normal     R16G16_SNORM        octahedral
+	//   texcoord   R16G16_FLOAT
+	//   tangent    R16G16_SNORM        octahedral
+	//   bitangent  R16G16_SNORM        octahedral
+	// The bitangent is kept rather than rebuilt from a sign, the exported frames are not orthogonal.
+	struct QuantizedMesh
+	{
+		uint32_t vertexCount = 0;
+		float positionOffset[3] = {};
+		float positionScale[3] = {};
+
+		std::vector<uint16_t> positions;
+		std::vector<int16_t> normals;
+		std::vector<uint16_t> texCoords;
+		std::vector<int16_t> tangents;
+		std::vector<int16_t> biTangents;
+		std::vector<uint32_t> indices;
+	};
+
+	constexpr uint32_t QuantizedVertexBytes = 24;
+
+	struct QuantizationError
+	{
+		float position = 0.0f;		// largest distance, in mesh units
+		float texCoord = 0.0f;		// largest difference of either component
+		float normal = 0.0f;		// largest angles, in degrees
+		float tangent = 0.0f;
+		float bitangent = 0.0f;
+	};
+
+	// Encode and decode run four vertices at a time with SSE2 where the target has it, and fall
+	// back to the equivalent scalar code elsewhere (ARM) and for the last few vertices. pVectorised
+	// false runs the scalar code for every vertex, the reference the SSE2 code must match bit for bit.
+	// Quantising needs all five streams.
+	bool QuantizeMesh(const MeshView & pMesh, QuantizedMesh & pQuantized, bool pVectorised = true);
+	void DequantizeMesh(const QuantizedMesh & pQuantized, MeshBuffer & pMesh, bool pVectorised = true);
+
+	QuantizationError MeasureQuantizationError(const MeshView & pOriginal, const MeshView & pDecoded);
+}
@@ -1,30 +1,26 @@
 #include "pch.h"
 #include "VertexShader.h"
 
-void VertexShader::Load(std::shared_ptr<DX::DeviceResources> pDeviceResources)
+void VertexShader::Create(std::shared_ptr<DX::DeviceResources> pDeviceResources, const uint8_t * pData, const size_t pSize)
 {
-	auto loadVSTask = DX::ReadDataAsync(mFilename);
-
-	auto createVSTask = loadVSTask.then([this, pDeviceResources](const std::vector<byte>& fileData) {
-		DX::ThrowIfFailed(
-			pDeviceResources->GetD3DDevice()->CreateVertexShader(
-				&fileData[0],
-				fileData.size(),
-				nullptr,
-				mVertexShader.ReleaseAndGetAddressOf()
-			)
-		);
-
-		DX::ThrowIfFailed(
-			pDeviceResources->GetD3DDevice()->CreateInputLayout(
-				this->mLayout.data(),
-				this->mLayout.size(),
-				&fileData[0],
-				fileData.size(),
-				mInputLayout.ReleaseAndGetAddressOf()
-			)
-		);
-	});
+	DX::ThrowIfFailed(
+		pDeviceResources->GetD3DDevice()->CreateVertexShader(
+			pData,
+			pSize,
+			nullptr,
+			mVertexShader.ReleaseAndGetAddressOf()
+		)
+	);
+
+	DX::ThrowIfFailed(
+		pDeviceResources->GetD3DDevice()->CreateInputLayout(
+			mLayout.data(),
+			static_cast<UINT>(mLayout.size()),
+			pData,
+			pSize,
+			mInputLayout.ReleaseAndGetAddressOf()
+		)
+	);
 }
 
 void VertexShader::Reset()
@@ -0,0 +1,314 @@
+#include "VirtualTexture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace Advanced_Rendering;
+
+namespace
+{
+	bool IsPowerOfTwo(const uint32_t pValue)
+	{
+		return pValue != 0 && (pValue & (pValue - 1)) == 0;
+	}
+
+	uint32_t Wrap(const int64_t pValue, const uint32_t pSize)
+	{
+		const auto wrapped = pValue % static_cast<int64_t>(pSize);
+		return static_cast<uint32_t>(wrapped < 0 ? wrapped + pSize : wrapped);
+	}
+}
+
+VirtualTexture::VirtualTexture(const DdsImage & pImage, const ResidencyOptions & pOptions) : mImage(&pImage), mOptions(pOptions)
+{
+	const auto compressed = IsBlockCompressed(pImage.format);
+	const auto bits = static_cast<uint32_t>(DdsBitsPerPixel(pImage.format));
+
+	if (pImage.dimension != DdsDimension::Texture2D || pImage.surfaces.empty() || bits == 0 || (!compressed && bits % 8 != 0) ||
+		!IsPowerOfTwo(pImage.width) || !IsPowerOfTwo(pImage.height) || pImage.width < VirtualTileSize || pImage.height < VirtualTileSize)
+	{
+		return;
+	}
+
+	mMipCount = 1;
+
+	while ((pImage.width >> mMipCount) != 0 || (pImage.height >> mMipCount) != 0)
+	{
+		mMipCount++;
+	}
+
+	mBlockSize = compressed ? 4 : 1;
+	mUnitBytes = compressed ? bits * 2 : bits / 8;
+
+	//Packed formats such as R8G8_B8G8 store two texels a unit, which tiles cannot split
+	if (pImage.mipCount != mMipCount || pImage.Surface(0).rowPitch != static_cast<size_t>(pImage.width / mBlockSize) * mUnitBytes)
+	{
+		return;
+	}
+
+	uint32_t tiles = 0;
+	mTailMip = mMipCount;
+
+	for (uint32_t mip = 0; mip < mMipCount; mip++)
+	{
+		mGridWidth.push_back(std::max(1u, (pImage.width >> mip) / VirtualTileSize));
+		mGridHeight.push_back(std::max(1u, (pImage.height >> mip) / VirtualTileSize));
+		mMipOffset.push_back(tiles);
+		tiles += mGridWidth[mip] * mGridHeight[mip];
+
+		if (mTailMip == mMipCount && mGridWidth[mip] == 1 && mGridHeight[mip] == 1)
+		{
+			mTailMip = mip;
+		}
+	}
+
+	mSlotUnits = (VirtualTileSize + VirtualTileBorder * 2) / mBlockSize;
+	mSlotBytes = static_cast<size_t>(mSlotUnits) * mSlotUnits * mUnitBytes;
+
+	//The tail has a slot of its own at every level, and there must be room for at least one more
+	const auto tailCount = mMipCount - mTailMip;
+	const auto slotCount = static_cast<uint32_t>(std::max<size_t>(tailCount + 1, std::min<size_t>(mOptions.budgetBytes / mSlotBytes, tiles)));
+
+	mColumns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(slotCount))));
+	mPageTable.assign(tiles, PageEntry(VirtualNoSlot, 0xFF));
+	mRequestFrame.assign(tiles, 0);
+	mRequestIndex.assign(tiles, 0);
+	mSlots.resize(slotCount);
+	mPhysical.resize(slotCount * mSlotBytes);
+
+	//Coarsest first, so each level of the tail only replaces the entries beneath it
+	for (uint32_t i = 0; i < tailCount; i++)
+	{
+		Load(mMipOffset[mMipCount - 1 - i], i);
+	}
+
+	for (auto slot = tailCount; slot < slotCount; slot++)
+	{
+		PushFront(slot);
+	}
+
+	mStats = ResidencyStats();
+}
+
+uint32_t VirtualTexture::TileMip(const uint32_t pTile) const
+{
+	return static_cast<uint32_t>(std::upper_bound(mMipOffset.begin(), mMipOffset.end(), pTile) - mMipOffset.begin()) - 1;
+}
+
+void VirtualTexture::Unlink(const uint32_t pSlot)
+{
+	auto & slot = mSlots[pSlot];
+
+	(slot.previous != UINT32_MAX ? mSlots[slot.previous].next : mLruHead) = slot.next;
+	(slot.next != UINT32_MAX ? mSlots[slot.next].previous : mLruTail) = slot.previous;
+
+	slot.previous = slot.next = UINT32_MAX;
+}
+
+void VirtualTexture::PushFront(const uint32_t pSlot)
+{
+	auto & slot = mSlots[pSlot];
+
+	slot.previous = UINT32_MAX;
+	slot.next = mLruHead;
+
+	(mLruHead != UINT32_MAX ? mSlots[mLruHead].previous : mLruTail) = pSlot;
+	mLruHead = pSlot;
+}
+
+void VirtualTexture::Touch(const uint32_t pSlot)
+{
+	mSlots[pSlot].lastUsed = mFrame;
+
+	//The tail's slots are never in the list
+	if (pSlot >= mMipCount - mTailMip && mLruHead != pSlot)
+	{
+		Unlink(pSlot);
+		PushFront(pSlot);
+	}
+}
+
+void VirtualTexture::CopyTile(const uint32_t pMip, const uint32_t pX, const uint32_t pY, uint8_t * pOutput) const
+{
+	const auto & surface = mImage->Surface(pMip);
+	const auto width = static_cast<uint32_t>(surface.rowPitch / mUnitBytes);
+	const auto height = static_cast<uint32_t>(surface.rows);
+	const auto left = static_cast<int64_t>(pX) * (VirtualTileSize / mBlockSize) - VirtualTileBorder / mBlockSize;
+	const auto top = static_cast<int64_t>(pY) * (VirtualTileSize / mBlockSize) - VirtualTileBorder / mBlockSize;
+
+	//Runs of whole rows, split where the slot wraps past an edge. Levels smaller than a tile repeat across it
+	for (uint32_t row = 0; row < mSlotUnits; row++)
+	{
+		const auto source = surface.data + Wrap(top + row, height) * surface.rowPitch;
+		auto output = pOutput + static_cast<size_t>(row) * mSlotUnits * mUnitBytes;
+
+		for (uint32_t column = 0; column < mSlotUnits;)
+		{
+			const auto x = Wrap(left + column, width);
+			const auto run = std::min(mSlotUnits - column, width - x);
+
+			memcpy(output, source + static_cast<size_t>(x) * mUnitBytes, static_cast<size_t>(run) * mUnitBytes);
+			output += static_cast<size_t>(run) * mUnitBytes;
+			column += run;
+		}
+	}
+}
+
+void VirtualTexture::Map(const uint32_t pMip, const uint32_t pX, const uint32_t pY, const uint32_t pEntry, const uint32_t pReplace)
+{
+	mPageTable[mMipOffset[pMip] + pY * mGridWidth[pMip] + pX] = pEntry;
+
+	if (pMip == 0)
+	{
+		return;
+	}
+
+	//Children still showing what this tile showed follow it, those with finer tiles of their own keep them
+	const auto mip = pMip - 1;
+
+	for (auto y = pY * 2; y < std::min(pY * 2 + 2, mGridHeight[mip]); y++)
+	{
+		for (auto x = pX * 2; x < std::min(pX * 2 + 2, mGridWidth[mip]); x++)
+		{
+			if (mPageTable[mMipOffset[mip] + y * mGridWidth[mip] + x] == pReplace)
+			{
+				Map(mip, x, y, pEntry, pReplace);
+			}
+		}
+	}
+}
+
+void VirtualTexture::Load(const uint32_t pTile, const uint32_t pSlot)
+{
+	auto & slot = mSlots[pSlot];
+
+	if (slot.tile != UINT32_MAX)
+	{
+		//Only tiles above the tail are evicted, so the parent always has an entry to fall back to
+		const auto mip = TileMip(slot.tile);
+		const auto index = slot.tile - mMipOffset[mip];
+		const auto x = index % mGridWidth[mip], y = index / mGridWidth[mip];
+
+		Map(mip, x, y, Lookup(mip + 1, x / 2, y / 2), PageEntry(pSlot, mip));
+
+		mStats.evictions++;
+		mResident--;
+	}
+
+	const auto mip = TileMip(pTile);
+	const auto index = pTile - mMipOffset[mip];
+	const auto x = index % mGridWidth[mip], y = index / mGridWidth[mip];
+
+	CopyTile(mip, x, y, mPhysical.data() + pSlot * mSlotBytes);
+	Map(mip, x, y, PageEntry(pSlot, mip), mPageTable[pTile]);
+
+	slot.tile = pTile;
+	Touch(pSlot);
+
+	mStats.loads++;
+	mResident++;
+	mUploads.push_back({ pSlot, mip, x, y });
+}
+
+void VirtualTexture::ProcessFeedback(const TileFeedback * const pFeedback, const size_t pCount)
+{
+	if (!IsValid())
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < pCount; i++)
+	{
+		const auto & feedback = pFeedback[i];
+
+		if (!std::isfinite(feedback.u) || !std::isfinite(feedback.v))
+		{
+			continue;
+		}
+
+		const auto lod = std::isfinite(feedback.lod) ? std::floor(feedback.lod) : 0.0f;
+		const auto mip = lod <= 0.0f ? 0u : std::min(static_cast<uint32_t>(std::min(lod, 64.0f)), mMipCount - 1);
+		const auto u = feedback.u - std::floor(feedback.u), v = feedback.v - std::floor(feedback.v);
+		const auto x = std::min(static_cast<uint32_t>(u * mGridWidth[mip]), mGridWidth[mip] - 1);
+		const auto y = std::min(static_cast<uint32_t>(v * mGridHeight[mip]), mGridHeight[mip] - 1);
+		const auto tile = mMipOffset[mip] + y * mGridWidth[mip] + x;
+		const auto residentMip = PageEntryMip(mPageTable[tile]);
+
+		mStats.samples++;
+		mStats.mipGap += residentMip - mip;
+
+		if (residentMip == mip)
+		{
+			mStats.sampleHits++;
+		}
+
+		if (mRequestFrame[tile] != mFrame)
+		{
+			//Whatever the tile shows now is in use, whether it is the tile or a coarser stand in
+			mRequestFrame[tile] = mFrame;
+			mStats.requests++;
+			Touch(PageEntrySlot(mPageTable[tile]));
+
+			if (residentMip == mip)
+			{
+				mStats.hits++;
+			}
+			else
+			{
+				mRequestIndex[tile] = static_cast<uint32_t>(mRequests.size());
+				mRequests.push_back({ tile, mip, 1 });
+			}
+		}
+		else if (residentMip != mip)
+		{
+			mRequests[mRequestIndex[tile]].count++;
+		}
+	}
+}
+
+void VirtualTexture::Update()
+{
+	mUploads.clear();
+
+	std::sort(mRequests.begin(), mRequests.end(), [](const Request & pA, const Request & pB)
+	{
+		return pA.mip != pB.mip ? pA.mip > pB.mip : pA.count != pB.count ? pA.count > pB.count : pA.tile < pB.tile;
+	});
+
+	uint32_t loads = 0;
+
+	for (const auto & request : mRequests)
+	{
+		//Evicting a tile this frame's feedback used would only bring it back next frame
+		const auto victim = mLruTail;
+
+		if (loads == mOptions.loadsPerFrame || victim == UINT32_MAX || (mSlots[victim].tile != UINT32_MAX && mSlots[victim].lastUsed == mFrame))
+		{
+			mStats.deferred += mRequests.size() - loads;
+			break;
+		}
+
+		Load(request.tile, victim);
+		loads++;
+	}
+
+	mRequests.clear();
+	mFrame++;
+}
+
+bool VirtualTexture::SlotTile(const uint32_t pSlot, uint32_t & pMip, uint32_t & pX, uint32_t & pY) const
+{
+	const auto tile = mSlots[pSlot].tile;
+
+	if (tile == UINT32_MAX)
+	{
+		return false;
+	}
+
+	pMip = TileMip(tile);
+	pX = (tile - mMipOffset[pMip]) % mGridWidth[pMip];
+	pY = (tile - mMipOffset[pMip]) / mGridWidth[pMip];
+
+	return true;
+}
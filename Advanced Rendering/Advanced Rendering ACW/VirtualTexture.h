@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DdsParser.h"
+
+namespace Advanced_Rendering
+{
+	constexpr uint32_t VirtualTileSize = 128;			// texels a side of the part of a level a tile covers
+	constexpr uint32_t VirtualTileBorder = 4;			// texels copied from the neighbouring tiles around it, one block
+	constexpr uint32_t VirtualNoSlot = 0xFFFFFF;
+
+	// One texel of a feedback pass: the wrapped UV a pixel sampled at and the LOD it sampled with,
+	// as CalculateLevelOfDetail gives it
+	struct TileFeedback
+	{
+		float u = 0.0f;
+		float v = 0.0f;
+		float lod = 0.0f;
+	};
+
+	// Page table entries hold the slot a tile's texels are in and the mip of the tile in that slot.
+	// A tile that is not resident holds its nearest resident ancestor's entry, so a lookup always
+	// finds texels, only blurrier.
+	inline uint32_t PageEntry(const uint32_t pSlot, const uint32_t pMip)
+	{
+		return pMip << 24 | pSlot;
+	}
+
+	inline uint32_t PageEntrySlot(const uint32_t pEntry)
+	{
+		return pEntry & VirtualNoSlot;
+	}
+
+	inline uint32_t PageEntryMip(const uint32_t pEntry)
+	{
+		return pEntry >> 24;
+	}
+
+	struct ResidencyOptions
+	{
+		size_t budgetBytes = 16 * 1024 * 1024;		// tile slots, the levels small enough to fit one tile are always resident within it
+		uint32_t loadsPerFrame = 16;				// tiles copied in at most each Update, coarsest first
+	};
+
+	struct ResidencyStats
+	{
+		uint64_t samples = 0;				// feedback texels
+		uint64_t sampleHits = 0;			// feedback texels whose tile was resident at the mip asked for
+		uint64_t mipGap = 0;				// mips between those asked for and those resident, summed over feedback texels
+		uint64_t requests = 0;				// distinct tiles a frame's feedback asked for
+		uint64_t hits = 0;					// requests already resident
+		uint64_t loads = 0;
+		uint64_t evictions = 0;
+		uint64_t deferred = 0;				// misses left for a later frame by the load limit or a budget full of tiles in use
+	};
+
+	// A slot to copy into the physical texture this frame
+	struct TileUpload
+	{
+		uint32_t slot;
+		uint32_t mip;
+		uint32_t x;
+		uint32_t y;
+	};
+
+	// Keeps the tiles of a large mipped texture that feedback asks for resident within a memory
+	// budget, least recently used first out, so the whole texture never has to be loaded. Tiles are
+	// copied on demand from the image, which is normally a mapped file, so only the pages of the file
+	// under those tiles are ever read.
+	//
+	// Slots are VirtualTileSize plus a border each side square, laid out in rows PhysicalColumns wide
+	// in the physical texture, and the page table is a mipped R32_UINT texture with a texel per tile.
+	// The border wraps as the sampler does, so bilinear filtering inside a slot matches filtering the
+	// whole texture. Call ProcessFeedback with each frame's feedback, then Update, then upload the
+	// slots in Uploads and the page table. Not thread safe; one thread drives it.
+	class VirtualTexture
+	{
+		struct Slot
+		{
+			uint32_t tile = UINT32_MAX;			// index into the page table, UINT32_MAX when empty
+			uint32_t lastUsed = 0;
+			uint32_t previous = UINT32_MAX;
+			uint32_t next = UINT32_MAX;
+		};
+
+		struct Request
+		{
+			uint32_t tile;
+			uint32_t mip;
+			uint32_t count;
+		};
+
+		const DdsImage * mImage = nullptr;
+		ResidencyOptions mOptions;
+		uint32_t mMipCount = 0;
+		uint32_t mTailMip = 0;					// first level whose grid is a single tile
+		uint32_t mBlockSize = 1;				// texels a side of a block, 4 when compressed
+		uint32_t mUnitBytes = 0;				// bytes of a block or texel
+		uint32_t mSlotUnits = 0;				// blocks or texels a side of a slot
+		size_t mSlotBytes = 0;
+		uint32_t mColumns = 0;
+		uint32_t mFrame = 1;
+		uint32_t mLruHead = UINT32_MAX;			// most recently used, tail slots are evicted first
+		uint32_t mLruTail = UINT32_MAX;
+		uint32_t mResident = 0;
+
+		std::vector<uint32_t> mGridWidth;
+		std::vector<uint32_t> mGridHeight;
+		std::vector<uint32_t> mMipOffset;
+		std::vector<uint32_t> mPageTable;
+		std::vector<uint32_t> mRequestFrame;
+		std::vector<uint32_t> mRequestIndex;
+		std::vector<Slot> mSlots;
+		std::vector<uint8_t> mPhysical;
+		std::vector<Request> mRequests;
+		std::vector<TileUpload> mUploads;
+		ResidencyStats mStats;
+
+		uint32_t TileMip(uint32_t pTile) const;
+		void Unlink(uint32_t pSlot);
+		void PushFront(uint32_t pSlot);
+		void Touch(uint32_t pSlot);
+		void CopyTile(uint32_t pMip, uint32_t pX, uint32_t pY, uint8_t * pOutput) const;
+		void Map(uint32_t pMip, uint32_t pX, uint32_t pY, uint32_t pEntry, uint32_t pReplace);
+		void Load(uint32_t pTile, uint32_t pSlot);
+
+	public:
+		// pImage must be a 2D texture with power of two sides of at least VirtualTileSize, its full
+		// mip chain and a block compressed or whole byte format, and must outlive the virtual texture
+		VirtualTexture(const DdsImage & pImage, const ResidencyOptions & pOptions);
+		~VirtualTexture() = default;
+
+		VirtualTexture(const VirtualTexture &) = delete;
+		VirtualTexture(VirtualTexture &&) = delete;
+		VirtualTexture & operator= (const VirtualTexture &) = delete;
+		VirtualTexture & operator= (VirtualTexture &&) = delete;
+
+		bool IsValid() const
+		{
+			return !mSlots.empty();
+		}
+
+		// Marks the tiles pFeedback sampled as used this frame and queues the ones that are missing
+		void ProcessFeedback(const TileFeedback * pFeedback, size_t pCount);
+
+		// Loads queued tiles, coarsest and then most asked for first, into empty slots or the least
+		// recently used ones not needed this frame, then starts the next frame
+		void Update();
+
+		// The tiles the last Update loaded, or the constructor before the first, to copy from SlotData
+		// into the physical texture
+		const std::vector<TileUpload> & Uploads() const
+		{
+			return mUploads;
+		}
+
+		const uint8_t * SlotData(const uint32_t pSlot) const
+		{
+			return mPhysical.data() + pSlot * mSlotBytes;
+		}
+
+		// False when pSlot is empty
+		bool SlotTile(uint32_t pSlot, uint32_t & pMip, uint32_t & pX, uint32_t & pY) const;
+
+		// The page table entry of a tile
+		uint32_t Lookup(const uint32_t pMip, const uint32_t pX, const uint32_t pY) const
+		{
+			return mPageTable[mMipOffset[pMip] + pY * mGridWidth[pMip] + pX];
+		}
+
+		// A level of the page table, GridWidth by GridHeight entries
+		const uint32_t * PageTable(const uint32_t pMip) const
+		{
+			return mPageTable.data() + mMipOffset[pMip];
+		}
+
+		uint32_t MipCount() const
+		{
+			return mMipCount;
+		}
+
+		uint32_t GridWidth(const uint32_t pMip) const
+		{
+			return mGridWidth[pMip];
+		}
+
+		uint32_t GridHeight(const uint32_t pMip) const
+		{
+			return mGridHeight[pMip];
+		}
+
+		uint32_t SlotCount() const
+		{
+			return static_cast<uint32_t>(mSlots.size());
+		}
+
+		uint32_t PhysicalColumns() const
+		{
+			return mColumns;
+		}
+
+		size_t SlotBytes() const
+		{
+			return mSlotBytes;
+		}
+
+		// Bytes of the slots holding tiles, the always resident tail included
+		size_t ResidentBytes() const
+		{
+			return mResident * mSlotBytes;
+		}
+
+		const ResidencyStats & Stats() const
+		{
+			return mStats;
+		}
+	};
+}